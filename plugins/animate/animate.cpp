@@ -4,6 +4,7 @@
 #include <wayfire/render-manager.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/core.hpp>
+#include <wayfire/output-layout.hpp>
 #include "animate.hpp"
 #include "plugins/common/wayfire/plugins/common/shared-core-data.hpp"
 #include "system_fade.hpp"
@@ -19,6 +20,51 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/view.hpp"
 #include <wayfire/matcher.hpp>
+#include <algorithm>
+
+class animation_hook;
+
+/**
+ * Steps all animations running on an output at once, right before each frame.
+ *
+ * Each animated view is damaged once per frame, with the union of its bounding boxes from before and after
+ * the step.
+ */
+class animation_scheduler_t : public wf::custom_data_t
+{
+    wf::output_t *output = nullptr;
+    std::vector<animation_hook*> hooks;
+
+    wf::effect_hook_t step_animations = [=] () { step_all(); };
+    void step_all();
+
+  public:
+    void add_hook(wf::output_t *wo, animation_hook *hook)
+    {
+        if (hooks.empty())
+        {
+            output = wo;
+            output->render->add_effect(&step_animations, wf::OUTPUT_EFFECT_PRE);
+        }
+
+        hooks.push_back(hook);
+    }
+
+    void remove_hook(animation_hook *hook)
+    {
+        auto it = std::find(hooks.begin(), hooks.end(), hook);
+        if (it == hooks.end())
+        {
+            return;
+        }
+
+        hooks.erase(it);
+        if (hooks.empty())
+        {
+            output->render->rem_effect(&step_animations);
+        }
+    }
+};
 
 /* Represents an animation running for a specific view
  * animation_t is which animation to use (i.e fire, zoom, etc). */
@@ -32,27 +78,21 @@ class animation_hook : public wf::custom_data_t
     std::unique_ptr<wf::animate::animation_base_t> animation;
     std::shared_ptr<wf::unmapped_view_snapshot_node> unmapped_contents;
 
-    void damage_whole_view()
-    {
-        view->damage();
-        if (unmapped_contents)
-        {
-            wf::scene::damage_node(unmapped_contents, unmapped_contents->get_bounding_box());
-        }
-    }
-
-    /* Update animation right before each frame */
-    wf::effect_hook_t update_animation_hook = [=] ()
+    /**
+     * Step the animation, called by the animation scheduler right before each frame.
+     *
+     * @return True if the animation should continue for at least one more frame.
+     */
+    bool step()
     {
-        damage_whole_view();
+        /* The transformed node contains the transformers of the animation and the unmapped contents. */
+        auto node = view->get_transformed_node();
+        wf::region_t damage = node->get_bounding_box();
         bool result = animation->step();
-        damage_whole_view();
-
-        if (!result)
-        {
-            stop_hook(false);
-        }
-    };
+        damage |= node->get_bounding_box();
+        wf::scene::damage_node(node, damage);
+        return result;
+    }
 
     /**
      * Switch the output the view is being animated on, and update the lastly
@@ -62,13 +102,12 @@ class animation_hook : public wf::custom_data_t
     {
         if (current_output)
         {
-            current_output->render->rem_effect(&update_animation_hook);
+            current_output->get_data_safe<animation_scheduler_t>()->remove_hook(this);
         }
 
         if (new_output)
         {
-            new_output->render->add_effect(&update_animation_hook,
-                wf::OUTPUT_EFFECT_PRE);
+            new_output->get_data_safe<animation_scheduler_t>()->add_hook(new_output, this);
         }
 
         current_output = new_output;
@@ -179,6 +218,25 @@ class animation_hook : public wf::custom_data_t
     animation_hook& operator =(animation_hook&&) = delete;
 };
 
+void animation_scheduler_t::step_all()
+{
+    /* Finished animations remove themselves from the list, so step a copy of it. */
+    auto stepped = hooks;
+    std::vector<animation_hook*> finished;
+    for (auto& hook : stepped)
+    {
+        if (!hook->step())
+        {
+            finished.push_back(hook);
+        }
+    }
+
+    for (auto& hook : finished)
+    {
+        hook->stop_hook(false);
+    }
+}
+
 class wayfire_animation : public wf::plugin_interface_t, private wf::per_output_tracker_mixin_t<>
 {
     wf::option_wrapper_t<std::string> open_animation{"animate/open_animation"};
@@ -235,11 +293,16 @@ class wayfire_animation : public wf::plugin_interface_t, private wf::per_output_
     void handle_output_removed(wf::output_t *output) override
     {
         cleanup_views_on_output(output);
+        output->erase_data<animation_scheduler_t>();
     }
 
     void fini() override
     {
         cleanup_views_on_output(nullptr);
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            wo->erase_data<animation_scheduler_t>();
+        }
 
         effects_registry->unregister_effect("fade");
         effects_registry->unregister_effect("zoom");
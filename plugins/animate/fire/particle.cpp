@@ -1,50 +1,45 @@
 #include "particle.hpp"
 #include "shaders.hpp"
 #include <wayfire/core.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/thread-pool.hpp>
+#include <wayfire/util/log.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
 
-void Particle::update(float time)
-{
-    if (life <= 0) // ignore
-    {
-        return;
-    }
+static wf::option_wrapper_t<bool> fire_gpu_particles{"animate/fire_gpu_particles"};
 
-    const float slowdown = 0.8;
-
-    pos   += speed * 0.2f * slowdown;
-    speed += g * 0.3f * slowdown;
+namespace
+{
+/* The number of particles updated by one task of the thread pool */
+const int PARTICLES_PER_TASK = 1024;
 
-    if (life != 0)
-    {
-        color.a /= life;
-    }
+/* The layout of a particle in the GPU buffers, see particle_update_vert_source */
+struct gpu_particle_t
+{
+    float life, fade, radius, base_radius;
+    glm::vec2 pos, speed, g, start_pos;
+    glm::vec4 color;
+};
 
-    life    -= fade * 0.3 * slowdown;
-    radius   = base_radius * std::pow(life, 0.5);
-    color.a *= life;
+static_assert(sizeof(gpu_particle_t) == 16 * sizeof(float), "gpu_particle_t must be tightly packed");
 
-    if (start_pos.x < pos.x)
-    {
-        g.x = -1;
-    } else
-    {
-        g.x = 1;
-    }
+const char *gpu_particle_varyings[] = {
+    "out_life", "out_fade", "out_radius", "out_base_radius",
+    "out_pos", "out_speed", "out_g", "out_start_pos", "out_color",
+};
 
-    if (life <= 0)
-    {
-        /* move outside */
-        pos = {-10000, -10000};
-    }
+/* Slows down the movement and fading of all particles */
+const float slowdown = 0.8;
 }
 
 ParticleSystem::ParticleSystem(int particles)
 {
+    create_program();
     resize(particles);
     last_update_msec = wf::get_current_time();
-    create_program();
-
-    particles_alive.store(0);
 }
 
 void ParticleSystem::set_initer(ParticleIniter init)
@@ -56,22 +51,71 @@ ParticleSystem::~ParticleSystem()
 {
     OpenGL::render_begin();
     program.free_resources();
+    if (gpu_simulation)
+    {
+        update_program.free_resources();
+        GL_CALL(glDeleteBuffers(2, buffers));
+    }
+
     OpenGL::render_end();
 }
 
-int ParticleSystem::spawn(int num)
+void ParticleSystem::store_particle(int i, const Particle& p)
 {
-    std::atomic<int> spawned(0);
+    life[i]   = p.life;
+    fade[i]   = p.fade;
+    radius[i] = p.radius;
+    base_radius[i] = p.base_radius;
+    pos[i]   = p.pos;
+    speed[i] = p.speed;
+    g[i]     = p.g;
+    start_pos[i] = p.start_pos;
+    color[i]     = p.color;
+}
 
-#   pragma omp parallel for
-    for (size_t i = 0; i < ps.size(); i++)
+void ParticleSystem::move_particle(int from, int to)
+{
+    life[to]   = life[from];
+    fade[to]   = fade[from];
+    radius[to] = radius[from];
+    base_radius[to] = base_radius[from];
+    pos[to]   = pos[from];
+    speed[to] = speed[from];
+    g[to]     = g[from];
+    start_pos[to] = start_pos[from];
+    color[to]     = color[from];
+}
+
+int ParticleSystem::spawn(int num)
+{
+    int spawned = 0;
+    Particle p;
+    if (gpu_simulation)
     {
-        if ((ps[i].life <= 0) && (spawned < num))
+        /* The particles stay in their slots on the GPU, so dead slots are
+         * reused. The new particles are uploaded on the next update. */
+        for (int i = 0; (i < max_particles) && (spawned < num); i++)
         {
-            pinit_func(ps[i]);
-            ++spawned;
-            ++particles_alive;
+            if (life[i] <= 0)
+            {
+                pinit_func(p);
+                store_particle(i, p);
+                spawned_particles.push_back(i);
+                ++spawned;
+                ++particles_alive;
+            }
         }
+
+        return spawned;
+    }
+
+    /* The live particles are compacted, so new ones are simply appended */
+    while ((spawned < num) && (particles_alive < max_particles))
+    {
+        pinit_func(p);
+        store_particle(particles_alive, p);
+        ++particles_alive;
+        ++spawned;
     }
 
     return spawned;
@@ -79,70 +123,119 @@ int ParticleSystem::spawn(int num)
 
 void ParticleSystem::resize(int num)
 {
-    if (num == (int)ps.size())
+    if (num == max_particles)
     {
         return;
     }
 
-#   pragma omp parallel for
-    for (size_t i = num; i < ps.size(); i++)
+    if (gpu_simulation)
     {
-        if (ps[i].life >= 0)
+        for (int i = num; i < max_particles; i++)
         {
-            --particles_alive;
+            if (life[i] > 0)
+            {
+                --particles_alive;
+            }
         }
+    } else
+    {
+        particles_alive = std::min(particles_alive, num);
     }
 
-    ps.resize(num);
-
-    color.resize(color_per_particle * num);
-    dark_color.resize(color_per_particle * num);
-    radius.resize(radius_per_particle * num);
-    center.resize(center_per_particle * num);
+    max_particles = num;
+    life.resize(num, -1);
+    fade.resize(num);
+    radius.resize(num);
+    base_radius.resize(num);
+    pos.resize(num);
+    speed.resize(num);
+    g.resize(num);
+    start_pos.resize(num);
+    color.resize(num);
+
+    if (gpu_simulation)
+    {
+        spawned_particles.erase(std::remove_if(spawned_particles.begin(), spawned_particles.end(),
+            [=] (int i) { return i >= num; }), spawned_particles.end());
+        resize_gpu_buffers(num);
+    }
 }
 
 int ParticleSystem::size()
 {
-    return ps.size();
+    return max_particles;
 }
 
-void ParticleSystem::update_worker(float time, int i)
+void ParticleSystem::update_cpu()
 {
-    if (ps[i].life <= 0)
+    const int count = particles_alive;
+
+    /* Chunks of particles are updated on the thread pool, and each array is processed independently by the
+     * vector units */
+    const int chunks = (count + PARTICLES_PER_TASK - 1) / PARTICLES_PER_TASK;
+    wf::thread_pool_t::get().parallel_for(chunks, [&] (size_t chunk)
     {
-        return;
-    }
+        const int begin = chunk * PARTICLES_PER_TASK;
+        const int end   = std::min(count, begin + PARTICLES_PER_TASK);
+#       pragma omp simd
+        for (int i = begin; i < end; i++)
+        {
+            pos[i]   += speed[i] * 0.2f * slowdown;
+            speed[i] += g[i] * 0.3f * slowdown;
 
-    ps[i].update(time);
+            const float new_life = life[i] - fade[i] * 0.3f * slowdown;
+            color[i].a = color[i].a / life[i] * new_life;
+            radius[i]  = base_radius[i] * std::sqrt(std::max(new_life, 0.0f));
+            life[i]    = new_life;
 
-    if (ps[i].life <= 0)
-    {
-        --particles_alive;
-    }
+            g[i].x = (start_pos[i].x < pos[i].x) ? -1.0f : 1.0f;
+        }
+    });
 
-    for (int j = 0; j < 4; j++) // maybe use memcpy?
+    /* Compact the live particles, by moving the last live particle into the
+     * slot of each dead one. The order does not matter for the blending. */
+    int i = 0;
+    while (i < particles_alive)
     {
-        color[4 * i + j] = ps[i].color[j];
-        dark_color[4 * i + j] = ps[i].color[j] * 0.5;
+        if (life[i] <= 0)
+        {
+            --particles_alive;
+            move_particle(particles_alive, i);
+        } else
+        {
+            ++i;
+        }
     }
-
-    center[2 * i]     = ps[i].pos[0];
-    center[2 * i + 1] = ps[i].pos[1];
-
-    radius[i] = ps[i].radius;
 }
 
 void ParticleSystem::update()
 {
-    // FIXME: don't hardcode 60FPS
-    float time = (wf::get_current_time() - last_update_msec) / 16.0;
+    // FIXME: don't hardcode 60FPS, each update is one step of the particles
     last_update_msec = wf::get_current_time();
 
-#   pragma omp parallel for
-    for (size_t i = 0; i < ps.size(); i++)
+    if (!gpu_simulation)
     {
-        update_worker(time, i);
+        update_cpu();
+        return;
     }
+
+    /* Only the life of the particles is tracked on the CPU, exactly like in
+     * particle_update_vert_source. */
+    for (int i = 0; i < max_particles; i++)
+    {
+        if (life[i] > 0)
+        {
+            life[i] -= fade[i] * 0.3f * slowdown;
+            if (life[i] <= 0)
+            {
+                --particles_alive;
+            }
+        }
+    }
+
+    OpenGL::render_begin();
+    update_gpu();
+    OpenGL::render_end();
 }
 
 int ParticleSystem::statistic()
@@ -156,9 +249,151 @@ void ParticleSystem::create_program()
     OpenGL::render_begin();
     program.set_simple(OpenGL::compile_program(particle_vert_source,
         particle_frag_source));
+    gpu_simulation = fire_gpu_particles && create_gpu_programs();
     OpenGL::render_end();
 }
 
+bool ParticleSystem::create_gpu_programs()
+{
+    GLint major = 0;
+    GL_CALL(glGetIntegerv(GL_MAJOR_VERSION, &major));
+    if (major < 3)
+    {
+        return false;
+    }
+
+    GLuint vertex_shader = OpenGL::compile_shader(particle_update_vert_source, GL_VERTEX_SHADER);
+    GLuint frag_shader   = OpenGL::compile_shader(particle_update_frag_source, GL_FRAGMENT_SHADER);
+    if ((vertex_shader == (GLuint)-1) || (frag_shader == (GLuint)-1))
+    {
+        return false;
+    }
+
+    /* The varyings have to be set before linking, so compile_program() cannot be used here. */
+    GLuint id = GL_CALL(glCreateProgram());
+    GL_CALL(glAttachShader(id, vertex_shader));
+    GL_CALL(glAttachShader(id, frag_shader));
+    GL_CALL(glTransformFeedbackVaryings(id, std::size(gpu_particle_varyings), gpu_particle_varyings,
+        GL_INTERLEAVED_ATTRIBS));
+    GL_CALL(glLinkProgram(id));
+    GL_CALL(glDeleteShader(vertex_shader));
+    GL_CALL(glDeleteShader(frag_shader));
+
+    GLint status = GL_FALSE;
+    GL_CALL(glGetProgramiv(id, GL_LINK_STATUS, &status));
+    if (status == GL_FALSE)
+    {
+        LOGE("Failed to link the fire particle update shader, falling back to CPU particles.");
+        GL_CALL(glDeleteProgram(id));
+        return false;
+    }
+
+    update_program.set_simple(id);
+    return true;
+}
+
+void ParticleSystem::resize_gpu_buffers(int num)
+{
+    OpenGL::render_begin();
+    GLuint new_buffers[2];
+    GL_CALL(glGenBuffers(2, new_buffers));
+
+    gpu_particle_t dead{};
+    dead.life = -1;
+    dead.pos  = {-10000, -10000};
+    std::vector<gpu_particle_t> initial(num, dead);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, new_buffers[0]));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, num * sizeof(gpu_particle_t), initial.data(), GL_DYNAMIC_COPY));
+    /* The other buffer is completely overwritten by the next update */
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, new_buffers[1]));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, num * sizeof(gpu_particle_t), nullptr, GL_DYNAMIC_COPY));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    if (buffers[current])
+    {
+        /* Keep the particles which are still alive */
+        const int kept = std::min(num, buffer_size);
+        GL_CALL(glBindBuffer(GL_COPY_READ_BUFFER, buffers[current]));
+        GL_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffers[0]));
+        GL_CALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+            kept * sizeof(gpu_particle_t)));
+        GL_CALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        GL_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+        GL_CALL(glDeleteBuffers(2, buffers));
+    }
+
+    buffers[0]  = new_buffers[0];
+    buffers[1]  = new_buffers[1];
+    current     = 0;
+    buffer_size = num;
+    OpenGL::render_end();
+}
+
+void ParticleSystem::upload_spawned_particles()
+{
+    if (spawned_particles.empty())
+    {
+        return;
+    }
+
+    /* Spawned particles mostly fill consecutive slots, upload them in runs */
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, buffers[current]));
+    std::vector<gpu_particle_t> run;
+    size_t i = 0;
+    while (i < spawned_particles.size())
+    {
+        const int first = spawned_particles[i];
+        run.clear();
+        while ((i < spawned_particles.size()) && (spawned_particles[i] == first + (int)run.size()))
+        {
+            const int j = spawned_particles[i];
+            run.push_back(gpu_particle_t{life[j], fade[j], radius[j], base_radius[j],
+                pos[j], speed[j], g[j], start_pos[j], color[j]});
+            ++i;
+        }
+
+        GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(gpu_particle_t),
+            run.size() * sizeof(gpu_particle_t), run.data()));
+    }
+
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    spawned_particles.clear();
+}
+
+void ParticleSystem::update_gpu()
+{
+    upload_spawned_particles();
+
+    update_program.use(wf::TEXTURE_TYPE_RGBA);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, buffers[current]));
+    auto attrib = [&] (const std::string& name, int size, size_t offset)
+    {
+        update_program.attrib_pointer(name, size, sizeof(gpu_particle_t), (void*)offset);
+    };
+
+    attrib("life", 1, offsetof(gpu_particle_t, life));
+    attrib("fade", 1, offsetof(gpu_particle_t, fade));
+    attrib("radius", 1, offsetof(gpu_particle_t, radius));
+    attrib("base_radius", 1, offsetof(gpu_particle_t, base_radius));
+    attrib("pos", 2, offsetof(gpu_particle_t, pos));
+    attrib("speed", 2, offsetof(gpu_particle_t, speed));
+    attrib("g", 2, offsetof(gpu_particle_t, g));
+    attrib("start_pos", 2, offsetof(gpu_particle_t, start_pos));
+    attrib("color", 4, offsetof(gpu_particle_t, color));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    GL_CALL(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[1 - current]));
+    GL_CALL(glEnable(GL_RASTERIZER_DISCARD));
+    GL_CALL(glBeginTransformFeedback(GL_POINTS));
+    GL_CALL(glDrawArrays(GL_POINTS, 0, buffer_size));
+    GL_CALL(glEndTransformFeedback());
+    GL_CALL(glDisable(GL_RASTERIZER_DISCARD));
+    GL_CALL(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0));
+
+    update_program.deactivate();
+    current = 1 - current;
+}
+
 void ParticleSystem::render(glm::mat4 matrix)
 {
     program.use(wf::TEXTURE_TYPE_RGBA);
@@ -172,31 +407,46 @@ void ParticleSystem::render(glm::mat4 matrix)
     program.attrib_pointer("position", 2, 0, vertex_data);
     program.attrib_divisor("position", 0);
 
-    program.attrib_pointer("radius", 1, 0, radius.data());
-    program.attrib_divisor("radius", 1);
+    int count;
+    if (gpu_simulation)
+    {
+        /* The particle attributes are read directly from the GPU buffer */
+        count = max_particles;
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, buffers[current]));
+        program.attrib_pointer("radius", 1, sizeof(gpu_particle_t), (void*)offsetof(gpu_particle_t, radius));
+        program.attrib_pointer("center", 2, sizeof(gpu_particle_t), (void*)offsetof(gpu_particle_t, pos));
+        program.attrib_pointer("color", 4, sizeof(gpu_particle_t), (void*)offsetof(gpu_particle_t, color));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    } else
+    {
+        /* Only the live particles, which are at the start of the arrays */
+        count = particles_alive;
+        program.attrib_pointer("radius", 1, 0, radius.data());
+        program.attrib_pointer("center", 2, 0, pos.data());
+        program.attrib_pointer("color", 4, 0, color.data());
+    }
 
-    program.attrib_pointer("center", 2, 0, center.data());
+    program.attrib_divisor("radius", 1);
     program.attrib_divisor("center", 1);
+    program.attrib_divisor("color", 1);
 
     // matrix
     program.uniformMatrix4f("matrix", matrix);
 
     /* Darken the background */
-    program.attrib_pointer("color", 4, 0, dark_color.data());
-    program.attrib_divisor("color", 1);
-
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
     program.uniform1f("smoothing", 0.7);
+    program.uniform1f("color_scale", 0.5);
 
     // TODO: optimize shaders for this case
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, count));
 
     // particle color
-    program.attrib_pointer("color", 4, 0, color.data());
     GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
     program.uniform1f("smoothing", 0.5);
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    program.uniform1f("color_scale", 1.0);
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, count));
 
     GL_CALL(glDisable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
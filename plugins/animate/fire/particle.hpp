@@ -3,9 +3,9 @@
 
 #include <wayfire/opengl.hpp>
 #include <functional>
-#include <atomic>
 #include <vector>
 
+/* The initial state of a newly spawned particle */
 struct Particle
 {
     float life = -1;
@@ -17,11 +17,6 @@ struct Particle
     glm::vec2 start_pos;
 
     glm::vec4 color{1.0, 1.0, 1.0, 1.0};
-
-    /* update the given particle
-     * time is the percentage of the frame which has elapsed
-     * must be thread-safe */
-    void update(float time);
 };
 
 /* a function to initialize a particle */
@@ -69,21 +64,38 @@ class ParticleSystem
     ParticleIniter pinit_func = [] (auto) {};
     uint32_t last_update_msec;
 
-    std::atomic<int> particles_alive;
-    std::vector<Particle> ps;
-
-    static constexpr int color_per_particle = 4;
-    std::vector<float> color, dark_color;
+    int particles_alive = 0;
+    int max_particles   = 0;
 
-    static constexpr int radius_per_particle = 1;
-    std::vector<float> radius;
-
-    static constexpr int center_per_particle = 2;
-    std::vector<float> center;
+    /* The state of the particles, as a structure of arrays. They are rendered
+     * directly from these arrays. Without GPU simulation, the live particles
+     * are kept compacted at the start of the arrays. */
+    std::vector<float> life, fade, radius, base_radius;
+    std::vector<glm::vec2> pos, speed, g, start_pos;
+    std::vector<glm::vec4> color;
 
     OpenGL::program_t program;
-    void update_worker(float time, int i);
+    void store_particle(int i, const Particle& p);
+    void move_particle(int from, int to);
+    void update_cpu();
     void create_program();
+
+    /* When supported, the particles are stepped on the GPU with transform
+     * feedback and stay in GPU memory. The CPU then only tracks the life of
+     * each particle, to know which slots can be reused by spawn(). */
+    bool gpu_simulation = false;
+    OpenGL::program_t update_program;
+    /* The particle buffers, stepped from buffers[current] to the other one */
+    GLuint buffers[2] = {0, 0};
+    int current = 0;
+    int buffer_size = 0;
+    /* Particles spawned since the last update, still to be uploaded */
+    std::vector<int> spawned_particles;
+
+    bool create_gpu_programs();
+    void resize_gpu_buffers(int num);
+    void upload_spawned_particles();
+    void update_gpu();
 };
 
 
@@ -11,6 +11,7 @@ attribute mediump vec2 center;
 attribute mediump vec4 color;
 
 uniform mat4 matrix;
+uniform mediump float color_scale;
 
 varying mediump vec2 uv;
 varying mediump vec4 out_color;
@@ -21,7 +22,7 @@ void main() {
     gl_Position = matrix * vec4(center.x + uv.x * 0.75, center.y + uv.y, 0.0, 1.0);
 
     R = radius;
-    out_color = color;
+    out_color = color * color_scale;
 }
 )";
 
@@ -50,4 +51,74 @@ void main()
 }
 )";
 
+/* Steps the particles on the GPU, the same way as
+ * ParticleSystem::update_cpu(). The result is captured with transform
+ * feedback. */
+static const char *particle_update_vert_source =
+    R"(
+#version 300 es
+
+in float life;
+in float fade;
+in float radius;
+in float base_radius;
+in vec2 pos;
+in vec2 speed;
+in vec2 g;
+in vec2 start_pos;
+in vec4 color;
+
+out float out_life;
+out float out_fade;
+out float out_radius;
+out float out_base_radius;
+out vec2 out_pos;
+out vec2 out_speed;
+out vec2 out_g;
+out vec2 out_start_pos;
+out vec4 out_color;
+
+void main() {
+    out_life = life;
+    out_fade = fade;
+    out_radius = radius;
+    out_base_radius = base_radius;
+    out_pos = pos;
+    out_speed = speed;
+    out_g = g;
+    out_start_pos = start_pos;
+    out_color = color;
+
+    if (life > 0.0)
+    {
+        const float slowdown = 0.8;
+        out_pos = pos + speed * 0.2 * slowdown;
+        out_speed = speed + g * 0.3 * slowdown;
+
+        out_life = life - fade * 0.3 * slowdown;
+        out_radius = base_radius * sqrt(max(out_life, 0.0));
+        out_color.a = color.a / life * out_life;
+        out_g.x = (start_pos.x < out_pos.x) ? -1.0 : 1.0;
+
+        if (out_life <= 0.0)
+        {
+            /* move outside */
+            out_pos = vec2(-10000.0, -10000.0);
+        }
+    }
+}
+)";
+
+static const char *particle_update_frag_source =
+    R"(
+#version 300 es
+
+out mediump vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(0.0);
+}
+)";
+
 #endif /* end of include guard: PARTICLE_ANIMATION_SHADER */
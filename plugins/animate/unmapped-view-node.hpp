@@ -9,16 +9,54 @@
 
 namespace wf
 {
+/**
+ * A node which shows the last contents of a view after it was unmapped.
+ *
+ * The contents are not copied when the view is unmapped, as this would delay the handling of the unmap (and
+ * therefore the start of the close animation). Instead, the render instances of the view's surfaces are
+ * generated immediately, which keeps the surfaces' last buffers alive, and the snapshot is rendered from them
+ * together with the first frame which shows the node.
+ */
 class unmapped_view_snapshot_node : public wf::scene::node_t
 {
     wf::render_target_t snapshot;
     wf::geometry_t bbox;
+    float scale = 1.0;
+    std::vector<scene::render_instance_uptr> pending_contents;
+
+    void ensure_snapshot()
+    {
+        if (pending_contents.empty())
+        {
+            return;
+        }
+
+        OpenGL::gpu_memory_scope_t memory_scope{[this] ()
+        {
+            return scene::gpu_memory_owner_of(this, "animate");
+        }};
+        OpenGL::render_begin();
+        snapshot.allocate(bbox.width * scale, bbox.height * scale);
+        OpenGL::render_end();
+        snapshot.geometry = bbox;
+        snapshot.scale    = scale;
+
+        scene::render_pass_params_t params;
+        params.background_color = {0, 0, 0, 0};
+        params.damage    = bbox;
+        params.target    = snapshot;
+        params.instances = &pending_contents;
+        scene::run_render_pass(params, scene::RPASS_CLEAR_BACKGROUND);
+        pending_contents.clear();
+    }
 
   public:
     unmapped_view_snapshot_node(wayfire_view view) : node_t(false)
     {
-        view->take_snapshot(snapshot);
-        bbox = view->get_surface_root_node()->get_bounding_box();
+        auto root_node = view->get_surface_root_node();
+        bbox  = root_node->get_bounding_box();
+        scale = view->get_output()->handle->scale;
+        root_node->gen_render_instances(pending_contents, [] (auto) {}, view->get_output());
     }
 
     ~unmapped_view_snapshot_node()
@@ -49,6 +87,14 @@ class unmapped_view_snapshot_node : public wf::scene::node_t
     {
       public:
         using simple_render_instance_t::simple_render_instance_t;
+        void schedule_instructions(std::vector<scene::render_instruction_t>& instructions,
+            const wf::render_target_t& target, wf::region_t& damage) override
+        {
+            // Render the snapshot before the instructions of the current render pass are executed.
+            self->ensure_snapshot();
+            simple_render_instance_t::schedule_instructions(instructions, target, damage);
+        }
+
         void render(const wf::render_target_t& target, const wf::region_t& region)
         {
             OpenGL::render_begin(target);
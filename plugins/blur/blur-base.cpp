@@ -7,6 +7,7 @@
 #include <wayfire/output.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/util/log.hpp>
+#include <cmath>
 
 static const char *blur_blend_vertex_shader =
     R"(
@@ -73,6 +74,7 @@ wf_blur_base::wf_blur_base(std::string name)
     this->offset_opt.set_callback(options_changed);
     this->degrade_opt.set_callback(options_changed);
     this->iterations_opt.set_callback(options_changed);
+    this->intermediate_format_opt.set_callback(options_changed);
 
     OpenGL::render_begin();
     blend_program.compile(blur_blend_vertex_shader, blur_blend_fragment_shader);
@@ -82,8 +84,8 @@ wf_blur_base::wf_blur_base(std::string name)
 wf_blur_base::~wf_blur_base()
 {
     OpenGL::render_begin();
-    fb[0].release();
-    fb[1].release();
+    release_intermediate(0);
+    release_intermediate(1);
     program[0].free_resources();
     program[1].free_resources();
     blend_program.free_resources();
@@ -95,6 +97,96 @@ int wf_blur_base::calculate_blur_radius()
     return offset_opt * degrade_opt * std::max(1, (int)iterations_opt);
 }
 
+void wf_blur_base::set_iteration_limit(int limit)
+{
+    iteration_limit = std::max(limit, 0);
+}
+
+int wf_blur_base::get_iterations()
+{
+    if (iteration_limit > 0)
+    {
+        return std::min((int)iterations_opt, iteration_limit);
+    }
+
+    return iterations_opt;
+}
+
+void wf_blur_base::release_intermediate(int index)
+{
+    if (fb_format[index] == GL_RGBA8)
+    {
+        fb[index].release();
+        return;
+    }
+
+    GL_CALL(glDeleteFramebuffers(1, &fb[index].fb));
+    GL_CALL(glDeleteTextures(1, &fb[index].tex));
+    OpenGL::untrack_gpu_memory(fb[index].tex);
+    fb[index].reset();
+    fb_format[index] = GL_RGBA8;
+}
+
+void wf_blur_base::allocate_intermediate(wf::framebuffer_t& buffer, int width, int height)
+{
+    OpenGL::gpu_memory_scope_t memory_scope{[] () { return OpenGL::gpu_memory_owner_t{"blur"}; }};
+    const int index = (&buffer == &fb[1]) ? 1 : 0;
+
+    /* RGB565 halves the bandwidth of each iteration, but drops the alpha channel
+     * of the background. Formats with float channels cannot be used, because
+     * GLES does not allow blitting between fixed point and float buffers. */
+    GLenum format = GL_RGBA8;
+    if ((intermediate_format_opt.value() == "rgb565") && !reduced_format_failed)
+    {
+        format = GL_RGB565;
+    }
+
+    if (format == GL_RGBA8)
+    {
+        if (fb_format[index] != GL_RGBA8)
+        {
+            release_intermediate(index);
+        }
+
+        buffer.allocate(width, height);
+        return;
+    }
+
+    if ((fb_format[index] == format) && (buffer.viewport_width == width) &&
+        (buffer.viewport_height == height))
+    {
+        return;
+    }
+
+    release_intermediate(index);
+    GL_CALL(glGenTextures(1, &buffer.tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, buffer.tex));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0));
+    OpenGL::track_gpu_memory(buffer.tex, uint64_t(width) * height * 2);
+
+    GL_CALL(glGenFramebuffers(1, &buffer.fb));
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, buffer.fb));
+    GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.tex, 0));
+    auto status = GL_CALL(glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+
+    buffer.viewport_width  = width;
+    buffer.viewport_height = height;
+    fb_format[index] = format;
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOGE("blur: cannot render to RGB565 buffers, using RGBA8 instead.");
+        reduced_format_failed = true;
+        release_intermediate(index);
+        buffer.allocate(width, height);
+    }
+}
+
 void wf_blur_base::render_iteration(wf::region_t blur_region,
     wf::framebuffer_t& in, wf::framebuffer_t& out,
     int width, int height)
@@ -104,7 +196,7 @@ void wf_blur_base::render_iteration(wf::region_t blur_region,
     width  = std::max(width, 1);
     height = std::max(height, 1);
 
-    out.allocate(width, height);
+    allocate_intermediate(out, width, height);
     out.bind();
 
     GL_CALL(glBindTexture(GL_TEXTURE_2D, in.tex));
@@ -163,7 +255,7 @@ wlr_box wf_blur_base::copy_region(wf::framebuffer_t& result,
     int degraded_height = subbox.height / degrade_opt;
 
     OpenGL::render_begin(source);
-    result.allocate(degraded_width, degraded_height);
+    allocate_intermediate(result, degraded_width, degraded_height);
 
     GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, source.fb));
     GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, result.fb));
@@ -208,6 +300,7 @@ void wf_blur_base::prepare_blur(const wf::render_target_t& target_fb, const wf::
     if (r != 0)
     {
         std::swap(fb[0], fb[1]);
+        std::swap(fb_format[0], fb_format[1]);
     }
 
     prepared_geometry = damage_box;
@@ -218,8 +311,90 @@ static wf::pointf_t get_center(wf::geometry_t g)
     return {g.x + g.width / 2.0, g.y + g.height / 2.0};
 }
 
+static void copy_framebuffer(const wf::framebuffer_t& from, wf::framebuffer_t& to)
+{
+    OpenGL::gpu_memory_scope_t memory_scope{[] () { return OpenGL::gpu_memory_owner_t{"blur"}; }};
+    OpenGL::render_begin();
+    to.allocate(from.viewport_width, from.viewport_height);
+    GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, from.fb));
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, to.fb));
+    GL_CALL(glBlitFramebuffer(0, 0, from.viewport_width, from.viewport_height,
+        0, 0, from.viewport_width, from.viewport_height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    OpenGL::render_end();
+}
+
+void copy_backdrop(const blurred_backdrop_t& from, blurred_backdrop_t& to)
+{
+    copy_framebuffer(from.fb, to.fb);
+    to.geometry = from.geometry;
+}
+
+void wf_blur_base::save_backdrop(blurred_backdrop_t& backdrop)
+{
+    copy_framebuffer(fb[0], backdrop.fb);
+    backdrop.geometry = prepared_geometry;
+}
+
+/**
+ * Find the texels of a blurred buffer which contain the framebuffer box @box. The buffer covers @covered
+ * (in framebuffer coordinates) and is upside down, like the buffers filled by copy_region().
+ */
+static wf::geometry_t box_in_blurred_buffer(wf::geometry_t box, wf::geometry_t covered,
+    const wf::framebuffer_t& buffer)
+{
+    const double sx = 1.0 * buffer.viewport_width / std::max(covered.width, 1);
+    const double sy = 1.0 * buffer.viewport_height / std::max(covered.height, 1);
+
+    const int x1 = std::round((box.x - covered.x) * sx);
+    const int x2 = std::round((box.x + box.width - covered.x) * sx);
+    const int y1 = std::round((covered.y + covered.height - box.y - box.height) * sy);
+    const int y2 = std::round((covered.y + covered.height - box.y) * sy);
+    return {x1, y1, x2 - x1, y2 - y1};
+}
+
+void wf_blur_base::update_backdrop(blurred_backdrop_t& backdrop, const wf::render_target_t& target_fb,
+    const wf::region_t& region)
+{
+    OpenGL::render_begin();
+    GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fb[0].fb));
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, backdrop.fb.fb));
+    for (const auto& rect : region)
+    {
+        auto box = target_fb.framebuffer_box_from_geometry_box(wlr_box_from_pixman_box(rect));
+        box = wf::geometry_intersection(wf::geometry_intersection(box, prepared_geometry),
+            backdrop.geometry);
+        if ((box.width <= 0) || (box.height <= 0))
+        {
+            continue;
+        }
+
+        auto src = box_in_blurred_buffer(box, prepared_geometry, fb[0]);
+        auto dst = box_in_blurred_buffer(box, backdrop.geometry, backdrop.fb);
+        GL_CALL(glBlitFramebuffer(src.x, src.y, src.x + src.width, src.y + src.height,
+            dst.x, dst.y, dst.x + dst.width, dst.y + dst.height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    }
+
+    OpenGL::render_end();
+}
+
 void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
     const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb)
+{
+    render_with_background(fb[0].tex, prepared_geometry, src_tex, src_box, damage,
+        background_source_fb, target_fb);
+}
+
+void wf_blur_base::render(const blurred_backdrop_t& backdrop, wf::texture_t src_tex, wlr_box src_box,
+    const wf::region_t& damage, const wf::render_target_t& background_source_fb,
+    const wf::render_target_t& target_fb)
+{
+    render_with_background(backdrop.fb.tex, backdrop.geometry, src_tex, src_box, damage,
+        background_source_fb, target_fb);
+}
+
+void wf_blur_base::render_with_background(GLuint bg_tex, wf::geometry_t bg_box,
+    wf::texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
+    const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb)
 {
     OpenGL::render_begin(target_fb);
     blend_program.use(src_tex.type);
@@ -253,8 +428,8 @@ void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box, const wf::regi
     // 3. Scale to match the view size
     // 4. Translate to match the view
     auto view_box    = background_source_fb.framebuffer_box_from_geometry_box(src_box); // Projected view
-    auto blurred_box = prepared_geometry;
-    // prepared_geometry is the projected damage bounding box
+    auto blurred_box = bg_box;
+    // bg_box is the projected damage bounding box
 
     glm::mat4 fb_fix   = target_fb.transform;
     const auto scale_x = 1.0 * view_box.width / blurred_box.width;
@@ -277,7 +452,7 @@ void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box, const wf::regi
 
     blend_program.set_active_texture(src_tex);
     GL_CALL(glActiveTexture(GL_TEXTURE0 + 1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, fb[0].tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, bg_tex));
     /* Render it to target_fb */
     target_fb.bind();
 
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "blur.hpp"
+#include "plugins/ipc/ipc-helpers.hpp"
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include "wayfire/plugins/common/shared-core-data.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <set>
+
+namespace wf
+{
+namespace blur
+{
+/**
+ * The result of benchmarking one configuration of a blur algorithm.
+ */
+struct benchmark_result_t
+{
+    std::string algorithm;
+    int degrade    = 1;
+    int iterations = 1;
+    int radius     = 0;
+    int width  = 0;
+    int height = 0;
+    /** The time needed to blur the whole buffer once, in microseconds. */
+    double time_us = 0;
+};
+
+/**
+ * A benchmark of the blur algorithms, exposed as the blur/benchmark IPC method.
+ *
+ * Each algorithm is run offscreen for every combination of the requested degrade and iteration values and
+ * buffer sizes. The GPU time is measured with timer queries if GL_EXT_disjoint_timer_query is supported,
+ * otherwise the CPU time between two glFinish() calls is used.
+ *
+ * The benchmark is synchronous, so the compositor does not render anything else while it is running.
+ */
+class blur_benchmark_t
+{
+    // From GL_EXT_disjoint_timer_query
+    static constexpr GLenum TIME_ELAPSED_QUERY = 0x88BF;
+    static constexpr GLenum GPU_DISJOINT_QUERY = 0x8FBB;
+
+    wf::shared_data::ref_ptr_t<wf::ipc::method_repository_t> method_repository;
+
+    static bool supports_timer_queries()
+    {
+        auto extensions = (const char*)glGetString(GL_EXTENSIONS);
+        return extensions && strstr(extensions, "GL_EXT_disjoint_timer_query");
+    }
+
+    /**
+     * Temporarily override the blur options of an algorithm, restoring them when destroyed.
+     */
+    class option_override_t
+    {
+        std::vector<std::pair<std::shared_ptr<wf::config::option_base_t>, std::string>> saved;
+
+      public:
+        void set(const std::string& name, const std::string& value)
+        {
+            auto opt = wf::get_core().config.get_option(name);
+            if (opt)
+            {
+                saved.emplace_back(opt, opt->get_value_str());
+                opt->set_value_str(value);
+            }
+        }
+
+        ~option_override_t()
+        {
+            for (auto it = saved.rbegin(); it != saved.rend(); ++it)
+            {
+                it->first->set_value_str(it->second);
+            }
+        }
+    };
+
+    static double measure(wf_blur_base& blur, int width, int height, int repeat, bool timer_queries)
+    {
+        wf::render_target_t target;
+        target.geometry = {0, 0, width, height};
+
+        OpenGL::render_begin();
+        target.allocate(width, height);
+        OpenGL::render_end();
+
+        // The contents do not matter for the performance, but the buffer should not be uninitialized.
+        OpenGL::render_begin(target);
+        OpenGL::clear({0.2, 0.4, 0.6, 1.0});
+        OpenGL::render_end();
+
+        wf::region_t region{target.geometry};
+
+        // Warm up, so that the buffers of the algorithm are already allocated.
+        blur.prepare_blur(target, region);
+
+        double time_us = 0;
+        OpenGL::render_begin();
+        if (timer_queries)
+        {
+            GLuint query;
+            GL_CALL(glGenQueries(1, &query));
+            GLint disjoint = 0;
+            GL_CALL(glGetIntegerv(GPU_DISJOINT_QUERY, &disjoint));
+            GL_CALL(glBeginQuery(TIME_ELAPSED_QUERY, query));
+            for (int i = 0; i < repeat; i++)
+            {
+                blur.prepare_blur(target, region);
+            }
+
+            GL_CALL(glEndQuery(TIME_ELAPSED_QUERY));
+
+            // Waits until the result is available.
+            GLuint elapsed_ns = 0;
+            GL_CALL(glGetQueryObjectuiv(query, GL_QUERY_RESULT, &elapsed_ns));
+            GL_CALL(glGetIntegerv(GPU_DISJOINT_QUERY, &disjoint));
+            GL_CALL(glDeleteQueries(1, &query));
+            time_us = disjoint ? -1 : elapsed_ns / 1000.0 / repeat;
+        } else
+        {
+            using clock = std::chrono::steady_clock;
+            GL_CALL(glFinish());
+            auto start = clock::now();
+            for (int i = 0; i < repeat; i++)
+            {
+                blur.prepare_blur(target, region);
+            }
+
+            GL_CALL(glFinish());
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+            time_us = 1.0 * elapsed.count() / repeat;
+        }
+
+        target.release();
+        OpenGL::render_end();
+        return time_us;
+    }
+
+    static std::vector<int> get_int_list(const nlohmann::json& data, const std::string& field,
+        std::vector<int> fallback)
+    {
+        if (!data.contains(field))
+        {
+            return fallback;
+        }
+
+        std::vector<int> result;
+        for (auto& value : data[field])
+        {
+            if (value.is_number_integer() && ((int)value > 0))
+            {
+                result.push_back(value);
+            }
+        }
+
+        return result.empty() ? fallback : result;
+    }
+
+    static nlohmann::json result_to_json(const benchmark_result_t& result)
+    {
+        nlohmann::json j;
+        j["algorithm"]  = result.algorithm;
+        j["degrade"]    = result.degrade;
+        j["iterations"] = result.iterations;
+        j["radius"]     = result.radius;
+        j["width"]      = result.width;
+        j["height"]     = result.height;
+        j["time-us"]    = result.time_us;
+        return j;
+    }
+
+    /**
+     * Run the benchmark.
+     *
+     * Optional arguments:
+     * - algorithms: the algorithms to test, by default all of them.
+     * - sizes: a list of [width, height] buffer sizes, by default the sizes of the outputs.
+     * - degrade, iterations: the values to test for the corresponding options.
+     * - repeat: how many times each configuration is run.
+     * - target-radius: if given, the cheapest configuration with at least this blur radius (at the largest
+     *   tested size) is reported as "best".
+     * - apply: if true, the best configuration is applied to the blur options.
+     */
+    wf::ipc::method_callback run_benchmark = [=] (const nlohmann::json& data)
+    {
+        WFJSON_OPTIONAL_FIELD(data, "algorithms", array);
+        WFJSON_OPTIONAL_FIELD(data, "sizes", array);
+        WFJSON_OPTIONAL_FIELD(data, "degrade", array);
+        WFJSON_OPTIONAL_FIELD(data, "iterations", array);
+        WFJSON_OPTIONAL_FIELD(data, "repeat", number_unsigned);
+        WFJSON_OPTIONAL_FIELD(data, "target-radius", number_unsigned);
+        WFJSON_OPTIONAL_FIELD(data, "apply", boolean);
+
+        const std::vector<std::string> all_algorithms = {"box", "gaussian", "kawase", "bokeh"};
+        auto algorithms = all_algorithms;
+        if (data.contains("algorithms"))
+        {
+            algorithms.clear();
+            for (auto& name : data["algorithms"])
+            {
+                if (!name.is_string() ||
+                    (std::find(all_algorithms.begin(), all_algorithms.end(), name) == all_algorithms.end()))
+                {
+                    return wf::ipc::json_error("unknown blur algorithm " + name.dump());
+                }
+
+                algorithms.push_back(name);
+            }
+        }
+
+        std::set<std::pair<int, int>> sizes;
+        if (data.contains("sizes"))
+        {
+            for (auto& size : data["sizes"])
+            {
+                if (!size.is_array() || (size.size() != 2) || !size[0].is_number_unsigned() ||
+                    !size[1].is_number_unsigned() || ((int)size[0] <= 0) || ((int)size[1] <= 0))
+                {
+                    return wf::ipc::json_error("sizes must be a list of [width, height] pairs");
+                }
+
+                sizes.insert({size[0], size[1]});
+            }
+        } else
+        {
+            for (auto& wo : wf::get_core().output_layout->get_outputs())
+            {
+                sizes.insert({wo->handle->width, wo->handle->height});
+            }
+        }
+
+        if (sizes.empty())
+        {
+            sizes.insert({1920, 1080});
+        }
+
+        const auto degrades   = get_int_list(data, "degrade", {1, 2, 3});
+        const auto iterations = get_int_list(data, "iterations", {1, 2, 3, 4});
+        const int repeat = data.contains("repeat") ? std::max(1, (int)data["repeat"]) : 5;
+
+        OpenGL::render_begin();
+        const bool timer_queries = supports_timer_queries();
+        OpenGL::render_end();
+
+        std::vector<benchmark_result_t> results;
+        for (auto& name : algorithms)
+        {
+            for (int degrade : degrades)
+            {
+                for (int iteration_count : iterations)
+                {
+                    option_override_t overrides;
+                    overrides.set("blur/" + name + "_degrade", std::to_string(degrade));
+                    overrides.set("blur/" + name + "_iterations", std::to_string(iteration_count));
+                    auto algorithm = create_blur_from_name(name);
+                    for (auto& [width, height] : sizes)
+                    {
+                        benchmark_result_t result;
+                        result.algorithm  = name;
+                        result.degrade    = degrade;
+                        result.iterations = iteration_count;
+                        result.radius     = algorithm->calculate_blur_radius();
+                        result.width   = width;
+                        result.height  = height;
+                        result.time_us = measure(*algorithm, width, height, repeat, timer_queries);
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["timer-queries"] = timer_queries;
+        response["results"] = nlohmann::json::array();
+        for (auto& result : results)
+        {
+            response["results"].push_back(result_to_json(result));
+        }
+
+        if (!data.contains("target-radius"))
+        {
+            return response;
+        }
+
+        const int target_radius = data["target-radius"];
+        const auto largest = *std::max_element(sizes.begin(), sizes.end(), [] (auto& a, auto& b)
+        {
+            return 1ll * a.first * a.second < 1ll * b.first * b.second;
+        });
+
+        const benchmark_result_t *best = nullptr;
+        for (auto& result : results)
+        {
+            if ((result.width != largest.first) || (result.height != largest.second) ||
+                (result.radius < target_radius) || (result.time_us < 0))
+            {
+                continue;
+            }
+
+            if (!best || (result.time_us < best->time_us))
+            {
+                best = &result;
+            }
+        }
+
+        if (!best)
+        {
+            response["best"] = nullptr;
+            return response;
+        }
+
+        response["best"] = result_to_json(*best);
+        if (data.contains("apply") && data["apply"])
+        {
+            auto set_option = [] (const std::string& name, const std::string& value)
+            {
+                if (auto opt = wf::get_core().config.get_option(name))
+                {
+                    opt->set_value_str(value);
+                }
+            };
+
+            set_option("blur/" + best->algorithm + "_degrade", std::to_string(best->degrade));
+            set_option("blur/" + best->algorithm + "_iterations", std::to_string(best->iterations));
+            set_option("blur/method", best->algorithm);
+            LOGI("blur: applied the benchmarked configuration ", best->algorithm, " degrade=",
+                best->degrade, " iterations=", best->iterations);
+        }
+
+        return response;
+    };
+
+  public:
+    blur_benchmark_t()
+    {
+        method_repository->register_method("blur/benchmark", run_benchmark);
+    }
+
+    ~blur_benchmark_t()
+    {
+        method_repository->unregister_method("blur/benchmark");
+    }
+};
+}
+}
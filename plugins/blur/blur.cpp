@@ -10,8 +10,10 @@
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/bindings-repository.hpp>
+#include <wayfire/render-manager.hpp>
 
 #include "blur.hpp"
+#include "blur-benchmark.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/debug.hpp"
 #include "wayfire/geometry.hpp"
@@ -41,13 +43,85 @@ namespace wf
 {
 namespace scene
 {
+static bool is_same_render_target(const wf::render_target_t& a, const wf::render_target_t& b)
+{
+    return (a.fb == b.fb) && (a.geometry == b.geometry) && (a.scale == b.scale) &&
+           (a.wl_transform == b.wl_transform) && (a.subbuffer.has_value() == b.subbuffer.has_value()) &&
+           (!a.subbuffer || (*a.subbuffer == *b.subbuffer));
+}
+
+/**
+ * A group of blurred nodes in the same render pass which share a single blur pass.
+ *
+ * Nodes can share their blur if none of them paints over the region another member samples its background
+ * from, and neither do the nodes between them in the stacking order. In that case, by the time the lowest
+ * member is rendered, the background of all members is complete, so the lowest member blurs the union of
+ * their regions once and the other members only sample from the result.
+ */
+struct blur_band_t
+{
+    const std::vector<render_instruction_t> *instructions = nullptr;
+    wf::render_target_t target;
+    // The instructions up to this index have been checked for overlap with the sampled region.
+    size_t checked_instructions = 0;
+    int members = 0;
+    // The region where the members read their background from, in the coordinate system of the target.
+    wf::region_t sampled_region;
+    // The region which needs to be blurred for all members.
+    wf::region_t blur_region;
+    blurred_backdrop_t backdrop;
+    bool prepared = false;
+
+    ~blur_band_t()
+    {
+        OpenGL::render_begin();
+        backdrop.fb.release();
+        OpenGL::render_end();
+    }
+
+    /**
+     * Check whether a node which paints @repaint can be added to the band as its lowest member.
+     */
+    bool can_join(const std::vector<render_instruction_t>& instructions, const wf::render_target_t& target,
+        const wf::region_t& repaint)
+    {
+        if (prepared || (this->instructions != &instructions) || !is_same_render_target(this->target, target) ||
+            (instructions.size() < checked_instructions) || !(repaint & sampled_region).empty())
+        {
+            return false;
+        }
+
+        for (size_t i = checked_instructions; i < instructions.size(); i++)
+        {
+            if (!is_same_render_target(instructions[i].target, target) ||
+                !(instructions[i].damage & sampled_region).empty())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+/**
+ * Tracks the band which the next blurred node in a render pass may join.
+ */
+struct blur_band_tracker_t
+{
+    std::weak_ptr<blur_band_t> open_band;
+};
+
 class blur_node_t : public transformer_base_node_t
 {
   public:
     blur_algorithm_provider provider;
-    blur_node_t(blur_algorithm_provider provider) : transformer_base_node_t(false)
+    std::shared_ptr<blur_band_tracker_t> bands;
+    blur_node_t(blur_algorithm_provider provider, std::shared_ptr<blur_band_tracker_t> bands) :
+        transformer_base_node_t(false)
     {
         this->provider = provider;
+        this->bands    = bands;
     }
 
     ~blur_node_t()
@@ -103,8 +177,204 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
 {
     blur_node_t::saved_pixels_t *saved_pixels = nullptr;
 
+    // The blurred backdrop is cached and reused as long as the pixels below the node do not change, for
+    // example when only the contents of a translucent terminal are updated. Damage which is pushed by the
+    // children of the node (content damage) does not invalidate the cache, any other damage on the output
+    // (backdrop damage) does. Only the main render pass of the output uses the cache.
+    wf::option_wrapper_t<bool> cache_backdrop{"blur/cache_backdrop"};
+    blurred_backdrop_t backdrop;
+    // The region where the cached backdrop is valid, in the coordinate system of the render target.
+    wf::region_t backdrop_valid;
+    // The region which will be valid after the current frame, if the backdrop is prepared again.
+    std::optional<wf::region_t> next_backdrop_valid;
+    // Backdrop damage since the last frame, in the coordinate system of the scenegraph root.
+    wf::region_t backdrop_damage;
+    // The setup the backdrop was prepared with. If any of these changes, the cache is invalid.
+    wf::geometry_t backdrop_target = {0, 0, 0, 0};
+    wf::geometry_t backdrop_bbox   = {0, 0, 0, 0};
+    wl_output_transform backdrop_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+    wf_blur_base *backdrop_algorithm = nullptr;
+    bool use_backdrop = false;
+    bool forwarding_content_damage = false;
+
+    // When only some parts of the cached backdrop are stale, it is updated tile by tile: only the stale
+    // tiles (and the blur radius around them) are repainted and blurred again.
+    static constexpr int BACKDROP_TILE_SIZE = 64;
+    std::optional<wf::region_t> stale_tiles;
+    // The region around the stale tiles which is blurred again.
+    wf::region_t stale_blur_region;
+
+    static int64_t region_area(const wf::region_t& region)
+    {
+        int64_t area = 0;
+        for (const auto& box : region)
+        {
+            area += int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+        }
+
+        return area;
+    }
+
+    /**
+     * Find the tiles of the cached backdrop which need to be blurred again.
+     * @return The stale tiles, or nothing if it is cheaper to blur the whole damaged region again.
+     */
+    std::optional<wf::region_t> find_stale_tiles(const wf::render_target_t& target, const wf::region_t& stale,
+        const wf::region_t& needed, wf::geometry_t bbox)
+    {
+        if (backdrop.fb.tex == (GLuint)-1)
+        {
+            return {};
+        }
+
+        const auto snap_down = [] (int x, int origin)
+        {
+            return origin + (int)std::floor(1.0 * (x - origin) / BACKDROP_TILE_SIZE) * BACKDROP_TILE_SIZE;
+        };
+
+        const auto snap_up = [] (int x, int origin)
+        {
+            return origin + (int)std::ceil(1.0 * (x - origin) / BACKDROP_TILE_SIZE) * BACKDROP_TILE_SIZE;
+        };
+
+        wf::region_t tiles;
+        for (const auto& box : stale)
+        {
+            const int x1 = snap_down(box.x1, target.geometry.x);
+            const int y1 = snap_down(box.y1, target.geometry.y);
+            const int x2 = snap_up(box.x2, target.geometry.x);
+            const int y2 = snap_up(box.y2, target.geometry.y);
+            tiles |= wf::geometry_t{x1, y1, x2 - x1, y2 - y1};
+        }
+
+        tiles &= bbox;
+        tiles &= target.geometry;
+        for (const auto& box : tiles)
+        {
+            auto fb_box = target.framebuffer_box_from_geometry_box(wlr_box_from_pixman_box(box));
+            if (wf::geometry_intersection(fb_box, backdrop.geometry) != fb_box)
+            {
+                return {};
+            }
+        }
+
+        if (2 * region_area(tiles) > region_area(needed))
+        {
+            return {};
+        }
+
+        return tiles;
+    }
+
+    // While the node or its render target moves, the background is blurred with fewer iterations. Once the
+    // motion stops, the node is repainted at full quality.
+    static constexpr int MOTION_SETTLE_MS = 100;
+    wf::option_wrapper_t<int> motion_iterations{"blur/motion_iterations"};
+    std::optional<wf::geometry_t> last_bbox;
+    wf::geometry_t last_target = {0, 0, 0, 0};
+    bool in_motion = false;
+    wf::wl_timer<false> restore_quality;
+
+    void update_motion(const wf::render_target_t& target, wf::geometry_t bbox)
+    {
+        in_motion = (motion_iterations > 0) && last_bbox &&
+            ((bbox != *last_bbox) || (target.geometry != last_target));
+        last_bbox   = bbox;
+        last_target = target.geometry;
+    }
+
+    // The band this node shares its blur with in the current render pass, see blur_band_t.
+    std::shared_ptr<blur_band_t> band;
+
+    std::shared_ptr<blur_band_t> find_band(const std::vector<render_instruction_t>& instructions,
+        const wf::render_target_t& target, const wf::region_t& repaint)
+    {
+        auto open_band = self->bands->open_band.lock();
+        if (open_band && open_band->can_join(instructions, target, repaint))
+        {
+            return open_band;
+        }
+
+        open_band = std::make_shared<blur_band_t>();
+        open_band->instructions = &instructions;
+        open_band->target = target;
+        self->bands->open_band = open_band;
+        return open_band;
+    }
+
+    wf::signal::connection_t<output_scene_damage_signal> on_output_damage = [=] (output_scene_damage_signal *ev)
+    {
+        if (!forwarding_content_damage)
+        {
+            backdrop_damage |= *ev->region;
+        }
+    };
+
+    bool can_cache_backdrop(const wf::render_target_t& target)
+    {
+        if (!cache_backdrop || !_shown_on || target.subbuffer)
+        {
+            return false;
+        }
+
+        auto layout = _shown_on->get_layout_geometry();
+        return (target.geometry.width == layout.width) && (target.geometry.height == layout.height) &&
+               (target.scale == _shown_on->handle->scale);
+    }
+
+    /**
+     * Remove the parts of the cached backdrop which were affected by backdrop damage since the last frame.
+     */
+    void update_backdrop_validity(const wf::render_target_t& target, wf::geometry_t bbox, int padding)
+    {
+        if ((target.geometry != backdrop_target) || (bbox != backdrop_bbox) ||
+            (target.wl_transform != backdrop_transform) || (self->provider().get() != backdrop_algorithm))
+        {
+            backdrop_valid.clear();
+        } else if (!backdrop_damage.empty())
+        {
+            // Translate from root to target coordinates. Every blurred pixel depends on the pixels within
+            // the blur radius around it.
+            auto changed = backdrop_damage +
+                (wf::origin(target.geometry) - wf::origin(_shown_on->get_layout_geometry()));
+            changed.expand_edges(padding);
+            backdrop_valid ^= changed;
+        }
+
+        backdrop_damage.clear();
+    }
+
+    std::function<OpenGL::gpu_memory_owner_t()> describe_memory_owner = [=] ()
+    {
+        return wf::scene::gpu_memory_owner_of(self.get(), "blur");
+    };
+
   public:
-    using transformer_render_instance_t::transformer_render_instance_t;
+    blur_render_instance_t(blur_node_t *self, damage_callback push_damage, wf::output_t *shown_on) :
+        transformer_render_instance_t(self, push_damage, shown_on)
+    {
+        // All damage of the children goes through _push_damage, so we can tell it apart from the rest of
+        // the output damage.
+        _push_damage = [=] (const wf::region_t& region)
+        {
+            forwarding_content_damage = true;
+            push_damage(region);
+            forwarding_content_damage = false;
+        };
+
+        if (shown_on)
+        {
+            shown_on->connect(&on_output_damage);
+        }
+    }
+
+    ~blur_render_instance_t()
+    {
+        OpenGL::render_begin();
+        backdrop.fb.release();
+        OpenGL::render_end();
+    }
+
     bool is_fully_opaque(wf::region_t damage)
     {
         if (self->get_children().size() == 1)
@@ -164,6 +434,42 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
             return;
         }
 
+        use_backdrop = false;
+        next_backdrop_valid.reset();
+        stale_tiles.reset();
+        band.reset();
+        update_motion(target, bbox);
+        // A background blurred at reduced quality must not end up in the cache.
+        if (can_cache_backdrop(target) && !in_motion)
+        {
+            update_backdrop_validity(target, bbox, padding);
+            auto needed = calculate_translucent_damage(target, padded_region & target.geometry);
+            auto stale  = needed ^ backdrop_valid;
+            if (stale.empty())
+            {
+                // The cached backdrop can be used, so the nodes below do not need to be repainted.
+                use_backdrop = true;
+                instructions.push_back(render_instruction_t{
+                            .instance = this,
+                            .target   = target,
+                            .damage   = damage & bbox,
+                        });
+                return;
+            }
+
+            stale_tiles = find_stale_tiles(target, stale, needed, bbox);
+            if (stale_tiles)
+            {
+                // Only the stale tiles need a fresh background, the rest comes from the cache.
+                padded_region = *stale_tiles;
+            } else
+            {
+                // The pixels below are repainted with padding, so the blurred backdrop will be valid in
+                // the whole damaged region.
+                next_backdrop_valid = needed;
+            }
+        }
+
         padded_region.expand_edges(padding);
         padded_region &= bbox;
 
@@ -174,6 +480,10 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
 
         // Actual region which will be repainted by this render instance.
         wf::region_t we_repaint = padded_region;
+        if (stale_tiles)
+        {
+            we_repaint |= damage & bbox;
+        }
 
         this->saved_pixels   = self->acquire_saved_pixel_buffer();
         saved_pixels->region =
@@ -183,6 +493,7 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         // Nodes below should re-render the padded areas so that we can sample from them
         damage |= padded_region;
 
+        OpenGL::gpu_memory_scope_t memory_scope{describe_memory_owner};
         OpenGL::render_begin();
         saved_pixels->pixels.allocate(target.viewport_width, target.viewport_height);
         saved_pixels->pixels.bind();
@@ -199,24 +510,128 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         }
 
         OpenGL::render_end();
+
+        if (stale_tiles)
+        {
+            instructions.push_back(render_instruction_t{
+                        .instance = this,
+                        .target   = target,
+                        .damage   = we_repaint,
+                    });
+            stale_blur_region = padded_region;
+            return;
+        }
+
+        band = find_band(instructions, target, we_repaint);
         instructions.push_back(render_instruction_t{
                     .instance = this,
                     .target   = target,
                     .damage   = we_repaint,
                 });
+
+        band->members++;
+        band->checked_instructions = instructions.size();
+        band->sampled_region |= we_repaint;
+        band->blur_region    |= calculate_translucent_damage(target, we_repaint);
+    }
+
+    /**
+     * Blur the background of the node, together with the other members of its band if it has any.
+     * @return The blurred background, if it was saved in the band.
+     */
+    const blurred_backdrop_t *prepare_background(const wf::render_target_t& target, const wf::region_t& damage)
+    {
+        // Attribute the buffers of the blur algorithm to the view.
+        OpenGL::gpu_memory_scope_t memory_scope{describe_memory_owner};
+        if (in_motion)
+        {
+            self->provider()->set_iteration_limit(motion_iterations);
+            restore_quality.set_timeout(MOTION_SETTLE_MS, [=] ()
+            {
+                _push_damage(self->get_bounding_box());
+            });
+        }
+
+        const blurred_backdrop_t *result = nullptr;
+        if (!band || (band->members <= 1))
+        {
+            self->provider()->prepare_blur(target, calculate_translucent_damage(target, damage));
+        } else
+        {
+            // Instructions are executed back-to-front, so the first member which is rendered is the lowest.
+            if (!band->prepared)
+            {
+                self->provider()->prepare_blur(target, band->blur_region);
+                self->provider()->save_backdrop(band->backdrop);
+                band->prepared = true;
+            }
+
+            result = &band->backdrop;
+        }
+
+        self->provider()->set_iteration_limit(0);
+        return result;
     }
 
     void render(const wf::render_target_t& target, const wf::region_t& damage) override
     {
         auto tex = get_texture(target.scale);
         auto bounding_box = self->get_bounding_box();
-        if (!damage.empty())
+        if (use_backdrop)
         {
-            auto translucent_damage = calculate_translucent_damage(target, damage);
-            self->provider()->prepare_blur(target, translucent_damage);
-            self->provider()->render(tex, bounding_box, damage, target, target);
+            use_backdrop = false;
+            if (!damage.empty())
+            {
+                self->provider()->render(backdrop, tex, bounding_box, damage, target, target);
+            }
+
+            return;
+        }
+
+        if (stale_tiles)
+        {
+            if (!damage.empty())
+            {
+                auto blur_region = calculate_translucent_damage(target, stale_blur_region);
+                self->provider()->prepare_blur(target, blur_region);
+                self->provider()->update_backdrop(backdrop, target, *stale_tiles);
+                backdrop_valid |= calculate_translucent_damage(target, *stale_tiles);
+                self->provider()->render(backdrop, tex, bounding_box, damage, target, target);
+            }
+
+            stale_tiles.reset();
+        } else if (!damage.empty())
+        {
+            auto shared = prepare_background(target, damage);
+            if (shared)
+            {
+                self->provider()->render(*shared, tex, bounding_box, damage, target, target);
+            } else
+            {
+                self->provider()->render(tex, bounding_box, damage, target, target);
+            }
+
+            if (next_backdrop_valid)
+            {
+                if (shared)
+                {
+                    copy_backdrop(*shared, backdrop);
+                } else
+                {
+                    self->provider()->save_backdrop(backdrop);
+                }
+
+                backdrop_valid     = std::move(*next_backdrop_valid);
+                backdrop_target    = target.geometry;
+                backdrop_bbox      = bounding_box;
+                backdrop_transform = target.wl_transform;
+                backdrop_algorithm = self->provider().get();
+            }
         }
 
+        next_backdrop_valid.reset();
+        band.reset();
+
         OpenGL::render_begin(target);
         // Setup framebuffer I/O. target_fb contains the frame
         // rendered with expanded damage and artifacts on the edges.
@@ -296,6 +711,8 @@ class wayfire_blur : public wf::plugin_interface_t
     wf::option_wrapper_t<wf::buttonbinding_t> toggle_button{"blur/toggle"};
     wf::config::option_base_t::updated_callback_t blur_method_changed;
     std::unique_ptr<wf_blur_base> blur_algorithm;
+    std::unique_ptr<wf::blur::blur_benchmark_t> benchmark;
+    std::shared_ptr<wf::scene::blur_band_tracker_t> bands = std::make_shared<wf::scene::blur_band_tracker_t>();
 
     void add_transformer(wayfire_view view)
     {
@@ -310,7 +727,7 @@ class wayfire_blur : public wf::plugin_interface_t
             return blur_algorithm.get();
         };
 
-        auto node = std::make_shared<wf::scene::blur_node_t>(provider);
+        auto node = std::make_shared<wf::scene::blur_node_t>(provider, bands);
         tmanager->add_transformer(node, wf::TRANSFORMER_BLUR);
     }
 
@@ -362,6 +779,7 @@ class wayfire_blur : public wf::plugin_interface_t
             return true;
         };
 
+        benchmark = std::make_unique<wf::blur::blur_benchmark_t>();
         wf::get_core().bindings->add_button(toggle_button, &button_toggle);
         provider = [=] () { return this->blur_algorithm.get(); };
         wf::get_core().connect(&on_view_mapped);
@@ -379,6 +797,7 @@ class wayfire_blur : public wf::plugin_interface_t
     {
         remove_transformers();
         wf::get_core().bindings->rem_binding(&button_toggle);
+        benchmark.reset();
 
         /* Call blur algorithm destructor */
         blur_algorithm = nullptr;
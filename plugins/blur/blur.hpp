@@ -88,6 +88,22 @@
  * `````````````````````````````````````````````````````````````````
  */
 
+/**
+ * A copy of a blurred background, which can be reused in later frames as long as the pixels below the
+ * blurred area do not change. See wf_blur_base::save_backdrop().
+ */
+struct blurred_backdrop_t
+{
+    wf::framebuffer_t fb;
+    /* The blurred box, in framebuffer coordinates of the render target it was prepared from */
+    wf::geometry_t geometry = {0, 0, 0, 0};
+};
+
+/**
+ * Copy the blurred background @from to @to.
+ */
+void copy_backdrop(const blurred_backdrop_t& from, blurred_backdrop_t& to);
+
 class wf_blur_base
 {
   protected:
@@ -109,8 +125,23 @@ class wf_blur_base
     wf::option_wrapper_t<double> saturation_opt;
     wf::option_wrapper_t<double> offset_opt;
     wf::option_wrapper_t<int> degrade_opt, iterations_opt;
+    wf::option_wrapper_t<std::string> intermediate_format_opt{"blur/intermediate_format"};
     wf::config::option_base_t::updated_callback_t options_changed;
 
+    /* the internal format of fb[0] and fb[1]. Buffers in a reduced format are not
+     * shared with the framebuffer pool, which only holds RGBA8 buffers */
+    GLenum fb_format[2] = {GL_RGBA8, GL_RGBA8};
+    bool reduced_format_failed = false;
+
+    /* see set_iteration_limit() */
+    int iteration_limit = 0;
+    /* the number of iterations the algorithm should run */
+    int get_iterations();
+
+    /* (re)allocate fb[0] or fb[1] with the format chosen by the intermediate_format option */
+    void allocate_intermediate(wf::framebuffer_t& buffer, int width, int height);
+    void release_intermediate(int index);
+
     /* renders the in texture to the out framebuffer.
      * assumes a properly bound and initialized GL program */
     void render_iteration(wf::region_t blur_region,
@@ -127,12 +158,26 @@ class wf_blur_base
      * returns the index of the fb where the result is stored (0 or 1) */
     virtual int blur_fb0(const wf::region_t& blur_region, int width, int height) = 0;
 
+    /* blend src_tex with the blurred background bg_tex, which contains the
+     * framebuffer box bg_box of background_source_fb */
+    void render_with_background(GLuint bg_tex, wf::geometry_t bg_box,
+        wf::texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
+        const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb);
+
   public:
     wf_blur_base(std::string name);
     virtual ~wf_blur_base();
 
     virtual int calculate_blur_radius();
 
+    /**
+     * Limit the number of iterations of the following @prepare_blur calls, for example to keep the frame
+     * rate stable while views are moving. The blur radius used for damage padding is not affected.
+     *
+     * @param limit The maximal number of iterations, or 0 to remove the limit.
+     */
+    void set_iteration_limit(int limit);
+
     /**
      * Calculate the blurred background region.
      *
@@ -152,6 +197,29 @@ class wf_blur_base
      */
     void render(wf::texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
         const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb);
+
+    /**
+     * Copy the background prepared by the last @prepare_blur call to @backdrop.
+     */
+    void save_backdrop(blurred_backdrop_t& backdrop);
+
+    /**
+     * Copy the part @region of the background prepared by the last @prepare_blur call into @backdrop. The
+     * region has to be within the area covered by @backdrop.
+     *
+     * @param target_fb The render target used to prepare the background blur.
+     * @param region The region to copy, in logical coordinates.
+     */
+    void update_backdrop(blurred_backdrop_t& backdrop, const wf::render_target_t& target_fb,
+        const wf::region_t& region);
+
+    /**
+     * Same as @render, but use a background saved with @save_backdrop instead of the one from the last
+     * @prepare_blur call.
+     */
+    void render(const blurred_backdrop_t& backdrop, wf::texture_t src_tex, wlr_box src_box,
+        const wf::region_t& damage, const wf::render_target_t& background_source_fb,
+        const wf::render_target_t& target_fb);
 };
 
 std::unique_ptr<wf_blur_base> create_box_blur();
@@ -1,4 +1,10 @@
 #include "blur.hpp"
+#include <config.h>
+#include <wayfire/util/log.hpp>
+
+#ifdef USE_GLES32
+    #include <GLES3/gl32.h>
+#endif
 
 static const char *gaussian_vertex_shader =
     R"(
@@ -67,8 +73,238 @@ void main()
     gl_FragColor = bp;
 })";
 
+#ifdef USE_GLES32
+/* The compute shader version of the two passes above: each work group loads a row (or column) of texels,
+ * including the neighbours within the blur radius, into shared memory once, so the five bilinear taps of
+ * every pixel are served from the tile instead of the texture. */
+static constexpr int COMPUTE_GROUP_SIZE = 128;
+static constexpr int COMPUTE_MAX_RADIUS = 32;
+
+static const char *gaussian_compute_shader =
+    R"(
+#version 310 es
+precision highp float;
+
+#define GROUP_SIZE 128
+#define MAX_RADIUS 32
+#define TILE_SIZE (GROUP_SIZE + 2 * MAX_RADIUS)
+
+layout(local_size_x = GROUP_SIZE, local_size_y = 1) in;
+
+uniform highp sampler2D bg_texture;
+layout(rgba8, binding = 0) writeonly uniform highp image2D out_image;
+
+// (1, 0) for the horizontal pass, (0, 1) for the vertical one
+uniform ivec2 direction;
+// The box to blur, in texels
+uniform ivec4 box;
+uniform float offset;
+
+shared vec4 tile[TILE_SIZE];
+
+vec4 sample_tile(float pos)
+{
+    float base = floor(pos);
+    int i = int(base);
+    return mix(tile[i], tile[i + 1], pos - base);
+}
+
+void main()
+{
+    ivec2 size = textureSize(bg_texture, 0);
+    ivec2 across = ivec2(1, 1) - direction;
+    int box_start = dot(box.xy, direction);
+    int box_end   = box_start + dot(box.zw, direction);
+    int along = box_start + int(gl_WorkGroupID.x) * GROUP_SIZE;
+    ivec2 line = (box.xy + int(gl_WorkGroupID.y) * across) * across;
+
+    for (int i = int(gl_LocalInvocationID.x); i < TILE_SIZE; i += GROUP_SIZE)
+    {
+        ivec2 coord = clamp(line + (along - MAX_RADIUS + i) * direction, ivec2(0), size - 1);
+        tile[i] = texelFetch(bg_texture, coord, 0);
+    }
+
+    barrier();
+
+    int pos = along + int(gl_LocalInvocationID.x);
+    if (pos >= box_end)
+    {
+        return;
+    }
+
+    float c  = float(int(gl_LocalInvocationID.x) + MAX_RADIUS);
+    vec4 bp  = tile[int(c)] * 0.204164;
+    bp += sample_tile(c + 1.5 * offset) * 0.304005;
+    bp += sample_tile(c - 1.5 * offset) * 0.304005;
+    bp += sample_tile(c + 3.5 * offset) * 0.093913;
+    bp += sample_tile(c - 3.5 * offset) * 0.093913;
+    imageStore(out_image, line + pos * direction, bp);
+})";
+
+static bool supports_compute_shaders()
+{
+    GLint major = 0, minor = 0;
+    GL_CALL(glGetIntegerv(GL_MAJOR_VERSION, &major));
+    GL_CALL(glGetIntegerv(GL_MINOR_VERSION, &minor));
+    return (major > 3) || ((major == 3) && (minor >= 1));
+}
+
+#endif
+
 class wf_gaussian_blur : public wf_blur_base
 {
+    wf::option_wrapper_t<bool> compute_shaders{"blur/compute_shaders"};
+
+#ifdef USE_GLES32
+    OpenGL::program_t compute_program;
+    GLint direction_location = -1;
+    GLint box_location       = -1;
+    bool compute_supported = false;
+
+    /* Image units need textures with immutable storage, so the compute passes render into their own
+     * textures. The framebuffer is used to copy the result back to fb[0]. */
+    GLuint compute_tex[2] = {0, 0};
+    GLuint compute_fb     = 0;
+    int compute_width     = 0;
+    int compute_height    = 0;
+
+    void create_compute_program()
+    {
+        if (!supports_compute_shaders())
+        {
+            return;
+        }
+
+        GLuint shader = OpenGL::compile_shader(gaussian_compute_shader, GL_COMPUTE_SHADER);
+        if (shader == (GLuint)-1)
+        {
+            return;
+        }
+
+        GLuint id = GL_CALL(glCreateProgram());
+        GL_CALL(glAttachShader(id, shader));
+        GL_CALL(glLinkProgram(id));
+        GL_CALL(glDeleteShader(shader));
+
+        GLint status = GL_FALSE;
+        GL_CALL(glGetProgramiv(id, GL_LINK_STATUS, &status));
+        if (status == GL_FALSE)
+        {
+            LOGE("Failed to link the gaussian blur compute shader, falling back to fragment shaders.");
+            GL_CALL(glDeleteProgram(id));
+            return;
+        }
+
+        compute_program.set_simple(id);
+        direction_location = GL_CALL(glGetUniformLocation(id, "direction"));
+        box_location       = GL_CALL(glGetUniformLocation(id, "box"));
+        compute_supported  = true;
+    }
+
+    void free_compute_textures()
+    {
+        if (compute_fb)
+        {
+            GL_CALL(glDeleteFramebuffers(1, &compute_fb));
+            GL_CALL(glDeleteTextures(2, compute_tex));
+        }
+
+        compute_fb     = 0;
+        compute_tex[0] = compute_tex[1] = 0;
+        compute_width  = compute_height = 0;
+    }
+
+    void allocate_compute_textures(int width, int height)
+    {
+        if ((width == compute_width) && (height == compute_height))
+        {
+            return;
+        }
+
+        free_compute_textures();
+        GL_CALL(glGenTextures(2, compute_tex));
+        for (auto tex : compute_tex)
+        {
+            GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+            GL_CALL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height));
+            GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+            GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        }
+
+        GL_CALL(glGenFramebuffers(1, &compute_fb));
+        compute_width  = width;
+        compute_height = height;
+    }
+
+    void dispatch(GLuint in_tex, GLuint out_tex, bool vertical, const wf::region_t& blur_region)
+    {
+        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, in_tex));
+        GL_CALL(glBindImageTexture(0, out_tex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8));
+        GL_CALL(glUniform2i(direction_location, !vertical, vertical));
+        for (auto& b : blur_region)
+        {
+            auto box = wlr_box_from_pixman_box(b);
+            box = wf::clamp(box, {0, 0, compute_width, compute_height});
+            if ((box.width <= 0) || (box.height <= 0))
+            {
+                continue;
+            }
+
+            GL_CALL(glUniform4i(box_location, box.x, box.y, box.width, box.height));
+            const int length = vertical ? box.height : box.width;
+            const int lines  = vertical ? box.width : box.height;
+            GL_CALL(glDispatchCompute((length + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, lines, 1));
+        }
+
+        /* The next pass samples the result */
+        GL_CALL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT));
+    }
+
+    bool can_use_compute()
+    {
+        /* The five taps must stay within the shared memory tile */
+        return compute_supported && compute_shaders &&
+               (3.5 * (double)offset_opt + 1 <= COMPUTE_MAX_RADIUS);
+    }
+
+    int blur_fb0_compute(const wf::region_t& blur_region, int width, int height)
+    {
+        int iterations = get_iterations();
+
+        OpenGL::render_begin();
+        allocate_compute_textures(width, height);
+        compute_program.use(wf::TEXTURE_TYPE_RGBA);
+        compute_program.uniform1i("bg_texture", 0);
+        compute_program.uniform1f("offset", offset_opt);
+
+        GLuint source = fb[0].tex;
+        for (int i = 0; i < iterations; i++)
+        {
+            dispatch(source, compute_tex[0], false, blur_region);
+            dispatch(compute_tex[0], compute_tex[1], true, blur_region);
+            source = compute_tex[1];
+        }
+
+        if (iterations > 0)
+        {
+            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, compute_fb));
+            GL_CALL(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                GL_TEXTURE_2D, compute_tex[1], 0));
+            GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb[0].fb));
+            GL_CALL(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        }
+
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        compute_program.deactivate();
+        OpenGL::render_end();
+
+        return 0;
+    }
+
+#endif
+
   public:
     wf_gaussian_blur() : wf_blur_base("gaussian")
     {
@@ -77,9 +313,23 @@ class wf_gaussian_blur : public wf_blur_base
             gaussian_vertex_shader, gaussian_fragment_shader_horz));
         program[1].set_simple(OpenGL::compile_program(
             gaussian_vertex_shader, gaussian_fragment_shader_vert));
+#ifdef USE_GLES32
+        create_compute_program();
+#endif
+        OpenGL::render_end();
+    }
+
+#ifdef USE_GLES32
+    ~wf_gaussian_blur()
+    {
+        OpenGL::render_begin();
+        free_compute_textures();
+        compute_program.free_resources();
         OpenGL::render_end();
     }
 
+#endif
+
     void upload_data(int i, int width, int height)
     {
         float offset = offset_opt;
@@ -104,7 +354,14 @@ class wf_gaussian_blur : public wf_blur_base
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
     {
-        int i, iterations = iterations_opt;
+#ifdef USE_GLES32
+        if (can_use_compute())
+        {
+            return blur_fb0_compute(blur_region, width, height);
+        }
+
+#endif
+        int i, iterations = get_iterations();
 
         OpenGL::render_begin();
         GL_CALL(glDisable(GL_BLEND));
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "wayfire/geometry.hpp"
+#include <cmath>
+#include <list>
 #include <string>
+#include <unordered_map>
 #include <wayfire/plugins/common/simple-texture.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
 #include <wayfire/config/types.hpp>
 #include <cairo.h>
 #include <pango/pango.h>
@@ -38,10 +42,97 @@ static void cairo_surface_upload_to_texture(
     GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED));
     GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
         buffer.width, buffer.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, src));
+    OpenGL::track_gpu_memory(buffer.tex, uint64_t(buffer.width) * buffer.height * 4, "cairo-texture");
 }
 
 namespace wf
 {
+/**
+ * Pango layouts of the texts rendered by plugins, shared via wf::shared_data.
+ *
+ * Creating a layout looks up the font and shapes the text, which is most of the cost of rendering a short
+ * label such as a window title. The cache keeps the layouts of the most recently rendered texts, keyed by
+ * text, font and absolute size (which includes the output scale), so re-rendering a text which did not
+ * change reuses its layout. All layouts share one pango context of the default font map.
+ */
+class pango_layout_cache_t
+{
+  public:
+    pango_layout_cache_t()
+    {
+        context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+    }
+
+    ~pango_layout_cache_t()
+    {
+        for (auto& entry : lru)
+        {
+            g_object_unref(entry.layout);
+        }
+
+        g_object_unref(context);
+    }
+
+    pango_layout_cache_t(const pango_layout_cache_t&) = delete;
+    pango_layout_cache_t& operator =(const pango_layout_cache_t&) = delete;
+
+    /**
+     * Get the layout of a text.
+     *
+     * @param cr   The cairo context the layout will be shown on.
+     * @param text The text of the layout.
+     * @param font The pango font description string, for example "sans-serif bold".
+     * @param size The absolute font size, in pixels.
+     *
+     * @return A new reference to the layout, release it with g_object_unref().
+     */
+    PangoLayout *get_layout(cairo_t *cr, const std::string& text, const std::string& font, double size)
+    {
+        // Does nothing unless the font options or transformation of cr differ from the previous call.
+        pango_cairo_update_context(cr, context);
+
+        const int pango_size = (int)std::round(size * PANGO_SCALE);
+        std::string key = font + '\n' + std::to_string(pango_size) + '\n' + text;
+        auto it = index.find(key);
+        if (it != index.end())
+        {
+            lru.splice(lru.begin(), lru, it->second);
+            return PANGO_LAYOUT(g_object_ref(lru.front().layout));
+        }
+
+        auto font_desc = pango_font_description_from_string(font.c_str());
+        pango_font_description_set_absolute_size(font_desc, pango_size);
+        auto layout = pango_layout_new(context);
+        pango_layout_set_font_description(layout, font_desc);
+        pango_layout_set_text(layout, text.c_str(), text.size());
+        pango_font_description_free(font_desc);
+
+        lru.push_front({key, layout});
+        index[std::move(key)] = lru.begin();
+        if (lru.size() > MAX_LAYOUTS)
+        {
+            index.erase(lru.back().key);
+            g_object_unref(lru.back().layout);
+            lru.pop_back();
+        }
+
+        return PANGO_LAYOUT(g_object_ref(layout));
+    }
+
+  private:
+    static constexpr size_t MAX_LAYOUTS = 256;
+
+    struct entry_t
+    {
+        std::string key;
+        PangoLayout *layout;
+    };
+
+    PangoContext *context;
+    std::list<entry_t> lru;
+    std::unordered_map<std::string, std::list<entry_t>::iterator> index;
+};
+
 /**
  * Simple wrapper around rendering text with Cairo. This object can be
  * kept around to avoid reallocation of the cairo surface and OpenGL
@@ -107,16 +198,10 @@ struct cairo_text_t
             cairo_create_surface();
         }
 
-        PangoFontDescription *font_desc;
-        PangoLayout *layout;
         PangoRectangle extents;
         /* TODO: font properties could be made parameters! */
-        font_desc = pango_font_description_from_string("sans-serif bold");
-        pango_font_description_set_absolute_size(font_desc,
-            par.font_size * par.output_scale * PANGO_SCALE);
-        layout = pango_cairo_create_layout(cr);
-        pango_layout_set_font_description(layout, font_desc);
-        pango_layout_set_text(layout, text.c_str(), text.size());
+        PangoLayout *layout = layouts->get_layout(cr, text, "sans-serif bold",
+            par.font_size * par.output_scale);
         pango_layout_get_extents(layout, NULL, &extents);
 
         double xpad = par.bg_rect ? 10.0 * par.output_scale : 0.0;
@@ -197,7 +282,6 @@ struct cairo_text_t
             par.text_color.b, par.text_color.a);
 
         pango_cairo_show_layout(cr, layout);
-        pango_font_description_free(font_desc);
         g_object_unref(layout);
 
         cairo_surface_flush(surface);
@@ -306,6 +390,8 @@ struct cairo_text_t
     cairo_surface_t *surface = nullptr;
     /* current width and height of the above surface */
     wf::dimensions_t surface_size = {400, 100};
+    /* keeps the shared layouts alive as long as the text is */
+    wf::shared_data::ref_ptr_t<pango_layout_cache_t> layouts;
 
 
     void cairo_free()
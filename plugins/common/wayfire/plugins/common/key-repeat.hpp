@@ -1,19 +1,124 @@
 #pragma once
 
+#include <wayfire/core.hpp>
 #include <wayfire/option-wrapper.hpp>
 #include <wayfire/util.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
 
 namespace wf
 {
-struct key_repeat_t
+/**
+ * Repeats the key (or button) pressed last, for all plugins and plugin instances.
+ *
+ * As with the key repeat of clients, only one key repeats at a time: starting the repeat of a new key stops
+ * the repeat of the previous one. The handler is decided when the key is pressed, so a repeat only runs the
+ * handler, and a single timer is armed with the repeat delay and then with the repeat period.
+ *
+ * Intended for use via wf::shared_data::ref_ptr_t, see key_repeat_t.
+ */
+class key_repeat_scheduler_t
 {
+  public:
+    using callback_t = std::function<bool (uint32_t)>;
+
+    key_repeat_scheduler_t()
+    {
+        source = wl_event_loop_add_timer(wf::get_core().ev_loop, handle_timeout, this);
+    }
+
+    ~key_repeat_scheduler_t()
+    {
+        wl_event_source_remove(source);
+    }
+
+    key_repeat_scheduler_t(const key_repeat_scheduler_t&) = delete;
+    key_repeat_scheduler_t& operator =(const key_repeat_scheduler_t&) = delete;
+
+    /**
+     * Start repeating @key on behalf of @owner. The handler is called with @key after the repeat delay, and
+     * then at the repeat rate, until it returns false or the repeat is stopped.
+     */
+    void start(const void *owner, uint32_t key, callback_t handler)
+    {
+        const int repeat_rate = rate;
+        if ((repeat_rate <= 0) || (repeat_rate > 1000))
+        {
+            stop_active();
+            return;
+        }
+
+        this->owner   = owner;
+        this->key     = key;
+        this->handler = std::make_shared<callback_t>(std::move(handler));
+        this->period_ms = 1000 / repeat_rate;
+        wl_event_source_timer_update(source, std::max(1, (int)delay));
+    }
+
+    /** Stop the repeat, if the key which is currently repeating was started by @owner. */
+    void stop(const void *owner)
+    {
+        if (this->owner == owner)
+        {
+            stop_active();
+        }
+    }
+
+    bool is_repeating(const void *owner) const
+    {
+        return owner && (this->owner == owner);
+    }
+
+  private:
     wf::option_wrapper_t<int> delay{"input/kb_repeat_delay"};
     wf::option_wrapper_t<int> rate{"input/kb_repeat_rate"};
 
-    wf::wl_timer<false> timer_delay;
-    wf::wl_timer<true> timer_rate;
+    wl_event_source *source;
+    const void *owner = nullptr;
+    uint32_t key = 0;
+    int period_ms = 0;
+    std::shared_ptr<callback_t> handler;
 
-    using callback_t = std::function<bool (uint32_t)>;
+    void stop_active()
+    {
+        wl_event_source_timer_update(source, 0);
+        owner = nullptr;
+        handler.reset();
+    }
+
+    static int handle_timeout(void *data)
+    {
+        auto self = (key_repeat_scheduler_t*)data;
+        if (!self->handler)
+        {
+            return 0;
+        }
+
+        // Re-arm first: the handler may stop the repeat or start a new one.
+        wl_event_source_timer_update(self->source, self->period_ms);
+
+        // Keep the handler alive while it runs, even if the repeat is restarted from within it.
+        auto handler = self->handler;
+        auto owner   = self->owner;
+        if (!(*handler)(self->key) && (self->owner == owner) && (self->handler == handler))
+        {
+            self->stop_active();
+        }
+
+        return 0;
+    }
+};
+
+/**
+ * A handle for repeating a key from a plugin. The repeat itself is driven by the shared
+ * key_repeat_scheduler_t, so starting a repeat here stops the repeat started by any other handle.
+ */
+struct key_repeat_t
+{
+    using callback_t = key_repeat_scheduler_t::callback_t;
 
     key_repeat_t()
     {}
@@ -22,23 +127,31 @@ struct key_repeat_t
         set_callback(key, handler);
     }
 
-    void set_callback(uint32_t key, callback_t handler)
+    ~key_repeat_t()
     {
         disconnect();
-        timer_delay.set_timeout(delay, [=] ()
-        {
-            timer_rate.set_timeout(1000 / rate, [=] ()
-            {
-                // handle can determine if key should be repeated
-                return handler(key);
-            });
-        });
+    }
+
+    key_repeat_t(const key_repeat_t&) = delete;
+    key_repeat_t& operator =(const key_repeat_t&) = delete;
+
+    void set_callback(uint32_t key, callback_t handler)
+    {
+        scheduler->start(this, key, std::move(handler));
     }
 
     void disconnect()
     {
-        timer_delay.disconnect();
-        timer_rate.disconnect();
+        scheduler->stop(this);
+    }
+
+    /** @return Whether the key of this handle is still repeating (or waiting for the repeat delay). */
+    bool is_connected()
+    {
+        return scheduler->is_repeating(this);
     }
+
+  private:
+    wf::shared_data::ref_ptr_t<key_repeat_scheduler_t> scheduler;
 };
 }
@@ -13,6 +13,7 @@
 #include "wayfire/signal-definitions.hpp"
 #include "wayfire/view-helpers.hpp"
 #include <memory>
+#include <optional>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/plugins/common/util.hpp>
 #include <wayfire/plugins/wobbly/wobbly-signal.hpp>
@@ -579,15 +580,22 @@ class core_drag_t : public signal::provider_t
         for (auto& v : all_views)
         {
             move_wobbly(v.view, to.x, to.y);
-            if (!view_held_in_place)
-            {
-                v.view->get_transformed_node()->begin_transform_update();
-                v.transformer->grab_position = to;
-                v.view->get_transformed_node()->end_transform_update();
-            }
         }
 
         update_current_output(to);
+        if (!view_held_in_place)
+        {
+            // Moving the views damages them on all outputs they are shown on, so it is done at most once per
+            // frame of the current output, not on each motion event.
+            pending_grab_position = to;
+            if (current_output)
+            {
+                current_output->render->schedule_redraw();
+            } else
+            {
+                apply_pending_grab_position();
+            }
+        }
 
         drag_motion_signal data;
         data.current_position = to;
@@ -608,6 +616,8 @@ class core_drag_t : public signal::provider_t
             return;
         }
 
+        apply_pending_grab_position();
+
         // Store data for the drag done signal
         drag_done_signal data;
         data.grab_position = all_views.front().transformer->grab_position;
@@ -701,6 +711,26 @@ class core_drag_t : public signal::provider_t
 
     std::shared_ptr<dragged_view_node_t> render_node;
 
+    // The grab position from the last motion event, not yet applied to the transformers of the views.
+    std::optional<wf::point_t> pending_grab_position;
+
+    void apply_pending_grab_position()
+    {
+        if (!pending_grab_position)
+        {
+            return;
+        }
+
+        for (auto& v : all_views)
+        {
+            v.view->get_transformed_node()->begin_transform_update();
+            v.transformer->grab_position = *pending_grab_position;
+            v.view->get_transformed_node()->end_transform_update();
+        }
+
+        pending_grab_position.reset();
+    }
+
     void update_current_output(wf::point_t grab)
     {
         wf::pointf_t origin = {1.0 * grab.x, 1.0 * grab.y};
@@ -733,6 +763,7 @@ class core_drag_t : public signal::provider_t
 
     wf::effect_hook_t on_pre_frame = [=] ()
     {
+        apply_pending_grab_position();
         for (auto& v : this->all_views)
         {
             if (v.transformer->scale_factor.running())
@@ -80,6 +80,13 @@ class preview_indication_t : public std::enable_shared_from_this<preview_indicat
      */
     void set_target_geometry(wf::geometry_t target, float alpha, bool close = false)
     {
+        // Restarting the animation with the same target would only slow it down.
+        if (animation.running() && (target == get_target_geometry()) && (alpha == animation.alpha.end) &&
+            (close == should_close))
+        {
+            return;
+        }
+
         animation.x.restart_with_end(target.x);
         animation.y.restart_with_end(target.y);
         animation.width.restart_with_end(target.width);
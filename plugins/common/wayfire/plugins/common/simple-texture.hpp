@@ -23,6 +23,7 @@ struct simple_texture_t
         OpenGL::render_begin();
         GL_CALL(glDeleteTextures(1, &tex));
         OpenGL::render_end();
+        OpenGL::untrack_gpu_memory(tex);
         this->tex = -1;
     }
 
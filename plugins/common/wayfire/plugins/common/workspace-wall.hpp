@@ -3,7 +3,9 @@
 
 #include "wayfire/workspace-set.hpp" // IWYU pragma: keep
 #include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 #include <memory>
+#include <optional>
 #include "wayfire/core.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/opengl.hpp"
@@ -15,6 +17,9 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/workspace-stream.hpp"
 #include "wayfire/output.hpp"
+#include "wayfire/object.hpp"
+#include "wayfire/option-wrapper.hpp"
+#include "wayfire/util.hpp"
 
 namespace wf
 {
@@ -31,6 +36,218 @@ struct wall_frame_event_t
     {}
 };
 
+/**
+ * The auxiliary buffers in which a workspace wall renders the workspaces of an output, together with the
+ * damage accumulated since they were last repainted.
+ *
+ * Normally, each workspace wall has its own buffers, which are fully repainted when the wall starts. If
+ * core/persistent_workspace_textures is enabled, the buffers are kept on the output instead, and while no
+ * wall is running their damage is tracked, so that the next wall only repaints what changed meanwhile.
+ */
+class workspace_buffers_t : public wf::custom_data_t
+{
+  public:
+    struct buffer_t
+    {
+        wf::render_target_t target;
+        // Damage accumulated for the buffer, in workspace-local coordinates
+        wf::region_t damage;
+        // The parts of the buffer which have been painted at the current scale, in workspace-local coordinates
+        wf::region_t painted;
+        // Current rendering scale for the workspace
+        float scale = 1.0;
+    };
+
+    std::vector<std::vector<std::shared_ptr<workspace_stream_node_t>>> streams;
+    std::vector<std::vector<buffer_t>> workspaces;
+
+    // The number of workspace walls using the persistent buffers of the output.
+    int32_t use_count = 0;
+    // Whether a workspace wall is currently rendering the buffers.
+    bool in_use = false;
+
+    workspace_buffers_t(wf::output_t *output) : output(output)
+    {
+        wf::get_core().scene()->connect(&on_root_update);
+    }
+
+    ~workspace_buffers_t()
+    {
+        release();
+    }
+
+    static bool persistent_enabled()
+    {
+        static wf::option_wrapper_t<bool> persistent{"core/persistent_workspace_textures"};
+        return persistent;
+    }
+
+    /**
+     * Make sure there is a buffer for each workspace, matching the current size and scale of the output.
+     * Newly allocated buffers are fully damaged.
+     */
+    void ensure_buffers()
+    {
+        reclaim_buffers.mark_used();
+        const auto grid     = output->wset()->get_workspace_grid_size();
+        const auto geometry = output->get_relative_geometry();
+        if ((grid == grid_size) && (geometry == buffer_geometry) && (output->handle->scale == buffer_scale))
+        {
+            return;
+        }
+
+        release();
+        grid_size = grid;
+        buffer_geometry = geometry;
+        buffer_scale    = output->handle->scale;
+
+        streams.resize(grid.width);
+        workspaces.resize(grid.width);
+        OpenGL::gpu_memory_scope_t memory_scope{[] () { return OpenGL::gpu_memory_owner_t{"workspace-wall"}; }};
+        OpenGL::render_begin();
+        for (int i = 0; i < grid.width; i++)
+        {
+            for (int j = 0; j < grid.height; j++)
+            {
+                streams[i].push_back(std::make_shared<workspace_stream_node_t>(output, wf::point_t{i, j}));
+
+                buffer_t buffer;
+                buffer.target.geometry     = streams[i][j]->get_bounding_box();
+                buffer.target.scale        = output->handle->scale;
+                buffer.target.wl_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+                buffer.target.transform    = get_output_matrix_from_transform(buffer.target.wl_transform);
+
+                auto size = buffer.target.framebuffer_box_from_geometry_box(buffer.target.geometry);
+                buffer.target.allocate(size.width, size.height);
+                buffer.damage |= buffer.target.geometry;
+                workspaces[i].push_back(buffer);
+            }
+        }
+
+        OpenGL::render_end();
+        regenerate_tracking_instances();
+    }
+
+    /**
+     * Whether to track the damage of the workspaces. This is done while no workspace wall renders them, as
+     * the wall tracks the damage itself.
+     */
+    void set_tracking(bool tracking)
+    {
+        this->tracking = tracking;
+        regenerate_tracking_instances();
+    }
+
+    /**
+     * Repaint the damaged parts of the buffer of a workspace at full scale, so that a workspace wall which
+     * shows it later does not have to. Damage tracking has to be enabled.
+     */
+    void prerender(wf::point_t ws)
+    {
+        if (!tracking || (ws.x < 0) || (ws.x >= (int)workspaces.size()) || (ws.y < 0) ||
+            (ws.y >= (int)workspaces[ws.x].size()))
+        {
+            return;
+        }
+
+        auto& buffer = workspaces[ws.x][ws.y];
+        if (buffer.scale != 1.0)
+        {
+            buffer.scale = 1.0;
+            buffer.target.subbuffer.reset();
+            buffer.painted.clear();
+            buffer.damage |= streams[ws.x][ws.y]->get_bounding_box();
+        }
+
+        if (buffer.damage.empty())
+        {
+            return;
+        }
+
+        scene::render_pass_params_t params;
+        params.instances = &tracking_instances[ws.x][ws.y];
+        params.damage    = buffer.damage;
+        params.reference_output = output;
+        params.target = buffer.target;
+        scene::run_render_pass(params, scene::RPASS_EMIT_SIGNALS);
+        buffer.painted |= buffer.damage;
+        buffer.damage.clear();
+    }
+
+  private:
+    wf::output_t *output;
+    wf::dimensions_t grid_size = {0, 0};
+    wf::geometry_t buffer_geometry = {0, 0, 0, 0};
+    double buffer_scale = 0.0;
+
+    bool tracking = false;
+    std::vector<std::vector<std::vector<scene::render_instance_uptr>>> tracking_instances;
+
+    // Releases the buffers kept while no wall has used them for a while. They are repainted fully when the
+    // next wall starts.
+    OpenGL::reclaimable_buffer_t reclaim_buffers{[this] ()
+        {
+            if (in_use)
+            {
+                reclaim_buffers.mark_used();
+            } else
+            {
+                release();
+            }
+        }
+    };
+
+    void release()
+    {
+        tracking_instances.clear();
+        OpenGL::render_begin();
+        for (auto& column : workspaces)
+        {
+            for (auto& buffer : column)
+            {
+                buffer.target.release();
+            }
+        }
+
+        OpenGL::render_end();
+        streams.clear();
+        workspaces.clear();
+        grid_size = {0, 0};
+    }
+
+    void regenerate_tracking_instances()
+    {
+        tracking_instances.clear();
+        if (!tracking)
+        {
+            return;
+        }
+
+        tracking_instances.resize(streams.size());
+        for (int i = 0; i < (int)streams.size(); i++)
+        {
+            tracking_instances[i].resize(streams[i].size());
+            for (int j = 0; j < (int)streams[i].size(); j++)
+            {
+                streams[i][j]->gen_render_instances(tracking_instances[i][j], [=] (const wf::region_t& damage)
+                {
+                    workspaces[i][j].damage |= damage;
+                }, output);
+            }
+        }
+    }
+
+    wf::signal::connection_t<scene::root_node_update_signal> on_root_update =
+        [=] (scene::root_node_update_signal *ev)
+    {
+        if (tracking && !(ev->flags & scene::update_flag::MASKED) &&
+            (ev->flags & (scene::update_flag::CHILDREN_LIST | scene::update_flag::ENABLED)))
+        {
+            regenerate_tracking_instances();
+        }
+    };
+};
+
 /**
  * A helper class to render workspaces arranged in a grid.
  */
@@ -43,11 +260,26 @@ class workspace_wall_t : public wf::signal::provider_t
     workspace_wall_t(wf::output_t *_output) : output(_output)
     {
         this->viewport = get_wall_rectangle();
+        if (workspace_buffers_t::persistent_enabled())
+        {
+            if (!output->has_data<workspace_buffers_t>())
+            {
+                output->store_data(std::make_unique<workspace_buffers_t>(output));
+            }
+
+            output->get_data<workspace_buffers_t>()->use_count++;
+            uses_persistent_buffers = true;
+        }
     }
 
     ~workspace_wall_t()
     {
         stop_output_renderer(false);
+        discard_prerendered();
+        if (uses_persistent_buffers && (--output->get_data<workspace_buffers_t>()->use_count == 0))
+        {
+            output->erase_data<workspace_buffers_t>();
+        }
     }
 
     /**
@@ -71,6 +303,33 @@ class workspace_wall_t : public wf::signal::provider_t
         this->gap_size = size;
     }
 
+    /**
+     * Enable or disable level-of-detail rendering of the workspaces.
+     *
+     * By default, workspaces are rendered at the scale at which they were last repainted, unless repainting
+     * them at the scale at which they are shown is cheaper. With level-of-detail rendering, each workspace
+     * is always rendered at the power-of-two scale closest above the one it is shown at.
+     */
+    void set_level_of_detail(bool enabled)
+    {
+        this->level_of_detail = enabled;
+    }
+
+    /**
+     * Repaint the damaged workspaces other than the given one only every few frames, so that on large grids
+     * only the workspace the user interacts with is repainted at the full rate. The other workspaces are
+     * repainted in turns, and right away if they have to be rendered at a different scale.
+     *
+     * @param focus The workspace to repaint at the full rate, or std::nullopt to repaint all workspaces at the
+     *   full rate.
+     * @param interval The number of frames between repaints of the other workspaces.
+     */
+    void set_focus_workspace(std::optional<wf::point_t> focus, int interval)
+    {
+        this->focus_workspace = focus;
+        this->reduced_rate_interval = std::max(interval, 1);
+    }
+
     /**
      * Set which part of the workspace wall to render.
      *
@@ -110,6 +369,77 @@ class workspace_wall_t : public wf::signal::provider_t
         this->emit(&data);
     }
 
+    /**
+     * Render the given workspaces into the buffers of the wall ahead of time, when the event loop is idle,
+     * so that the first frames after start_output_renderer() do not have to render them from scratch.
+     * Until the wall is started, the damage of the workspaces is tracked.
+     *
+     * Without persistent workspace textures, the buffers are kept only until the wall is stopped or
+     * discard_prerendered() is called.
+     *
+     * @param workspaces The workspaces to render. Workspaces outside of the grid are ignored.
+     */
+    void prerender_workspaces(std::vector<wf::point_t> workspaces)
+    {
+        if (render_node)
+        {
+            return;
+        }
+
+        prerender_idle.run_once([=] ()
+        {
+            prerender_workspaces_now(workspaces);
+        });
+    }
+
+    /**
+     * Same as prerender_workspaces(), but render the workspaces right away, for ex. when the wall is about to
+     * start and the work should not be done in its first frame.
+     */
+    void prerender_workspaces_now(const std::vector<wf::point_t>& workspaces)
+    {
+        if (render_node)
+        {
+            return;
+        }
+
+        workspace_buffers_t *buffers;
+        if (uses_persistent_buffers)
+        {
+            buffers = output->get_data<workspace_buffers_t>().get();
+        } else
+        {
+            if (!prerendered_buffers)
+            {
+                prerendered_buffers = std::make_unique<workspace_buffers_t>(output);
+            }
+
+            buffers = prerendered_buffers.get();
+        }
+
+        if (buffers->in_use)
+        {
+            // Another wall is rendering the buffers at the moment.
+            return;
+        }
+
+        buffers->ensure_buffers();
+        buffers->set_tracking(true);
+        for (auto& ws : workspaces)
+        {
+            buffers->prerender(ws);
+        }
+    }
+
+    /**
+     * Cancel a pending prerender and free the prerendered buffers, if the wall is not going to be started.
+     */
+    void discard_prerendered()
+    {
+        prerender_idle.disconnect();
+        prerendered_buffers.reset();
+    }
+
     /**
      * Register a render hook and paint the whole output as a desktop wall
      * with the set parameters.
@@ -117,6 +447,7 @@ class workspace_wall_t : public wf::signal::provider_t
     void start_output_renderer()
     {
         wf::dassert(render_node == nullptr, "Starting workspace-wall twice?");
+        prerender_idle.disconnect();
         render_node = std::make_shared<workspace_wall_node_t>(this);
         scene::add_front(wf::get_core().scene(), render_node);
     }
@@ -182,6 +513,12 @@ class workspace_wall_t : public wf::signal::provider_t
      */
     void set_ws_dim(const wf::point_t& ws, float value)
     {
+        auto it = render_colors.find({ws.x, ws.y});
+        if ((it != render_colors.end()) && (it->second == value))
+        {
+            return;
+        }
+
         render_colors[{ws.x, ws.y}] = value;
         if (render_node)
         {
@@ -191,10 +528,19 @@ class workspace_wall_t : public wf::signal::provider_t
 
   protected:
     wf::output_t *output;
+    bool uses_persistent_buffers = false;
+
+    // Buffers rendered by prerender_workspaces() for the next start of the wall, if the buffers are not
+    // persistent.
+    std::unique_ptr<workspace_buffers_t> prerendered_buffers;
+    wf::wl_idle_call prerender_idle;
 
     wf::color_t background_color = {0, 0, 0, 0};
     int gap_size = 0;
+    bool level_of_detail = false;
     wf::geometry_t viewport = {0, 0, 0, 0};
+    std::optional<wf::point_t> focus_workspace;
+    int reduced_rate_interval = 1;
 
     std::map<std::pair<int, int>, float> render_colors;
 
@@ -239,6 +585,8 @@ class workspace_wall_t : public wf::signal::provider_t
         {
             std::shared_ptr<workspace_wall_node_t> self;
             per_workspace_map_t<std::vector<scene::render_instance_uptr>> instances;
+            // Counts the frames for the workspaces repainted at a reduced rate
+            uint64_t frame_counter = 0;
 
             scene::damage_callback push_damage;
             wf::signal::connection_t<scene::node_damage_signal> on_wall_damage =
@@ -266,14 +614,15 @@ class workspace_wall_t : public wf::signal::provider_t
                 this->push_damage = push_damage;
                 self->connect(&on_wall_damage);
 
-                for (int i = 0; i < (int)self->workspaces.size(); i++)
+                auto& streams = self->buffers->streams;
+                for (int i = 0; i < (int)streams.size(); i++)
                 {
-                    for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                    for (int j = 0; j < (int)streams[i].size(); j++)
                     {
                         auto push_damage_child = [=] (const wf::region_t& damage)
                         {
                             // Store the damage because we'll have to update the buffers
-                            self->aux_buffer_damage[i][j] |= damage;
+                            self->buffers->workspaces[i][j].damage |= damage;
 
                             wf::region_t our_damage;
                             for (auto& rect : damage)
@@ -289,7 +638,7 @@ class workspace_wall_t : public wf::signal::provider_t
                             push_damage(our_damage);
                         };
 
-                        self->workspaces[i][j]->gen_render_instances(instances[i][j],
+                        streams[i][j]->gen_render_instances(instances[i][j],
                             push_damage_child, self->wall->output);
                     }
                 }
@@ -318,11 +667,27 @@ class workspace_wall_t : public wf::signal::provider_t
                 //
                 // Nonetheless, we need to make sure to rescale when this makes sense, and to avoid visual
                 // artifacts.
-                auto bbox = self->workspaces[i][j]->get_bounding_box();
-                const float render_scale = std::max(
+                auto& buffer = self->buffers->workspaces[i][j];
+                auto bbox    = self->buffers->streams[i][j]->get_bounding_box();
+                float render_scale = std::max(
                     1.0 * bbox.width / self->wall->viewport.width,
                     1.0 * bbox.height / self->wall->viewport.height);
-                const float current_scale = self->aux_buffer_current_scale[i][j];
+                const float current_scale = buffer.scale;
+
+                if (self->wall->level_of_detail)
+                {
+                    // Render directly at the next power-of-two scale above the thumbnail size, so that the
+                    // buffer is minified at most 2x when shown, and is repainted only when the thumbnails
+                    // cross a level during the animation. The zoomed-in workspace ends up at full scale.
+                    render_scale = std::min(1.0f, std::exp2(std::ceil(std::log2(render_scale))));
+                    if (render_scale == current_scale)
+                    {
+                        return false;
+                    }
+
+                    set_workspace_buffer_scale(buffer, render_scale, bbox);
+                    return true;
+                }
 
                 // Avoid keeping a low resolution if we are going up in the scale (for example, expo exit
                 // animation) and we're close to the 1.0 scale. Otherwise, we risk popping artifacts as we
@@ -339,47 +704,67 @@ class workspace_wall_t : public wf::signal::provider_t
 
                 if ((repaint_cost_current_scale > repaint_rescale_cost) || rescale_magnification)
                 {
-                    self->aux_buffer_current_scale[i][j] = render_scale;
-                    self->aux_buffers[i][j].subbuffer    = wf::geometry_t{
-                        0, 0,
-                        int(std::ceil(render_scale * self->aux_buffers[i][j].viewport_width)),
-                        int(std::ceil(render_scale * self->aux_buffers[i][j].viewport_height)),
-                    };
-
-                    self->aux_buffer_damage[i][j] |= self->workspaces[i][j]->get_bounding_box();
+                    set_workspace_buffer_scale(buffer, render_scale, bbox);
                     return true;
                 }
 
                 return false;
             }
 
+            static void set_workspace_buffer_scale(workspace_buffers_t::buffer_t& buffer, float scale,
+                wf::geometry_t bbox)
+            {
+                buffer.scale = scale;
+                buffer.target.subbuffer = wf::geometry_t{
+                    0, 0,
+                    int(std::ceil(scale * buffer.target.viewport_width)),
+                    int(std::ceil(scale * buffer.target.viewport_height)),
+                };
+
+                buffer.damage |= bbox;
+            }
+
             void schedule_instructions(
                 std::vector<scene::render_instruction_t>& instructions,
                 const wf::render_target_t& target, wf::region_t& damage) override
             {
                 // Update workspaces in a render pass
-                for (int i = 0; i < (int)self->workspaces.size(); i++)
+                auto& workspaces = self->buffers->workspaces;
+                const auto& focus = self->wall->focus_workspace;
+                const int interval = self->wall->reduced_rate_interval;
+                ++frame_counter;
+                for (int i = 0; i < (int)workspaces.size(); i++)
                 {
-                    for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                    for (int j = 0; j < (int)workspaces[i].size(); j++)
                     {
                         const auto ws_bbox     = self->wall->get_workspace_rectangle({i, j});
                         const auto visible_box =
                             geometry_intersection(self->wall->viewport, ws_bbox) - wf::origin(ws_bbox);
-                        wf::region_t visible_damage = self->aux_buffer_damage[i][j] & visible_box;
+                        wf::region_t visible_damage = workspaces[i][j].damage & visible_box;
                         if (consider_rescale_workspace_buffer(i, j, visible_damage))
                         {
                             visible_damage |= visible_box;
+                            workspaces[i][j].painted.clear();
+                        } else if (focus && (wf::point_t{i, j} != *focus) &&
+                                   ((frame_counter + i + j * (int)workspaces.size()) % interval != 0) &&
+                                   (wf::region_t{visible_box} ^ workspaces[i][j].painted).empty())
+                        {
+                            // Keep the damage for the turn of this workspace, the workspaces are staggered
+                            // so that they are not all repainted in the same frame. Parts which were never
+                            // painted are not skipped, as they have no contents to show meanwhile.
+                            continue;
                         }
 
                         if (!visible_damage.empty())
                         {
                             scene::render_pass_params_t params;
                             params.instances = &instances[i][j];
-                            params.damage    = std::move(visible_damage);
+                            params.damage    = visible_damage;
                             params.reference_output = self->wall->output;
-                            params.target = self->aux_buffers[i][j];
+                            params.target = workspaces[i][j].target;
                             scene::run_render_pass(params, scene::RPASS_EMIT_SIGNALS);
-                            self->aux_buffer_damage[i][j] ^= visible_damage;
+                            workspaces[i][j].damage  ^= visible_damage;
+                            workspaces[i][j].painted |= visible_damage;
                         }
                     }
                 }
@@ -415,15 +800,16 @@ class workspace_wall_t : public wf::signal::provider_t
                 {
                     target.logic_scissor(wlr_box_from_pixman_box(box));
                     OpenGL::clear(self->wall->background_color);
-                    for (int i = 0; i < (int)self->workspaces.size(); i++)
+                    auto& workspaces = self->buffers->workspaces;
+                    for (int i = 0; i < (int)workspaces.size(); i++)
                     {
-                        for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                        for (int j = 0; j < (int)workspaces[i].size(); j++)
                         {
                             auto box = get_workspace_rect({i, j});
                             auto A   = self->wall->viewport;
                             auto B   = self->get_bounding_box();
                             gl_geometry render_geometry = scale_fbox(A, B, box);
-                            auto& buffer = self->aux_buffers[i][j];
+                            auto& buffer = workspaces[i][j].target;
 
                             float dim = self->wall->get_color_for_workspace({i, j});
                             const glm::vec4 color = glm::vec4(dim, dim, dim, 1.0);
@@ -457,11 +843,12 @@ class workspace_wall_t : public wf::signal::provider_t
 
             void compute_visibility(wf::output_t *output, wf::region_t& visible) override
             {
-                for (int i = 0; i < (int)self->workspaces.size(); i++)
+                auto& streams = self->buffers->streams;
+                for (int i = 0; i < (int)streams.size(); i++)
                 {
-                    for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                    for (int j = 0; j < (int)streams[i].size(); j++)
                     {
-                        wf::region_t ws_region = self->workspaces[i][j]->get_bounding_box();
+                        wf::region_t ws_region = streams[i][j]->get_bounding_box();
                         for (auto& ch : this->instances[i][j])
                         {
                             ch->compute_visibility(output, ws_region);
@@ -474,47 +861,30 @@ class workspace_wall_t : public wf::signal::provider_t
       public:
         workspace_wall_node_t(workspace_wall_t *wall) : node_t(false)
         {
-            this->wall  = wall;
-            auto [w, h] = wall->output->wset()->get_workspace_grid_size();
-            workspaces.resize(w);
-            for (int i = 0; i < w; i++)
+            this->wall = wall;
+            if (wall->uses_persistent_buffers)
             {
-                for (int j = 0; j < h; j++)
-                {
-                    auto node = std::make_shared<workspace_stream_node_t>(
-                        wall->output, wf::point_t{i, j});
-                    workspaces[i].push_back(node);
-
-                    aux_buffers[i][j].geometry = workspaces[i][j]->get_bounding_box();
-                    aux_buffers[i][j].scale    = wall->output->handle->scale;
-                    aux_buffers[i][j].wl_transform = WL_OUTPUT_TRANSFORM_NORMAL;
-                    aux_buffers[i][j].transform    = get_output_matrix_from_transform(
-                        aux_buffers[i][j].wl_transform);
-
-                    auto size =
-                        aux_buffers[i][j].framebuffer_box_from_geometry_box(aux_buffers[i][j].geometry);
-                    OpenGL::render_begin();
-                    aux_buffers[i][j].allocate(size.width, size.height);
-                    OpenGL::render_end();
-
-                    aux_buffer_damage[i][j] |= aux_buffers[i][j].geometry;
-                    aux_buffer_current_scale[i][j] = 1.0;
-                }
+                buffers = wall->output->get_data<workspace_buffers_t>().get();
+            } else
+            {
+                own_buffers = wall->prerendered_buffers ? std::move(wall->prerendered_buffers) :
+                    std::make_unique<workspace_buffers_t>(wall->output);
+                buffers = own_buffers.get();
             }
+
+            buffers->ensure_buffers();
+            buffers->set_tracking(false);
+            buffers->in_use = true;
         }
 
         ~workspace_wall_node_t()
         {
-            OpenGL::render_begin();
-            for (auto& [_, buffers] : aux_buffers)
+            buffers->in_use = false;
+            if (!own_buffers)
             {
-                for (auto& [_, buffer] : buffers)
-                {
-                    buffer.release();
-                }
+                // Keep the persistent buffers up to date until the next wall.
+                buffers->set_tracking(true);
             }
-
-            OpenGL::render_end();
         }
 
         virtual void gen_render_instances(
@@ -542,14 +912,11 @@ class workspace_wall_t : public wf::signal::provider_t
 
       private:
         workspace_wall_t *wall;
-        std::vector<std::vector<std::shared_ptr<workspace_stream_node_t>>> workspaces;
 
-        // Buffers keeping the contents of almost-static workspaces
-        per_workspace_map_t<wf::render_target_t> aux_buffers;
-        // Damage accumulated for those buffers
-        per_workspace_map_t<wf::region_t> aux_buffer_damage;
-        // Current rendering scale for the workspace
-        per_workspace_map_t<float> aux_buffer_current_scale;
+        // Buffers keeping the contents of almost-static workspaces, either owned by the node or shared
+        // between walls, see workspace_buffers_t.
+        std::unique_ptr<workspace_buffers_t> own_buffers;
+        workspace_buffers_t *buffers;
     };
     std::shared_ptr<workspace_wall_node_t> render_node;
 };
@@ -0,0 +1,168 @@
+#include "cube-resources.hpp"
+#include <config.h>
+#include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/util/log.hpp>
+
+#ifdef USE_GLES32
+    #include <GLES3/gl32.h>
+#endif
+
+#include "shaders.tpp"
+#include "shaders-3-2.tpp"
+#include "cubemap-shaders.tpp"
+
+wf_cube_texture_t::~wf_cube_texture_t()
+{
+    if (tex != (GLuint)-1)
+    {
+        OpenGL::render_begin();
+        GL_CALL(glDeleteTextures(1, &tex));
+        OpenGL::render_end();
+    }
+}
+
+wf_cube_resources_t::~wf_cube_resources_t()
+{
+    OpenGL::render_begin();
+    cube_program.free_resources();
+    simple_program.free_resources();
+    cubemap_program.free_resources();
+    OpenGL::render_end();
+}
+
+void wf_cube_resources_t::load_programs()
+{
+    if (programs_loaded)
+    {
+        return;
+    }
+
+    programs_loaded = true;
+    OpenGL::render_begin();
+#ifdef USE_GLES32
+    std::string ext_string(reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS)));
+    tessellation_support = ext_string.find(std::string("GL_EXT_tessellation_shader")) !=
+        std::string::npos;
+#else
+    tessellation_support = false;
+#endif
+
+    simple_program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
+    cubemap_program.set_simple(OpenGL::compile_program(cubemap_vertex, cubemap_fragment));
+
+    if (!tessellation_support)
+    {
+        cube_program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
+    } else
+    {
+#ifdef USE_GLES32
+        auto id = GL_CALL(glCreateProgram());
+        GLuint vss, fss, tcs, tes, gss;
+
+        vss = OpenGL::compile_shader(cube_vertex_3_2, GL_VERTEX_SHADER);
+        fss = OpenGL::compile_shader(cube_fragment_3_2, GL_FRAGMENT_SHADER);
+        tcs = OpenGL::compile_shader(cube_tcs_3_2, GL_TESS_CONTROL_SHADER);
+        tes = OpenGL::compile_shader(cube_tes_3_2, GL_TESS_EVALUATION_SHADER);
+        gss = OpenGL::compile_shader(cube_geometry_3_2, GL_GEOMETRY_SHADER);
+
+        GL_CALL(glAttachShader(id, vss));
+        GL_CALL(glAttachShader(id, tcs));
+        GL_CALL(glAttachShader(id, tes));
+        GL_CALL(glAttachShader(id, gss));
+        GL_CALL(glAttachShader(id, fss));
+
+        GL_CALL(glLinkProgram(id));
+        GL_CALL(glUseProgram(id));
+
+        GL_CALL(glDeleteShader(vss));
+        GL_CALL(glDeleteShader(fss));
+        GL_CALL(glDeleteShader(tcs));
+        GL_CALL(glDeleteShader(tes));
+        GL_CALL(glDeleteShader(gss));
+        cube_program.set_simple(id);
+#endif
+    }
+
+    OpenGL::render_end();
+}
+
+std::shared_ptr<wf_cube_texture_t> wf_cube_resources_t::get_skydome_texture(const std::string& path)
+{
+    if (auto texture = skydome_textures[path].lock())
+    {
+        return texture;
+    }
+
+    auto texture = std::make_shared<wf_cube_texture_t>();
+    skydome_textures[path] = texture;
+
+    auto raw = texture.get();
+    raw->loading = true;
+    raw->pending_load = image_io::load_from_file_async(path,
+        [raw, path] (std::optional<image_io::decoded_image_t> image)
+    {
+        raw->loading = false;
+
+        OpenGL::render_begin();
+        GL_CALL(glGenTextures(1, &raw->tex));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, raw->tex));
+        if (image && image_io::upload(*image, GL_TEXTURE_2D))
+        {
+            GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+            GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+            GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+            GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        } else
+        {
+            LOGE("Failed to load skydome image from \"", path, "\".");
+            GL_CALL(glDeleteTextures(1, &raw->tex));
+            raw->tex = -1;
+        }
+
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        OpenGL::render_end();
+
+        // The texture may be used by the cube on any output
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            wo->render->damage_whole();
+        }
+    });
+
+    return texture;
+}
+
+std::shared_ptr<wf_cube_texture_t> wf_cube_resources_t::get_cubemap_texture(const std::string& path)
+{
+    if (auto texture = cubemap_textures[path].lock())
+    {
+        return texture;
+    }
+
+    auto texture = std::make_shared<wf_cube_texture_t>();
+    cubemap_textures[path] = texture;
+
+    OpenGL::render_begin();
+    GL_CALL(glGenTextures(1, &texture->tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, texture->tex));
+    if (image_io::load_from_file(path, GL_TEXTURE_CUBE_MAP))
+    {
+        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+    } else
+    {
+        LOGE("Failed to load cubemap background image from \"", path, "\".");
+        GL_CALL(glDeleteTextures(1, &texture->tex));
+        texture->tex = -1;
+    }
+
+    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
+    OpenGL::render_end();
+    return texture;
+}
@@ -0,0 +1,60 @@
+#ifndef WF_CUBE_RESOURCES_HPP
+#define WF_CUBE_RESOURCES_HPP
+
+#include <wayfire/opengl.hpp>
+#include <wayfire/img.hpp>
+#include <map>
+#include <memory>
+#include <string>
+
+/**
+ * A background texture loaded from an image file, shared by the backgrounds of
+ * all outputs which use the same image.
+ */
+struct wf_cube_texture_t
+{
+    /* -1 until the image is loaded, or if it could not be loaded */
+    GLuint tex = -1;
+    bool loading = false;
+    std::unique_ptr<image_io::async_load_t> pending_load;
+
+    ~wf_cube_texture_t();
+};
+
+/**
+ * The GPU resources of the cube plugin which are shared between all outputs,
+ * see wf::shared_data::ref_ptr_t. They stay resident while the plugin is
+ * loaded, so activating the cube does not compile or upload anything.
+ */
+class wf_cube_resources_t
+{
+  public:
+    /* The program for the cube faces, with tessellation if supported */
+    OpenGL::program_t cube_program;
+    bool tessellation_support = false;
+
+    /* The GLES 2.0 cube program, also used by the skydome */
+    OpenGL::program_t simple_program;
+    OpenGL::program_t cubemap_program;
+
+    /* Compile the programs if that has not been done yet */
+    void load_programs();
+
+    /* Get the texture of the given skydome image. On first use, the image is
+     * decoded asynchronously and the texture is loading until then. */
+    std::shared_ptr<wf_cube_texture_t> get_skydome_texture(const std::string& path);
+
+    /* Get the cube map texture of the given image, loading it on first use */
+    std::shared_ptr<wf_cube_texture_t> get_cubemap_texture(const std::string& path);
+
+    ~wf_cube_resources_t();
+
+  private:
+    bool programs_loaded = false;
+
+    /* The textures are freed once no background uses them anymore */
+    std::map<std::string, std::weak_ptr<wf_cube_texture_t>> skydome_textures;
+    std::map<std::string, std::weak_ptr<wf_cube_texture_t>> cubemap_textures;
+};
+
+#endif /* end of include guard: WF_CUBE_RESOURCES_HPP */
@@ -1,4 +1,6 @@
 #include <wayfire/per-output-plugin.hpp>
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <wayfire/plugin.hpp>
 #include <wayfire/opengl.hpp>
@@ -19,6 +21,8 @@
 #include "skydome.hpp"
 #include "cubemap.hpp"
 #include "cube-control-signal.hpp"
+#include "cube-resources.hpp"
+#include "wayfire/plugins/common/shared-core-data.hpp"
 #include "wayfire/region.hpp"
 #include "wayfire/scene-render.hpp"
 #include "wayfire/scene.hpp"
@@ -34,9 +38,6 @@
     #include <GLES3/gl32.h>
 #endif
 
-#include "shaders.tpp"
-#include "shaders-3-2.tpp"
-
 class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer_interaction_t
 {
     class cube_render_node_t : public wf::scene::node_t
@@ -110,15 +111,26 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
             void render(const wf::render_target_t& target,
                 const wf::region_t& region, const std::any& tag) override
             {
+                const float scale = self->cube->output->handle->scale * self->cube->get_face_scale();
                 for (int i = 0; i < (int)ws_instances.size(); i++)
                 {
+                    if (framebuffers[i].scale != scale)
+                    {
+                        /* The buffer is reallocated with the new size, so its contents are lost */
+                        ws_damage[i] |= self->workspaces[i]->get_bounding_box();
+                    }
+
                     framebuffers[i].geometry = self->workspaces[i]->get_bounding_box();
-                    framebuffers[i].scale    = self->cube->output->handle->scale;
+                    framebuffers[i].scale    = scale;
                     framebuffers[i].wl_transform = WL_OUTPUT_TRANSFORM_NORMAL;
                     framebuffers[i].transform    = get_output_matrix_from_transform(
                         framebuffers[i].wl_transform);
 
                     auto size = framebuffers[i].framebuffer_box_from_geometry_box(framebuffers[i].geometry);
+                    OpenGL::gpu_memory_scope_t memory_scope{[] ()
+                    {
+                        return OpenGL::gpu_memory_owner_t{"cube"};
+                    }};
                     OpenGL::render_begin();
                     framebuffers[i].allocate(size.width, size.height);
                     OpenGL::render_end();
@@ -197,12 +209,21 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
      * for the given FOV */
     float identity_z_offset;
 
-    OpenGL::program_t program;
+    /* The programs are shared by the cubes of all outputs */
+    wf::shared_data::ref_ptr_t<wf_cube_resources_t> resources;
+    OpenGL::program_t& program = resources->cube_program;
 
     wf_cube_animation_attribs animation;
     wf::option_wrapper_t<bool> use_light{"cube/light"};
     wf::option_wrapper_t<int> use_deform{"cube/deform"};
 
+    wf::option_wrapper_t<bool> dynamic_resolution{"cube/dynamic_resolution"};
+    wf::option_wrapper_t<double> dynamic_resolution_min_scale{"cube/dynamic_resolution_min_scale"};
+
+    /* The resolution of the faces relative to the output, see update_face_scale() */
+    double face_scale = 1.0;
+    float last_rotation = 0;
+
     std::string last_background_mode;
     std::unique_ptr<wf_cube_background_base> background;
 
@@ -234,8 +255,6 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
         }
     }
 
-    bool tessellation_support;
-
     int get_num_faces()
     {
         return output->wset()->get_workspace_grid_size().width;
@@ -265,9 +284,8 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
 
         output->connect(&on_cube_control);
 
-        OpenGL::render_begin();
-        load_program();
-        OpenGL::render_end();
+        resources->load_programs();
+        animation.projection = glm::perspective(45.0f, 1.f, 0.1f, 100.f);
     }
 
     void handle_pointer_button(const wlr_pointer_button_event& event) override
@@ -286,52 +304,6 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
         }
     }
 
-    void load_program()
-    {
-#ifdef USE_GLES32
-        std::string ext_string(reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS)));
-        tessellation_support = ext_string.find(std::string("GL_EXT_tessellation_shader")) !=
-            std::string::npos;
-#else
-        tessellation_support = false;
-#endif
-
-        if (!tessellation_support)
-        {
-            program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
-        } else
-        {
-#ifdef USE_GLES32
-            auto id = GL_CALL(glCreateProgram());
-            GLuint vss, fss, tcs, tes, gss;
-
-            vss = OpenGL::compile_shader(cube_vertex_3_2, GL_VERTEX_SHADER);
-            fss = OpenGL::compile_shader(cube_fragment_3_2, GL_FRAGMENT_SHADER);
-            tcs = OpenGL::compile_shader(cube_tcs_3_2, GL_TESS_CONTROL_SHADER);
-            tes = OpenGL::compile_shader(cube_tes_3_2, GL_TESS_EVALUATION_SHADER);
-            gss = OpenGL::compile_shader(cube_geometry_3_2, GL_GEOMETRY_SHADER);
-
-            GL_CALL(glAttachShader(id, vss));
-            GL_CALL(glAttachShader(id, tcs));
-            GL_CALL(glAttachShader(id, tes));
-            GL_CALL(glAttachShader(id, gss));
-            GL_CALL(glAttachShader(id, fss));
-
-            GL_CALL(glLinkProgram(id));
-            GL_CALL(glUseProgram(id));
-
-            GL_CALL(glDeleteShader(vss));
-            GL_CALL(glDeleteShader(fss));
-            GL_CALL(glDeleteShader(tcs));
-            GL_CALL(glDeleteShader(tes));
-            GL_CALL(glDeleteShader(gss));
-            program.set_simple(id);
-#endif
-        }
-
-        animation.projection = glm::perspective(45.0f, 1.f, 0.1f, 100.f);
-    }
-
     wf::signal::connection_t<cube_control_signal> on_cube_control = [=] (cube_control_signal *d)
     {
         rotate_and_zoom_cube(d->angle, d->zoom, d->ease, d->last_frame);
@@ -402,6 +374,9 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
         reload_background();
         animation.cube_animation.offset_z.set(identity_z_offset + Z_OFFSET_NEAR,
             identity_z_offset + Z_OFFSET_NEAR);
+
+        face_scale    = 1.0;
+        last_rotation = animation.cube_animation.rotation;
         return true;
     }
 
@@ -555,12 +530,86 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
     }
 
     glm::mat4 calculate_vp_matrix(const wf::render_target_t& dest)
+    {
+        return dest.transform * calculate_untransformed_vp_matrix();
+    }
+
+    glm::mat4 calculate_untransformed_vp_matrix()
     {
         float zoom_factor = animation.cube_animation.zoom;
         auto scale_matrix = glm::scale(glm::mat4(1.0),
             glm::vec3(1. / zoom_factor, 1. / zoom_factor, 1. / zoom_factor));
 
-        return dest.transform * animation.projection * animation.view * scale_matrix;
+        return animation.projection * animation.view * scale_matrix;
+    }
+
+    /* The largest size of a face on screen, relative to the output size */
+    double calculate_max_projected_face_size()
+    {
+        static const glm::vec4 corners[] = {
+            {-0.5, 0.5, 0, 1}, {0.5, 0.5, 0, 1}, {0.5, -0.5, 0, 1}, {-0.5, -0.5, 0, 1},
+        };
+
+        auto vp = calculate_untransformed_vp_matrix();
+        double max_size = 0.0;
+        for (int i = 0; i < get_num_faces(); i++)
+        {
+            auto mvp = vp * calculate_model_matrix(i);
+            glm::vec2 min{1e9, 1e9}, max{-1e9, -1e9};
+            bool visible = false;
+            for (auto& corner : corners)
+            {
+                auto projected = mvp * corner;
+                if (projected.w <= 0)
+                {
+                    // Behind the camera, the face is not used for the size.
+                    visible = false;
+                    break;
+                }
+
+                glm::vec2 ndc = glm::vec2(projected) / projected.w;
+                min     = glm::min(min, ndc);
+                max     = glm::max(max, ndc);
+                visible = true;
+            }
+
+            if (visible)
+            {
+                // NDC coordinates span [-1, 1] over the output.
+                auto extents = (max - min) * 0.5f;
+                max_size = std::max(max_size, (double)std::max(extents.x, extents.y));
+            }
+        }
+
+        return max_size;
+    }
+
+    /**
+     * With dynamic resolution, the faces are rendered at a lower resolution while the cube is moving. The
+     * resolution depends on how large the faces appear on screen and how fast the cube is rotating. Once the
+     * cube settles, the faces are rendered at the full resolution again.
+     */
+    void update_face_scale()
+    {
+        const float rotation = animation.cube_animation.rotation;
+        const double faces_per_frame = std::abs(rotation - last_rotation) / animation.side_angle;
+        last_rotation = rotation;
+
+        if (!dynamic_resolution || !animation.cube_animation.running())
+        {
+            face_scale = 1.0;
+            return;
+        }
+
+        double scale = calculate_max_projected_face_size() / (1.0 + 4.0 * faces_per_frame);
+        // Quantize the scale, so that the face buffers are not reallocated on every frame.
+        scale = std::ceil(scale * 8.0) / 8.0;
+        face_scale = std::clamp(scale, std::clamp((double)dynamic_resolution_min_scale, 0.05, 1.0), 1.0);
+    }
+
+    double get_face_scale() const
+    {
+        return face_scale;
     }
 
     /* Calculate the base model matrix for the i-th side of the cube */
@@ -602,7 +651,7 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
             auto model = calculate_model_matrix(i);
             program.uniformMatrix4f("model", model);
 
-            if (tessellation_support)
+            if (resources->tessellation_support)
             {
 #ifdef USE_GLES32
                 GL_CALL(glDrawElements(GL_PATCHES, 6, GL_UNSIGNED_INT, &indexData));
@@ -617,11 +666,6 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
 
     void render(const wf::render_target_t& dest, const std::vector<wf::render_target_t>& buffers)
     {
-        if (program.get_program_id(wf::TEXTURE_TYPE_RGBA) == 0)
-        {
-            load_program();
-        }
-
         OpenGL::render_begin(dest);
         GL_CALL(glClear(GL_DEPTH_BUFFER_BIT));
         OpenGL::render_end();
@@ -651,7 +695,7 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
         program.attrib_pointer("position", 2, 0, vertexData);
         program.attrib_pointer("uvPosition", 2, 0, coordData);
         program.uniformMatrix4f("VP", vp);
-        if (tessellation_support)
+        if (resources->tessellation_support)
         {
             program.uniform1i("deform", use_deform);
             program.uniform1i("light", use_light);
@@ -676,6 +720,7 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
     wf::effect_hook_t pre_hook = [=] ()
     {
         update_view_matrix();
+        update_face_scale();
         wf::scene::damage_node(render_node, render_node->get_bounding_box());
         if (animation.cube_animation.running())
         {
@@ -763,10 +808,6 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
         {
             deactivate();
         }
-
-        OpenGL::render_begin();
-        program.free_resources();
-        OpenGL::render_end();
     }
 };
 
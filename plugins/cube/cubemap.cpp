@@ -3,34 +3,25 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <config.h>
 #include <wayfire/core.hpp>
-#include <wayfire/img.hpp>
-
-#include "cubemap-shaders.tpp"
 
 wf_cube_background_cubemap::wf_cube_background_cubemap()
 {
-    create_program();
+    resources->load_programs();
+    OpenGL::render_begin();
+    GL_CALL(glGenBuffers(1, &vbo_cube_vertices));
+    GL_CALL(glGenBuffers(1, &ibo_cube_indices));
+    OpenGL::render_end();
     reload_texture();
 }
 
 wf_cube_background_cubemap::~wf_cube_background_cubemap()
 {
     OpenGL::render_begin();
-    program.free_resources();
-    GL_CALL(glDeleteTextures(1, &tex));
     GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
     GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
     OpenGL::render_end();
 }
 
-void wf_cube_background_cubemap::create_program()
-{
-    OpenGL::render_begin();
-    program.set_simple(
-        OpenGL::compile_program(cubemap_vertex, cubemap_fragment));
-    OpenGL::render_end();
-}
-
 void wf_cube_background_cubemap::reload_texture()
 {
     if (!last_background_image.compare(background_image))
@@ -39,43 +30,7 @@ void wf_cube_background_cubemap::reload_texture()
     }
 
     last_background_image = background_image;
-
-    OpenGL::render_begin();
-    if (tex == (uint32_t)-1)
-    {
-        GL_CALL(glGenTextures(1, &tex));
-        GL_CALL(glGenBuffers(1, &vbo_cube_vertices));
-        GL_CALL(glGenBuffers(1, &ibo_cube_indices));
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
-    if (!image_io::load_from_file(last_background_image, GL_TEXTURE_CUBE_MAP))
-    {
-        LOGE("Failed to load cubemap background image from \"%s\".",
-            last_background_image.c_str());
-
-        GL_CALL(glDeleteTextures(1, &tex));
-        GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
-        GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
-        tex = -1;
-    }
-
-    if (tex != (uint32_t)-1)
-    {
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
-            GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER,
-            GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S,
-            GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T,
-            GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,
-            GL_CLAMP_TO_EDGE));
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
-    OpenGL::render_end();
+    texture = resources->get_cubemap_texture(last_background_image);
 }
 
 void wf_cube_background_cubemap::render_frame(const wf::render_target_t& fb,
@@ -84,7 +39,7 @@ void wf_cube_background_cubemap::render_frame(const wf::render_target_t& fb,
     reload_texture();
 
     OpenGL::render_begin(fb);
-    if (tex == (uint32_t)-1)
+    if (texture->tex == (uint32_t)-1)
     {
         GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
@@ -96,7 +51,7 @@ void wf_cube_background_cubemap::render_frame(const wf::render_target_t& fb,
     program.use(wf::TEXTURE_TYPE_RGBA);
     GL_CALL(glDepthMask(GL_FALSE));
 
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, texture->tex));
 
     GLfloat cube_vertices[] = {
         -1.0, 1.0, 1.0,
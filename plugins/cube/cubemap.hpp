@@ -2,6 +2,8 @@
 #define WF_CUBE_CUBEMAP_HPP
 
 #include "cube-background.hpp"
+#include "cube-resources.hpp"
+#include "wayfire/plugins/common/shared-core-data.hpp"
 
 class wf_cube_background_cubemap : public wf_cube_background_base
 {
@@ -14,10 +16,10 @@ class wf_cube_background_cubemap : public wf_cube_background_base
 
   private:
     void reload_texture();
-    void create_program();
 
-    OpenGL::program_t program;
-    GLuint tex = -1;
+    wf::shared_data::ref_ptr_t<wf_cube_resources_t> resources;
+    OpenGL::program_t& program = resources->cubemap_program;
+    std::shared_ptr<wf_cube_texture_t> texture;
     GLuint vbo_cube_vertices;
     GLuint ibo_cube_indices;
 
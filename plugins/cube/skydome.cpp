@@ -1,13 +1,12 @@
 #include "skydome.hpp"
 #include <wayfire/core.hpp>
-#include <wayfire/img.hpp>
 
 #include <wayfire/output.hpp>
+#include <wayfire/render-manager.hpp>
 #include <wayfire/workspace-set.hpp>
 
 
 #include <glm/gtc/matrix_transform.hpp>
-#include "shaders.tpp"
 
 #define SKYDOME_GRID_WIDTH 128
 #define SKYDOME_GRID_HEIGHT 128
@@ -15,63 +14,25 @@
 wf_cube_background_skydome::wf_cube_background_skydome(wf::output_t *output)
 {
     this->output = output;
-    load_program();
+    resources->load_programs();
     reload_texture();
 }
 
-wf_cube_background_skydome::~wf_cube_background_skydome()
-{
-    OpenGL::render_begin();
-    program.free_resources();
-    if (tex != (GLuint) - 1)
-    {
-        GL_CALL(glDeleteTextures(1, &tex));
-    }
-
-    OpenGL::render_end();
-}
-
-void wf_cube_background_skydome::load_program()
-{
-    OpenGL::render_begin();
-    program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
-    OpenGL::render_end();
-}
+wf_cube_background_skydome::~wf_cube_background_skydome() = default;
 
 void wf_cube_background_skydome::reload_texture()
 {
-    if (!last_background_image.compare(background_image))
+    if (last_background_image.compare(background_image))
     {
-        return;
-    }
-
-    last_background_image = background_image;
-    OpenGL::render_begin();
-
-    if (tex == (uint32_t)-1)
-    {
-        GL_CALL(glGenTextures(1, &tex));
+        last_background_image = background_image;
+        pending_texture = resources->get_skydome_texture(last_background_image);
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-
-    if (image_io::load_from_file(last_background_image, GL_TEXTURE_2D))
-    {
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    } else
+    // Keep rendering the previous texture (if any) while the new image is decoded.
+    if (pending_texture && !pending_texture->loading)
     {
-        LOGE("Failed to load skydome image from \"%s\".",
-            last_background_image.c_str());
-        GL_CALL(glDeleteTextures(1, &tex));
-        tex = -1;
+        texture = std::move(pending_texture);
     }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-
-    OpenGL::render_end();
 }
 
 void wf_cube_background_skydome::fill_vertices()
@@ -135,7 +96,7 @@ void wf_cube_background_skydome::render_frame(const wf::render_target_t& fb,
     fill_vertices();
     reload_texture();
 
-    if (tex == (uint32_t)-1)
+    if (!texture || (texture->tex == (uint32_t)-1))
     {
         GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
@@ -168,7 +129,7 @@ void wf_cube_background_skydome::render_frame(const wf::render_target_t& fb,
     program.uniformMatrix4f("model", model);
 
     GL_CALL(glActiveTexture(GL_TEXTURE0));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, texture->tex));
 
     GL_CALL(glDrawElements(GL_TRIANGLES,
         6 * SKYDOME_GRID_WIDTH * (SKYDOME_GRID_HEIGHT - 2),
@@ -3,6 +3,8 @@
 
 #include "cube-background.hpp"
 #include "wayfire/output.hpp"
+#include "cube-resources.hpp"
+#include "wayfire/plugins/common/shared-core-data.hpp"
 #include <vector>
 
 class wf_cube_background_skydome : public wf_cube_background_base
@@ -17,12 +19,15 @@ class wf_cube_background_skydome : public wf_cube_background_base
   private:
     wf::output_t *output;
 
-    void load_program();
     void fill_vertices();
     void reload_texture();
 
-    OpenGL::program_t program;
-    GLuint tex = -1;
+    wf::shared_data::ref_ptr_t<wf_cube_resources_t> resources;
+    OpenGL::program_t& program = resources->simple_program;
+
+    /* The texture which is rendered, and the one replacing it once it is loaded */
+    std::shared_ptr<wf_cube_texture_t> texture;
+    std::shared_ptr<wf_cube_texture_t> pending_texture;
 
     std::vector<GLfloat> vertices;
     std::vector<GLfloat> coords;
@@ -2,6 +2,7 @@
 #include "deco-theme.hpp"
 #include <wayfire/opengl.hpp>
 #include <wayfire/plugins/common/cairo-util.hpp>
+#include <cmath>
 
 #define HOVERED  1.0
 #define NORMAL   0.0
@@ -11,6 +12,51 @@ namespace wf
 {
 namespace decor
 {
+std::shared_ptr<wf::simple_texture_t> button_texture_cache_t::get_texture(
+    const decoration_theme_t& theme, button_type_t type, double hover_progress)
+{
+    const int size = theme.get_title_height();
+    const int hover_step = std::lround(hover_progress * HOVER_STEPS);
+    const key_t key = {type, size, hover_step};
+
+    auto it = textures.find(key);
+    if (it != textures.end())
+    {
+        return it->second;
+    }
+
+    if (textures.size() >= MAX_TEXTURES)
+    {
+        for (auto prev = textures.begin(); prev != textures.end();)
+        {
+            prev = (prev->second.use_count() == 1) ? textures.erase(prev) : std::next(prev);
+        }
+    }
+
+    /**
+     * We render at 100% resolution
+     * When uploading the texture, this gets scaled
+     * to 70% of the titlebar height. Thus we will have
+     * a very crisp image
+     */
+    decoration_theme_t::button_state_t state = {
+        .width  = 1.0 * size,
+        .height = 1.0 * size,
+        .border = 1.0,
+        .hover_progress = 1.0 * hover_step / HOVER_STEPS,
+    };
+
+    auto texture = std::make_shared<wf::simple_texture_t>();
+    auto surface = theme.get_button_surface(type, state);
+    OpenGL::render_begin();
+    cairo_surface_upload_to_texture(surface, *texture);
+    OpenGL::render_end();
+    cairo_surface_destroy(surface);
+
+    textures[key] = texture;
+    return texture;
+}
+
 button_t::button_t(const decoration_theme_t& t, std::function<void()> damage) :
     theme(t), damage_callback(damage)
 {}
@@ -66,9 +112,14 @@ void button_t::set_pressed(bool is_pressed)
 void button_t::render(const wf::render_target_t& fb, wf::geometry_t geometry,
     wf::geometry_t scissor)
 {
+    if (!button_texture)
+    {
+        return;
+    }
+
     OpenGL::render_begin(fb);
     fb.logic_scissor(scissor);
-    OpenGL::render_texture(button_texture.tex, fb, geometry, {1, 1, 1, 1},
+    OpenGL::render_texture(button_texture->tex, fb, geometry, {1, 1, 1, 1},
         OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
     OpenGL::render_end();
 
@@ -80,24 +131,7 @@ void button_t::render(const wf::render_target_t& fb, wf::geometry_t geometry,
 
 void button_t::update_texture()
 {
-    /**
-     * We render at 100% resolution
-     * When uploading the texture, this gets scaled
-     * to 70% of the titlebar height. Thus we will have
-     * a very crisp image
-     */
-    decoration_theme_t::button_state_t state = {
-        .width  = 1.0 * theme.get_title_height(),
-        .height = 1.0 * theme.get_title_height(),
-        .border = 1.0,
-        .hover_progress = hover,
-    };
-
-    auto surface = theme.get_button_surface(type, state);
-    OpenGL::render_begin();
-    cairo_surface_upload_to_texture(surface, this->button_texture);
-    OpenGL::render_end();
-    cairo_surface_destroy(surface);
+    this->button_texture = texture_cache->get_texture(theme, type, hover);
 }
 
 void button_t::add_idle_damage()
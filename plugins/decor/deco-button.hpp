@@ -1,11 +1,15 @@
 #pragma once
 
+#include <map>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <wayfire/util.hpp>
 #include <wayfire/opengl.hpp>
 #include <wayfire/render-manager.hpp>
 #include <wayfire/util/duration.hpp>
 #include <wayfire/plugins/common/simple-texture.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
 
 #include <cairo.h>
 #include <pango/pango.h>
@@ -24,6 +28,32 @@ enum button_type_t
     BUTTON_MINIMIZE        = 1 << 2,
 };
 
+/**
+ * Button textures shared between all decorated views.
+ *
+ * The textures are keyed by the button type, size and hover progress, so that all buttons in the same state
+ * use the same texture, and hovering a button or decorating a new view does not render and upload it again.
+ */
+class button_texture_cache_t
+{
+  public:
+    /**
+     * Get the texture of a button, rendering it if it is not in the cache yet.
+     * The hover progress is rounded to steps of 1/HOVER_STEPS.
+     */
+    std::shared_ptr<wf::simple_texture_t> get_texture(const decoration_theme_t& theme,
+        button_type_t type, double hover_progress);
+
+  private:
+    static constexpr int HOVER_STEPS = 32;
+    /* When there are more textures, the ones not used by any button are dropped. */
+    static constexpr size_t MAX_TEXTURES = 256;
+
+    /* Type, size, hover step */
+    using key_t = std::tuple<int, int, int>;
+    std::map<key_t, std::shared_ptr<wf::simple_texture_t>> textures;
+};
+
 class button_t
 {
   public:
@@ -79,7 +109,8 @@ class button_t
 
     /* Whether the button needs repaint */
     button_type_t type;
-    wf::simple_texture_t button_texture;
+    std::shared_ptr<wf::simple_texture_t> button_texture;
+    wf::shared_data::ref_ptr_t<button_texture_cache_t> texture_cache;
 
     /* Whether the button is currently being hovered */
     bool is_hovered = false;
@@ -94,7 +125,7 @@ class button_t
     void add_idle_damage();
 
     /**
-     * Redraw the button surface and store it as a texture
+     * Get the texture for the current state of the button from the cache
      */
     void update_texture();
 };
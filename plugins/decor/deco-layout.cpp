@@ -162,6 +162,9 @@ void decoration_layout_t::resize(int width, int height)
     border_geometry = {0, height - border_size, width, border_size};
     this->layout_areas.push_back(std::make_unique<decoration_area_t>(
         DECORATION_AREA_RESIZE_BOTTOM, border_geometry));
+
+    /* The old areas are gone, find the hovered one in the new layout */
+    update_hovered();
 }
 
 /**
@@ -197,12 +200,11 @@ wf::region_t decoration_layout_t::calculate_region() const
     return r;
 }
 
-void decoration_layout_t::unset_hover(std::optional<wf::point_t> position)
+void decoration_layout_t::unset_hover()
 {
-    auto area = find_area_at(position);
-    if (area && (area->get_type() == DECORATION_AREA_BUTTON))
+    if (hovered_area && (hovered_area->get_type() == DECORATION_AREA_BUTTON))
     {
-        area->as_button().set_hover(false);
+        hovered_area->as_button().set_hover(false);
     }
 }
 
@@ -210,9 +212,14 @@ void decoration_layout_t::unset_hover(std::optional<wf::point_t> position)
 decoration_layout_t::action_response_t decoration_layout_t::handle_motion(
     int x, int y)
 {
-    auto previous_area = find_area_at(current_input);
-    auto current_area  = find_area_at(wf::point_t{x, y});
+    auto previous_area = hovered_area;
+    if (current_input != wf::point_t{x, y})
+    {
+        this->current_input = {x, y};
+        update_hovered();
+    }
 
+    auto current_area = hovered_area;
     if (previous_area == current_area)
     {
         if (is_grabbed && current_area &&
@@ -223,14 +230,17 @@ decoration_layout_t::action_response_t decoration_layout_t::handle_motion(
         }
     } else
     {
-        unset_hover(current_input);
+        if (previous_area && (previous_area->get_type() == DECORATION_AREA_BUTTON))
+        {
+            previous_area->as_button().set_hover(false);
+        }
+
         if (current_area && (current_area->get_type() == DECORATION_AREA_BUTTON))
         {
             current_area->as_button().set_hover(true);
         }
     }
 
-    this->current_input = {x, y};
     update_cursor();
 
     return {DECORATION_ACTION_NONE, 0};
@@ -248,7 +258,7 @@ decoration_layout_t::action_response_t decoration_layout_t::handle_press_event(
 {
     if (pressed)
     {
-        auto area = find_area_at(current_input);
+        auto area = hovered_area;
         if (area && (area->get_type() & DECORATION_AREA_MOVE_BIT))
         {
             if (timer.is_connected())
@@ -262,7 +272,7 @@ decoration_layout_t::action_response_t decoration_layout_t::handle_press_event(
 
         if (area && (area->get_type() & DECORATION_AREA_RESIZE_BIT))
         {
-            return {DECORATION_ACTION_RESIZE, calculate_resize_edges()};
+            return {DECORATION_ACTION_RESIZE, hovered_edges};
         }
 
         if (area && (area->get_type() == DECORATION_AREA_BUTTON))
@@ -282,7 +292,7 @@ decoration_layout_t::action_response_t decoration_layout_t::handle_press_event(
     {
         is_grabbed = false;
         auto begin_area = find_area_at(grab_origin);
-        auto end_area   = find_area_at(current_input);
+        auto end_area   = hovered_area;
 
         if (begin_area && (begin_area->get_type() == DECORATION_AREA_BUTTON))
         {
@@ -332,35 +342,48 @@ nonstd::observer_ptr<decoration_area_t> decoration_layout_t::find_area_at(std::o
     return nullptr;
 }
 
-/** Calculate resize edges based on @current_input */
-uint32_t decoration_layout_t::calculate_resize_edges() const
+/**
+ * Recalculate @hovered_area and @hovered_edges for @current_input.
+ * Both are found in a single pass, so that motion events do not walk the layout
+ * once for the area and again for the cursor.
+ */
+void decoration_layout_t::update_hovered()
 {
+    hovered_area  = nullptr;
+    hovered_edges = 0;
     if (!this->current_input.has_value())
     {
-        return 0;
+        return;
     }
 
-    uint32_t edges = 0;
     for (auto& area : layout_areas)
     {
         if (area->get_geometry() & *this->current_input)
         {
+            if (!hovered_area)
+            {
+                hovered_area = {area};
+            }
+
             if (area->get_type() & DECORATION_AREA_RESIZE_BIT)
             {
-                edges |= (area->get_type() & ~DECORATION_AREA_RESIZE_BIT);
+                hovered_edges |= (area->get_type() & ~DECORATION_AREA_RESIZE_BIT);
             }
         }
     }
-
-    return edges;
 }
 
-/** Update the cursor based on @current_input */
-void decoration_layout_t::update_cursor() const
+/** Update the cursor based on @current_input, if the resize edges changed */
+void decoration_layout_t::update_cursor()
 {
-    uint32_t edges   = calculate_resize_edges();
-    auto cursor_name = edges > 0 ?
-        wlr_xcursor_get_resize_name((wlr_edges)edges) : "default";
+    if (cursor_edges == hovered_edges)
+    {
+        return;
+    }
+
+    cursor_edges     = hovered_edges;
+    auto cursor_name = hovered_edges > 0 ?
+        wlr_xcursor_get_resize_name((wlr_edges)hovered_edges) : "default";
     wf::get_core().set_cursor(cursor_name);
 }
 
@@ -376,7 +399,9 @@ void decoration_layout_t::handle_focus_lost()
         }
     }
 
-    this->unset_hover(current_input);
+    this->unset_hover();
+    /* Whoever gets the pointer next sets its own cursor, so set ours again on re-entry */
+    this->cursor_edges.reset();
 }
 }
 }
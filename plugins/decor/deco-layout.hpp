@@ -154,6 +154,11 @@ class decoration_layout_t
     wf::point_t grab_origin;
     /* Last position of the input */
     std::optional<wf::point_t> current_input;
+    /* Area and resize edges at @current_input, see update_hovered() */
+    nonstd::observer_ptr<decoration_area_t> hovered_area = nullptr;
+    uint32_t hovered_edges = 0;
+    /* Resize edges the cursor was last set for, unset while the pointer is outside */
+    std::optional<uint32_t> cursor_edges;
     /* double-click timer */
     wf::wl_timer<false> timer;
     bool double_click_at_release = false;
@@ -161,10 +166,10 @@ class decoration_layout_t
     /** Create buttons in the layout, and return their total geometry */
     wf::geometry_t create_buttons(int width, int height);
 
-    /** Calculate resize edges based on @current_input */
-    uint32_t calculate_resize_edges() const;
-    /** Update the cursor based on @current_input */
-    void update_cursor() const;
+    /** Recalculate @hovered_area and @hovered_edges for @current_input */
+    void update_hovered();
+    /** Update the cursor based on @current_input, if the resize edges changed */
+    void update_cursor();
 
     /**
      * Find the layout area at the given coordinates, if any
@@ -172,8 +177,8 @@ class decoration_layout_t
      */
     nonstd::observer_ptr<decoration_area_t> find_area_at(std::optional<wf::point_t> point);
 
-    /** Unset hover state of hovered button at @position, if any */
-    void unset_hover(std::optional<wf::point_t> position);
+    /** Unset hover state of the hovered button, if any */
+    void unset_hover();
     wf::option_wrapper_t<std::string> button_order{"decoration/button_order"};
 };
 }
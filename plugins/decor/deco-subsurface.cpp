@@ -40,11 +40,16 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         }
     };
 
+    /* The title texture is rendered for widths in steps of this many pixels, and clipped to the width of the
+     * titlebar, so that it does not have to be rendered again on each step of an interactive resize. */
+    static constexpr int TITLE_WIDTH_BUCKET = 128;
+
     void update_title(int width, int height, double scale)
     {
         if (auto view = _view.lock())
         {
-            int target_width  = width * scale;
+            int target_width  = (int(width * scale) + TITLE_WIDTH_BUCKET - 1) / TITLE_WIDTH_BUCKET *
+                TITLE_WIDTH_BUCKET;
             int target_height = height * scale;
             if ((title_texture.tex.width != target_width) || (title_texture.tex.height != target_height) ||
                 (title_texture.current_text != view->get_title()))
@@ -100,10 +105,14 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
     }
 
     void render_title(const wf::render_target_t& fb,
-        wf::geometry_t geometry)
+        wf::geometry_t geometry, const wlr_box& scissor)
     {
         update_title(geometry.width, geometry.height, fb.scale);
-        OpenGL::render_texture(title_texture.tex.tex, fb, geometry,
+        fb.logic_scissor(wf::geometry_intersection(geometry, scissor));
+
+        wf::geometry_t texture_geometry = geometry;
+        texture_geometry.width = title_texture.tex.width / fb.scale;
+        OpenGL::render_texture(title_texture.tex.tex, fb, texture_geometry,
             glm::vec4(1.0f), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
     }
 
@@ -128,8 +137,7 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
             if (item->get_type() == wf::decor::DECORATION_AREA_TITLE)
             {
                 OpenGL::render_begin(fb);
-                fb.logic_scissor(scissor);
-                render_title(fb, item->get_geometry() + origin);
+                render_title(fb, item->get_geometry() + origin, scissor);
                 OpenGL::render_end();
             } else // button
             {
@@ -208,6 +216,11 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
                 self->render_scissor_box(target, self->get_offset(), wlr_box_from_pixman_box(box));
             }
         }
+
+        bool can_render_transformed() override
+        {
+            return true;
+        }
     };
 
     void gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
@@ -68,19 +68,10 @@ cairo_surface_t*decoration_theme_t::render_text(std::string text,
     const float font_scale = 0.8;
     const float font_size  = height * font_scale;
 
-    PangoFontDescription *font_desc;
-    PangoLayout *layout;
-
     // render text
-    font_desc = pango_font_description_from_string(((std::string)font).c_str());
-    pango_font_description_set_absolute_size(font_desc, font_size * PANGO_SCALE);
-
-    layout = pango_cairo_create_layout(cr);
-    pango_layout_set_font_description(layout, font_desc);
-    pango_layout_set_text(layout, text.c_str(), text.size());
+    PangoLayout *layout = layouts->get_layout(cr, text, font, font_size);
     cairo_set_source_rgba(cr, 1, 1, 1, 1);
     pango_cairo_show_layout(cr, layout);
-    pango_font_description_free(font_desc);
     g_object_unref(layout);
     cairo_destroy(cr);
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <wayfire/render-manager.hpp>
 #include "deco-button.hpp"
+#include <wayfire/plugins/common/cairo-util.hpp>
 
 namespace wf
 {
@@ -70,6 +71,7 @@ class decoration_theme_t
     wf::option_wrapper_t<int> border_size{"decoration/border_size"};
     wf::option_wrapper_t<wf::color_t> active_color{"decoration/active_color"};
     wf::option_wrapper_t<wf::color_t> inactive_color{"decoration/inactive_color"};
+    mutable wf::shared_data::ref_ptr_t<wf::pango_layout_cache_t> layouts;
 };
 }
 }
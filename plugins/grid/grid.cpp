@@ -5,6 +5,9 @@
 #include <wayfire/workarea.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/render-manager.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/txn/transaction-manager.hpp>
+#include <algorithm>
 #include <cmath>
 #include <linux/input-event-codes.h>
 #include "wayfire/plugin.hpp"
@@ -137,6 +140,21 @@ class wayfire_grid : public wf::plugin_interface_t, public wf::per_output_tracke
         return is_floating && (view->get_output() != nullptr) && view->toplevel()->pending().mapped;
     }
 
+    /**
+     * Slot requests are carried out together on idle, so that many requests in a row (for example from a
+     * script through IPC, or for all views after a workarea change) result in a single transaction, and in
+     * at most one animation per view.
+     */
+    struct pending_slot_t
+    {
+        std::weak_ptr<wf::view_interface_t> view;
+        int slot;
+        wf::point_t delta;
+    };
+
+    std::vector<pending_slot_t> pending_slots;
+    wf::wl_idle_call idle_apply_slots;
+
     void handle_slot(wayfire_toplevel_view view, int slot, wf::point_t delta = {0, 0})
     {
         if (!can_adjust_view(view))
@@ -145,9 +163,56 @@ class wayfire_grid : public wf::plugin_interface_t, public wf::per_output_tracke
         }
 
         view->get_data_safe<wf_grid_slot_data>()->slot = slot;
-        auto slot_geometry = wf::grid::get_slot_dimensions(view->get_output(), slot) + delta;
-        ensure_grid_view(view)->adjust_target_geometry(
-            slot_geometry, wf::grid::get_tiled_edges_for_slot(slot));
+
+        // A later request for the same view replaces the earlier one.
+        auto it = std::find_if(pending_slots.begin(), pending_slots.end(), [&] (const pending_slot_t& p)
+        {
+            return p.view.lock().get() == view.get();
+        });
+
+        if (it != pending_slots.end())
+        {
+            it->slot  = slot;
+            it->delta = delta;
+        } else
+        {
+            pending_slots.push_back({view->weak_from_this(), slot, delta});
+        }
+
+        idle_apply_slots.run_once([=] () { apply_pending_slots(); });
+    }
+
+    void apply_pending_slots()
+    {
+        auto requests = std::move(pending_slots);
+        pending_slots.clear();
+
+        auto tx = wf::txn::transaction_t::create();
+        for (auto& request : requests)
+        {
+            auto locked = request.view.lock();
+            auto view   = toplevel_cast(locked.get());
+            if (!view || !can_adjust_view(view))
+            {
+                continue;
+            }
+
+            auto slot_geometry = wf::grid::get_slot_dimensions(view->get_output(), request.slot) + request.delta;
+            const uint32_t edges = wf::grid::get_tiled_edges_for_slot(request.slot);
+            const auto& pending  = view->toplevel()->pending();
+            if ((pending.geometry == slot_geometry) && (pending.tiled_edges == edges) && !pending.fullscreen)
+            {
+                // Already in the slot, do not start another animation.
+                continue;
+            }
+
+            ensure_grid_view(view)->adjust_target_geometry(slot_geometry, edges, tx);
+        }
+
+        if (!tx->get_objects().empty())
+        {
+            wf::get_core().tx_manager->schedule_transaction(std::move(tx));
+        }
     }
 
     wf::signal::connection_t<wf::workarea_changed_signal> on_workarea_changed =
@@ -53,6 +53,10 @@ class crossfade_node_t : public scene::view_2d_transformer_t
         original_buffer.geometry = view->get_geometry();
         original_buffer.scale    = view->get_output()->handle->scale;
 
+        OpenGL::gpu_memory_scope_t memory_scope{[&] ()
+        {
+            return OpenGL::gpu_memory_owner_t{"crossfade", view->get_id()};
+        }};
         OpenGL::render_begin();
         auto w = original_buffer.scale * original_buffer.geometry.width;
         auto h = original_buffer.scale * original_buffer.geometry.height;
@@ -229,9 +233,11 @@ class grid_animation_t : public wf::custom_data_t
             return destroy();
         }
 
-        // Crossfade animation
+        // Crossfade animation. If the view is still animating towards an earlier target, the animation
+        // continues from the displayed geometry instead of starting over from the view's geometry.
+        const wf::geometry_t start = animation.running() ? (wf::geometry_t)animation : view->get_geometry();
         original = view->get_geometry();
-        animation.set_start(original);
+        animation.set_start(start);
         animation.set_end(geometry);
         animation.start();
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <wayfire/toplevel-view.hpp>
 #include <wayfire/output.hpp>
 #include <wayfire/workarea.hpp>
@@ -92,11 +93,10 @@ inline uint32_t get_slot_from_tiled_edges(uint32_t edges)
  * 4 5 6
  * 1 2 3
  * */
-inline wf::geometry_t get_slot_dimensions(wf::output_t *output, int n)
+inline wf::geometry_t get_slot_dimensions(wf::geometry_t area, int n)
 {
-    auto area = output->workarea->get_workarea();
-    int w2    = area.width / 2;
-    int h2    = area.height / 2;
+    int w2 = area.width / 2;
+    int h2 = area.height / 2;
 
     if (n % 3 == 1)
     {
@@ -118,5 +118,34 @@ inline wf::geometry_t get_slot_dimensions(wf::output_t *output, int n)
 
     return area;
 }
+
+/**
+ * The geometries of all slots of an output, stored on the output and computed again only when its workarea
+ * changes.
+ */
+struct slot_geometries_t : public wf::custom_data_t
+{
+    wf::geometry_t workarea = {0, 0, 0, 0};
+    std::array<wf::geometry_t, 10> slots;
+    bool valid = false;
+};
+
+inline wf::geometry_t get_slot_dimensions(wf::output_t *output, int n)
+{
+    auto area  = output->workarea->get_workarea();
+    auto cache = output->get_data_safe<slot_geometries_t>();
+    if (!cache->valid || (cache->workarea != area))
+    {
+        for (int slot = 0; slot < (int)cache->slots.size(); slot++)
+        {
+            cache->slots[slot] = get_slot_dimensions(area, slot);
+        }
+
+        cache->workarea = area;
+        cache->valid    = true;
+    }
+
+    return ((n >= 0) && (n < (int)cache->slots.size())) ? cache->slots[n] : get_slot_dimensions(area, n);
+}
 }
 }
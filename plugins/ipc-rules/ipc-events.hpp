@@ -1,9 +1,13 @@
 #pragma once
 
 #include "ipc-rules-common.hpp"
+#include <algorithm>
+#include <optional>
 #include <set>
 #include "plugins/ipc/ipc-method-repository.hpp"
 #include <wayfire/per-output-plugin.hpp>
+#include <wayfire/matcher.hpp>
+#include <wayfire/util.hpp>
 #include <nlohmann/json.hpp>
 
 namespace wf
@@ -37,7 +41,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         nlohmann::json data;
         data["event"]  = "output-added";
         data["output"] = output_to_json(output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, output);
     }
 
     void handle_output_removed(wf::output_t *output) override
@@ -45,7 +49,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         nlohmann::json data;
         data["event"]  = "output-removed";
         data["output"] = output_to_json(output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, output);
     }
 
     // Template FOO for efficient management of signals: ensure that only actually listened-for signals
@@ -125,15 +129,72 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         {"wset-workspace-changed", get_generic_output_registration_cb(&on_wset_workspace_changed)},
     };
 
-    // Track a list of clients which have requested watch
-    std::map<wf::ipc::client_interface_t*, std::set<std::string>> clients;
+    /**
+     * What a client has subscribed to. Events are only serialized and sent if they pass the client's filters.
+     */
+    struct subscription_t
+    {
+        // The events the client listens for
+        std::set<std::string> events;
+        // Events about views are sent only for views matching this condition
+        std::optional<wf::view_matcher_t> view_matcher;
+        // Events about views or outputs are sent only if they happen on this output
+        std::optional<uint64_t> output_id;
+        // If not empty, only these fields of the view are sent with events about views
+        std::vector<std::string> view_fields;
+        // If positive, high-frequency events are merged and sent at most once per this many milliseconds
+        int coalesce_ms = 0;
+        // Merged events waiting to be sent, together with the event and view or output they are about
+        std::vector<std::pair<std::string, nlohmann::json>> pending;
+        std::unique_ptr<wf::wl_timer<false>> flush_timer;
+
+        bool matches(wayfire_view view, wf::output_t *output)
+        {
+            if (view && view_matcher && !view_matcher->matches(view))
+            {
+                return false;
+            }
+
+            if (!output && view)
+            {
+                output = view->get_output();
+            }
+
+            if (output_id && output && (output->get_id() != *output_id))
+            {
+                return false;
+            }
 
+            return true;
+        }
+    };
+
+    // Track a list of clients which have requested watch
+    std::map<wf::ipc::client_interface_t*, subscription_t> clients;
+
+    /**
+     * Subscribe to events.
+     *
+     * Optional arguments:
+     * - events: the names of the events to watch, by default all of them.
+     * - view-matcher: a condition in the syntax of window rules (e.g. 'app_id is "foot"'). Events about views
+     *   are sent only for matching views.
+     * - output-id: events about views and outputs are sent only if they happen on the given output.
+     * - view-fields: the fields of the view objects to include in the events, by default all of them.
+     * - coalesce-ms: if given, events which can be emitted at frame rate (see coalesced_events()) are merged
+     *   for each view or output, and sent at most once per the given interval. Only the latest state is sent,
+     *   so they may arrive later than other events.
+     */
     wf::ipc::method_callback_full on_client_watch =
         [=] (nlohmann::json data, wf::ipc::client_interface_t *client)
     {
         static constexpr const char *EVENTS = "events";
         WFJSON_OPTIONAL_FIELD(data, EVENTS, array);
-        std::set<std::string> subscribed_to;
+        WFJSON_OPTIONAL_FIELD(data, "view-matcher", string);
+        WFJSON_OPTIONAL_FIELD(data, "output-id", number_unsigned);
+        WFJSON_OPTIONAL_FIELD(data, "view-fields", array);
+        WFJSON_OPTIONAL_FIELD(data, "coalesce-ms", number_unsigned);
+        subscription_t subscription;
         if (data.contains(EVENTS))
         {
             for (auto& sub : data[EVENTS])
@@ -145,30 +206,71 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
 
                 if (signal_map.count(sub))
                 {
-                    subscribed_to.insert((std::string)sub);
+                    subscription.events.insert((std::string)sub);
                 }
             }
         } else
         {
             for (auto& [ev_name, _] : signal_map)
             {
-                subscribed_to.insert(ev_name);
+                subscription.events.insert(ev_name);
+            }
+        }
+
+        if (data.contains("view-fields"))
+        {
+            for (auto& field : data["view-fields"])
+            {
+                if (!field.is_string())
+                {
+                    return wf::ipc::json_error("view-fields contains non-string entries!");
+                }
+
+                subscription.view_fields.push_back(field);
+            }
+        }
+
+        if (data.contains("view-matcher"))
+        {
+            auto condition = std::make_shared<wf::config::option_t<std::string>>("ipc-watch",
+                (std::string)data["view-matcher"]);
+            subscription.view_matcher.emplace(condition);
+        }
+
+        if (data.contains("output-id"))
+        {
+            subscription.output_id = data["output-id"];
+        }
+
+        if (data.contains("coalesce-ms") && ((int)data["coalesce-ms"] > 0))
+        {
+            subscription.coalesce_ms = data["coalesce-ms"];
+            subscription.flush_timer = std::make_unique<wf::wl_timer<false>>();
+        }
+
+        // Watching again replaces the previous subscription.
+        if (clients.count(client))
+        {
+            for (auto& ev_name : clients[client].events)
+            {
+                signal_map[ev_name].decrease_count();
             }
         }
 
-        for (auto& ev_name : subscribed_to)
+        for (auto& ev_name : subscription.events)
         {
             signal_map[ev_name].increase_count();
         }
 
-        clients[client] = subscribed_to;
+        clients.erase(client);
+        clients.emplace(client, std::move(subscription));
         return wf::ipc::json_ok();
     };
 
     wf::signal::connection_t<wf::ipc::client_disconnected_signal> on_client_disconnected =
         [=] (wf::ipc::client_disconnected_signal *ev)
     {
-        for (auto& ev_name : clients[ev->client])
+        for (auto& ev_name : clients[ev->client].events)
         {
             signal_map[ev_name].decrease_count();
         }
@@ -176,23 +278,141 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         clients.erase(ev->client);
     };
 
+    bool has_subscribers(const std::string& event_name, wayfire_view view, wf::output_t *output)
+    {
+        for (auto& [client, subscription] : clients)
+        {
+            if ((subscription.events.empty() || subscription.events.count(event_name)) &&
+                subscription.matches(view, output))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     void send_view_to_subscribes(wayfire_view view, std::string event_name)
     {
+        // Avoid serializing the view when nobody is interested in it.
+        if (!has_subscribers(event_name, view, nullptr))
+        {
+            return;
+        }
+
         nlohmann::json event;
         event["event"] = event_name;
         event["view"]  = view_to_json(view);
-        send_event_to_subscribes(event, event_name);
+        send_event_to_subscribes(event, event_name, view);
     }
 
-    void send_event_to_subscribes(const nlohmann::json& data, const std::string& event_name)
+    /**
+     * The events which are merged for subscriptions with coalesce-ms, and the field of each event which is kept
+     * from the first of the merged events.
+     */
+    static const std::map<std::string, std::string>& coalesced_events()
     {
-        for (auto& [client, events] : clients)
+        static const std::map<std::string, std::string> events = {
+            {"view-geometry-changed", "old-geometry"},
+            {"view-workspace-changed", "from"},
+            {"wset-workspace-changed", "previous-workspace"},
+        };
+
+        return events;
+    }
+
+    static std::string serialize_event(const nlohmann::json& data, const std::vector<std::string>& fields)
+    {
+        if (fields.empty() || !data.contains("view") || !data["view"].is_object())
+        {
+            return data.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+        }
+
+        auto message = data;
+        nlohmann::json projected = nlohmann::json::object();
+        for (auto& field : fields)
         {
-            if (events.empty() || events.count(event_name))
+            if (data["view"].contains(field))
             {
-                client->send_json(data);
+                projected[field] = data["view"][field];
             }
         }
+
+        message["view"] = std::move(projected);
+        return message.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+    }
+
+    void queue_coalesced_event(wf::ipc::client_interface_t *client, subscription_t& subscription,
+        const std::string& event_name, const std::string& key, const nlohmann::json& data)
+    {
+        auto it = std::find_if(subscription.pending.begin(), subscription.pending.end(),
+            [&] (const auto& pending) { return pending.first == key; });
+        if (it == subscription.pending.end())
+        {
+            subscription.pending.emplace_back(key, data);
+        } else
+        {
+            const auto& keep_field = coalesced_events().at(event_name);
+            auto merged = data;
+            merged[keep_field] = it->second[keep_field];
+            it->second = std::move(merged);
+        }
+
+        if (!subscription.flush_timer->is_connected())
+        {
+            subscription.flush_timer->set_timeout(subscription.coalesce_ms, [=] ()
+            {
+                flush_coalesced_events(client);
+            });
+        }
+    }
+
+    void flush_coalesced_events(wf::ipc::client_interface_t *client)
+    {
+        auto& subscription = clients[client];
+        auto pending = std::move(subscription.pending);
+        subscription.pending.clear();
+        for (auto& [_, data] : pending)
+        {
+            client->send_serialized(serialize_event(data, subscription.view_fields));
+        }
+    }
+
+    /**
+     * Send an event to the clients which subscribed to it and whose filters accept the @view and the @output
+     * the event is about. The event is serialized once for each distinct set of view fields.
+     */
+    void send_event_to_subscribes(const nlohmann::json& data, const std::string& event_name,
+        wayfire_view view = nullptr, wf::output_t *output = nullptr)
+    {
+        static const std::vector<std::string> all_fields;
+        const bool coalescable = coalesced_events().count(event_name);
+        std::map<std::vector<std::string>, std::string> serialized;
+        for (auto& [client, subscription] : clients)
+        {
+            if ((!subscription.events.empty() && !subscription.events.count(event_name)) ||
+                !subscription.matches(view, output))
+            {
+                continue;
+            }
+
+            if (coalescable && (subscription.coalesce_ms > 0))
+            {
+                const std::string key = event_name + (view ? " view " + std::to_string(view->get_id()) :
+                    " output " + std::to_string(output ? output->get_id() : 0));
+                queue_coalesced_event(client, subscription, event_name, key, data);
+                continue;
+            }
+
+            const auto& fields = data.contains("view") ? subscription.view_fields : all_fields;
+            auto it = serialized.find(fields);
+            if (it == serialized.end())
+            {
+                it = serialized.emplace(fields, serialize_event(data, fields)).first;
+            }
+
+            client->send_serialized(it->second);
+        }
     }
 
     wf::signal::connection_t<wf::view_mapped_signal> on_view_mapped = [=] (wf::view_mapped_signal *ev)
@@ -212,7 +432,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["event"]  = "view-set-output";
         data["output"] = output_to_json(ev->output);
         data["view"]   = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view, ev->output);
     };
 
     wf::signal::connection_t<wf::view_geometry_changed_signal> on_view_geometry_changed =
@@ -222,7 +442,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["event"] = "view-geometry-changed";
         data["old-geometry"] = wf::ipc::geometry_to_json(ev->old_geometry);
         data["view"] = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::view_moved_to_wset_signal> on_view_moved_to_wset =
@@ -233,7 +453,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["old-wset"] = wset_to_json(ev->old_wset.get());
         data["new-wset"] = wset_to_json(ev->new_wset.get());
         data["view"]     = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::keyboard_focus_changed_signal> on_kbfocus_changed =
@@ -250,7 +470,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["old-edges"] = ev->old_edges;
         data["new-edges"] = ev->new_edges;
         data["view"] = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     // Minimized rule handler.
@@ -279,7 +499,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["from"]  = wf::ipc::point_to_json(ev->from);
         data["to"]    = wf::ipc::point_to_json(ev->to);
         data["view"]  = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed =
@@ -303,7 +523,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["state"]  = ev->activated;
         data["output"] = ev->output ? (int)ev->output->get_id() : -1;
         data["output-data"] = output_to_json(ev->output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 
     wf::signal::connection_t<wf::output_gain_focus_signal> on_output_gain_focus =
@@ -312,7 +532,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         nlohmann::json data;
         data["event"]  = "output-gain-focus";
         data["output"] = output_to_json(ev->output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 
     wf::signal::connection_t<wf::workspace_set_changed_signal> on_wset_changed =
@@ -324,7 +544,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["output"]   = ev->output ? (int)ev->output->get_id() : -1;
         data["new-wset-data"] = wset_to_json(ev->new_wset.get());
         data["output-data"]   = output_to_json(ev->output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 
     wf::signal::connection_t<wf::workspace_changed_signal> on_wset_workspace_changed =
@@ -338,7 +558,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["wset"]   = (ev->output && ev->output->wset()) ? (int)ev->output->wset()->get_id() : -1;
         data["output-data"] = output_to_json(ev->output);
         data["wset-data"]   = ev->output ? wset_to_json(ev->output->wset().get()) : nullptr;
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 };
 }
@@ -0,0 +1,522 @@
+#pragma once
+
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include "plugins/ipc/ipc-helpers.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/seat.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/unstable/wlr-surface-node.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+namespace wf
+{
+/**
+ * Measures the latency from input events to the presentation of their results, exposed as the
+ * input/latency-* IPC methods.
+ *
+ * For each input device, one event at a time is followed: its hardware timestamp and its arrival in the
+ * compositor are recorded, and after core has handled it, the surface which received it. The sample is
+ * taken when the first frame which was committed after that surface's next commit is presented. Events
+ * which do not go to a client surface (for example because a plugin grabs the input) are measured until
+ * the next presented frame instead, and reported separately as compositor-driven samples.
+ *
+ * Events which arrive while another event of the same device is being followed are not measured. Events
+ * whose result is not presented within a second are counted as dropped.
+ */
+class ipc_rules_latency_methods_t
+{
+  public:
+    void init_latency_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->register_method("input/latency-start", start_latency);
+        method_repository->register_method("input/latency-stop", stop_latency);
+        method_repository->register_method("input/latency", get_latency);
+    }
+
+    void fini_latency_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->unregister_method("input/latency-start");
+        method_repository->unregister_method("input/latency-stop");
+        method_repository->unregister_method("input/latency");
+        stop_tracking();
+    }
+
+  private:
+    static constexpr int64_t TIMEOUT_US = 1000000;
+    static constexpr size_t MAX_SAMPLES = 1024;
+    // Upper bounds of the histogram buckets in milliseconds, the last bucket has no upper bound.
+    static constexpr int BUCKETS_MS[] = {2, 4, 8, 12, 16, 24, 33, 50, 67, 100, 150, 250, 500};
+    static constexpr size_t NUM_BUCKETS = sizeof(BUCKETS_MS) / sizeof(BUCKETS_MS[0]) + 1;
+
+    struct samples_t
+    {
+        uint64_t count = 0;
+        uint64_t histogram[NUM_BUCKETS] = {0};
+        // The most recent samples of the time from the event and from its arrival, in microseconds
+        std::vector<int64_t> from_event;
+        std::vector<int64_t> from_arrival;
+
+        void add(int64_t event_latency, int64_t arrival_latency)
+        {
+            const int ms = event_latency / 1000;
+            size_t bucket = 0;
+            while ((bucket < NUM_BUCKETS - 1) && (ms >= BUCKETS_MS[bucket]))
+            {
+                ++bucket;
+            }
+
+            histogram[bucket]++;
+            if (from_event.size() < MAX_SAMPLES)
+            {
+                from_event.push_back(event_latency);
+                from_arrival.push_back(arrival_latency);
+            } else
+            {
+                from_event[count % MAX_SAMPLES]   = event_latency;
+                from_arrival[count % MAX_SAMPLES] = arrival_latency;
+            }
+
+            ++count;
+        }
+    };
+
+    struct device_stats_t
+    {
+        std::string name;
+        samples_t client;
+        samples_t compositor;
+        uint64_t dropped = 0;
+    };
+
+    /** An event which is being followed until its result is presented. */
+    struct pending_t
+    {
+        int64_t event_us;
+        int64_t arrival_us;
+        // Whether the receiver was determined, after core handled the event
+        bool resolved = false;
+        wlr_surface *surface = nullptr;
+        bool surface_committed = false;
+        // The surface was destroyed before the result could be presented
+        bool dropped = false;
+        // The output whose committed frame contains the result, once known
+        wf::output_t *output = nullptr;
+
+        wf::wl_listener_wrapper on_surface_commit;
+        wf::wl_listener_wrapper on_surface_destroy;
+    };
+
+    struct output_state_t
+    {
+        wf::wl_listener_wrapper on_commit;
+        wf::wl_listener_wrapper on_present;
+    };
+
+    bool tracking = false;
+    std::map<wlr_input_device*, device_stats_t> stats;
+    std::map<wlr_input_device*, std::unique_ptr<pending_t>> pending;
+    std::map<wf::output_t*, std::unique_ptr<output_state_t>> outputs;
+
+    void start_tracking()
+    {
+        stop_tracking();
+        tracking = true;
+        stats.clear();
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            track_output(wo);
+        }
+
+        wf::get_core().output_layout->connect(&on_output_added);
+        wf::get_core().output_layout->connect(&on_output_pre_remove);
+        wf::get_core().connect(&on_device_removed);
+        wf::get_core().connect(&on_pointer_motion);
+        wf::get_core().connect(&on_pointer_motion_absolute);
+        wf::get_core().connect(&on_pointer_button);
+        wf::get_core().connect(&on_pointer_axis);
+        wf::get_core().connect(&on_keyboard_key);
+        wf::get_core().connect(&on_touch_down);
+        wf::get_core().connect(&on_touch_motion);
+        wf::get_core().connect(&on_post_pointer_motion);
+        wf::get_core().connect(&on_post_pointer_motion_absolute);
+        wf::get_core().connect(&on_post_pointer_button);
+        wf::get_core().connect(&on_post_pointer_axis);
+        wf::get_core().connect(&on_post_keyboard_key);
+        wf::get_core().connect(&on_post_touch_down);
+        wf::get_core().connect(&on_post_touch_motion);
+    }
+
+    void stop_tracking()
+    {
+        tracking = false;
+        on_output_added.disconnect();
+        on_output_pre_remove.disconnect();
+        on_device_removed.disconnect();
+        on_pointer_motion.disconnect();
+        on_pointer_motion_absolute.disconnect();
+        on_pointer_button.disconnect();
+        on_pointer_axis.disconnect();
+        on_keyboard_key.disconnect();
+        on_touch_down.disconnect();
+        on_touch_motion.disconnect();
+        on_post_pointer_motion.disconnect();
+        on_post_pointer_motion_absolute.disconnect();
+        on_post_pointer_button.disconnect();
+        on_post_pointer_axis.disconnect();
+        on_post_keyboard_key.disconnect();
+        on_post_touch_down.disconnect();
+        on_post_touch_motion.disconnect();
+        pending.clear();
+        outputs.clear();
+    }
+
+    void track_output(wf::output_t *output)
+    {
+        auto state = std::make_unique<output_state_t>();
+        state->on_commit.set_callback([=] (void*)
+        {
+            handle_output_commit(output);
+        });
+        state->on_present.set_callback([=] (void *data)
+        {
+            handle_output_present(output, static_cast<wlr_output_event_present*>(data));
+        });
+        state->on_commit.connect(&output->handle->events.commit);
+        state->on_present.connect(&output->handle->events.present);
+        outputs[output] = std::move(state);
+    }
+
+    void handle_event(wlr_input_device *device, uint32_t time_msec)
+    {
+        if (!device)
+        {
+            return;
+        }
+
+        drop_expired();
+        if (pending.count(device))
+        {
+            return;
+        }
+
+        auto& device_stats = stats[device];
+        if (device_stats.name.empty())
+        {
+            device_stats.name = nonull(device->name);
+        }
+
+        auto event = std::make_unique<pending_t>();
+        event->arrival_us = wf::get_current_time_us();
+        // The timestamps of the events are in milliseconds of the monotonic clock, truncated to 32 bits.
+        // Implausible delays mean that the device uses a different clock, then only the arrival is known.
+        const uint32_t delay_ms = (uint32_t)(event->arrival_us / 1000) - time_msec;
+        event->event_us = (delay_ms < 1000) ? (event->arrival_us - delay_ms * (int64_t)1000) :
+            event->arrival_us;
+
+        pending[device] = std::move(event);
+    }
+
+    static wlr_surface *node_to_surface(wf::scene::node_ptr node)
+    {
+        if (auto surface_node = dynamic_cast<wf::scene::wlr_surface_node_t*>(node.get()))
+        {
+            return surface_node->get_surface();
+        }
+
+        auto view = wf::node_to_view(node);
+        return view ? view->get_wlr_surface() : nullptr;
+    }
+
+    void handle_post_event(wlr_input_device *device, wf::scene::node_ptr focus)
+    {
+        auto it = pending.find(device);
+        if ((it == pending.end()) || it->second->resolved)
+        {
+            return;
+        }
+
+        auto event = it->second.get();
+        event->resolved = true;
+        event->surface  = focus ? node_to_surface(focus) : nullptr;
+        if (!event->surface)
+        {
+            return;
+        }
+
+        event->on_surface_commit.set_callback([=] (void*)
+        {
+            event->surface_committed = true;
+            event->on_surface_commit.disconnect();
+        });
+        event->on_surface_destroy.set_callback([=] (void*)
+        {
+            // Erased later, the listener cannot be destroyed from its own callback.
+            event->surface = nullptr;
+            event->dropped = true;
+            event->output  = nullptr;
+            event->on_surface_commit.disconnect();
+            event->on_surface_destroy.disconnect();
+        });
+        event->on_surface_commit.connect(&event->surface->events.commit);
+        event->on_surface_destroy.connect(&event->surface->events.destroy);
+    }
+
+    /** The frame committed on the output contains the results of the events which are ready by now. */
+    void handle_output_commit(wf::output_t *output)
+    {
+        for (auto& [device, event] : pending)
+        {
+            if (!event->resolved || event->output || event->dropped)
+            {
+                continue;
+            }
+
+            if (!event->surface)
+            {
+                event->output = output;
+                continue;
+            }
+
+            if (event->surface_committed)
+            {
+                auto view = wf::wl_surface_to_wayfire_view(event->surface->resource);
+                if (!view || !view->get_output() || (view->get_output() == output))
+                {
+                    event->output = output;
+                }
+            }
+        }
+    }
+
+    void handle_output_present(wf::output_t *output, wlr_output_event_present *ev)
+    {
+        const int64_t presented_us = (ev->presented && ev->when) ?
+            wf::timespec_to_usec(*ev->when) : wf::get_current_time_us();
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            auto& event = it->second;
+            if (event->output != output)
+            {
+                ++it;
+                continue;
+            }
+
+            if (!ev->presented)
+            {
+                // The frame was discarded, wait for the next one.
+                event->output = nullptr;
+                ++it;
+                continue;
+            }
+
+            auto& device_stats = stats[it->first];
+            auto& samples = event->surface ? device_stats.client : device_stats.compositor;
+            samples.add(presented_us - event->event_us, presented_us - event->arrival_us);
+            it = pending.erase(it);
+        }
+
+        drop_expired();
+    }
+
+    void drop_expired()
+    {
+        const int64_t now = wf::get_current_time_us();
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (it->second->dropped || (now - it->second->arrival_us > TIMEOUT_US))
+            {
+                stats[it->first].dropped++;
+                it = pending.erase(it);
+            } else
+            {
+                ++it;
+            }
+        }
+    }
+
+    static int64_t percentile(std::vector<int64_t> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        const size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    static nlohmann::json samples_to_json(const samples_t& samples)
+    {
+        nlohmann::json j;
+        j["samples"] = samples.count;
+        for (auto& [name, values] : {std::pair{"from-event", &samples.from_event},
+            std::pair{"from-arrival", &samples.from_arrival}})
+        {
+            j[name]["p50"] = percentile(*values, 0.50);
+            j[name]["p95"] = percentile(*values, 0.95);
+            j[name]["p99"] = percentile(*values, 0.99);
+            j[name]["max"] = values->empty() ? 0 : *std::max_element(values->begin(), values->end());
+        }
+
+        j["histogram"] = nlohmann::json::array();
+        for (size_t i = 0; i < NUM_BUCKETS; i++)
+        {
+            nlohmann::json bucket;
+            bucket["below-ms"] = (i < NUM_BUCKETS - 1) ? nlohmann::json(BUCKETS_MS[i]) : nlohmann::json();
+            bucket["count"]    = samples.histogram[i];
+            j["histogram"].push_back(bucket);
+        }
+
+        return j;
+    }
+
+    template<class Event>
+    using pre_connection_t = wf::signal::connection_t<wf::input_event_signal<Event>>;
+    template<class Event>
+    using post_connection_t = wf::signal::connection_t<wf::post_input_event_signal<Event>>;
+
+    pre_connection_t<wlr_pointer_motion_event> on_pointer_motion = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    pre_connection_t<wlr_pointer_motion_absolute_event> on_pointer_motion_absolute = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    pre_connection_t<wlr_pointer_button_event> on_pointer_button = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    pre_connection_t<wlr_pointer_axis_event> on_pointer_axis = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    pre_connection_t<wlr_keyboard_key_event> on_keyboard_key = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    pre_connection_t<wlr_touch_down_event> on_touch_down = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    pre_connection_t<wlr_touch_motion_event> on_touch_motion = [=] (auto *ev)
+    {
+        handle_event(ev->device, ev->event->time_msec);
+    };
+
+    post_connection_t<wlr_pointer_motion_event> on_post_pointer_motion = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().get_cursor_focus());
+    };
+
+    post_connection_t<wlr_pointer_motion_absolute_event> on_post_pointer_motion_absolute = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().get_cursor_focus());
+    };
+
+    post_connection_t<wlr_pointer_button_event> on_post_pointer_button = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().get_cursor_focus());
+    };
+
+    post_connection_t<wlr_pointer_axis_event> on_post_pointer_axis = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().get_cursor_focus());
+    };
+
+    post_connection_t<wlr_keyboard_key_event> on_post_keyboard_key = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().seat->get_active_node());
+    };
+
+    post_connection_t<wlr_touch_down_event> on_post_touch_down = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().get_touch_focus(ev->event->touch_id));
+    };
+
+    post_connection_t<wlr_touch_motion_event> on_post_touch_motion = [=] (auto *ev)
+    {
+        handle_post_event(ev->device, wf::get_core().get_touch_focus(ev->event->touch_id));
+    };
+
+    wf::signal::connection_t<wf::output_added_signal> on_output_added = [=] (wf::output_added_signal *ev)
+    {
+        track_output(ev->output);
+    };
+
+    wf::signal::connection_t<wf::output_pre_remove_signal> on_output_pre_remove =
+        [=] (wf::output_pre_remove_signal *ev)
+    {
+        outputs.erase(ev->output);
+        for (auto& [device, event] : pending)
+        {
+            if (event->output == ev->output)
+            {
+                event->output = nullptr;
+            }
+        }
+    };
+
+    wf::signal::connection_t<wf::input_device_removed_signal> on_device_removed =
+        [=] (wf::input_device_removed_signal *ev)
+    {
+        pending.erase(ev->device->get_wlr_handle());
+    };
+
+    /**
+     * Start measuring the input latency. The results of previous measurements are discarded.
+     */
+    wf::ipc::method_callback start_latency = [=] (const nlohmann::json&)
+    {
+        start_tracking();
+        return wf::ipc::json_ok();
+    };
+
+    wf::ipc::method_callback stop_latency = [=] (const nlohmann::json&)
+    {
+        stop_tracking();
+        return wf::ipc::json_ok();
+    };
+
+    /**
+     * Report the latency measured for each input device, in microseconds.
+     *
+     * Times are given from the hardware timestamp of the event (from-event) and from its arrival in the
+     * compositor (from-arrival), separately for events delivered to clients and for compositor-driven
+     * effects. The histogram is of the from-event times.
+     */
+    wf::ipc::method_callback get_latency = [=] (const nlohmann::json&)
+    {
+        auto response = wf::ipc::json_ok();
+        response["running"] = tracking;
+        response["devices"] = nlohmann::json::array();
+        for (auto& [device, device_stats] : stats)
+        {
+            nlohmann::json d;
+            d["id"]   = (intptr_t)device;
+            d["name"] = device_stats.name;
+            d["client"]     = samples_to_json(device_stats.client);
+            d["compositor"] = samples_to_json(device_stats.compositor);
+            d["dropped"]    = device_stats.dropped;
+            response["devices"].push_back(d);
+        }
+
+        return response;
+    };
+};
+}
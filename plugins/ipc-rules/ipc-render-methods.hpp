@@ -0,0 +1,379 @@
+#pragma once
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include "plugins/ipc/ipc-helpers.hpp"
+#include "wayfire/core.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <algorithm>
+
+namespace wf
+{
+class ipc_rules_render_methods_t
+{
+  public:
+    void init_render_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->register_method("render/frame-stats", get_frame_stats);
+        method_repository->register_method("render/framebuffer-pool", get_framebuffer_pool);
+        method_repository->register_method("render/benchmark-start", start_benchmark);
+        method_repository->register_method("render/benchmark-stop", stop_benchmark);
+        method_repository->register_method("render/benchmark-stats", get_benchmark_stats);
+        method_repository->register_method("debug/gpu-memory", get_gpu_memory);
+        method_repository->register_method("debug/damage-heatmap", set_damage_heatmap);
+        method_repository->register_method("debug/damage-report", get_damage_report);
+        method_repository->register_method("debug/gl-checks", get_gl_checks);
+    }
+
+    void fini_render_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->unregister_method("render/frame-stats");
+        method_repository->unregister_method("render/framebuffer-pool");
+        method_repository->unregister_method("render/benchmark-start");
+        method_repository->unregister_method("render/benchmark-stop");
+        method_repository->unregister_method("render/benchmark-stats");
+        method_repository->unregister_method("debug/gpu-memory");
+        method_repository->unregister_method("debug/damage-heatmap");
+        method_repository->unregister_method("debug/damage-report");
+        method_repository->unregister_method("debug/gl-checks");
+    }
+
+    static std::string frame_stage_to_string(wf::frame_stage_t stage)
+    {
+        switch (stage)
+        {
+          case wf::FRAME_STAGE_UPDATE:
+            return "update";
+
+          case wf::FRAME_STAGE_SCHEDULE:
+            return "schedule";
+
+          case wf::FRAME_STAGE_RENDER:
+            return "render";
+
+          case wf::FRAME_STAGE_POSTPROCESS:
+            return "postprocess";
+
+          case wf::FRAME_STAGE_SWAP:
+            return "swap";
+
+          case wf::FRAME_STAGE_GPU:
+            return "gpu";
+
+          default:
+            return "unknown";
+        }
+    }
+
+    static nlohmann::json frame_stats_to_json(wf::output_t *output)
+    {
+        auto stats = output->render->get_frame_stats();
+
+        nlohmann::json j;
+        j["output-id"]    = output->get_id();
+        j["output-name"]  = output->to_string();
+        j["total-frames"] = stats.total_frames;
+        j["gpu-timer-supported"] = stats.gpu_timer_supported;
+        for (int i = 0; i < wf::FRAME_STAGE_TOTAL; i++)
+        {
+            const auto& stage = stats.stages[i];
+            auto& s = j["stages"][frame_stage_to_string((wf::frame_stage_t)i)];
+            s["samples"] = stage.samples;
+            s["p50"] = stage.p50;
+            s["p95"] = stage.p95;
+            s["p99"] = stage.p99;
+            s["max"] = stage.max;
+        }
+
+        j["repaint"]["delay-ms"] = stats.repaint_delay;
+        j["repaint"]["predicted-render"] = stats.predicted_render_us;
+        j["repaint"]["last-margin"]    = stats.last_margin_us;
+        j["repaint"]["average-margin"] = stats.average_margin_us;
+        j["repaint"]["late-frames"]    = stats.late_frames;
+        j["damage"]["simplified-frames"] = stats.damage_simplified_frames;
+        j["damage"]["added-area"] = stats.damage_simplify_added_area;
+        j["cursor"]["cursor-only-frames"] = stats.cursor_only_frames;
+        j["cursor"]["plane-commits"] = stats.cursor_plane_commits;
+        j["frame-allocations"]    = stats.frame_allocations;
+        j["render-instances"]     = stats.render_instances;
+        j["direct-scanout"]       = stats.direct_scanout;
+        return j;
+    }
+
+    /**
+     * Report frame timing statistics (in microseconds) for the given output, or for all outputs if no
+     * output-id is given.
+     */
+    wf::ipc::method_callback get_frame_stats = [=] (const nlohmann::json& data)
+    {
+        WFJSON_OPTIONAL_FIELD(data, "output-id", number_unsigned);
+
+        auto response = wf::ipc::json_ok();
+        response["outputs"] = nlohmann::json::array();
+        if (data.contains("output-id"))
+        {
+            auto wo = wf::ipc::find_output_by_id(data["output-id"]);
+            if (!wo)
+            {
+                return wf::ipc::json_error("output not found");
+            }
+
+            response["outputs"].push_back(frame_stats_to_json(wo));
+            return response;
+        }
+
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            response["outputs"].push_back(frame_stats_to_json(wo));
+        }
+
+        return response;
+    };
+
+    /**
+     * Report the usage statistics of the pool of released framebuffers.
+     */
+    wf::ipc::method_callback get_framebuffer_pool = [=] (const nlohmann::json& data)
+    {
+        auto stats    = OpenGL::get_framebuffer_pool_stats();
+        auto response = wf::ipc::json_ok();
+        response["pooled-bytes"]   = stats.pooled_bytes;
+        response["pooled-buffers"] = stats.pooled_buffers;
+        response["hits"]   = stats.hits;
+        response["misses"] = stats.misses;
+        response["evictions"] = stats.evictions;
+        const uint64_t total = stats.hits + stats.misses;
+        response["hit-rate"] = total ? (double)stats.hits / total : 0.0;
+        return response;
+    };
+
+    /**
+     * Show or hide the damage heatmap on all outputs (see render_manager::set_damage_heatmap()). While it is
+     * shown, the damage reported by each node is recorded for debug/damage-report.
+     */
+    wf::ipc::method_callback set_damage_heatmap = [=] (const nlohmann::json& data)
+    {
+        WFJSON_EXPECT_FIELD(data, "enabled", boolean);
+        const bool enabled = data["enabled"];
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            output->render->set_damage_heatmap(enabled);
+        }
+
+        wf::scene::set_damage_attribution(enabled);
+        return wf::ipc::json_ok();
+    };
+
+    /**
+     * List the nodes which reported the most damaged area while the damage heatmap was shown, at most @limit
+     * of them (20 by default). With @reset set to true, the recorded damage is dropped afterwards.
+     */
+    wf::ipc::method_callback get_damage_report = [=] (const nlohmann::json& data)
+    {
+        WFJSON_OPTIONAL_FIELD(data, "limit", number_unsigned);
+        WFJSON_OPTIONAL_FIELD(data, "reset", boolean);
+        const size_t limit = data.contains("limit") ? (size_t)data["limit"] : 20;
+
+        auto response = wf::ipc::json_ok();
+        response["nodes"] = nlohmann::json::array();
+        uint64_t total = 0;
+        for (auto& stats : wf::scene::get_damage_attribution())
+        {
+            total += stats.area;
+            if (response["nodes"].size() < limit)
+            {
+                nlohmann::json entry;
+                entry["node"]    = stats.node;
+                entry["area"]    = stats.area;
+                entry["reports"] = stats.reports;
+                response["nodes"].push_back(std::move(entry));
+            }
+        }
+
+        response["total-area"] = total;
+        if (data.value("reset", false))
+        {
+            wf::scene::reset_damage_attribution();
+        }
+
+        return response;
+    };
+
+    /**
+     * Report the statistics of the GL error checks and, if core/gl_state_tracking is enabled, the number of
+     * redundant state changes per tracked frame. With @reset set to true, the statistics are reset afterwards.
+     */
+    wf::ipc::method_callback get_gl_checks = [=] (const nlohmann::json& data)
+    {
+        WFJSON_OPTIONAL_FIELD(data, "reset", boolean);
+
+        auto stats    = OpenGL::get_gl_check_stats();
+        auto response = wf::ipc::json_ok();
+        response["frames"] = stats.frames;
+        response["errors"]["checked-frames"] = stats.checked_frames;
+        response["errors"]["checked-calls"]  = stats.checked_calls;
+        response["errors"]["errors"]     = stats.errors;
+        response["errors"]["suppressed"] = stats.suppressed_errors;
+        response["state"]["tracked-frames"] = stats.tracked_frames;
+
+        auto add_state = [&] (const std::string& name, uint64_t changes, uint64_t redundant)
+        {
+            auto& entry = response["state"][name];
+            entry["total"]     = changes;
+            entry["redundant"] = redundant;
+            entry["redundant-per-frame"] = stats.tracked_frames ? (double)redundant / stats.tracked_frames : 0.0;
+        };
+
+        add_state("program-binds", stats.program_binds, stats.redundant_program_binds);
+        add_state("texture-binds", stats.texture_binds, stats.redundant_texture_binds);
+        add_state("framebuffer-binds", stats.framebuffer_binds, stats.redundant_framebuffer_binds);
+        add_state("uniform-sets", stats.uniform_sets, stats.redundant_uniform_sets);
+
+        if (data.value("reset", false))
+        {
+            OpenGL::reset_gl_check_stats();
+        }
+
+        return response;
+    };
+
+    /**
+     * Report the GPU memory allocated by the compositor and its plugins, by owner and largest first, and the
+     * estimated size of the buffers of the clients' main surfaces. At most @limit entries are listed in
+     * each category (20 by default).
+     */
+    wf::ipc::method_callback get_gpu_memory = [=] (const nlohmann::json& data)
+    {
+        WFJSON_OPTIONAL_FIELD(data, "limit", number_unsigned);
+        const size_t limit = data.contains("limit") ? (size_t)data["limit"] : 20;
+
+        auto response = wf::ipc::json_ok();
+        response["consumers"] = nlohmann::json::array();
+        uint64_t total = 0;
+        for (auto& usage : OpenGL::get_gpu_memory_usage())
+        {
+            total += usage.bytes;
+            if (response["consumers"].size() < limit)
+            {
+                nlohmann::json entry;
+                entry["owner"]    = usage.owner.name;
+                entry["view-id"]  = usage.owner.view_id;
+                entry["output"]   = usage.owner.output;
+                entry["bytes"]    = usage.bytes;
+                entry["textures"] = usage.textures;
+                response["consumers"].push_back(std::move(entry));
+            }
+        }
+
+        response["total-bytes"] = total;
+
+        std::vector<std::pair<uint64_t, wayfire_view>> client_buffers;
+        uint64_t client_total = 0;
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            auto surface = view->get_wlr_surface();
+            if (surface && surface->buffer)
+            {
+                const uint64_t bytes = uint64_t(surface->buffer->base.width) * surface->buffer->base.height * 4;
+                client_buffers.push_back({bytes, view});
+                client_total += bytes;
+            }
+        }
+
+        std::sort(client_buffers.begin(), client_buffers.end(), [] (const auto& a, const auto& b)
+        {
+            return a.first > b.first;
+        });
+        response["client-buffers"] = nlohmann::json::array();
+        for (size_t i = 0; i < std::min(limit, client_buffers.size()); i++)
+        {
+            nlohmann::json entry;
+            entry["view-id"] = client_buffers[i].second->get_id();
+            entry["app-id"]  = client_buffers[i].second->get_app_id();
+            entry["bytes"]   = client_buffers[i].first;
+            response["client-buffers"].push_back(std::move(entry));
+        }
+
+        response["client-buffers-total-bytes"] = client_total;
+        return response;
+    };
+
+    static nlohmann::json synthetic_frame_stats_to_json(wf::output_t *output)
+    {
+        auto stats    = output->render->get_synthetic_frame_stats();
+        auto response = wf::ipc::json_ok();
+        response["output-id"]   = output->get_id();
+        response["running"]     = stats.running;
+        response["rate"]        = stats.rate;
+        response["frames"]      = stats.frames;
+        response["duration-us"] = stats.duration;
+        response["fps"] = stats.fps;
+        response["frame-interval"]["p50"] = stats.interval_p50;
+        response["frame-interval"]["p95"] = stats.interval_p95;
+        response["frame-interval"]["p99"] = stats.interval_p99;
+        response["frame-interval"]["max"] = stats.interval_max;
+        return response;
+    }
+
+    /**
+     * Start driving the frames of a headless output for a throughput benchmark: the output is repainted at
+     * the given rate (in Hz), or as fast as possible if no rate is given.
+     */
+    wf::ipc::method_callback start_benchmark = [=] (const nlohmann::json& data)
+    {
+        WFJSON_EXPECT_FIELD(data, "output-id", number_unsigned);
+        WFJSON_OPTIONAL_FIELD(data, "rate", number_unsigned);
+
+        auto wo = wf::ipc::find_output_by_id(data["output-id"]);
+        if (!wo)
+        {
+            return wf::ipc::json_error("output not found");
+        }
+
+        if (!wlr_output_is_headless(wo->handle))
+        {
+            return wf::ipc::json_error("benchmarks are only supported on headless outputs");
+        }
+
+        const int rate = data.contains("rate") ? (int)data["rate"] : 0;
+        wo->render->set_synthetic_frame_driver(true, rate);
+        return wf::ipc::json_ok();
+    };
+
+    /**
+     * Stop the benchmark on the given output and report its results.
+     */
+    wf::ipc::method_callback stop_benchmark = [=] (const nlohmann::json& data)
+    {
+        WFJSON_EXPECT_FIELD(data, "output-id", number_unsigned);
+        auto wo = wf::ipc::find_output_by_id(data["output-id"]);
+        if (!wo)
+        {
+            return wf::ipc::json_error("output not found");
+        }
+
+        auto response = synthetic_frame_stats_to_json(wo);
+        wo->render->set_synthetic_frame_driver(false);
+        return response;
+    };
+
+    /**
+     * Report the results of the benchmark on the given output so far.
+     */
+    wf::ipc::method_callback get_benchmark_stats = [=] (const nlohmann::json& data)
+    {
+        WFJSON_EXPECT_FIELD(data, "output-id", number_unsigned);
+        auto wo = wf::ipc::find_output_by_id(data["output-id"]);
+        if (!wo)
+        {
+            return wf::ipc::json_error("output not found");
+        }
+
+        return synthetic_frame_stats_to_json(wo);
+    };
+};
+}
@@ -9,17 +9,26 @@
 #include "wayfire/core.hpp"
 #include "wayfire/plugins/common/shared-core-data.hpp"
 #include "wayfire/window-manager.hpp"
+#include "wayfire/unstable/wlr-surface-node.hpp"
 #include <wayfire/debug.hpp>
 
 #include "ipc-rules-common.hpp"
 #include "ipc-input-methods.hpp"
 #include "ipc-utility-methods.hpp"
+#include "ipc-render-methods.hpp"
+#include "ipc-txn-methods.hpp"
 #include "ipc-events.hpp"
+#include "ipc-view-cache.hpp"
+#include "ipc-snapshot.hpp"
+#include "ipc-input-latency.hpp"
 
 class ipc_rules_t : public wf::plugin_interface_t,
     public wf::ipc_rules_input_methods_t,
     public wf::ipc_rules_utility_methods_t,
-    public wf::ipc_rules_events_methods_t
+    public wf::ipc_rules_render_methods_t,
+    public wf::ipc_rules_txn_methods_t,
+    public wf::ipc_rules_events_methods_t,
+    public wf::ipc_rules_latency_methods_t
 {
   public:
     void init() override
@@ -28,6 +37,7 @@ class ipc_rules_t : public wf::plugin_interface_t,
         method_repository->register_method("window-rules/list-outputs", list_outputs);
         method_repository->register_method("window-rules/list-wsets", list_wsets);
         method_repository->register_method("window-rules/view-info", get_view_info);
+        method_repository->register_method("window-rules/view-stats", get_view_stats);
         method_repository->register_method("window-rules/output-info", get_output_info);
         method_repository->register_method("window-rules/wset-info", get_wset_info);
         method_repository->register_method("window-rules/configure-view", configure_view);
@@ -38,7 +48,12 @@ class ipc_rules_t : public wf::plugin_interface_t,
 
         init_input_methods(method_repository.get());
         init_utility_methods(method_repository.get());
+        init_render_methods(method_repository.get());
+        init_txn_methods(method_repository.get());
         init_events(method_repository.get());
+        view_cache.init();
+        snapshot_writer.init_snapshot(method_repository.get());
+        init_latency_methods(method_repository.get());
     }
 
     void fini() override
@@ -47,6 +62,7 @@ class ipc_rules_t : public wf::plugin_interface_t,
         method_repository->unregister_method("window-rules/list-outputs");
         method_repository->unregister_method("window-rules/list-wsets");
         method_repository->unregister_method("window-rules/view-info");
+        method_repository->unregister_method("window-rules/view-stats");
         method_repository->unregister_method("window-rules/output-info");
         method_repository->unregister_method("window-rules/wset-info");
         method_repository->unregister_method("window-rules/configure-view");
@@ -57,19 +73,56 @@ class ipc_rules_t : public wf::plugin_interface_t,
 
         fini_input_methods(method_repository.get());
         fini_utility_methods(method_repository.get());
+        fini_render_methods(method_repository.get());
+        fini_txn_methods(method_repository.get());
         fini_events(method_repository.get());
+        view_cache.fini();
+        snapshot_writer.fini_snapshot(method_repository.get());
+        fini_latency_methods(method_repository.get());
     }
 
-    wf::ipc::method_callback list_views = [=] (nlohmann::json)
+    wf::ipc_view_description_cache_t view_cache;
+    wf::ipc_snapshot_writer_t snapshot_writer;
+
+    /**
+     * List all views. Without arguments, the result is a list of view descriptions.
+     *
+     * If the optional argument since is given, the result is an object with the current version, the ids of
+     * all views, and the descriptions of the views which changed after the given version. Clients can pass
+     * the version of their last call to skip unchanged views.
+     */
+    wf::ipc::method_callback list_views = [=] (nlohmann::json data)
     {
-        auto response = nlohmann::json::array();
+        WFJSON_OPTIONAL_FIELD(data, "since", number_unsigned);
+        auto views = wf::get_core().get_all_views();
+        view_cache.retain_only(views);
+        if (!data.contains("since"))
+        {
+            auto response = nlohmann::json::array();
+            for (auto& view : views)
+            {
+                response.push_back(view_cache.get(view));
+            }
 
-        for (auto& view : wf::get_core().get_all_views())
+            return response;
+        }
+
+        const uint64_t since = data["since"];
+        auto response = wf::ipc::json_ok();
+        response["ids"]   = nlohmann::json::array();
+        response["views"] = nlohmann::json::array();
+        for (auto& view : views)
         {
-            nlohmann::json v = view_to_json(view);
-            response.push_back(v);
+            uint64_t version;
+            auto& description = view_cache.get(view, &version);
+            response["ids"].push_back(view->get_id());
+            if (version > since)
+            {
+                response["views"].push_back(description);
+            }
         }
 
+        response["version"] = view_cache.get_current_version();
         return response;
     };
 
@@ -79,7 +132,53 @@ class ipc_rules_t : public wf::plugin_interface_t,
         if (auto view = wf::ipc::find_view_by_id(data["id"]))
         {
             auto response = wf::ipc::json_ok();
-            response["info"] = view_to_json(view);
+            response["info"] = view_cache.get(view);
+            return response;
+        }
+
+        return wf::ipc::json_error("no such view");
+    };
+
+    static void collect_surface_stats(wf::scene::node_ptr node, nlohmann::json& surfaces)
+    {
+        if (auto surface = dynamic_cast<wf::scene::wlr_surface_node_t*>(node.get()))
+        {
+            auto stats = surface->get_stats();
+            nlohmann::json s;
+            s["commits"] = stats.commits;
+            s["commits-per-second"] = stats.commits_per_second;
+            s["damaged-area"] = stats.damaged_area;
+            s["damage-per-commit"] = stats.commits ? (double)stats.damaged_area / stats.commits : 0.0;
+            s["buffer"]["width"]   = stats.buffer_size.width;
+            s["buffer"]["height"]  = stats.buffer_size.height;
+            s["buffer"]["format"]  = stats.buffer_format;
+            s["buffer"]["dmabuf"]  = stats.dmabuf;
+            s["buffer"]["partial-uploads"] = stats.partial_uploads;
+            s["buffer"]["full-uploads"]    = stats.full_uploads;
+            s["scanout-frames"]    = stats.scanout_frames;
+            s["renders"] = stats.renders;
+            s["render-time-us"] = stats.render_time_us;
+            surfaces.push_back(s);
+        }
+
+        for (auto& ch : node->get_children())
+        {
+            collect_surface_stats(ch, surfaces);
+        }
+    }
+
+    /**
+     * Report commit, damage and rendering statistics for all surfaces (the main surface and subsurfaces, in
+     * scenegraph order) of the given view.
+     */
+    wf::ipc::method_callback get_view_stats = [=] (nlohmann::json data)
+    {
+        WFJSON_EXPECT_FIELD(data, "id", number_integer);
+        if (auto view = wf::ipc::find_view_by_id(data["id"]))
+        {
+            auto response = wf::ipc::json_ok();
+            response["surfaces"] = nlohmann::json::array();
+            collect_surface_stats(view->get_surface_root_node(), response["surfaces"]);
             return response;
         }
 
@@ -0,0 +1,444 @@
+#pragma once
+
+#include "ipc-rules-common.hpp"
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/per-output-plugin.hpp>
+#include <wayfire/seat.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/toplevel-view.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace wf
+{
+/**
+ * The layout of the shared memory snapshot returned by window-rules/snapshot.
+ *
+ * The memory starts with a header_t, followed by max_views view_t and max_outputs output_t entries at the
+ * given offsets. All fields are in host byte order, strings are NUL-terminated and truncated if necessary.
+ *
+ * The snapshot is protected by a seqlock: the compositor makes @sequence odd before changing the snapshot
+ * and even again afterwards. Readers copy the data they need, and retry if @sequence was odd or changed
+ * in the meantime.
+ */
+namespace snapshot
+{
+static constexpr uint32_t MAGIC = 0x57465353; // "WFSS"
+static constexpr uint32_t LAYOUT_VERSION = 1;
+static constexpr uint32_t MAX_VIEWS   = 512;
+static constexpr uint32_t MAX_OUTPUTS = 16;
+
+enum header_flags_t : uint32_t
+{
+    // Not all views or outputs fit in the snapshot
+    SNAPSHOT_TRUNCATED = (1 << 0),
+};
+
+enum view_flags_t : uint32_t
+{
+    VIEW_MAPPED     = (1 << 0),
+    VIEW_MINIMIZED  = (1 << 1),
+    VIEW_FULLSCREEN = (1 << 2),
+    VIEW_ACTIVATED  = (1 << 3),
+    VIEW_STICKY     = (1 << 4),
+    VIEW_FOCUSABLE  = (1 << 5),
+};
+
+struct header_t
+{
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t sequence;
+    // Increased on every change of the snapshot
+    uint64_t generation;
+    uint32_t view_count;
+    uint32_t output_count;
+    uint32_t max_views;
+    uint32_t max_outputs;
+    uint32_t views_offset;
+    uint32_t outputs_offset;
+    // 0 if no view / output is focused
+    uint32_t focused_view_id;
+    uint32_t focused_output_id;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct view_t
+{
+    uint32_t id;
+    int32_t pid;
+    // 0 if the view has no output, -1 if it has no workspace set
+    uint32_t output_id;
+    int32_t wset_index;
+    // The same as "geometry" in window-rules/view-info
+    int32_t x, y, width, height;
+    uint32_t tiled_edges;
+    uint32_t flags;
+    // wf::view_role_t and wf::scene::layer, UINT32_MAX if the view is in no layer
+    uint32_t role;
+    uint32_t layer;
+    uint64_t last_focus_timestamp;
+    char app_id[64];
+    char title[128];
+};
+
+struct output_t
+{
+    uint32_t id;
+    int32_t x, y, width, height;
+    int32_t wset_index;
+    int32_t workspace_x, workspace_y;
+    int32_t grid_width, grid_height;
+    char name[32];
+};
+}
+
+/**
+ * Maintains the shared memory snapshot of the compositor state for window-rules/snapshot.
+ *
+ * Nothing is done until the first client requests the snapshot. Afterwards, the snapshot is refreshed at most
+ * once per event loop iteration after a signal reported a change of the views or outputs, and only written
+ * (and its generation increased) if its contents actually changed. Nothing is done while nothing changes.
+ */
+class ipc_snapshot_writer_t : public wf::per_output_tracker_mixin_t<>
+{
+  public:
+    void init_snapshot(ipc::method_repository_t *method_repository)
+    {
+        method_repository->register_method("window-rules/snapshot", get_snapshot);
+        method_repository->connect(&on_client_disconnected);
+    }
+
+    void fini_snapshot(ipc::method_repository_t *method_repository)
+    {
+        method_repository->unregister_method("window-rules/snapshot");
+        on_client_disconnected.disconnect();
+        stop();
+    }
+
+  private:
+    static constexpr size_t VIEWS_OFFSET   = sizeof(snapshot::header_t);
+    static constexpr size_t OUTPUTS_OFFSET = VIEWS_OFFSET + snapshot::MAX_VIEWS * sizeof(snapshot::view_t);
+    static constexpr size_t SNAPSHOT_SIZE  = OUTPUTS_OFFSET +
+        snapshot::MAX_OUTPUTS * sizeof(snapshot::output_t);
+
+    int memfd = -1;
+    char *memory = nullptr;
+    std::set<wf::ipc::client_interface_t*> clients;
+    // The contents of the snapshot after the header are built here, and compared with the shared memory to
+    // detect changes.
+    std::vector<char> contents;
+    wf::wl_idle_call idle_update;
+
+    /**
+     * Get a file descriptor for the snapshot, sent with the response. Map it read-only with the returned size.
+     */
+    wf::ipc::method_callback_full get_snapshot = [=] (nlohmann::json, wf::ipc::client_interface_t *client)
+    {
+        if (!start())
+        {
+            return wf::ipc::json_error("Failed to create the snapshot");
+        }
+
+        if (!client || !client->attach_fd(memfd))
+        {
+            return wf::ipc::json_error("The client does not support file descriptor passing");
+        }
+
+        clients.insert(client);
+        auto response = wf::ipc::json_ok();
+        response["size"] = SNAPSHOT_SIZE;
+        response["layout-version"] = snapshot::LAYOUT_VERSION;
+        return response;
+    };
+
+    wf::signal::connection_t<wf::ipc::client_disconnected_signal> on_client_disconnected =
+        [=] (wf::ipc::client_disconnected_signal *ev)
+    {
+        if (clients.erase(ev->client) && clients.empty())
+        {
+            stop();
+        }
+    };
+
+    bool start()
+    {
+        if (memfd >= 0)
+        {
+            return true;
+        }
+
+        memfd = memfd_create("wayfire-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if ((memfd < 0) || (ftruncate(memfd, SNAPSHOT_SIZE) < 0))
+        {
+            LOGE("Failed to create the IPC snapshot: ", strerror(errno));
+            stop();
+            return false;
+        }
+
+        void *mapped = mmap(nullptr, SNAPSHOT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            LOGE("Failed to map the IPC snapshot: ", strerror(errno));
+            stop();
+            return false;
+        }
+
+        memory = (char*)mapped;
+        // Clients must not be able to resize or write to the snapshot.
+        int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+        seals |= F_SEAL_FUTURE_WRITE;
+#endif
+        fcntl(memfd, F_ADD_SEALS, seals);
+
+        auto header = (snapshot::header_t*)memory;
+        header->magic = snapshot::MAGIC;
+        header->layout_version = snapshot::LAYOUT_VERSION;
+        header->max_views     = snapshot::MAX_VIEWS;
+        header->max_outputs   = snapshot::MAX_OUTPUTS;
+        header->views_offset  = VIEWS_OFFSET;
+        header->outputs_offset = OUTPUTS_OFFSET;
+
+        contents.resize(SNAPSHOT_SIZE - VIEWS_OFFSET);
+        init_output_tracking();
+        wf::get_core().connect(&on_view_changed);
+        wf::get_core().connect(&on_title_changed);
+        wf::get_core().connect(&on_app_id_changed);
+        wf::get_core().connect(&on_view_mapped);
+        wf::get_core().connect(&on_view_unmapped);
+        wf::get_core().connect(&on_view_set_output);
+        wf::get_core().connect(&on_view_moved_to_wset);
+        wf::get_core().connect(&on_focus_changed);
+        wf::get_core().output_layout->connect(&on_layout_changed);
+        update();
+        return true;
+    }
+
+    void stop()
+    {
+        if (memory)
+        {
+            fini_output_tracking();
+            on_view_changed.disconnect();
+            on_title_changed.disconnect();
+            on_app_id_changed.disconnect();
+            on_view_mapped.disconnect();
+            on_view_unmapped.disconnect();
+            on_view_set_output.disconnect();
+            on_view_moved_to_wset.disconnect();
+            on_focus_changed.disconnect();
+            on_layout_changed.disconnect();
+            on_minimized.disconnect();
+            on_fullscreen.disconnect();
+            on_tiled.disconnect();
+            on_sticky.disconnect();
+            on_workspace_changed.disconnect();
+            on_wset_changed.disconnect();
+            on_output_changed.disconnect();
+            on_grid_changed.disconnect();
+            idle_update.disconnect();
+            munmap(memory, SNAPSHOT_SIZE);
+            memory = nullptr;
+        }
+
+        if (memfd >= 0)
+        {
+            close(memfd);
+            memfd = -1;
+        }
+
+        clients.clear();
+        contents.clear();
+        contents.shrink_to_fit();
+    }
+
+    void handle_new_output(wf::output_t *output) override
+    {
+        // The connections are disconnected from the output when it is destroyed.
+        output->connect(&on_minimized);
+        output->connect(&on_fullscreen);
+        output->connect(&on_tiled);
+        output->connect(&on_sticky);
+        output->connect(&on_workspace_changed);
+        output->connect(&on_wset_changed);
+        output->connect(&on_output_changed);
+        watch_grid(output->wset().get());
+        schedule_update();
+    }
+
+    void handle_output_removed(wf::output_t *output) override
+    {
+        schedule_update();
+    }
+
+    void watch_grid(wf::workspace_set_t *wset)
+    {
+        // Workspace sets can be shown on an output again, connect only once.
+        wset->disconnect(&on_grid_changed);
+        wset->connect(&on_grid_changed);
+    }
+
+    void schedule_update()
+    {
+        idle_update.run_once([=] () { update(); });
+    }
+
+    static void copy_string(char *dst, size_t size, const std::string& src)
+    {
+        const size_t len = std::min(size - 1, src.size());
+        std::memcpy(dst, src.data(), len);
+        std::memset(dst + len, 0, size - len);
+    }
+
+    void update()
+    {
+        std::fill(contents.begin(), contents.end(), 0);
+        auto views   = (snapshot::view_t*)contents.data();
+        auto outputs = (snapshot::output_t*)(contents.data() + OUTPUTS_OFFSET - VIEWS_OFFSET);
+
+        uint32_t flags = 0;
+        uint32_t view_count = 0;
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            if (view_count == snapshot::MAX_VIEWS)
+            {
+                flags |= snapshot::SNAPSHOT_TRUNCATED;
+                break;
+            }
+
+            auto toplevel = wf::toplevel_cast(view);
+            auto layer    = wf::get_view_layer(view);
+            auto geometry = toplevel ? toplevel->get_pending_geometry() : view->get_bounding_box();
+            auto& entry   = views[view_count++];
+            entry.id  = view->get_id();
+            entry.pid = get_view_pid(view);
+            entry.output_id  = view->get_output() ? view->get_output()->get_id() : 0;
+            entry.wset_index = (toplevel && toplevel->get_wset()) ? toplevel->get_wset()->get_index() : -1;
+            entry.x      = geometry.x;
+            entry.y      = geometry.y;
+            entry.width  = geometry.width;
+            entry.height = geometry.height;
+            entry.tiled_edges = toplevel ? toplevel->pending_tiled_edges() : 0;
+            entry.flags = (view->is_mapped() ? snapshot::VIEW_MAPPED : 0) |
+                (view->is_focusable() ? snapshot::VIEW_FOCUSABLE : 0);
+            if (toplevel)
+            {
+                entry.flags |= (toplevel->minimized ? snapshot::VIEW_MINIMIZED : 0) |
+                    (toplevel->pending_fullscreen() ? snapshot::VIEW_FULLSCREEN : 0) |
+                    (toplevel->activated ? snapshot::VIEW_ACTIVATED : 0) |
+                    (toplevel->sticky ? snapshot::VIEW_STICKY : 0);
+            }
+
+            entry.role  = view->role;
+            entry.layer = layer ? (uint32_t)*layer : UINT32_MAX;
+            entry.last_focus_timestamp = wf::get_focus_timestamp(view);
+            copy_string(entry.app_id, sizeof(entry.app_id), view->get_app_id());
+            copy_string(entry.title, sizeof(entry.title), view->get_title());
+        }
+
+        uint32_t output_count = 0;
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            if (output_count == snapshot::MAX_OUTPUTS)
+            {
+                flags |= snapshot::SNAPSHOT_TRUNCATED;
+                break;
+            }
+
+            auto geometry = wo->get_layout_geometry();
+            auto& entry   = outputs[output_count++];
+            entry.id     = wo->get_id();
+            entry.x      = geometry.x;
+            entry.y      = geometry.y;
+            entry.width  = geometry.width;
+            entry.height = geometry.height;
+            entry.wset_index  = wo->wset()->get_index();
+            entry.workspace_x = wo->wset()->get_current_workspace().x;
+            entry.workspace_y = wo->wset()->get_current_workspace().y;
+            entry.grid_width  = wo->wset()->get_workspace_grid_size().width;
+            entry.grid_height = wo->wset()->get_workspace_grid_size().height;
+            copy_string(entry.name, sizeof(entry.name), wo->to_string());
+        }
+
+        auto focus_view   = wf::get_core().seat->get_active_view();
+        auto focus_output = wf::get_core().seat->get_active_output();
+        const uint32_t focused_view_id   = focus_view ? focus_view->get_id() : 0;
+        const uint32_t focused_output_id = focus_output ? focus_output->get_id() : 0;
+
+        auto header = (snapshot::header_t*)memory;
+        if (!std::memcmp(memory + VIEWS_OFFSET, contents.data(), contents.size()) &&
+            (header->view_count == view_count) &&
+            (header->output_count == output_count) && (header->flags == flags) &&
+            (header->focused_view_id == focused_view_id) && (header->focused_output_id == focused_output_id))
+        {
+            return;
+        }
+
+        // Seqlock write: an odd sequence number tells readers that the snapshot is being changed.
+        __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        std::memcpy(memory + VIEWS_OFFSET, contents.data(), contents.size());
+        header->view_count   = view_count;
+        header->output_count = output_count;
+        header->flags = flags;
+        header->focused_view_id   = focused_view_id;
+        header->focused_output_id = focused_output_id;
+        header->generation++;
+        __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELEASE);
+    }
+
+    wf::signal::connection_t<wf::view_geometry_changed_signal> on_view_changed =
+        [=] (wf::view_geometry_changed_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed =
+        [=] (wf::view_title_changed_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_app_id_changed_signal> on_app_id_changed =
+        [=] (wf::view_app_id_changed_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_mapped_signal> on_view_mapped =
+        [=] (wf::view_mapped_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_unmapped_signal> on_view_unmapped =
+        [=] (wf::view_unmapped_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_set_output_signal> on_view_set_output =
+        [=] (wf::view_set_output_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_moved_to_wset_signal> on_view_moved_to_wset =
+        [=] (wf::view_moved_to_wset_signal*) { schedule_update(); };
+    // Activation and focus timestamps change together with the keyboard focus.
+    wf::signal::connection_t<wf::keyboard_focus_changed_signal> on_focus_changed =
+        [=] (wf::keyboard_focus_changed_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::output_layout_configuration_changed_signal> on_layout_changed =
+        [=] (wf::output_layout_configuration_changed_signal*) { schedule_update(); };
+
+    // Connected to every output
+    wf::signal::connection_t<wf::view_minimized_signal> on_minimized =
+        [=] (wf::view_minimized_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_fullscreen_signal> on_fullscreen =
+        [=] (wf::view_fullscreen_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_tiled_signal> on_tiled =
+        [=] (wf::view_tiled_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::view_set_sticky_signal> on_sticky =
+        [=] (wf::view_set_sticky_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::workspace_changed_signal> on_workspace_changed =
+        [=] (wf::workspace_changed_signal*) { schedule_update(); };
+    wf::signal::connection_t<wf::workspace_set_changed_signal> on_wset_changed =
+        [=] (wf::workspace_set_changed_signal *ev)
+    {
+        watch_grid(ev->new_wset.get());
+        schedule_update();
+    };
+    wf::signal::connection_t<wf::output_configuration_changed_signal> on_output_changed =
+        [=] (wf::output_configuration_changed_signal*) { schedule_update(); };
+    // Connected to the workspace sets which were shown on an output
+    wf::signal::connection_t<wf::workspace_grid_changed_signal> on_grid_changed =
+        [=] (wf::workspace_grid_changed_signal*) { schedule_update(); };
+};
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include "plugins/ipc/ipc-helpers.hpp"
+#include "wayfire/core.hpp"
+#include <wayfire/txn/transaction-manager.hpp>
+
+namespace wf
+{
+class ipc_rules_txn_methods_t
+{
+  public:
+    void init_txn_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->register_method("txn/trace", get_transaction_trace);
+    }
+
+    void fini_txn_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->unregister_method("txn/trace");
+    }
+
+    static std::string transaction_event_to_string(wf::txn::transaction_event_t event)
+    {
+        switch (event)
+        {
+          case wf::txn::transaction_event_t::SCHEDULED:
+            return "scheduled";
+
+          case wf::txn::transaction_event_t::MERGED:
+            return "merged";
+
+          case wf::txn::transaction_event_t::COMMITTED:
+            return "committed";
+
+          case wf::txn::transaction_event_t::OBJECT_READY:
+            return "object-ready";
+
+          case wf::txn::transaction_event_t::SPLIT:
+            return "split";
+
+          case wf::txn::transaction_event_t::APPLIED:
+            return "applied";
+
+          case wf::txn::transaction_event_t::TIMED_OUT:
+            return "timed-out";
+        }
+
+        return "unknown";
+    }
+
+    /**
+     * Dump the transaction trace (see core/transaction_trace_size) in the Chrome trace event format, which
+     * can be loaded in Perfetto or chrome://tracing. Each transaction is shown as a separate track, with an
+     * instant event for each step of its lifecycle.
+     */
+    wf::ipc::method_callback get_transaction_trace = [=] (const nlohmann::json&)
+    {
+        auto response = wf::ipc::json_ok();
+        response["traceEvents"] = nlohmann::json::array();
+        for (auto& entry : wf::get_core().tx_manager->get_trace())
+        {
+            nlohmann::json ev;
+            ev["name"] = transaction_event_to_string(entry.event);
+            ev["ph"]   = "i";
+            ev["s"]    = "t";
+            ev["ts"]   = entry.time_us;
+            ev["pid"]  = 0;
+            ev["tid"]  = (uint64_t)(uintptr_t)entry.tx;
+            if (entry.other_tx)
+            {
+                ev["args"]["into"] = (uint64_t)(uintptr_t)entry.other_tx;
+            }
+
+            if (entry.object[0])
+            {
+                ev["args"]["object"] = std::string(entry.object);
+            }
+
+            response["traceEvents"].push_back(std::move(ev));
+        }
+
+        response["displayTimeUnit"] = "ms";
+        return response;
+    };
+};
+}
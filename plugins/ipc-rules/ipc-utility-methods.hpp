@@ -3,10 +3,12 @@
 #include "ipc-rules-common.hpp"
 #include "plugins/ipc/ipc-method-repository.hpp"
 #include "wayfire/debug.hpp"
+#include <map>
 #include <set>
 #include <wayfire/plugin.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/output-layout.hpp>
+#include <wayfire/startup-profile.hpp>
 #include <wayfire/config/compound-option.hpp>
 
 extern "C" {
@@ -30,6 +32,8 @@ class ipc_rules_utility_methods_t
         method_repository->register_method("wayfire/destroy-headless-output", destroy_headless_output);
         method_repository->register_method("wayfire/get-config-option", get_config_option);
         method_repository->register_method("wayfire/set-config-options", set_config_options);
+        method_repository->register_method("wayfire/startup-profile", get_startup_profile);
+        method_repository->register_method("debug/log-ring", get_log_ring);
     }
 
     void fini_utility_methods(ipc::method_repository_t *method_repository)
@@ -39,6 +43,8 @@ class ipc_rules_utility_methods_t
         method_repository->unregister_method("wayfire/destroy-headless-output");
         method_repository->unregister_method("wayfire/get-config-option");
         method_repository->unregister_method("wayfire/set-config-option");
+        method_repository->unregister_method("wayfire/startup-profile");
+        method_repository->unregister_method("debug/log-ring");
     }
 
     wf::ipc::method_callback get_wayfire_configuration_info = [=] (nlohmann::json)
@@ -55,6 +61,46 @@ class ipc_rules_utility_methods_t
         return response;
     };
 
+    /**
+     * Format the messages recorded in the log ring. With the optional argument clear set to true, the ring
+     * is emptied afterwards, so that the next call only returns new messages.
+     */
+    wf::ipc::method_callback get_log_ring = [=] (nlohmann::json data)
+    {
+        WFJSON_OPTIONAL_FIELD(data, "clear", boolean);
+
+        nlohmann::json response = wf::ipc::json_ok();
+        response["messages"] = wf::log::ring::format_all();
+        if (data.value("clear", false))
+        {
+            wf::log::ring::clear();
+        }
+
+        return response;
+    };
+
+    wf::ipc::method_callback get_startup_profile = [=] (nlohmann::json)
+    {
+        nlohmann::json response = wf::ipc::json_ok();
+        response["recording"] = wf::startup_profile::is_recording();
+        response["events"]    = nlohmann::json::array();
+        std::map<std::string, double> totals;
+        for (auto& ev : wf::startup_profile::get_events())
+        {
+            nlohmann::json entry;
+            entry["category"]    = ev.category;
+            entry["name"]        = ev.name;
+            entry["start-ms"]    = ev.start_us / 1000.0;
+            entry["duration-ms"] = ev.duration_us / 1000.0;
+            response["events"].push_back(std::move(entry));
+            totals[ev.category] += ev.duration_us / 1000.0;
+        }
+
+        // Nested steps, like initializing a plugin while core loads the plugins, count in both categories.
+        response["total-ms"] = totals;
+        return response;
+    };
+
     wf::ipc::method_callback create_headless_output = [=] (const nlohmann::json& data)
     {
         WFJSON_EXPECT_FIELD(data, "width", number_unsigned);
@@ -243,6 +289,8 @@ class ipc_rules_utility_methods_t
             return wf::ipc::json_error("Options must be an object!");
         }
 
+        reload_config_signal event;
+        event.changes_known = true;
         for (auto& [option, value] : data.items())
         {
             auto opt = wf::get_core().config.get_option(option);
@@ -268,9 +316,11 @@ class ipc_rules_utility_methods_t
             }
 
             opt->set_locked(true);
+            auto slash = option.find('/');
+            event.add_changed_option(option.substr(0, slash),
+                (slash == std::string::npos) ? "" : option.substr(slash + 1));
         }
 
-        reload_config_signal event;
         wf::get_core().emit(&event);
         return wf::ipc::json_ok();
     };
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "ipc-rules-common.hpp"
+#include <map>
+#include <set>
+#include <tuple>
+#include <wayfire/core.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/toplevel-view.hpp>
+#include <nlohmann/json.hpp>
+
+namespace wf
+{
+/**
+ * A cache of the JSON descriptions of views (see view_to_json()), used to answer frequent queries like
+ * window-rules/list-views without rebuilding the description of every view each time.
+ *
+ * Title and app-id changes are tracked with signals. All other state is compared with its value from the
+ * time the description was built, which is much cheaper than building the JSON object again.
+ *
+ * Every rebuilt description gets a new version number, so that clients can ask only for changed views.
+ */
+class ipc_view_description_cache_t
+{
+  public:
+    void init()
+    {
+        wf::get_core().connect(&on_title_changed);
+        wf::get_core().connect(&on_app_id_changed);
+        wf::get_core().connect(&on_view_unmapped);
+    }
+
+    void fini()
+    {
+        on_title_changed.disconnect();
+        on_app_id_changed.disconnect();
+        on_view_unmapped.disconnect();
+        entries.clear();
+    }
+
+    /** Get the description of the view, and the version at which it last changed. */
+    const nlohmann::json& get(wayfire_view view, uint64_t *version = nullptr)
+    {
+        auto& entry = entries[view->get_id()];
+        auto state  = get_state(view);
+        if (entry.dirty || (entry.state != state))
+        {
+            entry.description = view_to_json(view);
+            entry.state   = state;
+            entry.dirty   = false;
+            entry.version = ++current_version;
+        }
+
+        if (version)
+        {
+            *version = entry.version;
+        }
+
+        return entry.description;
+    }
+
+    /** Forget the descriptions of all views which are not in the given list. */
+    void retain_only(const std::vector<wayfire_view>& views)
+    {
+        std::set<uint32_t> ids;
+        for (auto& view : views)
+        {
+            ids.insert(view->get_id());
+        }
+
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            it = ids.count(it->first) ? std::next(it) : entries.erase(it);
+        }
+    }
+
+    /** The version of the most recently rebuilt description. */
+    uint64_t get_current_version() const
+    {
+        return current_version;
+    }
+
+  private:
+    // The state of a view which the description depends on, except for title and app-id. Outputs and
+    // workspace sets are compared by id and index, like in the description, since their addresses may be
+    // reused by new objects.
+    using state_t = std::tuple<int64_t, view_role_t, uint64_t, bool, std::optional<wf::scene::layer>,
+        wf::geometry_t, wf::geometry_t, wf::geometry_t, int, uint32_t, bool, bool, bool, bool,
+        int64_t, wf::dimensions_t, wf::dimensions_t, bool>;
+
+    static state_t get_state(wayfire_view view)
+    {
+        auto toplevel = wf::toplevel_cast(view);
+        return state_t{
+            view->get_output() ? (int64_t)view->get_output()->get_id() : -1, view->role,
+            wf::get_focus_timestamp(view), view->is_mapped(), wf::get_view_layer(view),
+            view->get_bounding_box(), get_view_base_geometry(view),
+            toplevel ? toplevel->get_pending_geometry() : wf::geometry_t{0, 0, 0, 0},
+            (toplevel && toplevel->parent) ? (int)toplevel->parent->get_id() : -1,
+            toplevel ? toplevel->pending_tiled_edges() : 0,
+            toplevel ? toplevel->pending_fullscreen() : false,
+            toplevel ? toplevel->minimized : false,
+            toplevel ? toplevel->activated : false,
+            toplevel ? toplevel->sticky : false,
+            (toplevel && toplevel->get_wset()) ? (int64_t)toplevel->get_wset()->get_index() : -1,
+            toplevel ? toplevel->toplevel()->get_min_size() : wf::dimensions_t{0, 0},
+            toplevel ? toplevel->toplevel()->get_max_size() : wf::dimensions_t{0, 0},
+            view->is_focusable(),
+        };
+    }
+
+    struct entry_t
+    {
+        bool dirty = true;
+        state_t state;
+        uint64_t version = 0;
+        nlohmann::json description;
+    };
+
+    std::map<uint32_t, entry_t> entries;
+    uint64_t current_version = 0;
+
+    void mark_dirty(wayfire_view view)
+    {
+        auto it = entries.find(view->get_id());
+        if (it != entries.end())
+        {
+            it->second.dirty = true;
+        }
+    }
+
+    wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed =
+        [=] (wf::view_title_changed_signal *ev)
+    {
+        mark_dirty(ev->view);
+    };
+
+    wf::signal::connection_t<wf::view_app_id_changed_signal> on_app_id_changed =
+        [=] (wf::view_app_id_changed_signal *ev)
+    {
+        mark_dirty(ev->view);
+    };
+
+    wf::signal::connection_t<wf::view_unmapped_signal> on_view_unmapped = [=] (wf::view_unmapped_signal *ev)
+    {
+        entries.erase(ev->view->get_id());
+    };
+};
+}
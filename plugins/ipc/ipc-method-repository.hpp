@@ -1,9 +1,14 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <functional>
 #include <map>
+#include <unordered_map>
 #include "wayfire/signal-provider.hpp"
+#include <wayfire/trace.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/txn/transaction-manager.hpp>
 
 namespace wf
 {
@@ -17,6 +22,26 @@ class client_interface_t
 {
   public:
     virtual bool send_json(nlohmann::json json) = 0; // Returns true upon success.
+
+    /**
+     * Send a message which was already serialized with nlohmann::json::dump(), for example when the same
+     * message is sent to many clients. Returns true upon success.
+     */
+    virtual bool send_serialized(const std::string& serialized)
+    {
+        return send_json(nlohmann::json::parse(serialized));
+    }
+
+    /**
+     * Send a duplicate of the given file descriptor together with the next message to the client, for
+     * example the response of the current method call. Returns false if the client does not support
+     * receiving file descriptors.
+     */
+    virtual bool attach_fd(int fd)
+    {
+        return false;
+    }
+
     virtual ~client_interface_t() = default;
 };
 
@@ -63,9 +88,9 @@ class method_repository_t : public wf::signal::provider_t
      */
     void register_method(std::string method, method_callback handler)
     {
-        this->methods[method] = [handler] (const nlohmann::json& data, client_interface_t*)
+        this->methods[method] = [handler = std::move(handler)] (nlohmann::json data, client_interface_t*)
         {
-            return handler(data);
+            return handler(std::move(data));
         };
     }
 
@@ -80,13 +105,18 @@ class method_repository_t : public wf::signal::provider_t
     /**
      * Call an IPC method with the given name and given parameters.
      * If the method was not registered, a JSON object containing an error will be returned.
+     *
+     * The parameters are moved along to the handler, so callers which do not need them afterwards should
+     * pass them with std::move() to avoid copying them.
      */
-    nlohmann::json call_method(std::string method, nlohmann::json data,
+    nlohmann::json call_method(const std::string& method, nlohmann::json data,
         client_interface_t *client = nullptr)
     {
-        if (this->methods.count(method))
+        WF_TRACE_ZONE_TEXT("ipc method", method);
+        auto it = this->methods.find(method);
+        if (it != this->methods.end())
         {
-            return this->methods[method](std::move(data), client);
+            return it->second(std::move(data), client);
         }
 
         return {
@@ -100,17 +130,69 @@ class method_repository_t : public wf::signal::provider_t
         {
             nlohmann::json response;
             response["methods"] = nlohmann::json::array();
+            std::vector<std::string> names;
             for (auto& [method, _] : methods)
+            {
+                names.push_back(method);
+            }
+
+            std::sort(names.begin(), names.end());
+            for (auto& method : names)
             {
                 response["methods"].push_back(method);
             }
 
             return response;
         });
+
+        /**
+         * Call several methods in order, in a single round-trip. Arguments:
+         * - calls: a list of {"method": ..., "data": ...} objects.
+         * - stop-on-error: if true, the calls after the first one which returned an error are skipped.
+         *
+         * View changes made by the calls are collected in a single transaction and applied atomically.
+         * The response contains the responses of the calls which were executed, in order.
+         */
+        register_method("batch", [this] (nlohmann::json data, client_interface_t *client)
+        {
+            if (!data.contains("calls") || !data["calls"].is_array())
+            {
+                return nlohmann::json{{"error", "Missing \"calls\" array"}};
+            }
+
+            for (auto& call : data["calls"])
+            {
+                if (!call.is_object() || !call.contains("method") || !call["method"].is_string())
+                {
+                    return nlohmann::json{{"error", "Each call must be an object with a \"method\""}};
+                }
+            }
+
+            const bool stop_on_error = data.contains("stop-on-error") && data["stop-on-error"].is_boolean() &&
+                data["stop-on-error"];
+
+            nlohmann::json response = {{"result", "ok"}};
+            response["responses"] = nlohmann::json::array();
+            wf::get_core().tx_manager->begin_batch();
+            for (auto& call : data["calls"])
+            {
+                auto call_data = call.contains("data") ? std::move(call["data"]) : nlohmann::json::object();
+                auto result    = call_method(call["method"], std::move(call_data), client);
+                const bool failed = result.is_object() && result.contains("error");
+                response["responses"].push_back(std::move(result));
+                if (failed && stop_on_error)
+                {
+                    break;
+                }
+            }
+
+            wf::get_core().tx_manager->end_batch();
+            return response;
+        });
     }
 
   private:
-    std::map<std::string, method_callback_full> methods;
+    std::unordered_map<std::string, method_callback_full> methods;
 };
 
 // A few helper definitions for IPC method implementations.
@@ -0,0 +1,413 @@
+#include "ipc-worker.hpp"
+#include <wayfire/util/log.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+std::string wf::ipc::encode_message(const nlohmann::json& message, message_encoding_t encoding)
+{
+    switch (encoding)
+    {
+      case message_encoding_t::CBOR:
+      {
+        auto bytes = nlohmann::json::to_cbor(message);
+        return std::string(bytes.begin(), bytes.end());
+      }
+
+      case message_encoding_t::MSGPACK:
+      {
+        auto bytes = nlohmann::json::to_msgpack(message);
+        return std::string(bytes.begin(), bytes.end());
+      }
+
+      default:
+        return message.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+    }
+}
+
+static nlohmann::json decode_message(const char *data, size_t len, wf::ipc::message_encoding_t encoding)
+{
+    switch (encoding)
+    {
+      case wf::ipc::message_encoding_t::CBOR:
+        return nlohmann::json::from_cbor(data, data + len, true, false);
+
+      case wf::ipc::message_encoding_t::MSGPACK:
+        return nlohmann::json::from_msgpack(data, data + len, true, false);
+
+      default:
+        return nlohmann::json::parse(data, data + len, nullptr, false);
+    }
+}
+
+/**
+ * Increment the eventfd. This fails only if the counter would overflow, in which case the eventfd is readable
+ * already, so the failure is not reported.
+ */
+static void wake_up(int fd)
+{
+    uint64_t one = 1;
+    while ((write(fd, &one, sizeof(one)) < 0) && (errno == EINTR))
+    {}
+}
+
+static void drain(int fd)
+{
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) == sizeof(count))
+    {}
+}
+
+wf::ipc::worker_t::worker_t(wl_event_loop *loop, dispatch_callback_t dispatch)
+{
+    this->dispatch = std::move(dispatch);
+    epoll_fd   = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd    = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    results_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ((epoll_fd < 0) || (wake_fd < 0) || (results_fd < 0))
+    {
+        LOGE("Failed to set up the IPC worker: ", strerror(errno));
+        running = false;
+        return;
+    }
+
+    epoll_event ev = {};
+    ev.events   = EPOLLIN;
+    ev.data.u64 = 0;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+
+    results_source = wl_event_loop_add_fd(loop, results_fd, WL_EVENT_READABLE, handle_results, this);
+    thread = std::thread([=] () { run(); });
+}
+
+wf::ipc::worker_t::~worker_t()
+{
+    running = false;
+    if (thread.joinable())
+    {
+        wake_up(wake_fd);
+        thread.join();
+    }
+
+    for (auto& [id, client] : clients)
+    {
+        close(client.fd);
+    }
+
+    if (results_source)
+    {
+        wl_event_source_remove(results_source);
+    }
+
+    for (int fd : {epoll_fd, wake_fd, results_fd})
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void wf::ipc::worker_t::push_command(command_t command)
+{
+    {
+        std::lock_guard<std::mutex> lock(commands_mutex);
+        commands.push_back(std::move(command));
+    }
+
+    wake_up(wake_fd);
+}
+
+void wf::ipc::worker_t::add_client(uint64_t client, int fd)
+{
+    command_t command;
+    command.type   = command_t::ADD;
+    command.client = client;
+    command.fd     = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (command.fd < 0)
+    {
+        LOGE("Failed to duplicate the socket of IPC client ", client);
+        return;
+    }
+
+    push_command(std::move(command));
+}
+
+void wf::ipc::worker_t::remove_client(uint64_t client)
+{
+    command_t command;
+    command.type   = command_t::REMOVE;
+    command.client = client;
+    push_command(std::move(command));
+}
+
+void wf::ipc::worker_t::serialize(uint64_t client, uint64_t sequence, nlohmann::json message,
+    message_encoding_t encoding)
+{
+    command_t command;
+    command.type     = command_t::SERIALIZE;
+    command.client   = client;
+    command.sequence = sequence;
+    command.message  = std::move(message);
+    command.encoding = encoding;
+    push_command(std::move(command));
+}
+
+void wf::ipc::worker_t::push_results(std::vector<result_t> new_results)
+{
+    if (new_results.empty())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        if (results.empty())
+        {
+            results = std::move(new_results);
+        } else
+        {
+            std::move(new_results.begin(), new_results.end(), std::back_inserter(results));
+        }
+    }
+
+    wake_up(results_fd);
+}
+
+void wf::ipc::worker_t::push_error(std::string error)
+{
+    {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        errors.push_back(std::move(error));
+    }
+
+    wake_up(results_fd);
+}
+
+int wf::ipc::worker_t::handle_results(int fd, uint32_t mask, void *data)
+{
+    auto self = (worker_t*)data;
+    drain(fd);
+
+    std::vector<result_t> results;
+    std::vector<std::string> errors;
+    {
+        std::lock_guard<std::mutex> lock(self->results_mutex);
+        std::swap(results, self->results);
+        std::swap(errors, self->errors);
+    }
+
+    for (auto& error : errors)
+    {
+        LOGE(error);
+    }
+
+    if (!results.empty())
+    {
+        self->dispatch(std::move(results));
+    }
+
+    return 0;
+}
+
+void wf::ipc::worker_t::close_client(uint64_t id)
+{
+    auto it = clients.find(id);
+    if (it != clients.end())
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+        clients.erase(it);
+    }
+}
+
+void wf::ipc::worker_t::handle_commands()
+{
+    drain(wake_fd);
+
+    std::vector<command_t> pending;
+    {
+        std::lock_guard<std::mutex> lock(commands_mutex);
+        std::swap(pending, commands);
+    }
+
+    std::vector<result_t> serialized;
+    for (auto& command : pending)
+    {
+        switch (command.type)
+        {
+          case command_t::ADD:
+          {
+            auto& client = clients[command.client];
+            client.fd = command.fd;
+            // +1 for null byte at the end
+            client.buffer.resize(MAX_MESSAGE_LEN + 1);
+
+            epoll_event ev = {};
+            ev.events   = EPOLLIN;
+            ev.data.u64 = command.client;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &ev);
+            break;
+          }
+
+          case command_t::REMOVE:
+            close_client(command.client);
+            break;
+
+          case command_t::SERIALIZE:
+          {
+            result_t result;
+            result.type     = result_t::SERIALIZED;
+            result.client   = command.client;
+            result.sequence = command.sequence;
+            result.serialized = encode_message(command.message, command.encoding);
+            serialized.push_back(std::move(result));
+            break;
+          }
+        }
+    }
+
+    push_results(std::move(serialized));
+}
+
+bool wf::ipc::worker_t::read_messages(uint64_t id, client_state_t& client, std::vector<result_t>& out)
+{
+    while (true)
+    {
+        size_t target = HEADER_LEN;
+        if (client.valid >= HEADER_LEN)
+        {
+            uint32_t len;
+            std::memcpy(&len, client.buffer.data(), HEADER_LEN);
+            if (len > MAX_MESSAGE_LEN - HEADER_LEN)
+            {
+                push_error("Client tried to pass too long a message!");
+                return false;
+            }
+
+            target = HEADER_LEN + len;
+        }
+
+        if ((client.valid == target) && (target > HEADER_LEN))
+        {
+            // Finally, received the message, make sure we have a terminating NULL byte
+            client.buffer[client.valid] = '\0';
+            const char *str = client.buffer.data() + HEADER_LEN;
+            auto message    = decode_message(str, target - HEADER_LEN, client.encoding);
+            client.valid = 0;
+            if (message.is_discarded())
+            {
+                push_error(std::string("Client's message could not be parsed: ") +
+                    ((client.encoding == message_encoding_t::JSON) ? str : "(binary)"));
+                return false;
+            }
+
+            if (!message.is_object() || !message.contains("method") || !message["method"].is_string())
+            {
+                push_error("Client's message does not contain a method to be called!");
+                return false;
+            }
+
+            // The following messages are already in the new encoding, so it has to be switched before the
+            // main loop handles the request.
+            if ((message["method"] == "ipc/set-encoding") && message.contains("data") &&
+                message["data"].is_object() && message["data"].value("encoding", "").size())
+            {
+                static const std::map<std::string, message_encoding_t> encodings = {
+                    {"json", message_encoding_t::JSON},
+                    {"cbor", message_encoding_t::CBOR},
+                    {"msgpack", message_encoding_t::MSGPACK},
+                };
+
+                auto it = encodings.find(message["data"].value("encoding", ""));
+                if (it != encodings.end())
+                {
+                    client.encoding = it->second;
+                }
+            }
+
+            result_t result;
+            result.type    = result_t::REQUEST;
+            result.client  = id;
+            result.message = std::move(message);
+            out.push_back(std::move(result));
+            continue;
+        }
+
+        ssize_t r = read(client.fd, client.buffer.data() + client.valid, target - client.valid);
+        if (r == 0)
+        {
+            return false;
+        }
+
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+
+        client.valid += r;
+    }
+}
+
+void wf::ipc::worker_t::run()
+{
+    static constexpr int MAX_EVENTS = 16;
+    epoll_event events[MAX_EVENTS];
+    while (running)
+    {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            push_error("IPC worker: epoll_wait failed: " + std::generic_category().message(errno));
+            return;
+        }
+
+        std::vector<result_t> out;
+        bool commands_pending = false;
+        for (int i = 0; i < n; i++)
+        {
+            const uint64_t id = events[i].data.u64;
+            if (id == 0)
+            {
+                commands_pending = true;
+                continue;
+            }
+
+            auto it = clients.find(id);
+            if (it == clients.end())
+            {
+                continue;
+            }
+
+            if (!read_messages(id, it->second, out))
+            {
+                result_t result;
+                result.type   = result_t::DISCONNECTED;
+                result.client = id;
+                out.push_back(std::move(result));
+                close_client(id);
+            }
+        }
+
+        push_results(std::move(out));
+        if (commands_pending)
+        {
+            handle_commands();
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include <wayland-server.h>
+
+namespace wf
+{
+namespace ipc
+{
+/**
+ * The encoding of the messages exchanged with a client.
+ */
+enum class message_encoding_t
+{
+    JSON,
+    CBOR,
+    MSGPACK,
+};
+
+static constexpr int MAX_MESSAGE_LEN = (1 << 20);
+static constexpr int HEADER_LEN = 4;
+
+/** Serialize a message with the given encoding. */
+std::string encode_message(const nlohmann::json& message, message_encoding_t encoding);
+
+/**
+ * A thread which reads and parses the messages of the IPC clients, and serializes large responses, so that
+ * neither happens in the compositor's event loop.
+ *
+ * The worker has its own epoll loop over (duplicates of) the client sockets. Complete and valid requests
+ * are handed to the main loop, in the order they were received, through a queue and an eventfd registered
+ * on the compositor's event loop, the same way as asynchronous image loading.
+ *
+ * Writing to the sockets stays on the main thread, so that the order of the messages sent to a client is
+ * decided there. Errors of the worker thread are also passed to the main thread, which logs them, since the
+ * logging functions are not thread-safe.
+ */
+class worker_t
+{
+  public:
+    struct result_t
+    {
+        enum type_t
+        {
+            /* A parsed request with a method, in message */
+            REQUEST,
+            /* The client sent an invalid message or closed the connection */
+            DISCONNECTED,
+            /* A response requested with serialize(), in serialized */
+            SERIALIZED,
+        };
+
+        type_t type;
+        uint64_t client;
+        nlohmann::json message;
+        uint64_t sequence = 0;
+        std::string serialized;
+    };
+
+    using dispatch_callback_t = std::function<void (std::vector<result_t>)>;
+
+    /**
+     * Start the worker thread. The callback is run on the main thread with the results of the worker.
+     */
+    worker_t(wl_event_loop *loop, dispatch_callback_t dispatch);
+    ~worker_t();
+
+    worker_t(const worker_t&) = delete;
+    worker_t& operator =(const worker_t&) = delete;
+
+    /** Start reading the messages from the given client socket. The worker uses a duplicate of @fd. */
+    void add_client(uint64_t client, int fd);
+
+    /** Stop reading from the client. Results which are already queued are still dispatched. */
+    void remove_client(uint64_t client);
+
+    /** Serialize a message for the client, the result is dispatched with the given sequence number. */
+    void serialize(uint64_t client, uint64_t sequence, nlohmann::json message, message_encoding_t encoding);
+
+  private:
+    struct command_t
+    {
+        enum type_t
+        {
+            ADD,
+            REMOVE,
+            SERIALIZE,
+        };
+
+        type_t type;
+        uint64_t client;
+        int fd = -1;
+        uint64_t sequence = 0;
+        nlohmann::json message;
+        message_encoding_t encoding = message_encoding_t::JSON;
+    };
+
+    /* State of a connected client, only accessed by the worker thread. */
+    struct client_state_t
+    {
+        int fd;
+        message_encoding_t encoding = message_encoding_t::JSON;
+        std::vector<char> buffer;
+        size_t valid = 0;
+    };
+
+    int epoll_fd = -1;
+    int wake_fd  = -1;
+    int results_fd = -1;
+    wl_event_source *results_source = nullptr;
+    std::atomic<bool> running = true;
+    std::thread thread;
+
+    std::mutex commands_mutex;
+    std::vector<command_t> commands;
+
+    std::mutex results_mutex;
+    std::vector<result_t> results;
+    std::vector<std::string> errors;
+    dispatch_callback_t dispatch;
+
+    std::map<uint64_t, client_state_t> clients;
+
+    void run();
+    void push_command(command_t command);
+    void handle_commands();
+    void push_results(std::vector<result_t> new_results);
+    /** Log an error of the worker thread from the main thread. */
+    void push_error(std::string error);
+
+    /** Read all available messages of the client. Returns false if the client should be disconnected. */
+    bool read_messages(uint64_t id, client_state_t& client, std::vector<result_t>& out);
+    void close_client(uint64_t id);
+
+    static int handle_results(int fd, uint32_t mask, void *data);
+};
+}
+}
@@ -1,13 +1,15 @@
 #include "ipc.hpp"
 #include "wayfire/plugins/common/shared-core-data.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <climits>
+#include <cstring>
 #include <wayfire/util/log.hpp>
 #include <wayfire/core.hpp>
 #include <wayfire/plugin.hpp>
 
 #include <fcntl.h>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
 #include <unistd.h>
 
 /**
@@ -26,6 +28,38 @@ wf::ipc::server_t::server_t()
     {
         do_accept_new_client();
     };
+
+    /**
+     * Switch the encoding of the messages of the calling client to JSON text ("json", the default), CBOR
+     * ("cbor") or MessagePack ("msgpack"). The response and all following messages in both directions use
+     * the new encoding.
+     */
+    set_encoding = [=] (const nlohmann::json& data, client_interface_t *client)
+    {
+        WFJSON_EXPECT_FIELD(data, "encoding", string);
+        auto ipc_client = dynamic_cast<client_t*>(client);
+        if (!ipc_client)
+        {
+            return wf::ipc::json_error("The encoding can only be set for IPC socket clients");
+        }
+
+        static const std::map<std::string, client_t::encoding_t> encodings = {
+            {"json", client_t::encoding_t::JSON},
+            {"cbor", client_t::encoding_t::CBOR},
+            {"msgpack", client_t::encoding_t::MSGPACK},
+        };
+
+        auto it = encodings.find(data["encoding"]);
+        if (it == encodings.end())
+        {
+            return wf::ipc::json_error("Unknown encoding " + data["encoding"].dump());
+        }
+
+        ipc_client->set_encoding(it->second);
+        return wf::ipc::json_ok();
+    };
+
+    method_repository->register_method("ipc/set-encoding", set_encoding);
 }
 
 void wf::ipc::server_t::init(std::string socket_path)
@@ -40,10 +74,15 @@ void wf::ipc::server_t::init(std::string socket_path)
     listen(fd, 3);
     source = wl_event_loop_add_fd(wl_display_get_event_loop(wf::get_core().display),
         fd, WL_EVENT_READABLE, wl_loop_handle_ipc_fd_connection, &accept_new_client);
+    worker = std::make_unique<worker_t>(wf::get_core().ev_loop, [=] (std::vector<worker_t::result_t> results)
+    {
+        handle_worker_results(std::move(results));
+    });
 }
 
 wf::ipc::server_t::~server_t()
 {
+    method_repository->unregister_method("ipc/set-encoding");
     if (fd != -1)
     {
         close(fd);
@@ -114,7 +153,42 @@ void wf::ipc::server_t::do_accept_new_client()
         return;
     }
 
-    this->clients.push_back(std::make_unique<client_t>(this, cfd));
+    this->clients.push_back(std::make_unique<client_t>(this, cfd, next_client_id++));
+    worker->add_client(clients.back()->id, cfd);
+}
+
+wf::ipc::client_t*wf::ipc::server_t::find_client(uint64_t id)
+{
+    auto it = std::find_if(clients.begin(), clients.end(), [&] (const auto& cl) { return cl->id == id; });
+    return (it == clients.end()) ? nullptr : it->get();
+}
+
+void wf::ipc::server_t::handle_worker_results(std::vector<worker_t::result_t> results)
+{
+    for (auto& result : results)
+    {
+        // Clients may disappear while handling earlier results.
+        auto client = find_client(result.client);
+        if (!client)
+        {
+            continue;
+        }
+
+        switch (result.type)
+        {
+          case worker_t::result_t::REQUEST:
+            handle_incoming_message(client, std::move(result.message));
+            break;
+
+          case worker_t::result_t::DISCONNECTED:
+            client_disappeared(client);
+            break;
+
+          case worker_t::result_t::SERIALIZED:
+            client->handle_serialized(result.sequence, std::move(result.serialized));
+            break;
+        }
+    }
 }
 
 void wf::ipc::server_t::client_disappeared(client_t *client)
@@ -133,7 +207,8 @@ void wf::ipc::server_t::client_disappeared(client_t *client)
 void wf::ipc::server_t::handle_incoming_message(
     client_t *client, nlohmann::json message)
 {
-    client->send_json(method_repository->call_method(message["method"], message["data"], client));
+    const std::string method = message["method"];
+    client->send_json(method_repository->call_method(method, std::move(message["data"]), client));
 }
 
 /* --------------------------- Per-client code ------------------------------*/
@@ -144,171 +219,300 @@ int wl_loop_handle_ipc_client_fd_event(int, uint32_t mask, void *data)
     return 0;
 }
 
-static constexpr int MAX_MESSAGE_LEN = (1 << 20);
-static constexpr int HEADER_LEN = 4;
-
-wf::ipc::client_t::client_t(server_t *ipc, int fd)
+wf::ipc::client_t::client_t(server_t *ipc, int fd, uint64_t id) : id(id)
 {
     LOGD("New IPC client, fd ", fd);
 
     this->fd  = fd;
     this->ipc = ipc;
 
+    // Errors and hangups are reported even without any events in the mask.
     auto ev_loop = wf::get_core().ev_loop;
-    source = wl_event_loop_add_fd(ev_loop, fd, WL_EVENT_READABLE,
+    source = wl_event_loop_add_fd(ev_loop, fd, 0,
         wl_loop_handle_ipc_client_fd_event, &this->handle_fd_activity);
-
-    // +1 for null byte at the end
-    buffer.resize(MAX_MESSAGE_LEN + 1);
     this->handle_fd_activity = [=] (uint32_t event_mask)
     {
-        handle_fd_incoming(event_mask);
+        handle_fd_event(event_mask);
     };
 }
 
-// -1 error, 0 success, 1 try again later
-int wf::ipc::client_t::read_up_to(int n, int *available)
+void wf::ipc::client_t::handle_fd_event(uint32_t event_mask)
 {
-    int need = n - current_buffer_valid;
-    int want = std::min(need, *available);
+    if (event_mask & (WL_EVENT_ERROR | WL_EVENT_HANGUP))
+    {
+        // The IPC worker may still have requests of the client which it has not dispatched yet. It reports
+        // the disconnection after them, until then stop watching the socket, since the hangup is reported
+        // continuously.
+        wl_event_source_remove(source);
+        source = nullptr;
+        return;
+    }
 
-    while (want > 0)
+    if (event_mask & WL_EVENT_WRITABLE)
     {
-        int r = read(fd, buffer.data() + current_buffer_valid, want);
-        if (r <= 0)
+        if (!flush_send_queue())
         {
-            LOGI("Read: EOF or error (%d) %s\n", r, strerror(errno));
-            return -1;
+            LOGE("Error sending json to client!");
+            ipc->client_disappeared(this);
+            return;
         }
 
-        want -= r;
-        *available -= r;
-        current_buffer_valid += r;
-    }
-
-    if (current_buffer_valid < n)
-    {
-        // didn't read all n bytes
-        return 1;
+        update_event_mask();
     }
-
-    return 0;
 }
 
-void wf::ipc::client_t::handle_fd_incoming(uint32_t event_mask)
+wf::ipc::client_t::~client_t()
 {
-    if (event_mask & (WL_EVENT_ERROR | WL_EVENT_HANGUP))
+    ipc->worker->remove_client(id);
+    clear_send_queue();
+    if (pending_fd >= 0)
     {
-        ipc->client_disappeared(this);
-        // this no longer exists
-        return;
+        close(pending_fd);
     }
 
-    int available = 0;
-    if (ioctl(this->fd, FIONREAD, &available) != 0)
+    if (source)
     {
-        LOGE("Failed to inspect message buffer!");
-        ipc->client_disappeared(this);
-        return;
+        wl_event_source_remove(source);
     }
 
-    while (available > 0)
+    shutdown(fd, SHUT_RDWR);
+    close(this->fd);
+}
+
+bool wf::ipc::client_t::flush_send_queue()
+{
+    while (!send_queue.empty())
     {
-        if (current_buffer_valid < HEADER_LEN)
+        auto& message = send_queue.front();
+        if (!message.ready)
         {
-            if (read_up_to(HEADER_LEN, &available) < 0)
-            {
-                ipc->client_disappeared(this);
-                return;
-            }
-
-            continue;
+            // Later messages have to wait until the IPC worker has serialized this one.
+            break;
         }
 
-        const uint32_t len = *((uint32_t*)buffer.data());
-        if (len > MAX_MESSAGE_LEN - HEADER_LEN)
+        ssize_t w;
+        if (message.fd >= 0)
         {
-            LOGE("Client tried to pass too long a message!");
-            ipc->client_disappeared(this);
-            return;
-        }
-
-        const int next_target = HEADER_LEN + len;
-        int r = read_up_to(next_target, &available);
-        if (r < 0)
+            // The file descriptor is sent with the first bytes of the message.
+            iovec iov;
+            iov.iov_base = message.data.data() + send_offset;
+            iov.iov_len  = message.data.size() - send_offset;
+
+            char control[CMSG_SPACE(sizeof(int))] = {0};
+            msghdr msg = {};
+            msg.msg_iov    = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control    = control;
+            msg.msg_controllen = sizeof(control);
+
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type  = SCM_RIGHTS;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(cmsg), &message.fd, sizeof(int));
+            w = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (w > 0)
+            {
+                close(message.fd);
+                message.fd = -1;
+            }
+        } else
         {
-            ipc->client_disappeared(this);
-            return;
+            w = write(fd, message.data.data() + send_offset, message.data.size() - send_offset);
         }
 
-        if (r > 0)
+        if (w < 0)
         {
-            // Try again
-            continue;
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
         }
 
-        // Finally, received the message, make sure we have a terminating NULL byte
-        buffer[current_buffer_valid] = '\0';
-        char *str    = buffer.data() + HEADER_LEN;
-        auto message = nlohmann::json::parse(str, nullptr, false);
-        if (message.is_discarded())
+        send_offset += w;
+        send_queue_bytes -= w;
+        if (send_offset == message.data.size())
         {
-            LOGE("Client's message could not be parsed: ", str);
-            ipc->client_disappeared(this);
-            return;
+            send_queue.pop_front();
+            send_offset = 0;
         }
+    }
+
+    return true;
+}
 
-        if (!message.contains("method"))
+void wf::ipc::client_t::clear_send_queue()
+{
+    for (auto& message : send_queue)
+    {
+        if (message.fd >= 0)
         {
-            LOGE("Client's message does not contain a method to be called!");
-            ipc->client_disappeared(this);
-            return;
+            close(message.fd);
         }
+    }
+
+    send_queue.clear();
+    send_queue_bytes = 0;
+    send_offset = 0;
+}
+
+bool wf::ipc::client_t::attach_fd(int fd)
+{
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0)
+    {
+        return false;
+    }
 
-        ipc->handle_incoming_message(this, std::move(message));
-        // Reset for next message
-        current_buffer_valid = 0;
+    if (pending_fd >= 0)
+    {
+        close(pending_fd);
     }
+
+    pending_fd = copy;
+    return true;
 }
 
-wf::ipc::client_t::~client_t()
+void wf::ipc::client_t::update_event_mask()
 {
-    wl_event_source_remove(source);
-    shutdown(fd, SHUT_RDWR);
-    close(this->fd);
+    const uint32_t mask = (!send_queue.empty() && send_queue.front().ready) ? WL_EVENT_WRITABLE : 0;
+    if (source && (mask != event_mask))
+    {
+        event_mask = mask;
+        wl_event_source_fd_update(source, mask);
+    }
+}
+
+bool wf::ipc::client_t::flush_and_update()
+{
+    if (!flush_send_queue())
+    {
+        LOGE("Error sending json to client!");
+        shutdown(fd, SHUT_RDWR);
+        return false;
+    }
+
+    update_event_mask();
+    return true;
 }
 
-static bool write_exact(int fd, char *buf, ssize_t n)
+/**
+ * Count the values in a JSON document, stopping once the limit is reached. This bounds the cost of deciding
+ * whether a message is large enough to be serialized by the IPC worker.
+ */
+static int count_json_values(const nlohmann::json& json, int limit)
 {
-    while (n > 0)
+    int count = 1;
+    if (json.is_structured())
     {
-        ssize_t w = write(fd, buf, n);
-        if (w <= 0)
+        for (auto& child : json)
         {
-            return false;
+            if (count >= limit)
+            {
+                break;
+            }
+
+            count += count_json_values(child, limit - count);
         }
+    }
+
+    return count;
+}
 
-        n   -= w;
-        buf += w;
+bool wf::ipc::client_t::send_json(nlohmann::json json)
+{
+    const int threshold = ipc->async_serialize_threshold;
+    if ((threshold <= 0) || (count_json_values(json, threshold) < threshold))
+    {
+        return send_encoded(encode_message(json, encoding));
     }
 
+    // Queue a placeholder, so that messages sent in the meantime stay in order.
+    queued_message_t message;
+    message.ready    = false;
+    message.sequence = next_sequence++;
+    message.fd = pending_fd;
+    pending_fd = -1;
+    send_queue.push_back(std::move(message));
+    ipc->worker->serialize(id, send_queue.back().sequence, std::move(json), encoding);
     return true;
 }
 
-bool wf::ipc::client_t::send_json(nlohmann::json json)
+void wf::ipc::client_t::handle_serialized(uint64_t sequence, std::string serialized)
+{
+    auto find_placeholder = [&] ()
+    {
+        return std::find_if(send_queue.begin(), send_queue.end(), [&] (const queued_message_t& message)
+        {
+            return !message.ready && (message.sequence == sequence);
+        });
+    };
+
+    if (find_placeholder() == send_queue.end())
+    {
+        return;
+    }
+
+    // May clear the queue and shut down the client.
+    const bool ok = check_send_backlog(serialized.length());
+    auto it = find_placeholder();
+    if (it == send_queue.end())
+    {
+        return;
+    }
+
+    if (ok)
+    {
+        uint32_t len = serialized.length();
+        it->data  = std::string((char*)&len, HEADER_LEN);
+        it->data += serialized;
+        it->ready = true;
+        send_queue_bytes += it->data.size();
+    } else
+    {
+        if (it->fd >= 0)
+        {
+            close(it->fd);
+        }
+
+        send_queue.erase(it);
+    }
+
+    flush_and_update();
+}
+
+bool wf::ipc::client_t::send_serialized(const std::string& serialized)
+{
+    if (encoding == encoding_t::JSON)
+    {
+        return send_encoded(serialized);
+    }
+
+    return send_json(nlohmann::json::parse(serialized, nullptr, false));
+}
+
+void wf::ipc::client_t::set_encoding(encoding_t encoding)
+{
+    this->encoding = encoding;
+}
+
+bool wf::ipc::client_t::check_send_backlog(size_t size)
 {
-    std::string serialized = json.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
-    if (serialized.length() > MAX_MESSAGE_LEN)
+    if (size > MAX_MESSAGE_LEN)
     {
         LOGE("Error sending json to client: message too long!");
         shutdown(fd, SHUT_RDWR);
         return false;
     }
 
-    uint32_t len = serialized.length();
-    if (!write_exact(fd, (char*)&len, 4) || !write_exact(fd, serialized.data(), len))
+    const size_t max_backlog = 1024ul * std::max(1, (int)ipc->max_send_backlog);
+    if (send_queue_bytes + HEADER_LEN + size > max_backlog)
     {
-        LOGE("Error sending json to client!");
+        if ((std::string)ipc->backlog_policy == "drop")
+        {
+            LOGW("IPC client ", this, " is not reading its messages, dropping a message.");
+            return false;
+        }
+
+        LOGE("IPC client ", this, " is not reading its messages, disconnecting it.");
+        clear_send_queue();
         shutdown(fd, SHUT_RDWR);
         return false;
     }
@@ -316,6 +520,26 @@ bool wf::ipc::client_t::send_json(nlohmann::json json)
     return true;
 }
 
+bool wf::ipc::client_t::send_encoded(const std::string& serialized)
+{
+    if (!check_send_backlog(serialized.length()))
+    {
+        return false;
+    }
+
+    uint32_t len = serialized.length();
+    queued_message_t message;
+    message.data = std::string((char*)&len, HEADER_LEN);
+    message.data += serialized;
+    message.fd   = pending_fd;
+    pending_fd   = -1;
+    send_queue_bytes += message.data.size();
+    send_queue.push_back(std::move(message));
+
+    const bool was_pending = (send_queue.size() > 1);
+    return was_pending || flush_and_update();
+}
+
 namespace wf
 {
 class ipc_plugin_t : public wf::plugin_interface_t
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <deque>
 #include <nlohmann/json.hpp>
 #include <sys/un.h>
 #include <wayfire/object.hpp>
+#include <wayfire/option-wrapper.hpp>
 #include <wayland-server.h>
 #include <wayfire/plugins/common/shared-core-data.hpp>
 #include "ipc-method-repository.hpp"
+#include "ipc-worker.hpp"
 
 namespace wf
 {
@@ -18,22 +21,76 @@ class server_t;
 class client_t : public client_interface_t
 {
   public:
-    client_t(server_t *server, int client_fd);
+    client_t(server_t *server, int client_fd, uint64_t id);
     ~client_t();
     bool send_json(nlohmann::json json) override;
+    bool send_serialized(const std::string& serialized) override;
+
+    /**
+     * The encoding of the messages in both directions. Clients start with JSON text and can switch with the
+     * ipc/set-encoding method.
+     */
+    using encoding_t = message_encoding_t;
+
+    void set_encoding(encoding_t encoding);
+    bool attach_fd(int fd) override;
+
+    /** Fill in a response which was serialized by the IPC worker, see send_json(). */
+    void handle_serialized(uint64_t sequence, std::string serialized);
+
+    /** A unique id of the client, used to identify it in the IPC worker. */
+    const uint64_t id;
 
   private:
     int fd;
     wl_event_source *source;
     server_t *ipc;
 
-    int current_buffer_valid = 0;
-    std::vector<char> buffer;
-    int read_up_to(int n, int *available);
+    encoding_t encoding = encoding_t::JSON;
+    /** Send a message which is already encoded with the client's encoding. */
+    bool send_encoded(const std::string& message);
+    /**
+     * Check whether a message with the given size can be queued. If not, the message must be dropped, and
+     * the client may have been disconnected.
+     */
+    bool check_send_backlog(size_t size);
 
-    /** Handle incoming data on the socket */
+    /**
+     * Handle writability and errors of the socket. Incoming messages are read by the IPC worker and
+     * dispatched by the server.
+     */
     std::function<void(uint32_t)> handle_fd_activity;
-    void handle_fd_incoming(uint32_t);
+    void handle_fd_event(uint32_t);
+
+    /**
+     * Messages which could not be written to the socket yet, including their header. Writing never blocks
+     * the compositor: the queue is flushed when the socket becomes writable again.
+     */
+    struct queued_message_t
+    {
+        std::string data;
+        // A file descriptor sent together with the message (owned by the queue), or -1
+        int fd = -1;
+        // False while the message is still being serialized by the IPC worker
+        bool ready = true;
+        uint64_t sequence = 0;
+    };
+
+    std::deque<queued_message_t> send_queue;
+    // A file descriptor to send with the next message, see attach_fd()
+    int pending_fd = -1;
+    void clear_send_queue();
+    // The number of bytes of the first message in the queue which were already written
+    size_t send_offset = 0;
+    size_t send_queue_bytes = 0;
+    uint64_t next_sequence  = 0;
+
+    /** Write as much of the queue as possible. Returns false on a write error. */
+    bool flush_send_queue();
+    /** Flush the queue and wait for writability if needed. Shuts the client down on errors. */
+    bool flush_and_update();
+    void update_event_mask();
+    uint32_t event_mask = 0;
 };
 
 /**
@@ -52,17 +109,28 @@ class server_t
     wf::shared_data::ref_ptr_t<wf::ipc::method_repository_t> method_repository;
 
     void handle_incoming_message(client_t *client, nlohmann::json message);
+    void handle_worker_results(std::vector<worker_t::result_t> results);
+    client_t *find_client(uint64_t id);
+    method_callback_full set_encoding;
 
     void client_disappeared(client_t *client);
 
     int fd = -1;
 
+    wf::option_wrapper_t<int> max_send_backlog{"ipc/max_send_backlog"};
+    wf::option_wrapper_t<std::string> backlog_policy{"ipc/backlog_policy"};
+    wf::option_wrapper_t<int> async_serialize_threshold{"ipc/async_serialize_threshold"};
+
     /**
      * Setup a socket at the given address, and set it as CLOEXEC and non-blocking.
      */
     int setup_socket(const char *address);
     sockaddr_un saddr;
     wl_event_source *source;
+
+    // Declared before the clients, which remove themselves from the worker when destroyed.
+    std::unique_ptr<worker_t> worker;
+    uint64_t next_client_id = 1;
     std::vector<std::unique_ptr<client_t>> clients;
 
     std::function<void()> accept_new_client;
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <wayfire/core.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/util/log.hpp>
+#include <wayfire/touch/touch.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_touch.h>
+}
+
+namespace wf
+{
+namespace input_trace
+{
+/**
+ * The binary format of input traces: a header followed by fixed-size records, all in host byte order.
+ * Traces are meant to be replayed on the machine where they were recorded.
+ */
+constexpr uint32_t MAGIC   = 0x54494657; // "WFIT"
+constexpr uint32_t VERSION = 1;
+
+struct header_t
+{
+    uint32_t magic   = MAGIC;
+    uint32_t version = VERSION;
+    uint64_t count   = 0;
+};
+
+enum record_type_t : uint8_t
+{
+    /* A keyboard key, code is the evdev keycode */
+    RECORD_KEY      = 0,
+    /* A pointer button, code is the evdev button code */
+    RECORD_BUTTON   = 1,
+    /* The cursor position after a pointer motion event, in layout coordinates */
+    RECORD_MOTION   = 2,
+    /* A touch point going down or moving, code is the finger id, position in layout coordinates */
+    RECORD_TOUCH    = 3,
+    /* A touch point being lifted, code is the finger id */
+    RECORD_TOUCH_UP = 4,
+};
+
+struct record_t
+{
+    /* Time since the recording was started, in microseconds */
+    uint64_t time_us;
+    uint8_t type;
+    /* Pressed (1) or released (0), for keys and buttons */
+    uint8_t state;
+    uint16_t reserved = 0;
+    int32_t code;
+    float x;
+    float y;
+};
+
+static_assert(sizeof(record_t) == 24, "input trace records must stay compact");
+
+inline bool write_trace(const std::string& file, const std::vector<record_t>& records)
+{
+    std::unique_ptr<FILE, int (*)(FILE*)> f{std::fopen(file.c_str(), "wb"), std::fclose};
+    if (!f)
+    {
+        return false;
+    }
+
+    header_t header;
+    header.count = records.size();
+    return (std::fwrite(&header, sizeof(header), 1, f.get()) == 1) &&
+           (std::fwrite(records.data(), sizeof(record_t), records.size(), f.get()) == records.size());
+}
+
+inline bool read_trace(const std::string& file, std::vector<record_t>& records)
+{
+    std::unique_ptr<FILE, int (*)(FILE*)> f{std::fopen(file.c_str(), "rb"), std::fclose};
+    header_t header;
+    if (!f || (std::fread(&header, sizeof(header), 1, f.get()) != 1) ||
+        (header.magic != MAGIC) || (header.version != VERSION))
+    {
+        return false;
+    }
+
+    records.resize(header.count);
+    return std::fread(records.data(), sizeof(record_t), records.size(), f.get()) == records.size();
+}
+
+/**
+ * Records the input events handled by core, after plugins and core have processed them.
+ *
+ * Pointer motion is recorded as the resulting cursor position, so that a replay does not depend on the
+ * pointer acceleration settings. Axis, gesture and tablet events are not recorded.
+ */
+class recorder_t
+{
+  public:
+    void start()
+    {
+        records.clear();
+        start_time = wf::get_current_time_us();
+        wf::get_core().connect(&on_key);
+        wf::get_core().connect(&on_button);
+        wf::get_core().connect(&on_motion);
+        wf::get_core().connect(&on_motion_absolute);
+        wf::get_core().connect(&on_touch_down);
+        wf::get_core().connect(&on_touch_motion);
+        wf::get_core().connect(&on_touch_up);
+        running = true;
+    }
+
+    /** Stop recording and return the recorded events. */
+    std::vector<record_t> stop()
+    {
+        on_key.disconnect();
+        on_button.disconnect();
+        on_motion.disconnect();
+        on_motion_absolute.disconnect();
+        on_touch_down.disconnect();
+        on_touch_motion.disconnect();
+        on_touch_up.disconnect();
+        running = false;
+        return std::move(records);
+    }
+
+    bool is_running() const
+    {
+        return running;
+    }
+
+    size_t size() const
+    {
+        return records.size();
+    }
+
+  private:
+    bool running = false;
+    int64_t start_time = 0;
+    std::vector<record_t> records;
+
+    void add(record_type_t type, uint8_t state, int32_t code, wf::pointf_t position = {0, 0})
+    {
+        record_t record;
+        record.time_us = wf::get_current_time_us() - start_time;
+        record.type    = type;
+        record.state   = state;
+        record.code    = code;
+        record.x = position.x;
+        record.y = position.y;
+        records.push_back(record);
+    }
+
+    void add_finger(int32_t id)
+    {
+        auto& fingers = wf::get_core().get_touch_state().fingers;
+        auto it = fingers.find(id);
+        if (it != fingers.end())
+        {
+            add(RECORD_TOUCH, 1, id, {it->second.current.x, it->second.current.y});
+        }
+    }
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_keyboard_key_event>> on_key =
+        [=] (wf::post_input_event_signal<wlr_keyboard_key_event> *ev)
+    {
+        add(RECORD_KEY, ev->event->state == WL_KEYBOARD_KEY_STATE_PRESSED, ev->event->keycode);
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_button_event>> on_button =
+        [=] (wf::post_input_event_signal<wlr_pointer_button_event> *ev)
+    {
+        add(RECORD_BUTTON, ev->event->state == WL_POINTER_BUTTON_STATE_PRESSED, ev->event->button);
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion =
+        [=] (wf::post_input_event_signal<wlr_pointer_motion_event> *ev)
+    {
+        add(RECORD_MOTION, 0, 0, wf::get_core().get_cursor_position());
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_absolute_event>>
+    on_motion_absolute = [=] (wf::post_input_event_signal<wlr_pointer_motion_absolute_event> *ev)
+    {
+        add(RECORD_MOTION, 0, 0, wf::get_core().get_cursor_position());
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_down_event>> on_touch_down =
+        [=] (wf::post_input_event_signal<wlr_touch_down_event> *ev)
+    {
+        add_finger(ev->event->touch_id);
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_motion_event>> on_touch_motion =
+        [=] (wf::post_input_event_signal<wlr_touch_motion_event> *ev)
+    {
+        add_finger(ev->event->touch_id);
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_up_event>> on_touch_up =
+        [=] (wf::post_input_event_signal<wlr_touch_up_event> *ev)
+    {
+        add(RECORD_TOUCH_UP, 0, ev->event->touch_id);
+    };
+};
+
+/**
+ * Feeds a recorded trace back to core, at the original timing or sped up.
+ *
+ * The events are scheduled relative to the start of the replay, so that delays in the event loop do not
+ * accumulate. Events which are due within the same millisecond are fed together.
+ *
+ * The frame counters of the outputs are captured when the replay starts, so that the statistics at the end
+ * can report the frames rendered during the replay.
+ */
+class replayer_t
+{
+  public:
+    using feed_callback_t = std::function<void (const record_t&)>;
+
+    void start(std::vector<record_t> trace, double speed, feed_callback_t feed)
+    {
+        stop();
+        this->records = std::move(trace);
+        this->speed   = speed;
+        this->feed    = std::move(feed);
+        this->next    = 0;
+        this->start_time = wf::get_current_time_us();
+
+        initial_stats.clear();
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            initial_stats[wo->get_id()] = wo->render->get_frame_stats();
+        }
+
+        running = true;
+        schedule_next();
+    }
+
+    void stop()
+    {
+        timer.disconnect();
+        if (running)
+        {
+            running  = false;
+            duration = wf::get_current_time_us() - start_time;
+        }
+    }
+
+    bool is_running() const
+    {
+        return running;
+    }
+
+    nlohmann::json get_status() const
+    {
+        nlohmann::json status;
+        status["running"]  = running;
+        status["fed"]      = next;
+        status["total"]    = records.size();
+        status["speed"]    = speed;
+        status["duration"] = running ? (wf::get_current_time_us() - start_time) : duration;
+        status["outputs"]  = nlohmann::json::array();
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            auto stats = wo->render->get_frame_stats();
+            const auto& render = stats.stages[wf::FRAME_STAGE_RENDER];
+
+            nlohmann::json j;
+            j["output-id"]   = wo->get_id();
+            j["output-name"] = wo->to_string();
+            auto it = initial_stats.find(wo->get_id());
+            j["frames"]      = stats.total_frames - (it != initial_stats.end() ? it->second.total_frames : 0);
+            j["late-frames"] = stats.late_frames - (it != initial_stats.end() ? it->second.late_frames : 0);
+            j["render"]["p50"] = render.p50;
+            j["render"]["p95"] = render.p95;
+            j["render"]["p99"] = render.p99;
+            j["render"]["max"] = render.max;
+            status["outputs"].push_back(j);
+        }
+
+        return status;
+    }
+
+  private:
+    bool running = false;
+    double speed = 1.0;
+    size_t next  = 0;
+    int64_t start_time = 0;
+    int64_t duration   = 0;
+    std::vector<record_t> records;
+    feed_callback_t feed;
+    std::map<uint64_t, wf::frame_stats_t> initial_stats;
+    wf::wl_timer<false> timer;
+
+    int64_t due_time(const record_t& record) const
+    {
+        return start_time + (int64_t)(record.time_us / speed);
+    }
+
+    void schedule_next()
+    {
+        if (next >= records.size())
+        {
+            stop();
+            LOGI("stipc: replayed ", records.size(), " input events");
+            return;
+        }
+
+        const int64_t delay_us = due_time(records[next]) - wf::get_current_time_us();
+        timer.set_timeout(std::max<int64_t>(1, delay_us / 1000), [=] ()
+        {
+            const int64_t now = wf::get_current_time_us() + 500;
+            while ((next < records.size()) && (due_time(records[next]) <= now))
+            {
+                feed(records[next++]);
+            }
+
+            schedule_next();
+        });
+    }
+};
+}
+}
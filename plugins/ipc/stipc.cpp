@@ -1,4 +1,5 @@
 #include "ipc-method-repository.hpp"
+#include "stipc-input-trace.hpp"
 #include "wayfire/plugin.hpp"
 #include "wayfire/plugins/common/shared-core-data.hpp"
 #include "wayfire/toplevel-view.hpp"
@@ -305,6 +306,13 @@ class stipc_plugin_t : public wf::plugin_interface_t
         method_repository->register_method("stipc/delay_next_tx", delay_next_tx);
         method_repository->register_method("stipc/get_xwayland_pid", get_xwayland_pid);
         method_repository->register_method("stipc/get_xwayland_display", get_xwayland_display);
+        method_repository->register_method("stipc/get_xwayland_stats", get_xwayland_stats);
+        method_repository->register_method("stipc/get_configure_stats", get_configure_stats);
+        method_repository->register_method("stipc/record_start", record_start);
+        method_repository->register_method("stipc/record_stop", record_stop);
+        method_repository->register_method("stipc/replay", replay);
+        method_repository->register_method("stipc/replay_stop", replay_stop);
+        method_repository->register_method("stipc/replay_status", replay_status);
     }
 
     bool is_unloadable() override
@@ -645,6 +653,26 @@ class stipc_plugin_t : public wf::plugin_interface_t
         return response;
     };
 
+    ipc::method_callback get_xwayland_stats = [=] (nlohmann::json)
+    {
+        auto stats    = wf::xwayland_get_stats();
+        auto response = wf::ipc::json_ok();
+        response["lazy"]      = stats.lazy;
+        response["prewarmed"] = stats.prewarmed;
+        response["started"]   = stats.started;
+        response["startup-latency-ms"] = stats.startup_latency_ms;
+        response["first-surface-ms"]   = stats.first_surface_ms;
+        response["memory-kb"] = stats.memory_kb;
+        return response;
+    };
+
+    ipc::method_callback get_configure_stats = [=] (nlohmann::json)
+    {
+        auto response = wf::ipc::json_ok();
+        response["suppressed"] = wf::get_suppressed_configure_count();
+        return response;
+    };
+
     ipc::method_callback get_xwayland_display = [=] (nlohmann::json)
     {
         auto response = wf::ipc::json_ok();
@@ -652,6 +680,124 @@ class stipc_plugin_t : public wf::plugin_interface_t
         return response;
     };
 
+    input_trace::recorder_t recorder;
+    input_trace::replayer_t replayer;
+
+    /**
+     * Start recording the input events handled by core, see input_trace::recorder_t.
+     */
+    ipc::method_callback record_start = [=] (nlohmann::json)
+    {
+        if (replayer.is_running())
+        {
+            return wf::ipc::json_error("cannot record while a trace is being replayed");
+        }
+
+        recorder.start();
+        return wf::ipc::json_ok();
+    };
+
+    /**
+     * Stop recording and write the trace to the given file.
+     */
+    ipc::method_callback record_stop = [=] (nlohmann::json data)
+    {
+        WFJSON_EXPECT_FIELD(data, "file", string);
+        if (!recorder.is_running())
+        {
+            return wf::ipc::json_error("not recording");
+        }
+
+        auto records = recorder.stop();
+        if (!input_trace::write_trace(data["file"], records))
+        {
+            return wf::ipc::json_error("failed to write the trace file");
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["events"]   = records.size();
+        response["duration"] = records.empty() ? 0 : records.back().time_us;
+        return response;
+    };
+
+    void feed_record(const input_trace::record_t& record)
+    {
+        switch (record.type)
+        {
+          case input_trace::RECORD_KEY:
+            input->do_key(record.code, record.state ?
+                WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED);
+            break;
+
+          case input_trace::RECORD_BUTTON:
+            input->do_button(record.code, record.state ?
+                WL_POINTER_BUTTON_STATE_PRESSED : WL_POINTER_BUTTON_STATE_RELEASED);
+            break;
+
+          case input_trace::RECORD_MOTION:
+            input->do_motion(record.x, record.y);
+            break;
+
+          case input_trace::RECORD_TOUCH:
+            input->do_touch(record.code, record.x, record.y);
+            break;
+
+          case input_trace::RECORD_TOUCH_UP:
+            input->do_touch_release(record.code);
+            break;
+        }
+    }
+
+    /**
+     * Replay a recorded trace through the stipc input devices.
+     *
+     * Arguments: file, and optionally speed (default 1.0, higher values replay faster). The replay runs
+     * asynchronously, its progress and the frame statistics are reported by stipc/replay_status.
+     */
+    ipc::method_callback replay = [=] (nlohmann::json data)
+    {
+        WFJSON_EXPECT_FIELD(data, "file", string);
+        WFJSON_OPTIONAL_FIELD(data, "speed", number);
+        const double speed = data.value("speed", 1.0);
+        if (speed <= 0)
+        {
+            return wf::ipc::json_error("speed must be positive");
+        }
+
+        if (recorder.is_running())
+        {
+            return wf::ipc::json_error("cannot replay while recording");
+        }
+
+        std::vector<input_trace::record_t> records;
+        if (!input_trace::read_trace(data["file"], records))
+        {
+            return wf::ipc::json_error("failed to read the trace file");
+        }
+
+        replayer.start(std::move(records), speed, [=] (const input_trace::record_t& record)
+        {
+            feed_record(record);
+        });
+
+        return wf::ipc::json_ok();
+    };
+
+    ipc::method_callback replay_stop = [=] (nlohmann::json)
+    {
+        replayer.stop();
+        auto response = wf::ipc::json_ok();
+        response["status"] = replayer.get_status();
+        return response;
+    };
+
+    ipc::method_callback replay_status = [=] (nlohmann::json)
+    {
+        auto response = wf::ipc::json_ok();
+        response["status"] = replayer.get_status();
+        return response;
+    };
+
     std::unique_ptr<headless_input_backend_t> input;
 };
 }
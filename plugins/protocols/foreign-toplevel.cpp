@@ -2,8 +2,11 @@
 #include "wayfire/signal-definitions.hpp"
 #include <wayfire/output-layout.hpp>
 #include "wayfire/view.hpp"
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <wayfire/plugin.hpp>
+#include <wayfire/util.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/toplevel-view.hpp>
 #include <wayfire/window-manager.hpp>
@@ -35,13 +38,14 @@ class wayfire_foreign_toplevel
         toplevel_handle_v1_fullscreen_request.connect(&handle->events.request_fullscreen);
         toplevel_handle_v1_set_rectangle_request.connect(&handle->events.set_rectangle);
 
-        toplevel_send_title();
-        toplevel_send_app_id();
-        toplevel_send_state();
-        toplevel_update_output(view->get_output(), true);
+        // The initial state is sent right away, so that clients never see an empty handle.
+        pending_updates = UPDATE_ALL;
+        flush_updates();
 
         view->connect(&on_title_changed);
         view->connect(&on_app_id_changed);
+        view->connect(&on_gtk_app_id_changed);
+        app_id_mode.set_callback([=] { schedule_update(UPDATE_APP_ID); });
 
         view->connect(&on_set_output);
         view->connect(&on_tiled);
@@ -63,9 +67,69 @@ class wayfire_foreign_toplevel
     }
 
   private:
+    /**
+     * Changes to the view are not sent right away, but collected and flushed once per event loop
+     * iteration. Clients like browsers change their title many times in a row, and a single action may
+     * change several parts of the state at once. wlroots then sends a single done event for the flush.
+     */
+    enum update_flags_t
+    {
+        UPDATE_TITLE  = (1 << 0),
+        UPDATE_APP_ID = (1 << 1),
+        UPDATE_STATE  = (1 << 2),
+        UPDATE_OUTPUT = (1 << 3),
+        UPDATE_ALL    = UPDATE_TITLE | UPDATE_APP_ID | UPDATE_STATE | UPDATE_OUTPUT,
+    };
+
+    uint32_t pending_updates = 0;
+    wf::wl_idle_call idle_flush_updates;
+
+    // The values last sent to the clients, used to skip updates which do not change anything.
+    std::optional<std::string> sent_title;
+    std::optional<std::string> sent_app_id;
+    wlr_output *sent_output = nullptr;
+
+    void schedule_update(uint32_t updates)
+    {
+        pending_updates |= updates;
+        idle_flush_updates.run_once([=] () { flush_updates(); });
+    }
+
+    void flush_updates()
+    {
+        idle_flush_updates.disconnect();
+        const uint32_t updates = pending_updates;
+        pending_updates = 0;
+
+        if (updates & UPDATE_TITLE)
+        {
+            toplevel_send_title();
+        }
+
+        if (updates & UPDATE_APP_ID)
+        {
+            toplevel_send_app_id();
+        }
+
+        if (updates & UPDATE_STATE)
+        {
+            toplevel_send_state();
+        }
+
+        if (updates & UPDATE_OUTPUT)
+        {
+            toplevel_send_output();
+        }
+    }
+
     void toplevel_send_title()
     {
-        wlr_foreign_toplevel_handle_v1_set_title(handle, view->get_title().c_str());
+        auto title = view->get_title();
+        if (title != sent_title)
+        {
+            wlr_foreign_toplevel_handle_v1_set_title(handle, title.c_str());
+            sent_title = std::move(title);
+        }
     }
 
     void toplevel_send_app_id()
@@ -74,15 +138,15 @@ class wayfire_foreign_toplevel
 
         auto default_app_id = view->get_app_id();
 
-        gtk_shell_app_id_query_signal ev;
-        ev.view = view;
-        wf::get_core().emit(&ev);
-        std::string app_id_mode = wf::option_wrapper_t<std::string>("workarounds/app_id_mode");
+        // Set by the gtk-shell plugin, if the client used gtk-shell.
+        auto gtk_data = view->get_data<gtk_shell_view_data_t>();
+        std::string gtk_app_id = gtk_data ? gtk_data->app_id : "";
+        const std::string mode = app_id_mode;
 
-        if ((app_id_mode == "gtk-shell") && (ev.app_id.length() > 0))
+        if ((mode == "gtk-shell") && (gtk_app_id.length() > 0))
         {
-            app_id = ev.app_id;
-        } else if (app_id_mode == "full")
+            app_id = gtk_app_id;
+        } else if (mode == "full")
         {
 #if WF_HAS_XWAYLAND
             auto wlr_surface = view->get_wlr_surface();
@@ -91,21 +155,26 @@ class wayfire_foreign_toplevel
                 if (wlr_xwayland_surface *xw_surface =
                         wlr_xwayland_surface_try_from_wlr_surface(wlr_surface))
                 {
-                    ev.app_id = nonull(xw_surface->instance);
+                    gtk_app_id = nonull(xw_surface->instance);
                 }
             }
 
 #endif
 
-            app_id = default_app_id + " " + ev.app_id;
+            app_id = default_app_id + " " + gtk_app_id;
         } else
         {
             app_id = default_app_id;
         }
 
-        wlr_foreign_toplevel_handle_v1_set_app_id(handle, app_id.c_str());
+        if (app_id != sent_app_id)
+        {
+            wlr_foreign_toplevel_handle_v1_set_app_id(handle, app_id.c_str());
+            sent_app_id = std::move(app_id);
+        }
     }
 
+    // wlroots sends the state and parent only if they changed.
     void toplevel_send_state()
     {
         wlr_foreign_toplevel_handle_v1_set_maximized(handle,
@@ -125,58 +194,76 @@ class wayfire_foreign_toplevel
         }
     }
 
-    void toplevel_update_output(wf::output_t *output, bool enter)
+    void toplevel_send_output()
     {
-        if (output && enter)
+        auto output = view->get_output() ? view->get_output()->handle : nullptr;
+        if (output == sent_output)
         {
-            wlr_foreign_toplevel_handle_v1_output_enter(handle, output->handle);
+            return;
         }
 
-        if (output && !enter)
+        // The previous output may have been destroyed in the meantime, in which case wlroots already sent
+        // the leave event.
+        auto outputs = wf::get_core().output_layout->get_outputs();
+        if (sent_output && std::any_of(outputs.begin(), outputs.end(),
+            [=] (wf::output_t *wo) { return wo->handle == sent_output; }))
         {
-            wlr_foreign_toplevel_handle_v1_output_leave(handle, output->handle);
+            wlr_foreign_toplevel_handle_v1_output_leave(handle, sent_output);
         }
+
+        if (output)
+        {
+            wlr_foreign_toplevel_handle_v1_output_enter(handle, output);
+        }
+
+        sent_output = output;
     }
 
     wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed = [=] (auto)
     {
-        toplevel_send_title();
+        schedule_update(UPDATE_TITLE);
     };
 
     wf::signal::connection_t<wf::view_app_id_changed_signal> on_app_id_changed = [=] (auto)
     {
-        toplevel_send_app_id();
+        schedule_update(UPDATE_APP_ID);
     };
 
-    wf::signal::connection_t<wf::view_set_output_signal> on_set_output = [=] (wf::view_set_output_signal *ev)
+    wf::signal::connection_t<gtk_shell_app_id_changed_signal> on_gtk_app_id_changed = [=] (auto)
+    {
+        schedule_update(UPDATE_APP_ID);
+    };
+
+    wf::option_wrapper_t<std::string> app_id_mode{"workarounds/app_id_mode"};
+
+    wf::signal::connection_t<wf::view_set_output_signal> on_set_output = [=] (auto)
     {
-        toplevel_update_output(ev->output, false);
-        toplevel_update_output(view->get_output(), true);
+        schedule_update(UPDATE_OUTPUT);
     };
 
     wf::signal::connection_t<wf::view_minimized_signal> on_minimized = [=] (auto)
     {
-        toplevel_send_state();
+        schedule_update(UPDATE_STATE);
     };
 
     wf::signal::connection_t<wf::view_fullscreen_signal> on_fullscreen = [=] (auto)
     {
-        toplevel_send_state();
+        schedule_update(UPDATE_STATE);
     };
 
     wf::signal::connection_t<wf::view_tiled_signal> on_tiled = [=] (auto)
     {
-        toplevel_send_state();
+        schedule_update(UPDATE_STATE);
     };
 
     wf::signal::connection_t<wf::view_activated_state_signal> on_activated = [=] (auto)
     {
-        toplevel_send_state();
+        schedule_update(UPDATE_STATE);
     };
 
     wf::signal::connection_t<wf::view_parent_changed_signal> on_parent_changed = [=] (auto)
     {
-        toplevel_send_state();
+        schedule_update(UPDATE_STATE);
     };
 
     wf::wl_listener_wrapper toplevel_handle_v1_maximize_request;
@@ -18,9 +18,27 @@
 class wf_gtk_shell : public wf::custom_data_t
 {
   public:
+    // App-ids of surfaces which do not have a view yet, moved to the view when it is mapped.
     std::map<wl_resource*, std::string> surface_app_id;
 };
 
+/**
+ * Store the app_id on the view, where other plugins can read it, and notify them if it changed.
+ */
+static void set_view_gtk_app_id(wayfire_view view, const std::string& app_id)
+{
+    auto data = view->get_data_safe<gtk_shell_view_data_t>();
+    if (data->app_id == app_id)
+    {
+        return;
+    }
+
+    data->app_id = app_id;
+    gtk_shell_app_id_changed_signal ev;
+    ev.view = view;
+    view->emit(&ev);
+}
+
 struct wf_gtk_surface
 {
     wl_resource *resource;
@@ -41,7 +59,16 @@ static void handle_gtk_surface_set_dbus_properties(wl_client *client,
     const char *unique_bus_name)
 {
     auto surface = static_cast<wf_gtk_surface*>(wl_resource_get_user_data(resource));
-    if (application_id)
+    if (!application_id)
+    {
+        return;
+    }
+
+    wayfire_view view = wf::wl_surface_to_wayfire_view(surface->wl_surface);
+    if (view && view->is_mapped())
+    {
+        set_view_gtk_app_id(view, application_id);
+    } else
     {
         wf::get_core().get_data_safe<wf_gtk_shell>()->surface_app_id[surface->wl_surface] = application_id;
     }
@@ -225,6 +252,7 @@ static void handle_xdg_surface_on_destroy(wf_gtk_surface *surface)
 static void handle_gtk_surface_destroy(wl_resource *resource)
 {
     auto surface = static_cast<wf_gtk_surface*>(wl_resource_get_user_data(resource));
+    wf::get_core().get_data_safe<wf_gtk_shell>()->surface_app_id.erase(surface->wl_surface);
     delete surface;
 }
 
@@ -341,6 +369,7 @@ class wayfire_gtk_shell_impl : public wf::plugin_interface_t
         auto display = wf::get_core().display;
         wl_global_create(display, &gtk_shell1_interface, GTK_SHELL_VERSION, NULL, bind_gtk_shell1);
         wf::get_core().connect(&on_app_id_query);
+        wf::get_core().connect(&on_view_mapped);
     }
 
     bool is_unloadable() override
@@ -351,10 +380,26 @@ class wayfire_gtk_shell_impl : public wf::plugin_interface_t
     wf::signal::connection_t<gtk_shell_app_id_query_signal> on_app_id_query =
         [=] (gtk_shell_app_id_query_signal *ev)
     {
-        if (auto surface = ev->view->get_wlr_surface())
+        if (auto data = ev->view->get_data<gtk_shell_view_data_t>())
+        {
+            ev->app_id = data->app_id;
+        }
+    };
+
+    wf::signal::connection_t<wf::view_mapped_signal> on_view_mapped = [=] (wf::view_mapped_signal *ev)
+    {
+        auto surface = ev->view->get_wlr_surface();
+        if (!surface)
+        {
+            return;
+        }
+
+        auto shell = wf::get_core().get_data_safe<wf_gtk_shell>();
+        auto it    = shell->surface_app_id.find(surface->resource);
+        if (it != shell->surface_app_id.end())
         {
-            auto shell = wf::get_core().get_data_safe<wf_gtk_shell>();
-            ev->app_id = shell->surface_app_id[surface->resource];
+            set_view_gtk_app_id(ev->view, it->second);
+            shell->surface_app_id.erase(it);
         }
     };
 };
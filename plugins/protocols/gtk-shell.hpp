@@ -1,9 +1,30 @@
 #pragma once
 
 #include <wayfire/view.hpp>
+#include <wayfire/object.hpp>
+
+/**
+ * The gtk-shell-specific properties of a view, stored on the view by the gtk_shell plugin.
+ * Other plugins can read them with view->get_data<gtk_shell_view_data_t>(), which is nullptr if the client
+ * never set any of them.
+ */
+struct gtk_shell_view_data_t : public wf::custom_data_t
+{
+    std::string app_id;
+};
+
+/**
+ * on: view
+ * when: After the gtk-shell app_id of the view changed, see gtk_shell_view_data_t.
+ */
+struct gtk_shell_app_id_changed_signal
+{
+    wayfire_view view;
+};
 
 /**
  * A signal to query the gtk_shell plugin about the gtk-shell-specific app_id of the given view.
+ * Prefer gtk_shell_view_data_t, which does not require a round trip through the core.
  */
 struct gtk_shell_app_id_query_signal
 {
@@ -0,0 +1,917 @@
+#include "ext-image-capture-source-v1-protocol.h"
+#include "ext-image-copy-capture-v1-protocol.h"
+#include <wayfire/core.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/plugin.hpp>
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/toplevel-view.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <wlr/types/wlr_ext_foreign_toplevel_list_v1.h>
+
+#include <drm_fourcc.h>
+#include <sys/stat.h>
+#include <cmath>
+#include <map>
+#include <memory>
+
+#define IMAGE_CAPTURE_VERSION 1
+
+/**
+ * An implementation of ext-image-capture-source-v1 and ext-image-copy-capture-v1, with output sources and
+ * toplevel sources (toplevels are identified by the handles of ext-foreign-toplevel-list-v1).
+ *
+ * A session keeps render instances of the captured node, so that it knows the damage of the node itself. A
+ * toplevel is captured by rendering only its surfaces (like view snapshots) into the client's buffer, and
+ * only the damaged part of it. Frames are not captured until the source has new damage, so capturing a
+ * small window costs nothing while the rest of the screen changes.
+ *
+ * DMA-BUF client buffers are rendered into directly. SHM buffers are rendered into a framebuffer kept by the
+ * session, and only the damaged rectangles are read back.
+ */
+
+namespace
+{
+/** What a capture source captures: the surfaces of a view, or the whole contents of an output. */
+struct capture_target_t
+{
+    std::weak_ptr<wf::view_interface_t> view;
+    wf::output_t *output = nullptr;
+};
+
+capture_target_t *target_from_resource(wl_resource *resource)
+{
+    return static_cast<capture_target_t*>(wl_resource_get_user_data(resource));
+}
+
+/** Render in the orientation of wlr_buffers, i.e. with the first row at the top, see render-manager.cpp. */
+void setup_buffer_orientation(wf::render_target_t& target)
+{
+    target.wl_transform = WL_OUTPUT_TRANSFORM_FLIPPED_180;
+    target.transform    = get_output_matrix_from_transform(WL_OUTPUT_TRANSFORM_FLIPPED_180);
+}
+
+class capture_session_t;
+
+class capture_frame_t
+{
+  public:
+    wl_resource *resource;
+    capture_session_t *session;
+    wlr_buffer *buffer = nullptr;
+    // Damage sent by the client: the parts of the buffer which it considers outdated, in buffer coordinates.
+    wf::region_t buffer_damage;
+    bool captured = false;
+
+    capture_frame_t(wl_client *client, uint32_t id, capture_session_t *session);
+    ~capture_frame_t();
+
+    void fail(ext_image_copy_capture_frame_v1_failure_reason reason)
+    {
+        ext_image_copy_capture_frame_v1_send_failed(resource, reason);
+        finish();
+    }
+
+    /** The frame has been captured or failed, it cannot be used anymore. */
+    void finish();
+};
+
+class capture_session_t
+{
+  public:
+    wl_resource *resource;
+    capture_frame_t *frame = nullptr;
+
+    capture_session_t(wl_client *client, uint32_t version, uint32_t id, const capture_target_t *target);
+
+    ~capture_session_t()
+    {
+        if (frame)
+        {
+            frame->session = nullptr;
+        }
+
+        OpenGL::render_begin();
+        shm_fb.release();
+        OpenGL::render_end();
+    }
+
+    /** A frame was submitted for capture. */
+    void schedule_capture()
+    {
+        if (stopped)
+        {
+            frame->fail(EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED);
+            return;
+        }
+
+        if (needs_full_frame || !damage.empty() || !frame->buffer_damage.empty())
+        {
+            idle_capture.run_once([=] () { capture(); });
+        }
+    }
+
+  private:
+    capture_target_t target;
+    bool stopped = false;
+
+    wf::dimensions_t buffer_size = {0, 0};
+    float scale = 1.0;
+    // Damage of the captured node since the last captured frame, in the coordinate system of the node.
+    wf::region_t damage;
+    // Whether the whole source has to be sent with the next frame, e.g. for the first frame.
+    bool needs_full_frame = true;
+
+    std::vector<wf::scene::render_instance_uptr> instances;
+    // SHM buffers are rendered here and read back. It always has the latest contents of the source.
+    wf::framebuffer_t shm_fb;
+    bool shm_fb_valid = false;
+
+    wf::wl_idle_call idle_capture;
+
+    wf::signal::connection_t<wf::scene::root_node_update_signal> on_root_update =
+        [=] (wf::scene::root_node_update_signal *ev)
+    {
+        if (!(ev->flags & wf::scene::update_flag::MASKED) &&
+            (ev->flags & (wf::scene::update_flag::CHILDREN_LIST | wf::scene::update_flag::ENABLED)))
+        {
+            regenerate_instances();
+        }
+    };
+
+    wf::signal::connection_t<wf::view_unmapped_signal> on_view_unmapped = [=] (wf::view_unmapped_signal *ev)
+    {
+        stop();
+    };
+
+    wf::signal::connection_t<wf::view_set_output_signal> on_view_set_output = [=] (wf::view_set_output_signal*)
+    {
+        regenerate_instances();
+    };
+
+    wf::signal::connection_t<wf::output_removed_signal> on_output_removed = [=] (wf::output_removed_signal *ev)
+    {
+        if (ev->output == target.output)
+        {
+            stop();
+        }
+    };
+
+    wayfire_view get_view() const
+    {
+        auto view = target.view.lock();
+        return view ? wayfire_view{view.get()} : nullptr;
+    }
+
+    /** @return The output whose scale is used, and for which render instances are generated. */
+    wf::output_t *get_output() const
+    {
+        if (auto view = get_view())
+        {
+            return view->get_output();
+        }
+
+        return target.output;
+    }
+
+    wf::scene::node_ptr get_node() const
+    {
+        if (auto view = get_view())
+        {
+            return view->get_surface_root_node();
+        }
+
+        return wf::get_core().scene();
+    }
+
+    /** @return The captured area, in the coordinate system of the captured node. */
+    wf::geometry_t get_geometry() const
+    {
+        if (auto view = get_view())
+        {
+            return view->get_surface_root_node()->get_bounding_box();
+        }
+
+        return target.output->get_layout_geometry();
+    }
+
+    void stop()
+    {
+        if (stopped)
+        {
+            return;
+        }
+
+        stopped = true;
+        instances.clear();
+        on_root_update.disconnect();
+        on_view_unmapped.disconnect();
+        on_view_set_output.disconnect();
+        on_output_removed.disconnect();
+        idle_capture.disconnect();
+        ext_image_copy_capture_session_v1_send_stopped(resource);
+        if (frame && frame->captured)
+        {
+            frame->fail(EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED);
+        }
+    }
+
+  public:
+    void start()
+    {
+        if (!get_view() && !target.output)
+        {
+            // The source is inert, e.g. the toplevel was already closed.
+            stop();
+            return;
+        }
+
+        if (auto view = get_view())
+        {
+            view->connect(&on_view_unmapped);
+            view->connect(&on_view_set_output);
+        } else
+        {
+            wf::get_core().output_layout->connect(&on_output_removed);
+        }
+
+        wf::get_core().scene()->connect(&on_root_update);
+        regenerate_instances();
+        update_constraints();
+    }
+
+  private:
+    void regenerate_instances()
+    {
+        instances.clear();
+        auto output = get_output();
+        if (!output)
+        {
+            return;
+        }
+
+        get_node()->gen_render_instances(instances, [=] (const wf::region_t& region)
+        {
+            damage |= region;
+            if (frame && frame->captured)
+            {
+                schedule_capture();
+            }
+        }, output);
+
+        needs_full_frame = true;
+        if (frame && frame->captured)
+        {
+            schedule_capture();
+        }
+    }
+
+    /** Send the buffer constraints if the size of the source changed. @return Whether they changed. */
+    bool update_constraints()
+    {
+        auto output = get_output();
+        const float new_scale = output ? output->handle->scale : 1.0;
+        const auto geometry   = get_geometry();
+        const wf::dimensions_t new_size = {
+            std::max(1, (int)std::ceil(geometry.width * new_scale)),
+            std::max(1, (int)std::ceil(geometry.height * new_scale)),
+        };
+
+        if ((new_size == buffer_size) && (new_scale == scale))
+        {
+            return false;
+        }
+
+        buffer_size = new_size;
+        scale = new_scale;
+        needs_full_frame = true;
+        shm_fb_valid     = false;
+
+        ext_image_copy_capture_session_v1_send_buffer_size(resource, buffer_size.width, buffer_size.height);
+        ext_image_copy_capture_session_v1_send_shm_format(resource, WL_SHM_FORMAT_ARGB8888);
+        ext_image_copy_capture_session_v1_send_shm_format(resource, WL_SHM_FORMAT_XRGB8888);
+
+        auto renderer = wf::get_core().renderer;
+        struct stat dev_stat;
+        const int drm_fd = wlr_renderer_get_drm_fd(renderer);
+        if ((drm_fd >= 0) && (fstat(drm_fd, &dev_stat) == 0))
+        {
+            wl_array device;
+            wl_array_init(&device);
+            auto dev = (dev_t*)wl_array_add(&device, sizeof(dev_t));
+            *dev = dev_stat.st_rdev;
+            ext_image_copy_capture_session_v1_send_dmabuf_device(resource, &device);
+            wl_array_release(&device);
+
+            auto formats = wlr_renderer_get_render_formats(renderer);
+            for (size_t i = 0; formats && (i < formats->len); i++)
+            {
+                const auto& format = formats->formats[i];
+                wl_array modifiers;
+                wl_array_init(&modifiers);
+                for (size_t j = 0; j < format.len; j++)
+                {
+                    *(uint64_t*)wl_array_add(&modifiers, sizeof(uint64_t)) = format.modifiers[j];
+                }
+
+                ext_image_copy_capture_session_v1_send_dmabuf_format(resource, format.format, &modifiers);
+                wl_array_release(&modifiers);
+            }
+        }
+
+        ext_image_copy_capture_session_v1_send_done(resource);
+        return true;
+    }
+
+    /** Convert a region in the coordinate system of the node to buffer coordinates. */
+    wf::region_t to_buffer(const wf::region_t& region, wf::geometry_t geometry) const
+    {
+        wf::region_t result = ((region & geometry) + -wf::origin(geometry)) * scale;
+        return result & wf::geometry_t{0, 0, buffer_size.width, buffer_size.height};
+    }
+
+    /** Convert a region in buffer coordinates to the coordinate system of the node. */
+    wf::region_t from_buffer(const wf::region_t& region, wf::geometry_t geometry) const
+    {
+        return (region * (1.0 / scale)) + wf::origin(geometry);
+    }
+
+    /** Render the given damage of the node into the given render target. */
+    void render(wf::render_target_t target, const wf::region_t& render_damage, wf::geometry_t geometry)
+    {
+        target.geometry = geometry;
+        target.scale    = scale;
+        target.viewport_width  = buffer_size.width;
+        target.viewport_height = buffer_size.height;
+        setup_buffer_orientation(target);
+
+        wf::scene::render_pass_params_t params;
+        params.instances = &instances;
+        params.damage    = render_damage;
+        params.target    = target;
+        params.background_color = {0, 0, 0, 0};
+        params.reference_output = get_output();
+        wf::scene::run_render_pass(params, wf::scene::RPASS_CLEAR_BACKGROUND);
+    }
+
+    bool render_dmabuf(wlr_buffer *buffer, const wf::region_t& render_damage, wf::geometry_t geometry)
+    {
+        OpenGL::render_begin();
+        GLuint fbo = wlr_gles2_renderer_get_buffer_fbo(wf::get_core().renderer, buffer);
+        OpenGL::render_end();
+        if (!fbo)
+        {
+            return false;
+        }
+
+        wf::render_target_t target;
+        target.fb = fbo;
+        render(target, render_damage, geometry);
+        OpenGL::render_begin();
+        GL_CALL(glFlush());
+        OpenGL::render_end();
+        return true;
+    }
+
+    bool render_shm(wlr_buffer *buffer, const wf::region_t& copy_damage, wf::geometry_t geometry)
+    {
+        OpenGL::gpu_memory_scope_t memory_scope{[] () { return OpenGL::gpu_memory_owner_t{"image-capture"}; }};
+        OpenGL::render_begin();
+        if (shm_fb.allocate(buffer_size.width, buffer_size.height))
+        {
+            shm_fb_valid = false;
+        }
+
+        OpenGL::render_end();
+
+        // The framebuffer is kept up to date with the damage of the source, and the client's buffer gets
+        // the rectangles it is missing.
+        wf::render_target_t target;
+        target.fb  = shm_fb.fb;
+        target.tex = shm_fb.tex;
+        render(target, shm_fb_valid ? damage : wf::region_t{geometry}, geometry);
+        shm_fb_valid = true;
+
+        void *data;
+        uint32_t format;
+        size_t stride;
+        if (!wlr_buffer_begin_data_ptr_access(buffer, WLR_BUFFER_DATA_PTR_ACCESS_WRITE, &data, &format, &stride))
+        {
+            return false;
+        }
+
+        OpenGL::render_begin();
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, shm_fb.fb));
+        GL_CALL(glPixelStorei(GL_PACK_ROW_LENGTH, stride / 4));
+        for (const auto& box : copy_damage)
+        {
+            const int width  = box.x2 - box.x1;
+            const int height = box.y2 - box.y1;
+            auto start = (uint8_t*)data + box.y1 * stride + box.x1 * 4;
+            GL_CALL(glReadPixels(box.x1, box.y1, width, height, GL_RGBA, GL_UNSIGNED_BYTE, start));
+
+            // GL gives us RGBA in memory, while ARGB8888/XRGB8888 are BGRA in memory.
+            for (int y = 0; y < height; y++)
+            {
+                auto pixel = start + y * stride;
+                for (int x = 0; x < width; x++, pixel += 4)
+                {
+                    std::swap(pixel[0], pixel[2]);
+                }
+            }
+        }
+
+        GL_CALL(glPixelStorei(GL_PACK_ROW_LENGTH, 0));
+        OpenGL::render_end();
+        wlr_buffer_end_data_ptr_access(buffer);
+        return true;
+    }
+
+    void capture()
+    {
+        if (!frame || !frame->captured || stopped)
+        {
+            return;
+        }
+
+        if (update_constraints())
+        {
+            // The client has to allocate a new buffer with the new size.
+            frame->fail(EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_BUFFER_CONSTRAINTS);
+            return;
+        }
+
+        auto buffer = frame->buffer;
+        if ((buffer->width != buffer_size.width) || (buffer->height != buffer_size.height))
+        {
+            frame->fail(EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_BUFFER_CONSTRAINTS);
+            return;
+        }
+
+        const auto geometry = get_geometry();
+        if (needs_full_frame)
+        {
+            damage |= geometry;
+        }
+
+        // The damage reported to the client: what changed since the last frame.
+        wf::region_t frame_damage = to_buffer(damage, geometry);
+        // What has to be written to the buffer: also the parts which the client considers outdated.
+        wf::region_t copy_damage = frame_damage | frame->buffer_damage;
+
+        bool ok;
+        wlr_dmabuf_attributes dmabuf;
+        wlr_shm_attributes shm;
+        if (wlr_buffer_get_dmabuf(buffer, &dmabuf))
+        {
+            ok = render_dmabuf(buffer, damage | from_buffer(frame->buffer_damage, geometry), geometry);
+        } else if (wlr_buffer_get_shm(buffer, &shm) &&
+                   ((shm.format == DRM_FORMAT_ARGB8888) || (shm.format == DRM_FORMAT_XRGB8888)))
+        {
+            ok = render_shm(buffer, copy_damage, geometry);
+        } else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            frame->fail(EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_BUFFER_CONSTRAINTS);
+            return;
+        }
+
+        damage.clear();
+        needs_full_frame = false;
+
+        ext_image_copy_capture_frame_v1_send_transform(frame->resource, WL_OUTPUT_TRANSFORM_NORMAL);
+        for (const auto& box : frame_damage)
+        {
+            ext_image_copy_capture_frame_v1_send_damage(frame->resource,
+                box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+        }
+
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        ext_image_copy_capture_frame_v1_send_presentation_time(frame->resource,
+            (uint64_t)now.tv_sec >> 32, now.tv_sec & 0xffffffff, now.tv_nsec);
+        ext_image_copy_capture_frame_v1_send_ready(frame->resource);
+        frame->finish();
+    }
+};
+
+/* ext_image_copy_capture_frame_v1 */
+
+void handle_frame_destroy(wl_client*, wl_resource *resource)
+{
+    wl_resource_destroy(resource);
+}
+
+void handle_frame_attach_buffer(wl_client*, wl_resource *resource, wl_resource *buffer_resource)
+{
+    auto frame = static_cast<capture_frame_t*>(wl_resource_get_user_data(resource));
+    if (!frame)
+    {
+        return;
+    }
+
+    if (frame->captured)
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_ALREADY_CAPTURED,
+            "attach_buffer sent after capture");
+        return;
+    }
+
+    auto buffer = wlr_buffer_try_from_resource(buffer_resource);
+    if (frame->buffer)
+    {
+        wlr_buffer_unlock(frame->buffer);
+    }
+
+    // wlr_buffer_try_from_resource() returns a locked buffer.
+    frame->buffer = buffer;
+}
+
+void handle_frame_damage_buffer(wl_client*, wl_resource *resource, int32_t x, int32_t y, int32_t width,
+    int32_t height)
+{
+    auto frame = static_cast<capture_frame_t*>(wl_resource_get_user_data(resource));
+    if (!frame)
+    {
+        return;
+    }
+
+    if (frame->captured)
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_ALREADY_CAPTURED,
+            "damage_buffer sent after capture");
+        return;
+    }
+
+    if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0))
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_INVALID_BUFFER_DAMAGE,
+            "invalid buffer damage");
+        return;
+    }
+
+    frame->buffer_damage |= wf::geometry_t{x, y, width, height};
+}
+
+void handle_frame_capture(wl_client*, wl_resource *resource)
+{
+    auto frame = static_cast<capture_frame_t*>(wl_resource_get_user_data(resource));
+    if (!frame)
+    {
+        return;
+    }
+
+    if (frame->captured)
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_ALREADY_CAPTURED,
+            "capture sent twice");
+        return;
+    }
+
+    if (!frame->buffer)
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_FRAME_V1_ERROR_NO_BUFFER,
+            "capture sent without a buffer");
+        return;
+    }
+
+    frame->captured = true;
+    if (!frame->session)
+    {
+        frame->fail(EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED);
+        return;
+    }
+
+    frame->session->schedule_capture();
+}
+
+const struct ext_image_copy_capture_frame_v1_interface frame_impl = {
+    .destroy = handle_frame_destroy,
+    .attach_buffer = handle_frame_attach_buffer,
+    .damage_buffer = handle_frame_damage_buffer,
+    .capture = handle_frame_capture,
+};
+
+void handle_frame_resource_destroy(wl_resource *resource)
+{
+    delete static_cast<capture_frame_t*>(wl_resource_get_user_data(resource));
+}
+
+capture_frame_t::capture_frame_t(wl_client *client, uint32_t id, capture_session_t *session) :
+    session(session)
+{
+    resource = wl_resource_create(client, &ext_image_copy_capture_frame_v1_interface,
+        wl_resource_get_version(session->resource), id);
+    wl_resource_set_implementation(resource, &frame_impl, this, handle_frame_resource_destroy);
+}
+
+capture_frame_t::~capture_frame_t()
+{
+    if (session && (session->frame == this))
+    {
+        session->frame = nullptr;
+    }
+
+    if (buffer)
+    {
+        wlr_buffer_unlock(buffer);
+    }
+}
+
+void capture_frame_t::finish()
+{
+    if (session && (session->frame == this))
+    {
+        session->frame = nullptr;
+    }
+
+    session = nullptr;
+    if (buffer)
+    {
+        wlr_buffer_unlock(buffer);
+        buffer = nullptr;
+    }
+}
+
+/* ext_image_copy_capture_session_v1 */
+
+void handle_session_create_frame(wl_client *client, wl_resource *resource, uint32_t id)
+{
+    auto session = static_cast<capture_session_t*>(wl_resource_get_user_data(resource));
+    if (session->frame)
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_SESSION_V1_ERROR_DUPLICATE_FRAME,
+            "the session already has a frame");
+        return;
+    }
+
+    session->frame = new capture_frame_t(client, id, session);
+}
+
+void handle_session_destroy(wl_client*, wl_resource *resource)
+{
+    wl_resource_destroy(resource);
+}
+
+const struct ext_image_copy_capture_session_v1_interface session_impl = {
+    .create_frame = handle_session_create_frame,
+    .destroy = handle_session_destroy,
+};
+
+void handle_session_resource_destroy(wl_resource *resource)
+{
+    delete static_cast<capture_session_t*>(wl_resource_get_user_data(resource));
+}
+
+capture_session_t::capture_session_t(wl_client *client, uint32_t version, uint32_t id,
+    const capture_target_t *target)
+{
+    if (target)
+    {
+        this->target = *target;
+    }
+
+    resource = wl_resource_create(client, &ext_image_copy_capture_session_v1_interface, version, id);
+    wl_resource_set_implementation(resource, &session_impl, this, handle_session_resource_destroy);
+}
+
+/* ext_image_copy_capture_cursor_session_v1: cursors are not captured separately, so the capture sessions of
+ * cursor sessions are stopped right away. */
+
+void handle_cursor_session_destroy(wl_client*, wl_resource *resource)
+{
+    wl_resource_destroy(resource);
+}
+
+void handle_cursor_session_get_capture_session(wl_client *client, wl_resource *resource, uint32_t id)
+{
+    auto session = new capture_session_t(client, wl_resource_get_version(resource), id, nullptr);
+    session->start();
+}
+
+const struct ext_image_copy_capture_cursor_session_v1_interface cursor_session_impl = {
+    .destroy = handle_cursor_session_destroy,
+    .get_capture_session = handle_cursor_session_get_capture_session,
+};
+
+/* ext_image_copy_capture_manager_v1 */
+
+void handle_copy_manager_create_session(wl_client *client, wl_resource *resource, uint32_t id,
+    wl_resource *source, uint32_t options)
+{
+    if (options & ~EXT_IMAGE_COPY_CAPTURE_MANAGER_V1_OPTIONS_PAINT_CURSORS)
+    {
+        wl_resource_post_error(resource, EXT_IMAGE_COPY_CAPTURE_MANAGER_V1_ERROR_INVALID_OPTION,
+            "unknown options");
+        return;
+    }
+
+    // Software cursors are drawn after the scene, so they are never part of the captured image.
+    auto session = new capture_session_t(client, wl_resource_get_version(resource), id,
+        target_from_resource(source));
+    session->start();
+}
+
+void handle_copy_manager_create_pointer_cursor_session(wl_client *client, wl_resource *resource, uint32_t id,
+    wl_resource *source, wl_resource *pointer)
+{
+    auto cursor_session = wl_resource_create(client, &ext_image_copy_capture_cursor_session_v1_interface,
+        wl_resource_get_version(resource), id);
+    wl_resource_set_implementation(cursor_session, &cursor_session_impl, nullptr, nullptr);
+}
+
+void handle_destroy(wl_client*, wl_resource *resource)
+{
+    wl_resource_destroy(resource);
+}
+
+const struct ext_image_copy_capture_manager_v1_interface copy_manager_impl = {
+    .create_session = handle_copy_manager_create_session,
+    .create_pointer_cursor_session = handle_copy_manager_create_pointer_cursor_session,
+    .destroy = handle_destroy,
+};
+
+/* ext_image_capture_source_v1 */
+
+const struct ext_image_capture_source_v1_interface source_impl = {
+    .destroy = handle_destroy,
+};
+
+void handle_source_resource_destroy(wl_resource *resource)
+{
+    delete target_from_resource(resource);
+}
+
+void create_source(wl_client *client, wl_resource *manager, uint32_t id, capture_target_t *target)
+{
+    auto resource = wl_resource_create(client, &ext_image_capture_source_v1_interface,
+        wl_resource_get_version(manager), id);
+    wl_resource_set_implementation(resource, &source_impl, target, handle_source_resource_destroy);
+}
+
+void handle_output_source_manager_create_source(wl_client *client, wl_resource *resource, uint32_t id,
+    wl_resource *output_resource)
+{
+    auto target = new capture_target_t;
+    if (auto wlr_output = wlr_output_from_resource(output_resource))
+    {
+        target->output = wf::get_core().output_layout->find_output(wlr_output);
+    }
+
+    create_source(client, resource, id, target);
+}
+
+const struct ext_output_image_capture_source_manager_v1_interface output_source_manager_impl = {
+    .create_source = handle_output_source_manager_create_source,
+    .destroy = handle_destroy,
+};
+
+void handle_toplevel_source_manager_create_source(wl_client *client, wl_resource *resource, uint32_t id,
+    wl_resource *toplevel_resource)
+{
+    auto target = new capture_target_t;
+    auto handle = wlr_ext_foreign_toplevel_handle_v1_from_resource(toplevel_resource);
+    if (handle && handle->data)
+    {
+        target->view = static_cast<wf::view_interface_t*>(handle->data)->weak_from_this();
+    }
+
+    create_source(client, resource, id, target);
+}
+
+const struct ext_foreign_toplevel_image_capture_source_manager_v1_interface toplevel_source_manager_impl = {
+    .create_source = handle_toplevel_source_manager_create_source,
+    .destroy = handle_destroy,
+};
+
+template<class Interface>
+void bind_manager(wl_client *client, const wl_interface *interface, const Interface *impl,
+    uint32_t version, uint32_t id)
+{
+    auto resource = wl_resource_create(client, interface, version, id);
+    wl_resource_set_implementation(resource, impl, nullptr, nullptr);
+}
+}
+
+/** An ext-foreign-toplevel-list-v1 handle of a toplevel view, which identifies it as a capture source. */
+class ext_foreign_toplevel_t
+{
+    wayfire_toplevel_view view;
+    wlr_ext_foreign_toplevel_handle_v1 *handle;
+
+  public:
+    ext_foreign_toplevel_t(wayfire_toplevel_view view, wlr_ext_foreign_toplevel_list_v1 *list) : view(view)
+    {
+        auto title  = view->get_title();
+        auto app_id = view->get_app_id();
+        wlr_ext_foreign_toplevel_handle_v1_state state = {
+            .title  = title.c_str(),
+            .app_id = app_id.c_str(),
+        };
+        handle = wlr_ext_foreign_toplevel_handle_v1_create(list, &state);
+        handle->data = view.get();
+
+        view->connect(&on_title_changed);
+        view->connect(&on_app_id_changed);
+    }
+
+    ~ext_foreign_toplevel_t()
+    {
+        wlr_ext_foreign_toplevel_handle_v1_destroy(handle);
+    }
+
+  private:
+    void update_state()
+    {
+        auto title  = view->get_title();
+        auto app_id = view->get_app_id();
+        wlr_ext_foreign_toplevel_handle_v1_state state = {
+            .title  = title.c_str(),
+            .app_id = app_id.c_str(),
+        };
+        wlr_ext_foreign_toplevel_handle_v1_update_state(handle, &state);
+    }
+
+    wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed = [=] (auto)
+    {
+        update_state();
+    };
+
+    wf::signal::connection_t<wf::view_app_id_changed_signal> on_app_id_changed = [=] (auto)
+    {
+        update_state();
+    };
+};
+
+class wayfire_image_capture_impl : public wf::plugin_interface_t
+{
+  public:
+    void init() override
+    {
+        auto display = wf::get_core().display;
+        toplevel_list = wlr_ext_foreign_toplevel_list_v1_create(display, 1);
+
+        wl_global_create(display, &ext_output_image_capture_source_manager_v1_interface,
+            IMAGE_CAPTURE_VERSION, nullptr, [] (wl_client *client, void*, uint32_t version, uint32_t id)
+        {
+            bind_manager(client, &ext_output_image_capture_source_manager_v1_interface,
+                &output_source_manager_impl, version, id);
+        });
+        wl_global_create(display, &ext_foreign_toplevel_image_capture_source_manager_v1_interface,
+            IMAGE_CAPTURE_VERSION, nullptr, [] (wl_client *client, void*, uint32_t version, uint32_t id)
+        {
+            bind_manager(client, &ext_foreign_toplevel_image_capture_source_manager_v1_interface,
+                &toplevel_source_manager_impl, version, id);
+        });
+        wl_global_create(display, &ext_image_copy_capture_manager_v1_interface,
+            IMAGE_CAPTURE_VERSION, nullptr, [] (wl_client *client, void*, uint32_t version, uint32_t id)
+        {
+            bind_manager(client, &ext_image_copy_capture_manager_v1_interface, &copy_manager_impl, version, id);
+        });
+
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            auto toplevel = wf::toplevel_cast(view);
+            if (toplevel && toplevel->is_mapped())
+            {
+                toplevels[toplevel] = std::make_unique<ext_foreign_toplevel_t>(toplevel, toplevel_list);
+            }
+        }
+
+        wf::get_core().connect(&on_view_mapped);
+        wf::get_core().connect(&on_view_unmapped);
+    }
+
+    bool is_unloadable() override
+    {
+        return false;
+    }
+
+  private:
+    wf::signal::connection_t<wf::view_mapped_signal> on_view_mapped = [=] (wf::view_mapped_signal *ev)
+    {
+        if (auto toplevel = wf::toplevel_cast(ev->view))
+        {
+            toplevels[toplevel] = std::make_unique<ext_foreign_toplevel_t>(toplevel, toplevel_list);
+        }
+    };
+
+    wf::signal::connection_t<wf::view_unmapped_signal> on_view_unmapped = [=] (wf::view_unmapped_signal *ev)
+    {
+        toplevels.erase(wf::toplevel_cast(ev->view));
+    };
+
+    wlr_ext_foreign_toplevel_list_v1 *toplevel_list;
+    std::map<wayfire_toplevel_view, std::unique_ptr<ext_foreign_toplevel_t>> toplevels;
+};
+
+DECLARE_WAYFIRE_PLUGIN(wayfire_image_capture_impl);
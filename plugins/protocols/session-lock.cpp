@@ -461,10 +461,14 @@ class wf_session_lock_plugin : public wf::plugin_interface_t
         switch (state)
         {
           case UNLOCKED:
+            set_scene_locked(false);
+            break;
+
           case LOCKING:
             break;
 
           case LOCKED:
+            set_scene_locked(true);
             // Screen locked.
             // If a previous lock is in zombie state, delete it, so it stops listening for output
             // changes, removes lock_crashed_nodes, etc.
@@ -487,9 +491,35 @@ class wf_session_lock_plugin : public wf::plugin_interface_t
         }
     }
 
+    /**
+     * While the session is locked, only the lock surfaces can be seen. The layers below them are disabled,
+     * so that the render manager does not generate render instances for them: their damage does not
+     * schedule frames, they are not evaluated while rendering, and a fullscreen lock surface can be scanned
+     * out directly. Input does not reach them either. The desktop widget layer stays enabled, so that an
+     * on-screen keyboard can be used on the lock screen.
+     */
+    void set_scene_locked(bool locked)
+    {
+        if (locked == scene_locked)
+        {
+            return;
+        }
+
+        scene_locked = locked;
+        auto root = wf::get_core().scene();
+        for (size_t layer = 0; layer < (size_t)wf::scene::layer::LOCK; layer++)
+        {
+            wf::scene::set_node_enabled(root->layers[layer], !locked);
+        }
+
+        LOGC(LSHELL, locked ? "disabled" : "enabled", " the layers below the lock screen");
+    }
+
     void fini() override
     {
         // TODO: unlock everything?
+        // At least do not leave the layers below the lock screen disabled.
+        set_scene_locked(false);
     }
 
     bool is_unloadable() override
@@ -503,6 +533,7 @@ class wf_session_lock_plugin : public wf::plugin_interface_t
     wf::wl_listener_wrapper destroy;
 
     std::shared_ptr<wayfire_session_lock> cur_lock, prev_lock;
+    bool scene_locked = false;
 };
 
 DECLARE_WAYFIRE_PLUGIN(wf_session_lock_plugin);
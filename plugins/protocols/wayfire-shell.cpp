@@ -5,12 +5,15 @@
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/util/log.hpp>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 #include <wayfire/plugin.hpp>
 
 #include "wayfire/output.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/output-layout.hpp"
+#include "wayfire/region.hpp"
 #include "wayfire/render-manager.hpp"
 #include "wayfire-shell-unstable-v2-protocol.h"
 #include "wayfire/signal-definitions.hpp"
@@ -27,47 +30,68 @@ class wfs_hotspot
 {
   private:
     wf::geometry_t hotspot_geometry;
+    wf::output_t *output;
 
     bool hotspot_triggered = false;
-    wf::wl_idle_call idle_check_input;
     wf::wl_timer<false> timer;
 
     uint32_t timeout_ms;
     wl_resource *hotspot_resource;
 
-    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_axis_event>> on_tablet_axis =
-        [=] (wf::post_input_event_signal<wlr_tablet_tool_axis_event> *ev)
+    wf::geometry_t calculate_hotspot_geometry(wf::output_t *output,
+        uint32_t edge_mask, uint32_t distance) const
     {
-        idle_check_input.run_once([=] ()
+        wf::geometry_t slot = output->get_layout_geometry();
+        if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_TOP)
         {
-            auto gcf = wf::get_core().get_cursor_position();
-            wf::point_t gc{(int)gcf.x, (int)gcf.y};
-            process_input_motion(gc);
-        });
-    };
+            slot.height = distance;
+        } else if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_BOTTOM)
+        {
+            slot.y += slot.height - distance;
+            slot.height = distance;
+        }
 
-    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion_event =
-        [=] (auto)
-    {
-        idle_check_input.run_once([=] ()
+        if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_LEFT)
         {
-            auto gcf = wf::get_core().get_cursor_position();
-            wf::point_t gc{(int)gcf.x, (int)gcf.y};
-            process_input_motion(gc);
-        });
-    };
+            slot.width = distance;
+        } else if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_RIGHT)
+        {
+            slot.x    += slot.width - distance;
+            slot.width = distance;
+        }
 
-    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_motion_event>> on_touch_motion = [=] (auto)
+        return slot;
+    }
+
+    wfs_hotspot(const wfs_hotspot &) = delete;
+    wfs_hotspot(wfs_hotspot &&) = delete;
+    wfs_hotspot& operator =(const wfs_hotspot&) = delete;
+    wfs_hotspot& operator =(wfs_hotspot&&) = delete;
+
+  public:
+    /**
+     * Create a new hotspot.
+     * It is guaranteedd that edge_mask contains at most 2 non-opposing edges.
+     */
+    wfs_hotspot(wf::output_t *output, uint32_t edge_mask,
+        uint32_t distance, uint32_t timeout, wl_client *client, uint32_t id);
+    ~wfs_hotspot();
+
+    wf::geometry_t get_geometry() const
     {
-        idle_check_input.run_once([=] ()
-        {
-            auto gcf = wf::get_core().get_touch_position(0);
-            wf::point_t gc{(int)gcf.x, (int)gcf.y};
-            process_input_motion(gc);
-        });
-    };
+        return hotspot_geometry;
+    }
 
-    wf::signal::connection_t<wf::output_removed_signal> on_output_removed;
+    /** Make the hotspot inactive if its output was removed. */
+    void handle_output_removed(wf::output_t *removed)
+    {
+        if (removed == output)
+        {
+            /* Make hotspot inactive by setting the region to empty */
+            hotspot_geometry = {0, 0, 0, 0};
+            process_input_motion({0, 0});
+        }
+    }
 
     void process_input_motion(wf::point_t gc)
     {
@@ -101,74 +125,149 @@ class wfs_hotspot
             });
         }
     }
+};
 
-    wf::geometry_t calculate_hotspot_geometry(wf::output_t *output,
-        uint32_t edge_mask, uint32_t distance) const
+/**
+ * Processes the input motion for all hotspots of all clients, once per event loop iteration.
+ *
+ * Hotspots cover only small areas at the output edges, so only the hotspots which contain the input
+ * position, and those which contained it the last time (which need to be reset), are looked at. Motion
+ * anywhere else costs a single lookup in the union of all hotspots.
+ */
+class wfs_hotspot_manager
+{
+    std::vector<wfs_hotspot*> hotspots;
+    // The hotspots which contained the last input position.
+    std::vector<wfs_hotspot*> active;
+    wf::region_t hotspot_area;
+    wf::wl_idle_call idle_check_input;
+
+    void check_input(wf::pointf_t gcf)
     {
-        wf::geometry_t slot = output->get_layout_geometry();
-        if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_TOP)
+        idle_check_input.run_once([=] ()
         {
-            slot.height = distance;
-        } else if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_BOTTOM)
+            process_input_motion(wf::point_t{(int)gcf.x, (int)gcf.y});
+        });
+    }
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_axis_event>> on_tablet_axis =
+        [=] (wf::post_input_event_signal<wlr_tablet_tool_axis_event> *ev)
+    {
+        check_input(wf::get_core().get_cursor_position());
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion_event =
+        [=] (auto)
+    {
+        check_input(wf::get_core().get_cursor_position());
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_motion_event>> on_touch_motion = [=] (auto)
+    {
+        check_input(wf::get_core().get_touch_position(0));
+    };
+
+    wf::signal::connection_t<wf::output_removed_signal> on_output_removed =
+        [=] (wf::output_removed_signal *ev)
+    {
+        for (auto& hs : hotspots)
         {
-            slot.y += slot.height - distance;
-            slot.height = distance;
+            hs->handle_output_removed(ev->output);
         }
 
-        if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_LEFT)
-        {
-            slot.width = distance;
-        } else if (edge_mask & ZWF_OUTPUT_V2_HOTSPOT_EDGE_RIGHT)
+        update_area();
+    };
+
+    void update_area()
+    {
+        hotspot_area.clear();
+        for (auto& hs : hotspots)
         {
-            slot.x    += slot.width - distance;
-            slot.width = distance;
+            hotspot_area |= hs->get_geometry();
         }
-
-        return slot;
     }
 
-    wfs_hotspot(const wfs_hotspot &) = delete;
-    wfs_hotspot(wfs_hotspot &&) = delete;
-    wfs_hotspot& operator =(const wfs_hotspot&) = delete;
-    wfs_hotspot& operator =(wfs_hotspot&&) = delete;
-
-  public:
-    /**
-     * Create a new hotspot.
-     * It is guaranteedd that edge_mask contains at most 2 non-opposing edges.
-     */
-    wfs_hotspot(wf::output_t *output, uint32_t edge_mask,
-        uint32_t distance, uint32_t timeout, wl_client *client, uint32_t id)
+    void process_input_motion(wf::point_t gc)
     {
-        this->timeout_ms = timeout;
-        this->hotspot_geometry =
-            calculate_hotspot_geometry(output, edge_mask, distance);
+        auto left = std::remove_if(active.begin(), active.end(), [&] (wfs_hotspot *hs)
+        {
+            hs->process_input_motion(gc);
+            return !(hs->get_geometry() & gc);
+        });
+        active.erase(left, active.end());
 
-        hotspot_resource =
-            wl_resource_create(client, &zwf_hotspot_v2_interface, 1, id);
-        wl_resource_set_implementation(hotspot_resource, NULL, this,
-            handle_hotspot_destroy);
+        if (!hotspot_area.contains_point(gc))
+        {
+            return;
+        }
 
-        // setup output destroy listener
-        on_output_removed.set_callback([this, output] (wf::output_removed_signal *ev)
+        for (auto& hs : hotspots)
         {
-            if (ev->output == output)
+            if ((hs->get_geometry() & gc) && (std::find(active.begin(), active.end(), hs) == active.end()))
             {
-                /* Make hotspot inactive by setting the region to empty */
-                hotspot_geometry = {0, 0, 0, 0};
-                process_input_motion({0, 0});
+                hs->process_input_motion(gc);
+                active.push_back(hs);
             }
-        });
+        }
+    }
 
-        wf::get_core().connect(&on_motion_event);
-        wf::get_core().connect(&on_touch_motion);
-        wf::get_core().connect(&on_tablet_axis);
-        wf::get_core().output_layout->connect(&on_output_removed);
+  public:
+    static wfs_hotspot_manager& get()
+    {
+        static wfs_hotspot_manager manager;
+        return manager;
     }
 
-    ~wfs_hotspot() = default;
+    void add_hotspot(wfs_hotspot *hotspot)
+    {
+        hotspots.push_back(hotspot);
+        hotspot_area |= hotspot->get_geometry();
+        if (!on_motion_event.is_connected())
+        {
+            wf::get_core().connect(&on_motion_event);
+            wf::get_core().connect(&on_touch_motion);
+            wf::get_core().connect(&on_tablet_axis);
+            wf::get_core().output_layout->connect(&on_output_removed);
+        }
+    }
+
+    void remove_hotspot(wfs_hotspot *hotspot)
+    {
+        hotspots.erase(std::remove(hotspots.begin(), hotspots.end(), hotspot), hotspots.end());
+        active.erase(std::remove(active.begin(), active.end(), hotspot), active.end());
+        update_area();
+        if (hotspots.empty())
+        {
+            on_motion_event.disconnect();
+            on_touch_motion.disconnect();
+            on_tablet_axis.disconnect();
+            on_output_removed.disconnect();
+            idle_check_input.disconnect();
+        }
+    }
 };
 
+wfs_hotspot::wfs_hotspot(wf::output_t *output, uint32_t edge_mask,
+    uint32_t distance, uint32_t timeout, wl_client *client, uint32_t id)
+{
+    this->output     = output;
+    this->timeout_ms = timeout;
+    this->hotspot_geometry =
+        calculate_hotspot_geometry(output, edge_mask, distance);
+
+    hotspot_resource =
+        wl_resource_create(client, &zwf_hotspot_v2_interface, 1, id);
+    wl_resource_set_implementation(hotspot_resource, NULL, this,
+        handle_hotspot_destroy);
+
+    wfs_hotspot_manager::get().add_hotspot(this);
+}
+
+wfs_hotspot::~wfs_hotspot()
+{
+    wfs_hotspot_manager::get().remove_hotspot(this);
+}
+
 static void handle_hotspot_destroy(wl_resource *resource)
 {
     auto *hotspot = (wfs_hotspot*)wl_resource_get_user_data(resource);
@@ -212,6 +311,7 @@ class wfs_output
     {
         wf::get_core().output_layout->disconnect(&on_output_removed);
         on_fullscreen_layer_focused.disconnect();
+        idle_send_fullscreen.disconnect();
     }
 
     wf::signal::connection_t<wf::output_removed_signal> on_output_removed =
@@ -224,16 +324,34 @@ class wfs_output
         }
     };
 
+    /**
+     * The fullscreen state can flip several times while views are restacked or change state, the client is
+     * notified only of the state at the end of the event loop iteration, and only if it changed.
+     */
+    bool sent_fullscreen = false;
+    bool pending_fullscreen = false;
+    wf::wl_idle_call idle_send_fullscreen;
+
     wf::signal::connection_t<wf::fullscreen_layer_focused_signal> on_fullscreen_layer_focused =
         [=] (wf::fullscreen_layer_focused_signal *ev)
     {
-        if (ev->has_promoted)
+        pending_fullscreen = ev->has_promoted;
+        idle_send_fullscreen.run_once([=] ()
         {
-            zwf_output_v2_send_enter_fullscreen(resource);
-        } else
-        {
-            zwf_output_v2_send_leave_fullscreen(resource);
-        }
+            if (pending_fullscreen == sent_fullscreen)
+            {
+                return;
+            }
+
+            sent_fullscreen = pending_fullscreen;
+            if (sent_fullscreen)
+            {
+                zwf_output_v2_send_enter_fullscreen(resource);
+            } else
+            {
+                zwf_output_v2_send_leave_fullscreen(resource);
+            }
+        });
     };
 
     wf::signal::connection_t<wayfire_shell_toggle_menu_signal> on_toggle_menu = [=] (auto)
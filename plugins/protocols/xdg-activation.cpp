@@ -1,12 +1,18 @@
 #include "wayfire/core.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include "wayfire/view.hpp"
+#include <deque>
 #include <memory>
+#include <unordered_map>
 #include <wayfire/plugin.hpp>
 #include <wayfire/view.hpp>
 #include <wayfire/toplevel-view.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/window-manager.hpp>
+#include <wayfire/util.hpp>
+#include "plugins/common/wayfire/plugins/common/shared-core-data.hpp"
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include "plugins/ipc/ipc-helpers.hpp"
 #include "config.h"
 
 class wayfire_xdg_activation_protocol_impl : public wf::plugin_interface_t
@@ -15,13 +21,25 @@ class wayfire_xdg_activation_protocol_impl : public wf::plugin_interface_t
     void init() override
     {
         xdg_activation = wlr_xdg_activation_v1_create(wf::get_core().display);
-        xdg_activation_request_activate.notify = xdg_activation_handle_request_activate;
+        // Tokens are expired by the plugin with a single timer, instead of a timer for each token.
+        xdg_activation->token_timeout_msec = 0;
 
+        xdg_activation_request_activate.notify = xdg_activation_handle_request_activate;
         wl_signal_add(&xdg_activation->events.request_activate, &xdg_activation_request_activate);
+
+        on_new_token.set_callback([=] (void *data)
+        {
+            track_token(static_cast<wlr_xdg_activation_token_v1*>(data));
+        });
+        on_new_token.connect(&xdg_activation->events.new_token);
+
+        ipc_repo->register_method("xdg-activation/stats", get_stats);
     }
 
     void fini() override
-    {}
+    {
+        ipc_repo->unregister_method("xdg-activation/stats");
+    }
 
     bool is_unloadable() override
     {
@@ -59,6 +77,118 @@ class wayfire_xdg_activation_protocol_impl : public wf::plugin_interface_t
 
     struct wlr_xdg_activation_v1 *xdg_activation;
     struct wl_listener xdg_activation_request_activate;
+    wf::wl_listener_wrapper on_new_token;
+
+    wf::option_wrapper_t<int> token_timeout{"xdg-activation/timeout"};
+    wf::shared_data::ref_ptr_t<wf::ipc::method_repository_t> ipc_repo;
+
+    struct tracked_token_t
+    {
+        // Distinguishes tokens which were allocated at the same address.
+        uint64_t id;
+        wf::wl_listener_wrapper on_destroy;
+    };
+
+    struct expiry_t
+    {
+        wlr_xdg_activation_token_v1 *token;
+        uint64_t id;
+        int64_t deadline;
+    };
+
+    std::unordered_map<wlr_xdg_activation_token_v1*, std::unique_ptr<tracked_token_t>> tokens;
+
+    // All tokens have the same timeout, so they expire in the order they were issued. Consumed tokens are
+    // left in the queue and skipped once they reach its front.
+    std::deque<expiry_t> expiry_queue;
+    wf::wl_timer<false> expiry_timer;
+    uint64_t next_id = 0;
+    bool expiring    = false;
+
+    uint64_t issued   = 0;
+    uint64_t consumed = 0;
+    uint64_t expired  = 0;
+
+    void track_token(wlr_xdg_activation_token_v1 *token)
+    {
+        ++issued;
+        auto tracked = std::make_unique<tracked_token_t>();
+        tracked->id = next_id++;
+        tracked->on_destroy.set_callback([=] (void*)
+        {
+            if (!expiring)
+            {
+                ++consumed;
+            }
+
+            tokens.erase(token);
+        });
+        tracked->on_destroy.connect(&token->events.destroy);
+
+        if (token_timeout > 0)
+        {
+            expiry_queue.push_back({token, tracked->id, wf::get_current_time() + token_timeout});
+            if (!expiry_timer.is_connected())
+            {
+                schedule_expiry();
+            }
+        }
+
+        tokens[token] = std::move(tracked);
+    }
+
+    void schedule_expiry()
+    {
+        while (!expiry_queue.empty() && !is_tracked(expiry_queue.front()))
+        {
+            expiry_queue.pop_front();
+        }
+
+        if (expiry_queue.empty())
+        {
+            return;
+        }
+
+        const int64_t remaining = expiry_queue.front().deadline - wf::get_current_time();
+        expiry_timer.set_timeout(std::max<int64_t>(remaining, 1), [=] ()
+        {
+            expire_tokens();
+            schedule_expiry();
+        });
+    }
+
+    void expire_tokens()
+    {
+        const int64_t now = wf::get_current_time();
+        while (!expiry_queue.empty() && (expiry_queue.front().deadline <= now))
+        {
+            auto entry = expiry_queue.front();
+            expiry_queue.pop_front();
+            if (is_tracked(entry))
+            {
+                ++expired;
+                expiring = true;
+                wlr_xdg_activation_token_v1_destroy(entry.token);
+                expiring = false;
+            }
+        }
+    }
+
+    bool is_tracked(const expiry_t& entry) const
+    {
+        auto it = tokens.find(entry.token);
+        return (it != tokens.end()) && (it->second->id == entry.id);
+    }
+
+    wf::ipc::method_callback get_stats = [=] (const nlohmann::json&)
+    {
+        auto response = wf::ipc::json_ok();
+        response["issued"]   = issued;
+        response["consumed"] = consumed;
+        response["expired"]  = expired;
+        response["active"]   = tokens.size();
+        return response;
+    };
 };
 
 DECLARE_WAYFIRE_PLUGIN(wayfire_xdg_activation_protocol_impl);
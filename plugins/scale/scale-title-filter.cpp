@@ -102,6 +102,25 @@ class scale_title_filter : public wf::per_output_plugin_instance_t
         std::transform(string.begin(), string.end(), string.begin(), transform);
     }
 
+    /**
+     * The result of matching a view against the filter, kept while scale is
+     * running so that typing does not normalize and search all titles again.
+     */
+    struct view_match_t
+    {
+        /* the title and app-id the normalized text was created from */
+        std::string title, app_id;
+        bool case_sensitive = false;
+        /* the normalized title and app-id, separated by a NUL character which
+         * no filter contains */
+        std::string text;
+        /* the (normalized) filter of the last match and its result */
+        std::string filter;
+        bool matched = false;
+    };
+
+    std::map<wayfire_view, view_match_t> matches;
+
     bool should_show_view(wayfire_view view)
     {
         auto filter = get_active_filter().title_filter;
@@ -111,15 +130,33 @@ class scale_title_filter : public wf::per_output_plugin_instance_t
             return true;
         }
 
+        fix_case(filter);
         auto title  = view->get_title();
         auto app_id = view->get_app_id();
+        auto it     = matches.find(view);
+        if ((it == matches.end()) || (it->second.title != title) || (it->second.app_id != app_id) ||
+            (it->second.case_sensitive != case_sensitive))
+        {
+            view_match_t match;
+            match.title  = title;
+            match.app_id = app_id;
+            match.case_sensitive = case_sensitive;
+            fix_case(title);
+            fix_case(app_id);
+            match.text = title + '\0' + app_id;
+            it = matches.insert_or_assign(view, std::move(match)).first;
+        } else if ((it->second.filter == filter) ||
+                   (!it->second.matched && (filter.find(it->second.filter) != std::string::npos)))
+        {
+            /* Same filter, or the filter was extended and the view did not
+             * match the shorter one already */
+            it->second.filter = filter;
+            return it->second.matched;
+        }
 
-        fix_case(title);
-        fix_case(app_id);
-        fix_case(filter);
-
-        return (title.find(filter) != std::string::npos) ||
-               (app_id.find(filter) != std::string::npos);
+        it->second.filter  = filter;
+        it->second.matched = it->second.text.find(filter) != std::string::npos;
+        return it->second.matched;
     }
 
     scale_title_filter_text& get_active_filter()
@@ -164,7 +201,9 @@ class scale_title_filter : public wf::per_output_plugin_instance_t
         });
     };
 
-    std::map<uint32_t, std::unique_ptr<wf::key_repeat_t>> keys;
+    /* Only the key pressed last repeats, as in clients */
+    wf::key_repeat_t key_repeat;
+    uint32_t repeating_key = 0;
     wf::key_repeat_t::callback_t handle_key_repeat = [=] (uint32_t raw_keycode)
     {
         auto seat     = wf::get_core().get_current_seat();
@@ -210,7 +249,12 @@ class scale_title_filter : public wf::per_output_plugin_instance_t
     {
         if (ev->event->state == WL_KEYBOARD_KEY_STATE_RELEASED)
         {
-            keys.erase(ev->event->keycode);
+            if (ev->event->keycode == repeating_key)
+            {
+                key_repeat.disconnect();
+                repeating_key = 0;
+            }
+
             return;
         }
 
@@ -224,7 +268,8 @@ class scale_title_filter : public wf::per_output_plugin_instance_t
             return;
         }
 
-        keys[ev->event->keycode] = std::make_unique<wf::key_repeat_t>(ev->event->keycode, handle_key_repeat);
+        key_repeat.set_callback(ev->event->keycode, handle_key_repeat);
+        repeating_key = ev->event->keycode;
         handle_key_repeat(ev->event->keycode);
     };
 
@@ -237,8 +282,10 @@ class scale_title_filter : public wf::per_output_plugin_instance_t
     void do_end_scale()
     {
         scale_key.disconnect();
-        keys.clear();
+        key_repeat.disconnect();
+        repeating_key = 0;
         clear_overlay();
+        matches.clear();
         scale_running = false;
         get_active_filter().check_scale_end();
     }
@@ -10,23 +10,111 @@
 #include "wayfire/view-helpers.hpp"
 #include "wayfire/view-transform.hpp"
 
+#include <list>
 #include <memory>
+#include <unordered_map>
 #include <wayfire/opengl.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/plugins/common/cairo-util.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
 #include <wayfire/plugins/common/simple-texture.hpp>
 #include <wayfire/scene.hpp>
 #include <wayfire/scene-render.hpp>
 
+/**
+ * A rendered title.
+ */
+struct title_texture_t
+{
+    wf::simple_texture_t tex;
+    /* whether the title had to be cropped */
+    bool overflow = false;
+};
+
+/**
+ * The rendered titles, shared by the views on all outputs.
+ *
+ * Titles are looked up by their text and rendering parameters, so views with
+ * the same title share a texture. Titles which are not shown anymore are kept
+ * for a while, so that a title which keeps changing back and forth (like the
+ * title of a browser tab which is loading) is not rendered with pango again.
+ */
+class title_texture_cache_t
+{
+    /* How many titles which are not used by any view are kept */
+    static constexpr size_t max_unused = 64;
+
+    using entry_t = std::pair<std::string, std::shared_ptr<title_texture_t>>;
+    /* Most recently used first */
+    std::list<entry_t> entries;
+    std::unordered_map<std::string, std::list<entry_t>::iterator> index;
+    wf::cairo_text_t renderer;
+
+    static std::string make_key(const std::string& text, const wf::cairo_text_t::params& par)
+    {
+        char key[256];
+        snprintf(key, sizeof(key), "%d %g %d %d %g %g %g %g %g %g %g %g %d %d %d\n",
+            par.font_size, par.output_scale, par.max_size.width, par.max_size.height,
+            par.bg_color.r, par.bg_color.g, par.bg_color.b, par.bg_color.a,
+            par.text_color.r, par.text_color.g, par.text_color.b, par.text_color.a,
+            par.bg_rect, par.rounded_rect, par.exact_size);
+        return key + text;
+    }
+
+    void evict_unused()
+    {
+        size_t unused = 0;
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if ((it->second.use_count() == 1) && (++unused > max_unused))
+            {
+                index.erase(it->first);
+                it = entries.erase(it);
+            } else
+            {
+                ++it;
+            }
+        }
+    }
+
+  public:
+    /**
+     * Get the texture with the given title, rendering it if it is not cached.
+     */
+    std::shared_ptr<const title_texture_t> get(const std::string& text,
+        const wf::cairo_text_t::params& par)
+    {
+        auto key = make_key(text, par);
+        auto it  = index.find(key);
+        if (it != index.end())
+        {
+            entries.splice(entries.begin(), entries, it->second);
+            return entries.front().second;
+        }
+
+        auto title = std::make_shared<title_texture_t>();
+        auto size  = renderer.render_text(text, par);
+        /* take over the texture, the next title is uploaded to a new one */
+        title->tex = std::move(renderer.tex);
+        title->overflow = size.width > title->tex.width;
+
+        entries.emplace_front(key, title);
+        index[key] = entries.begin();
+        evict_unused();
+        return title;
+    }
+};
+
 /**
  * Class storing an overlay with a view's title, only stored for parent views.
  */
 struct view_title_texture_t : public wf::custom_data_t
 {
     wayfire_toplevel_view view;
-    wf::cairo_text_t overlay;
+    wf::shared_data::ref_ptr_t<title_texture_cache_t> cache;
+    /* null until the title is rendered for the first time */
+    std::shared_ptr<const title_texture_t> overlay;
     wf::cairo_text_t::params par;
-    bool overflow = false;
     wayfire_toplevel_view dialog; /* the texture should be rendered on top of this dialog */
 
     /**
@@ -41,14 +129,13 @@ struct view_title_texture_t : public wf::custom_data_t
 
     void update_overlay_texture()
     {
-        auto res = overlay.render_text(view->get_title(), par);
-        overflow = res.width > overlay.tex.width;
+        overlay = cache->get(view->get_title(), par);
     }
 
     wf::signal::connection_t<wf::view_title_changed_signal> view_changed_title =
         [=] (wf::view_title_changed_signal *ev)
     {
-        if (overlay.tex.tex != (GLuint) - 1)
+        if (overlay)
         {
             update_overlay_texture();
         }
@@ -202,18 +289,18 @@ class title_overlay_node_t : public node_t
          * animated and maybe redraw less frequently
          */
         auto& tex = get_overlay_texture(find_topmost_parent(view));
-        if ((tex.overlay.tex.tex == (GLuint) - 1) ||
+        if (!tex.overlay ||
             (output_scale != tex.par.output_scale) ||
-            (tex.overlay.tex.width > box.width * output_scale) ||
-            (tex.overflow &&
-             (tex.overlay.tex.width < std::floor(box.width * output_scale))))
+            (tex.overlay->tex.width > box.width * output_scale) ||
+            (tex.overlay->overflow &&
+             (tex.overlay->tex.width < std::floor(box.width * output_scale))))
         {
             tex.par.output_scale = output_scale;
             tex.update_overlay_texture({box.width, box.height});
         }
 
-        geometry.width  = tex.overlay.tex.width / output_scale;
-        geometry.height = tex.overlay.tex.height / output_scale;
+        geometry.width  = tex.overlay->tex.width / output_scale;
+        geometry.height = tex.overlay->tex.height / output_scale;
 
         auto bbox = get_scaled_bbox(view);
         geometry.x = bbox.x + bbox.width / 2 - geometry.width / 2;
@@ -244,10 +331,10 @@ class title_overlay_node_t : public node_t
         auto parent = find_topmost_parent(view);
         auto& title = get_overlay_texture(parent);
 
-        if (title.overlay.tex.tex != (GLuint) - 1)
+        if (title.overlay)
         {
             text_height = (unsigned int)std::ceil(
-                title.overlay.tex.height / title.par.output_scale);
+                title.overlay->tex.height / title.par.output_scale);
         } else
         {
             text_height =
@@ -329,9 +416,7 @@ class title_overlay_render_instance_t : public render_instance_t
         auto tr     = self->view->get_transformed_node()
             ->get_transformer<wf::scene::view_2d_transformer_t>("scale");
 
-        GLuint tex = title.overlay.tex.tex;
-
-        if (tex == (GLuint) - 1)
+        if (!title.overlay || (title.overlay->tex.tex == (GLuint) - 1))
         {
             /* this should not happen */
             return;
@@ -342,7 +427,7 @@ class title_overlay_render_instance_t : public render_instance_t
         for (const auto& box : region)
         {
             target.logic_scissor(wlr_box_from_pixman_box(box));
-            OpenGL::render_transformed_texture(tex, self->geometry, ortho,
+            OpenGL::render_transformed_texture(title.overlay->tex.tex, self->geometry, ortho,
                 {1.0f, 1.0f, 1.0f, tr->alpha}, OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
         }
 
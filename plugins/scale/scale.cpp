@@ -69,6 +69,12 @@ struct view_scale_data
 
     view_visibility_t visibility = view_visibility_t::VISIBLE;
     bool was_minimized = false; /* flag to indicate if this view was originally minimized */
+
+    /* The values the view is animated towards, see setup_view_transform() */
+    bool has_target = false;
+    double target_scale_x = 1, target_scale_y = 1;
+    double target_translation_x = 0, target_translation_y = 0;
+    double target_alpha = 1;
 };
 
 /**
@@ -97,6 +103,8 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
     /* helper class for optionally showing title overlays */
     scale_show_title_t show_title;
     std::vector<int> current_row_sizes;
+    /* The views in the order of their slots in the last layout, row by row */
+    std::vector<wayfire_toplevel_view> slot_order;
     wf::point_t initial_workspace;
     bool hook_set;
     /* View that was active before scale began. */
@@ -365,8 +373,9 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
         }
 
         set_hook();
-        auto alpha = scale_data[view].transformer->alpha;
-        scale_data[view].fade_animation.animate(alpha, 1);
+        auto& view_data = scale_data[view];
+        view_data.fade_animation.animate(view_data.transformer->alpha, 1);
+        view_data.target_alpha = 1;
         if (view->children.size())
         {
             fade_in(view->children.front());
@@ -390,9 +399,10 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
                 continue;
             }
 
-            auto alpha = scale_data[v].transformer->alpha;
+            auto& view_data = scale_data[v];
             double target_alpha = (v->minimized) ? minimized_alpha : inactive_alpha;
-            scale_data[v].fade_animation.animate(alpha, target_alpha);
+            view_data.fade_animation.animate(view_data.transformer->alpha, target_alpha);
+            view_data.target_alpha = target_alpha;
         }
     }
 
@@ -775,7 +785,9 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
             views.begin(), views.end(), wf::find_topmost_parent(view)) != views.end();
     }
 
-    /* Convenience assignment function */
+    /* Convenience assignment function. The animations are restarted only if
+     * the target changed, so that a relayout in which a view keeps its slot
+     * does not disturb it. */
     void setup_view_transform(view_scale_data& view_data,
         double scale_x,
         double scale_y,
@@ -783,19 +795,37 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
         double translation_y,
         double target_alpha)
     {
-        view_data.animation.scale_animation.scale_x.set(
-            view_data.transformer->scale_x, scale_x);
-        view_data.animation.scale_animation.scale_y.set(
-            view_data.transformer->scale_y, scale_y);
-        view_data.animation.scale_animation.translation_x.set(
-            view_data.transformer->translation_x, translation_x);
-        view_data.animation.scale_animation.translation_y.set(
-            view_data.transformer->translation_y, translation_y);
-        view_data.animation.scale_animation.start();
-        view_data.fade_animation = wf::animation::simple_animation_t(
-            wf::option_wrapper_t<wf::animation_description_t>{"scale/duration"});
-        view_data.fade_animation.animate(view_data.transformer->alpha,
-            target_alpha);
+        const bool same_geometry = view_data.has_target &&
+            (view_data.target_scale_x == scale_x) && (view_data.target_scale_y == scale_y) &&
+            (view_data.target_translation_x == translation_x) &&
+            (view_data.target_translation_y == translation_y);
+        if (!same_geometry)
+        {
+            view_data.animation.scale_animation.scale_x.set(
+                view_data.transformer->scale_x, scale_x);
+            view_data.animation.scale_animation.scale_y.set(
+                view_data.transformer->scale_y, scale_y);
+            view_data.animation.scale_animation.translation_x.set(
+                view_data.transformer->translation_x, translation_x);
+            view_data.animation.scale_animation.translation_y.set(
+                view_data.transformer->translation_y, translation_y);
+            view_data.animation.scale_animation.start();
+        }
+
+        if (!view_data.has_target || (view_data.target_alpha != target_alpha))
+        {
+            view_data.fade_animation = wf::animation::simple_animation_t(
+                wf::option_wrapper_t<wf::animation_description_t>{"scale/duration"});
+            view_data.fade_animation.animate(view_data.transformer->alpha,
+                target_alpha);
+        }
+
+        view_data.has_target     = true;
+        view_data.target_scale_x = scale_x;
+        view_data.target_scale_y = scale_y;
+        view_data.target_translation_x = translation_x;
+        view_data.target_translation_y = translation_y;
+        view_data.target_alpha = target_alpha;
     }
 
     static bool view_compare_x(const wayfire_toplevel_view& a, const wayfire_toplevel_view& b)
@@ -816,10 +846,25 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
         return a_coords < b_coords;
     }
 
+    /* Arrange the views in rows. Views which had a slot in the previous
+     * layout keep their order, so that a view being added or removed only
+     * moves the views after it. New views are sorted by their geometry and
+     * placed after them. */
     std::vector<std::vector<wayfire_toplevel_view>> view_sort(
         std::vector<wayfire_toplevel_view>& views)
     {
         std::vector<std::vector<wayfire_toplevel_view>> view_grid;
+        std::vector<wayfire_toplevel_view> placed;
+        for (auto& view : slot_order)
+        {
+            auto it = std::find(views.begin(), views.end(), view);
+            if (it != views.end())
+            {
+                placed.push_back(view);
+                views.erase(it);
+            }
+        }
+
         // First ensure a consistent sorting of all views using a persistent
         // identifier before sorting by geometry.
         // This is so that if two views have exactly the same geometry,
@@ -829,6 +874,7 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
             return a.get() < b.get();
         });
         std::stable_sort(views.begin(), views.end(), view_compare_y);
+        views.insert(views.begin(), placed.begin(), placed.end());
 
         int rows = sqrt(views.size() + 1);
         int views_per_row = (int)std::ceil((double)views.size() / rows);
@@ -841,6 +887,12 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
                 view_compare_x);
         }
 
+        slot_order.clear();
+        for (auto& row : view_grid)
+        {
+            slot_order.insert(slot_order.end(), row.begin(), row.end());
+        }
+
         return view_grid;
     }
 
@@ -876,7 +928,9 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
 
         if (!current_focus_view)
         {
-            std::sort(views.begin(), views.end(), [=] (wayfire_toplevel_view a, wayfire_toplevel_view b)
+            // Only the most recently focused view is needed, view_sort() decides the order of the rest.
+            auto it = std::min_element(views.begin(), views.end(),
+                [=] (wayfire_toplevel_view a, wayfire_toplevel_view b)
             {
                 if (a->minimized != b->minimized)
                 {
@@ -888,7 +942,7 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
                 return wf::get_focus_timestamp(a) > wf::get_focus_timestamp(b);
             });
 
-            current_focus_view = views.empty() ? nullptr : views.front();
+            current_focus_view = (it == views.end()) ? nullptr : *it;
             wf::get_core().default_wm->focus_raise_view(current_focus_view);
         }
     }
@@ -1047,6 +1101,8 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
             return;
         }
 
+        // A different set of views, sort all of them by their geometry again
+        slot_order.clear();
         if (all_workspaces)
         {
             layout_slots(get_views());
@@ -1413,6 +1469,7 @@ class wayfire_scale : public wf::per_output_plugin_instance_t,
         unset_hook();
         remove_transformers();
         scale_data.clear();
+        slot_order.clear();
         grab->ungrab_input();
         on_view_mapped.disconnect();
         view_minimized.disconnect();
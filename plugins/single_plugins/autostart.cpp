@@ -1,34 +1,98 @@
 #include <wayfire/plugin.hpp>
 #include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/startup-profile.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/option-wrapper.hpp>
 #include <config.h>
 
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+
+/**
+ * Runs the autostart entries once, at startup.
+ *
+ * Each entry can be assigned a stage with a `stage_<name>` option, which decides when it is started:
+ * - now: when the plugin is initialized, as early as possible (the default).
+ * - startup: when the compositor has finished starting up.
+ * - output: when the first output is available.
+ * - frame: when the first frame has been shown.
+ *
+ * Entries of the same stage are started in the order of the config file, separated by
+ * autostart_stagger_ms, so that they do not compete with each other and with the compositor.
+ */
 class wayfire_autostart : public wf::plugin_interface_t
 {
     wf::option_wrapper_t<bool> autostart_wf_shell{"autostart/autostart_wf_shell"};
+    wf::option_wrapper_t<int> stagger_ms{"autostart/autostart_stagger_ms"};
     wf::option_wrapper_t<wf::config::compound_list_t<std::string>>
     autostart_entries{"autostart/autostart"};
 
+    enum class stage_t
+    {
+        NOW,
+        STARTUP,
+        OUTPUT,
+        FRAME,
+    };
+
+    struct entry_t
+    {
+        std::string name;
+        std::string command;
+        stage_t stage = stage_t::NOW;
+        pid_t pid     = 0;
+        std::chrono::steady_clock::time_point spawned;
+        bool ready = false;
+    };
+
+    static constexpr const char *STAGE_PREFIX = "stage_";
+    /* Start the entries waiting for the first frame or output at the latest after this time. */
+    static constexpr uint32_t STAGE_TIMEOUT_MS = 2000;
+    /* Stop waiting for the entries to show their first view after this time. */
+    static constexpr uint32_t READY_TIMEOUT_MS = 30'000;
+
+    std::vector<entry_t> entries;
+    std::deque<size_t> spawn_queue;
+    wf::wl_timer<false> stagger_timer;
+    wf::wl_idle_call idle_spawn;
+    wf::wl_idle_call idle_later_stages;
+    wf::wl_idle_call idle_frame_stage;
+    wf::wl_timer<false> frame_timeout;
+    wf::wl_timer<false> ready_timeout;
+    bool later_stages_started = false;
+    bool output_stage_started = false;
+    bool frame_stage_started  = false;
+
   public:
     void init() override
     {
         /* Run only once, at startup */
-        auto section = wf::get_core().config.get_section("autostart");
-
         bool panel_manually_started = false;
         bool background_manually_started = false;
+        std::map<std::string, std::string> stages;
 
         for (const auto& [name, command] : autostart_entries.value())
         {
             // Because we accept any option names, we should ignore regular
             // options
-            if (name == "autostart_wf_shell")
+            if ((name == "autostart_wf_shell") || (name == "autostart_stagger_ms"))
+            {
+                continue;
+            }
+
+            if (name.rfind(STAGE_PREFIX, 0) == 0)
             {
+                stages[name.substr(std::strlen(STAGE_PREFIX))] = command;
                 continue;
             }
 
-            wf::get_core().run(command);
+            entries.push_back({name, command});
             if (command.find("wf-panel") != std::string::npos)
             {
                 panel_manually_started = true;
@@ -40,21 +104,204 @@ class wayfire_autostart : public wf::plugin_interface_t
             }
         }
 
+        for (auto& entry : entries)
+        {
+            if (stages.count(entry.name))
+            {
+                entry.stage = parse_stage(entry.name, stages[entry.name]);
+            }
+        }
+
+        // The panel needs an output, and the background only covers the first frame anyway.
         if (autostart_wf_shell && !panel_manually_started)
         {
-            wf::get_core().run("wf-panel");
+            entries.push_back({"wf-panel", "wf-panel", stage_t::OUTPUT});
         }
 
         if (autostart_wf_shell && !background_manually_started)
         {
-            wf::get_core().run("wf-background");
+            entries.push_back({"wf-background", "wf-background", stage_t::FRAME});
         }
+
+        wf::get_core().connect(&on_view_mapped);
+        ready_timeout.set_timeout(READY_TIMEOUT_MS, [=] () { on_view_mapped.disconnect(); });
+
+        start_stage(stage_t::NOW);
+
+        // At startup, the compositor finishes starting up before the event loop runs. If the idle callback
+        // runs first, the plugin was loaded later on.
+        wf::get_core().connect(&on_startup_finished);
+        idle_later_stages.run_once([=] () { start_later_stages(); });
+    }
+
+    void fini() override
+    {
+        idle_later_stages.disconnect();
+        idle_frame_stage.disconnect();
+        on_view_mapped.disconnect();
+        on_startup_finished.disconnect();
+        on_output_added.disconnect();
+        on_frame_done.disconnect();
     }
 
     bool is_unloadable() override
     {
         return false;
     }
+
+  private:
+    static stage_t parse_stage(const std::string& name, const std::string& stage)
+    {
+        static const std::map<std::string, stage_t> stages = {
+            {"now", stage_t::NOW},
+            {"startup", stage_t::STARTUP},
+            {"output", stage_t::OUTPUT},
+            {"frame", stage_t::FRAME},
+        };
+
+        auto it = stages.find(stage);
+        if (it == stages.end())
+        {
+            LOGE("autostart: invalid stage \"", stage, "\" for ", name, ", starting it now");
+            return stage_t::NOW;
+        }
+
+        return it->second;
+    }
+
+    void start_later_stages()
+    {
+        if (later_stages_started)
+        {
+            return;
+        }
+
+        later_stages_started = true;
+        on_startup_finished.disconnect();
+        idle_later_stages.disconnect();
+        start_stage(stage_t::STARTUP);
+
+        auto outputs = wf::get_core().output_layout->get_outputs();
+        if (!outputs.empty())
+        {
+            start_output_stage();
+        } else
+        {
+            wf::get_core().output_layout->connect(&on_output_added);
+        }
+
+        for (auto& output : outputs)
+        {
+            output->connect(&on_frame_done);
+        }
+
+        // Do not wait forever if no output renders, for example with only the noop output.
+        frame_timeout.set_timeout(STAGE_TIMEOUT_MS, [=] ()
+        {
+            idle_frame_stage.run_once([=] () { start_frame_stage(); });
+        });
+    }
+
+    void start_output_stage()
+    {
+        if (!output_stage_started)
+        {
+            output_stage_started = true;
+            on_output_added.disconnect();
+            start_stage(stage_t::OUTPUT);
+        }
+    }
+
+    void start_frame_stage()
+    {
+        start_output_stage();
+        if (!frame_stage_started)
+        {
+            frame_stage_started = true;
+            on_frame_done.disconnect();
+            frame_timeout.disconnect();
+            start_stage(stage_t::FRAME);
+        }
+    }
+
+    void start_stage(stage_t stage)
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].stage == stage)
+            {
+                spawn_queue.push_back(i);
+            }
+        }
+
+        if (!stagger_timer.is_connected() && !idle_spawn.is_connected())
+        {
+            spawn_next();
+        }
+    }
+
+    void spawn_next()
+    {
+        while (!spawn_queue.empty())
+        {
+            auto& entry = entries[spawn_queue.front()];
+            spawn_queue.pop_front();
+
+            entry.spawned = std::chrono::steady_clock::now();
+            entry.pid     = wf::get_core().run(entry.command);
+            LOGD("autostart: started ", entry.name, " (pid ", entry.pid, ")");
+
+            if ((stagger_ms > 0) && !spawn_queue.empty())
+            {
+                // Continue from an idle callback, so that the timer is not rearmed from its own callback.
+                stagger_timer.set_timeout(stagger_ms, [=] ()
+                {
+                    idle_spawn.run_once([=] () { spawn_next(); });
+                });
+                return;
+            }
+        }
+    }
+
+    wf::signal::connection_t<wf::core_startup_finished_signal> on_startup_finished =
+        [=] (wf::core_startup_finished_signal*)
+    {
+        start_later_stages();
+    };
+
+    wf::signal::connection_t<wf::output_added_signal> on_output_added = [=] (wf::output_added_signal *ev)
+    {
+        ev->output->connect(&on_frame_done);
+        start_output_stage();
+    };
+
+    wf::signal::connection_t<wf::frame_done_signal> on_frame_done = [=] (wf::frame_done_signal*)
+    {
+        idle_frame_stage.run_once([=] () { start_frame_stage(); });
+    };
+
+    /** Report the time until each entry maps its first view, as far as its process can be identified. */
+    wf::signal::connection_t<wf::view_mapped_signal> on_view_mapped = [=] (wf::view_mapped_signal *ev)
+    {
+        pid_t pid = 0;
+        if (!ev->view->get_client())
+        {
+            return;
+        }
+
+        wl_client_get_credentials(ev->view->get_client(), &pid, 0, 0);
+        for (auto& entry : entries)
+        {
+            if (!entry.ready && entry.pid && (entry.pid == pid))
+            {
+                entry.ready = true;
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - entry.spawned).count();
+                LOGI("autostart: ", entry.name, " showed its first view ", elapsed, "ms after it was started");
+                wf::startup_profile::record("autostart", entry.name + " ready", entry.spawned);
+            }
+        }
+    };
 };
 
 DECLARE_WAYFIRE_PLUGIN(wayfire_autostart);
@@ -14,24 +14,9 @@
 #include <wayfire/bindings-repository.hpp>
 #include <wayfire/seat.hpp>
 #include <wayfire/util/log.hpp>
+#include <wayfire/plugins/common/key-repeat.hpp>
 #include <plugins/ipc/ipc-method-repository.hpp>
 
-/* Initial repeat delay passed */
-static int repeat_delay_timeout_handler(void *callback)
-{
-    (*reinterpret_cast<std::function<void()>*>(callback))();
-
-    return 1; // disconnect
-}
-
-/* Between each repeat */
-static int repeat_once_handler(void *callback)
-{
-    (*reinterpret_cast<std::function<void()>*>(callback))();
-
-    return 1; // continue timer
-}
-
 /* Provides a way to bind specific commands to activator bindings.
  *
  * It supports 4 modes:
@@ -72,8 +57,7 @@ class wayfire_command : public wf::plugin_interface_t
         command_callback callback;
     } repeat;
 
-    wl_event_source *repeat_source = NULL;
-    wl_event_source *repeat_delay_source = NULL;
+    wf::key_repeat_t repeat_timer;
 
     enum binding_mode
     {
@@ -134,49 +118,21 @@ class wayfire_command : public wf::plugin_interface_t
             repeat.pressed_button = data.activation_data;
         }
 
-        repeat_delay_source = wl_event_loop_add_timer(wf::get_core().ev_loop,
-            repeat_delay_timeout_handler, &on_repeat_delay_timeout);
-
-        wl_event_source_timer_update(repeat_delay_source, wf::option_wrapper_t<int>("input/kb_repeat_delay"));
+        // The command is decided now, so repeats only run it.
+        repeat_timer.set_callback(data.activation_data, [callback] (uint32_t)
+        {
+            callback();
+            return true;
+        });
 
         wf::get_core().connect(&on_button_event);
         wf::get_core().connect(&on_key_event);
         return true;
     }
 
-    std::function<void()> on_repeat_delay_timeout = [=] ()
-    {
-        repeat_delay_source = NULL;
-        repeat_source = wl_event_loop_add_timer(wf::get_core().ev_loop, repeat_once_handler, &on_repeat_once);
-        on_repeat_once();
-    };
-
-    std::function<void()> on_repeat_once = [=] ()
-    {
-        uint32_t repeat_rate = wf::option_wrapper_t<int>("input/kb_repeat_rate");
-        if ((repeat_rate <= 0) || (repeat_rate > 1000))
-        {
-            return reset_repeat();
-        }
-
-        wl_event_source_timer_update(repeat_source, 1000 / repeat_rate);
-        repeat.callback();
-    };
-
     void reset_repeat()
     {
-        if (repeat_delay_source)
-        {
-            wl_event_source_remove(repeat_delay_source);
-            repeat_delay_source = NULL;
-        }
-
-        if (repeat_source)
-        {
-            wl_event_source_remove(repeat_source);
-            repeat_source = NULL;
-        }
-
+        repeat_timer.disconnect();
         repeat.pressed_key = repeat.pressed_button = 0;
         on_button_event.disconnect();
         on_key_event.disconnect();
@@ -288,9 +244,12 @@ class wayfire_command : public wf::plugin_interface_t
         bindings.clear();
     }
 
-    wf::signal::connection_t<wf::reload_config_signal> on_reload_config = [=] (auto)
+    wf::signal::connection_t<wf::reload_config_signal> on_reload_config = [=] (wf::reload_config_signal *ev)
     {
-        setup_bindings_from_config();
+        if (ev->section_changed("command"))
+        {
+            setup_bindings_from_config();
+        }
     };
 
     wf::plugin_activation_data_t grab_interface = {
@@ -42,6 +42,8 @@ class wayfire_expo : public wf::per_output_plugin_instance_t, public wf::keyboar
     wf::option_wrapper_t<bool> keyboard_interaction{"expo/keyboard_interaction"};
     wf::option_wrapper_t<double> inactive_brightness{"expo/inactive_brightness"};
     wf::option_wrapper_t<int> transition_length{"expo/transition_length"};
+    wf::option_wrapper_t<bool> level_of_detail{"expo/level_of_detail"};
+    wf::option_wrapper_t<int> inactive_update_interval{"expo/inactive_update_interval"};
     wf::geometry_animation_t zoom_animation{zoom_duration};
 
     wf::option_wrapper_t<bool> move_enable_snap_off{"move/enable_snap_off"};
@@ -309,6 +311,8 @@ class wayfire_expo : public wf::per_output_plugin_instance_t, public wf::keyboar
     {
         wall->set_background_color(background_color);
         wall->set_gap_size(this->delimiter_offset);
+        wall->set_level_of_detail(level_of_detail);
+        wall->set_focus_workspace(target_ws, inactive_update_interval);
         if (zoom_in)
         {
             zoom_animation.set_start(wall->get_workspace_rectangle(
@@ -691,6 +695,8 @@ class wayfire_expo : public wf::per_output_plugin_instance_t, public wf::keyboar
 
     wf::effect_hook_t pre_frame = [=] ()
     {
+        // The workspace under the cursor is repainted at the full rate
+        wall->set_focus_workspace(target_ws, inactive_update_interval);
         if (zoom_animation.running())
         {
             wall->set_viewport(zoom_animation);
@@ -42,10 +42,11 @@ class extra_gestures_plugin_t : public per_output_plugin_instance_t
      * Run an action on the view under the touch points, if the touch points
      * are on the current output and the view is toplevel.
      */
-    void execute_view_action(std::function<void(wayfire_view)> action)
+    template<class Action>
+    void execute_view_action(Action&& action)
     {
         auto& core = wf::get_core();
-        auto state = core.get_touch_state();
+        const auto& state = core.get_touch_state();
         auto center_touch_point = state.get_center().current;
         wf::pointf_t center     = {center_touch_point.x, center_touch_point.y};
 
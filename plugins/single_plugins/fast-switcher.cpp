@@ -26,6 +26,8 @@ class wayfire_fast_switcher : public wf::per_output_plugin_instance_t, public wf
     wf::option_wrapper_t<double> inactive_alpha{"fast-switcher/inactive_alpha"};
     std::vector<wayfire_toplevel_view> views; // all views on current viewport
     size_t current_view_index = 0;
+    // The index of the view which was last raised above the others, or -1 if the views need a full restack.
+    int raised_view_index = -1;
     // the modifiers which were used to activate switcher
     uint32_t activating_modifiers = 0;
     bool active = false;
@@ -65,11 +67,17 @@ class wayfire_fast_switcher : public wf::per_output_plugin_instance_t, public wf
         current_view_index = i;
         set_view_highlighted(views[i], true);
 
-        for (int i = (int)views.size() - 1; i >= 0; i--)
+        // The views are stacked in focus order, except for the previously raised view. The views after both
+        // it and the new choice are already in place, so only the ones before them are restacked.
+        const int restack_from = (raised_view_index < 0) ?
+            (int)views.size() - 1 : std::max(i, raised_view_index);
+        for (int j = restack_from; j >= 0; j--)
         {
-            wf::view_bring_to_front(views[i]);
+            wf::view_bring_to_front(views[j]);
         }
 
+        raised_view_index = i;
+
         if (reorder_only)
         {
             wf::view_bring_to_front(views[i]);
@@ -91,6 +99,7 @@ class wayfire_fast_switcher : public wf::per_output_plugin_instance_t, public wf
         }
 
         views.erase(views.begin() + i);
+        raised_view_index = -1;
 
         if (views.empty())
         {
@@ -128,12 +137,20 @@ class wayfire_fast_switcher : public wf::per_output_plugin_instance_t, public wf
 
     void update_views()
     {
-        views = output->wset()->get_views(
-            wf::WSET_CURRENT_WORKSPACE | wf::WSET_MAPPED_ONLY | wf::WSET_EXCLUDE_MINIMIZED);
-        std::sort(views.begin(), views.end(), [] (wayfire_toplevel_view& a, wayfire_toplevel_view& b)
-        {
-            return wf::get_focus_timestamp(a) > wf::get_focus_timestamp(b);
-        });
+        // Core keeps the views in focus order, so they only need to be filtered. The storage of the previous
+        // activation is reused.
+        views.clear();
+        auto wset = output->wset();
+        auto ws   = wset->get_current_workspace();
+        for (auto& view : wf::get_core().get_views_by_focus())
+        {
+            auto toplevel = wf::toplevel_cast(view);
+            if (toplevel && (toplevel->get_wset() == wset) && toplevel->is_mapped() &&
+                !toplevel->minimized && wset->view_visible_on(toplevel, ws))
+            {
+                views.push_back(toplevel);
+            }
+        }
     }
 
     bool do_switch(bool forward)
@@ -158,6 +175,7 @@ class wayfire_fast_switcher : public wf::per_output_plugin_instance_t, public wf
         }
 
         current_view_index = 0;
+        raised_view_index  = -1;
         active = true;
 
         /* Set all to semi-transparent */
@@ -27,86 +27,60 @@
 #include <wayfire/opengl.hpp>
 #include <wayfire/util/duration.hpp>
 #include <wayfire/render-manager.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <cmath>
 
-static const char *vertex_shader =
+static const char *fisheye_effect_source =
     R"(
-#version 100
+uniform highp vec2 EFFECT_center;
+uniform highp float EFFECT_radius;
+uniform highp float EFFECT_zoom;
 
-attribute mediump vec2 position;
+highp vec2 EFFECT_warp(highp vec2 pos)
+{
+    const highp float PI = 3.1415926535;
 
-void main() {
+    highp vec2 offset = EFFECT_center - pos;
+    highp float dist  = length(offset);
+    if ((dist >= EFFECT_radius) || (dist == 0.0))
+    {
+        return pos;
+    }
 
-    gl_Position = vec4(position.xy, 0.0, 1.0);
+    // Pixels are taken from closer to the center, the most halfway to the border of the circle. The shift is
+    // limited so that they are always taken from inside of the circle.
+    highp float shift = sin(PI * dist / EFFECT_radius) * (EFFECT_zoom - 1.0) * EFFECT_zoom;
+    shift = clamp(shift, dist - EFFECT_radius, dist + EFFECT_radius);
+    return pos + offset / dist * shift;
 }
-)";
-
-static const char *fragment_shader =
-    R"(
-#version 100
-precision mediump float;
-
-uniform vec2 u_resolution;
-uniform vec2 u_mouse;
-uniform float u_radius;
-uniform float u_zoom;
-uniform sampler2D u_texture;
-
-const float PI = 3.1415926535;
 
-void main()
+mediump vec4 EFFECT(mediump vec4 color)
 {
-        float radius = u_radius;
-
-        float zoom = u_zoom;
-        float pw = 1.0 / u_resolution.x;
-        float ph = 1.0 / u_resolution.y;
-
-        vec4 p0 = vec4(u_mouse.x, u_resolution.y - u_mouse.y, 1.0 / radius, 0.0);
-        vec4 p1 = vec4(pw, ph, PI / radius, (zoom - 1.0) * zoom);
-        vec4 p2 = vec4(0, 0, -PI / 2.0, 0.0);
-
-        vec4 t0, t1, t2, t3;
-
-        vec3 tc = vec3(1.0, 0.0, 0.0);
-        vec2 uv = vec2(gl_FragCoord.x, gl_FragCoord.y);
-
-        t1 = p0.xyww - vec4(uv, 0.0, 0.0);
-        t2.x = t2.y = t2.z = t2.w = 1.0 / sqrt(dot(t1.xyz, t1.xyz));
-        t0 = t2 - p0;
-
-        t3.x = t3.y = t3.z = t3.w = 1.0 / t2.x;
-        t3 = t3 * p1.z + p2.z;
-        t3.x = t3.y = t3.z = t3.w = cos(t3.x);
-
-        t3 = t3 * p1.w;
-
-        t1 = t2 * t1;
-        t1 = t1 * t3 + vec4(uv, 0.0, 0.0);
-
-        if (t0.z < 0.0) {
-                t1.x = uv.x;
-                t1.y = uv.y;
-        }
-
-        t1 = t1 * p1 + p2;
-
-        tc = texture2D(u_texture, t1.xy).rgb;
-
-        gl_FragColor = vec4(tc, 1.0);
+    return color;
 }
 )";
 
+/**
+ * The fisheye distorts only a circle around the cursor, so it is a warp effect (see post_color_effect_t):
+ * it is fused with the other color effects, and only the circle is processed again when the cursor moves or
+ * when something in the circle changes.
+ */
 class wayfire_fisheye : public wf::per_output_plugin_instance_t
 {
     wf::animation::simple_animation_t progression{wf::create_option<int>(300)};
 
-    float target_zoom;
-    bool active, hook_set;
+    bool active   = false;
+    bool hook_set = false;
+    /* Whether the zoom was animating in the last frame */
+    bool animating = false;
 
     wf::option_wrapper_t<double> radius{"fisheye/radius"};
     wf::option_wrapper_t<double> zoom{"fisheye/zoom"};
 
-    OpenGL::program_t program;
+    wf::post_color_effect_t effect;
+    /* The distorted area in the last frame, in output-local coordinates */
+    wf::geometry_t last_area = {0, 0, 0, 0};
 
     wf::plugin_activation_data_t grab_interface = {
         .name = "fisheye",
@@ -116,22 +90,65 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
   public:
     void init() override
     {
-        hook_set = active = false;
         output->add_activator(wf::option_wrapper_t<wf::activatorbinding_t>{"fisheye/toggle"}, &toggle_cb);
 
-        target_zoom = zoom;
         zoom.set_callback([=] ()
         {
             if (active)
             {
                 this->progression.animate(zoom);
+                damage_area();
+            }
+        });
+
+        radius.set_callback([=] ()
+        {
+            if (hook_set)
+            {
+                damage_area();
             }
         });
 
-        OpenGL::render_begin();
-        program.set_simple(
-            OpenGL::compile_program(vertex_shader, fragment_shader));
-        OpenGL::render_end();
+        effect.source = fisheye_effect_source;
+        effect.warp   = true;
+        effect.set_uniforms = [=] (OpenGL::program_t& program, const std::string& prefix)
+        {
+            auto center = get_center();
+            program.uniform2f(prefix + "_center", center.x, center.y);
+            program.uniform1f(prefix + "_radius", radius);
+            program.uniform1f(prefix + "_zoom", progression);
+        };
+    }
+
+    /** The center of the circle, in framebuffer pixels with (0,0) at the bottom-left corner. */
+    wf::pointf_t get_center()
+    {
+        auto oc     = output->get_cursor_position();
+        wlr_box box = {(int)oc.x, (int)oc.y, 1, 1};
+        const auto& fb = output->render->get_target_framebuffer();
+        box = fb.framebuffer_box_from_geometry_box(box);
+        return {(double)box.x, (double)fb.viewport_height - box.y};
+    }
+
+    /** The box around the circle, in output-local coordinates. */
+    wf::geometry_t get_area()
+    {
+        auto oc = output->get_cursor_position();
+        // The radius is given in framebuffer pixels.
+        const double r = radius / output->handle->scale;
+        const int x1   = std::floor(oc.x - r) - 1;
+        const int y1   = std::floor(oc.y - r) - 1;
+        const int x2   = std::ceil(oc.x + r) + 1;
+        const int y2   = std::ceil(oc.y + r) + 1;
+        return {x1, y1, x2 - x1, y2 - y1};
+    }
+
+    /* Damage the area which was distorted in the last frame and the area which will be distorted now. */
+    void damage_area()
+    {
+        output->render->damage(last_area);
+        last_area = get_area();
+        output->render->damage(last_area);
     }
 
     wf::activator_callback toggle_cb = [=] (auto)
@@ -152,60 +169,74 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
             if (!hook_set)
             {
                 hook_set = true;
-                output->render->add_post(&render_hook);
-                output->render->set_redraw_always();
+                output->render->add_post(&effect);
+                output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+                output->connect(&on_scene_damage);
+                wf::get_core().connect(&on_motion);
+                wf::get_core().connect(&on_absolute_motion);
             }
         }
 
+        damage_area();
         return true;
     };
 
-    wf::post_hook_t render_hook = [=] (const wf::framebuffer_t& source,
-                                       const wf::framebuffer_t& dest)
+    wf::effect_hook_t pre_hook = [=] ()
     {
-        auto oc     = output->get_cursor_position();
-        wlr_box box = {(int)oc.x, (int)oc.y, 1, 1};
-        box = output->render->get_target_framebuffer().
-            framebuffer_box_from_geometry_box(box);
-        oc.x = box.x;
-        oc.y = box.y;
-
-        static const float vertexData[] = {
-            -1.0f, -1.0f,
-            1.0f, -1.0f,
-            1.0f, 1.0f,
-            -1.0f, 1.0f
-        };
-
-        OpenGL::render_begin(dest);
-        program.use(wf::TEXTURE_TYPE_RGBA);
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, source.tex));
-        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        if (!active && !progression.running())
+        {
+            finalize();
+            return;
+        }
 
-        program.uniform2f("u_mouse", oc.x, oc.y);
-        program.uniform2f("u_resolution", dest.viewport_width, dest.viewport_height);
-        program.uniform1f("u_radius", radius);
-        program.uniform1f("u_zoom", progression);
+        // Damage the frame after the animation too, so that its final zoom gets painted.
+        if (progression.running() || animating)
+        {
+            animating = progression.running();
+            damage_area();
+        }
+    };
 
-        program.attrib_pointer("position", 2, 0, vertexData);
+    void on_cursor_moved()
+    {
+        if (get_area() != last_area)
+        {
+            damage_area();
+        }
+    }
 
-        GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion = [=] (auto)
+    {
+        on_cursor_moved();
+    };
 
-        program.deactivate();
-        OpenGL::render_end();
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_absolute_event>>
+    on_absolute_motion = [=] (auto)
+    {
+        on_cursor_moved();
+    };
 
-        if (!active && !progression.running())
+    /* Pixels in the circle are taken from other positions in the circle, so damage in it affects all of it. */
+    wf::signal::connection_t<wf::output_scene_damage_signal> on_scene_damage =
+        [=] (wf::output_scene_damage_signal *ev)
+    {
+        // The damage is in the coordinate system of the scenegraph root.
+        auto area = last_area + wf::origin(output->get_layout_geometry());
+        if (!(*ev->region & area).empty())
         {
-            finalize();
+            output->render->damage(last_area);
         }
     };
 
     void finalize()
     {
-        output->render->rem_post(&render_hook);
-        output->render->set_redraw_always(false);
-        hook_set = false;
+        output->render->rem_post(&effect);
+        output->render->rem_effect(&pre_hook);
+        on_scene_damage.disconnect();
+        on_motion.disconnect();
+        on_absolute_motion.disconnect();
+        hook_set  = false;
+        animating = false;
     }
 
     void fini() override
@@ -215,10 +246,6 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
             finalize();
         }
 
-        OpenGL::render_begin();
-        program.free_resources();
-        OpenGL::render_end();
-
         output->rem_binding(&toggle_cb);
     }
 };
@@ -43,6 +43,23 @@ class wayfire_idle
     wf::signal::connection_t<wf::seat_activity_signal> on_seat_activity;
     std::optional<wf::idle_inhibitor_t> hotkey_inhibitor;
     wf::wl_timer<false> timeout_dpms;
+    /* Seat activity arrives with every input event, restart the timeout once per event loop iteration. */
+    wf::wl_idle_call idle_restart_dpms;
+
+    wf::signal::connection_t<wf::idle_inhibit_changed_signal> inhibit_changed =
+        [=] (wf::idle_inhibit_changed_signal *ev)
+    {
+        if (ev->inhibit)
+        {
+            on_seat_activity.disconnect();
+            idle_restart_dpms.disconnect();
+            timeout_dpms.disconnect();
+        } else
+        {
+            wf::get_core().connect(&on_seat_activity);
+            create_dpms_timeout();
+        }
+    };
 
     wayfire_idle()
     {
@@ -53,10 +70,11 @@ class wayfire_idle
 
         on_seat_activity = [=] (void*)
         {
-            create_dpms_timeout();
+            idle_restart_dpms.run_once([=] () { create_dpms_timeout(); });
         };
         create_dpms_timeout();
         wf::get_core().connect(&on_seat_activity);
+        wf::get_core().connect(&inhibit_changed);
     }
 
     void create_dpms_timeout()
@@ -86,7 +104,9 @@ class wayfire_idle
     ~wayfire_idle()
     {
         timeout_dpms.disconnect();
+        idle_restart_dpms.disconnect();
         wf::get_core().disconnect(&on_seat_activity);
+        wf::get_core().disconnect(&inhibit_changed);
     }
 
     /* Change all outputs with state from to state to */
@@ -126,6 +146,7 @@ class wayfire_idle_plugin : public wf::per_output_plugin_instance_t
     bool output_inhibited = false;
     uint32_t last_time;
     wf::wl_timer<false> timeout_screensaver;
+    wf::wl_idle_call idle_restart_screensaver;
     wf::signal::connection_t<wf::seat_activity_signal> on_seat_activity;
     wf::shared_data::ref_ptr_t<wayfire_idle> global_idle;
 
@@ -157,17 +178,15 @@ class wayfire_idle_plugin : public wf::per_output_plugin_instance_t
             return;
         }
 
+        // The DPMS timeout is shared by all outputs and handled by global_idle itself.
         if (ev->inhibit)
         {
-            wf::get_core().disconnect(&global_idle->on_seat_activity);
             wf::get_core().disconnect(&on_seat_activity);
-            global_idle->timeout_dpms.disconnect();
+            idle_restart_screensaver.disconnect();
             timeout_screensaver.disconnect();
         } else
         {
-            wf::get_core().connect(&global_idle->on_seat_activity);
             wf::get_core().connect(&on_seat_activity);
-            global_idle->create_dpms_timeout();
             create_screensaver_timeout();
         }
     };
@@ -228,7 +247,7 @@ class wayfire_idle_plugin : public wf::per_output_plugin_instance_t
 
         on_seat_activity = [=] (void*)
         {
-            create_screensaver_timeout();
+            idle_restart_screensaver.run_once([=] () { create_screensaver_timeout(); });
         };
         wf::get_core().connect(&on_seat_activity);
         wf::get_core().connect(&inhibit_changed);
@@ -421,6 +440,7 @@ class wayfire_idle_plugin : public wf::per_output_plugin_instance_t
         wf::get_core().disconnect(&on_seat_activity);
         wf::get_core().disconnect(&inhibit_changed);
         timeout_screensaver.disconnect();
+        idle_restart_screensaver.disconnect();
         output->rem_binding(&toggle);
     }
 };
@@ -47,6 +47,15 @@ class wayfire_move : public wf::per_output_plugin_instance_t,
         wf::grid::slot_t slot_id = wf::grid::SLOT_NONE;
     } slot;
 
+    /* The part of the workarea in which the input does not snap to any slot, so that motion inside of it does
+     * not need to calculate the slot. Recalculated when the workarea or the threshold changes. */
+    struct
+    {
+        wf::geometry_t workarea = {0, 0, 0, 0};
+        int threshold = -1;
+        wf::geometry_t free_area = {0, 0, 0, 0};
+    } snap_cache;
+
 
     wf::wl_timer<false> workspace_switch_timer;
 
@@ -373,22 +382,33 @@ class wayfire_move : public wf::per_output_plugin_instance_t,
     wf::grid::slot_t calc_slot(wf::point_t point)
     {
         auto g = output->workarea->get_workarea();
-        if (!(output->get_relative_geometry() & point))
+        int threshold = snap_threshold;
+        if ((g != snap_cache.workarea) || (threshold != snap_cache.threshold))
         {
-            return wf::grid::SLOT_NONE;
+            snap_cache.workarea  = g;
+            snap_cache.threshold = threshold;
+            snap_cache.free_area = {
+                g.x + threshold + 1,
+                g.y + threshold,
+                g.width - 2 * threshold - 1,
+                g.height - 2 * threshold + 1,
+            };
         }
 
-        int threshold = snap_threshold;
+        if ((snap_cache.free_area & point) || !(output->get_relative_geometry() & point))
+        {
+            return wf::grid::SLOT_NONE;
+        }
 
         bool is_left   = point.x - g.x <= threshold;
         bool is_right  = g.x + g.width - point.x <= threshold;
         bool is_top    = point.y - g.y < threshold;
-        bool is_bottom = g.x + g.height - point.y < threshold;
+        bool is_bottom = g.y + g.height - point.y < threshold;
 
         bool is_far_left   = point.x - g.x <= quarter_snap_threshold;
         bool is_far_right  = g.x + g.width - point.x <= quarter_snap_threshold;
         bool is_far_top    = point.y - g.y < quarter_snap_threshold;
-        bool is_far_bottom = g.x + g.height - point.y < quarter_snap_threshold;
+        bool is_far_bottom = g.y + g.height - point.y < quarter_snap_threshold;
 
         wf::grid::slot_t slot = wf::grid::SLOT_NONE;
         if ((is_left && is_far_top) || (is_far_left && is_top))
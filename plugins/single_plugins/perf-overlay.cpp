@@ -0,0 +1,344 @@
+#include <wayfire/per-output-plugin.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <wayfire/plugins/common/cairo-util.hpp>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+/**
+ * Shows an overlay with the performance of the output: a graph of the paint time of the recent frames, the
+ * GPU time, late frames, repaint delay, damaged area, number of render instances and direct scanout.
+ *
+ * The overlay is redrawn into a texture only every update_interval milliseconds, and damages only its own
+ * box, so that it does not cause extra repaints of the output. Each frame draws the texture once.
+ */
+class wayfire_perf_overlay : public wf::per_output_plugin_instance_t
+{
+    static constexpr int OVERLAY_WIDTH  = 280;
+    static constexpr int OVERLAY_HEIGHT = 160;
+    static constexpr int GRAPH_HEIGHT   = 50;
+    static constexpr size_t HISTORY_SIZE = 120;
+    static constexpr int MARGIN = 10;
+
+    wf::option_wrapper_t<wf::activatorbinding_t> toggle_key{"perf-overlay/toggle"};
+    wf::option_wrapper_t<std::string> position{"perf-overlay/position"};
+    wf::option_wrapper_t<int> update_interval{"perf-overlay/update_interval"};
+
+    bool active = false;
+
+    // Paint time of the recent frames, in microseconds.
+    std::deque<int64_t> paint_times;
+    int64_t paint_start = 0;
+
+    // Damaged fraction of the output, accumulated since the last update of the overlay.
+    double damage_sum = 0;
+    int damage_frames = 0;
+    double damage_percent = 0;
+
+    wf::simple_texture_t tex;
+    cairo_surface_t *surface = nullptr;
+    cairo_t *cr = nullptr;
+    float scale = 1.0;
+
+    wf::wl_timer<true> update_timer;
+    wf::activator_callback toggle_cb = [=] (auto)
+    {
+        set_active(!active);
+        return true;
+    };
+
+    wf::effect_hook_t pre_hook = [=] ()
+    {
+        paint_start = wf::get_current_time_us();
+    };
+
+    wf::effect_hook_t overlay_hook = [=] ()
+    {
+        record_damage();
+        render();
+    };
+
+    wf::effect_hook_t post_hook = [=] ()
+    {
+        paint_times.push_back(wf::get_current_time_us() - paint_start);
+        if (paint_times.size() > HISTORY_SIZE)
+        {
+            paint_times.pop_front();
+        }
+    };
+
+  public:
+    void init() override
+    {
+        output->add_activator(toggle_key, &toggle_cb);
+        position.set_callback([=] ()
+        {
+            if (active)
+            {
+                output->render->damage_whole();
+            }
+        });
+    }
+
+    void fini() override
+    {
+        set_active(false);
+        output->rem_binding(&toggle_cb);
+        free_surface();
+    }
+
+  private:
+    void set_active(bool enable)
+    {
+        if (enable == active)
+        {
+            return;
+        }
+
+        active = enable;
+        if (active)
+        {
+            output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+            output->render->add_effect(&overlay_hook, wf::OUTPUT_EFFECT_OVERLAY);
+            output->render->add_effect(&post_hook, wf::OUTPUT_EFFECT_POST);
+            update_overlay();
+            update_timer.set_timeout(std::max(16, (int)update_interval), [=] ()
+            {
+                update_overlay();
+                return true;
+            });
+        } else
+        {
+            update_timer.disconnect();
+            output->render->rem_effect(&pre_hook);
+            output->render->rem_effect(&overlay_hook);
+            output->render->rem_effect(&post_hook);
+            output->render->damage(get_box());
+            paint_times.clear();
+            tex.release();
+        }
+    }
+
+    /** @return The box of the overlay, in output-local coordinates. */
+    wf::geometry_t get_box()
+    {
+        auto size = output->get_screen_size();
+        wf::geometry_t box{MARGIN, MARGIN, OVERLAY_WIDTH, OVERLAY_HEIGHT};
+        const std::string pos = position;
+        if (pos.find("right") != std::string::npos)
+        {
+            box.x = size.width - OVERLAY_WIDTH - MARGIN;
+        }
+
+        if (pos.find("bottom") != std::string::npos)
+        {
+            box.y = size.height - OVERLAY_HEIGHT - MARGIN;
+        }
+
+        return box;
+    }
+
+    /** Accumulate the damaged fraction of the output in the current frame, excluding the overlay itself. */
+    void record_damage()
+    {
+        const int total = output->handle->width * output->handle->height;
+        if (total <= 0)
+        {
+            return;
+        }
+
+        auto own_box = get_box();
+        wf::geometry_t own_pixels = {
+            (int)std::floor(own_box.x * output->handle->scale),
+            (int)std::floor(own_box.y * output->handle->scale),
+            (int)std::ceil(own_box.width * output->handle->scale),
+            (int)std::ceil(own_box.height * output->handle->scale),
+        };
+
+        auto damage = output->render->get_swap_damage() ^ own_pixels;
+        int64_t area = 0;
+        for (const auto& box : damage)
+        {
+            area += int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+        }
+
+        damage_sum += (double)area / total;
+        ++damage_frames;
+    }
+
+    void free_surface()
+    {
+        if (cr)
+        {
+            cairo_destroy(cr);
+        }
+
+        if (surface)
+        {
+            cairo_surface_destroy(surface);
+        }
+
+        cr = nullptr;
+        surface = nullptr;
+    }
+
+    void ensure_surface()
+    {
+        const int width  = std::ceil(OVERLAY_WIDTH * scale);
+        const int height = std::ceil(OVERLAY_HEIGHT * scale);
+        if (surface && (cairo_image_surface_get_width(surface) == width) &&
+            (cairo_image_surface_get_height(surface) == height))
+        {
+            return;
+        }
+
+        free_surface();
+        surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        cr = cairo_create(surface);
+    }
+
+    static std::string format_ms(int64_t us)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << us / 1000.0 << " ms";
+        return out.str();
+    }
+
+    void draw_graph(int64_t budget_us)
+    {
+        const double width  = OVERLAY_WIDTH * scale - 2 * MARGIN * scale;
+        const double height = GRAPH_HEIGHT * scale;
+        const double x0     = MARGIN * scale;
+        const double y0     = MARGIN * scale;
+
+        int64_t max_us = 2 * budget_us;
+        for (auto t : paint_times)
+        {
+            max_us = std::max(max_us, t);
+        }
+
+        cairo_set_source_rgba(cr, 1, 1, 1, 0.1);
+        cairo_rectangle(cr, x0, y0, width, height);
+        cairo_fill(cr);
+
+        const double bar_width = width / HISTORY_SIZE;
+        double x = x0 + width - bar_width * paint_times.size();
+        for (auto t : paint_times)
+        {
+            const double h = height * t / max_us;
+            if (t > budget_us)
+            {
+                cairo_set_source_rgba(cr, 1, 0.3, 0.3, 1);
+            } else
+            {
+                cairo_set_source_rgba(cr, 0.3, 1, 0.3, 1);
+            }
+
+            cairo_rectangle(cr, x, y0 + height - h, std::max(1.0, bar_width - 1), h);
+            cairo_fill(cr);
+            x += bar_width;
+        }
+
+        // The time available for one frame at the refresh rate of the output.
+        const double budget_y = y0 + height - height * budget_us / max_us;
+        cairo_set_source_rgba(cr, 1, 1, 0, 0.8);
+        cairo_set_line_width(cr, scale);
+        cairo_move_to(cr, x0, budget_y);
+        cairo_line_to(cr, x0 + width, budget_y);
+        cairo_stroke(cr);
+    }
+
+    /** Redraw the contents of the overlay into its texture and damage its box. */
+    void update_overlay()
+    {
+        scale = output->handle->scale;
+        ensure_surface();
+
+        if (damage_frames > 0)
+        {
+            damage_percent = 100.0 * damage_sum / damage_frames;
+        }
+
+        damage_sum    = 0;
+        damage_frames = 0;
+
+        auto stats = output->render->get_frame_stats();
+        const int refresh_mhz = output->handle->refresh;
+        const int64_t budget_us = refresh_mhz > 0 ? 1'000'000'000ll / refresh_mhz : 16'667;
+
+        cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_rgba(cr, 0, 0, 0, 0.7);
+        cairo_paint(cr);
+        cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+        draw_graph(budget_us);
+
+        const auto& gpu = stats.stages[wf::FRAME_STAGE_GPU];
+        std::vector<std::string> lines = {
+            "paint: " + (paint_times.empty() ? std::string("-") : format_ms(paint_times.back())) +
+            " / budget " + format_ms(budget_us),
+            "gpu p50: " + (stats.gpu_timer_supported && gpu.samples ? format_ms(gpu.p50) : std::string("n/a")),
+            "late frames: " + std::to_string(stats.late_frames),
+            "repaint delay: " + std::to_string(stats.repaint_delay) + " ms",
+            "damage: " + std::to_string((int)std::round(damage_percent)) + "%",
+            "render instances: " + std::to_string(stats.render_instances),
+            std::string("direct scanout: ") + (stats.direct_scanout ? "yes" : "no"),
+        };
+
+        cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+        cairo_set_font_size(cr, 11 * scale);
+        cairo_set_source_rgba(cr, 1, 1, 1, 1);
+        double y = (MARGIN + GRAPH_HEIGHT + 16) * scale;
+        for (const auto& line : lines)
+        {
+            cairo_move_to(cr, MARGIN * scale, y);
+            cairo_show_text(cr, line.c_str());
+            y += 13 * scale;
+        }
+
+        cairo_surface_flush(surface);
+        OpenGL::render_begin();
+        cairo_surface_upload_to_texture(surface, tex);
+        OpenGL::render_end();
+
+        // Damage without scheduling a repaint: the overlay is updated with the next frame of the output.
+        output->render->damage(get_box(), false);
+    }
+
+    void render()
+    {
+        if (tex.tex == (GLuint) - 1)
+        {
+            return;
+        }
+
+        auto out_fb = output->render->get_target_framebuffer();
+        auto box    = get_box();
+        auto damage = output->render->get_scheduled_damage() & box;
+        if (damage.empty())
+        {
+            return;
+        }
+
+        auto ortho = out_fb.get_orthographic_projection();
+
+        OpenGL::render_begin(out_fb);
+        for (auto& rect : damage)
+        {
+            out_fb.logic_scissor(wlr_box_from_pixman_box(rect));
+            OpenGL::render_transformed_texture(tex.tex, box, ortho, glm::vec4(1.f),
+                OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
+        }
+
+        OpenGL::render_end();
+    }
+};
+
+DECLARE_WAYFIRE_PLUGIN(wf::per_output_plugin_t<wayfire_perf_overlay>);
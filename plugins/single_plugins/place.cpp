@@ -6,6 +6,112 @@
 #include <wayfire/workarea.hpp>
 #include <wayfire/window-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/workspace-set.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+/**
+ * An index of the free space in an area, stored as the list of maximal empty rectangles.
+ *
+ * Occupying a rectangle only splits the free rectangles which intersect it, so placing several views one
+ * after another does not need to look at the views which were placed before.
+ */
+class free_space_index_t
+{
+  public:
+    void reset(wf::geometry_t area)
+    {
+        free.clear();
+        if ((area.width > 0) && (area.height > 0))
+        {
+            free.push_back(area);
+        }
+    }
+
+    void occupy(wf::geometry_t box)
+    {
+        std::vector<wf::geometry_t> result;
+        for (auto& rect : free)
+        {
+            auto common = wf::geometry_intersection(rect, box);
+            if ((common.width <= 0) || (common.height <= 0))
+            {
+                result.push_back(rect);
+                continue;
+            }
+
+            // The parts of the rectangle left, right, above and below of the box, each as large as possible.
+            const wf::geometry_t parts[] = {
+                {rect.x, rect.y, common.x - rect.x, rect.height},
+                {common.x + common.width, rect.y, rect.x + rect.width - common.x - common.width, rect.height},
+                {rect.x, rect.y, rect.width, common.y - rect.y},
+                {rect.x, common.y + common.height, rect.width, rect.y + rect.height - common.y - common.height},
+            };
+
+            for (auto& part : parts)
+            {
+                if ((part.width > 0) && (part.height > 0))
+                {
+                    result.push_back(part);
+                }
+            }
+        }
+
+        // Keep only the maximal rectangles
+        free.clear();
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            bool contained = false;
+            for (size_t j = 0; j < result.size() && !contained; j++)
+            {
+                // For equal rectangles, only the first one is kept.
+                contained = (i != j) && contains(result[j], result[i]) &&
+                    (!contains(result[i], result[j]) || (j < i));
+            }
+
+            if (!contained)
+            {
+                free.push_back(result[i]);
+            }
+        }
+    }
+
+    /**
+     * Find the top-most (and then left-most) position where a rectangle of the given size fits into the free
+     * space.
+     */
+    std::optional<wf::point_t> find_position(wf::dimensions_t size) const
+    {
+        std::optional<wf::point_t> best;
+        for (auto& rect : free)
+        {
+            if ((rect.width < size.width) || (rect.height < size.height))
+            {
+                continue;
+            }
+
+            if (!best || (rect.y < best->y) || ((rect.y == best->y) && (rect.x < best->x)))
+            {
+                best = wf::point_t{rect.x, rect.y};
+            }
+        }
+
+        return best;
+    }
+
+  private:
+    std::vector<wf::geometry_t> free;
+
+    static bool contains(const wf::geometry_t& outer, const wf::geometry_t& inner)
+    {
+        return (inner.x >= outer.x) && (inner.y >= outer.y) &&
+               (inner.x + inner.width <= outer.x + outer.width) &&
+               (inner.y + inner.height <= outer.y + outer.height);
+    }
+};
 
 class wayfire_place_window : public wf::per_output_plugin_instance_t
 {
@@ -26,6 +132,9 @@ class wayfire_place_window : public wf::per_output_plugin_instance_t
         if (mode == "cascade")
         {
             cascade(toplevel, workarea);
+        } else if (mode == "smart")
+        {
+            smart(toplevel, workarea);
         } else if (mode == "maximize")
         {
             maximize(toplevel, workarea);
@@ -40,6 +149,7 @@ class wayfire_place_window : public wf::per_output_plugin_instance_t
 
     wf::signal::connection_t<wf::workarea_changed_signal> workarea_changed_cb = [=] (auto)
     {
+        free_space_dirty = true;
         auto workarea = output->workarea->get_workarea();
         if ((cascade_x < workarea.x) ||
             (cascade_x > workarea.x + workarea.width))
@@ -58,6 +168,47 @@ class wayfire_place_window : public wf::per_output_plugin_instance_t
 
     int cascade_x, cascade_y;
 
+    /* The free space on the current workspace, for the smart placement mode. It is rebuilt from the views on
+     * the workspace only after they changed, views placed in the meantime are added incrementally. */
+    free_space_index_t free_space;
+    bool free_space_dirty = true;
+    /* The view which is being placed, its own geometry changes do not invalidate the index. */
+    wayfire_toplevel_view placing = nullptr;
+
+    wf::signal::connection_t<wf::view_geometry_changed_signal> on_view_geometry_changed =
+        [=] (wf::view_geometry_changed_signal *ev)
+    {
+        if (ev->view != placing)
+        {
+            free_space_dirty = true;
+        }
+    };
+
+    wf::signal::connection_t<wf::view_unmapped_signal> on_view_unmapped = [=] (auto)
+    {
+        free_space_dirty = true;
+    };
+
+    wf::signal::connection_t<wf::view_minimized_signal> on_view_minimized = [=] (auto)
+    {
+        free_space_dirty = true;
+    };
+
+    wf::signal::connection_t<wf::view_set_output_signal> on_view_set_output = [=] (auto)
+    {
+        free_space_dirty = true;
+    };
+
+    wf::signal::connection_t<wf::workspace_changed_signal> on_workspace_changed = [=] (auto)
+    {
+        free_space_dirty = true;
+    };
+
+    wf::signal::connection_t<wf::workspace_set_changed_signal> on_wset_changed = [=] (auto)
+    {
+        free_space_dirty = true;
+    };
+
   public:
     void init() override
     {
@@ -67,6 +218,50 @@ class wayfire_place_window : public wf::per_output_plugin_instance_t
 
         output->connect(&workarea_changed_cb);
         output->connect(&on_view_mapped);
+        output->connect(&on_view_geometry_changed);
+        output->connect(&on_view_unmapped);
+        output->connect(&on_view_minimized);
+        output->connect(&on_view_set_output);
+        output->connect(&on_workspace_changed);
+        output->connect(&on_wset_changed);
+    }
+
+    void rebuild_free_space(wayfire_toplevel_view except, wf::geometry_t workarea)
+    {
+        free_space.reset(workarea);
+        auto views = output->wset()->get_views(
+            wf::WSET_CURRENT_WORKSPACE | wf::WSET_MAPPED_ONLY | wf::WSET_EXCLUDE_MINIMIZED);
+        for (auto& view : views)
+        {
+            if (view != except)
+            {
+                free_space.occupy(view->get_pending_geometry());
+            }
+        }
+
+        free_space_dirty = false;
+    }
+
+    /* Place the view at the top-left-most free spot of the workarea, or center it if there is none. */
+    void smart(wayfire_toplevel_view & view, wf::geometry_t workarea)
+    {
+        if (free_space_dirty)
+        {
+            rebuild_free_space(view, workarea);
+        }
+
+        wf::geometry_t window = view->get_pending_geometry();
+        auto position = free_space.find_position(wf::dimensions(window));
+        if (!position)
+        {
+            center(view, workarea);
+            return;
+        }
+
+        placing = view;
+        view->move(position->x, position->y);
+        placing = nullptr;
+        free_space.occupy({position->x, position->y, window.width, window.height});
     }
 
     void cascade(wayfire_toplevel_view & view, wf::geometry_t workarea)
@@ -6,6 +6,8 @@
 #include <wayfire/seat.hpp>
 #include <wayfire/output-layout.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
+#include <wayfire/txn/transaction-manager.hpp>
+#include <wayfire/util.hpp>
 #include <chrono>
 
 namespace wf
@@ -35,6 +37,25 @@ class preserve_output_t : public wf::plugin_interface_t
     wf::option_wrapper_t<int> last_output_focus_timeout{"preserve-output/last_output_focus_timeout"};
     std::map<std::string, per_output_state_t> saved_outputs;
 
+    /**
+     * Outputs are usually added or removed in groups, for example when a docking station is (dis)connected.
+     * All changes to views caused by restoring or saving outputs (new geometry of the views in the restored
+     * workspace sets, views migrated to other outputs, etc.) until the next idle are collected in a single
+     * transaction, so that they are applied at once instead of output by output.
+     */
+    wf::wl_idle_call idle_end_batch;
+    void batch_until_idle()
+    {
+        if (!idle_end_batch.is_connected())
+        {
+            wf::get_core().tx_manager->begin_batch();
+            idle_end_batch.run_once([] ()
+            {
+                wf::get_core().tx_manager->end_batch();
+            });
+        }
+    }
+
     bool focused_output_expired(const per_output_state_t& state) const
     {
         using namespace std::chrono;
@@ -82,6 +103,7 @@ class preserve_output_t : public wf::plugin_interface_t
         }
 
         LOGD("Restoring workspace set ", data.workspace_set->get_index(), " to output ", output->to_string());
+        batch_until_idle();
         output->set_workspace_set(data.workspace_set);
         if (data.was_focused && !focused_output_expired(data))
         {
@@ -102,6 +124,7 @@ class preserve_output_t : public wf::plugin_interface_t
         if (wf::get_core().get_current_state() == compositor_state_t::RUNNING)
         {
             LOGD("Received pre-remove event: ", ev->output->to_string());
+            batch_until_idle();
             save_output(ev->output);
         }
     };
@@ -123,6 +146,15 @@ class preserve_output_t : public wf::plugin_interface_t
         wf::get_core().output_layout->connect(&on_new_output);
         wf::get_core().output_layout->connect(&output_pre_remove);
     }
+
+    void fini() override
+    {
+        if (idle_end_batch.is_connected())
+        {
+            idle_end_batch.disconnect();
+            wf::get_core().tx_manager->end_batch();
+        }
+    }
 };
 }
 }
@@ -0,0 +1,613 @@
+#include "wayfire/core.hpp"
+#include "wayfire/plugin.hpp"
+#include "wayfire/scene-operations.hpp"
+#include <wayfire/workspace-set.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/toplevel-view.hpp>
+#include <wayfire/window-manager.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Saves the placement of outputs and views on shutdown, and restores it after the next start, so that a
+ * restart of the compositor (e.g. after an update) does not leave clients restored by session management in a
+ * default layout.
+ *
+ * The checkpoint is a small binary file. It is restored lazily: outputs get their workspace back when they
+ * are added, views when a view with the same app-id (and preferably the same title) is mapped. Views are
+ * returned to their workspace set when a set with the same index exists at that point. Entries which were not
+ * claimed within the restore timeout are dropped.
+ */
+namespace wf
+{
+namespace session_checkpoint
+{
+static constexpr uint32_t CHECKPOINT_MAGIC   = 0x50434657; // "WFCP"
+static constexpr uint32_t CHECKPOINT_VERSION = 2;
+
+struct output_entry_t
+{
+    std::string identifier;
+    std::string name;
+    wf::point_t workspace;
+};
+
+struct view_entry_t
+{
+    std::string app_id;
+    std::string title;
+    std::string output_identifier;
+    // The index of the workspace set of the view, which may be different from the one shown on the output.
+    uint32_t wset_index;
+    wf::point_t workspace;
+    // Relative to the workspace of the view.
+    wf::geometry_t geometry;
+    uint32_t tiled_edges;
+    bool minimized;
+    bool sticky;
+    bool fullscreen;
+};
+
+struct checkpoint_t
+{
+    std::vector<output_entry_t> outputs;
+    std::vector<view_entry_t> views;
+};
+
+static std::string make_output_identifier(wf::output_t *output)
+{
+    std::string identifier = "";
+    identifier += nonull(output->handle->make);
+    identifier += "|";
+    identifier += nonull(output->handle->model);
+    identifier += "|";
+    identifier += nonull(output->handle->serial);
+    return identifier;
+}
+
+class writer_t
+{
+  public:
+    std::string data;
+
+    void put_u32(uint32_t value)
+    {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_i32(int32_t value)
+    {
+        put_u32(static_cast<uint32_t>(value));
+    }
+
+    void put_string(const std::string& str)
+    {
+        put_u32(str.size());
+        data.append(str);
+    }
+};
+
+/** Reads the checkpoint, all functions return false if the data is truncated. */
+class reader_t
+{
+  public:
+    reader_t(const std::string& data) : data(data)
+    {}
+
+    bool get_u32(uint32_t& value)
+    {
+        if (data.size() - pos < sizeof(value))
+        {
+            return false;
+        }
+
+        std::copy_n(data.data() + pos, sizeof(value), reinterpret_cast<char*>(&value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool get_i32(int32_t& value)
+    {
+        uint32_t raw;
+        if (!get_u32(raw))
+        {
+            return false;
+        }
+
+        value = static_cast<int32_t>(raw);
+        return true;
+    }
+
+    bool get_string(std::string& str)
+    {
+        uint32_t size;
+        if (!get_u32(size) || (data.size() - pos < size))
+        {
+            return false;
+        }
+
+        str.assign(data, pos, size);
+        pos += size;
+        return true;
+    }
+
+  private:
+    const std::string& data;
+    size_t pos = 0;
+};
+
+static std::string serialize(const checkpoint_t& checkpoint)
+{
+    writer_t out;
+    out.put_u32(CHECKPOINT_MAGIC);
+    out.put_u32(CHECKPOINT_VERSION);
+
+    out.put_u32(checkpoint.outputs.size());
+    for (auto& output : checkpoint.outputs)
+    {
+        out.put_string(output.identifier);
+        out.put_string(output.name);
+        out.put_i32(output.workspace.x);
+        out.put_i32(output.workspace.y);
+    }
+
+    out.put_u32(checkpoint.views.size());
+    for (auto& view : checkpoint.views)
+    {
+        out.put_string(view.app_id);
+        out.put_string(view.title);
+        out.put_string(view.output_identifier);
+        out.put_u32(view.wset_index);
+        out.put_i32(view.workspace.x);
+        out.put_i32(view.workspace.y);
+        out.put_i32(view.geometry.x);
+        out.put_i32(view.geometry.y);
+        out.put_i32(view.geometry.width);
+        out.put_i32(view.geometry.height);
+        out.put_u32(view.tiled_edges);
+        out.put_u32((view.minimized ? 1 : 0) | (view.sticky ? 2 : 0) | (view.fullscreen ? 4 : 0));
+    }
+
+    return out.data;
+}
+
+static std::optional<checkpoint_t> deserialize(const std::string& data)
+{
+    reader_t in{data};
+    uint32_t magic, version, count;
+    if (!in.get_u32(magic) || !in.get_u32(version) || (magic != CHECKPOINT_MAGIC) ||
+        (version != CHECKPOINT_VERSION))
+    {
+        return {};
+    }
+
+    checkpoint_t checkpoint;
+    if (!in.get_u32(count))
+    {
+        return {};
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        output_entry_t output;
+        if (!in.get_string(output.identifier) || !in.get_string(output.name) ||
+            !in.get_i32(output.workspace.x) || !in.get_i32(output.workspace.y))
+        {
+            return {};
+        }
+
+        checkpoint.outputs.push_back(std::move(output));
+    }
+
+    if (!in.get_u32(count))
+    {
+        return {};
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        view_entry_t view;
+        uint32_t flags;
+        if (!in.get_string(view.app_id) || !in.get_string(view.title) ||
+            !in.get_string(view.output_identifier) || !in.get_u32(view.wset_index) ||
+            !in.get_i32(view.workspace.x) || !in.get_i32(view.workspace.y) ||
+            !in.get_i32(view.geometry.x) || !in.get_i32(view.geometry.y) ||
+            !in.get_i32(view.geometry.width) || !in.get_i32(view.geometry.height) ||
+            !in.get_u32(view.tiled_edges) || !in.get_u32(flags))
+        {
+            return {};
+        }
+
+        view.minimized  = flags & 1;
+        view.sticky     = flags & 2;
+        view.fullscreen = flags & 4;
+        checkpoint.views.push_back(std::move(view));
+    }
+
+    return checkpoint;
+}
+
+static std::filesystem::path default_checkpoint_path()
+{
+    const char *state_home = getenv("XDG_STATE_HOME");
+    const char *home = getenv("HOME");
+    if (state_home && *state_home)
+    {
+        return std::filesystem::path(state_home) / "wayfire" / "checkpoint";
+    }
+
+    return home ? (std::filesystem::path(home) / ".local/state/wayfire/checkpoint") : "";
+}
+
+class session_checkpoint_t : public wf::plugin_interface_t
+{
+    wf::option_wrapper_t<std::string> checkpoint_file{"session-checkpoint/file"};
+    wf::option_wrapper_t<int> restore_timeout{"session-checkpoint/restore_timeout"};
+
+    checkpoint_t pending;
+    wf::wl_timer<false> restore_timer;
+
+  public:
+    void init() override
+    {
+        load_checkpoint();
+        wf::get_core().connect(&on_shutdown);
+        if (pending.outputs.empty() && pending.views.empty())
+        {
+            return;
+        }
+
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            restore_output(output);
+        }
+
+        wf::get_core().output_layout->connect(&on_output_added);
+        wf::get_core().connect(&on_view_mapped);
+        restore_timer.set_timeout(restore_timeout, [=] ()
+        {
+            LOGD("Dropping ", pending.views.size(), " unclaimed views from the checkpoint");
+            stop_restoring();
+        });
+    }
+
+    void fini() override
+    {
+        stop_restoring();
+        on_shutdown.disconnect();
+    }
+
+  private:
+    std::filesystem::path get_checkpoint_path()
+    {
+        std::string file = checkpoint_file;
+        return file.empty() ? default_checkpoint_path() : std::filesystem::path(file);
+    }
+
+    void load_checkpoint()
+    {
+        auto path = get_checkpoint_path();
+        if (path.empty())
+        {
+            return;
+        }
+
+        std::ifstream in{path, std::ios::binary};
+        if (!in)
+        {
+            return;
+        }
+
+        std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        in.close();
+
+        // A checkpoint is restored only once, the next shutdown writes a new one.
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+
+        auto checkpoint = deserialize(data);
+        if (!checkpoint)
+        {
+            LOGW("Ignoring invalid or outdated checkpoint ", path.string());
+            return;
+        }
+
+        pending = std::move(*checkpoint);
+        LOGI("Restoring checkpoint with ", pending.outputs.size(), " outputs and ",
+            pending.views.size(), " views");
+    }
+
+    void save_checkpoint()
+    {
+        auto path = get_checkpoint_path();
+        if (path.empty())
+        {
+            return;
+        }
+
+        checkpoint_t checkpoint;
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            checkpoint.outputs.push_back({make_output_identifier(output), output->to_string(),
+                output->wset()->get_current_workspace()});
+        }
+
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            auto toplevel = wf::toplevel_cast(view);
+            if (!toplevel || !toplevel->is_mapped() || !toplevel->get_output() ||
+                (toplevel->role != wf::VIEW_ROLE_TOPLEVEL) || toplevel->parent)
+            {
+                continue;
+            }
+
+            auto output = toplevel->get_output();
+            auto wset   = toplevel->get_wset();
+            if (!wset)
+            {
+                continue;
+            }
+
+            auto ws   = wset->get_view_main_workspace(toplevel);
+            auto size = wset->get_last_output_geometry().value_or(output->get_relative_geometry());
+            auto geometry = toplevel->get_pending_geometry();
+            if (!toplevel->sticky)
+            {
+                auto cur_ws = wset->get_current_workspace();
+                geometry.x -= (ws.x - cur_ws.x) * size.width;
+                geometry.y -= (ws.y - cur_ws.y) * size.height;
+            }
+
+            checkpoint.views.push_back({toplevel->get_app_id(), toplevel->get_title(),
+                make_output_identifier(output), (uint32_t)wset->get_index(), ws, geometry,
+                toplevel->pending_tiled_edges(), toplevel->minimized, toplevel->sticky,
+                toplevel->pending_fullscreen()});
+        }
+
+        // Write to a temporary file first, so that a crash during shutdown does not leave a truncated
+        // checkpoint behind.
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        auto tmp_path = path;
+        tmp_path += ".tmp";
+        {
+            std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+            auto data = serialize(checkpoint);
+            out.write(data.data(), data.size());
+            if (!out)
+            {
+                LOGW("Failed to write the checkpoint to ", tmp_path.string());
+                return;
+            }
+        }
+
+        std::filesystem::rename(tmp_path, path, ec);
+        if (ec)
+        {
+            LOGW("Failed to write the checkpoint to ", path.string(), ": ", ec.message());
+        }
+    }
+
+    void stop_restoring()
+    {
+        restore_timer.disconnect();
+        on_output_added.disconnect();
+        on_view_mapped.disconnect();
+        pending = {};
+    }
+
+    void restore_output(wf::output_t *output)
+    {
+        auto identifier = make_output_identifier(output);
+        auto it = std::find_if(pending.outputs.begin(), pending.outputs.end(), [&] (const output_entry_t& e)
+        {
+            return e.identifier == identifier;
+        });
+
+        if (it == pending.outputs.end())
+        {
+            it = std::find_if(pending.outputs.begin(), pending.outputs.end(), [&] (const output_entry_t& e)
+            {
+                return e.name == output->to_string();
+            });
+        }
+
+        if (it == pending.outputs.end())
+        {
+            return;
+        }
+
+        if (output->wset()->is_workspace_valid(it->workspace))
+        {
+            output->wset()->set_workspace(it->workspace);
+        }
+
+        pending.outputs.erase(it);
+    }
+
+    wf::output_t *find_output(const std::string& identifier)
+    {
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            if (make_output_identifier(output) == identifier)
+            {
+                return output;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::shared_ptr<wf::workspace_set_t> find_wset(uint64_t index)
+    {
+        for (auto& wset : wf::workspace_set_t::get_all())
+        {
+            if (wset->get_index() == index)
+            {
+                return wset->shared_from_this();
+            }
+        }
+
+        return nullptr;
+    }
+
+    void move_view_to_wset(wayfire_toplevel_view view, std::shared_ptr<wf::workspace_set_t> target_wset)
+    {
+        auto old_wset = view->get_wset();
+        old_wset->remove_view(view);
+        wf::scene::remove_child(view->get_root_node());
+        wf::emit_view_pre_moved_to_wset_pre(view, old_wset, target_wset);
+
+        if (view->get_output() != target_wset->get_attached_output())
+        {
+            view->set_output(target_wset->get_attached_output());
+        }
+
+        wf::scene::readd_front(target_wset->get_node(), view->get_root_node());
+        target_wset->add_view(view);
+        wf::emit_view_moved_to_wset(view, old_wset, target_wset);
+    }
+
+    /** Find the entry for the view, preferring one with the same title. */
+    std::vector<view_entry_t>::iterator find_view_entry(wayfire_toplevel_view view)
+    {
+        auto app_id = view->get_app_id();
+        auto title  = view->get_title();
+        auto fallback = pending.views.end();
+        for (auto it = pending.views.begin(); it != pending.views.end(); ++it)
+        {
+            if (it->app_id != app_id)
+            {
+                continue;
+            }
+
+            if (it->title == title)
+            {
+                return it;
+            }
+
+            if (fallback == pending.views.end())
+            {
+                fallback = it;
+            }
+        }
+
+        return fallback;
+    }
+
+    void restore_view(wayfire_toplevel_view view)
+    {
+        auto it = find_view_entry(view);
+        if (it == pending.views.end())
+        {
+            return;
+        }
+
+        auto entry = std::move(*it);
+        pending.views.erase(it);
+
+        // Views go back to their workspace set if it exists (for example, if it is shown on an output again
+        // or was restored by another plugin), otherwise to the current workspace set of their output.
+        if (auto target_wset = find_wset(entry.wset_index))
+        {
+            if (view->get_wset() != target_wset)
+            {
+                move_view_to_wset(view, target_wset);
+            }
+        } else
+        {
+            auto output = find_output(entry.output_identifier);
+            if (!output)
+            {
+                return;
+            }
+
+            if (view->get_output() != output)
+            {
+                wf::move_view_to_output(view, output, true);
+            }
+        }
+
+        auto wset = view->get_wset();
+        if (!wset || !wset->is_workspace_valid(entry.workspace) || !wset->get_last_output_geometry())
+        {
+            return;
+        }
+
+        // The workspace set may be hidden, in which case the view has no output and is only placed.
+        auto output = view->get_output();
+
+        if (entry.sticky)
+        {
+            view->set_sticky(true);
+        }
+
+        auto geometry = entry.geometry;
+        if (!entry.sticky)
+        {
+            auto size   = *wset->get_last_output_geometry();
+            auto cur_ws = wset->get_current_workspace();
+            geometry.x += (entry.workspace.x - cur_ws.x) * size.width;
+            geometry.y += (entry.workspace.y - cur_ws.y) * size.height;
+        }
+
+        if (entry.fullscreen && output)
+        {
+            wf::get_core().default_wm->fullscreen_request(view, output, true, entry.workspace);
+        } else if (entry.tiled_edges && output)
+        {
+            wf::get_core().default_wm->tile_request(view, entry.tiled_edges, entry.workspace);
+        } else if ((geometry.width > 0) && (geometry.height > 0))
+        {
+            view->set_geometry(geometry);
+        }
+
+        if (entry.minimized)
+        {
+            wf::get_core().default_wm->minimize_request(view, true);
+        }
+
+        if (pending.views.empty() && pending.outputs.empty())
+        {
+            stop_restoring();
+        }
+    }
+
+    wf::signal::connection_t<wf::output_added_signal> on_output_added = [=] (wf::output_added_signal *ev)
+    {
+        restore_output(ev->output);
+    };
+
+    wf::signal::connection_t<wf::view_mapped_signal> on_view_mapped = [=] (wf::view_mapped_signal *ev)
+    {
+        if (auto toplevel = wf::toplevel_cast(ev->view))
+        {
+            if ((toplevel->role == wf::VIEW_ROLE_TOPLEVEL) && !toplevel->parent)
+            {
+                restore_view(toplevel);
+            }
+        }
+    };
+
+    wf::signal::connection_t<wf::core_shutdown_signal> on_shutdown = [=] (wf::core_shutdown_signal*)
+    {
+        save_checkpoint();
+    };
+};
+}
+}
+
+DECLARE_WAYFIRE_PLUGIN(wf::session_checkpoint::session_checkpoint_t);
@@ -27,6 +27,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <algorithm>
+#include <map>
 #include <set>
 
 constexpr const char *switcher_transformer = "switcher-3d";
@@ -337,6 +338,7 @@ class WayfireSwitcher : public wf::per_output_plugin_instance_t, public wf::keyb
 
         render_node = std::make_shared<switcher_render_node_t>(this);
         wf::scene::add_front(wf::get_core().scene(), render_node);
+        wf::get_core().scene()->connect(&on_root_update);
         return true;
     }
 
@@ -346,6 +348,8 @@ class WayfireSwitcher : public wf::per_output_plugin_instance_t, public wf::keyb
         output->deactivate_plugin(&grab_interface);
 
         output->render->rem_effect(&pre_hook);
+        on_root_update.disconnect();
+        view_instances.clear();
         wf::scene::remove_child(render_node);
         render_node = nullptr;
 
@@ -492,10 +496,24 @@ class WayfireSwitcher : public wf::per_output_plugin_instance_t, public wf::keyb
         }
     }
 
-    // returns a list of mapped views
+    // returns a list of mapped views, most recently focused first
     std::vector<wayfire_toplevel_view> get_workspace_views() const
     {
-        return output->wset()->get_views(wf::WSET_MAPPED_ONLY | wf::WSET_CURRENT_WORKSPACE);
+        // Core keeps the views in focus order, so they only need to be filtered.
+        std::vector<wayfire_toplevel_view> ws_views;
+        auto wset = output->wset();
+        auto ws   = wset->get_current_workspace();
+        for (auto& view : wf::get_core().get_views_by_focus())
+        {
+            auto toplevel = wf::toplevel_cast(view);
+            if (toplevel && (toplevel->get_wset() == wset) && toplevel->is_mapped() &&
+                wset->view_visible_on(toplevel, ws))
+            {
+                ws_views.push_back(toplevel);
+            }
+        }
+
+        return ws_views;
     }
 
     /* Change the current focus to the next or the previous view */
@@ -528,11 +546,6 @@ class WayfireSwitcher : public wf::per_output_plugin_instance_t, public wf::keyb
             views.push_back(create_switcher_view(v));
         }
 
-        std::sort(views.begin(), views.end(), [] (SwitcherView& a, SwitcherView& b)
-        {
-            return wf::get_focus_timestamp(a.view) > wf::get_focus_timestamp(b.view);
-        });
-
         if (ws_views.empty())
         {
             return;
@@ -666,13 +679,38 @@ class WayfireSwitcher : public wf::per_output_plugin_instance_t, public wf::keyb
         return sw;
     }
 
+    /**
+     * The render instances of the views shown by the switcher. They are kept
+     * while the switcher is shown, so that the transformers render the contents
+     * of their view to their auxiliary buffer only once and afterwards repaint
+     * only the parts which were damaged, instead of the whole view every frame.
+     */
+    std::map<wayfire_view, std::vector<wf::scene::render_instance_uptr>> view_instances;
+
+    wf::signal::connection_t<wf::scene::root_node_update_signal> on_root_update =
+        [=] (wf::scene::root_node_update_signal *ev)
+    {
+        if (!(ev->flags & wf::scene::update_flag::MASKED) &&
+            (ev->flags & (wf::scene::update_flag::CHILDREN_LIST | wf::scene::update_flag::ENABLED)))
+        {
+            // Transformers were added or removed, or views appeared or disappeared
+            view_instances.clear();
+        }
+    };
+
     void render_view_scene(wayfire_view view, const wf::render_target_t& buffer)
     {
-        std::vector<wf::scene::render_instance_uptr> instances;
-        view->get_transformed_node()->gen_render_instances(instances, [] (auto) {});
+        auto it = view_instances.find(view);
+        if (it == view_instances.end())
+        {
+            // Damage is tracked by the transformers, and the switcher repaints
+            // the whole output anyway
+            it = view_instances.emplace(view, std::vector<wf::scene::render_instance_uptr>{}).first;
+            view->get_transformed_node()->gen_render_instances(it->second, [] (auto) {});
+        }
 
         wf::scene::render_pass_params_t params;
-        params.instances = &instances;
+        params.instances = &it->second;
         params.damage    = view->get_transformed_node()->get_bounding_box();
         params.reference_output = this->output;
         params.target = buffer;
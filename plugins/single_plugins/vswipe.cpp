@@ -74,6 +74,12 @@ class vswipe : public wf::per_output_plugin_instance_t
         int vy = 0;
         int vw = 0;
         int vh = 0;
+
+        // Options used by every update, read once when the swipe begins.
+        double speed_factor = 1.0;
+        double speed_cap    = 0.5;
+        bool free_movement  = false;
+        bool smooth_transition = false;
     } state;
 
     std::unique_ptr<wf::workspace_wall_t> wall;
@@ -191,6 +197,28 @@ class vswipe : public wf::per_output_plugin_instance_t
         state.vh = grid.height;
         state.vx = ws.x;
         state.vy = ws.y;
+
+        state.speed_factor  = speed_factor;
+        state.speed_cap     = speed_cap;
+        state.free_movement = enable_free_movement;
+        state.smooth_transition = smooth_transition;
+
+        // The direction is known only after the first updates, so prepare the current workspace and all of
+        // its neighbours while the fingers start moving.
+        std::vector<wf::point_t> prerender;
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                if (((dx == 0) || enable_horizontal) && ((dy == 0) || enable_vertical) &&
+                    ((dx == 0) || (dy == 0) || state.free_movement))
+                {
+                    prerender.push_back({ws.x + dx, ws.y + dy});
+                }
+            }
+        }
+
+        wall->prerender_workspaces(prerender);
     };
 
     void start_swipe(swipe_direction_t direction)
@@ -233,21 +261,19 @@ class vswipe : public wf::per_output_plugin_instance_t
 
     swipe_direction_t calculate_direction(wf::pointf_t deltas)
     {
-        auto grid = output->wset()->get_workspace_grid_size();
-
         bool horizontal = deltas.x > initial_direction_threshold;
         bool vertical   = deltas.y > initial_direction_threshold;
 
         horizontal &= deltas.x > deltas.y;
         vertical   &= deltas.y > deltas.x;
 
-        if (is_diagonal(deltas) && enable_free_movement)
+        if (is_diagonal(deltas) && state.free_movement)
         {
             return DIAGONAL;
-        } else if (horizontal && (grid.width > 1) && enable_horizontal)
+        } else if (horizontal && (state.vw > 1) && enable_horizontal)
         {
             return HORIZONTAL;
-        } else if (vertical && (grid.height > 1) && enable_vertical)
+        } else if (vertical && (state.vh > 1) && enable_vertical)
         {
             return VERTICAL;
         }
@@ -263,12 +289,12 @@ class vswipe : public wf::per_output_plugin_instance_t
             return;
         }
 
-        state.delta_sum.x += ev->event->dx / speed_factor;
-        state.delta_sum.y += ev->event->dy / speed_factor;
+        state.delta_sum.x += ev->event->dx / state.speed_factor;
+        state.delta_sum.y += ev->event->dy / state.speed_factor;
         if (state.direction == UNKNOWN)
         {
-            state.initial_deltas.x += std::abs(ev->event->dx / speed_factor);
-            state.initial_deltas.y += std::abs(ev->event->dy / speed_factor);
+            state.initial_deltas.x += std::abs(ev->event->dx / state.speed_factor);
+            state.initial_deltas.y += std::abs(ev->event->dy / state.speed_factor);
             state.direction = calculate_direction(state.initial_deltas);
             if (state.direction == UNKNOWN)
             {
@@ -276,7 +302,7 @@ class vswipe : public wf::per_output_plugin_instance_t
             }
 
             start_swipe(state.direction);
-        } else if ((state.direction != DIAGONAL) && enable_free_movement)
+        } else if ((state.direction != DIAGONAL) && state.free_movement)
         {
             /* Consider promoting to diagonal movement */
             double other = (state.direction == HORIZONTAL ? state.delta_sum.y : state.delta_sum.x);
@@ -286,19 +312,15 @@ class vswipe : public wf::per_output_plugin_instance_t
             }
         }
 
-        const double cap = speed_cap;
-
         state.delta_prev = state.delta_last;
-        double current_delta_processed;
-
         const auto& process_delta =
             [&] (double delta, wf::timed_transition_t& total_delta, int ws, int ws_max)
         {
-            current_delta_processed = vswipe_process_delta(delta / speed_factor, total_delta,
-                ws, ws_max, cap, enable_free_movement);
+            double processed = vswipe_process_delta(delta / state.speed_factor, total_delta,
+                ws, ws_max, state.speed_cap, state.free_movement);
 
-            double new_delta_end   = total_delta.end + current_delta_processed;
-            double new_delta_start = smooth_transition ? total_delta : new_delta_end;
+            double new_delta_end   = total_delta.end + processed;
+            double new_delta_start = state.smooth_transition ? total_delta : new_delta_end;
             total_delta.set(new_delta_start, new_delta_end);
         };
 
@@ -320,6 +342,12 @@ class vswipe : public wf::per_output_plugin_instance_t
     {
         if (!state.swiping || !output->is_plugin_active(grab_interface.name))
         {
+            if (state.swiping)
+            {
+                // The swipe did not start an animation, so the prerendered workspaces are not needed.
+                wall->discard_prerendered();
+            }
+
             state.swiping = false;
 
             return;
@@ -337,7 +365,7 @@ class vswipe : public wf::per_output_plugin_instance_t
         {
             target_delta.x = vswipe_finish_target(smooth_delta.dx.end,
                 state.vx, state.vw, state.delta_prev.x + state.delta_last.x,
-                move_threshold, fast_threshold, enable_free_movement);
+                move_threshold, fast_threshold, state.free_movement);
             target_workspace.x -= target_delta.x;
         }
 
@@ -345,7 +373,7 @@ class vswipe : public wf::per_output_plugin_instance_t
         {
             target_delta.y = vswipe_finish_target(smooth_delta.dy.end,
                 state.vy, state.vh, state.delta_prev.y + state.delta_last.y,
-                move_threshold, fast_threshold, enable_free_movement);
+                move_threshold, fast_threshold, state.free_movement);
             target_workspace.y -= target_delta.y;
         }
 
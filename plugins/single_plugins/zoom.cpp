@@ -3,6 +3,7 @@
 #include <wayfire/opengl.hpp>
 #include <wayfire/render-manager.hpp>
 #include <wayfire/util/duration.hpp>
+#include <wayfire/signal-definitions.hpp>
 
 class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
 {
@@ -18,6 +19,8 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
     wf::option_wrapper_t<int> interpolation_method{"zoom/interpolation_method"};
     wf::animation::simple_animation_t progression{smoothing_duration};
     bool hook_set = false;
+    /* The source rectangle of the last blit, in framebuffer coordinates */
+    wlr_box last_source = {0, 0, 0, 0};
 
     wf::plugin_activation_data_t grab_interface = {
         .name = "zoom",
@@ -40,16 +43,71 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
         if (target != progression.end)
         {
             progression.animate(target);
+            output->render->schedule_redraw();
 
             if (!hook_set)
             {
                 hook_set = true;
                 output->render->add_post(&render_hook);
-                output->render->set_redraw_always();
+                wf::get_core().connect(&on_motion);
+                wf::get_core().connect(&on_absolute_motion);
             }
         }
     }
 
+    /**
+     * Calculate the part of the output framebuffer which is magnified, based on the cursor position and the
+     * current zoom level.
+     */
+    wlr_box get_source_box(int w, int h)
+    {
+        auto oc = output->get_cursor_position();
+        double x, y;
+        wlr_box b = output->get_relative_geometry();
+        wlr_box_closest_point(&b, oc.x, oc.y, &x, &y);
+
+        /* get rotation & scale */
+        wlr_box box = {int(x), int(y), 1, 1};
+        box = output->render->get_target_framebuffer().
+            framebuffer_box_from_geometry_box(box);
+
+        x = box.x;
+        y = h - box.y;
+
+        const float scale = (progression - 1) / progression;
+
+        // The target width and height are truncated here so that `x1+tw` and
+        // `x1` round to GLint in tandem for glBlitFramebuffer(). This keeps the
+        // aspect ratio constant while panning around.
+        const GLint tw = w / progression, th = h / progression;
+        return {int(x * scale), int(y * scale), tw, th};
+    }
+
+    /**
+     * The zoomed image only changes because of damage (which already schedules a frame), a new zoom level or
+     * cursor motion, so there is no need to redraw the output constantly. On motion, a frame is scheduled
+     * only if the magnified region moves.
+     */
+    void schedule_redraw_on_motion()
+    {
+        const auto& fb = output->render->get_target_framebuffer();
+        if (get_source_box(fb.viewport_width, fb.viewport_height) != last_source)
+        {
+            output->render->schedule_redraw();
+        }
+    }
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion = [=] (auto)
+    {
+        schedule_redraw_on_motion();
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_absolute_event>>
+    on_absolute_motion = [=] (auto)
+    {
+        schedule_redraw_on_motion();
+    };
+
     wf::axis_callback axis = [=] (wlr_pointer_axis_event *ev)
     {
         if (!output->can_activate_plugin(&grab_interface))
@@ -72,28 +130,8 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
     {
         auto w = destination.viewport_width;
         auto h = destination.viewport_height;
-        auto oc = output->get_cursor_position();
-        double x, y;
-        wlr_box b = output->get_relative_geometry();
-        wlr_box_closest_point(&b, oc.x, oc.y, &x, &y);
-
-        /* get rotation & scale */
-        wlr_box box = {int(x), int(y), 1, 1};
-        box = output->render->get_target_framebuffer().
-            framebuffer_box_from_geometry_box(box);
-
-        x = box.x;
-        y = h - box.y;
-
-        const float scale = (progression - 1) / progression;
-
-        // The target width and height are truncated here so that `x1+tw` and
-        // `x1` round to GLint in tandem for glBlitFramebuffer(). This keeps the
-        // aspect ratio constant while panning around.
-        const GLint tw = w / progression, th = h / progression;
-
-        const float x1 = x * scale;
-        const float y1 = y * scale;
+        last_source = get_source_box(w, h);
+        const auto& src = last_source;
 
         const GLenum interpolation =
             (interpolation_method ==
@@ -102,11 +140,14 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
         OpenGL::render_begin(source);
         GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, source.fb));
         GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination.fb));
-        GL_CALL(glBlitFramebuffer(x1, y1, x1 + tw, y1 + th, 0, 0, w, h,
+        GL_CALL(glBlitFramebuffer(src.x, src.y, src.x + src.width, src.y + src.height, 0, 0, w, h,
             GL_COLOR_BUFFER_BIT, interpolation));
         OpenGL::render_end();
 
-        if (!progression.running() && (progression - 1 <= 0.01))
+        if (progression.running())
+        {
+            output->render->schedule_redraw();
+        } else if (progression - 1 <= 0.01)
         {
             unset_hook();
         }
@@ -114,8 +155,9 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
 
     void unset_hook()
     {
-        output->render->set_redraw_always(false);
         output->render->rem_post(&render_hook);
+        on_motion.disconnect();
+        on_absolute_motion.disconnect();
         hook_set = false;
     }
 
@@ -123,7 +165,7 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
     {
         if (hook_set)
         {
-            output->render->rem_post(&render_hook);
+            unset_hook();
         }
 
         output->rem_binding(&axis);
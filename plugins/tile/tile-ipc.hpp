@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <map>
+#include <optional>
 #include <set>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/toplevel-view.hpp>
@@ -20,13 +23,88 @@ struct json_builder_data_t
     gap_size_t gaps;
 };
 
+/** The size of the child relative to its parent split, along the split axis. */
+inline double child_rel_size(const split_node_t *split, const tree_node_t *child)
+{
+    if (split->get_split_direction() == SPLIT_HORIZONTAL)
+    {
+        return 1.0 * child->geometry.height / split->geometry.height;
+    }
+
+    return 1.0 * child->geometry.width / split->geometry.width;
+}
+
+/**
+ * The version of the tiling layouts, shared by all workspaces. It is increased each time a layout query finds
+ * a node which changed since the previous query.
+ */
+inline uint64_t& layout_version()
+{
+    static uint64_t version = 0;
+    return version;
+}
+
+/**
+ * Compare the tree with what was reported the last time, and assign a new layout version to the nodes
+ * which changed. Doing this at query time instead of in every function which modifies the tree costs a
+ * traversal of the tree, but no JSON is built for it.
+ *
+ * @return The newest version in which any node in the subtree changed.
+ */
+inline uint64_t update_layout_versions(tree_node_t *root, const wf::point_t& offset, double rel_size)
+{
+    auto& state   = root->ipc_state;
+    auto geometry = root->geometry - offset;
+    bool changed  = (state.geometry != geometry) || (state.rel_size != rel_size) ||
+        (state.children.size() != root->children.size());
+    for (size_t i = 0; !changed && (i < root->children.size()); i++)
+    {
+        changed = (state.children[i] != root->children[i]->id);
+    }
+
+    if (changed)
+    {
+        state.geometry = geometry;
+        state.rel_size = rel_size;
+        state.children.clear();
+        for (auto& child : root->children)
+        {
+            state.children.push_back(child->id);
+        }
+
+        state.changed = ++layout_version();
+    }
+
+    state.subtree_changed = state.changed;
+    if (auto split = root->as_split_node())
+    {
+        for (auto& child : split->children)
+        {
+            state.subtree_changed = std::max(state.subtree_changed,
+                update_layout_versions(child.get(), offset, child_rel_size(split.get(), child.get())));
+        }
+    }
+
+    return state.subtree_changed;
+}
+
 /**
  * Get a json description of the given tiling tree.
+ *
+ * @param since If set, subtrees which did not change since this layout version are described only by their
+ *   node-id, see update_layout_versions().
  */
 inline nlohmann::json tree_to_json(const std::unique_ptr<tree_node_t>& root, const wf::point_t& offset,
-    double rel_size = 1.0)
+    double rel_size = 1.0, std::optional<uint64_t> since = {})
 {
     nlohmann::json js;
+    js["node-id"] = root->id;
+    if (since && (root->ipc_state.subtree_changed <= *since))
+    {
+        js["unchanged"] = true;
+        return js;
+    }
+
     js["percent"]  = rel_size;
     js["geometry"] = wf::ipc::geometry_to_json(root->geometry - offset);
     if (auto view = root->as_view_node())
@@ -39,23 +117,16 @@ inline nlohmann::json tree_to_json(const std::unique_ptr<tree_node_t>& root, con
     wf::dassert(split != nullptr, "Expected to be split node");
 
     nlohmann::json children = nlohmann::json::array();
-    if (split->get_split_direction() == SPLIT_HORIZONTAL)
+    for (auto& child : split->children)
     {
-        for (auto& child : split->children)
-        {
-            children.push_back(
-                tree_to_json(child, offset, 1.0 * child->geometry.height / split->geometry.height));
-        }
+        children.push_back(tree_to_json(child, offset, child_rel_size(split.get(), child.get()), since));
+    }
 
+    if (split->get_split_direction() == SPLIT_HORIZONTAL)
+    {
         js["horizontal-split"] = std::move(children);
     } else
     {
-        for (auto& child : split->children)
-        {
-            children.push_back(tree_to_json(
-                child, offset, 1.0 * child->geometry.width / split->geometry.width));
-        }
-
         js["vertical-split"] = std::move(children);
     }
 
@@ -164,15 +235,30 @@ inline std::optional<std::string> verify_json_tree(nlohmann::json& json, json_bu
     return {};
 }
 
+/**
+ * The view nodes which were detached from the old layout, so that they can be reused in the new one. This
+ * keeps the view's tiling state (transformers, animations) instead of tearing it down and setting it up again.
+ */
+using reusable_view_nodes_t = std::map<wayfire_toplevel_view, std::unique_ptr<tile::tree_node_t>>;
+
 inline std::unique_ptr<tile::tree_node_t> build_tree_from_json_rec(const nlohmann::json& json,
-    tile_workspace_set_data_t *wdata, wf::point_t vp)
+    tile_workspace_set_data_t *wdata, wf::point_t vp, reusable_view_nodes_t& reusable)
 {
     std::unique_ptr<tile::tree_node_t> root;
 
     if (json.count("view-id"))
     {
         auto view = toplevel_cast(wf::ipc::find_view_by_id(json["view-id"]));
-        root = wdata->setup_view_tiling(view, vp);
+        auto it   = reusable.find(view);
+        if (it != reusable.end())
+        {
+            root = std::move(it->second);
+            reusable.erase(it);
+            wdata->reuse_view_tiling(view, vp);
+        } else
+        {
+            root = wdata->setup_view_tiling(view, vp);
+        }
     } else
     {
         const bool is_horiz_split = json.count("horizontal-split");
@@ -182,7 +268,7 @@ inline std::unique_ptr<tile::tree_node_t> build_tree_from_json_rec(const nlohman
 
         for (auto& child : children_list)
         {
-            split_parent->children.push_back(build_tree_from_json_rec(child, wdata, vp));
+            split_parent->children.push_back(build_tree_from_json_rec(child, wdata, vp, reusable));
             split_parent->children.back()->parent = {split_parent.get()};
         }
 
@@ -202,9 +288,9 @@ inline std::unique_ptr<tile::tree_node_t> build_tree_from_json_rec(const nlohman
  * Note that the tree description first has to be verified and pre-processed by verify_json_tree().
  */
 inline std::unique_ptr<tile::tree_node_t> build_tree_from_json(const nlohmann::json& json,
-    tile_workspace_set_data_t *wdata, wf::point_t vp)
+    tile_workspace_set_data_t *wdata, wf::point_t vp, reusable_view_nodes_t& reusable)
 {
-    auto root = build_tree_from_json_rec(json, wdata, vp);
+    auto root = build_tree_from_json_rec(json, wdata, vp, reusable);
     if (root->as_view_node())
     {
         // Handle cases with a single view.
@@ -223,6 +309,8 @@ inline nlohmann::json handle_ipc_get_layout(const nlohmann::json& params)
     WFJSON_EXPECT_FIELD(params["workspace"], "x", number_unsigned);
     WFJSON_EXPECT_FIELD(params["workspace"], "y", number_unsigned);
 
+    WFJSON_OPTIONAL_FIELD(params, "since", number_unsigned);
+
     int x   = params["workspace"]["x"].get<int>();
     int y   = params["workspace"]["y"].get<int>();
     auto ws = ipc::find_workspace_set_by_index(params["wset-index"].get<int>());
@@ -240,8 +328,17 @@ inline nlohmann::json handle_ipc_get_layout(const nlohmann::json& params)
         auto resolution = ws->get_last_output_geometry().value_or(tile::default_output_resolution);
         wf::point_t offset = {cur_ws.x * resolution.width, cur_ws.y * resolution.height};
 
-        response["layout"] =
-            tree_to_json(tile_workspace_set_data_t::get(ws->shared_from_this()).roots[x][y], offset);
+        auto& root = tile_workspace_set_data_t::get(ws->shared_from_this()).roots[x][y];
+        update_layout_versions(root.get(), offset, 1.0);
+
+        std::optional<uint64_t> since;
+        if (params.contains("since"))
+        {
+            since = params["since"].get<uint64_t>();
+        }
+
+        response["layout"]  = tree_to_json(root, offset, 1.0, since);
+        response["version"] = layout_version();
         return response;
     }
 
@@ -280,6 +377,9 @@ inline nlohmann::json handle_ipc_set_layout(nlohmann::json params)
         return wf::ipc::json_error(*err);
     }
 
+    // All steps below end up in a single transaction.
+    autocommit_transaction_t batch;
+
     // Step 1: detach any views which are currently present in the layout, but should no longer be
     // in the layout
     std::vector<nonstd::observer_ptr<tile::view_node_t>> views_to_remove;
@@ -291,19 +391,23 @@ inline nlohmann::json handle_ipc_set_layout(nlohmann::json params)
         }
     });
 
-    tile_ws.detach_views(views_to_remove);
+    if (!views_to_remove.empty())
+    {
+        tile_ws.detach_views(views_to_remove);
+    }
 
     {
         autocommit_transaction_t tx;
         data.touched_wsets.erase(nullptr);
 
-        // Step 2: temporarily detach some of the nodes
+        // Step 2: temporarily detach the nodes of the views in the new layout, they are reused below
+        reusable_view_nodes_t reusable;
         for (auto& touched_view : data.touched_views)
         {
             auto tile = wf::tile::view_node_t::get_node(touched_view);
             if (tile)
             {
-                tile->parent->remove_child(tile, tx.tx);
+                reusable[touched_view] = tile->parent->remove_child(tile, tx.tx);
             }
 
             if (touched_view->get_wset().get() != ws)
@@ -323,7 +427,7 @@ inline nlohmann::json handle_ipc_set_layout(nlohmann::json params)
         }
 
         // Step 3: set up the new layout
-        tile_ws.roots[x][y] = build_tree_from_json(params["layout"], &tile_ws, {x, y});
+        tile_ws.roots[x][y] = build_tree_from_json(params["layout"], &tile_ws, {x, y}, reusable);
         tile::flatten_tree(tile_ws.roots[x][y]);
         tile_ws.roots[x][y]->set_gaps(tile_ws.get_gaps());
         tile_ws.roots[x][y]->set_geometry(workarea, tx.tx);
@@ -8,6 +8,14 @@
 #include <wayfire/workarea.hpp>
 #include <wayfire/window-manager.hpp>
 
+/**
+ * A transaction which is scheduled when it goes out of scope.
+ *
+ * The objects are collected in a transaction manager batch, so nested (or
+ * otherwise overlapping) autocommit transactions, and the objects other code
+ * schedules in the meantime (e.g. fullscreen requests), end up in a single
+ * transaction.
+ */
 struct autocommit_transaction_t
 {
   public:
@@ -15,14 +23,17 @@ struct autocommit_transaction_t
     autocommit_transaction_t()
     {
         tx = wf::txn::transaction_t::create();
+        wf::get_core().tx_manager->begin_batch();
     }
 
     ~autocommit_transaction_t()
     {
-        if (!tx->get_objects().empty())
+        for (auto& object : tx->get_objects())
         {
-            wf::get_core().tx_manager->schedule_transaction(std::move(tx));
+            wf::get_core().tx_manager->schedule_object(object);
         }
+
+        wf::get_core().tx_manager->end_batch();
     }
 };
 
@@ -127,6 +138,7 @@ class tile_workspace_set_data_t : public wf::custom_data_t
         wf::geometry_t output_geometry =
             wset.lock()->get_last_output_geometry().value_or(tile::default_output_resolution);
 
+        autocommit_transaction_t tx;
         auto wsize = wset.lock()->get_workspace_grid_size();
         for (int i = 0; i < wsize.width; i++)
         {
@@ -136,8 +148,6 @@ class tile_workspace_set_data_t : public wf::custom_data_t
                 auto vp_geometry = workarea;
                 vp_geometry.x += i * output_geometry.width;
                 vp_geometry.y += j * output_geometry.height;
-
-                autocommit_transaction_t tx;
                 roots[i][j]->set_geometry(vp_geometry, tx.tx);
             }
         }
@@ -244,6 +254,17 @@ class tile_workspace_set_data_t : public wf::custom_data_t
         return std::make_unique<wf::tile::view_node_t>(view);
     }
 
+    /** Move a view which keeps its tiling node to the tiled layer of the given workspace. */
+    void reuse_view_tiling(wayfire_toplevel_view view, wf::point_t vp)
+    {
+        auto node = view->get_root_node();
+        if (node->parent() != tiled_sublayer[vp.x][vp.y].get())
+        {
+            wf::scene::readd_front(tiled_sublayer[vp.x][vp.y], node);
+            view_bring_to_front(view);
+        }
+    }
+
     void attach_view(wayfire_toplevel_view view, std::optional<wf::point_t> _vp = {})
     {
         auto vp = _vp.value_or(wset.lock()->get_current_workspace());
@@ -260,6 +281,8 @@ class tile_workspace_set_data_t : public wf::custom_data_t
     void detach_views(std::vector<nonstd::observer_ptr<tile::view_node_t>> views,
         bool reinsert = true)
     {
+        // Removing the views and resizing the remaining ones is a single transaction
+        autocommit_transaction_t batch;
         {
             autocommit_transaction_t tx;
             for (auto& v : views)
@@ -91,6 +91,12 @@ int32_t split_node_t::calculate_splittable() const
     return calculate_splittable(this->geometry);
 }
 
+static bool gaps_equal(const gap_size_t& a, const gap_size_t& b)
+{
+    return (a.left == b.left) && (a.right == b.right) && (a.top == b.top) &&
+           (a.bottom == b.bottom) && (a.internal == b.internal);
+}
+
 void split_node_t::recalculate_children(wf::geometry_t available, wf::txn::transaction_uptr& tx)
 {
     if (this->children.empty())
@@ -114,7 +120,17 @@ void split_node_t::recalculate_children(wf::geometry_t available, wf::txn::trans
         return (current / old_child_sum) * total_splittable;
     };
 
-    set_gaps(this->gaps);
+    /* Fix up the gaps of the children whose position changed. Children with
+     * the correct gaps are not descended into, their own set_geometry() below
+     * takes care of the next level. */
+    for (auto& child : this->children)
+    {
+        auto child_gaps = get_child_gaps(child.get());
+        if (!gaps_equal(child_gaps, child->get_gaps()))
+        {
+            child->set_gaps(child_gaps);
+        }
+    }
 
     /* For each child, assign its percentage of the whole. */
     for (auto& child : this->children)
@@ -207,39 +223,44 @@ void split_node_t::set_gaps(const gap_size_t& gaps)
     this->gaps = gaps;
     for (const auto& child : this->children)
     {
-        gap_size_t child_gaps = gaps;
+        child->set_gaps(get_child_gaps(child.get()));
+    }
+}
 
-        /* See which edges are modified by this split */
-        int32_t *first_edge, *second_edge;
-        switch (this->split_direction)
-        {
-          case SPLIT_HORIZONTAL:
-            first_edge  = &child_gaps.top;
-            second_edge = &child_gaps.bottom;
-            break;
-
-          case SPLIT_VERTICAL:
-            first_edge  = &child_gaps.left;
-            second_edge = &child_gaps.right;
-            break;
-
-          default:
-            assert(false);
-        }
+gap_size_t split_node_t::get_child_gaps(const tree_node_t *child) const
+{
+    gap_size_t child_gaps = gaps;
 
-        /* Override internal edges */
-        if (child != this->children.front())
-        {
-            *first_edge = gaps.internal;
-        }
+    /* See which edges are modified by this split */
+    int32_t *first_edge, *second_edge;
+    switch (this->split_direction)
+    {
+      case SPLIT_HORIZONTAL:
+        first_edge  = &child_gaps.top;
+        second_edge = &child_gaps.bottom;
+        break;
 
-        if (child != this->children.back())
-        {
-            *second_edge = gaps.internal;
-        }
+      case SPLIT_VERTICAL:
+        first_edge  = &child_gaps.left;
+        second_edge = &child_gaps.right;
+        break;
+
+      default:
+        assert(false);
+    }
+
+    /* Override internal edges */
+    if (child != this->children.front().get())
+    {
+        *first_edge = gaps.internal;
+    }
 
-        child->set_gaps(child_gaps);
+    if (child != this->children.back().get())
+    {
+        *second_edge = gaps.internal;
     }
+
+    return child_gaps;
 }
 
 split_direction_t split_node_t::get_split_direction() const
@@ -458,10 +479,21 @@ void view_node_t::set_geometry(wf::geometry_t geometry, wf::txn::transaction_upt
     }
 
     wf::get_core().default_wm->update_last_windowed_geometry(view);
+    auto target = calculate_target_geometry();
+
+    /* Do not make the transaction wait for views which stay where they are */
+    const auto& pending = view->toplevel()->pending();
+    const auto& current = view->toplevel()->current();
+    if ((pending.tiled_edges == TILED_EDGES_ALL) && (current.tiled_edges == TILED_EDGES_ALL) &&
+        (pending.geometry == target) && (current.geometry == target) &&
+        (pending.fullscreen == current.fullscreen) && !view->has_data<wf::grid::grid_animation_t>())
+    {
+        return;
+    }
+
     view->toplevel()->pending().tiled_edges = TILED_EDGES_ALL;
     tx->add_object(view->toplevel());
 
-    auto target = calculate_target_geometry();
     if (this->needs_crossfade() && (target != view->get_geometry()))
     {
         view->get_transformed_node()->rem_transformer(scale_transformer_name);
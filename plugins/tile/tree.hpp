@@ -48,6 +48,23 @@ struct tree_node_t
     /** The geometry occupied by the node */
     wf::geometry_t geometry;
 
+    /** A unique id of the node, used by IPC clients to refer to subtrees. */
+    const uint64_t id = next_id++;
+
+    /**
+     * What IPC clients were last told about the node, used to report only the subtrees which changed since
+     * a given layout version (see tile-ipc.hpp).
+     */
+    struct ipc_state_t
+    {
+        wf::geometry_t geometry = {0, 0, 0, 0};
+        double rel_size = 0.0;
+        std::vector<uint64_t> children;
+        // The version in which the node itself, and any node in its subtree, last changed.
+        uint64_t changed = 0;
+        uint64_t subtree_changed = 0;
+    } ipc_state;
+
     /** Set the geometry available for the node and its subnodes. */
     virtual void set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr& tx);
 
@@ -70,6 +87,9 @@ struct tree_node_t
   protected:
     /* Gaps */
     gap_size_t gaps;
+
+  private:
+    static inline uint64_t next_id = 1;
 };
 
 /**
@@ -123,6 +143,9 @@ struct split_node_t : public tree_node_t
   private:
     split_direction_t split_direction;
 
+    /** Calculate the gaps of the given child from its position in the split */
+    gap_size_t get_child_gaps(const tree_node_t *child) const;
+
     /**
      * Resize the children so that they fit inside the given
      * available_geometry.
@@ -112,6 +112,8 @@ class workspace_switch_t
         wall->set_viewport(wall->get_workspace_rectangle(
             output->wset()->get_current_workspace()));
         wall->set_background_color(background_color);
+        // Render the current workspace now, instead of in the first frame of the animation.
+        wall->prerender_workspaces_now({output->wset()->get_current_workspace()});
         wall->start_output_renderer();
 
         if (overlay_view_node)
@@ -11,6 +11,7 @@
 #include "../wm-actions/wm-actions-signals.hpp"
 #include <wayfire/plugins/common/util.hpp>
 #include <wayfire/window-manager.hpp>
+#include <wayfire/render-manager.hpp>
 
 #include <algorithm>
 #include <cfloat>
@@ -90,6 +91,16 @@ bool view_action_interface_t::execute(const std::string & name,
                 _set_geometry_ppt(std::get<1>(geometry), std::get<2>(geometry),
                     std::get<3>(geometry), std::get<4>(geometry));
             }
+        } else if (id == "tearing")
+        {
+            auto policy = wf::is_string(args.at(1)) ? wf::get_string(args.at(1)) : "";
+            if ((policy != "allow") && (policy != "deny"))
+            {
+                LOGE("View action interface: Tearing policy should be allow or deny, got ", policy);
+                return true;
+            }
+
+            _set_tearing(policy == "allow");
         } else
         {
             LOGE("View action interface: Unsupported set operation to identifier ",
@@ -403,6 +414,11 @@ void view_action_interface_t::_set_alpha(float alpha)
     }
 }
 
+void view_action_interface_t::_set_tearing(bool allow)
+{
+    _view->get_data_safe<wf::view_tearing_policy_t>()->allow = allow;
+}
+
 void view_action_interface_t::_set_geometry(int x, int y, int w, int h)
 {
     _resize(w, h);
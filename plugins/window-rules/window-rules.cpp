@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cctype>
+#include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <wayfire/per-output-plugin.hpp>
@@ -58,11 +62,30 @@ class wayfire_window_rules_t : public wf::per_output_plugin_instance_t
     // Auto-reload on changes to config file
     wf::signal::connection_t<wf::reload_config_signal> _reload_config = [=] (wf::reload_config_signal *ev)
     {
-        setup_rules_from_config();
+        if (ev->section_changed("window-rules"))
+        {
+            setup_rules_from_config();
+        }
     };
 
     std::vector<std::shared_ptr<wf::rule_t>> _rules;
 
+    /**
+     * The rules which may apply to a view on a given signal, as indices into _rules. A rule which can only
+     * match a single app-id is only listed under this app-id, all other rules of the signal are generic.
+     */
+    struct rule_bucket_t
+    {
+        std::vector<size_t> generic;
+        std::unordered_map<std::string, std::vector<size_t>> by_app_id;
+    };
+
+    std::map<std::string, rule_bucket_t> _rules_by_signal;
+    /* Rules whose signal could not be determined, tried for all signals */
+    std::vector<size_t> _unindexed_rules;
+
+    void index_rule(const std::string& rule_str, size_t index);
+
     wf::view_access_interface_t _access_interface;
     wf::view_action_interface_t _action_interface;
 
@@ -111,8 +134,25 @@ void wayfire_window_rules_t::apply(const std::string & signal, wayfire_view view
         return;
     }
 
-    for (const auto & rule : _rules)
+    // A local list, because rule actions may re-enter apply(), for ex. minimize emits view_minimized_signal.
+    std::vector<size_t> candidates = _unindexed_rules;
+    auto bucket = _rules_by_signal.find(signal);
+    if (bucket != _rules_by_signal.end())
+    {
+        auto& generic = bucket->second.generic;
+        candidates.insert(candidates.end(), generic.begin(), generic.end());
+        auto specific = bucket->second.by_app_id.find(view->get_app_id());
+        if (specific != bucket->second.by_app_id.end())
+        {
+            candidates.insert(candidates.end(), specific->second.begin(), specific->second.end());
+        }
+    }
+
+    // Rules are applied in the order of the config file.
+    std::sort(candidates.begin(), candidates.end());
+    for (size_t index : candidates)
     {
+        const auto& rule = _rules[index];
         _access_interface.set_view(view);
         _action_interface.set_view(view);
         auto error = rule->apply(signal, _access_interface, _action_interface);
@@ -177,9 +217,95 @@ void wayfire_window_rules_t::apply(const std::string & signal, wayfire_view view
     }
 }
 
+/**
+ * Split a rule into words, quoted strings and the single character operators of the rule syntax. Quoted
+ * strings are returned with their quotes, so that they cannot be mistaken for keywords.
+ */
+static std::vector<std::string> tokenize_rule(const std::string& text)
+{
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (std::isspace((unsigned char)c))
+        {
+            ++i;
+        } else if (c == '"')
+        {
+            size_t j = i + 1;
+            std::string token = "\"";
+            while ((j < text.size()) && (text[j] != '"'))
+            {
+                if ((text[j] == '\\') && (j + 1 < text.size()))
+                {
+                    ++j;
+                }
+
+                token += text[j++];
+            }
+
+            tokens.push_back(token + "\"");
+            i = j + 1;
+        } else if (std::string("()&|!").find(c) != std::string::npos)
+        {
+            tokens.push_back(std::string(1, c));
+            ++i;
+        } else
+        {
+            size_t j = i;
+            while ((j < text.size()) && !std::isspace((unsigned char)text[j]) &&
+                   (std::string("()&|!\"").find(text[j]) == std::string::npos))
+            {
+                ++j;
+            }
+
+            tokens.push_back(text.substr(i, j - i));
+            i = j;
+        }
+    }
+
+    return tokens;
+}
+
+void wayfire_window_rules_t::index_rule(const std::string& rule_str, size_t index)
+{
+    // Rules have the form `on <signal> if <condition> then <action> [else <action>]`.
+    auto tokens = tokenize_rule(rule_str);
+    if ((tokens.size() < 2) || (tokens[0] != "on") || (tokens[1].front() == '"'))
+    {
+        _unindexed_rules.push_back(index);
+        return;
+    }
+
+    auto& bucket = _rules_by_signal[tokens[1]];
+
+    // A rule can only match the app-id of an `app_id is "..."` predicate if the condition is a plain
+    // conjunction, and if it has no else branch, which would run for all other views.
+    auto then   = std::find(tokens.begin(), tokens.end(), "then");
+    bool simple = (tokens.size() > 2) && (tokens[2] == "if") && (then != tokens.end()) &&
+        std::none_of(tokens.begin(), tokens.end(), [] (const std::string& token)
+    {
+        return (token == "|") || (token == "!") || (token == "else");
+    });
+
+    for (auto it = tokens.begin() + 2; simple && (it + 2 < then); ++it)
+    {
+        if ((it[0] == "app_id") && (it[1] == "is") && (it[2].front() == '"'))
+        {
+            bucket.by_app_id[it[2].substr(1, it[2].size() - 2)].push_back(index);
+            return;
+        }
+    }
+
+    bucket.generic.push_back(index);
+}
+
 void wayfire_window_rules_t::setup_rules_from_config()
 {
     _rules.clear();
+    _rules_by_signal.clear();
+    _unindexed_rules.clear();
 
     wf::option_wrapper_t<wf::config::compound_list_t<std::string>> rule_list_option{"window-rules/rules"};
     auto rule_list = rule_list_option.value();
@@ -191,6 +317,7 @@ void wayfire_window_rules_t::setup_rules_from_config()
         auto rule = wf::rule_parser_t().parse(_lexer);
         if (rule != nullptr)
         {
+            index_rule(rule_str, _rules.size());
             _rules.push_back(rule);
         }
     }
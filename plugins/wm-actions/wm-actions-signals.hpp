@@ -28,4 +28,15 @@ struct wm_actions_above_changed_signal
 {
     wayfire_view view;
 };
+
+/**
+ * on: output
+ * when: Emitted once after the above state of several views was changed at once (for example, by an IPC call
+ *   with a list of views), after the wm_actions_above_changed_signal of each view. Plugins which can handle
+ *   the whole batch at once may use it to avoid doing work for each view.
+ */
+struct wm_actions_above_changed_bulk_signal
+{
+    std::vector<wayfire_view> views;
+};
 }
@@ -17,7 +17,10 @@
 #include "wayfire/window-manager.hpp"
 #include "wayfire/seat.hpp"
 #include "wayfire/nonstd/reverse.hpp"
+#include "wayfire/matcher.hpp"
+#include "wayfire/txn/transaction-manager.hpp"
 #include "wm-actions-signals.hpp"
+#include <map>
 
 class always_on_top_root_node_t : public wf::scene::output_node_t
 {
@@ -82,6 +85,80 @@ class wayfire_wm_actions_output_t : public wf::per_output_plugin_instance_t
         return true;
     }
 
+    /**
+     * Change the above state of several views on the output at once. Each affected container node gets a
+     * single update of its children. A wm_actions_above_changed_signal is emitted for each view, followed by
+     * a single wm_actions_above_changed_bulk_signal.
+     */
+    bool set_keep_above_state(const std::vector<wayfire_view>& views, bool above)
+    {
+        if (views.empty() || !output->can_activate_plugin(&grab_interface))
+        {
+            return false;
+        }
+
+        auto target = above ? always_above : output->wset()->get_node();
+        std::vector<wf::scene::node_ptr> moved;
+        std::vector<wf::scene::floating_inner_node_t*> sources;
+        for (auto& view : views)
+        {
+            auto root = view->get_root_node();
+            moved.push_back(root);
+            auto parent = dynamic_cast<wf::scene::floating_inner_node_t*>(root->parent());
+            if (parent && (parent != target.get()) &&
+                (std::find(sources.begin(), sources.end(), parent) == sources.end()))
+            {
+                sources.push_back(parent);
+            }
+
+            if (above)
+            {
+                view->store_data(std::make_unique<wf::custom_data_t>(), "wm-actions-above");
+            } else if (view->has_data("wm-actions-above"))
+            {
+                view->erase_data("wm-actions-above");
+            }
+        }
+
+        auto is_moved = [&] (const wf::scene::node_ptr& node)
+        {
+            return std::find(moved.begin(), moved.end(), node) != moved.end();
+        };
+
+        // Detach the views from their old containers first, a node can be added only once it has no parent.
+        for (auto& parent : sources)
+        {
+            auto children = parent->get_children();
+            children.erase(std::remove_if(children.begin(), children.end(), is_moved), children.end());
+            parent->set_children_list(children);
+        }
+
+        auto children = target->get_children();
+        children.erase(std::remove_if(children.begin(), children.end(), is_moved), children.end());
+        children.insert(children.begin(), moved.begin(), moved.end());
+        target->set_children_list(children);
+
+        for (auto& parent : sources)
+        {
+            wf::scene::update(parent->shared_from_this(), wf::scene::update_flag::CHILDREN_LIST);
+        }
+
+        wf::scene::update(target, wf::scene::update_flag::CHILDREN_LIST);
+
+        // Plugins which only know the per-view signal still have to learn about each change.
+        for (auto& view : views)
+        {
+            wf::wm_actions_above_changed_signal view_data;
+            view_data.view = view;
+            output->emit(&view_data);
+        }
+
+        wf::wm_actions_above_changed_bulk_signal data;
+        data.views = views;
+        output->emit(&data);
+        return true;
+    }
+
     /**
      * Find the selected toplevel view, or nullptr if the selected view is not
      * toplevel.
@@ -296,19 +373,41 @@ class wayfire_wm_actions_output_t : public wf::per_output_plugin_instance_t
     void do_send_to_back(wayfire_view view)
     {
         auto view_root = view->get_root_node();
+        if (dynamic_cast<wf::scene::floating_inner_node_t*>(view_root->parent()))
+        {
+            wf::scene::lower_to_back(view_root);
+        }
+    }
+
+    /**
+     * Send several views to the back of their containers, keeping their relative order. Each container is
+     * reordered with a single update.
+     */
+    void do_send_to_back(const std::vector<wayfire_view>& views)
+    {
+        std::map<wf::scene::floating_inner_node_t*, std::vector<wf::scene::node_ptr>> moved;
+        for (auto& view : views)
+        {
+            auto view_root = view->get_root_node();
+            if (auto parent = dynamic_cast<wf::scene::floating_inner_node_t*>(view_root->parent()))
+            {
+                moved[parent].push_back(view_root);
+            }
+        }
 
-        if (auto parent =
-                dynamic_cast<wf::scene::floating_inner_node_t*>(view_root->parent()))
-        {
-            auto parent_children = parent->get_children();
-            parent_children.erase(
-                std::remove(parent_children.begin(), parent_children.end(),
-                    view_root),
-                parent_children.end());
-            parent_children.push_back(view_root);
-            parent->set_children_list(parent_children);
-            wf::scene::update(parent->shared_from_this(),
-                wf::scene::update_flag::CHILDREN_LIST);
+        for (auto& [parent, nodes] : moved)
+        {
+            auto children = parent->get_children();
+            children.erase(std::remove_if(children.begin(), children.end(), [&] (const auto& node)
+            {
+                return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+            }), children.end());
+            children.insert(children.end(), nodes.begin(), nodes.end());
+            if (children != parent->get_children())
+            {
+                parent->set_children_list(children);
+                wf::scene::update(parent->shared_from_this(), wf::scene::update_flag::REORDERED);
+            }
         }
     }
 
@@ -421,21 +520,93 @@ class wayfire_wm_actions_t : public wf::plugin_interface_t,
         ipc_repo->unregister_method("wm-actions/send-to-back");
     }
 
+    /**
+     * Run an IPC action on the views given in the parameters: a single view (view_id), a list of views
+     * (view_ids) or all toplevel views matching a condition in the syntax of window rules (view_matcher).
+     * The changes to all views are applied in a single transaction.
+     */
+    nlohmann::json execute_for_views(const nlohmann::json& params,
+        std::function<void(const std::vector<wayfire_toplevel_view>&, bool)> views_op)
+    {
+        WFJSON_EXPECT_FIELD(params, "state", boolean);
+        WFJSON_OPTIONAL_FIELD(params, "view_ids", array);
+        WFJSON_OPTIONAL_FIELD(params, "view_matcher", string);
+
+        std::vector<wayfire_toplevel_view> views;
+        if (params.contains("view_ids"))
+        {
+            for (auto& id : params["view_ids"])
+            {
+                if (!id.is_number_integer())
+                {
+                    return wf::ipc::json_error("view_ids contains non-integer entries!");
+                }
+
+                wayfire_toplevel_view view = toplevel_cast(wf::ipc::find_view_by_id(id));
+                if (!view)
+                {
+                    return wf::ipc::json_error("toplevel view id not found!");
+                }
+
+                views.push_back(view);
+            }
+        } else if (params.contains("view_matcher"))
+        {
+            auto condition = std::make_shared<wf::config::option_t<std::string>>("wm-actions-ipc",
+                (std::string)params["view_matcher"]);
+            wf::view_matcher_t matcher{condition};
+            for (auto& view : wf::get_core().get_all_views())
+            {
+                auto toplevel = toplevel_cast(view);
+                if (toplevel && toplevel->is_mapped() && matcher.matches(view))
+                {
+                    views.push_back(toplevel);
+                }
+            }
+        } else
+        {
+            WFJSON_EXPECT_FIELD(params, "view_id", number_integer);
+            wayfire_toplevel_view view = toplevel_cast(wf::ipc::find_view_by_id(params["view_id"]));
+            if (!view)
+            {
+                return wf::ipc::json_error("toplevel view id not found!");
+            }
+
+            views.push_back(view);
+        }
+
+        wf::get_core().tx_manager->begin_batch();
+        views_op(views, params["state"]);
+        wf::get_core().tx_manager->end_batch();
+
+        auto response = wf::ipc::json_ok();
+        response["count"] = views.size();
+        return response;
+    }
+
     nlohmann::json execute_for_view(const nlohmann::json& params,
         std::function<void(wayfire_toplevel_view, bool)> view_op)
     {
-        WFJSON_EXPECT_FIELD(params, "view_id", number_integer);
-        WFJSON_EXPECT_FIELD(params, "state", boolean);
+        return execute_for_views(params, [&] (const std::vector<wayfire_toplevel_view>& views, bool state)
+        {
+            for (auto& view : views)
+            {
+                view_op(view, state);
+            }
+        });
+    }
 
-        wayfire_toplevel_view view = toplevel_cast(wf::ipc::find_view_by_id(params["view_id"]));
-        if (!view)
+    /** Group the views by their output, for the actions which are implemented per output. */
+    static std::map<wf::output_t*, std::vector<wayfire_view>> group_by_output(
+        const std::vector<wayfire_toplevel_view>& views)
+    {
+        std::map<wf::output_t*, std::vector<wayfire_view>> result;
+        for (auto& view : views)
         {
-            return wf::ipc::json_error("toplevel view id not found!");
+            result[view->get_output()].push_back(view);
         }
 
-        bool state = params["state"];
-        view_op(view, state);
-        return wf::ipc::json_ok();
+        return result;
     }
 
     wf::ipc::method_callback ipc_minimize = [=] (const nlohmann::json& js)
@@ -456,15 +627,24 @@ class wayfire_wm_actions_t : public wf::plugin_interface_t,
 
     wf::ipc::method_callback ipc_set_always_on_top = [=] (const nlohmann::json& js)
     {
-        return execute_for_view(js, [=] (wayfire_toplevel_view view, bool state)
+        return execute_for_views(js, [=] (const std::vector<wayfire_toplevel_view>& views, bool state)
         {
-            if (!view->get_output())
+            for (auto& [output, output_views] : group_by_output(views))
             {
-                view->store_data(std::make_unique<wf::custom_data_t>(), "wm-actions-above");
-                return;
+                if (!output)
+                {
+                    for (auto& view : output_views)
+                    {
+                        view->store_data(std::make_unique<wf::custom_data_t>(), "wm-actions-above");
+                    }
+                } else if (output_views.size() == 1)
+                {
+                    output_instance[output]->set_keep_above_state(output_views.front(), state);
+                } else
+                {
+                    output_instance[output]->set_keep_above_state(output_views, state);
+                }
             }
-
-            output_instance[view->get_output()]->set_keep_above_state(view, state);
         });
     };
 
@@ -486,14 +666,15 @@ class wayfire_wm_actions_t : public wf::plugin_interface_t,
 
     wf::ipc::method_callback ipc_send_to_back = [=] (const nlohmann::json& js)
     {
-        return execute_for_view(js, [=] (wayfire_toplevel_view view, bool state)
+        return execute_for_views(js, [=] (const std::vector<wayfire_toplevel_view>& views, bool state)
         {
-            if (!view->get_output())
+            for (auto& [output, output_views] : group_by_output(views))
             {
-                return;
+                if (output)
+                {
+                    output_instance[output]->do_send_to_back(output_views);
+                }
             }
-
-            output_instance[view->get_output()]->do_send_to_back(view);
         });
     };
 
@@ -42,6 +42,11 @@
 
 #define MODEL_MAX_SPRINGS (GRID_WIDTH * GRID_HEIGHT * 2)
 
+/* The model is integrated in fixed steps of this many milliseconds */
+#define WOBBLY_STEP_MS 15.0f
+/* Limits the number of steps done for a single frame, e.g. after a stall */
+#define WOBBLY_MAX_FRAME_MS 100
+
 typedef struct _xy_pair {
     float x, y;
 } Point, Vector;
@@ -59,6 +64,8 @@ typedef struct _Edge {
 typedef struct _Object {
     Vector	 force;
     Point	 position;
+    /* The position before the last step, used for interpolating between steps */
+    Point	 previous;
     Vector	 velocity;
     float	 theta;
     int		 immobile;
@@ -81,6 +88,11 @@ typedef struct _Model {
     float	 steps;
     Point	 topLeft;
     Point	 bottomRight;
+    /* The control points of the rendered patch: the positions of the objects
+     * interpolated between the last two steps, stored as separate arrays of
+     * x and y coordinates so that the patch evaluation can be vectorized. */
+    float	 controlX[GRID_WIDTH * GRID_HEIGHT];
+    float	 controlY[GRID_WIDTH * GRID_HEIGHT];
 } Model;
 
 typedef struct _WobblyWindow {
@@ -91,6 +103,9 @@ typedef struct _WobblyWindow {
     int         grab_dx;
     int         grab_dy;
     unsigned int  state;
+    /* The Bernstein coefficients of each mesh column, see wobbly_add_geometry */
+    float       *coeffsU;
+    int         coeffsColumns;
 } WobblyWindow;
 
 #define WobblyInitial  (1L << 0)
@@ -105,6 +120,7 @@ static void objectInit(Object *object, float positionX, float positionY,
 
     object->position.x = positionX;
     object->position.y = positionY;
+    object->previous   = object->position;
 
     object->velocity.x = velocityX;
     object->velocity.y = velocityY;
@@ -125,10 +141,48 @@ static void springInit(Spring *spring, Object *a, Object *b,
     spring->offset.y = offsetY;
 }
 
+/* Interpolate the control points between the last two steps. Immobile objects
+ * (e.g. the grabbed one) are not interpolated, so that they follow the pointer
+ * without lag. */
+static void modelUpdateControlPoints(Model *model)
+{
+    int i;
+    float alpha = model->steps;
+
+    for (i = 0; i < model->numObjects; i++)
+    {
+        Object *object = &model->objects[i];
+        if (object->immobile)
+        {
+            model->controlX[i] = object->position.x;
+            model->controlY[i] = object->position.y;
+        }
+        else
+        {
+            model->controlX[i] = object->previous.x +
+                (object->position.x - object->previous.x) * alpha;
+            model->controlY[i] = object->previous.y +
+                (object->position.y - object->previous.y) * alpha;
+        }
+    }
+}
+
+/* Forget the motion of the last step, e.g. after objects have been moved
+ * directly. */
+static void modelResetInterpolation(Model *model)
+{
+    int i;
+
+    for (i = 0; i < model->numObjects; i++)
+        model->objects[i].previous = model->objects[i].position;
+}
+
 static void modelCalcBounds(Model *model)
 {
     int i;
 
+    modelUpdateControlPoints(model);
+
     model->topLeft.x	 = SHRT_MAX;
     model->topLeft.y	 = SHRT_MAX;
     model->bottomRight.x = SHRT_MIN;
@@ -136,15 +190,15 @@ static void modelCalcBounds(Model *model)
 
     for (i = 0; i < model->numObjects; i++)
     {
-        if (model->objects[i].position.x < model->topLeft.x)
-            model->topLeft.x = model->objects[i].position.x;
-        else if (model->objects[i].position.x > model->bottomRight.x)
-            model->bottomRight.x = model->objects[i].position.x;
-
-        if (model->objects[i].position.y < model->topLeft.y)
-            model->topLeft.y = model->objects[i].position.y;
-        else if (model->objects[i].position.y > model->bottomRight.y)
-            model->bottomRight.y = model->objects[i].position.y;
+        if (model->controlX[i] < model->topLeft.x)
+            model->topLeft.x = model->controlX[i];
+        else if (model->controlX[i] > model->bottomRight.x)
+            model->bottomRight.x = model->controlX[i];
+
+        if (model->controlY[i] < model->topLeft.y)
+            model->topLeft.y = model->controlY[i];
+        else if (model->controlY[i] > model->bottomRight.y)
+            model->bottomRight.y = model->controlY[i];
     }
 }
 
@@ -341,15 +395,19 @@ static int modelStep(Model *model, float friction, float k, float time)
     float velocitySum = 0.0f;
     float force, forceSum = 0.0f;
 
-    model->steps += time / 15.0f;
+    model->steps += time / WOBBLY_STEP_MS;
     steps = floor (model->steps);
     model->steps -= steps;
 
+    /* Frames between two steps show the model interpolated between them */
     if (!steps)
         return 1;
 
     for (j = 0; j < steps; j++)
     {
+        for (i = 0; i < model->numObjects; i++)
+            model->objects[i].previous = model->objects[i].position;
+
         for (i = 0; i < model->numSprings; i++)
             springExertForces (&model->springs[i], k);
 
@@ -370,38 +428,12 @@ static int modelStep(Model *model, float friction, float k, float time)
     return wobbly;
 }
 
-static void bezierPatchEvaluate (Model *model, float u, float v,
-        float *patchX, float *patchY)
+static void bernsteinCoefficients(float t, float *coeffs)
 {
-    float coeffsU[4], coeffsV[4];
-    float x, y;
-    int   i, j;
-
-    coeffsU[0] = (1 - u) * (1 - u) * (1 - u);
-    coeffsU[1] = 3 * u * (1 - u) * (1 - u);
-    coeffsU[2] = 3 * u * u * (1 - u);
-    coeffsU[3] = u * u * u;
-
-    coeffsV[0] = (1 - v) * (1 - v) * (1 - v);
-    coeffsV[1] = 3 * v * (1 - v) * (1 - v);
-    coeffsV[2] = 3 * v * v * (1 - v);
-    coeffsV[3] = v * v * v;
-
-    x = y = 0.0f;
-
-    for (i = 0; i < 4; i++)
-    {
-        for (j = 0; j < 4; j++)
-        {
-            x += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_WIDTH + i].position.x;
-            y += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_HEIGHT + i].position.y;
-        }
-    }
-
-    *patchX = x;
-    *patchY = y;
+    coeffs[0] = (1 - t) * (1 - t) * (1 - t);
+    coeffs[1] = 3 * t * (1 - t) * (1 - t);
+    coeffs[2] = 3 * t * t * (1 - t);
+    coeffs[3] = t * t * t;
 }
 
 static int wobblyEnsureModel(struct wobbly_surface *surface)
@@ -515,6 +547,7 @@ void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
 {
     WobblyWindow *ww = surface->ww;
     float  friction, springK;
+    int    time, maxTime;
 
     friction = wobbly_settings_get_friction();
     springK  = wobbly_settings_get_spring_k();
@@ -523,9 +556,15 @@ void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
     {
         if (ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce))
         {
-            ww->wobbly = modelStep(ww->model, friction, springK,
-                    (ww->wobbly & WobblyVelocity) ?
-                    msSinceLastPaint : 16);
+            /* The model advances with the real time between frames, so that it
+             * does not run faster on high refresh rate outputs. When the model
+             * starts moving, the time since the last paint is meaningless and
+             * at most one frame is simulated. */
+            maxTime = (ww->wobbly & WobblyVelocity) ? WOBBLY_MAX_FRAME_MS : 16;
+            time = msSinceLastPaint < maxTime ? msSinceLastPaint : maxTime;
+            time = time > 0 ? time : 0;
+
+            ww->wobbly = modelStep(ww->model, friction, springK, time);
 
             if (ww->wobbly) {
                 modelCalcBounds(ww->model);
@@ -551,43 +590,70 @@ void wobbly_done_paint(struct wobbly_surface *surface)
 void wobbly_add_geometry(struct wobbly_surface *surface)
 {
     WobblyWindow *ww = surface->ww;
+    Model *model = ww->model;
 
-    float    width, height;
-    float    deformedX, deformedY;
-    int      x, y, iw, ih;
-    float    cell_w, cell_h;
-    GLfloat  *v, *uv;
+    float    controlRowX[GRID_WIDTH], controlRowY[GRID_WIDTH];
+    float    coeffsV[GRID_HEIGHT];
+    float    u, v;
+    int      i, j, x, y, iw, ih;
+    float    *cu;
+    GLfloat  *vert, *uv;
 
     if (ww->wobbly)
     {
-        width  = surface->width;
-        height = surface->height;
-
-        cell_w = width / surface->x_cells;
-        cell_h = height / surface->y_cells;
-
         iw = surface->x_cells + 1;
         ih = surface->y_cells + 1;
 
-        v = realloc(surface->v, sizeof(GLfloat) * 2 * iw * ih);
+        vert = realloc(surface->v, sizeof(GLfloat) * 2 * iw * ih);
         uv = realloc(surface->uv, sizeof(GLfloat) * 2 * iw * ih);
 
-        surface->v = v;
+        surface->v = vert;
         surface->uv = uv;
 
-        for (y = 0; y < ih; y++)
+        modelUpdateControlPoints(model);
+
+        /* The coefficients of each column only depend on the mesh resolution */
+        if (ww->coeffsColumns != iw)
         {
+            ww->coeffsU = realloc(ww->coeffsU, sizeof(float) * GRID_WIDTH * iw);
+            ww->coeffsColumns = iw;
             for (x = 0; x < iw; x++)
+                bernsteinCoefficients((float) x / surface->x_cells,
+                    &ww->coeffsU[GRID_WIDTH * x]);
+        }
+
+        /* The bicubic patch is separable: for each row of the mesh, the 4x4
+         * control points are first reduced to a single cubic curve, which is
+         * then evaluated in every column. This needs 8 instead of 32
+         * multiply-adds per vertex. */
+        for (y = 0; y < ih; y++)
+        {
+            v = (float) y / surface->y_cells;
+            bernsteinCoefficients(v, coeffsV);
+
+            for (i = 0; i < GRID_WIDTH; i++)
             {
-                bezierPatchEvaluate(ww->model,
-                        (x * cell_w) / width, (y * cell_h) / height,
-                        &deformedX, &deformedY);
+                controlRowX[i] = 0.0f;
+                controlRowY[i] = 0.0f;
+                for (j = 0; j < GRID_HEIGHT; j++)
+                {
+                    controlRowX[i] += coeffsV[j] * model->controlX[j * GRID_WIDTH + i];
+                    controlRowY[i] += coeffsV[j] * model->controlY[j * GRID_WIDTH + i];
+                }
+            }
+
+            cu = ww->coeffsU;
+            for (x = 0; x < iw; x++, cu += GRID_WIDTH)
+            {
+                u = (float) x / surface->x_cells;
 
-                *v++ = deformedX;
-                *v++ = deformedY;
+                *vert++ = cu[0] * controlRowX[0] + cu[1] * controlRowX[1] +
+                    cu[2] * controlRowX[2] + cu[3] * controlRowX[3];
+                *vert++ = cu[0] * controlRowY[0] + cu[1] * controlRowY[1] +
+                    cu[2] * controlRowY[2] + cu[3] * controlRowY[3];
 
-                *uv++ = (x * cell_w) / width;
-                *uv++ = 1.0 - ((y * cell_h) / height);
+                *uv++ = u;
+                *uv++ = 1.0 - v;
             }
         }
     }
@@ -713,7 +779,11 @@ void wobbly_ungrab_notify(struct wobbly_surface *surface)
         if (ww->model)
         {
             if (ww->model->anchorObject)
+            {
                 ww->model->anchorObject->immobile = 0;
+                ww->model->anchorObject->previous =
+                    ww->model->anchorObject->position;
+            }
 
             ww->model->anchorObject = NULL;
 
@@ -736,6 +806,8 @@ int wobbly_init(struct wobbly_surface *surface)
     ww->wobbly  = 0;
     ww->grabbed = 0;
     ww->state   = 0;
+    ww->coeffsU = 0;
+    ww->coeffsColumns = 0;
 
     surface->ww = ww;
     if(!wobblyEnsureModel(surface))
@@ -756,8 +828,10 @@ void wobbly_fini(struct wobbly_surface *surface)
         free(ww->model->objects);
         free(ww->model);
         free(surface->v);
+        free(surface->uv);
     }
 
+    free (ww->coeffsU);
     free (ww);
 }
 
@@ -782,6 +856,7 @@ void wobbly_force_geometry(struct wobbly_surface *surface,
 
 	    modelInitSprings(ww->model, w, h);
 		modelAdjustCorners(ww->model, x, y, w, h, 1);
+	    modelResetInterpolation(ww->model);
 
 	    ww->wobbly |= WobblyInitial;
     }
@@ -816,6 +891,10 @@ void wobbly_translate(struct wobbly_surface *surface, int dx, int dy)
         {
             ww->model->objects[i].position.x += dx;
             ww->model->objects[i].position.y += dy;
+            ww->model->objects[i].previous.x += dx;
+            ww->model->objects[i].previous.y += dy;
+            ww->model->controlX[i] += dx;
+            ww->model->controlY[i] += dy;
         }
 
         ww->model->topLeft.x += dx;
@@ -839,6 +918,10 @@ void wobbly_scale(struct wobbly_surface *surface, double dx, double dy)
         {
             scale(surface->x, &ww->model->objects[i].position.x, dx);
             scale(surface->y, &ww->model->objects[i].position.y, dy);
+            scale(surface->x, &ww->model->objects[i].previous.x, dx);
+            scale(surface->y, &ww->model->objects[i].previous.y, dy);
+            scale(surface->x, &ww->model->controlX[i], dx);
+            scale(surface->y, &ww->model->controlY[i], dy);
         }
 
         scale(surface->x, &ww->model->topLeft.x, dx);
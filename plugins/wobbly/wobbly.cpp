@@ -1,13 +1,16 @@
 #include "wayfire/debug.hpp"
 #include "wayfire/opengl.hpp"
 #include "wayfire/region.hpp"
+#include <algorithm>
 #include <memory>
 #include <wayfire/plugin.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/core.hpp>
+#include <wayfire/output-layout.hpp>
 #include <wayfire/view-transform.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/render-manager.hpp>
+#include <wayfire/thread-pool.hpp>
 #include <wayfire/plugins/common/util.hpp>
 
 extern "C"
@@ -652,6 +655,8 @@ class wobbly_transformer_node_t : public wf::scene::transformer_base_node_t
 
     std::unique_ptr<wf::iwobbly_state_t> state;
     uint32_t last_frame;
+    /* The time since the previous frame, for step_model() */
+    int frame_time = 0;
     bool force_tile = false;
 
     void init_model()
@@ -676,7 +681,12 @@ class wobbly_transformer_node_t : public wf::scene::transformer_base_node_t
     }
 
   public:
-    void update_model()
+    /**
+     * Prepare the next frame of the model on the main thread.
+     *
+     * @return Whether the model needs to be stepped with step_model().
+     */
+    bool begin_frame()
     {
         view->damage();
 
@@ -686,17 +696,36 @@ class wobbly_transformer_node_t : public wf::scene::transformer_base_node_t
         state->handle_frame();
         view->connect(&on_view_geometry_changed);
 
-        /* Update all the wobbly model */
         auto now = wf::get_current_time();
+        if (now <= last_frame)
+        {
+            return false;
+        }
+
+        frame_time = now - last_frame;
+        last_frame = now;
+        view->get_transformed_node()->begin_transform_update();
+        return true;
+    }
+
+    /**
+     * Step the model and update the wobbly geometry. This touches only the model, so the models of different
+     * views can be stepped in parallel.
+     */
+    void step_model()
+    {
+        wobbly_prepare_paint(model.get(), frame_time);
+        wobbly_add_geometry(model.get());
+        wobbly_done_paint(model.get());
+    }
 
-        if (now > last_frame)
+    /**
+     * Finish the frame on the main thread, after step_model() if @stepped is true.
+     */
+    void end_frame(bool stepped)
+    {
+        if (stepped)
         {
-            view->get_transformed_node()->begin_transform_update();
-            wobbly_prepare_paint(model.get(), now - last_frame);
-            /* Update wobbly geometry */
-            last_frame = now;
-            wobbly_add_geometry(model.get());
-            wobbly_done_paint(model.get());
             view->get_transformed_node()->end_transform_update();
         }
 
@@ -852,11 +881,78 @@ class wobbly_transformer_node_t : public wf::scene::transformer_base_node_t
     }
 };
 
+/**
+ * Steps the models of all wobbly views shown on an output before each frame.
+ *
+ * The state of the views is updated on the main thread, but the models themselves are independent of each
+ * other, so they are stepped in parallel on the thread pool when several views wobble at the same time.
+ */
+class wobbly_frame_scheduler_t : public wf::custom_data_t
+{
+    wf::output_t *output = nullptr;
+    std::vector<wobbly_transformer_node_t*> nodes;
+
+    wf::effect_hook_t pre_hook = [=] ()
+    {
+        /* Nodes may be destroyed when their wobbly is done, keep them alive until the end of the frame. */
+        std::vector<std::shared_ptr<wobbly_transformer_node_t>> frame;
+        for (auto& node : nodes)
+        {
+            frame.push_back(std::dynamic_pointer_cast<wobbly_transformer_node_t>(node->shared_from_this()));
+        }
+
+        std::vector<bool> stepped(frame.size());
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            stepped[i] = frame[i]->begin_frame();
+        }
+
+        wf::thread_pool_t::get().parallel_for(frame.size(), [&] (size_t i)
+        {
+            if (stepped[i])
+            {
+                frame[i]->step_model();
+            }
+        });
+
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            frame[i]->end_frame(stepped[i]);
+        }
+    };
+
+  public:
+    void add_node(wf::output_t *wo, wobbly_transformer_node_t *node)
+    {
+        if (nodes.empty())
+        {
+            output = wo;
+            output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+        }
+
+        nodes.push_back(node);
+    }
+
+    void remove_node(wobbly_transformer_node_t *node)
+    {
+        auto it = std::find(nodes.begin(), nodes.end(), node);
+        if (it == nodes.end())
+        {
+            return;
+        }
+
+        nodes.erase(it);
+        if (nodes.empty())
+        {
+            output->render->rem_effect(&pre_hook);
+        }
+    }
+};
+
 class wobbly_render_instance_t :
     public wf::scene::transformer_render_instance_t<wobbly_transformer_node_t>
 {
     wf::output_t *wo = nullptr;
-    wf::effect_hook_t pre_hook;
 
   public:
     wobbly_render_instance_t(wobbly_transformer_node_t *self, wf::scene::damage_callback push_damage,
@@ -865,8 +961,7 @@ class wobbly_render_instance_t :
         if (shown_on)
         {
             wo = shown_on;
-            pre_hook = [=] () { self->update_model(); };
-            wo->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+            wo->get_data_safe<wobbly_frame_scheduler_t>()->add_node(wo, self);
         }
     }
 
@@ -874,7 +969,7 @@ class wobbly_render_instance_t :
     {
         if (wo)
         {
-            wo->render->rem_effect(&pre_hook);
+            wo->get_data_safe<wobbly_frame_scheduler_t>()->remove_node(self);
         }
     }
 
@@ -999,6 +1094,11 @@ class wayfire_wobbly : public wf::plugin_interface_t
             }
         }
 
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            wo->erase_data<wobbly_frame_scheduler_t>();
+        }
+
         OpenGL::render_begin();
         program.free_resources();
         OpenGL::render_end();
@@ -10,6 +10,7 @@
 #include <wayfire/signal-provider.hpp>
 
 #include <sys/types.h>
+#include <functional>
 #include <limits>
 #include <vector>
 #include <wayfire/nonstd/observer_ptr.h>
@@ -123,6 +124,8 @@ class compositor_core_t : public wf::object_base_t, public signal::provider_t
         wlr_gamma_control_manager_v1 *gamma_v1;
         wlr_screencopy_manager_v1 *screencopy;
         wlr_export_dmabuf_manager_v1 *export_dmabuf;
+        wlr_linux_dmabuf_v1 *linux_dmabuf = NULL;
+        wlr_linux_drm_syncobj_manager_v1 *drm_syncobj = NULL;
         wlr_server_decoration_manager *decorator_manager;
         wlr_xdg_decoration_manager_v1 *xdg_decorator;
         wlr_xdg_output_manager_v1 *output_manager;
@@ -260,6 +263,46 @@ class compositor_core_t : public wf::object_base_t, public signal::provider_t
      */
     std::vector<wayfire_view> get_all_views();
 
+    /**
+     * Call @callback for each view core manages, until it returns false.
+     * Unlike get_all_views(), no list of views is built. The callback must not create or destroy views.
+     */
+    void for_each_view(const std::function<bool (wayfire_view)>& callback);
+
+    /**
+     * @return The first view for which @predicate returns true, or nullptr if there is none.
+     */
+    wayfire_view find_view(const std::function<bool (wayfire_view)>& predicate);
+
+    /**
+     * @return A list of the views for which @predicate returns true.
+     */
+    std::vector<wayfire_view> get_views_if(const std::function<bool (wayfire_view)>& predicate);
+
+    /**
+     * @return The view with the given id (see view_interface_t::get_id()), or nullptr.
+     */
+    wayfire_view find_view_by_id(uint32_t id);
+
+    /**
+     * Get all views whose output is @output (which may be nullptr).
+     *
+     * The lists are cached by core and rebuilt only after views are created, destroyed or change their
+     * output, so this is cheap to call repeatedly. The list may be rebuilt by the next call after such a
+     * change, so callers which create, destroy or move views while iterating should make a copy first.
+     */
+    const std::vector<wayfire_view>& get_views_on_output(wf::output_t *output);
+
+    /**
+     * Get all views core manages, most recently focused first (by the last_focus_timestamp of their surface
+     * root node). Views which were never focused come last.
+     *
+     * Like get_views_on_output(), the list is cached by core. It is rebuilt only after views are created or
+     * destroyed, focus changes just move the newly focused views to the front, so this is cheap to call on
+     * each key press of a window switcher.
+     */
+    const std::vector<wayfire_view>& get_views_by_focus();
+
     /** The wayland socket name of Wayfire */
     std::string wayland_display;
 
@@ -315,6 +358,17 @@ class compositor_core_t : public wf::object_base_t, public signal::provider_t
  */
 void move_view_to_output(wayfire_toplevel_view v, wf::output_t *new_output, bool reconfigure);
 
+/**
+ * Move several views to new_output at once, see move_view_to_output().
+ *
+ * In contrast to calling move_view_to_output() for each view, the scenegraph is updated only once, the views
+ * keep their relative stacking order (@views should be given from top to bottom), and with @reconfigure, the
+ * new geometry of all views is applied in a single transaction. view_moved_to_wset_signal is still emitted
+ * for each view, followed by a single views_moved_to_output_signal.
+ */
+void move_views_to_output(const std::vector<wayfire_toplevel_view>& views, wf::output_t *new_output,
+    bool reconfigure);
+
 /**
  * Start a move of a view to a new workspace set (and thus potentially to a new output).
  * Note that the view will be removed from its current workspace set and added to the new one.
@@ -0,0 +1,390 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+    #error "wayfire/coroutine.hpp requires C++20 coroutines, build the plugin with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/thread-pool.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/txn/transaction-manager.hpp>
+
+/**
+ * Coroutine support for plugins which implement operations spanning several frames or event loop iterations,
+ * as an alternative to state machines built from idle calls, timers and signal connections.
+ *
+ * The core itself is built as C++17, so this header is only usable from plugins built as C++20. Everything
+ * here runs on the main thread, except the functions passed to on_worker().
+ *
+ * Example:
+ *
+ * wf::coro::task_t animate(wf::output_t *output)
+ * {
+ *     auto layout = co_await wf::coro::on_worker([] { return compute_layout(); });
+ *     co_await wf::coro::schedule_transaction(build_transaction(layout));
+ *     for (int i = 0; i < 10; i++)
+ *     {
+ *         step_animation();
+ *         co_await wf::coro::next_frame(output);
+ *     }
+ * }
+ *
+ * The plugin keeps the returned task as a member: destroying the task destroys the suspended coroutine with
+ * all its local variables, which disconnects whatever it was waiting for. A suspended coroutine is never
+ * resumed after its task is gone, so plugins can be unloaded at any time.
+ */
+namespace wf
+{
+namespace coro
+{
+/**
+ * The result of a coroutine. The coroutine starts running as soon as it is called, and runs until its first
+ * suspension point.
+ *
+ * A task owns its coroutine: if the task is destroyed before the coroutine finished, the coroutine is
+ * destroyed without being resumed. Tasks can also be awaited by other coroutines, which are resumed once the
+ * task finishes.
+ */
+class task_t
+{
+  public:
+    struct promise_type
+    {
+        // The coroutine awaiting this task, if any.
+        std::coroutine_handle<> continuation;
+
+        task_t get_return_object()
+        {
+            return task_t{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        struct final_awaiter_t
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept
+            {
+                auto next = self.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept
+            {}
+        };
+
+        // The frame is kept until the task is destroyed, so that the task can check whether it is done.
+        final_awaiter_t final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {}
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+
+    task_t() = default;
+    task_t(task_t&& other) : handle(std::exchange(other.handle, nullptr))
+    {}
+
+    task_t& operator =(task_t&& other)
+    {
+        if (this != &other)
+        {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    task_t(const task_t&) = delete;
+    task_t& operator =(const task_t&) = delete;
+
+    ~task_t()
+    {
+        reset();
+    }
+
+    /** @return true if the task has a coroutine which has not finished yet. */
+    bool is_running() const
+    {
+        return handle && !handle.done();
+    }
+
+    /** Destroy the coroutine, if it has not finished yet it is cancelled. */
+    void reset()
+    {
+        if (handle)
+        {
+            std::exchange(handle, nullptr).destroy();
+        }
+    }
+
+    struct awaiter_t
+    {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() const noexcept
+        {
+            return !handle || handle.done();
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+        }
+
+        void await_resume() noexcept
+        {}
+    };
+
+    /** Wait until the task finishes. The task must be awaited at most once. */
+    awaiter_t operator co_await() const noexcept
+    {
+        return awaiter_t{handle};
+    }
+
+  private:
+    explicit task_t(std::coroutine_handle<promise_type> handle) : handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Schedule a redraw of the output and wait until the frame is done (see frame_done_signal).
+ *
+ * Outputs which do not repaint (for example with DPMS off) send no frame events, so the coroutine is also
+ * resumed after FALLBACK_MS without a frame, and when the output is about to be removed. co_await returns
+ * true if a frame was actually done. If it returns false, the output may be going away and must not be used
+ * after the next suspension point.
+ */
+class next_frame
+{
+  public:
+    static constexpr uint32_t FALLBACK_MS = 100;
+
+    explicit next_frame(wf::output_t *output) : output(output)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        this->awaiting = awaiting;
+        on_frame_done  = [this] (wf::frame_done_signal*) { wake(true); };
+        on_pre_remove  = [this] (wf::output_pre_remove_signal*) { wake(false); };
+        output->connect(&on_frame_done);
+        output->connect(&on_pre_remove);
+        fallback.set_timeout(FALLBACK_MS, [this] { wake(false); });
+        output->render->schedule_redraw();
+    }
+
+    bool await_resume() const noexcept
+    {
+        return frame_done;
+    }
+
+  private:
+    wf::output_t *output;
+    std::coroutine_handle<> awaiting;
+    bool frame_done = false;
+    wf::signal::connection_t<wf::frame_done_signal> on_frame_done;
+    wf::signal::connection_t<wf::output_pre_remove_signal> on_pre_remove;
+    wf::wl_timer<false> fallback;
+
+    void wake(bool frame_done)
+    {
+        this->frame_done = frame_done;
+        on_frame_done.disconnect();
+        on_pre_remove.disconnect();
+        fallback.disconnect();
+        awaiting.resume();
+    }
+};
+
+/**
+ * Wait for the given number of milliseconds, see wf::wl_timer.
+ */
+class timeout
+{
+  public:
+    explicit timeout(uint32_t timeout_ms) : timeout_ms(timeout_ms)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return timeout_ms == 0;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        timer.set_timeout(timeout_ms, [awaiting] { awaiting.resume(); });
+    }
+
+    void await_resume() const noexcept
+    {}
+
+  private:
+    uint32_t timeout_ms;
+    wf::wl_timer<false> timer;
+};
+
+/**
+ * Schedule the transaction with the transaction manager and wait until it has been applied. If the manager
+ * merges it with other transactions, the coroutine is resumed when the merged transaction is applied.
+ *
+ * If the transaction is split (see transaction_t::set_adaptive_timeout()), the objects which were ready are
+ * applied early, and the coroutine keeps waiting for the late objects.
+ */
+class schedule_transaction
+{
+  public:
+    struct result_t
+    {
+        // The transaction timed out, see transaction_applied_signal.
+        bool timed_out = false;
+        // The objects which were applied early because the transaction was split. The remaining objects
+        // were applied when the coroutine was resumed.
+        std::vector<wf::txn::transaction_object_sptr> applied_early;
+    };
+
+    explicit schedule_transaction(wf::txn::transaction_uptr tx) : tx(std::move(tx))
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        on_applied = [this, awaiting] (wf::txn::transaction_applied_signal *ev)
+        {
+            result.timed_out = ev->timed_out;
+            on_applied.disconnect();
+            on_merged.disconnect();
+            on_split.disconnect();
+            awaiting.resume();
+        };
+
+        on_merged = [this] (wf::txn::transaction_merged_signal *ev)
+        {
+            follow(ev->into);
+        };
+
+        on_split = [this] (wf::txn::transaction_split_signal *ev)
+        {
+            result.applied_early.insert(result.applied_early.end(), ev->applied.begin(), ev->applied.end());
+        };
+
+        follow(tx.get());
+        wf::get_core().tx_manager->schedule_transaction(std::move(tx));
+    }
+
+    result_t await_resume() noexcept
+    {
+        return std::move(result);
+    }
+
+  private:
+    wf::txn::transaction_uptr tx;
+    result_t result;
+    wf::signal::connection_t<wf::txn::transaction_applied_signal> on_applied;
+    wf::signal::connection_t<wf::txn::transaction_merged_signal> on_merged;
+    wf::signal::connection_t<wf::txn::transaction_split_signal> on_split;
+
+    void follow(wf::txn::transaction_t *target)
+    {
+        on_applied.disconnect();
+        on_merged.disconnect();
+        on_split.disconnect();
+        target->connect(&on_applied);
+        target->connect(&on_merged);
+        target->connect(&on_split);
+    }
+};
+
+/**
+ * Run a function on the compositor's thread pool and wait for it to finish. co_await returns the result of
+ * the function. The function must not use the compositor's state.
+ *
+ * If the coroutine is destroyed while the function is queued, the function is cancelled. If it is already
+ * running, destroying the coroutine waits for it to finish.
+ */
+template<class Function>
+class on_worker
+{
+    using result_t = std::invoke_result_t<Function&>;
+    using stored_t = std::conditional_t<std::is_void_v<result_t>, std::monostate, result_t>;
+
+  public:
+    explicit on_worker(Function fn) : fn(std::move(fn))
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        tasks.emplace();
+        tasks->submit([this]
+        {
+            if constexpr (std::is_void_v<result_t>)
+            {
+                fn();
+                result.emplace();
+            } else
+            {
+                result.emplace(fn());
+            }
+        }, [awaiting] { awaiting.resume(); });
+    }
+
+    result_t await_resume()
+    {
+        if constexpr (!std::is_void_v<result_t>)
+        {
+            return std::move(*result);
+        }
+    }
+
+  private:
+    Function fn;
+    std::optional<stored_t> result;
+
+    // Declared last, so that it is destroyed first and waits for a running function before the storage for
+    // its result is gone.
+    std::optional<wf::task_group_t> tasks;
+};
+}
+}
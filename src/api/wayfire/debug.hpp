@@ -11,6 +11,7 @@
 
 #define nonull(x) ((x) ? (x) : ("nil"))
 #include <wayfire/dassert.hpp>
+#include <wayfire/trace.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/scene.hpp>
 #include <wayfire/core.hpp>
@@ -23,6 +24,12 @@ namespace wf
  */
 void dump_scene(scene::node_ptr root = wf::get_core().scene());
 
+/**
+ * Get the total number of heap allocations done by the process so far, or -1 if Wayfire was built without
+ * the allocation_stats build option.
+ */
+int64_t get_heap_allocation_count();
+
 /**
  * Information about the version that Wayfire was built with.
  * Made available at runtime.
@@ -69,13 +76,27 @@ enum class logging_category : size_t
 };
 
 extern std::bitset<(size_t)logging_category::TOTAL> enabled_categories;
+
+/**
+ * Categories which are recorded in the log ring (see log-ring.hpp) instead of being printed.
+ * Categories which are enabled are printed, even if they are also recorded.
+ */
+extern std::bitset<(size_t)logging_category::TOTAL> recorded_categories;
+
+/** @return The name of the category, as used in LOGC. */
+const char *category_to_string(logging_category category);
 }
 }
 
+#include <wayfire/log-ring.hpp>
+
 #define LOGC(CAT, ...) \
     if (wf::log::enabled_categories[(size_t)wf::log::logging_category::CAT]) \
     { \
         LOGD("[", #CAT, "] ", __VA_ARGS__); \
+    } else if (wf::log::recorded_categories[(size_t)wf::log::logging_category::CAT]) \
+    { \
+        wf::log::ring::record((size_t)wf::log::logging_category::CAT, __FILE__, __LINE__, __VA_ARGS__); \
     }
 
 /* ------------------- Miscallaneous helpers for debugging ------------------ */
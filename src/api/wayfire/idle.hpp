@@ -4,7 +4,8 @@ namespace wf
 {
 /**
  * Dummy non-copyable type that increments the global inhibitor count when created,
- * and decrements when destroyed. These changes influence wlroots idle enablement.
+ * and decrements when destroyed. These changes influence wlroots idle enablement, and are applied at the
+ * end of the current event loop iteration.
  */
 class idle_inhibitor_t
 {
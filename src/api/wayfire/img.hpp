@@ -2,15 +2,63 @@
 #define IMG_HPP_
 
 #include <wayfire/opengl.hpp>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace image_io
 {
+/* An image decoded in memory: 8 bits per channel (3 or 4 channels),
+ * with tightly packed rows */
+struct decoded_image_t
+{
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+    std::vector<uint8_t> pixels;
+};
+
 /* Load the image from the given file, binding it to the given GL texture target
  * Bind the texture before you call this function
  * Guaranteed: doesn't change any GL state except pixel packing */
 bool load_from_file(std::string name, GLuint target);
 
+/* Decode the image from the given file without touching any GL state.
+ * Can be called from any thread. */
+std::optional<decoded_image_t> decode_from_file(std::string name);
+
+/* Downscale the image with a box filter so that it fits in max_width x max_height,
+ * preserving its aspect ratio. Images which already fit are left untouched. */
+void downscale_to_fit(decoded_image_t& image, int max_width, int max_height);
+
+/* Upload a decoded image to the given GL texture target
+ * Same requirements and guarantees as load_from_file() */
+bool upload(const decoded_image_t& image, GLuint target);
+
+/* A pending asynchronous image load, see load_from_file_async().
+ * Destroying it cancels the callback if it hasn't been called yet. */
+class async_load_t
+{
+  public:
+    ~async_load_t();
+
+    struct impl;
+    std::shared_ptr<impl> priv;
+};
+
+using async_load_callback_t = std::function<void (std::optional<decoded_image_t>)>;
+
+/* Decode the image from the given file on a worker thread, optionally downscaling
+ * it to fit in max_width x max_height (0 means no limit).
+ *
+ * The callback is called from the main loop once decoding is done, so it may use
+ * upload() (inside OpenGL::render_begin/end) to get the image into a texture.
+ * The returned object must be kept alive until then. */
+std::unique_ptr<async_load_t> load_from_file_async(std::string name,
+    async_load_callback_t callback, int max_width = 0, int max_height = 0);
+
 /* Function that saves the given pixels(in rgba format) to a (currently) png file */
 void write_to_file(std::string name, uint8_t *pixels, int w, int h,
     std::string type, bool invert = false);
@@ -19,6 +67,9 @@ void write_to_file(std::string name, wf::framebuffer_t buffer);
 
 /* Initializes all backends, called at startup */
 void init();
+
+/* Cancels pending asynchronous loads, called at shutdown */
+void fini();
 }
 
 #endif /* end of include guard: IMG_HPP_ */
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <wayfire/geometry.hpp>
+#include <wayfire/util/log.hpp>
+
+namespace wf
+{
+namespace log
+{
+/**
+ * The log ring records messages of selected logging categories in a binary ring buffer per thread, instead of
+ * printing them. Only the arguments are stored: numbers, pointers and geometry types are copied as they are,
+ * strings are copied byte for byte, and all other arguments are formatted to a string right away, since they
+ * might refer to objects which no longer exist when the ring is dumped. The actual message is formatted only
+ * when the ring is dumped, which happens when the compositor crashes or on demand via the IPC method
+ * debug/log-ring. This makes it cheap enough to keep verbose categories recorded permanently.
+ *
+ * When a ring is full, the oldest messages are overwritten. Records do not contain pointers to code or data
+ * of the thread or plugin which wrote them, so they can be dumped after a plugin has been unloaded.
+ */
+namespace ring
+{
+/** The size of the ring buffer of each thread, in bytes. */
+constexpr size_t RING_CAPACITY = 512 * 1024;
+
+enum class arg_tag_t : uint8_t
+{
+    BOOL,
+    CHAR,
+    INT,
+    UINT,
+    DOUBLE,
+    POINTER,
+    POINT,
+    POINTF,
+    DIMENSIONS,
+    GEOMETRY,
+    STRING,
+};
+
+/** A message being written, encodes the arguments into a temporary buffer of the thread. */
+class record_writer_t
+{
+  public:
+    record_writer_t(size_t category, std::string_view file, int line);
+
+    /** Append the message to the ring of the calling thread. */
+    void commit();
+
+    template<class T>
+    void encode(const T& arg)
+    {
+        using type = std::decay_t<T>;
+        if constexpr (std::is_same_v<type, bool>)
+        {
+            put(arg_tag_t::BOOL, (uint8_t)arg);
+        } else if constexpr (std::is_same_v<type, char> || std::is_same_v<type, signed char> ||
+                             std::is_same_v<type, unsigned char>)
+        {
+            put(arg_tag_t::CHAR, (char)arg);
+        } else if constexpr (std::is_integral_v<type> && std::is_signed_v<type>)
+        {
+            put(arg_tag_t::INT, (int64_t)arg);
+        } else if constexpr (std::is_integral_v<type>)
+        {
+            put(arg_tag_t::UINT, (uint64_t)arg);
+        } else if constexpr (std::is_floating_point_v<type>)
+        {
+            put(arg_tag_t::DOUBLE, (double)arg);
+        } else if constexpr (std::is_same_v<type, const char*> || std::is_same_v<type, char*>)
+        {
+            const char *str = arg;
+            put_string(str ? std::string_view{str} : std::string_view{"(null)"});
+        } else if constexpr (std::is_same_v<type, std::string> || std::is_same_v<type, std::string_view>)
+        {
+            put_string(arg);
+        } else if constexpr (std::is_pointer_v<type>)
+        {
+            put(arg_tag_t::POINTER, (uintptr_t)arg);
+        } else if constexpr (std::is_same_v<type, wf::point_t>)
+        {
+            put(arg_tag_t::POINT, arg);
+        } else if constexpr (std::is_same_v<type, wf::pointf_t>)
+        {
+            put(arg_tag_t::POINTF, arg);
+        } else if constexpr (std::is_same_v<type, wf::dimensions_t>)
+        {
+            put(arg_tag_t::DIMENSIONS, arg);
+        } else if constexpr (std::is_same_v<type, wf::geometry_t>)
+        {
+            put(arg_tag_t::GEOMETRY, arg);
+        } else
+        {
+            put_string(wf::log::detail::format_concat(arg));
+        }
+    }
+
+  private:
+    std::vector<char>& data;
+
+    template<class T>
+    void put(arg_tag_t tag, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        size_t pos = data.size();
+        data.resize(pos + 1 + sizeof(T));
+        data[pos] = (char)tag;
+        std::memcpy(data.data() + pos + 1, &value, sizeof(T));
+    }
+
+    void put_string(std::string_view str);
+};
+
+template<class... Args>
+void record(size_t category, std::string_view file, int line, const Args&... args)
+{
+    record_writer_t writer{category, file, line};
+    (writer.encode(args), ...);
+    writer.commit();
+}
+
+/**
+ * Format the recorded messages of all threads, ordered by the time they were recorded.
+ * Each message is prefixed with its time, category and source location.
+ */
+std::vector<std::string> format_all();
+
+/** Print the recorded messages of all threads to the log. Used when the compositor crashes. */
+void dump_to_log();
+
+/** Drop the recorded messages of all threads. */
+void clear();
+}
+}
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace wf
+{
+/**
+ * A list which can be modified while it is being iterated, for lists of small trivially copyable values
+ * like the pointers to signal connections or effect hooks. It has the same interface as wf::safe_list_t.
+ *
+ * The elements are stored contiguously, and the first InlineCapacity of them inside the list itself, so
+ * that short lists do not allocate at all. Elements removed during an iteration are replaced by a
+ * tombstone, which is skipped by all iterations. The tombstones are compacted in a single pass when the
+ * outermost iteration finishes, elements removed outside of an iteration are erased directly.
+ *
+ * Elements added during an iteration are not visited by that iteration.
+ */
+template<class T, size_t InlineCapacity = 4>
+class compact_safe_list_t
+{
+    static_assert(std::is_trivially_copyable_v<T>, "compact_safe_list_t holds trivially copyable values");
+
+  public:
+    compact_safe_list_t() = default;
+
+    // Non-copyable and non-movable: iterations keep a pointer to the list.
+    compact_safe_list_t(const compact_safe_list_t&) = delete;
+    compact_safe_list_t(compact_safe_list_t&&) = delete;
+    compact_safe_list_t& operator =(const compact_safe_list_t&) = delete;
+    compact_safe_list_t& operator =(compact_safe_list_t&&) = delete;
+
+    void push_back(T value)
+    {
+        if (count == capacity)
+        {
+            grow();
+        }
+
+        data()[count++] = {value, true};
+        ++alive;
+    }
+
+    /** @return The number of elements in the list, not counting tombstones. */
+    size_t size() const
+    {
+        return alive;
+    }
+
+    /** @return The last element in the list. The list must not be empty. */
+    T& back()
+    {
+        size_t i = count;
+        while (!data()[--i].alive)
+        {}
+
+        return data()[i].value;
+    }
+
+    /** @return The first element in the list. The list must not be empty. */
+    T& front()
+    {
+        size_t i = 0;
+        while (!data()[i].alive)
+        {
+            ++i;
+        }
+
+        return data()[i].value;
+    }
+
+    /** Remove all elements for which @predicate returns true. */
+    template<class Predicate>
+    void remove_if(Predicate predicate)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& entry = data()[i];
+            if (entry.alive && predicate(entry.value))
+            {
+                entry.alive = false;
+                --alive;
+            }
+        }
+
+        if ((iteration_depth == 0) && (alive < count))
+        {
+            compact();
+        }
+    }
+
+    /** Remove all occurrences of @value. */
+    void remove_all(const T& value)
+    {
+        remove_if([&] (const T& other) { return other == value; });
+    }
+
+    /** Call @func for each element, in the order they were added. */
+    template<class Func>
+    void for_each(Func func)
+    {
+        iteration_guard_t guard{this};
+        // Elements added by @func are after the end of the iteration.
+        const size_t end = count;
+        for (size_t i = 0; i < end; i++)
+        {
+            // Copy the value, @func may add elements and thereby move the storage.
+            auto entry = data()[i];
+            if (entry.alive)
+            {
+                func(entry.value);
+            }
+        }
+    }
+
+    /** Call @func for each element, starting with the element added last. */
+    template<class Func>
+    void for_each_reverse(Func func)
+    {
+        iteration_guard_t guard{this};
+        for (size_t i = count; i > 0; i--)
+        {
+            auto entry = data()[i - 1];
+            if (entry.alive)
+            {
+                func(entry.value);
+            }
+        }
+    }
+
+  private:
+    struct entry_t
+    {
+        T value;
+        bool alive;
+    };
+
+    entry_t inline_entries[InlineCapacity];
+    std::unique_ptr<entry_t[]> heap_entries;
+
+    // The number of stored entries, including tombstones.
+    size_t count = 0;
+    size_t capacity = InlineCapacity;
+    // The number of entries which are not tombstones.
+    size_t alive = 0;
+    // The number of iterations currently running over the list.
+    int iteration_depth = 0;
+
+    struct iteration_guard_t
+    {
+        compact_safe_list_t *list;
+        iteration_guard_t(compact_safe_list_t *list) : list(list)
+        {
+            ++list->iteration_depth;
+        }
+
+        ~iteration_guard_t()
+        {
+            if ((--list->iteration_depth == 0) && (list->alive < list->count))
+            {
+                list->compact();
+            }
+        }
+    };
+
+    entry_t *data()
+    {
+        return heap_entries ? heap_entries.get() : inline_entries;
+    }
+
+    const entry_t *data() const
+    {
+        return heap_entries ? heap_entries.get() : inline_entries;
+    }
+
+    void grow()
+    {
+        auto entries = std::make_unique<entry_t[]>(capacity * 2);
+        std::copy(data(), data() + count, entries.get());
+        heap_entries = std::move(entries);
+        capacity    *= 2;
+    }
+
+    /** Remove the tombstones, keeping the order of the elements. */
+    void compact()
+    {
+        auto entries = data();
+        size_t kept  = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (entries[i].alive)
+            {
+                entries[kept++] = entries[i];
+            }
+        }
+
+        count = kept;
+    }
+};
+}
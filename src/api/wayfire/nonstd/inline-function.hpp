@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wf
+{
+template<class Signature, size_t InlineSize = 48>
+class inline_function_t;
+
+/**
+ * A replacement for std::function which stores callables of up to @InlineSize bytes inside the object
+ * itself, instead of allocating them on the heap (std::function in libstdc++ does so only for callables
+ * of up to 16 bytes). Larger callables are still supported, but are allocated on the heap.
+ *
+ * In contrast to std::function, inline_function_t is neither copyable nor movable, since it is meant to be
+ * stored in objects which are themselves pinned in memory, like signal connections.
+ */
+template<class R, class... Args, size_t InlineSize>
+class inline_function_t<R(Args...), InlineSize>
+{
+  public:
+    inline_function_t() = default;
+    ~inline_function_t()
+    {
+        reset();
+    }
+
+    inline_function_t(const inline_function_t&) = delete;
+    inline_function_t(inline_function_t&&) = delete;
+    inline_function_t& operator =(const inline_function_t&) = delete;
+    inline_function_t& operator =(inline_function_t&&) = delete;
+
+    /** Replace the stored callable with a copy of @callable. */
+    template<class Callable>
+    void assign(Callable&& callable)
+    {
+        using T = std::decay_t<Callable>;
+        reset();
+        if constexpr (fits_inline<T>)
+        {
+            new (&storage) T(std::forward<Callable>(callable));
+            ops = &inline_ops<T>;
+        } else
+        {
+            *reinterpret_cast<T**>(&storage) = new T(std::forward<Callable>(callable));
+            ops = &heap_ops<T>;
+        }
+    }
+
+    /** Destroy the stored callable, if any. */
+    void reset()
+    {
+        if (ops)
+        {
+            auto old_ops = ops;
+            ops = nullptr;
+            old_ops->destroy(&storage);
+        }
+    }
+
+    explicit operator bool() const
+    {
+        return ops != nullptr;
+    }
+
+    R operator ()(Args... args) const
+    {
+        return ops->invoke(&storage, std::forward<Args>(args)...);
+    }
+
+  private:
+    struct ops_t
+    {
+        R (*invoke)(const void *storage, Args&&... args);
+        void (*destroy)(void *storage);
+    };
+
+    template<class T>
+    static constexpr bool fits_inline = (sizeof(T) <= InlineSize) &&
+        (alignof(T) <= alignof(std::max_align_t)) && std::is_nothrow_destructible_v<T>;
+
+    template<class T>
+    static constexpr ops_t inline_ops = {
+        [] (const void *storage, Args&&... args) -> R
+        {
+            auto& callable = *const_cast<T*>(static_cast<const T*>(storage));
+            return callable(std::forward<Args>(args)...);
+        },
+        [] (void *storage)
+        {
+            static_cast<T*>(storage)->~T();
+        },
+    };
+
+    template<class T>
+    static constexpr ops_t heap_ops = {
+        [] (const void *storage, Args&&... args) -> R
+        {
+            return (**static_cast<T* const*>(storage))(std::forward<Args>(args)...);
+        },
+        [] (void *storage)
+        {
+            delete *static_cast<T**>(storage);
+        },
+    };
+
+    const ops_t *ops = nullptr;
+    alignas(std::max_align_t) mutable unsigned char storage[InlineSize];
+};
+}
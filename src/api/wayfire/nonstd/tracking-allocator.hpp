@@ -1,6 +1,8 @@
 #pragma once
+#include <cstddef>
 #include <memory>
 #include <functional>
+#include <vector>
 #include <wayfire/dassert.hpp>
 #include <wayfire/nonstd/observer_ptr.h>
 #include <wayfire/signal-provider.hpp>
@@ -17,10 +19,86 @@ struct destruct_signal
     T *object;
 };
 
+namespace detail
+{
+/** The header in front of each block of a slab, holding the position of its object in the tracked list. */
+struct alignas(std::max_align_t) slab_slot_t
+{
+    size_t index;
+};
+
+/**
+ * A slab of blocks of a fixed size. Blocks are carved from chunks which are kept for the lifetime of the
+ * process, freed blocks are put on an intrusive free list and handed out again first. This way, creating
+ * and destroying objects in quick succession does not go through the general purpose allocator.
+ */
+template<size_t BlockSize>
+class slab_t
+{
+  public:
+    static slab_t& get()
+    {
+        // Never destroyed, objects may still be freed while static storage is torn down at exit.
+        static slab_t *slab = new slab_t;
+        return *slab;
+    }
+
+    /** @return A block of BlockSize bytes, preceded by its slot header. */
+    void *allocate()
+    {
+        if (!free_list)
+        {
+            add_chunk();
+        }
+
+        auto block = free_list;
+        free_list = free_list->next;
+        return (char*)block + sizeof(slab_slot_t);
+    }
+
+    void deallocate(void *payload)
+    {
+        auto block = (free_block_t*)((char*)payload - sizeof(slab_slot_t));
+        block->next = free_list;
+        free_list   = block;
+    }
+
+  private:
+    static constexpr size_t CHUNK_BLOCKS = 16;
+    static constexpr size_t BLOCK_STRIDE = sizeof(slab_slot_t) +
+        (BlockSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    struct free_block_t
+    {
+        free_block_t *next;
+    };
+
+    free_block_t *free_list = nullptr;
+    std::vector<std::unique_ptr<char[]>> chunks;
+
+    void add_chunk()
+    {
+        // operator new[] for char returns memory aligned for any fundamental type.
+        chunks.emplace_back(new char[CHUNK_BLOCKS * BLOCK_STRIDE]);
+        for (size_t i = CHUNK_BLOCKS; i > 0; i--)
+        {
+            auto block = (free_block_t*)(chunks.back().get() + (i - 1) * BLOCK_STRIDE);
+            block->next = free_list;
+            free_list   = block;
+        }
+    }
+};
+}
+
 /**
  * The tracking allocator is a factory singleton for allocating objects of a certain type.
  * The objects are allocated via shared pointers, and the tracking allocator keeps a list of all allocated
  * objects, accessible by plugins.
+ *
+ * Each object is allocated together with its shared pointer control block in a single block of a slab, and
+ * remembers its position in the list, so that freeing it is O(1): the entry of a freed object is only cleared,
+ * and the list is compacted the next time it is requested. The list stays in the order the objects were
+ * allocated.
  */
 template<class ObjectType>
 class tracking_allocator_t
@@ -36,25 +114,167 @@ class tracking_allocator_t
     }
 
     template<class ConcreteObjectType, class... Args>
-    std::shared_ptr<ConcreteObjectType> allocate(Args... args)
+    std::shared_ptr<ConcreteObjectType> allocate(Args&&... args)
     {
         static_assert(std::is_base_of_v<ObjectType, ConcreteObjectType>);
-        auto ptr = std::shared_ptr<ConcreteObjectType>(
-            new ConcreteObjectType(std::forward<Args>(args)...),
-            std::bind(&tracking_allocator_t<ObjectType>::deallocate_object, this, std::placeholders::_1));
+        auto ptr = std::allocate_shared<ConcreteObjectType>(
+            allocator_t<ConcreteObjectType>{}, std::forward<Args>(args)...);
 
+        auto slot = slot_of(ptr.get());
+        slot->index = allocated_objects.size();
         allocated_objects.push_back(ptr.get());
+        slots.push_back(slot);
+        ++generation;
         return ptr;
     }
 
+    /**
+     * Get all allocated objects, in the order they were allocated.
+     *
+     * The list is invalidated when objects are allocated or freed, so callers which may do that while
+     * iterating should make a copy first.
+     */
     const std::vector<nonstd::observer_ptr<ObjectType>>& get_all()
     {
+        compact();
         return allocated_objects;
     }
 
+    /**
+     * Get a counter which is incremented whenever an object is allocated or freed.
+     * It can be used to invalidate caches derived from the list of objects.
+     */
+    uint64_t get_generation() const
+    {
+        return generation;
+    }
+
   private:
     std::vector<nonstd::observer_ptr<ObjectType>> allocated_objects;
-    void deallocate_object(ObjectType *obj)
+    // The slot of each object in allocated_objects, at the same index. The slots of freed objects are null.
+    std::vector<detail::slab_slot_t*> slots;
+    size_t nr_freed = 0;
+    uint64_t generation = 0;
+
+    /** Remove the entries of freed objects, keeping the order of the rest. */
+    void compact()
+    {
+        if (nr_freed == 0)
+        {
+            return;
+        }
+
+        size_t j = 0;
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (slots[i])
+            {
+                allocated_objects[j] = allocated_objects[i];
+                slots[j] = slots[i];
+                slots[j]->index = j;
+                ++j;
+            }
+        }
+
+        allocated_objects.resize(j);
+        slots.resize(j);
+        nr_freed = 0;
+    }
+
+    // The block most recently handed out by allocator_t, in which the next object is constructed.
+    static inline void *last_block = nullptr;
+    template<class ConcreteObjectType>
+    static inline std::ptrdiff_t object_offset = -1;
+
+    template<class ConcreteObjectType>
+    static detail::slab_slot_t *slot_of(ConcreteObjectType *obj)
+    {
+        return (detail::slab_slot_t*)((char*)obj - object_offset<ConcreteObjectType> -
+            sizeof(detail::slab_slot_t));
+    }
+
+    /**
+     * The allocator for std::allocate_shared. It hands out blocks of the slab for the control block type
+     * and constructs and destroys the objects through the tracking allocator, which the object types may
+     * have befriended.
+     */
+    template<class T>
+    struct allocator_t
+    {
+        using value_type = T;
+
+        allocator_t() = default;
+        template<class U>
+        allocator_t(const allocator_t<U>&)
+        {}
+
+        template<class U>
+        struct rebind
+        {
+            using other = allocator_t<U>;
+        };
+
+        T *allocate(size_t n)
+        {
+            if (n != 1)
+            {
+                wf::dassert(false, "The tracking allocator allocates one object at a time!");
+            }
+
+            last_block = detail::slab_t<sizeof(T)>::get().allocate();
+            return (T*)last_block;
+        }
+
+        void deallocate(T *block, size_t)
+        {
+            detail::slab_t<sizeof(T)>::get().deallocate(block);
+        }
+
+        template<class U, class... Args>
+        void construct(U *obj, Args&&... args)
+        {
+            // The object lives at the same offset in every block of its type. Determine it before the
+            // constructor runs, as it may allocate further objects.
+            auto& offset = object_offset<U>;
+            if (offset < 0)
+            {
+                offset = (char*)obj - (char*)last_block;
+            }
+
+            if ((char*)obj - (char*)last_block != offset)
+            {
+                wf::dassert(false, "Object is not in its block?");
+            }
+
+            tracking_allocator_t::construct_object(obj, std::forward<Args>(args)...);
+        }
+
+        template<class U>
+        void destroy(U *obj)
+        {
+            tracking_allocator_t::get().deallocate_object(obj, slot_of(obj));
+        }
+
+        template<class U>
+        bool operator ==(const allocator_t<U>&) const
+        {
+            return true;
+        }
+
+        template<class U>
+        bool operator !=(const allocator_t<U>&) const
+        {
+            return false;
+        }
+    };
+
+    template<class ConcreteObjectType, class... Args>
+    static void construct_object(ConcreteObjectType *obj, Args&&... args)
+    {
+        new ((void*)obj) ConcreteObjectType(std::forward<Args>(args)...);
+    }
+
+    void deallocate_object(ObjectType *obj, detail::slab_slot_t *slot)
     {
         if constexpr (std::is_base_of_v<wf::signal::provider_t, ObjectType>)
         {
@@ -63,11 +283,19 @@ class tracking_allocator_t
             obj->emit(&event);
         }
 
-        auto it = std::find(allocated_objects.begin(), allocated_objects.end(),
-            nonstd::observer_ptr<ObjectType>{obj});
-        wf::dassert(it != allocated_objects.end(), "Object is not allocated?");
-        allocated_objects.erase(it);
-        delete obj;
+        const size_t index = slot->index;
+        wf::dassert((index < allocated_objects.size()) && (allocated_objects[index].get() == obj),
+            "Object is not allocated?");
+        allocated_objects[index] = nullptr;
+        slots[index] = nullptr;
+        // Compact when most entries are freed, so that the list does not grow if nobody requests it.
+        if (++nr_freed > slots.size() / 2)
+        {
+            compact();
+        }
+
+        ++generation;
+        obj->~ObjectType();
     }
 };
 }
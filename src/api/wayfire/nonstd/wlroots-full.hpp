@@ -41,8 +41,18 @@ extern "C"
 #include <wlr/util/transform.h>
 #include <wlr/types/wlr_screencopy_v1.h>
 #include <wlr/types/wlr_export_dmabuf_v1.h>
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
+#include <wlr/types/wlr_linux_drm_syncobj_v1.h>
+#include <wlr/render/drm_syncobj.h>
 #include <wlr/types/wlr_keyboard_shortcuts_inhibit_v1.h>
 
+#if  __has_include(<tearing-control-v1-protocol.h>)
+    #include <wlr/types/wlr_tearing_control_v1.h>
+#endif
+#if  __has_include(<content-type-v1-protocol.h>)
+    #include <wlr/types/wlr_content_type_v1.h>
+#endif
+
 // Shells
 #if  __has_include(<xdg-shell-protocol.h>)
     #include <wlr/types/wlr_xdg_shell.h>
@@ -99,6 +109,7 @@ extern "C"
 // Output management
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_output_management_v1.h>
+#include <wlr/types/wlr_output_swapchain_manager.h>
 
 #if __has_include(<wlr-output-power-management-unstable-v1-protocol.h>)
     #include <wlr/types/wlr_output_power_management_v1.h>
@@ -124,6 +135,7 @@ extern "C"
 #include <wlr/types/wlr_xcursor_manager.h>
 #include <wlr/types/wlr_pointer_gestures_v1.h>
 #include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/interfaces/wlr_output.h>
 #include <wlr/types/wlr_touch.h>
 #include <wlr/types/wlr_pointer_gestures_v1.h>
 #include <wlr/xcursor.h>
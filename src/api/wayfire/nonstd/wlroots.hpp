@@ -20,6 +20,8 @@ extern "C"
     struct wlr_gamma_control_manager_v1;
     struct wlr_xdg_output_manager_v1;
     struct wlr_export_dmabuf_manager_v1;
+    struct wlr_linux_dmabuf_v1;
+    struct wlr_linux_drm_syncobj_manager_v1;
     struct wlr_server_decoration_manager;
     struct wlr_input_inhibit_manager;
     struct wlr_idle_inhibit_manager_v1;
@@ -9,6 +9,9 @@
 #include <wayfire/nonstd/wlroots.hpp>
 
 #include <wayfire/geometry.hpp>
+#include <functional>
+#include <string>
+#include <vector>
 
 #define GLM_FORCE_RADIANS
 #include <glm/mat4x4.hpp>
@@ -98,12 +101,39 @@ struct render_target_t : public framebuffer_t
      * other framebuffer transformations, if has_nonstandard_transform is set */
     glm::mat4 transform = glm::mat4(1.0);
 
+    // The exact logical geometry, if the render target is not aligned to logical pixels (see transformed()).
+    // In that case, @geometry is the smallest box containing it.
+    std::optional<wlr_fbox> exact_geometry;
+
+    // If set, nothing outside of this box is painted: it is applied as a scissor by render_begin() and
+    // logic_scissor(). In framebuffer coordinates, (0,0) is top-left.
+    std::optional<wlr_box> framebuffer_clip;
+
+    // The opacity of the content rendered to the target. It is set by transformers which render their
+    // children directly, and applied by the render instances which support it, see
+    // render_instance_t::get_alpha_layer_count().
+    float alpha = 1.0;
+
     /**
      * Get a render target which is the same as this, but whose geometry is
      * translated by @offset.
      */
     render_target_t translated(wf::point_t offset) const;
 
+    /**
+     * Get a render target for content which is scaled by @scale and then translated by @offset, that is,
+     * whose logical point p ends up at p * scale + offset in this render target.
+     *
+     * Transformers use it to render their children directly, instead of through an auxiliary buffer.
+     */
+    render_target_t transformed(double scale, wf::pointf_t offset) const;
+
+    /**
+     * Get a render target which is the same as this, but which does not paint outside of the given box
+     * (in logical coordinates), see @framebuffer_clip.
+     */
+    render_target_t clipped(wf::geometry_t box) const;
+
     /**
      * Get the geometry of the given box after projecting it onto the framebuffer.
      * In the values returned, (0,0) is top-left.
@@ -196,6 +226,8 @@ namespace OpenGL
  * and render_end() */
 void render_begin(); // use if you just want to bind GL context but won't draw
 void render_begin(const wf::framebuffer_t& fb);
+/* Same as above, but also applies the clip of the render target, if any */
+void render_begin(const wf::render_target_t& target);
 void render_begin(int32_t viewport_width, int32_t viewport_height, uint32_t fb);
 
 /* Call this to indicate an end of the rendering.
@@ -283,6 +315,171 @@ void render_texture(wf::texture_t texture,
     glm::vec4 color = glm::vec4(1.f),
     uint32_t bits   = 0);
 
+/**
+ * Statistics of the pool of released framebuffers, see core/framebuffer_pool_budget.
+ */
+struct framebuffer_pool_stats_t
+{
+    /* The amount of memory held by the pooled framebuffers, in bytes. */
+    uint64_t pooled_bytes   = 0;
+    uint64_t pooled_buffers = 0;
+    /* Number of allocations which could (not) reuse a pooled framebuffer. */
+    uint64_t hits   = 0;
+    uint64_t misses = 0;
+    /* Number of pooled framebuffers freed because the pool grew beyond its budget. */
+    uint64_t evictions = 0;
+};
+
+framebuffer_pool_stats_t get_framebuffer_pool_stats();
+
+/**
+ * The owner GPU memory is attributed to. Empty fields are unknown.
+ */
+struct gpu_memory_owner_t
+{
+    /* The plugin or subsystem, for example "blur" or "postprocessing". */
+    std::string name;
+    /* The id of the view the memory is used for, or 0. */
+    uint32_t view_id = 0;
+    /* The name of the output the memory is used for. */
+    std::string output;
+};
+
+/**
+ * While a scope is alive, the GPU memory allocated by framebuffer_t::allocate() and by the texture upload
+ * helpers is attributed to its owner. Scopes can be nested, fields left empty by the innermost scope are
+ * taken from the outer ones, so that e.g. a plugin only has to name itself while the render manager
+ * provides the output.
+ *
+ * The owner is described lazily, only when memory is actually allocated, so scopes are cheap enough to be
+ * opened on every frame.
+ */
+class gpu_memory_scope_t
+{
+  public:
+    gpu_memory_scope_t(std::function<gpu_memory_owner_t()> describe_owner);
+    ~gpu_memory_scope_t();
+
+    gpu_memory_scope_t(const gpu_memory_scope_t&) = delete;
+    gpu_memory_scope_t& operator =(const gpu_memory_scope_t&) = delete;
+
+  private:
+    std::function<gpu_memory_owner_t()> describe_owner;
+    friend gpu_memory_owner_t get_current_gpu_memory_owner();
+};
+
+/** @return The owner described by the current scopes. */
+gpu_memory_owner_t get_current_gpu_memory_owner();
+
+/**
+ * Record that @tex holds @bytes of GPU memory, owned by the owner of the current scopes. If no scope names
+ * an owner, @fallback_name is used. Recording an already tracked texture updates its size and owner.
+ * Textures which are not allocated through framebuffer_t should be tracked with this by their users.
+ */
+void track_gpu_memory(GLuint tex, uint64_t bytes, const char *fallback_name = "unknown");
+
+/** Forget the GPU memory of @tex, called when the texture is deleted. */
+void untrack_gpu_memory(GLuint tex);
+
+/**
+ * The GPU memory attributed to one owner.
+ */
+struct gpu_memory_usage_t
+{
+    gpu_memory_owner_t owner;
+    uint64_t bytes    = 0;
+    uint64_t textures = 0;
+};
+
+/** @return The tracked GPU memory per owner, largest first. */
+std::vector<gpu_memory_usage_t> get_gpu_memory_usage();
+
+/**
+ * An auxiliary buffer which can be released while it is not used and recreated once it is needed again, for
+ * example the inner_content of a transformer. Its owner calls mark_used() whenever it uses the buffer.
+ *
+ * Buffers which have not been used for core/buffer_reclaim_frames frames are released with the callback
+ * given to the constructor, and when the system runs low on memory, all buffers which were not used in the
+ * last frame of each output are released. The callback is called outside of the rendering of a frame.
+ */
+class reclaimable_buffer_t
+{
+  public:
+    reclaimable_buffer_t(std::function<void()> release);
+    ~reclaimable_buffer_t();
+
+    reclaimable_buffer_t(const reclaimable_buffer_t&) = delete;
+    reclaimable_buffer_t& operator =(const reclaimable_buffer_t&) = delete;
+
+    /** Record that the buffer is allocated and used in the current frame. */
+    void mark_used();
+
+  private:
+    std::function<void()> release;
+    uint64_t last_used = 0;
+    // Whether the buffer is allocated, i.e. it was used since it was last released.
+    bool allocated = false;
+    friend void reclaim_buffers(uint64_t max_idle_frames);
+};
+
+/**
+ * Release the reclaimable buffers which have not been used during the last @max_idle_frames frames, counting
+ * the frames of all outputs. With @max_idle_frames = 1, all buffers not used in the last frame are released.
+ */
+void reclaim_buffers(uint64_t max_idle_frames);
+
+/** Free the framebuffers kept in the pool of released framebuffers. */
+void clear_framebuffer_pool();
+
+/**
+ * Statistics of the checks done by GL_CALL and the GL helpers, see core/gl_error_check_period and
+ * core/gl_state_tracking. Counters accumulate until reset_gl_check_stats() is called.
+ */
+struct gl_check_stats_t
+{
+    /* Number of frames painted, and how many of them were checked for errors / tracked for state changes. */
+    uint64_t frames = 0;
+    uint64_t checked_frames = 0;
+    uint64_t tracked_frames = 0;
+
+    /* Number of glGetError() calls, the errors they returned, and errors not logged because their call site
+     * had already reported one. */
+    uint64_t checked_calls = 0;
+    uint64_t errors = 0;
+    uint64_t suppressed_errors = 0;
+
+    /* State changes done by the GL helpers in tracked frames, and how many of them did not change anything. */
+    uint64_t program_binds = 0;
+    uint64_t redundant_program_binds = 0;
+    uint64_t texture_binds = 0;
+    uint64_t redundant_texture_binds = 0;
+    uint64_t framebuffer_binds = 0;
+    uint64_t redundant_framebuffer_binds = 0;
+    uint64_t uniform_sets = 0;
+    uint64_t redundant_uniform_sets = 0;
+};
+
+gl_check_stats_t get_gl_check_stats();
+
+/** Reset the statistics, and let call sites which already reported an error report again. */
+void reset_gl_check_stats();
+
+/**
+ * Create a sync file which is signalled when the GL commands submitted so far have completed.
+ *
+ * @return The file descriptor of the sync file, owned by the caller, or -1 if the driver does not support
+ *   native fences (EGL_ANDROID_native_fence_sync).
+ */
+int export_render_fence();
+
+/**
+ * Make the GPU wait until the given sync file is signalled before executing the GL commands submitted
+ * afterwards. The CPU does not wait. Takes ownership of @fd.
+ *
+ * @return Whether the wait could be inserted.
+ */
+bool wait_sync_file(int fd);
+
 /**
  * Render the textured rectangle again.
  *
@@ -290,6 +487,23 @@ void render_texture(wf::texture_t texture,
  */
 void draw_cached();
 
+/**
+ * Render the cached textured rectangle once more, clipped to the rectangles of
+ * @region, with a single draw call. This avoids setting a scissor box and
+ * issuing a separate draw call for each damaged rectangle.
+ *
+ * The rectangles are rounded to framebuffer pixels and clipped to the
+ * framebuffer_clip of @target, so exactly the pixels are painted which
+ * logic_scissor() with each rectangle would allow.
+ *
+ * The region is in the logical coordinates of @target. The quad's
+ * transformation matrix must be the orthographic projection of @target
+ * (which may include the output rotation), it may not be distorted further.
+ *
+ * See RENDER_FLAG_CACHED for detailed explanation.
+ */
+void draw_cached_region(const wf::render_target_t& target, const wf::region_t& region);
+
 /**
  * Clear the cached state.
  *
@@ -317,6 +531,39 @@ GLuint compile_program(std::string vertex_source, std::string frag_source);
  */
 void render_rectangle(wf::geometry_t box, wf::color_t color, glm::mat4 matrix);
 
+/**
+ * A batch of solid-color rectangles, rendered with a single draw call.
+ *
+ * Rectangles can be clipped to a region (typically the damage), which is done when they are added, so that
+ * no scissor changes are needed while rendering. Overlapping rectangles are blended in the order they were
+ * added, like with render_rectangle().
+ */
+class rectangle_batch_t
+{
+  public:
+    /** Add a rectangle with a premultiplied color. */
+    void add(wf::geometry_t box, wf::color_t color);
+
+    /** Add the parts of the rectangle inside the given region. */
+    void add(wf::geometry_t box, wf::color_t color, const wf::region_t& clip);
+
+    /** @return true if there is nothing to render. */
+    bool empty() const;
+
+    /** Remove all rectangles from the batch. */
+    void clear();
+
+    /**
+     * Render all rectangles in the batch with the given matrix. Must be called between render_begin() and
+     * render_end(), the batch is not cleared afterwards.
+     */
+    void render(glm::mat4 matrix) const;
+
+  private:
+    // Six vertices (two triangles) per rectangle, each with a position and a color.
+    std::vector<GLfloat> vertices;
+};
+
 /**
  * An OpenGL program for rendering texture_t.
  * It contains multiple programs for the different texture types.
@@ -373,6 +620,23 @@ class program_t
     /** @return The program ID for the given texture type, or 0 on failure */
     int get_program_id(wf::texture_type_t type);
 
+    /**
+     * The location of a uniform or an attribute, resolved for the programs of
+     * all texture types at once. Using locations instead of names avoids
+     * looking up the name every time a value is set.
+     *
+     * Locations stay valid until the program is recompiled or freed.
+     */
+    struct location_t
+    {
+        int loc[wf::TEXTURE_TYPE_ALL];
+    };
+
+    /** Resolve the location of a uniform for all texture types. */
+    location_t get_uniform_location(const std::string& name);
+    /** Resolve the location of an attribute for all texture types. */
+    location_t get_attrib_location(const std::string& name);
+
     /** Set the given uniform for the currently used program. */
     void uniform1i(const std::string& name, int value);
     /** Set the given uniform for the currently used program. */
@@ -386,6 +650,19 @@ class program_t
     /** Set the given uniform for the currently used program. */
     void uniformMatrix4f(const std::string& name, const glm::mat4& value);
 
+    /** Set the given uniform for the currently used program. */
+    void uniform1i(const location_t& uniform, int value);
+    /** Set the given uniform for the currently used program. */
+    void uniform1f(const location_t& uniform, float value);
+    /** Set the given uniform for the currently used program. */
+    void uniform2f(const location_t& uniform, float x, float y);
+    /** Set the given uniform for the currently used program. */
+    void uniform3f(const location_t& uniform, float x, float y, float z);
+    /** Set the given uniform for the currently used program. */
+    void uniform4f(const location_t& uniform, const glm::vec4& value);
+    /** Set the given uniform for the currently used program. */
+    void uniformMatrix4f(const location_t& uniform, const glm::mat4& value);
+
     /*
      * Set the attribute pointer and active the attribute.
      *
@@ -396,6 +673,10 @@ class program_t
     void attrib_pointer(const std::string& attrib,
         int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
 
+    /** Same as attrib_pointer() above, but with a resolved attribute location. */
+    void attrib_pointer(const location_t& attrib,
+        int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
+
     /*
      * Set the attrib divisor. Analogous to glVertexAttribDivisor().
      *
@@ -53,4 +53,102 @@ class option_wrapper_t : public base_option_wrapper_t<Type>
         return wf::get_core().config.get_option(name);
     }
 };
+
+/**
+ * A config option for per-frame and per-event code. The value is copied whenever the option is updated, so
+ * reading it is a plain load, without going through the option object.
+ *
+ * Unlike option_wrapper_t, the value is returned by reference: compare strings with value() == "...".
+ */
+template<class Type>
+class cached_option_t
+{
+  public:
+    cached_option_t()
+    {}
+
+    cached_option_t(const std::string& option_name)
+    {
+        load_option(option_name);
+    }
+
+    /** Cache the value of an option which is not (necessarily) part of the config. */
+    explicit cached_option_t(std::shared_ptr<config::option_t<Type>> option)
+    {
+        set_option(std::move(option));
+    }
+
+    ~cached_option_t()
+    {
+        set_option(nullptr);
+    }
+
+    cached_option_t(const cached_option_t&) = delete;
+    cached_option_t(cached_option_t&&) = delete;
+    cached_option_t& operator =(const cached_option_t&) = delete;
+    cached_option_t& operator =(cached_option_t&&) = delete;
+
+    void load_option(const std::string& option_name)
+    {
+        auto raw   = wf::get_core().config.get_option(option_name);
+        auto typed = std::dynamic_pointer_cast<config::option_t<Type>>(raw);
+        if (!typed)
+        {
+            detail::option_wrapper_debug_message(option_name,
+                std::runtime_error(raw ? "Invalid option type" : "No such option"));
+        }
+
+        set_option(std::move(typed));
+    }
+
+    /** Set a callback to be run after the cached value has been updated. */
+    void set_callback(std::function<void()> callback)
+    {
+        this->callback = std::move(callback);
+    }
+
+    const Type& value() const
+    {
+        return cached;
+    }
+
+    operator const Type&() const
+    {
+        return cached;
+    }
+
+    std::shared_ptr<config::option_t<Type>> raw_option() const
+    {
+        return option;
+    }
+
+  private:
+    std::shared_ptr<config::option_t<Type>> option;
+    Type cached{};
+    std::function<void()> callback;
+
+    config::option_base_t::updated_callback_t on_updated = [=] ()
+    {
+        cached = option->get_value();
+        if (callback)
+        {
+            callback();
+        }
+    };
+
+    void set_option(std::shared_ptr<config::option_t<Type>> new_option)
+    {
+        if (option)
+        {
+            option->rem_updated_handler(&on_updated);
+        }
+
+        option = std::move(new_option);
+        if (option)
+        {
+            option->add_updated_handler(&on_updated);
+            cached = option->get_value();
+        }
+    }
+};
 }
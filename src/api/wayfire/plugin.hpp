@@ -91,6 +91,19 @@ class plugin_interface_t
         return 0;
     }
 
+    /**
+     * A plugin which is not needed right away and whose init() is expensive, for example because it compiles
+     * shaders or loads images, can request that its init() is deferred until the first frame has been shown
+     * after startup. Plugins loaded later, for example after the plugin list changes, are initialized
+     * immediately.
+     *
+     * Note that the plugin has no bindings and receives no signals until it is initialized.
+     */
+    virtual bool defer_init() const
+    {
+        return false;
+    }
+
     virtual ~plugin_interface_t() = default;
 };
 }
@@ -105,7 +118,7 @@ class plugin_interface_t
 using wayfire_plugin_load_func = wf::plugin_interface_t * (*)();
 
 /** The version of Wayfire's API/ABI */
-constexpr uint32_t WAYFIRE_API_ABI_VERSION = 2024'12'20;
+constexpr uint32_t WAYFIRE_API_ABI_VERSION = 2026'10'14;
 
 /**
  * Each plugin must also provide a function which returns the Wayfire API/ABI
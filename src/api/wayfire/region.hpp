@@ -12,6 +12,8 @@ struct region_t
     /* Makes a copy of the given region */
     region_t(pixman_region32_t *damage);
     region_t(const wlr_box& box);
+    /* Makes a region out of the given boxes, which may overlap. Empty boxes are ignored. */
+    region_t(const pixman_box32_t *boxes, int count);
     ~region_t();
 
     region_t(const region_t& other);
@@ -24,6 +26,14 @@ struct region_t
     void clear();
 
     void expand_edges(int amount);
+
+    /**
+     * Merge the rectangles of the region until it consists of at most @max_boxes rectangles.
+     * The resulting region always contains the original region.
+     *
+     * @return The area (in pixels) which was added to the region by merging.
+     */
+    int64_t simplify(int max_boxes);
     pixman_box32_t get_extents() const;
     bool contains_point(const point_t& point) const;
     bool contains_pointf(const pointf_t& point) const;
@@ -68,6 +78,30 @@ struct region_t
      * won't let us pass a const pixman_region32_t* */
     pixman_region32_t *unconst() const;
 };
+
+/**
+ * Bulk operations on arrays of boxes, for example the rectangles of a damage region. They process all
+ * coordinates of a box at once with the vector extensions of the compiler (SSE or NEON instructions).
+ */
+
+/** A 2D affine transformation, mapping (x, y) to (xx * x + xy * y + x0, yx * x + yy * y + y0). */
+struct affine_2d_t
+{
+    double xx, xy, x0;
+    double yx, yy, y0;
+};
+
+/** Intersect each box with @clip. Boxes which do not intersect @clip become empty. */
+void intersect_boxes(pixman_box32_t *boxes, size_t count, const pixman_box32_t& clip);
+
+/**
+ * Translate each box by @offset, then scale it by @scale. The result is rounded outwards, like the result of
+ * scaling a wf::geometry_t.
+ */
+void scale_boxes(pixman_box32_t *boxes, size_t count, double scale, wf::pointf_t offset = {0, 0});
+
+/** Replace each box by the bounding box of its image under @transform, rounded outwards. */
+void transform_boxes(pixman_box32_t *boxes, size_t count, const affine_2d_t& transform);
 }
 
 wlr_box wlr_box_from_pixman_box(const pixman_box32_t& box);
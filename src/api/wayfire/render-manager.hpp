@@ -4,6 +4,11 @@
 #include <wayfire/object.hpp>
 #include <wayfire/region.hpp>
 
+namespace OpenGL
+{
+class program_t;
+}
+
 namespace wf
 {
 /* Effect hooks provide the plugins with a way to execute custom code
@@ -45,6 +50,50 @@ enum output_effect_type_t
 using post_hook_t = std::function<void (const wf::framebuffer_t& source,
     const wf::framebuffer_t& destination)>;
 
+/**
+ * A postprocessing effect which computes each pixel only from the color of the same pixel in its source, for
+ * example color inversion or a color filter.
+ *
+ * In contrast to post hooks, color effects do not render a pass of their own: consecutive color effects are
+ * fused into a single generated shader, which processes the output image in one pass. If all post effects of
+ * an output are color effects, only the damaged parts of the output are processed each frame, so an effect
+ * whose parameters change has to damage the output.
+ */
+struct post_color_effect_t
+{
+    /**
+     * The GLSL (version 100) source of the effect. It has to define the function
+     * `mediump vec4 EFFECT(mediump vec4 color)`, which returns the processed color, and may declare uniforms
+     * and helper functions.
+     *
+     * Each occurrence of EFFECT is replaced with a name unique to the effect inside the fused shader, so the
+     * names of uniforms and helpers should start with EFFECT as well, for ex. EFFECT_strength. The source
+     * should not change while the effect is added.
+     */
+    std::string source;
+
+    /**
+     * Called with the fused program active before each pass, to set the uniforms of the effect.
+     *
+     * @param program The fused program.
+     * @param prefix The name with which EFFECT was replaced in the source.
+     */
+    std::function<void (OpenGL::program_t& program, const std::string& prefix)> set_uniforms;
+
+    /**
+     * Effects may also move pixels within a bounded area of the output, for example a magnifier around the
+     * cursor. Such effects set @warp and additionally define `highp vec2 EFFECT_warp(highp vec2 pos)`, which
+     * returns the position in the source from which the pixel at @pos is taken. Positions are in framebuffer
+     * pixels with (0,0) at the bottom-left corner, like gl_FragCoord.
+     *
+     * Outside of its area, the warp has to return @pos unchanged, and inside of it, it may only return
+     * positions in the area. Since only the damaged parts of the output are processed, the effect has to
+     * damage its whole area when the area moves or changes, and whenever the scene damages a part of it
+     * (see output_scene_damage_signal).
+     */
+    bool warp = false;
+};
+
 /**
  * The frame-done signal is emitted on an output when the frame has been completed (regardless of whether new
  * content was painted or not).
@@ -52,6 +101,125 @@ using post_hook_t = std::function<void (const wf::framebuffer_t& source,
 struct frame_done_signal
 {};
 
+/**
+ * The output-scene-damage signal is emitted on an output whenever the scenegraph damages a part of it, before
+ * the damage is added to the next frame. The region is in the coordinate system of the scenegraph root.
+ *
+ * It can be used by render instances which cache rendered content and need to know which parts of the output
+ * have changed.
+ */
+struct output_scene_damage_signal
+{
+    const wf::region_t *region;
+};
+
+/**
+ * The stages of repainting an output which are measured by the frame profiler.
+ */
+enum frame_stage_t
+{
+    /* Running pre and damage hooks and acquiring the next buffer */
+    FRAME_STAGE_UPDATE      = 0,
+    /* Generating render instructions from the render instances */
+    FRAME_STAGE_SCHEDULE    = 1,
+    /* Executing the render instructions (CPU time only) */
+    FRAME_STAGE_RENDER      = 2,
+    /* Overlay hooks, postprocessing effects and software cursors */
+    FRAME_STAGE_POSTPROCESS = 3,
+    /* Submitting the render pass and committing the output state */
+    FRAME_STAGE_SWAP        = 4,
+    /* Time the GPU spent on the frame, measured with timer queries */
+    FRAME_STAGE_GPU         = 5,
+    /* Invalid stage, used internally */
+    FRAME_STAGE_TOTAL       = 6,
+};
+
+/**
+ * Rolling statistics over the most recently rendered frames of an output.
+ * All times are in microseconds.
+ */
+struct frame_stats_t
+{
+    struct stage_stats_t
+    {
+        int64_t p50 = 0;
+        int64_t p95 = 0;
+        int64_t p99 = 0;
+        int64_t max = 0;
+        /* The number of frames for which the stage was measured. */
+        uint64_t samples = 0;
+    };
+
+    /* The total number of frames rendered since the output was created. */
+    uint64_t total_frames = 0;
+    /* Whether GPU times are available (requires GL_EXT_disjoint_timer_query). */
+    bool gpu_timer_supported = false;
+    stage_stats_t stages[FRAME_STAGE_TOTAL];
+
+    /* The current repaint delay in milliseconds. */
+    int repaint_delay = 0;
+    /* Predicted time to paint and commit a frame, including the safety margin.
+     * Only set when the predictive repaint scheduling policy is used. */
+    int64_t predicted_render_us = 0;
+    /* Time between committing the last frame and the vblank it was scheduled for.
+     * Negative if the frame was late. */
+    int64_t last_margin_us    = 0;
+    int64_t average_margin_us = 0;
+    /* The number of frames committed after the vblank they were scheduled for. */
+    uint64_t late_frames = 0;
+
+    /* The number of frames whose damage was merged because of core/damage_max_rectangles. */
+    uint64_t damage_simplified_frames = 0;
+    /* The total area in pixels which was added to the damage by merging. */
+    int64_t damage_simplify_added_area = 0;
+
+    /* The number of frames rendered only because software cursors were moved or changed. */
+    uint64_t cursor_only_frames = 0;
+    /* The number of commits which updated the hardware cursor without rendering a frame. */
+    uint64_t cursor_plane_commits = 0;
+
+    /* The number of heap allocations during the last painted frame, including those of worker threads
+     * running meanwhile, or -1 if Wayfire was built without the allocation_stats option. */
+    int64_t frame_allocations = -1;
+
+    /* The number of top-level render instances of the output's scenegraph. */
+    uint64_t render_instances = 0;
+    /* Whether the last frame was directly scanned out instead of being rendered. */
+    bool direct_scanout = false;
+};
+
+/**
+ * If set on a view, overrides core/allow_tearing for the view's surfaces, e.g. to allow tearing only for
+ * selected games. Set by the window-rules plugin with `set tearing allow|deny`.
+ */
+struct view_tearing_policy_t : public wf::custom_data_t
+{
+    bool allow = false;
+};
+
+/**
+ * Results of the synthetic frame driver of an output, see render_manager::set_synthetic_frame_driver().
+ * All times are in microseconds.
+ */
+struct synthetic_frame_stats_t
+{
+    /* Whether the synthetic frame driver is running. */
+    bool running = false;
+    /* The requested frame rate, 0 means as fast as possible. */
+    int rate = 0;
+    /* The number of frames painted since the driver was started. */
+    uint64_t frames = 0;
+    /* Time since the driver was started. */
+    int64_t duration = 0;
+    /* The achieved frame rate. */
+    double fps = 0;
+    /* Distribution of the time between two consecutive frames. */
+    int64_t interval_p50 = 0;
+    int64_t interval_p95 = 0;
+    int64_t interval_p99 = 0;
+    int64_t interval_max = 0;
+};
+
 /** Render manager
  *
  * Each output has a render manager, which is responsible for all rendering
@@ -116,6 +284,21 @@ class render_manager
      */
     void rem_post(post_hook_t *hook);
 
+    /**
+     * Add a new postprocessing color effect. It runs after the post hooks added before it, and before the
+     * post hooks added after it.
+     *
+     * @param effect The effect, which has to stay valid until it is removed.
+     */
+    void add_post(post_color_effect_t *effect);
+
+    /**
+     * Remove a postprocessing color effect. No-op if the effect isn't active.
+     *
+     * @param effect The effect to be removed.
+     */
+    void rem_post(post_color_effect_t *effect);
+
     /**
      * @return The damaged region on the current output for the current
      * frame that is used when swapping buffers. This function should
@@ -178,6 +361,38 @@ class render_manager
      */
     void set_require_depth_buffer(bool require);
 
+    /**
+     * Get timing statistics for the recently rendered frames on the output.
+     * Frames which were skipped or directly scanned out are not included.
+     */
+    frame_stats_t get_frame_stats() const;
+
+    /**
+     * Start or stop driving the output's frames from Wayfire instead of the frame events of the backend.
+     * While the synthetic frame driver is running, the whole output is repainted on every frame, and the
+     * frame rate and the distribution of frame times are recorded (see get_synthetic_frame_stats()).
+     * Starting the driver again resets its statistics.
+     *
+     * This is meant for throughput benchmarks on headless outputs. Other backends cannot commit frames
+     * faster than the display refreshes.
+     *
+     * @param enabled Whether to start or stop the driver.
+     * @param rate The target frame rate in Hz, 0 means as fast as possible.
+     */
+    void set_synthetic_frame_driver(bool enabled, int rate = 0);
+
+    /**
+     * Get the results of the synthetic frame driver since it was last started.
+     */
+    synthetic_frame_stats_t get_synthetic_frame_stats() const;
+
+    /**
+     * Show or hide the damage heatmap. While it is shown, the damage of each frame is drawn over the output,
+     * on top of a decaying heatmap of the damage of the recent frames. The whole output is repainted in every
+     * frame then, and frames are rendered until the heat has decayed.
+     */
+    void set_damage_heatmap(bool enabled);
+
   public:
     class impl;
     std::unique_ptr<impl> pimpl;
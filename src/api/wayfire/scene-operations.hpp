@@ -63,18 +63,25 @@ inline bool raise_to_front(node_ptr child)
 {
     auto dyn_parent = dynamic_cast<floating_inner_node_t*>(child->parent());
     wf::dassert(dyn_parent, "Raise to front in a non-floating container!");
+    if (!dyn_parent->move_to_front(child))
+    {
+        return false;
+    }
+
+    update(dyn_parent->shared_from_this(), update_flag::REORDERED);
+    return true;
+}
 
-    auto children = dyn_parent->get_children();
-    if (children.front() == child)
+inline bool lower_to_back(node_ptr child)
+{
+    auto dyn_parent = dynamic_cast<floating_inner_node_t*>(child->parent());
+    wf::dassert(dyn_parent, "Lower to back in a non-floating container!");
+    if (!dyn_parent->move_to_back(child))
     {
         return false;
     }
 
-    children.erase(std::remove(children.begin(), children.end(), child),
-        children.end());
-    children.insert(children.begin(), child);
-    dyn_parent->set_children_list(children);
-    update(dyn_parent->shared_from_this(), update_flag::CHILDREN_LIST);
+    update(dyn_parent->shared_from_this(), update_flag::REORDERED);
     return true;
 }
 }
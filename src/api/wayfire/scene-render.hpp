@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <new>
+#include <string>
 #include <vector>
 #include <any>
 #include <wayfire/config/types.hpp>
@@ -75,6 +77,16 @@ class render_instance_t
   public:
     virtual ~render_instance_t() = default;
 
+    /**
+     * Render instances are created and destroyed in bulk whenever the scenegraph changes. To avoid going
+     * through the heap every time, the memory of destroyed instances (including those of derived classes)
+     * is kept in a pool and reused for new instances of the same size.
+     */
+    static void *operator new(std::size_t size);
+    static void operator delete(void *ptr, std::size_t size);
+    static void *operator new(std::size_t size, std::align_val_t align);
+    static void operator delete(void *ptr, std::size_t size, std::align_val_t align);
+
     /**
      * Handle the front-to-back iteration (2.) from a render pass.
      * Each instance should add the render instructions (calls to
@@ -154,6 +166,30 @@ class render_instance_t
      */
     virtual void compute_visibility(wf::output_t *output, wf::region_t& visible)
     {}
+
+    /**
+     * Check whether the render instance (and its children) can render to render targets created with
+     * render_target_t::transformed(), that is, whether it only uses the projection, scissor and scale of the
+     * render target, instead of computing framebuffer coordinates from its geometry.
+     *
+     * Transformers use this to render their children directly to the target, without an auxiliary buffer.
+     */
+    virtual bool can_render_transformed()
+    {
+        return false;
+    }
+
+    /**
+     * Get the number of surfaces the render instance (and its children) paints, if it applies the alpha of
+     * render targets (see render_target_t::alpha), or -1 if it does not.
+     *
+     * Transformers which render their children directly can apply their opacity this way only if the
+     * children paint a single surface, otherwise overlapping surfaces would show through each other.
+     */
+    virtual int get_alpha_layer_count()
+    {
+        return -1;
+    }
 };
 
 using render_instance_uptr = std::unique_ptr<render_instance_t>;
@@ -169,12 +205,48 @@ struct node_damage_signal
     wf::region_t region;
 };
 
+/**
+ * The damage reported by one node while damage attribution was enabled.
+ */
+struct node_damage_stats_t
+{
+    // The description of the node (see node_t::stringify()) when it first reported damage.
+    std::string node;
+    // The sum of the areas of the damaged regions, in the coordinate system of the node's parent.
+    uint64_t area = 0;
+    // The number of times the node reported damage.
+    uint64_t reports = 0;
+};
+
+/**
+ * Start or stop recording the damage reported by nodes via damage_node(). Used to find nodes which damage
+ * more than they should. Recording is off by default and costs nothing then. Stopping keeps the results.
+ */
+void set_damage_attribution(bool enabled);
+
+/** @return The recorded damage per node, sorted by descending area. */
+std::vector<node_damage_stats_t> get_damage_attribution();
+
+/** Drop the recorded damage of all nodes. */
+void reset_damage_attribution();
+
+namespace detail
+{
+extern bool damage_attribution_enabled;
+void record_node_damage(node_t *node, const wf::region_t& damage);
+}
+
 /**
  * A helper function to emit the damage signal on a node.
  */
 template<class NodePtr>
 inline void damage_node(NodePtr node, wf::region_t damage)
 {
+    if (detail::damage_attribution_enabled)
+    {
+        detail::record_node_damage(&*node, damage);
+    }
+
     node_damage_signal data;
     data.region = damage;
     node->emit(&data);
@@ -223,6 +295,17 @@ enum render_pass_flags
     RPASS_CLEAR_BACKGROUND = (1 << 1),
 };
 
+/**
+ * CPU time spent in the different steps of a render pass, in microseconds.
+ */
+struct render_pass_timings_t
+{
+    /** Time spent generating render instructions. */
+    int64_t schedule_us = 0;
+    /** Time spent clearing the background and executing the render instructions. */
+    int64_t render_us = 0;
+};
+
 /**
  * A struct containing the information necessary to execute a render pass.
  */
@@ -248,6 +331,11 @@ struct render_pass_params_t
      * feedback.
      */
     output_t *reference_output = nullptr;
+
+    /**
+     * If set, the time spent in the different steps of the render pass is stored here.
+     */
+    render_pass_timings_t *timings = nullptr;
 };
 
 /**
@@ -287,6 +375,19 @@ direct_scanout try_scanout_from_list(
 void compute_visibility_from_list(const std::vector<render_instance_uptr>& instances, wf::output_t *output,
     wf::region_t& region, const wf::point_t& offset);
 
+/**
+ * A helper function for can_render_transformed implementations.
+ * @return true if all instances in the list can render to transformed render targets.
+ */
+bool can_render_transformed_list(const std::vector<render_instance_uptr>& instances);
+
+/**
+ * A helper function for get_alpha_layer_count implementations.
+ * @return The total number of surfaces painted by the instances in the list, or -1 if one of them does not
+ *   apply the alpha of render targets.
+ */
+int get_alpha_layer_count_list(const std::vector<render_instance_uptr>& instances);
+
 /**
  * A helper class for easier implementation of render instances.
  * It automatically schedules instruction for the current node and tracks damage from the main node.
@@ -309,7 +410,7 @@ class simple_render_instance_t : public render_instance_t
         instructions.push_back(render_instruction_t{
                     .instance = this,
                     .target   = target,
-                    .damage   = damage & self->get_bounding_box(),
+                    .damage   = damage & self->get_cached_bounding_box(),
                 });
     }
 
@@ -333,6 +434,17 @@ class simple_render_instance_t : public render_instance_t
 struct node_regen_instances_signal
 {};
 
+/**
+ * Emitted on: node
+ * Emitted when the children of the node were reordered with update_flag::REORDERED. Render instances which
+ * keep the instances of the node's children in a list of their own should reorder it and set @handled,
+ * otherwise the render instances of the node are regenerated.
+ */
+struct node_reorder_instances_signal
+{
+    bool handled = false;
+};
+
 uint32_t optimize_nested_render_instances(wf::scene::node_ptr node, uint32_t flags);
 }
 }
@@ -131,6 +131,12 @@ enum update_flag
      * updates (for example regenerating render instances) are not necessary).
      */
     MASKED        = (1 << 5),
+    /**
+     * The node's children were reordered, but no child was added or removed. Render instances which keep
+     * the instances of the node's children in a list of their own reorder it in place (see
+     * node_reorder_instances_signal), otherwise the update is handled like a CHILDREN_LIST update.
+     */
+    REORDERED     = (1 << 6),
 };
 }
 
@@ -286,6 +292,27 @@ class node_t : public std::enable_shared_from_this<node_t>,
      */
     wf::geometry_t get_children_bounding_box();
 
+    /**
+     * Same as @get_bounding_box, but while a bounding box cache scope is active (see
+     * begin_bounding_box_cache()), the result is computed only once and reused until the node or one of its
+     * descendants is updated with scene::update().
+     *
+     * Outside of such a scope, this is equivalent to calling @get_bounding_box.
+     */
+    wf::geometry_t get_cached_bounding_box();
+
+    /**
+     * A counter which is increased whenever an update() to the node or its descendants requires the render
+     * instances of the node to be regenerated (i.e. a CHILDREN_LIST or ENABLED update which was not handled
+     * locally by the descendants, see optimize_update()).
+     *
+     * Render instances generated while the counter had the same value are interchangeable.
+     */
+    uint64_t get_instances_generation() const
+    {
+        return instances_generation;
+    }
+
     /**
      * Structure nodes are special nodes which core usually creates when Wayfire
      * is started (e.g. layer and output nodes). These nodes should not be
@@ -378,6 +405,18 @@ class node_t : public std::enable_shared_from_this<node_t>,
     std::vector<std::shared_ptr<node_t>> children;
 
     void set_children_unchecked(std::vector<node_ptr> new_list);
+
+  private:
+    /* Cached bounding boxes of the children used by find_node_at(), see core/hit_test_cache. */
+    struct hit_test_cache_t;
+    std::unique_ptr<hit_test_cache_t> hit_test_cache;
+    bool validate_hit_test_cache();
+
+    /* See get_cached_bounding_box(). A generation of 0 marks the cached box as dirty. */
+    wf::geometry_t cached_bounding_box = {0, 0, 0, 0};
+    uint64_t cached_bounding_box_generation = 0;
+    uint64_t instances_generation = 0;
+    friend void update(node_ptr changed_node, uint32_t flags);
 };
 
 /**
@@ -405,6 +444,16 @@ class floating_inner_node_t : public node_t
      * children is updated, and each child's parent is set to this node.
      */
     bool set_children_list(std::vector<node_ptr> new_list);
+
+    /**
+     * Move the given child to the front (the top of the stacking order) or to the back of the list of
+     * children, without touching the other children. The node should then be updated with
+     * update_flag::REORDERED.
+     *
+     * @return false if the child was already there.
+     */
+    bool move_to_front(node_ptr child);
+    bool move_to_back(node_ptr child);
 };
 using floating_inner_ptr = std::shared_ptr<floating_inner_node_t>;
 
@@ -435,6 +484,7 @@ class output_node_t : public floating_inner_node_t
 
     wf::geometry_t get_bounding_box() override;
     std::optional<input_node_t> find_node_at(const wf::pointf_t& at) override;
+    uint32_t optimize_update(uint32_t flags) override;
 
     /**
      * Get the output this node is responsible for.
@@ -494,6 +544,7 @@ class root_node_t final : public floating_inner_node_t
     root_node_t();
     virtual ~root_node_t();
     std::string stringify() const override;
+    wf::keyboard_focus_node_t keyboard_refocus(wf::output_t *output) override;
 
     /**
      * An ordered list of all layers' nodes.
@@ -523,5 +574,46 @@ void set_node_enabled(wf::scene::node_ptr node, bool enabled);
  * @param flags A bit mask consisting of flags defined in the @update_flag enum.
  */
 void update(node_ptr changed_node, uint32_t flags);
+
+/**
+ * Invalidate the cached bounding boxes which find_node_at() uses to skip views
+ * when core/hit_test_cache is enabled. This happens automatically on every
+ * update() and whenever an output is repainted, so plugins need to call this
+ * only if they change the input region of a view without doing either.
+ */
+void invalidate_hit_test_cache();
+
+/**
+ * Get the current generation of the hit-testing caches. It changes whenever
+ * invalidate_hit_test_cache() is called, so nodes with caches of their own can
+ * compare it to the generation their cache was built for.
+ */
+uint64_t get_hit_test_generation();
+
+/**
+ * Invalidate the result of the last keyboard_refocus() on the root node, which is reused when
+ * core/keyboard_refocus_cache is enabled. This happens automatically on every update(), when a node is
+ * focused or gets keyboard focus, when the workspace of an output changes, when a transaction is scheduled
+ * or a view's geometry changes, when a layer-shell surface changes its keyboard interactivity and when an
+ * exclusive client (for ex. a screen locker) is set or unset. Plugins which change the result of their
+ * nodes' keyboard_refocus() in other ways need to call this before refocusing.
+ */
+void invalidate_keyboard_refocus();
+
+/**
+ * Start a scope in which node_t::get_cached_bounding_box() may return cached results, if
+ * core/bounding_box_cache is enabled. Scopes may be nested, and each call must be matched with a call to
+ * end_bounding_box_cache().
+ *
+ * Within the scope, changes to the geometry of nodes have to be announced with scene::update(), which marks
+ * the changed node and all of its parents as dirty. Core opens a scope for every render pass and for
+ * visibility computations, during which the scenegraph is not expected to change.
+ */
+void begin_bounding_box_cache();
+
+/**
+ * End a scope started with begin_bounding_box_cache().
+ */
+void end_bounding_box_cache();
 }
 } // namespace wf
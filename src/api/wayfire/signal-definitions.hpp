@@ -5,6 +5,9 @@
 #include "wayfire/output.hpp"
 #include "wayfire/seat.hpp"
 
+#include <set>
+#include <string>
+
 /**
  * Documentation of signals emitted from core components.
  * Each signal documentation follows the following scheme:
@@ -44,6 +47,21 @@ struct core_startup_finished_signal
 struct core_shutdown_signal
 {};
 
+/**
+ * on: core
+ * when: When the system is low on memory, see core/memory_pressure_threshold and
+ *   core/memory_pressure_min_available. Core has already released the auxiliary buffers which were not used
+ *   in the last frame, plugins should drop their caches as well. Emitted at most every few seconds.
+ */
+struct memory_pressure_signal
+{
+    // The share of time in percent during which tasks stalled on memory over the last 10 seconds, or -1 if
+    // the kernel does not report it.
+    double pressure = -1;
+    // The available memory in MiB, or -1 if it is not known.
+    int64_t available_mb = -1;
+};
+
 class input_device_t;
 /**
  * on: core
@@ -190,10 +208,38 @@ struct touch_focus_changed_signal
 
 /**
  * on: core
- * when: When the config file is reloaded
+ * when: When the config file is reloaded, or options were changed via IPC.
  */
 struct reload_config_signal
-{};
+{
+    /**
+     * Whether changed_options lists all options which changed. If not, for example when the signal was
+     * emitted by a plugin, any option might have changed.
+     */
+    bool changes_known = false;
+    /** The options whose value changed, or which were added or removed, as section/option. */
+    std::set<std::string> changed_options;
+    /** The sections which contain a changed option, or which were added or removed. */
+    std::set<std::string> changed_sections;
+
+    void add_changed_option(const std::string& section, const std::string& option)
+    {
+        changed_sections.insert(section);
+        changed_options.insert(section + "/" + option);
+    }
+
+    /** @return Whether an option of the given section might have changed. */
+    bool section_changed(const std::string& section) const
+    {
+        return !changes_known || changed_sections.count(section);
+    }
+
+    /** @return Whether any option might have changed. */
+    bool any_changed() const
+    {
+        return !changes_known || !changed_sections.empty();
+    }
+};
 
 /**
  * on: core
@@ -214,7 +260,8 @@ struct seat_activity_signal
 
 /**
  * on: core
- * when: idle inhibit changed.
+ * when: idle inhibit changed. Changes of the inhibitors are collected and announced at most once per
+ *   event loop iteration, only if the resulting state differs from the previously announced one.
  */
 struct idle_inhibit_changed_signal
 {
@@ -755,6 +802,21 @@ struct view_moved_to_wset_signal
     std::shared_ptr<wf::workspace_set_t> new_wset;
 };
 
+/**
+ * on: core
+ * when: After wf::move_views_to_output() (or wf::move_view_to_output()) has moved a group of views to a new
+ *   output, for example when an output is removed and its views are transferred to another output. It is
+ *   emitted once, after the view-moved-to-wset signals of the individual views, so that plugins can handle
+ *   all views at once.
+ */
+struct views_moved_to_output_signal
+{
+    /* The views which were moved, from top to bottom */
+    std::vector<wayfire_toplevel_view> views;
+    /* The output the views were moved to */
+    wf::output_t *output;
+};
+
 /**
  * on: output
  * when: This signal is a combination of the unmapped, minimized and set-output signals. In the latter case,
@@ -4,7 +4,10 @@
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
-#include <wayfire/nonstd/safe-list.hpp>
+#include <vector>
+#include <wayfire/nonstd/compact-safe-list.hpp>
+#include <wayfire/nonstd/inline-function.hpp>
+#include <wayfire/trace.hpp>
 #include <cassert>
 #include <typeindex>
 
@@ -14,6 +17,92 @@ namespace signal
 {
 class provider_t;
 
+/**
+ * The list of providers a connection is connected to, with set semantics.
+ * Almost all connections are connected to a single provider, so a few of them are stored inline and
+ * connecting does not allocate memory.
+ */
+class provider_list_t
+{
+  public:
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    size_t size() const
+    {
+        return spilled ? overflow.size() : count;
+    }
+
+    provider_t *const *begin() const
+    {
+        return spilled ? overflow.data() : inline_items;
+    }
+
+    provider_t *const *end() const
+    {
+        return begin() + size();
+    }
+
+    void insert(provider_t *provider)
+    {
+        for (auto p : *this)
+        {
+            if (p == provider)
+            {
+                return;
+            }
+        }
+
+        if (spilled)
+        {
+            overflow.push_back(provider);
+        } else if (count < INLINE_ITEMS)
+        {
+            inline_items[count++] = provider;
+        } else
+        {
+            overflow.assign(inline_items, inline_items + count);
+            overflow.push_back(provider);
+            spilled = true;
+        }
+    }
+
+    void erase(provider_t *provider)
+    {
+        if (spilled)
+        {
+            for (size_t i = 0; i < overflow.size(); i++)
+            {
+                if (overflow[i] == provider)
+                {
+                    overflow.erase(overflow.begin() + i);
+                    return;
+                }
+            }
+
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (inline_items[i] == provider)
+            {
+                inline_items[i] = inline_items[--count];
+                return;
+            }
+        }
+    }
+
+  private:
+    static constexpr size_t INLINE_ITEMS = 2;
+    provider_t *inline_items[INLINE_ITEMS];
+    size_t count = 0;
+    bool spilled = false;
+    std::vector<provider_t*> overflow;
+};
+
 /**
  * A base class for all connection_t, needed to store list of connections in a
  * type-safe way.
@@ -48,7 +137,7 @@ class connection_base_t
 
     // Allow provider to deregister itself
     friend class provider_t;
-    std::unordered_set<provider_t*> connected_to;
+    provider_list_t connected_to;
 };
 
 /**
@@ -93,10 +182,24 @@ class connection_t final : public connection_base_t
         set_callback(callback);
     }
 
-    /** Set the signal callback or override the existing signal callback. */
-    void set_callback(callback cb)
+    /**
+     * Set the signal callback or override the existing signal callback.
+     * Callables of up to 48 bytes (a lambda capturing up to six pointers) are stored without allocating.
+     */
+    template<class T>
+    void set_callback(const T& cb)
     {
-        this->current_callback = cb;
+        if constexpr (std::is_constructible_v<bool, const T&>)
+        {
+            // Empty std::function objects or null function pointers
+            if (!cb)
+            {
+                current_callback.reset();
+                return;
+            }
+        }
+
+        this->current_callback.assign(cb);
     }
 
     /** Call the stored callback with the given data. */
@@ -117,7 +220,7 @@ class connection_t final : public connection_base_t
     connection_t& operator =(const connection_t&) = delete;
     connection_t& operator =(connection_t&&) = delete;
 
-    callback current_callback;
+    wf::inline_function_t<void(SignalType*)> current_callback;
 };
 
 class provider_t
@@ -137,7 +240,15 @@ class provider_t
     template<class SignalType>
     void connect(connection_t<SignalType> *callback)
     {
-        typed_connections[index<SignalType>()].push_back(callback);
+        auto connections = find_connections(index<SignalType>());
+        if (!connections)
+        {
+            typed_connections.push_back({index<SignalType>(),
+                std::make_unique<wf::compact_safe_list_t<connection_base_t*>>()});
+            connections = typed_connections.back().connections.get();
+        }
+
+        connections->push_back(callback);
         callback->connected_to.insert(this);
     }
 
@@ -145,9 +256,9 @@ class provider_t
     void disconnect(connection_base_t *callback)
     {
         callback->connected_to.erase(this);
-        for (auto& [id, connected] : typed_connections)
+        for (auto& entry : typed_connections)
         {
-            connected.remove_all(callback);
+            entry.connections->remove_all(callback);
         }
     }
 
@@ -155,12 +266,24 @@ class provider_t
     template<class SignalType>
     void emit(SignalType *data)
     {
-        auto& conns = typed_connections[std::type_index(typeid(SignalType))];
-        conns.for_each([&] (connection_base_t *tc)
+        // Most providers have no connections at all for most signals, bail out early in that case.
+        if (typed_connections.empty())
         {
-            auto real_type = dynamic_cast<connection_t<SignalType>*>(tc);
-            assert(real_type);
-            real_type->emit(data);
+            return;
+        }
+
+        auto conns = find_connections(index<SignalType>());
+        if (!conns)
+        {
+            return;
+        }
+
+        WF_TRACE_ZONE_SAMPLED("signal emit", 64);
+        conns->for_each([&] (connection_base_t *tc)
+        {
+            // Connections are stored by their signal type, so the cast is always valid.
+            assert(dynamic_cast<connection_t<SignalType>*>(tc));
+            static_cast<connection_t<SignalType>*>(tc)->emit(data);
         });
     }
 
@@ -169,9 +292,9 @@ class provider_t
 
     ~provider_t()
     {
-        for (auto& [id, connected] : typed_connections)
+        for (auto& entry : typed_connections)
         {
-            connected.for_each([&] (connection_base_t *base)
+            entry.connections->for_each([&] (connection_base_t *base)
             {
                 base->connected_to.erase(this);
             });
@@ -193,8 +316,32 @@ class provider_t
         return std::type_index(typeid(SignalType));
     }
 
-    std::unordered_map<std::type_index, wf::safe_list_t<connection_base_t*>>
-    typed_connections;
+    /**
+     * Providers typically have connections for only a handful of signal types, so a flat list is faster to
+     * search than a hash map, and comparing type_index values is cheaper than hashing them.
+     * The lists are heap-allocated so that they do not move when a new signal type is connected during
+     * emission of another signal.
+     */
+    struct typed_connections_t
+    {
+        std::type_index id;
+        std::unique_ptr<wf::compact_safe_list_t<connection_base_t*>> connections;
+    };
+
+    wf::compact_safe_list_t<connection_base_t*> *find_connections(const std::type_index& id)
+    {
+        for (auto& entry : typed_connections)
+        {
+            if (entry.id == id)
+            {
+                return entry.connections.get();
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::vector<typed_connections_t> typed_connections;
 };
 }
 }
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wf
+{
+class output_t;
+
+/**
+ * The startup profile records a timeline of the steps taken while the compositor starts: creating the
+ * backend and renderer, enabling outputs, loading and initializing plugins, launching Xwayland, spawning
+ * the autostart programs and presenting the first frame on each output.
+ *
+ * Recording stops when every output has presented its first frame after startup, or a few seconds after
+ * startup at the latest. At that point, if the environment variable WAYFIRE_STARTUP_TRACE is set to a file
+ * path, the timeline is written there in the Trace Event Format, which can be opened in chrome://tracing or
+ * Perfetto. The timeline is also available via the IPC method wayfire/startup-profile.
+ */
+namespace startup_profile
+{
+struct event_t
+{
+    // The subsystem which the step belongs to, for example core, output or plugin.
+    std::string category;
+    std::string name;
+    // The start of the step, in microseconds since the compositor process started.
+    int64_t start_us;
+    // The duration of the step in microseconds, zero for events which mark a point in time.
+    int64_t duration_us;
+};
+
+using clock = std::chrono::steady_clock;
+
+/** @return The time since the compositor process started, in milliseconds. */
+double get_uptime_ms();
+
+/** @return Whether startup steps are still being recorded. */
+bool is_recording();
+
+/** Record an event which marks a point in time. */
+void mark(const std::string& category, const std::string& name);
+
+/** Record a step which started at @start and ends now. */
+void record(const std::string& category, const std::string& name, clock::time_point start);
+
+/** Records the step which takes as long as the lifetime of the scope object. */
+class scope_t
+{
+  public:
+    scope_t(std::string category, std::string name) :
+        category(std::move(category)), name(std::move(name)), start(clock::now())
+    {}
+
+    ~scope_t()
+    {
+        record(category, name, start);
+    }
+
+    scope_t(const scope_t&) = delete;
+    scope_t& operator =(const scope_t&) = delete;
+
+  private:
+    std::string category;
+    std::string name;
+    clock::time_point start;
+};
+
+/**
+ * Record the first frame presented on @output. Called by the render manager of each output once. When all
+ * outputs have presented a frame after startup has finished, recording stops.
+ */
+void mark_first_frame(wf::output_t *output);
+
+/** Called by core when startup has finished, to stop recording at the latest after a timeout. */
+void startup_finished();
+
+/** Stop recording and write the trace file, if requested. Does nothing if recording already stopped. */
+void finish();
+
+/** @return The recorded events, in the order they ended. */
+const std::vector<event_t>& get_events();
+}
+}
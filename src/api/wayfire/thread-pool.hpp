@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+struct wl_event_loop;
+
+namespace wf
+{
+/**
+ * A pool of worker threads shared by core and plugins, for CPU-heavy work which would otherwise block the
+ * compositor's event loop: decoding images, physics simulation, serialization, etc.
+ *
+ * Each worker has its own queue of tasks, and idle workers steal tasks from the queues of the others. By
+ * default, there is one worker for each CPU the compositor may run on, minus one for the main thread. The
+ * CPU affinity and the cgroup CPU quota of the compositor are taken into account, and the count can be set
+ * with core/worker_threads.
+ *
+ * Work is submitted either with parallel_for(), which blocks until it is done, or asynchronously through
+ * a task_group_t, whose completions are run on the main loop.
+ */
+class thread_pool_t
+{
+  public:
+    /**
+     * Create a pool with the given number of workers (0 to size the pool automatically). Completions are
+     * dispatched on @loop.
+     */
+    thread_pool_t(wl_event_loop *loop, size_t workers = 0);
+    ~thread_pool_t();
+
+    thread_pool_t(const thread_pool_t&) = delete;
+    thread_pool_t& operator =(const thread_pool_t&) = delete;
+
+    /** Get the compositor's thread pool. */
+    static thread_pool_t& get();
+
+    /** @return The number of worker threads. */
+    size_t get_worker_count() const;
+
+    /**
+     * Run fn(i) for each i in [0, count) on the workers and the calling thread, and return once all calls
+     * are done. The calls may run in any order and in parallel, so they must not depend on each other.
+     *
+     * This is meant for work which is needed right away, for example stepping simulations before a frame.
+     * It may be called from a worker too.
+     */
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    struct impl;
+
+  private:
+    std::unique_ptr<impl> priv;
+    friend class task_group_t;
+};
+
+/**
+ * A group of asynchronous tasks, usually owned by a plugin or by the object which needs their results.
+ *
+ * The tasks of a group run on the workers of the pool, and once a task is done, its completion callback is
+ * run on the main loop, where it may use the compositor's state. Tasks must not use the compositor's state.
+ *
+ * Destroying the group cancels the tasks which have not started yet, waits for those which are running and
+ * drops the completions which have not run yet. In particular, a plugin which keeps its task groups as
+ * members can be unloaded at any time.
+ */
+class task_group_t
+{
+  public:
+    task_group_t(thread_pool_t& pool = thread_pool_t::get());
+    ~task_group_t();
+
+    task_group_t(const task_group_t&) = delete;
+    task_group_t& operator =(const task_group_t&) = delete;
+
+    /** Run @task on a worker, then @done (if set) on the main loop. */
+    void submit(std::function<void()> task, std::function<void()> done = {});
+
+    /** @return The number of submitted tasks whose completion has not run yet. */
+    size_t get_pending_count() const;
+
+    struct impl;
+
+  private:
+    std::shared_ptr<impl> priv;
+};
+}
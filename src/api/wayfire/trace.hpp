@@ -0,0 +1,109 @@
+#pragma once
+
+// WF_USE_CONFIG_H is set only when building Wayfire itself, external plugins
+// need to use <wayfire/config.h>
+#ifdef WF_USE_CONFIG_H
+    #include <config.h>
+#else
+    #include <wayfire/config.h>
+#endif
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Zone instrumentation for profilers.
+ *
+ * When Wayfire is built with the option tracing set to tracy or perfetto, the macros below record zones with
+ * the chosen profiler. Otherwise, they compile to nothing. Zone names must be string literals.
+ *
+ * WF_TRACE_ZONE(name): a zone which lasts until the end of the enclosing scope.
+ * WF_TRACE_ZONE_TEXT(name, text): like WF_TRACE_ZONE, annotated with a runtime string, e.g. a plugin name.
+ * WF_TRACE_ZONE_SAMPLED(name, period): records only every period-th execution of the zone, for code which
+ *   runs too often to record every time.
+ *
+ * Plugins get the macros via <wayfire/debug.hpp>.
+ */
+#define WF_TRACE_CONCAT_IMPL(a, b) a ## b
+#define WF_TRACE_CONCAT(a, b) WF_TRACE_CONCAT_IMPL(a, b)
+#define WF_TRACE_SAMPLE(period) \
+    static thread_local uint32_t WF_TRACE_CONCAT(wf_trace_counter_, __LINE__) = 0; \
+    const bool WF_TRACE_CONCAT(wf_trace_active_, __LINE__) = \
+        (WF_TRACE_CONCAT(wf_trace_counter_, __LINE__)++ % (period)) == 0
+
+#if defined(WF_TRACING_TRACY)
+    #include <tracy/Tracy.hpp>
+
+    #define WF_TRACE_ZONE(name) ZoneScopedN(name)
+    #define WF_TRACE_ZONE_TEXT(name, text) \
+    ZoneScopedN(name); \
+    { \
+        std::string_view wf_trace_text{text}; \
+        ZoneText(wf_trace_text.data(), wf_trace_text.size()); \
+    }
+    #define WF_TRACE_ZONE_SAMPLED(name, period) \
+    WF_TRACE_SAMPLE(period); \
+    ZoneNamedN(WF_TRACE_CONCAT(wf_trace_zone_, __LINE__), name, WF_TRACE_CONCAT(wf_trace_active_, __LINE__))
+
+#elif defined(WF_TRACING_PERFETTO)
+    #include <perfetto.h>
+    #include <string>
+
+PERFETTO_DEFINE_CATEGORIES(perfetto::Category("wayfire").SetDescription("Wayfire compositor"));
+
+namespace wf
+{
+namespace trace
+{
+/** A zone which is recorded only if it is active. */
+class sampled_zone_t
+{
+  public:
+    sampled_zone_t(const char *name, bool active) : active(active)
+    {
+        if (active)
+        {
+            TRACE_EVENT_BEGIN("wayfire", perfetto::StaticString{name});
+        }
+    }
+
+    ~sampled_zone_t()
+    {
+        if (active)
+        {
+            TRACE_EVENT_END("wayfire");
+        }
+    }
+
+    sampled_zone_t(const sampled_zone_t&) = delete;
+    sampled_zone_t& operator =(const sampled_zone_t&) = delete;
+
+  private:
+    bool active;
+};
+}
+}
+
+    #define WF_TRACE_ZONE(name) TRACE_EVENT("wayfire", name)
+    #define WF_TRACE_ZONE_TEXT(name, text) TRACE_EVENT("wayfire", name, "text", std::string{text})
+    #define WF_TRACE_ZONE_SAMPLED(name, period) \
+    WF_TRACE_SAMPLE(period); \
+    wf::trace::sampled_zone_t WF_TRACE_CONCAT(wf_trace_zone_, __LINE__){name, \
+        WF_TRACE_CONCAT(wf_trace_active_, __LINE__)}
+
+#else
+    #define WF_TRACE_ZONE(name)
+    #define WF_TRACE_ZONE_TEXT(name, text)
+    #define WF_TRACE_ZONE_SAMPLED(name, period)
+#endif
+
+namespace wf
+{
+namespace trace
+{
+/**
+ * Connect to the profiler, if Wayfire was built with one. Called once at startup, before any zone is recorded.
+ */
+void init();
+}
+}
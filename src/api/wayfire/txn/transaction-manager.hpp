@@ -8,6 +8,43 @@ namespace wf
 {
 namespace txn
 {
+/**
+ * The different steps in the lifecycle of a transaction, as recorded in the transaction trace.
+ */
+enum class transaction_event_t : uint8_t
+{
+    /** The transaction was passed to schedule_transaction(). */
+    SCHEDULED,
+    /** The (pending) transaction was merged into the newly scheduled transaction given as object. */
+    MERGED,
+    /** The transaction was committed. */
+    COMMITTED,
+    /** An object of the committed transaction became ready. */
+    OBJECT_READY,
+    /** The objects which were ready were applied, because the other objects were late. */
+    SPLIT,
+    /** All objects were ready and the transaction was applied. */
+    APPLIED,
+    /** The transaction was applied because it timed out. */
+    TIMED_OUT,
+};
+
+/**
+ * A single entry in the transaction trace.
+ */
+struct transaction_trace_entry_t
+{
+    /** The time of the event, see wf::get_current_time_us(). */
+    int64_t time_us;
+    /** The transaction the event refers to. Only used as an identifier, the transaction may not exist anymore. */
+    const void *tx;
+    /** For MERGED, the transaction which tx is merged into. */
+    const void *other_tx;
+    transaction_event_t event;
+    /** For OBJECT_READY, a description of the object (as given by stringify(), truncated). */
+    char object[47];
+};
+
 /*
  * The transaction manager keeps track of all committed and pending transactions and ensures that there is at
  * most one committed transaction for a given object.
@@ -40,6 +77,22 @@ class transaction_manager_t : public signal::provider_t
      */
     void schedule_object(transaction_object_sptr object);
 
+    /**
+     * Start a batch of changes. Until the matching end_batch() call, all objects passed to schedule_object()
+     * are collected in a single transaction instead of getting a transaction each. This is useful when many
+     * objects are changed at once (for example, when all views of an output are moved to another output), so
+     * that their new state is applied atomically.
+     *
+     * Batches may be nested, the collected transaction is scheduled when the outermost batch ends.
+     * Transactions passed directly to schedule_transaction() are not affected.
+     */
+    void begin_batch();
+
+    /**
+     * End a batch started by begin_batch().
+     */
+    void end_batch();
+
     /**
      * Check whether there is a pending transaction for the given object.
      */
@@ -50,6 +103,19 @@ class transaction_manager_t : public signal::provider_t
      */
     bool is_object_committed(transaction_object_sptr object) const;
 
+    /**
+     * Set the number of entries in the transaction trace. The trace is a ring buffer which contains the last
+     * events in the lifecycle of all transactions. 0 disables tracing, which is the default.
+     *
+     * Changing the capacity clears the trace.
+     */
+    void set_trace_capacity(size_t capacity);
+
+    /**
+     * Get the entries of the transaction trace, from the oldest to the newest one.
+     */
+    std::vector<transaction_trace_entry_t> get_trace() const;
+
     struct impl;
     std::unique_ptr<impl> priv;
 };
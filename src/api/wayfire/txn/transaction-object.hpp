@@ -2,6 +2,8 @@
 
 #include <wayfire/signal-provider.hpp>
 
+struct wl_client;
+
 namespace wf
 {
 namespace txn
@@ -43,6 +45,15 @@ class transaction_object_t : public signal::provider_t
      */
     virtual void apply() = 0;
 
+    /**
+     * Get the client whose response the object waits for when it is committed, if any. It is used to learn
+     * how fast each client usually responds, see the core/transaction_adaptive_timeout option.
+     */
+    virtual wl_client *get_client() const
+    {
+        return nullptr;
+    }
+
     virtual ~transaction_object_t() = default;
 };
 
@@ -3,6 +3,7 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/util.hpp"
 #include <wayfire/txn/transaction-object.hpp>
+#include <unordered_set>
 
 namespace wf
 {
@@ -50,20 +51,72 @@ class transaction_t : public signal::provider_t
      */
     void commit();
 
+    /**
+     * Enable splitting of the transaction. If a client takes longer than usual (as learned from its previous
+     * transactions) to make its objects ready, the objects which are already ready are applied without
+     * waiting for the full timeout. The remaining objects are applied when they become ready or when the
+     * transaction times out.
+     *
+     * Must be called before commit().
+     */
+    void set_adaptive_timeout(bool enabled);
+
     virtual ~transaction_t() = default;
 
   private:
     std::vector<transaction_object_sptr> objects;
+    // Filled only for transactions with many objects, see add_object().
+    std::unordered_set<transaction_object_t*> object_index;
     int count_ready_objects = 0;
     uint64_t timeout;
     timer_setter_t timer_setter;
 
+    bool adaptive_timeout = false;
+    int64_t commit_time_us = 0;
+    // The objects which are ready, in the order they became ready.
+    std::vector<transaction_object_t*> ready_objects;
+    // Used to set the final timeout after the transaction was split, from outside of the timer callback.
+    wf::wl_idle_call idle_set_final_timeout;
+
     void apply(bool did_timeout);
+    void split();
+    int64_t get_split_timeout();
     wf::signal::connection_t<object_ready_signal> on_object_ready;
 };
 
 using transaction_uptr = std::unique_ptr<transaction_t>;
 
+/**
+ * A signal emitted on a committed transaction when one of its objects becomes ready.
+ */
+struct transaction_object_ready_signal
+{
+    transaction_t *self;
+    transaction_object_t *object;
+};
+
+/**
+ * A signal emitted on a transaction when it is split because some of its objects took longer than usual to
+ * become ready (see transaction_t::set_adaptive_timeout()). The objects which were ready have been applied
+ * and are no longer part of the transaction.
+ */
+struct transaction_split_signal
+{
+    transaction_t *self;
+    std::vector<transaction_object_sptr> applied;
+};
+
+/**
+ * A signal emitted on a pending transaction when the transaction manager merges it into a newly scheduled
+ * transaction. All objects of the transaction are now part of @into, and the transaction is destroyed right
+ * after the signal.
+ */
+struct transaction_merged_signal
+{
+    transaction_t *self;
+    transaction_t *into;
+};
+
 /**
  * A signal emitted on a transaction as soon as it has been applied.
  */
@@ -49,6 +49,8 @@ class translation_node_instance_t : public render_instance_t
     wf::signal::connection_t<wf::scene::node_damage_signal> on_node_damage;
     wf::signal::connection_t<wf::scene::node_regen_instances_signal> on_regen_instances;
     wf::output_t *shown_on;
+    // Whether the last visibility computation found the node to be completely hidden.
+    bool fully_occluded = false;
     void regen_instances();
 
   public:
@@ -62,6 +64,8 @@ class translation_node_instance_t : public render_instance_t
     void presentation_feedback(wf::output_t *output) override;
     wf::scene::direct_scanout try_scanout(wf::output_t *output) override;
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override;
+    bool can_render_transformed() override;
+    int get_alpha_layer_count() override;
 };
 }
 }
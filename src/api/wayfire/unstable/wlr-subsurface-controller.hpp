@@ -2,6 +2,7 @@
 
 #include "wayfire/util.hpp"
 #include <memory>
+#include <optional>
 #include <wayfire/scene.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/unstable/translation-node.hpp>
@@ -10,6 +11,10 @@ namespace wf
 {
 /**
  * A subsurface root node. It applies a translation to its children equal to the offset of the subsurface.
+ *
+ * With core/flatten_subsurfaces, a subsurface root which is not nested in another one flattens the tree of
+ * nested subsurfaces below it: it generates a single render instance for the whole tree and hit-tests a flat
+ * list of the surfaces in it, instead of going through one level per nested subsurface.
  */
 class wlr_subsurface_root_node_t : public wf::scene::translation_node_t
 {
@@ -18,8 +23,26 @@ class wlr_subsurface_root_node_t : public wf::scene::translation_node_t
     std::string stringify() const override;
     bool update_offset(bool damage = true);
 
+    void gen_render_instances(std::vector<scene::render_instance_uptr>& instances,
+        scene::damage_callback damage, wf::output_t *output) override;
+    std::optional<wf::scene::input_node_t> find_node_at(const wf::pointf_t& at) override;
+
   private:
     wlr_subsurface *subsurface;
+
+    struct flat_input_entry_t
+    {
+        wf::scene::node_t *node;
+        // The offset of the node relative to this subsurface root.
+        wf::point_t offset;
+        // Only surfaces are known to accept input solely inside of their bounding box.
+        std::optional<wf::geometry_t> bbox;
+    };
+
+    // The flattened list used for hit-testing, valid for the hit-testing generation it was built for.
+    std::vector<flat_input_entry_t> flat_input;
+    uint64_t flat_input_generation = 0;
+    void rebuild_flat_input();
     wf::wl_listener_wrapper on_subsurface_destroy;
     wf::wl_listener_wrapper on_subsurface_commit;
 };
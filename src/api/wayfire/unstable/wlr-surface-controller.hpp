@@ -5,6 +5,12 @@
 
 namespace wf
 {
+class wlr_subsurface_root_node_t;
+namespace scene
+{
+class wlr_surface_node_t;
+}
+
 struct node_recheck_constraints_signal
 {};
 
@@ -18,11 +24,33 @@ class wlr_surface_controller_t
     static void create_controller(wlr_surface *surface, scene::floating_inner_ptr root_node);
     static void try_free_controller(wlr_surface *surface);
 
+    /**
+     * With core/batch_subsurface_commits, the state and position of synchronized subsurfaces are not applied
+     * when their commit event is emitted, but together with those of the other subsurfaces, once the surface
+     * whose commit applied them commits itself.
+     *
+     * @return The controller of the surface whose commit applies the state of @surface, or nullptr if the
+     *   state of @surface should be applied right away.
+     */
+    static wlr_surface_controller_t *get_batching_controller(wlr_surface *surface);
+
+    /** Apply the deferred state of @node (see wlr_surface_node_t::apply_deferred_state()) on the next commit. */
+    void defer_surface_state(scene::wlr_surface_node_t *node);
+
+    /** Update the offset of @node on the next commit. */
+    void defer_subsurface_offset(wlr_subsurface_root_node_t *node);
+
   private:
     wlr_surface_controller_t(wlr_surface *surface, scene::floating_inner_ptr root_node);
     ~wlr_surface_controller_t();
 
     void update_subsurface_order_and_position();
+    scene::wlr_surface_node_t *find_main_node();
+
+    std::vector<std::weak_ptr<scene::node_t>> deferred_surfaces;
+    std::vector<std::weak_ptr<wlr_subsurface_root_node_t>> deferred_subsurfaces;
+    void apply_deferred_commits();
+    bool to_root_coordinates(scene::node_t *node, wf::region_t& region);
 
     scene::floating_inner_ptr root;
     wlr_surface *surface;
@@ -3,12 +3,15 @@
 #include "wayfire/geometry.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/option-wrapper.hpp"
 #include "wayfire/view-transform.hpp"
 #include <wayfire/scene.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 
 namespace wf
 {
+struct explicit_sync_acquire_t;
+
 namespace scene
 {
 struct surface_state_t
@@ -22,11 +25,19 @@ struct surface_state_t
     wf::dimensions_t size = {0, 0};
     std::optional<wlr_fbox> src_viewport;
     wl_output_transform transform = WL_OUTPUT_TRANSFORM_NORMAL;
+    // If the client uses linux-drm-syncobj, the acquire point of the buffer. Call acquire->wait_gpu() before
+    // sampling the texture.
+    std::shared_ptr<wf::explicit_sync_acquire_t> acquire;
 
     // Read the current surface state, get a lock on the current surface buffer (releasing any old locks),
     // and accumulate damage.
     void merge_state(wlr_surface *surface);
 
+    // Whether each pixel of the buffer maps to exactly one framebuffer pixel when the surface is shown at
+    // @scale. This is the case for clients which use fractional-scale-v1 and viewporter to submit buffers at
+    // the preferred scale, and for clients whose integer buffer scale matches @scale.
+    bool is_pixel_exact(float scale) const;
+
     surface_state_t() = default;
 
     // Releases the lock on the current_buffer, if one is held.
@@ -38,6 +49,39 @@ struct surface_state_t
     surface_state_t& operator =(surface_state_t&& other);
 };
 
+/**
+ * Statistics about the commits and rendering of a single surface, useful for finding clients which draw a lot.
+ */
+struct surface_stats_t
+{
+    /** Total number of commits. */
+    uint64_t commits = 0;
+    /**
+     * The number of commits per second, measured over windows of at least one second. If the current window
+     * is two seconds or older, the rate is measured over the current window instead.
+     */
+    double commits_per_second = 0;
+    /** The sum of the damaged area of all commits, in buffer pixels. */
+    uint64_t damaged_area = 0;
+    /** The size and DRM fourcc format of the current buffer, or 0 if there is no buffer. */
+    wf::dimensions_t buffer_size = {0, 0};
+    uint32_t buffer_format = 0;
+    /** Whether the buffer is a DMA-BUF, as opposed to shared memory. */
+    bool dmabuf = false;
+    /**
+     * For shared memory buffers: the number of commits where only the damaged part of the buffer was
+     * uploaded into the surface's existing texture, and the number of commits which needed a new texture
+     * (and therefore a full upload), for example because the buffer size changed.
+     */
+    uint64_t partial_uploads = 0;
+    uint64_t full_uploads    = 0;
+    /** The number of frames where the surface was directly scanned out. */
+    uint64_t scanout_frames = 0;
+    /** The number of times the surface was rendered and the total CPU time spent doing so. */
+    uint64_t renders = 0;
+    int64_t render_time_us = 0;
+};
+
 /**
  * An implementation of node_t for wlr_surfaces.
  *
@@ -67,8 +111,19 @@ class wlr_surface_node_t : public node_t, public zero_copy_texturable_node_t
 
     wlr_surface *get_surface() const;
     void apply_state(surface_state_t&& state);
+
+    /**
+     * Apply the state accumulated from the commits whose application was deferred by the surface controller
+     * (see core/batch_subsurface_commits), without damaging the node.
+     *
+     * @return The damage of the applied commits, in the coordinate system of the node.
+     */
+    wf::region_t apply_deferred_state();
     void send_frame_done(bool delay_until_vblank);
 
+    /** Get the commit and render statistics of the surface. */
+    surface_stats_t get_stats() const;
+
   private:
     std::unique_ptr<pointer_interaction_t> ptr_interaction;
     std::unique_ptr<touch_interaction_t> tch_interaction;
@@ -87,8 +142,44 @@ class wlr_surface_node_t : public node_t, public zero_copy_texturable_node_t
     wf::wl_listener_wrapper on_surface_destroyed;
     wf::wl_listener_wrapper on_surface_commit;
 
+    surface_stats_t stats;
+    int64_t commit_window_start_us = 0;
+    uint64_t commit_window_commits = 0;
+    const wlr_texture *last_texture = nullptr;
+    void update_commit_stats();
+
+    /**
+     * Video surfaces (see content-type-v1) get frame callbacks only shortly before their next frame is due,
+     * instead of on every output frame, see frame_done_due().
+     */
+    int64_t last_buffer_commit_us   = 0;
+    int64_t video_frame_interval_us = 0;
+    void update_video_cadence();
+    bool frame_done_due(wf::output_t *output) const;
+
+    /**
+     * Surfaces which are not visible on any output (e.g. minimized, on another workspace or occluded) do not
+     * get frame callbacks on every output frame. Instead, they get them at a low rate from a timer, see the
+     * core/background_frame_rate option.
+     */
+    int full_rate_instances = 0;
+    wf::wl_timer<true> background_frame_timer;
+    /**
+     * Whether the view matches core/unthrottled_views. Cached until the view's title or app-id or the option
+     * changes.
+     */
+    std::optional<bool> unthrottled;
+    bool is_unthrottled();
+    void reset_unthrottled();
+    wf::option_wrapper_t<std::string> unthrottled_views_option{"core/unthrottled_views"};
+    wf::wl_idle_call idle_reset_unthrottled;
+    wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed;
+    wf::signal::connection_t<wf::view_app_id_changed_signal> on_app_id_changed;
+    void update_frame_throttle();
+
     const bool autocommit;
     surface_state_t current_state;
+    surface_state_t deferred_state;
     void apply_current_surface_state();
 };
 }
@@ -10,9 +10,15 @@ namespace wf
 /** Convert timespect to milliseconds. */
 int64_t timespec_to_msec(const timespec& ts);
 
+/** Convert timespec to microseconds. */
+int64_t timespec_to_usec(const timespec& ts);
+
 /** Returns current time in msec, using CLOCK_MONOTONIC as a base */
 int64_t get_current_time();
 
+/** Returns current time in usec, using CLOCK_MONOTONIC as a base */
+int64_t get_current_time_us();
+
 /**
  * A wrapper around wl_listener compatible with C++11 std::functions
  */
@@ -53,7 +59,10 @@ struct wl_listener_wrapper
 };
 
 /**
- * A wrapper for adding idle callbacks to the event loop
+ * A wrapper for adding idle callbacks to the event loop.
+ *
+ * All idle calls are queued in a single list and dispatched from a single idle event source, so that
+ * scheduling an idle call does not need to allocate a new event source.
  */
 class wl_idle_call
 {
@@ -93,12 +102,17 @@ class wl_idle_call
 
   private:
     callback_t call;
-    wl_event_source *source = NULL;
+    // Link in the queue of pending idle calls. Empty if the idle call is not scheduled.
+    wl_list link;
+    static void dispatch_queue(void*);
 };
 
 /**
  * A wrapper for wl_event_loop_add_timer / wl_event_loop_timer_update
  *
+ * The event source is created on the first call to set_timeout() and then reused until the timer is
+ * destroyed, disconnecting only disarms it. libwayland multiplexes all armed timers onto one timerfd.
+ *
  * @param repeatable If repeatable is true, then the callback's return value indicates whether to repeat the
  *   timer or not. In those cases, it is not possible to destroy the timer from within the callback.
  */
@@ -132,6 +146,7 @@ class wl_timer
 
   private:
     wl_event_source *source = NULL;
+    bool armed = false;
     uint32_t timeout = -1;
     std::function<void()> execute;
 };
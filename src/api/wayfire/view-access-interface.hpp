@@ -28,6 +28,8 @@ namespace wf
  * "tiled-right" -> bool
  * "tiled-top" -> bool
  * "tiled-bottom" -> bool
+ * "focusable" -> bool
+ * "mapped" -> bool
  * "maximized" -> bool
  * "floating" -> bool
  * "type" -> std::string (This will return a type string like the matcher plugin did)
@@ -53,6 +55,42 @@ class view_access_interface_t : public access_interface_t
     // Inherits docs.
     virtual variant_t get(const std::string & identifier, bool & error) override;
 
+    /**
+     * The supported properties, so that the identifier of a property can be resolved once and then
+     * queried without string comparisons.
+     */
+    enum class property_t
+    {
+        APP_ID,
+        TITLE,
+        ROLE,
+        FULLSCREEN,
+        ACTIVATED,
+        MINIMIZED,
+        FOCUSABLE,
+        MAPPED,
+        TILED_LEFT,
+        TILED_RIGHT,
+        TILED_TOP,
+        TILED_BOTTOM,
+        MAXIMIZED,
+        FLOATING,
+        TYPE,
+        UNKNOWN,
+    };
+
+    /**
+     * @brief resolve_property Find the property with the given identifier.
+     *
+     * @return The property, or property_t::UNKNOWN if it is not supported.
+     */
+    static property_t resolve_property(const std::string & identifier);
+
+    /**
+     * @brief get Same as get(identifier, error), for a resolved property.
+     */
+    variant_t get(property_t property, bool & error);
+
     /**
      * @brief set_view Setter for the view to interrogate.
      *
@@ -66,5 +104,8 @@ class view_access_interface_t : public access_interface_t
      * @brief _view The view to interrogate.
      */
     wayfire_view _view;
+
+    /** The value of the "type" property. */
+    std::string get_type();
 };
 } // End namespace wf.
@@ -6,13 +6,23 @@
 #include "wayfire/region.hpp"
 #include "wayfire/scene-render.hpp"
 #include "wayfire/scene.hpp"
+#include <cmath>
 #include <memory>
 #include <wayfire/opengl.hpp>
+#include <glm/mat3x3.hpp>
 
 namespace wf
 {
+struct view_geometry_changed_signal;
+
 namespace scene
 {
+/**
+ * Describe @node as the owner of GPU memory, see OpenGL::gpu_memory_scope_t: named @name, or after the node
+ * itself if @name is empty, and attributed to the view the node belongs to.
+ */
+OpenGL::gpu_memory_owner_t gpu_memory_owner_of(node_t *node, std::string name = "");
+
 class zero_copy_texturable_node_t
 {
   public:
@@ -64,12 +74,18 @@ class transformer_base_node_t : public scene::floating_inner_node_t
     // children's current content.
     wf::region_t cached_damage;
 
+    // Releases @inner_content when the transformer has not been rendered for a while.
+    OpenGL::reclaimable_buffer_t reclaim_inner_content{[this] () { release_buffers(); }};
+
     wf::texture_t get_updated_contents(const wf::geometry_t& bbox, float scale,
         std::vector<scene::render_instance_uptr>& children)
     {
-        int target_width  = scale * bbox.width;
-        int target_height = scale * bbox.height;
+        // Round up like the output's framebuffer does, so that surfaces rendered at the same scale are
+        // not squeezed by a pixel.
+        int target_width  = std::ceil(scale * bbox.width);
+        int target_height = std::ceil(scale * bbox.height);
 
+        OpenGL::gpu_memory_scope_t memory_scope{[this] () { return gpu_memory_owner_of(this); }};
         OpenGL::render_begin();
         inner_content.scale = scale;
         if (inner_content.allocate(target_width, target_height))
@@ -79,6 +95,7 @@ class transformer_base_node_t : public scene::floating_inner_node_t
 
         inner_content.geometry = bbox;
         OpenGL::render_end();
+        reclaim_inner_content.mark_used();
 
         render_pass_params_t params;
         params.instances = &children;
@@ -237,7 +254,7 @@ class transformer_render_instance_t : public render_instance_t
     {
         if (!damage.empty())
         {
-            auto our_damage = damage & self->get_bounding_box();
+            auto our_damage = damage & self->get_cached_bounding_box();
             instructions.push_back(wf::scene::render_instruction_t{
                         .instance = this,
                         .target   = target,
@@ -265,7 +282,7 @@ class transformer_render_instance_t : public render_instance_t
 
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override
     {
-        if (!(visible & self->get_bounding_box()).empty())
+        if (!(visible & self->get_cached_bounding_box()).empty())
         {
             // By default, we are not sure how the visibility region is affected, so we take a simple 0-or-1
             // approach: if anything of the bounding box is visible, we assume the whole view is visible, and
@@ -395,6 +412,32 @@ class view_2d_transformer_t : public transformer_base_node_t
         damage_callback push_damage, wf::output_t *shown_on) override;
 
     std::weak_ptr<wf::view_interface_t> view;
+
+    /** The transformation from the coordinates of the children to those of the parent, see to_global(). */
+    wf::affine_2d_t get_affine_transform();
+
+  private:
+    /**
+     * The composed transformation and its inverse, as affine matrices in homogeneous 2D coordinates. They are
+     * cached because to_local() and to_global() are called for every pointer motion and every damaged box,
+     * and recomputed when the parameters above or the center of the view change.
+     */
+    struct cached_transform_t
+    {
+        float scale_x, scale_y, translation_x, translation_y, angle;
+        wf::pointf_t center;
+        glm::dmat3 forward, inverse;
+        bool valid = false;
+    };
+
+    cached_transform_t cache;
+
+    // The center of toplevels changes only with their geometry, other views have no such signal.
+    bool center_tracked = false;
+    bool center_dirty   = true;
+    wf::signal::connection_t<wf::view_geometry_changed_signal> on_geometry_changed;
+
+    const cached_transform_t& get_cached_transform();
 };
 
 /**
@@ -409,8 +452,23 @@ class view_3d_transformer_t : public transformer_base_node_t
     glm::mat4 view_proj{1.0}, translation{1.0}, rotation{1.0}, scaling{1.0};
     glm::vec4 color{1, 1, 1, 1};
 
+    /**
+     * Get the composed transformation. It is cached and only recomputed when the matrices above or the size
+     * of the view change.
+     */
     glm::mat4 calculate_total_transform();
 
+  private:
+    struct cached_transform_t
+    {
+        glm::mat4 view_proj, translation, rotation, scaling;
+        float depth;
+        glm::mat4 total;
+        bool valid = false;
+    };
+
+    cached_transform_t cache;
+
   public:
     view_3d_transformer_t(wayfire_view view);
     wf::pointf_t to_local(const wf::pointf_t& point) override;
@@ -187,11 +187,12 @@ class view_interface_t : public wf::signal::provider_t, public wf::object_base_t
     std::unique_ptr<view_priv_impl> priv;
 
     template<class ConcreteView, class... Args>
-    static std::shared_ptr<ConcreteView> create(Args... args)
+    static std::shared_ptr<ConcreteView> create(Args&&... args)
     {
         static_assert(std::is_base_of_v<view_interface_t, ConcreteView>,
             "view_interface_t::create<T> can be used only when T is a view type!");
-        auto view = tracking_allocator_t<view_interface_t>::get().allocate<ConcreteView>(args...);
+        auto view = tracking_allocator_t<view_interface_t>::get().allocate<ConcreteView>(
+            std::forward<Args>(args)...);
         view->base_initialization();
         return view;
     }
@@ -56,7 +56,13 @@ class output_workarea_manager_t
     void remove_reserved_area(anchored_area *area);
 
     /**
-     * Recalculate reserved area for each anchored area
+     * Recalculate reserved area for each anchored area.
+     *
+     * The workarea (see get_workarea()) is updated immediately. workarea_changed_signal is emitted only if
+     * the workarea actually changed, and at most once per frame: if the workarea already changed in the
+     * current frame, the signal is emitted on the next frame event of the output, with the combined change.
+     * Outputs which do not repaint (for example with DPMS off) send no frame events, so a short timeout is
+     * used as a fallback for them.
      */
     void reflow_reserved_areas();
 
@@ -39,7 +39,7 @@ enum wset_view_flags
     WSET_CURRENT_WORKSPACE = (1 << 2),
     // Sort the resulting array in the same order as the scenegraph nodes of the corresponding views.
     // Views not attached to the scenegraph (wf::get_core().scene()) are not included in the answer.
-    // This operation may be slow, so it should not be used on hot paths.
+    // The sorted list is cached by the workspace set, see get_views_in_stacking_order().
     WSET_SORT_STACKING     = (1 << 3),
 };
 
@@ -148,6 +148,18 @@ class workspace_set_t : public wf::signal::provider_t, public wf::object_base_t,
     std::vector<wayfire_toplevel_view> get_views(uint32_t flags = 0,
         std::optional<wf::point_t> workspace = {});
 
+    /**
+     * Get the views of the workspace set which are attached to the scenegraph, in stacking order. This is
+     * the same as get_views(WSET_SORT_STACKING) (or get_views(WSET_SORT_STACKING | WSET_MAPPED_ONLY) if
+     * @mapped_only is set), but without copying the list.
+     *
+     * The list is maintained by the workspace set and re-sorted only when the stacking order or the set of
+     * views changes, so it is cheap to call on hot paths. The list may be rebuilt by the next call to this
+     * function or to get_views() after such a change, so callers which restack views or call into the
+     * workspace set while iterating should make a copy first.
+     */
+    const std::vector<wayfire_toplevel_view>& get_views_in_stacking_order(bool mapped_only = true);
+
     /**
      * Get the main workspace for a view.
      * The main workspace is the one which contains the view's center.
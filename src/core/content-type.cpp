@@ -0,0 +1,63 @@
+#include "content-type.hpp"
+#include <wayfire/debug.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+#include <utility>
+
+wf::content_type_manager_t::content_type_manager_t(wl_display *display)
+{
+    manager = wlr_content_type_manager_v1_create(display, 1);
+}
+
+wf::content_type_t wf::content_type_manager_t::get_content_type(wlr_surface *surface) const
+{
+    static wf::option_wrapper_t<bool> content_type_hints{"core/content_type_hints"};
+    if (!manager || !surface || !content_type_hints)
+    {
+        return content_type_t::NONE;
+    }
+
+    switch (wlr_surface_get_content_type_v1(manager, surface))
+    {
+      case WP_CONTENT_TYPE_V1_TYPE_PHOTO:
+        return content_type_t::PHOTO;
+
+      case WP_CONTENT_TYPE_V1_TYPE_VIDEO:
+        return content_type_t::VIDEO;
+
+      case WP_CONTENT_TYPE_V1_TYPE_GAME:
+        return content_type_t::GAME;
+
+      default:
+        return content_type_t::NONE;
+    }
+}
+
+void wf::content_type_manager_t::set_candidate(wf::output_t *output, wlr_surface *surface)
+{
+    outputs[output].pending = surface;
+}
+
+void wf::content_type_manager_t::commit_frame(wf::output_t *output)
+{
+    auto& state = outputs[output];
+    auto type   = get_content_type(std::exchange(state.pending, nullptr));
+    if (type != state.current)
+    {
+        LOGD("Content type of ", output->to_string(), " changed to ", (int)type);
+        state.current = type;
+    }
+}
+
+wf::content_type_t wf::content_type_manager_t::get_output_content_type(wf::output_t *output) const
+{
+    auto it = outputs.find(output);
+    return it == outputs.end() ? content_type_t::NONE : it->second.current;
+}
+
+void wf::content_type_manager_t::remove_output(wf::output_t *output)
+{
+    outputs.erase(output);
+}
@@ -0,0 +1,68 @@
+#ifndef WF_CORE_CONTENT_TYPE_HPP
+#define WF_CORE_CONTENT_TYPE_HPP
+
+#include <wayfire/nonstd/wlroots.hpp>
+#include <unordered_map>
+
+struct wlr_content_type_manager_v1;
+
+namespace wf
+{
+class output_t;
+
+/** The kind of content a surface shows, as hinted by its client with content-type-v1. */
+enum class content_type_t
+{
+    NONE,
+    PHOTO,
+    VIDEO,
+    GAME,
+};
+
+/**
+ * Implements the content-type-v1 protocol and tracks the content type of the surface which covers each
+ * output, so that the render manager can adapt its scheduling:
+ *
+ * - GAME: frames are painted without repaint delay, and on adaptive sync outputs as soon as the game
+ *   commits (on-demand rendering), for the lowest latency.
+ * - PHOTO: on adaptive sync outputs, frames are painted on demand, so that the display can refresh
+ *   at its lowest rate while the picture does not change.
+ * - VIDEO: surfaces get frame callbacks at the cadence of the video instead of every output frame,
+ *   see wlr_surface_node_t.
+ */
+class content_type_manager_t
+{
+  public:
+    content_type_manager_t(wl_display *display);
+
+    content_type_manager_t(const content_type_manager_t&) = delete;
+    content_type_manager_t& operator =(const content_type_manager_t&) = delete;
+
+    /** @return The content type hinted by the client of @surface, NONE if disabled by core/content_type_hints. */
+    content_type_t get_content_type(wlr_surface *surface) const;
+
+    /** Report that @surface covers the whole of @output in the current frame. */
+    void set_candidate(wf::output_t *output, wlr_surface *surface);
+
+    /** Update the content type of @output after the render instances had a chance to report a candidate. */
+    void commit_frame(wf::output_t *output);
+
+    /** @return The content type of the surface which covered @output in the last frame. */
+    content_type_t get_output_content_type(wf::output_t *output) const;
+
+    /** Forget the state of an output which is being destroyed. */
+    void remove_output(wf::output_t *output);
+
+  private:
+    struct output_state_t
+    {
+        wlr_surface *pending = nullptr;
+        content_type_t current = content_type_t::NONE;
+    };
+
+    wlr_content_type_manager_v1 *manager;
+    std::unordered_map<wf::output_t*, output_state_t> outputs;
+};
+}
+
+#endif /* end of include guard: WF_CORE_CONTENT_TYPE_HPP */
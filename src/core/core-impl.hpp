@@ -13,6 +13,12 @@ namespace wf
 class seat_t;
 class input_manager_t;
 class input_method_relay;
+class memory_pressure_monitor_t;
+class dmabuf_feedback_manager_t;
+class explicit_sync_manager_t;
+class tearing_control_manager_t;
+class content_type_manager_t;
+class thread_pool_t;
 class compositor_core_impl_t : public compositor_core_t
 {
   public:
@@ -22,6 +28,12 @@ class compositor_core_impl_t : public compositor_core_t
     std::unique_ptr<wf::input_manager_t> input;
     std::unique_ptr<input_method_relay> im_relay;
     std::unique_ptr<plugin_manager_t> plugin_mgr;
+    std::unique_ptr<memory_pressure_monitor_t> memory_pressure;
+    std::unique_ptr<dmabuf_feedback_manager_t> dmabuf_feedback;
+    std::unique_ptr<explicit_sync_manager_t> explicit_sync;
+    std::unique_ptr<tearing_control_manager_t> tearing_control;
+    std::unique_ptr<content_type_manager_t> content_type;
+    std::unique_ptr<thread_pool_t> thread_pool;
 
     /**
      * Initialize the compositor core.
@@ -74,6 +86,13 @@ class compositor_core_impl_t : public compositor_core_t
     compositor_core_impl_t();
     virtual ~compositor_core_impl_t();
 
+    /**
+     * Secondary indices of the views, see find_view_by_id(), get_views_on_output() and
+     * get_views_by_focus().
+     */
+    struct view_index_t;
+    view_index_t& get_view_index();
+
   protected:
     wf::wl_listener_wrapper vkbd_created;
     wf::wl_listener_wrapper vptr_created;
@@ -88,6 +107,13 @@ class compositor_core_impl_t : public compositor_core_t
 
   private:
     wf::option_wrapper_t<bool> discard_command_output;
+
+    /** The environment variables set for the commands started with run(). */
+    std::vector<std::pair<std::string, std::string>> get_command_environment();
+    pid_t spawn_command(const std::string& command);
+    pid_t fork_command(const std::string& command);
+    wf::option_wrapper_t<int> transaction_trace_size;
+    std::unique_ptr<view_index_t> view_index;
     static std::unique_ptr<compositor_core_impl_t> static_core;
 };
 
@@ -11,23 +11,37 @@
 #include "wayfire/txn/transaction-manager.hpp"
 #include "wayfire/bindings-repository.hpp"
 #include "wayfire/util.hpp"
+#include <algorithm>
 #include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "plugin-loader.hpp"
+#include "memory-pressure.hpp"
+#include "dmabuf-feedback.hpp"
+#include "explicit-sync.hpp"
+#include "tearing-control.hpp"
+#include "content-type.hpp"
 #include "seat/tablet.hpp"
 #include "wayfire/touch/touch.hpp"
 #include "wayfire/view.hpp"
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <spawn.h>
+#include <signal.h>
 #include <float.h>
 
 #include <wayfire/img.hpp>
+#include <wayfire/thread-pool.hpp>
 #include <wayfire/output.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/output-layout.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/signal-definitions.hpp>
+#include <wayfire/startup-profile.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 
 #include "wayfire/unstable/wlr-surface-controller.hpp"
@@ -79,9 +93,28 @@ void wf::compositor_core_impl_t::init()
 {
     this->scene_root = std::make_shared<scene::root_node_t>();
     this->tx_manager = std::make_unique<txn::transaction_manager_t>();
+    transaction_trace_size.load_option("core/transaction_trace_size");
+    transaction_trace_size.set_callback([=] ()
+    {
+        tx_manager->set_trace_capacity(std::max(0, transaction_trace_size.value()));
+    });
+    tx_manager->set_trace_capacity(std::max(0, transaction_trace_size.value()));
     this->default_wm = std::make_unique<wf::window_manager_t>();
+    wf::option_wrapper_t<int> worker_threads{"core/worker_threads"};
+    this->thread_pool = std::make_unique<wf::thread_pool_t>(ev_loop, std::max(0, worker_threads.value()));
+
+    /* Like wlr_renderer_init_wl_display(), but we need the linux-dmabuf global to send per-surface
+     * feedback, see dmabuf_feedback_manager_t. */
+    wlr_renderer_init_wl_shm(renderer, display);
+    if (wlr_renderer_get_texture_formats(renderer, WLR_BUFFER_CAP_DMABUF))
+    {
+        protocols.linux_dmabuf = wlr_linux_dmabuf_v1_create_with_renderer(display, 5, renderer);
+    }
 
-    wlr_renderer_init_wl_display(renderer, display);
+    if (protocols.linux_dmabuf)
+    {
+        dmabuf_feedback = std::make_unique<wf::dmabuf_feedback_manager_t>(protocols.linux_dmabuf, renderer);
+    }
 
     /* Order here is important:
      * 1. init_desktop_apis() must come after wlr_compositor_create(),
@@ -94,6 +127,23 @@ void wf::compositor_core_impl_t::init()
     /* Needed for subsurfaces */
     wlr_subcompositor_create(display);
 
+    /* Explicit synchronization needs timeline support in both the renderer, which waits for acquire points
+     * and signals release points, and the backend, which waits for acquire points during direct scanout. */
+    wf::option_wrapper_t<bool> explicit_sync_enabled{"core/explicit_sync"};
+    const int drm_fd = wlr_renderer_get_drm_fd(renderer);
+    if (explicit_sync_enabled && (drm_fd >= 0) && renderer->features.timeline && backend->features.timeline)
+    {
+        protocols.drm_syncobj = wlr_linux_drm_syncobj_manager_v1_create(display, 1, drm_fd);
+    }
+
+    if (protocols.drm_syncobj)
+    {
+        explicit_sync = std::make_unique<wf::explicit_sync_manager_t>(compositor);
+    }
+
+    tearing_control = std::make_unique<wf::tearing_control_manager_t>(display);
+    content_type    = std::make_unique<wf::content_type_manager_t>(display);
+
     /* Legacy DRM */
     if (runtime_config.legacy_wl_drm &&
         wlr_renderer_get_texture_formats(renderer, WLR_BUFFER_CAP_DMABUF))
@@ -217,7 +267,11 @@ void wf::compositor_core_impl_t::post_init()
     core_backend_started_signal backend_started_ev;
     this->emit(&backend_started_ev);
     this->state = compositor_state_t::RUNNING;
-    plugin_mgr  = std::make_unique<wf::plugin_manager_t>();
+    {
+        wf::startup_profile::scope_t step{"core", "load plugins"};
+        plugin_mgr = std::make_unique<wf::plugin_manager_t>();
+    }
+
     this->bindings->reparse_extensions();
 
     // Move pointer to the middle of the leftmost, topmost output
@@ -232,8 +286,10 @@ void wf::compositor_core_impl_t::post_init()
 
     // Start processing cursor events
     seat->priv->cursor->setup_listeners();
+    memory_pressure = std::make_unique<wf::memory_pressure_monitor_t>();
     core_startup_finished_signal startup_ev;
     this->emit(&startup_ev);
+    wf::startup_profile::startup_finished();
 }
 
 void wf::compositor_core_impl_t::shutdown()
@@ -261,11 +317,14 @@ void wf::compositor_core_impl_t::disconnect_signals()
 void wf::compositor_core_impl_t::fini()
 {
     this->state = compositor_state_t::SHUTDOWN;
+    wf::startup_profile::finish();
     core_shutdown_signal ev;
     this->emit(&ev);
 
+    memory_pressure.reset();
     LOGI("Unloading plugins...");
     plugin_mgr.reset();
+    image_io::fini();
     // Shut down xwayland first, otherwise, wlroots will attempt to restart it when we kill it via
     // wl_display_destroy_clients().
     wf::fini_xwayland();
@@ -282,6 +341,11 @@ void wf::compositor_core_impl_t::fini()
     input.reset();
     priv_output_layout_fini(output_layout.get());
     output_layout.reset();
+    dmabuf_feedback.reset();
+    explicit_sync.reset();
+    tearing_control.reset();
+    content_type.reset();
+    thread_pool.reset();
     tx_manager.reset();
     OpenGL::fini();
     disconnect_signals();
@@ -424,15 +488,391 @@ std::vector<wayfire_view> wf::compositor_core_t::get_all_views()
     return wf::tracking_allocator_t<view_interface_t>::get().get_all();
 }
 
+void wf::compositor_core_t::for_each_view(const std::function<bool(wayfire_view)>& callback)
+{
+    for (auto& view : wf::tracking_allocator_t<view_interface_t>::get().get_all())
+    {
+        if (!callback(view))
+        {
+            return;
+        }
+    }
+}
+
+wayfire_view wf::compositor_core_t::find_view(const std::function<bool(wayfire_view)>& predicate)
+{
+    for (auto& view : wf::tracking_allocator_t<view_interface_t>::get().get_all())
+    {
+        if (predicate(view))
+        {
+            return view;
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<wayfire_view> wf::compositor_core_t::get_views_if(
+    const std::function<bool(wayfire_view)>& predicate)
+{
+    std::vector<wayfire_view> result;
+    for (auto& view : wf::tracking_allocator_t<view_interface_t>::get().get_all())
+    {
+        if (predicate(view))
+        {
+            result.push_back(view);
+        }
+    }
+
+    return result;
+}
+
+static uint64_t get_view_focus_timestamp(wayfire_view view)
+{
+    return view->get_surface_root_node()->keyboard_interaction().last_focus_timestamp;
+}
+
+struct wf::compositor_core_impl_t::view_index_t
+{
+    std::unordered_map<uint32_t, wayfire_view> by_id;
+    std::unordered_map<wf::output_t*, std::vector<wayfire_view>> by_output;
+
+    // The allocator generation the indices were built for, or none if they are dirty.
+    std::optional<uint64_t> generation;
+
+    // All views, most recently focused first. Rebuilt only when views are created or destroyed, and
+    // reordered in place after focus changes.
+    std::vector<wayfire_view> by_focus;
+    std::optional<uint64_t> focus_generation;
+    uint64_t focus_timestamp = 0;
+
+    wf::signal::connection_t<view_set_output_signal> on_view_set_output = [=] (view_set_output_signal *ev)
+    {
+        generation.reset();
+    };
+
+    view_index_t()
+    {
+        wf::get_core().connect(&on_view_set_output);
+    }
+
+    void ensure_up_to_date()
+    {
+        auto& allocator = wf::tracking_allocator_t<view_interface_t>::get();
+        if (generation == allocator.get_generation())
+        {
+            return;
+        }
+
+        by_id.clear();
+        for (auto& [output, views] : by_output)
+        {
+            views.clear();
+        }
+
+        for (auto& view : allocator.get_all())
+        {
+            by_id[view->get_id()] = view;
+            by_output[view->get_output()].push_back(view);
+        }
+
+        generation = allocator.get_generation();
+    }
+
+    void ensure_focus_order()
+    {
+        auto& allocator = wf::tracking_allocator_t<view_interface_t>::get();
+        const uint64_t last_timestamp = wf::get_core().seat->get_last_focus_timestamp();
+        if (focus_generation != allocator.get_generation())
+        {
+            by_focus = allocator.get_all();
+            std::sort(by_focus.begin(), by_focus.end(), [] (wayfire_view a, wayfire_view b)
+            {
+                auto ts_a = get_view_focus_timestamp(a);
+                auto ts_b = get_view_focus_timestamp(b);
+                return (ts_a > ts_b) || ((ts_a == ts_b) && (a->get_id() < b->get_id()));
+            });
+        } else if (focus_timestamp != last_timestamp)
+        {
+            // Only the few views focused since the last call are out of place, and they have to move towards
+            // the front. An insertion sort does this in a single pass, without allocating.
+            for (size_t i = 1; i < by_focus.size(); i++)
+            {
+                auto view = by_focus[i];
+                auto ts   = get_view_focus_timestamp(view);
+                size_t j  = i;
+                for (; (j > 0) && (get_view_focus_timestamp(by_focus[j - 1]) < ts); j--)
+                {
+                    by_focus[j] = by_focus[j - 1];
+                }
+
+                by_focus[j] = view;
+            }
+        }
+
+        focus_generation = allocator.get_generation();
+        focus_timestamp  = last_timestamp;
+    }
+};
+
+wf::compositor_core_impl_t::view_index_t& wf::compositor_core_impl_t::get_view_index()
+{
+    if (!view_index)
+    {
+        view_index = std::make_unique<view_index_t>();
+    }
+
+    view_index->ensure_up_to_date();
+    return *view_index;
+}
+
+wayfire_view wf::compositor_core_t::find_view_by_id(uint32_t id)
+{
+    auto& index = get_core_impl().get_view_index();
+    auto it     = index.by_id.find(id);
+    return (it == index.by_id.end()) ? nullptr : it->second;
+}
+
+const std::vector<wayfire_view>& wf::compositor_core_t::get_views_on_output(wf::output_t *output)
+{
+    return get_core_impl().get_view_index().by_output[output];
+}
+
+const std::vector<wayfire_view>& wf::compositor_core_t::get_views_by_focus()
+{
+    auto& index = get_core_impl().get_view_index();
+    index.ensure_focus_order();
+    return index.by_focus;
+}
+
+namespace
+{
+/**
+ * Reaps a child started with posix_spawn() once it exits, so that it does not stay around as a zombie.
+ * The child is watched through a pidfd, which does not interfere with the children of wlroots (Xwayland)
+ * the way a SIGCHLD handler calling waitpid(-1) would. If no pidfd can be opened for the child, it is polled
+ * with waitpid() on a timer instead.
+ */
+struct child_reaper_t
+{
+    static constexpr int POLL_INTERVAL_MS = 1000;
+
+    pid_t pid;
+    int pidfd = -1;
+    wl_event_source *source = nullptr;
+
+    static int handle_exit(int fd, uint32_t mask, void *data)
+    {
+        auto self = static_cast<child_reaper_t*>(data);
+        waitpid(self->pid, nullptr, WNOHANG);
+        delete self;
+        return 0;
+    }
+
+    static int handle_poll(void *data)
+    {
+        auto self = static_cast<child_reaper_t*>(data);
+        if (waitpid(self->pid, nullptr, WNOHANG) == 0)
+        {
+            wl_event_source_timer_update(self->source, POLL_INTERVAL_MS);
+            return 0;
+        }
+
+        delete self;
+        return 0;
+    }
+
+    /** Start watching @pid, @return false if it cannot be watched at all. */
+    static bool watch(wl_event_loop *loop, pid_t pid, int pidfd)
+    {
+        auto reaper = new child_reaper_t{pid, pidfd};
+        if (pidfd >= 0)
+        {
+            reaper->source = wl_event_loop_add_fd(loop, pidfd, WL_EVENT_READABLE, handle_exit, reaper);
+        }
+
+        if (!reaper->source)
+        {
+            reaper->source = wl_event_loop_add_timer(loop, handle_poll, reaper);
+            if (reaper->source)
+            {
+                wl_event_source_timer_update(reaper->source, POLL_INTERVAL_MS);
+            }
+        }
+
+        if (!reaper->source)
+        {
+            delete reaper;
+            return false;
+        }
+
+        return true;
+    }
+
+    ~child_reaper_t()
+    {
+        if (source)
+        {
+            wl_event_source_remove(source);
+        }
+
+        if (pidfd >= 0)
+        {
+            close(pidfd);
+        }
+    }
+};
+
+int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/** pidfds are available since Linux 5.3, older kernels fall back to the double fork. */
+bool supports_pidfd()
+{
+    static const bool supported = [] ()
+    {
+        int fd = open_pidfd(getpid());
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        close(fd);
+        return true;
+    }();
+
+    return supported;
+}
+}
+
+std::vector<std::pair<std::string, std::string>> wf::compositor_core_impl_t::get_command_environment()
+{
+    std::vector<std::pair<std::string, std::string>> environment = {
+        {"_JAVA_AWT_WM_NONREPARENTING", "1"},
+        {"WAYLAND_DISPLAY", wayland_display},
+    };
+
+#if WF_HAS_XWAYLAND
+    if (!xwayland_get_display().empty())
+    {
+        environment.push_back({"DISPLAY", xwayland_get_display()});
+    }
+
+#endif
+
+    return environment;
+}
+
 /**
  * Upon successful execution, returns the PID of the child process.
  * Returns 0 in case of failure.
  */
 pid_t wf::compositor_core_impl_t::run(std::string command)
+{
+    // Commands run during startup are typically the autostart programs.
+    wf::startup_profile::mark("spawn", command);
+    return supports_pidfd() ? spawn_command(command) : fork_command(command);
+}
+
+/**
+ * Start the command with posix_spawn(), which glibc implements with clone(CLONE_VM | CLONE_VFORK). Unlike
+ * fork(), it does not copy the page tables of the compositor, so the cost of starting a command does not grow
+ * with the size of the compositor's address space (mapped buffers, large heaps).
+ */
+pid_t wf::compositor_core_impl_t::spawn_command(const std::string& command)
+{
+    // The child cannot call setenv() between vfork and exec, so it gets a complete environment instead.
+    auto overrides = get_command_environment();
+    std::vector<std::string> environment;
+    for (char **var = environ; *var; ++var)
+    {
+        std::string entry = *var;
+        bool overridden   = std::any_of(overrides.begin(), overrides.end(), [&] (const auto& o)
+        {
+            return entry.compare(0, o.first.size() + 1, o.first + "=") == 0;
+        });
+
+        if (!overridden)
+        {
+            environment.push_back(std::move(entry));
+        }
+    }
+
+    for (auto& [name, value] : overrides)
+    {
+        environment.push_back(name + "=" + value);
+    }
+
+    std::vector<char*> envp;
+    for (auto& entry : environment)
+    {
+        envp.push_back(entry.data());
+    }
+
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (discard_command_output)
+    {
+        posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, 1, 2);
+    }
+
+    // The event loop blocks the signals it handles, the command should start with the default mask.
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t no_signals;
+    sigemptyset(&no_signals);
+    posix_spawnattr_setsigmask(&attr, &no_signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    pid_t pid;
+    const char *argv[] = {"/bin/sh", "-c", command.c_str(), nullptr};
+    int ret = posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char**>(argv), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (ret != 0)
+    {
+        LOGE("wf::compositor_core_impl_t::run(\"", command, "\"): posix_spawn failed: ", strerror(ret));
+        return 0;
+    }
+
+    // Opening the pidfd can still fail, for example when the compositor is out of file descriptors. The
+    // child is then polled with waitpid() instead, since it has to be reaped either way.
+    int pidfd = open_pidfd(pid);
+    if (pidfd < 0)
+    {
+        LOGW("wf::compositor_core_impl_t::run(\"", command, "\"): failed to open pidfd, polling the child: ",
+            strerror(errno));
+    }
+
+    if (!child_reaper_t::watch(ev_loop, pid, pidfd))
+    {
+        LOGE("wf::compositor_core_impl_t::run(\"", command, "\"): failed to watch the child process");
+    }
+
+    return pid;
+}
+
+/**
+ * Start the command with a double fork, so that the command is not a child of the compositor and does not
+ * need to be reaped.
+ */
+pid_t wf::compositor_core_impl_t::fork_command(const std::string& command)
 {
     static constexpr size_t READ_END  = 0;
     static constexpr size_t WRITE_END = 1;
 
+    auto environment = get_command_environment();
+
     int pipe_fd[2];
     int ret = pipe2(pipe_fd, O_CLOEXEC);
     if (ret == -1)
@@ -452,15 +892,11 @@ pid_t wf::compositor_core_impl_t::run(std::string command)
             close(pipe_fd[READ_END]);
             close(pipe_fd[WRITE_END]);
 
-            setenv("_JAVA_AWT_WM_NONREPARENTING", "1", 1);
-            setenv("WAYLAND_DISPLAY", wayland_display.c_str(), 1);
-#if WF_HAS_XWAYLAND
-            if (!xwayland_get_display().empty())
+            for (auto& [name, value] : environment)
             {
-                setenv("DISPLAY", xwayland_get_display().c_str(), 1);
+                setenv(name.c_str(), value.c_str(), 1);
             }
 
-#endif
             if (discard_command_output)
             {
                 int dev_null = open("/dev/null", O_WRONLY);
@@ -533,69 +969,159 @@ void wf::start_move_view_to_wset(wayfire_toplevel_view v, std::shared_ptr<wf::wo
 
 void wf::move_view_to_output(wayfire_toplevel_view v, wf::output_t *new_output, bool reconfigure)
 {
-    wf::dassert(!v->parent, "Cannot move a dialog to a different output than its parent!");
+    move_views_to_output({v}, new_output, reconfigure);
+}
 
-    auto old_output = v->get_output();
-    auto old_wset   = v->get_wset();
+void wf::move_views_to_output(const std::vector<wayfire_toplevel_view>& views, wf::output_t *new_output,
+    bool reconfigure)
+{
+    assert(new_output);
+    if (views.empty())
+    {
+        return;
+    }
 
-    uint32_t edges;
-    bool fullscreen;
-    wf::geometry_t view_g;
-    wf::geometry_t old_output_g;
-    wf::geometry_t new_output_g;
+    struct view_move_t
+    {
+        wayfire_toplevel_view view;
+        std::shared_ptr<wf::workspace_set_t> old_wset;
+        uint32_t edges  = 0;
+        bool fullscreen = false;
+        wf::geometry_t geometry;
+        int delta_x = 0;
+        int delta_y = 0;
+    };
+
+    auto new_wset = new_output->wset();
+    const auto new_output_g = new_output->get_relative_geometry();
+
+    std::vector<view_move_t> moves;
+    moves.reserve(views.size());
+    for (auto& v : views)
+    {
+        wf::dassert(!v->parent, "Cannot move a dialog to a different output than its parent!");
 
-    int delta_x = 0;
-    int delta_y = 0;
+        view_move_t move;
+        move.view     = v;
+        move.old_wset = v->get_wset();
+        if (reconfigure)
+        {
+            move.edges = v->pending_tiled_edges();
+            move.fullscreen = v->pending_fullscreen();
+            move.geometry   = v->get_pending_geometry();
+            auto old_output_g = v->get_output()->get_relative_geometry();
+            auto ratio_x = (double)new_output_g.width / old_output_g.width;
+            auto ratio_y = (double)new_output_g.height / old_output_g.height;
+            move.geometry.x *= ratio_x;
+            move.geometry.y *= ratio_y;
+
+            move.delta_x = move.geometry.x - v->get_pending_geometry().x;
+            move.delta_y = move.geometry.y - v->get_pending_geometry().y;
+        }
 
-    if (reconfigure)
+        moves.push_back(move);
+    }
+
+    for (auto& move : moves)
+    {
+        emit_view_pre_moved_to_wset_pre(move.view, move.view->get_wset(), new_wset);
+    }
+
+    // Detach all views from their old workspace sets, updating each affected scenegraph node only once
+    // instead of once per view.
+    std::unordered_set<wf::scene::node_t*> moved_nodes;
+    std::vector<wf::scene::floating_inner_node_t*> old_parents;
+    for (auto& move : moves)
     {
-        edges = v->pending_tiled_edges();
-        fullscreen = v->pending_fullscreen();
-        view_g     = v->get_pending_geometry();
-        old_output_g = old_output->get_relative_geometry();
-        new_output_g = new_output->get_relative_geometry();
-        auto ratio_x = (double)new_output_g.width / old_output_g.width;
-        auto ratio_y = (double)new_output_g.height / old_output_g.height;
-        view_g.x *= ratio_x;
-        view_g.y *= ratio_y;
+        if (auto wset = move.view->get_wset())
+        {
+            wset->remove_view(move.view);
+            auto node = move.view->get_root_node();
+            if (auto parent = dynamic_cast<wf::scene::floating_inner_node_t*>(node->parent()))
+            {
+                moved_nodes.insert(node.get());
+                if (std::find(old_parents.begin(), old_parents.end(), parent) == old_parents.end())
+                {
+                    old_parents.push_back(parent);
+                }
+            }
+        }
+    }
 
-        delta_x = view_g.x - v->get_pending_geometry().x;
-        delta_y = view_g.y - v->get_pending_geometry().y;
+    for (auto& parent : old_parents)
+    {
+        auto children = parent->get_children();
+        children.erase(std::remove_if(children.begin(), children.end(), [&] (const wf::scene::node_ptr& child)
+        {
+            return moved_nodes.count(child.get());
+        }), children.end());
+        parent->set_children_list(children);
+        wf::scene::update(parent->shared_from_this(), wf::scene::update_flag::CHILDREN_LIST);
     }
 
-    assert(new_output);
+    // The views keep their relative stacking order and end up above the views already on the new output.
+    auto new_children = new_wset->get_node()->get_children();
+    std::vector<wf::scene::node_ptr> front;
+    front.reserve(moves.size());
+    for (auto& move : moves)
+    {
+        front.push_back(move.view->get_root_node());
+    }
+
+    new_children.insert(new_children.begin(), front.begin(), front.end());
+    new_wset->get_node()->set_children_list(new_children);
+    wf::scene::update(new_wset->get_node(), wf::scene::update_flag::CHILDREN_LIST);
+    for (auto& move : moves)
+    {
+        new_wset->add_view(move.view);
+    }
 
-    start_move_view_to_wset(v, new_output->wset());
     if (new_output == wf::get_core().seat->get_active_output())
     {
-        wf::get_core().seat->focus_view(v);
+        wf::get_core().seat->focus_view(moves.front().view);
     }
 
     if (reconfigure)
     {
-        if (fullscreen)
+        // Apply the new geometry of all views in a single transaction.
+        const auto workarea = new_output->workarea->get_workarea();
+        wf::get_core().tx_manager->begin_batch();
+        for (auto& move : moves)
         {
-            wf::get_core().default_wm->fullscreen_request(v, new_output, true);
-        } else if (edges)
-        {
-            wf::get_core().default_wm->tile_request(v, edges);
-        } else
-        {
-            auto new_g = wf::clamp(view_g, new_output->workarea->get_workarea());
-            v->set_geometry(new_g);
-        }
+            auto& v = move.view;
+            if (move.fullscreen)
+            {
+                wf::get_core().default_wm->fullscreen_request(v, new_output, true);
+            } else if (move.edges)
+            {
+                wf::get_core().default_wm->tile_request(v, move.edges);
+            } else
+            {
+                v->set_geometry(wf::clamp(move.geometry, workarea));
+            }
 
-        for (auto& dialog : v->enumerate_views())
-        {
-            if ((dialog != v) && (delta_x || delta_y))
+            for (auto& dialog : v->enumerate_views())
             {
-                dialog->move(dialog->get_pending_geometry().x + delta_x,
-                    dialog->get_pending_geometry().y + delta_y);
+                if ((dialog != v) && (move.delta_x || move.delta_y))
+                {
+                    dialog->move(dialog->get_pending_geometry().x + move.delta_x,
+                        dialog->get_pending_geometry().y + move.delta_y);
+                }
             }
         }
+
+        wf::get_core().tx_manager->end_batch();
+    }
+
+    views_moved_to_output_signal data;
+    data.output = new_output;
+    for (auto& move : moves)
+    {
+        emit_view_moved_to_wset(move.view, move.old_wset, new_wset);
+        data.views.push_back(move.view);
     }
 
-    emit_view_moved_to_wset(v, old_wset, new_output->wset());
+    wf::get_core().emit(&data);
 }
 
 const std::shared_ptr<wf::scene::root_node_t>& wf::compositor_core_impl_t::scene()
@@ -614,6 +1140,7 @@ wf::compositor_core_impl_t::~compositor_core_impl_t()
 {
     input.reset();
     output_layout.reset();
+    view_index.reset();
 }
 
 wf::compositor_core_t& wf::compositor_core_t::get()
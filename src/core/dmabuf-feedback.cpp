@@ -0,0 +1,274 @@
+#include "dmabuf-feedback.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/debug.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+/* Keep the scanout feedback while the surface is not a candidate for up to this many frames, so that
+ * clients do not reallocate their buffers each time scanout is briefly blocked, e.g. by a popup. */
+constexpr int RESET_DELAY_FRAMES = 60;
+}
+
+struct wf::dmabuf_feedback_manager_t::output_state_t
+{
+    // The feedback with the scanout tranche of the output, built when it is first needed.
+    wlr_linux_dmabuf_feedback_v1 feedback;
+    bool feedback_initialized = false;
+    bool feedback_unsupported = false;
+
+    // The candidate reported in the current frame.
+    wlr_surface *pending = nullptr;
+    // The surface which has the scanout feedback of the output.
+    wlr_surface *current = nullptr;
+    wf::wl_listener_wrapper on_current_destroy;
+    int missed_frames = 0;
+
+    wf::option_wrapper_t<std::string> gpu_affinity;
+    // The DRM device driving the output, or 0 if it is not driven by a DRM device.
+    dev_t device = 0;
+
+    ~output_state_t()
+    {
+        if (feedback_initialized)
+        {
+            wlr_linux_dmabuf_feedback_v1_finish(&feedback);
+        }
+    }
+};
+
+struct wf::dmabuf_feedback_manager_t::affinity_t
+{
+    wf::output_t *output;
+    wf::wl_listener_wrapper on_destroy;
+};
+
+namespace
+{
+dev_t get_device(int drm_fd)
+{
+    struct stat dev_stat;
+    if ((drm_fd < 0) || (fstat(drm_fd, &dev_stat) != 0))
+    {
+        return 0;
+    }
+
+    return dev_stat.st_rdev;
+}
+}
+
+wf::dmabuf_feedback_manager_t::dmabuf_feedback_manager_t(wlr_linux_dmabuf_v1 *linux_dmabuf,
+    wlr_renderer *renderer) : linux_dmabuf(linux_dmabuf), renderer(renderer)
+{}
+
+wf::dmabuf_feedback_manager_t::~dmabuf_feedback_manager_t()
+{
+    for (auto& [surface, affinity] : affinities)
+    {
+        wlr_linux_dmabuf_v1_set_surface_feedback(linux_dmabuf, surface, nullptr);
+    }
+
+    affinities.clear();
+    for (auto& [output, state] : outputs)
+    {
+        reset_feedback(*state);
+    }
+}
+
+wf::dmabuf_feedback_manager_t::output_state_t& wf::dmabuf_feedback_manager_t::get_state(
+    wf::output_t *output)
+{
+    auto& state = outputs[output];
+    if (!state)
+    {
+        state = std::make_unique<output_state_t>();
+        auto section = wf::get_core().config_backend->get_output_section(output->handle);
+        state->gpu_affinity.load_option(section->get_name() + "/gpu_affinity");
+        state->device = get_device(wlr_backend_get_drm_fd(output->handle->backend));
+    }
+
+    return *state;
+}
+
+void wf::dmabuf_feedback_manager_t::reset_feedback(output_state_t& state)
+{
+    if (state.current)
+    {
+        set_default_feedback(state.current);
+        state.on_current_destroy.disconnect();
+        state.current = nullptr;
+    }
+
+    state.missed_frames = 0;
+}
+
+void wf::dmabuf_feedback_manager_t::set_candidate(wf::output_t *output, wlr_surface *surface)
+{
+    get_state(output).pending = surface;
+}
+
+void wf::dmabuf_feedback_manager_t::commit_frame(wf::output_t *output)
+{
+    static wf::option_wrapper_t<bool> scanout_feedback{"core/scanout_dmabuf_feedback"};
+
+    auto& state    = get_state(output);
+    auto candidate = std::exchange(state.pending, nullptr);
+    if (!scanout_feedback)
+    {
+        reset_feedback(state);
+        return;
+    }
+
+    if (candidate == state.current)
+    {
+        state.missed_frames = 0;
+        return;
+    }
+
+    if (!candidate)
+    {
+        if (state.current && (++state.missed_frames >= RESET_DELAY_FRAMES))
+        {
+            LOGC(SCANOUT, "Surface ", state.current, " is no longer a scanout candidate on ",
+                output->to_string(), ", restoring the default dmabuf feedback.");
+            reset_feedback(state);
+        }
+
+        return;
+    }
+
+    reset_feedback(state);
+    auto feedback = get_output_feedback(output);
+    if (!feedback || !wlr_linux_dmabuf_v1_set_surface_feedback(linux_dmabuf, candidate, feedback))
+    {
+        return;
+    }
+
+    LOGC(SCANOUT, "Sending scanout dmabuf feedback of ", output->to_string(), " to surface ", candidate);
+    state.current = candidate;
+    state.on_current_destroy.set_callback([&state] (void*)
+    {
+        state.on_current_destroy.disconnect();
+        state.current = nullptr;
+    });
+    state.on_current_destroy.connect(&candidate->events.destroy);
+}
+
+wlr_linux_dmabuf_feedback_v1*wf::dmabuf_feedback_manager_t::get_output_feedback(wf::output_t *output)
+{
+    auto& state = get_state(output);
+    if (state.feedback_unsupported)
+    {
+        return nullptr;
+    }
+
+    if (!state.feedback_initialized)
+    {
+        wlr_linux_dmabuf_feedback_v1_init_options options = {};
+        options.main_renderer = renderer;
+        options.scanout_primary_output = output->handle;
+        if (!wlr_linux_dmabuf_feedback_v1_init_with_options(&state.feedback, &options))
+        {
+            LOGC(SCANOUT, "Cannot build scanout dmabuf feedback for ", output->to_string());
+            state.feedback_unsupported = true;
+            return nullptr;
+        }
+
+        state.feedback_initialized = true;
+    }
+
+    return &state.feedback;
+}
+
+bool wf::dmabuf_feedback_manager_t::prefers_own_gpu(wf::output_t *output)
+{
+    auto& state = get_state(output);
+    return ((std::string)state.gpu_affinity == "output") && state.device &&
+           (state.device != get_device(wlr_renderer_get_drm_fd(renderer)));
+}
+
+void wf::dmabuf_feedback_manager_t::set_default_feedback(wlr_surface *surface)
+{
+    auto it = affinities.find(surface);
+    auto feedback = (it != affinities.end()) ? get_output_feedback(it->second->output) : nullptr;
+    // Passing no feedback makes the surface use the default feedback again.
+    wlr_linux_dmabuf_v1_set_surface_feedback(linux_dmabuf, surface, feedback);
+}
+
+void wf::dmabuf_feedback_manager_t::set_visible_outputs(wlr_surface *surface,
+    const std::vector<wf::output_t*>& visible_outputs)
+{
+    wf::output_t *target = nullptr;
+    for (auto output : visible_outputs)
+    {
+        if (!prefers_own_gpu(output) || (target && (get_state(target).device != get_state(output).device)))
+        {
+            target = nullptr;
+            break;
+        }
+
+        if (!target)
+        {
+            target = output;
+        }
+    }
+
+    auto it = affinities.find(surface);
+    wf::output_t *current = (it != affinities.end()) ? it->second->output : nullptr;
+    if (current == target)
+    {
+        return;
+    }
+
+    if (target)
+    {
+        auto& affinity = affinities[surface];
+        affinity = std::make_unique<affinity_t>();
+        affinity->output = target;
+        affinity->on_destroy.set_callback([=] (void*) { affinities.erase(surface); });
+        affinity->on_destroy.connect(&surface->events.destroy);
+        LOGC(SCANOUT, "Surface ", surface, " is shown only on ", target->to_string(),
+            ", preferring buffers of its GPU.");
+    } else
+    {
+        affinities.erase(it);
+    }
+
+    // A scanout candidate keeps its feedback, and gets the new default feedback when it is reset.
+    const bool is_candidate = std::any_of(outputs.begin(), outputs.end(),
+        [=] (const auto& state) { return state.second->current == surface; });
+    if (!is_candidate)
+    {
+        set_default_feedback(surface);
+    }
+}
+
+void wf::dmabuf_feedback_manager_t::remove_output(wf::output_t *output)
+{
+    for (auto it = affinities.begin(); it != affinities.end();)
+    {
+        if (it->second->output == output)
+        {
+            auto surface = it->first;
+            it = affinities.erase(it);
+            wlr_linux_dmabuf_v1_set_surface_feedback(linux_dmabuf, surface, nullptr);
+        } else
+        {
+            ++it;
+        }
+    }
+
+    auto it = outputs.find(output);
+    if (it != outputs.end())
+    {
+        reset_feedback(*it->second);
+        outputs.erase(it);
+    }
+}
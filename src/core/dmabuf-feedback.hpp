@@ -0,0 +1,68 @@
+#ifndef WF_CORE_DMABUF_FEEDBACK_HPP
+#define WF_CORE_DMABUF_FEEDBACK_HPP
+
+#include <wayfire/nonstd/wlroots.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace wf
+{
+class output_t;
+
+/**
+ * Sends per-surface linux-dmabuf feedback to clients whose surfaces could be scanned out directly.
+ *
+ * On each frame where direct scanout is possible, the surface which covers the whole output reports itself
+ * as the scanout candidate of the output, even if its current buffer cannot be scanned out. The candidate
+ * gets feedback with a scanout tranche listing the formats and modifiers of the primary plane of the output,
+ * so that the client can allocate buffers which the display engine can show without composition. When the
+ * surface has not been a candidate for a while, it gets the default feedback again.
+ *
+ * Outputs driven by another GPU than the renderer's can set output/gpu_affinity to "output". Surfaces shown
+ * only on such outputs (of the same GPU) then keep the feedback of the output instead of the default one,
+ * so that clients allocate buffers which that GPU can scan out, without a copy through the primary GPU.
+ */
+class dmabuf_feedback_manager_t
+{
+  public:
+    dmabuf_feedback_manager_t(wlr_linux_dmabuf_v1 *linux_dmabuf, wlr_renderer *renderer);
+    ~dmabuf_feedback_manager_t();
+
+    dmabuf_feedback_manager_t(const dmabuf_feedback_manager_t&) = delete;
+    dmabuf_feedback_manager_t& operator =(const dmabuf_feedback_manager_t&) = delete;
+
+    /** Report @surface as the scanout candidate of the current frame of @output. */
+    void set_candidate(wf::output_t *output, wlr_surface *surface);
+
+    /** Update the feedback of the candidate of @output, after direct scanout was attempted for a frame. */
+    void commit_frame(wf::output_t *output);
+
+    /**
+     * Update the feedback of @surface after the set of outputs it is visible on changed.
+     * The surface gets the feedback of the outputs if all of them prefer their own GPU.
+     */
+    void set_visible_outputs(wlr_surface *surface, const std::vector<wf::output_t*>& outputs);
+
+    /** Forget the state of an output which is being destroyed. */
+    void remove_output(wf::output_t *output);
+
+  private:
+    struct output_state_t;
+    struct affinity_t;
+
+    wlr_linux_dmabuf_v1 *linux_dmabuf;
+    wlr_renderer *renderer;
+    std::unordered_map<wf::output_t*, std::unique_ptr<output_state_t>> outputs;
+    // Surfaces which are shown only on outputs preferring their own GPU.
+    std::unordered_map<wlr_surface*, std::unique_ptr<affinity_t>> affinities;
+
+    output_state_t& get_state(wf::output_t *output);
+    void reset_feedback(output_state_t& state);
+    wlr_linux_dmabuf_feedback_v1 *get_output_feedback(wf::output_t *output);
+    bool prefers_own_gpu(wf::output_t *output);
+    void set_default_feedback(wlr_surface *surface);
+};
+}
+
+#endif /* end of include guard: WF_CORE_DMABUF_FEEDBACK_HPP */
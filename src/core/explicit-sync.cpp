@@ -0,0 +1,146 @@
+#include "explicit-sync.hpp"
+#include <wayfire/debug.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+#include <xf86drm.h>
+#include <unistd.h>
+
+wf::explicit_sync_acquire_t::explicit_sync_acquire_t(wlr_drm_syncobj_timeline *timeline, uint64_t point) :
+    timeline(wlr_drm_syncobj_timeline_ref(timeline)), point(point)
+{}
+
+wf::explicit_sync_acquire_t::~explicit_sync_acquire_t()
+{
+    wlr_drm_syncobj_timeline_unref(timeline);
+}
+
+void wf::explicit_sync_acquire_t::wait_gpu()
+{
+    if (waited)
+    {
+        return;
+    }
+
+    waited = true;
+    int fd = wlr_drm_syncobj_timeline_export_sync_file(timeline, point);
+    if (fd < 0)
+    {
+        LOGE("Failed to export the acquire point of a buffer, it may be rendered before it is ready.");
+        return;
+    }
+
+    if (!OpenGL::wait_sync_file(fd))
+    {
+        LOGE("Failed to wait for the acquire point of a buffer, it may be rendered before it is ready.");
+    }
+}
+
+std::shared_ptr<wf::explicit_sync_acquire_t> wf::explicit_sync_acquire_t::from_surface(wlr_surface *surface,
+    const std::shared_ptr<explicit_sync_acquire_t>& previous)
+{
+    auto state = wlr_linux_drm_syncobj_v1_get_surface_state(surface);
+    if (!state || !state->acquire_timeline || !surface->buffer)
+    {
+        return nullptr;
+    }
+
+    if (previous && (previous->timeline == state->acquire_timeline) && (previous->point == state->acquire_point))
+    {
+        return previous;
+    }
+
+    return std::make_shared<explicit_sync_acquire_t>(state->acquire_timeline, state->acquire_point);
+}
+
+struct wf::explicit_sync_manager_t::surface_t
+{
+    wf::wl_listener_wrapper on_commit;
+    wf::wl_listener_wrapper on_destroy;
+};
+
+struct wf::explicit_sync_manager_t::release_t
+{
+    wlr_drm_syncobj_timeline *timeline;
+    uint64_t point;
+    wf::wl_listener_wrapper on_buffer_release;
+    wf::wl_listener_wrapper on_buffer_destroy;
+
+    ~release_t()
+    {
+        wlr_drm_syncobj_timeline_unref(timeline);
+    }
+};
+
+wf::explicit_sync_manager_t::explicit_sync_manager_t(wlr_compositor *compositor)
+{
+    on_new_surface.set_callback([=] (void *data)
+    {
+        auto surface = (wlr_surface*)data;
+        auto& state  = surfaces[surface];
+        state = std::make_unique<surface_t>();
+        state->on_commit.set_callback([=] (void*) { handle_commit(surface); });
+        state->on_commit.connect(&surface->events.commit);
+        state->on_destroy.set_callback([=] (void*) { surfaces.erase(surface); });
+        state->on_destroy.connect(&surface->events.destroy);
+    });
+    on_new_surface.connect(&compositor->events.new_surface);
+}
+
+wf::explicit_sync_manager_t::~explicit_sync_manager_t()
+{
+    // Do not leave clients waiting for buffers which will never be released.
+    while (!releases.empty())
+    {
+        signal_release(releases.front().get());
+    }
+}
+
+void wf::explicit_sync_manager_t::handle_commit(wlr_surface *surface)
+{
+    auto state = wlr_linux_drm_syncobj_v1_get_surface_state(surface);
+    if (!state || !state->release_timeline || !surface->buffer ||
+        !(surface->current.committed & WLR_SURFACE_STATE_BUFFER))
+    {
+        return;
+    }
+
+    auto release = std::make_unique<release_t>();
+    release->timeline = wlr_drm_syncobj_timeline_ref(state->release_timeline);
+    release->point    = state->release_point;
+
+    // The surface node locks the buffer while it is the current state of the surface, and scanout or
+    // rendering may lock it for longer. The buffer is released once all of them are done with it.
+    auto ptr = release.get();
+    ptr->on_buffer_release.set_callback([=] (void*) { signal_release(ptr); });
+    ptr->on_buffer_release.connect(&surface->buffer->base.events.release);
+    ptr->on_buffer_destroy.set_callback([=] (void*) { signal_release(ptr); });
+    ptr->on_buffer_destroy.connect(&surface->buffer->base.events.destroy);
+    releases.push_back(std::move(release));
+}
+
+void wf::explicit_sync_manager_t::signal_release(release_t *release)
+{
+    int fd = OpenGL::export_render_fence();
+    bool signalled = false;
+    if (fd >= 0)
+    {
+        signalled = wlr_drm_syncobj_timeline_import_sync_file(release->timeline, release->point, fd);
+        close(fd);
+    }
+
+    if (!signalled)
+    {
+        // Without a fence, wait until the GPU is done with the buffer before signalling from the CPU.
+        OpenGL::render_begin();
+        GL_CALL(glFinish());
+        OpenGL::render_end();
+        if (drmSyncobjTimelineSignal(release->timeline->drm_fd, &release->timeline->handle,
+            &release->point, 1) != 0)
+        {
+            LOGE("Failed to signal the release point of a buffer");
+        }
+    }
+
+    releases.remove_if([=] (const auto& r) { return r.get() == release; });
+}
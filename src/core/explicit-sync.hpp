@@ -0,0 +1,82 @@
+#ifndef WF_CORE_EXPLICIT_SYNC_HPP
+#define WF_CORE_EXPLICIT_SYNC_HPP
+
+#include <wayfire/nonstd/wlroots.hpp>
+#include <wayfire/util.hpp>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+struct wlr_drm_syncobj_timeline;
+
+namespace wf
+{
+/**
+ * The acquire point of a buffer committed by a client which uses linux-drm-syncobj. The buffer may be used
+ * only after the point is signalled.
+ */
+struct explicit_sync_acquire_t
+{
+    wlr_drm_syncobj_timeline *timeline;
+    uint64_t point;
+
+    explicit_sync_acquire_t(wlr_drm_syncobj_timeline *timeline, uint64_t point);
+    ~explicit_sync_acquire_t();
+
+    explicit_sync_acquire_t(const explicit_sync_acquire_t&) = delete;
+    explicit_sync_acquire_t& operator =(const explicit_sync_acquire_t&) = delete;
+
+    /**
+     * Make the GPU wait for the acquire point before it executes the GL commands submitted afterwards.
+     * The compositor thread does not block. Since all rendering happens in the same GL context, the wait
+     * is inserted only the first time.
+     *
+     * Must be called with the GL context current, before the buffer's texture is first sampled.
+     */
+    void wait_gpu();
+
+    /**
+     * Get the acquire point of the current buffer of @surface.
+     *
+     * @param previous The acquire point of the previous state of the surface. It is returned again if the
+     *   surface's acquire point did not change, so that the GPU does not wait for it twice.
+     * @return The acquire point, or nullptr if the surface does not use explicit synchronization.
+     */
+    static std::shared_ptr<explicit_sync_acquire_t> from_surface(wlr_surface *surface,
+        const std::shared_ptr<explicit_sync_acquire_t>& previous);
+
+  private:
+    bool waited = false;
+};
+
+/**
+ * Signals the release points of buffers committed by clients which use linux-drm-syncobj.
+ *
+ * A release point is signalled when the compositor drops its last lock on the buffer, which happens after
+ * the last frame using the buffer was rendered or scanned out. At that time the GPU may still be reading
+ * the buffer, so the release point gets a fence of the GL commands submitted so far instead of being
+ * signalled right away. If the driver cannot export fences, the point is signalled immediately.
+ */
+class explicit_sync_manager_t
+{
+  public:
+    explicit_sync_manager_t(wlr_compositor *compositor);
+    ~explicit_sync_manager_t();
+
+    explicit_sync_manager_t(const explicit_sync_manager_t&) = delete;
+    explicit_sync_manager_t& operator =(const explicit_sync_manager_t&) = delete;
+
+  private:
+    struct surface_t;
+    struct release_t;
+
+    wf::wl_listener_wrapper on_new_surface;
+    std::unordered_map<wlr_surface*, std::unique_ptr<surface_t>> surfaces;
+    std::list<std::unique_ptr<release_t>> releases;
+
+    void handle_commit(wlr_surface *surface);
+    void signal_release(release_t *release);
+};
+}
+
+#endif /* end of include guard: WF_CORE_EXPLICIT_SYNC_HPP */
@@ -121,3 +121,10 @@ void enable_gl_synchronous_debug()
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
     glDebugMessageCallback(errorHandler, 0);
 }
+
+void disable_gl_synchronous_debug()
+{
+    glDebugMessageCallback(nullptr, 0);
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDisable(GL_DEBUG_OUTPUT);
+}
@@ -1,18 +1,43 @@
 #include <wayfire/idle.hpp>
+#include <wayfire/util.hpp>
 #include <wayfire/util/log.hpp>
 #include "core/seat/input-manager.hpp"
 #include "core-impl.hpp"
 
 unsigned int wf::idle_inhibitor_t::inhibitors = 0;
 
+namespace
+{
+/* Whether the last idle_inhibit_changed_signal reported an inhibited state. */
+bool announced_inhibit = false;
+wf::wl_idle_call idle_announce;
+}
+
 void wf::idle_inhibitor_t::notify_update()
 {
-    /* NOTE: inhibited -> NOT enabled */
-    wlr_idle_notifier_v1_set_inhibited(wf::get_core().protocols.idle_notifier, inhibitors != 0);
+    if (wf::get_core().get_current_state() == wf::compositor_state_t::SHUTDOWN)
+    {
+        return;
+    }
+
+    // Clients like video players create and destroy inhibitors in quick succession, so the changes are
+    // collected and only the resulting state is announced, once per event loop iteration.
+    idle_announce.run_once([] ()
+    {
+        const bool inhibit = (inhibitors != 0);
+        if (inhibit == announced_inhibit)
+        {
+            return;
+        }
+
+        announced_inhibit = inhibit;
+        /* NOTE: inhibited -> NOT enabled */
+        wlr_idle_notifier_v1_set_inhibited(wf::get_core().protocols.idle_notifier, inhibit);
 
-    wf::idle_inhibit_changed_signal data;
-    data.inhibit = (inhibitors != 0);
-    wf::get_core().emit(&data);
+        wf::idle_inhibit_changed_signal data;
+        data.inhibit = inhibit;
+        wf::get_core().emit(&data);
+    });
 }
 
 wf::idle_inhibitor_t::idle_inhibitor_t()
@@ -2,6 +2,8 @@
 #include <wayfire/util/log.hpp>
 #include "wayfire/img.hpp"
 #include "wayfire/opengl.hpp"
+#include "wayfire/core.hpp"
+#include "wayfire/thread-pool.hpp"
 
 #include <config.h>
 
@@ -14,6 +16,8 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <unordered_map>
 #include <functional>
@@ -22,12 +26,12 @@
 
 namespace image_io
 {
-using Loader = std::function<bool (const char*, GLuint)>;
+using Decoder = std::function<std::optional<decoded_image_t> (const char*)>;
 using Writer = std::function<void (const char*name, uint8_t*pixels, unsigned long,
     unsigned long, bool)>;
 namespace
 {
-std::unordered_map<std::string, Loader> loaders;
+std::unordered_map<std::string, Decoder> decoders;
 std::unordered_map<std::string, Writer> writers;
 }
 
@@ -121,42 +125,46 @@ bool load_data_as_cubemap(unsigned char *data, int width, int height, int channe
 #ifdef BUILD_WITH_IMAGEIO
 /* All backend functions are taken from the internet.
  * If you want to be credited, contact me */
-bool texture_from_png(const char *filename, GLuint target)
+std::optional<decoded_image_t> decode_png(const char *filename)
 {
     FILE *fp = fopen(filename, "rb");
-    int width, height;
-    png_byte color_type;
-    png_byte bit_depth;
-    png_bytep *row_pointers;
+    if (!fp)
+    {
+        return {};
+    }
 
     png_structp png =
         png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!png)
     {
         fclose(fp);
-        return false;
+        return {};
     }
 
     png_infop infos = png_create_info_struct(png);
     if (!infos)
     {
+        png_destroy_read_struct(&png, NULL, NULL);
         fclose(fp);
-        return false;
+        return {};
     }
 
+    decoded_image_t image;
+    std::vector<png_bytep> row_pointers;
     if (setjmp(png_jmpbuf(png)))
     {
+        png_destroy_read_struct(&png, &infos, NULL);
         fclose(fp);
-        return false;
+        return {};
     }
 
     png_init_io(png, fp);
     png_read_info(png, infos);
 
-    width  = png_get_image_width(png, infos);
-    height = png_get_image_height(png, infos);
-    color_type = png_get_color_type(png, infos);
-    bit_depth  = png_get_bit_depth(png, infos);
+    image.width  = png_get_image_width(png, infos);
+    image.height = png_get_image_height(png, infos);
+    png_byte color_type = png_get_color_type(png, infos);
+    png_byte bit_depth  = png_get_bit_depth(png, infos);
 
     if (bit_depth == 16)
     {
@@ -195,40 +203,20 @@ bool texture_from_png(const char *filename, GLuint target)
 
     png_read_update_info(png, infos);
 
-    row_pointers = new png_bytep[height];
-    png_byte *data = new png_byte[height * png_get_rowbytes(png, infos)];
-
-    for (int i = 0; i < height; i++)
+    const size_t stride = png_get_rowbytes(png, infos);
+    image.channels = png_get_channels(png, infos);
+    image.pixels.resize(image.height * stride);
+    row_pointers.resize(image.height);
+    for (int i = 0; i < image.height; i++)
     {
-        row_pointers[i] = data + i * png_get_rowbytes(png, infos);
-    }
-
-    png_read_image(png, row_pointers);
-
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(data, width, height,
-            png_get_channels(png, infos)))
-        {
-            png_destroy_read_struct(&png, &infos, NULL);
-            delete[] row_pointers;
-            delete[] data;
-            fclose(fp);
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGBA, width, height, 0,
-            GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)data));
+        row_pointers[i] = image.pixels.data() + i * stride;
     }
 
+    png_read_image(png, row_pointers.data());
     png_destroy_read_struct(&png, &infos, NULL);
-    delete[] row_pointers;
-    delete[] data;
-
     fclose(fp);
 
-    return true;
+    return image;
 }
 
 void texture_to_png(const char *name, uint8_t *pixels, int w, int h, bool invert)
@@ -295,67 +283,52 @@ void texture_to_png(const char *name, uint8_t *pixels, int w, int h, bool invert
     png_free(png, rows);
 }
 
-bool texture_from_jpeg(const char *FileName, GLuint target)
+std::optional<decoded_image_t> decode_jpeg(const char *FileName)
 {
-    unsigned long data_size;
     unsigned char *rowptr[1];
-    unsigned char *jdata;
     struct jpeg_decompress_struct infot;
     struct jpeg_error_mgr err;
 
     std::FILE *file = fopen(FileName, "rb");
-    infot.err = jpeg_std_error(&err);
-    jpeg_create_decompress(&infot);
-
     if (!file)
     {
-        LOGE("failed to read JPEG file ", FileName);
-
-        return false;
+        return {};
     }
 
+    infot.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&infot);
     jpeg_stdio_src(&infot, file);
     jpeg_read_header(&infot, TRUE);
-    jpeg_start_decompress(&infot);
+    if (infot.jpeg_color_space == JCS_GRAYSCALE)
+    {
+        // Expand grayscale images, so that the output always has 3 channels.
+        infot.out_color_space = JCS_RGB;
+    }
 
-    data_size = infot.output_width * infot.output_height * 3;
+    jpeg_start_decompress(&infot);
 
-    jdata = new unsigned char [data_size];
+    decoded_image_t image;
+    image.width    = infot.output_width;
+    image.height   = infot.output_height;
+    image.channels = 3;
+    image.pixels.resize(image.width * image.height * 3);
     while (infot.output_scanline < infot.output_height)
     {
-        rowptr[0] = (unsigned char*)jdata + 3 * infot.output_width *
+        rowptr[0] = image.pixels.data() + 3 * infot.output_width *
             infot.output_scanline;
         jpeg_read_scanlines(&infot, rowptr, 1);
     }
 
     jpeg_finish_decompress(&infot);
-
-    GLint width  = infot.output_width;
-    GLint height = infot.output_height;
-
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(jdata, width, height, 3))
-        {
-            fclose(file);
-            delete[] jdata;
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGB, width, height, 0,
-            GL_RGB, GL_UNSIGNED_BYTE, jdata));
-    }
-
+    jpeg_destroy_decompress(&infot);
     fclose(file);
-    delete[] jdata;
 
-    return true;
+    return image;
 }
 
 #endif
 
-bool load_from_file(std::string name, GLuint target)
+std::optional<decoded_image_t> decode_from_file(std::string name)
 {
     if (access(name.c_str(), F_OK) == -1)
     {
@@ -364,7 +337,7 @@ bool load_from_file(std::string name, GLuint target)
             LOGE(__func__, "() cannot access ", name);
         }
 
-        return false;
+        return {};
     }
 
     int len = name.length();
@@ -373,7 +346,7 @@ bool load_from_file(std::string name, GLuint target)
         LOGE(
             "load_from_file() called with file without extension or with invalid extension!");
 
-        return false;
+        return {};
     }
 
     auto ext = name.substr(len - 3, 3);
@@ -382,16 +355,155 @@ bool load_from_file(std::string name, GLuint target)
         ext[i] = std::tolower(ext[i]);
     }
 
-    auto it = loaders.find(ext);
-    if (it == loaders.end())
+    auto it = decoders.find(ext);
+    if (it == decoders.end())
     {
         LOGE("load_from_file() called with unsupported extension ", ext);
 
-        return false;
-    } else
+        return {};
+    }
+
+    auto image = it->second(name.c_str());
+    if (!image)
     {
-        return it->second(name.c_str(), target);
+        LOGE("failed to decode image ", name);
     }
+
+    return image;
+}
+
+void downscale_to_fit(decoded_image_t& image, int max_width, int max_height)
+{
+    if ((max_width <= 0) || (max_height <= 0) ||
+        ((image.width <= max_width) && (image.height <= max_height)))
+    {
+        return;
+    }
+
+    const double scale = std::min((double)max_width / image.width,
+        (double)max_height / image.height);
+    const int width  = std::max(1, (int)(image.width * scale));
+    const int height = std::max(1, (int)(image.height * scale));
+    const int channels = image.channels;
+
+    // Each destination pixel is the average of the block of source pixels it covers.
+    std::vector<uint8_t> pixels((size_t)width * height * channels);
+    for (int y = 0; y < height; y++)
+    {
+        const int sy0 = (int64_t)y * image.height / height;
+        const int sy1 = std::max(sy0 + 1, (int)((int64_t)(y + 1) * image.height / height));
+        for (int x = 0; x < width; x++)
+        {
+            const int sx0 = (int64_t)x * image.width / width;
+            const int sx1 = std::max(sx0 + 1, (int)((int64_t)(x + 1) * image.width / width));
+            const uint32_t count = (sy1 - sy0) * (sx1 - sx0);
+            for (int c = 0; c < channels; c++)
+            {
+                uint32_t sum = 0;
+                for (int sy = sy0; sy < sy1; sy++)
+                {
+                    const uint8_t *row = image.pixels.data() + (size_t)sy * image.width * channels;
+                    for (int sx = sx0; sx < sx1; sx++)
+                    {
+                        sum += row[sx * channels + c];
+                    }
+                }
+
+                pixels[((size_t)y * width + x) * channels + c] = sum / count;
+            }
+        }
+    }
+
+    image.width  = width;
+    image.height = height;
+    image.pixels = std::move(pixels);
+}
+
+bool upload(const decoded_image_t& image, GLuint target)
+{
+    if (target == GL_TEXTURE_CUBE_MAP)
+    {
+        return load_data_as_cubemap((unsigned char*)image.pixels.data(),
+            image.width, image.height, image.channels);
+    } else if (target == GL_TEXTURE_2D)
+    {
+        auto format = (image.channels == 4 ? GL_RGBA : GL_RGB);
+        GL_CALL(glTexImage2D(target, 0, format, image.width, image.height, 0,
+            format, GL_UNSIGNED_BYTE, (GLvoid*)image.pixels.data()));
+    }
+
+    return true;
+}
+
+bool load_from_file(std::string name, GLuint target)
+{
+    auto image = decode_from_file(name);
+    return image && upload(*image, target);
+}
+
+struct async_load_t::impl
+{
+    std::string name;
+    int max_width;
+    int max_height;
+
+    /* Accessed only on the main thread. */
+    async_load_callback_t callback;
+
+    /* Set by the worker before the completion is queued on the main loop. */
+    std::optional<decoded_image_t> result;
+    std::atomic<bool> cancelled = false;
+};
+
+namespace
+{
+/* Images are decoded on the compositor's thread pool. */
+std::unique_ptr<wf::task_group_t> decode_tasks;
+}
+
+async_load_t::~async_load_t()
+{
+    priv->cancelled = true;
+    priv->callback  = nullptr;
+}
+
+std::unique_ptr<async_load_t> load_from_file_async(std::string name,
+    async_load_callback_t callback, int max_width, int max_height)
+{
+    if (!decode_tasks)
+    {
+        decode_tasks = std::make_unique<wf::task_group_t>();
+    }
+
+    auto load = std::make_unique<async_load_t>();
+    load->priv = std::make_shared<async_load_t::impl>();
+    load->priv->name       = std::move(name);
+    load->priv->max_width  = max_width;
+    load->priv->max_height = max_height;
+    load->priv->callback   = std::move(callback);
+
+    auto job = load->priv;
+    decode_tasks->submit([job] ()
+    {
+        if (!job->cancelled)
+        {
+            job->result = decode_from_file(job->name);
+            if (job->result)
+            {
+                downscale_to_fit(*job->result, job->max_width, job->max_height);
+            }
+        }
+    }, [job] ()
+    {
+        // The callback may destroy the async_load_t, so take it out first.
+        auto callback = std::move(job->callback);
+        if (!job->cancelled && callback)
+        {
+            callback(std::move(job->result));
+        }
+    });
+
+    return load;
 }
 
 void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type,
@@ -424,9 +536,14 @@ void init()
 {
     LOGD("init ImageIO");
 #ifdef BUILD_WITH_IMAGEIO
-    loaders["png"] = Loader(texture_from_png);
-    loaders["jpg"] = Loader(texture_from_jpeg);
+    decoders["png"] = Decoder(decode_png);
+    decoders["jpg"] = Decoder(decode_jpeg);
     writers["png"] = Writer(texture_to_png);
 #endif
 }
+
+void fini()
+{
+    decode_tasks.reset();
+}
 }
@@ -0,0 +1,377 @@
+#include <wayfire/log-ring.hpp>
+#include <wayfire/debug.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+using clock = std::chrono::system_clock;
+
+enum record_kind_t : uint32_t
+{
+    // Fills the space at the end of the buffer which is too small for the next record.
+    RECORD_PADDING = 0,
+    RECORD_MESSAGE = 1,
+};
+
+/* Records are aligned to 8 bytes, so that the header can always be read in place and a padding record fits
+ * in any space left at the end of the buffer. */
+struct record_header_t
+{
+    uint32_t size;
+    uint32_t kind;
+    int64_t time_us;
+    uint32_t category;
+    int32_t line;
+    uint32_t payload_size;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(record_header_t) % 8 == 0);
+static_assert(wf::log::ring::RING_CAPACITY % 8 == 0);
+
+size_t align8(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+struct thread_ring_t;
+
+struct registry_t
+{
+    std::mutex mutex;
+    std::vector<thread_ring_t*> rings;
+};
+
+registry_t& registry()
+{
+    // Leaked on purpose, so that rings of threads which exit late can still unregister.
+    static registry_t *registry = new registry_t;
+    return *registry;
+}
+
+struct thread_ring_t
+{
+    // Guards buffer and positions against concurrent dumps from other threads.
+    std::mutex mutex;
+    std::vector<char> buffer;
+    // Positions grow monotonically, the physical offset is the position modulo the capacity.
+    uint64_t read_pos  = 0;
+    uint64_t write_pos = 0;
+
+    // The record being encoded. Only used by the owning thread.
+    std::vector<char> scratch;
+
+    thread_ring_t()
+    {
+        std::lock_guard lock{registry().mutex};
+        registry().rings.push_back(this);
+    }
+
+    ~thread_ring_t()
+    {
+        std::lock_guard lock{registry().mutex};
+        auto& rings = registry().rings;
+        rings.erase(std::remove(rings.begin(), rings.end(), this), rings.end());
+    }
+
+    record_header_t *header_at(uint64_t pos)
+    {
+        return reinterpret_cast<record_header_t*>(buffer.data() + pos % buffer.size());
+    }
+
+    /** Drop the oldest records until @size bytes after the write position are free. */
+    void make_room(size_t size)
+    {
+        while (write_pos + size - read_pos > buffer.size())
+        {
+            read_pos += header_at(read_pos)->size;
+        }
+    }
+
+    void append(const record_header_t& header, const char *payload)
+    {
+        if (buffer.empty())
+        {
+            buffer.resize(wf::log::ring::RING_CAPACITY);
+        }
+
+        if (header.size > buffer.size())
+        {
+            return;
+        }
+
+        size_t offset = write_pos % buffer.size();
+        size_t remaining = buffer.size() - offset;
+        if (remaining < header.size)
+        {
+            make_room(remaining);
+            header_at(write_pos)->size = remaining;
+            header_at(write_pos)->kind = RECORD_PADDING;
+            write_pos += remaining;
+        }
+
+        make_room(header.size);
+        char *dest = buffer.data() + write_pos % buffer.size();
+        std::memcpy(dest, &header, sizeof(header));
+        std::memcpy(dest + sizeof(header), payload, header.payload_size);
+        write_pos += header.size;
+    }
+};
+
+thread_ring_t& thread_ring()
+{
+    static thread_local thread_ring_t ring;
+    return ring;
+}
+
+template<class T>
+T read_value(const char*& pos)
+{
+    T value;
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+std::string_view read_string(const char*& pos)
+{
+    auto len = read_value<uint32_t>(pos);
+    std::string_view str{pos, len};
+    pos += len;
+    return str;
+}
+
+template<class T>
+void append_streamed(std::string& out, const T& value)
+{
+    std::ostringstream ss;
+    ss << value;
+    out += ss.str();
+}
+
+/** Format the arguments of a message, in the same way as LOGD would have done. */
+void format_args(const char *pos, const char *end, std::string& out)
+{
+    using wf::log::ring::arg_tag_t;
+    while (pos < end)
+    {
+        auto tag = (arg_tag_t)*pos++;
+        switch (tag)
+        {
+          case arg_tag_t::BOOL:
+            out += read_value<uint8_t>(pos) ? "true" : "false";
+            break;
+
+          case arg_tag_t::CHAR:
+            out += read_value<char>(pos);
+            break;
+
+          case arg_tag_t::INT:
+            out += std::to_string(read_value<int64_t>(pos));
+            break;
+
+          case arg_tag_t::UINT:
+            out += std::to_string(read_value<uint64_t>(pos));
+            break;
+
+          case arg_tag_t::DOUBLE:
+            append_streamed(out, read_value<double>(pos));
+            break;
+
+          case arg_tag_t::POINTER:
+          {
+            auto ptr = read_value<uintptr_t>(pos);
+            if (ptr)
+            {
+                append_streamed(out, (const void*)ptr);
+            } else
+            {
+                out += "(null)";
+            }
+
+            break;
+          }
+
+          case arg_tag_t::POINT:
+            append_streamed(out, read_value<wf::point_t>(pos));
+            break;
+
+          case arg_tag_t::POINTF:
+            append_streamed(out, read_value<wf::pointf_t>(pos));
+            break;
+
+          case arg_tag_t::DIMENSIONS:
+            append_streamed(out, read_value<wf::dimensions_t>(pos));
+            break;
+
+          case arg_tag_t::GEOMETRY:
+            append_streamed(out, read_value<wf::geometry_t>(pos));
+            break;
+
+          case arg_tag_t::STRING:
+            out += read_string(pos);
+            break;
+
+          default:
+            out += "<corrupted record>";
+            return;
+        }
+    }
+}
+
+std::string format_time(int64_t time_us)
+{
+    std::time_t seconds = time_us / 1'000'000;
+    std::tm local;
+    localtime_r(&seconds, &local);
+
+    char buf[64];
+    size_t len = std::strftime(buf, sizeof(buf), "%d-%m-%y %H:%M:%S", &local);
+    std::snprintf(buf + len, sizeof(buf) - len, ".%06d", (int)(time_us % 1'000'000));
+    return buf;
+}
+
+struct formatted_record_t
+{
+    int64_t time_us;
+    std::string line;
+};
+
+void format_ring(thread_ring_t& ring, std::vector<formatted_record_t>& out)
+{
+    for (uint64_t pos = ring.read_pos; pos < ring.write_pos; pos += ring.header_at(pos)->size)
+    {
+        auto header = ring.header_at(pos);
+        if (header->kind != RECORD_MESSAGE)
+        {
+            continue;
+        }
+
+        const char *payload = reinterpret_cast<const char*>(header + 1);
+        const char *end     = payload + header->payload_size;
+        // The source file is the first argument of each record.
+        payload++;
+        auto file = read_string(payload);
+
+        std::string line = format_time(header->time_us) + " [" +
+            wf::log::category_to_string((wf::log::logging_category)header->category) + "] ";
+        line += file;
+        line += ":" + std::to_string(header->line) + " ";
+        format_args(payload, end, line);
+        out.push_back({header->time_us, std::move(line)});
+    }
+}
+
+std::vector<std::string> sorted_lines(std::vector<formatted_record_t> records)
+{
+    std::stable_sort(records.begin(), records.end(), [] (const auto& a, const auto& b)
+    {
+        return a.time_us < b.time_us;
+    });
+
+    std::vector<std::string> lines;
+    lines.reserve(records.size());
+    for (auto& rec : records)
+    {
+        lines.push_back(std::move(rec.line));
+    }
+
+    return lines;
+}
+}
+
+wf::log::ring::record_writer_t::record_writer_t(size_t category, std::string_view file, int line) :
+    data(thread_ring().scratch)
+{
+    data.resize(sizeof(record_header_t));
+    auto header = reinterpret_cast<record_header_t*>(data.data());
+    header->kind     = RECORD_MESSAGE;
+    header->category = category;
+    header->line     = line;
+    header->time_us  = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock::now().time_since_epoch()).count();
+
+    // Like the regular log, only print the file name, not the full path.
+    auto slash = file.find_last_of('/');
+    put_string(slash == std::string_view::npos ? file : file.substr(slash + 1));
+}
+
+void wf::log::ring::record_writer_t::put_string(std::string_view str)
+{
+    uint32_t len = str.size();
+    size_t pos   = data.size();
+    data.resize(pos + 1 + sizeof(len) + len);
+    data[pos] = (char)arg_tag_t::STRING;
+    std::memcpy(data.data() + pos + 1, &len, sizeof(len));
+    std::memcpy(data.data() + pos + 1 + sizeof(len), str.data(), len);
+}
+
+void wf::log::ring::record_writer_t::commit()
+{
+    auto header = *reinterpret_cast<record_header_t*>(data.data());
+    header.payload_size = data.size() - sizeof(record_header_t);
+    header.size = align8(data.size());
+
+    auto& ring = thread_ring();
+    std::lock_guard lock{ring.mutex};
+    ring.append(header, data.data() + sizeof(record_header_t));
+}
+
+std::vector<std::string> wf::log::ring::format_all()
+{
+    std::vector<formatted_record_t> records;
+    std::lock_guard lock{registry().mutex};
+    for (auto ring : registry().rings)
+    {
+        std::lock_guard ring_lock{ring->mutex};
+        format_ring(*ring, records);
+    }
+
+    return sorted_lines(std::move(records));
+}
+
+void wf::log::ring::dump_to_log()
+{
+    // We might have crashed while holding one of the locks, so skip what cannot be locked.
+    std::vector<formatted_record_t> records;
+    std::unique_lock lock{registry().mutex, std::try_to_lock};
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+
+    for (auto ring : registry().rings)
+    {
+        std::unique_lock ring_lock{ring->mutex, std::try_to_lock};
+        if (ring_lock.owns_lock())
+        {
+            format_ring(*ring, records);
+        }
+    }
+
+    if (records.empty())
+    {
+        return;
+    }
+
+    wf::log::log_plain(wf::log::LOG_LEVEL_ERROR, "Recorded log messages:");
+    for (auto& line : sorted_lines(std::move(records)))
+    {
+        wf::log::log_plain(wf::log::LOG_LEVEL_ERROR, line);
+    }
+}
+
+void wf::log::ring::clear()
+{
+    std::lock_guard lock{registry().mutex};
+    for (auto ring : registry().rings)
+    {
+        std::lock_guard ring_lock{ring->mutex};
+        ring->read_pos = ring->write_pos;
+    }
+}
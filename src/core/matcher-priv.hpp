@@ -0,0 +1,70 @@
+#pragma once
+
+#include <wayfire/condition/access_interface.hpp>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+/**
+ * An access interface which resolves each identifier of a parsed condition to a property of @Access only
+ * once, so that evaluating the condition does not look up property names.
+ *
+ * The conditions pass the identifiers they own to get(), so an identifier is recognized by its address.
+ * Its name is kept too, and checked when the address matches, in case a condition passes a temporary
+ * string instead. reset() must be called whenever the condition is replaced.
+ *
+ * @Access must provide a property_t enum with an UNKNOWN value, a static resolve_property(identifier), and
+ * get() for both identifiers and resolved properties, like view_access_interface_t.
+ */
+template<class Access>
+class resolved_access_interface_t : public access_interface_t
+{
+  public:
+    using property_t = typename Access::property_t;
+
+    /** The interface which the resolved properties are queried from. */
+    Access access;
+
+    variant_t get(const std::string& identifier, bool& error) override
+    {
+        for (auto& entry : resolved)
+        {
+            if ((entry.identifier == &identifier) && (entry.name == identifier))
+            {
+                return query(entry, error);
+            }
+        }
+
+        resolved.push_back({&identifier, identifier, Access::resolve_property(identifier)});
+        return query(resolved.back(), error);
+    }
+
+    /** Forget the resolved identifiers, for example when the condition is parsed again. */
+    void reset()
+    {
+        resolved.clear();
+    }
+
+  private:
+    struct entry_t
+    {
+        const std::string *identifier;
+        std::string name;
+        property_t property;
+    };
+
+    std::vector<entry_t> resolved;
+
+    variant_t query(const entry_t& entry, bool& error)
+    {
+        if (entry.property == property_t::UNKNOWN)
+        {
+            // Reports the unsupported identifier
+            return access.get(entry.name, error);
+        }
+
+        return access.get(entry.property, error);
+    }
+};
+}
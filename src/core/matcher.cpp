@@ -6,6 +6,8 @@
 #include <wayfire/view-access-interface.hpp>
 #include <wayfire/parser/condition_parser.hpp>
 
+#include "matcher-priv.hpp"
+
 class wf::view_matcher_t::impl
 {
   public:
@@ -15,9 +17,20 @@ class wf::view_matcher_t::impl
     wf::condition_parser_t parser;
     std::shared_ptr<wf::condition_t> condition;
 
+    /* Resolves the properties used by the condition */
+    wf::resolved_access_interface_t<wf::view_access_interface_t> access;
+
+    bool evaluate(wayfire_view view)
+    {
+        access.access.set_view(view);
+        bool ignored = false;
+        return condition->evaluate(access, ignored);
+    }
+
     bool try_parse(const std::string& value, const std::string& opt_name)
     {
         lexer.reset(value);
+        access.reset();
         try {
             condition = parser.parse(lexer);
 
@@ -72,6 +85,7 @@ class wf::view_matcher_t::impl
     }
 
     impl() = default;
+
     ~impl()
     {
         disconnect_updated_handler();
@@ -110,6 +124,11 @@ void wf::view_matcher_t::set_from_option(
 
 bool wf::view_matcher_t::matches(wayfire_view view)
 {
+    if (this->priv->condition && view)
+    {
+        return this->priv->evaluate(view);
+    }
+
     if (this->priv->condition)
     {
         bool ignored = false;
@@ -0,0 +1,101 @@
+#include "memory-pressure.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+constexpr uint32_t POLL_INTERVAL_MS = 2000;
+/* While the pressure persists, release the buffers again at most this often. */
+constexpr auto RELEASE_INTERVAL = std::chrono::seconds(10);
+
+/** @return The "some avg10" value of /proc/pressure/memory, or -1 if it is not available. */
+double read_memory_pressure()
+{
+    std::ifstream psi{"/proc/pressure/memory"};
+    std::string line;
+    while (std::getline(psi, line))
+    {
+        std::istringstream fields{line};
+        std::string kind, avg10;
+        fields >> kind >> avg10;
+        if ((kind == "some") && (avg10.rfind("avg10=", 0) == 0))
+        {
+            return std::stod(avg10.substr(6));
+        }
+    }
+
+    return -1;
+}
+
+/** @return MemAvailable in MiB, or -1 if it is not available. */
+int64_t read_available_memory()
+{
+    std::ifstream meminfo{"/proc/meminfo"};
+    std::string key;
+    int64_t value;
+    std::string unit;
+    while (meminfo >> key >> value)
+    {
+        std::getline(meminfo, unit);
+        if (key == "MemAvailable:")
+        {
+            return value / 1024;
+        }
+    }
+
+    return -1;
+}
+}
+
+wf::memory_pressure_monitor_t::memory_pressure_monitor_t()
+{
+    poll_timer.set_timeout(POLL_INTERVAL_MS, [=] ()
+    {
+        check();
+        return true;
+    });
+}
+
+wf::memory_pressure_monitor_t::~memory_pressure_monitor_t()
+{
+    poll_timer.disconnect();
+}
+
+void wf::memory_pressure_monitor_t::check()
+{
+    static wf::option_wrapper_t<int> threshold{"core/memory_pressure_threshold"};
+    static wf::option_wrapper_t<int> min_available{"core/memory_pressure_min_available"};
+    if ((threshold <= 0) && (min_available <= 0))
+    {
+        return;
+    }
+
+    memory_pressure_signal ev;
+    ev.pressure     = (threshold > 0) ? read_memory_pressure() : -1;
+    ev.available_mb = (min_available > 0) ? read_available_memory() : -1;
+    const bool low_memory = ((threshold > 0) && (ev.pressure > threshold)) ||
+        ((min_available > 0) && (ev.available_mb >= 0) && (ev.available_mb < min_available));
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!low_memory || (released_before && (now - last_release < RELEASE_INTERVAL)))
+    {
+        return;
+    }
+
+    LOGI("Low on memory (pressure ", ev.pressure, "%, ", ev.available_mb, " MiB available), releasing buffers");
+    released_before = true;
+    last_release    = now;
+    // Keep the buffers used in the last frame of each output.
+    OpenGL::reclaim_buffers(std::max<size_t>(1, wf::get_core().output_layout->get_outputs().size()));
+    OpenGL::clear_framebuffer_pool();
+    wf::get_core().emit(&ev);
+}
@@ -0,0 +1,36 @@
+#ifndef WF_CORE_MEMORY_PRESSURE_HPP
+#define WF_CORE_MEMORY_PRESSURE_HPP
+
+#include <wayfire/util.hpp>
+#include <chrono>
+#include <cstdint>
+
+namespace wf
+{
+/**
+ * Watches the memory of the system and releases the auxiliary buffers which are not used in the current
+ * frame, together with the framebuffer pool, when the system runs low on memory. Afterwards, it emits
+ * memory_pressure_signal on core, so that plugins can drop their caches as well.
+ *
+ * Memory pressure is read from /proc/pressure/memory (the "some avg10" value) if the kernel supports it,
+ * and the available memory from /proc/meminfo. Both are polled every few seconds.
+ */
+class memory_pressure_monitor_t
+{
+  public:
+    memory_pressure_monitor_t();
+    ~memory_pressure_monitor_t();
+
+    memory_pressure_monitor_t(const memory_pressure_monitor_t&) = delete;
+    memory_pressure_monitor_t& operator =(const memory_pressure_monitor_t&) = delete;
+
+  private:
+    wf::wl_timer<true> poll_timer;
+    std::chrono::steady_clock::time_point last_release;
+    bool released_before = false;
+
+    void check();
+};
+}
+
+#endif /* end of include guard: WF_CORE_MEMORY_PRESSURE_HPP */
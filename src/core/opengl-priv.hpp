@@ -14,6 +14,17 @@ void fini();
 void bind_output(wf::output_t *output, uint32_t fb);
 /** Indicate the output frame has been finished */
 void unbind_output(wf::output_t *output);
+
+/**
+ * Get a depth texture (GL_DEPTH_COMPONENT) of the given size, reusing one from the framebuffer pool if
+ * possible. Must be called inside render_begin()/render_end().
+ */
+GLuint allocate_depth_texture(int width, int height);
+/**
+ * Give a depth texture back to the framebuffer pool, which frees it once the pool grows beyond
+ * core/framebuffer_pool_budget.
+ */
+void release_depth_texture(GLuint tex, int width, int height);
 }
 
 #endif /* end of include guard: WF_OPENGL_PRIV_HPP */
@@ -1,4 +1,6 @@
 #include <wayfire/util/log.hpp>
+#include <algorithm>
+#include <cmath>
 #include <map>
 #include "opengl-priv.hpp"
 #include "wayfire/geometry.hpp"
@@ -7,10 +9,24 @@
 #include "config.h"
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <set>
+#include <list>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <wayfire/nonstd/reverse.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <unistd.h>
+#include <cstring>
+#include <wayfire/option-wrapper.hpp>
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <GLES2/gl2ext.h>
 
 #include "shaders.tpp"
+#include "gldebug.hpp"
 #include "wayfire/region.hpp"
 
 const char *gl_error_string(const GLenum err)
@@ -33,15 +49,85 @@ const char *gl_error_string(const GLenum err)
     return "UNKNOWN GL ERROR";
 }
 
+namespace
+{
+/**
+ * The checks done by GL_CALL and the GL helpers. They are chosen at the start of each frame (see
+ * OpenGL::bind_output()) and apply to the frame and to the GL work done until the next frame starts.
+ */
+struct gl_checks_t
+{
+    bool check_errors = true;
+    bool track_state  = false;
+    bool debug_output = false;
+    bool debug_output_enabled = false;
+    OpenGL::gl_check_stats_t stats;
+    // Call sites which already reported an error, by function and line.
+    std::set<std::pair<std::string, uint32_t>> reported;
+};
+
+gl_checks_t gl_checks;
+
+/** Count a bind of @value to @binding, and whether it was already bound. */
+void track_binding(GLenum binding, GLint value, uint64_t& binds, uint64_t& redundant)
+{
+    if (!gl_checks.track_state)
+    {
+        return;
+    }
+
+    GLint current = 0;
+    glGetIntegerv(binding, &current);
+    ++binds;
+    redundant += (current == value);
+}
+
+/** Count a set of the uniform at @loc of @program, and whether it already had the given values. */
+template<class T>
+void track_uniform(GLuint program, GLint loc, const T *values, int count)
+{
+    if (!gl_checks.track_state || (loc < 0))
+    {
+        return;
+    }
+
+    T current[16];
+    if constexpr (std::is_same_v<T, GLint>)
+    {
+        glGetUniformiv(program, loc, current);
+    } else
+    {
+        glGetUniformfv(program, loc, current);
+    }
+
+    ++gl_checks.stats.uniform_sets;
+    gl_checks.stats.redundant_uniform_sets += std::equal(values, values + count, current);
+}
+}
+
 static bool disable_gl_call = false;
 void gl_call(const char *func, uint32_t line, const char *glfunc)
 {
-    GLenum err;
-    if (disable_gl_call || ((err = glGetError()) == GL_NO_ERROR))
+    if (disable_gl_call || !gl_checks.check_errors)
     {
         return;
     }
 
+    ++gl_checks.stats.checked_calls;
+    GLenum err = glGetError();
+    if (err == GL_NO_ERROR)
+    {
+        return;
+    }
+
+    ++gl_checks.stats.errors;
+    // A failing call usually fails again on every frame, so only its first error is logged.
+    if (!gl_checks.reported.emplace(func, line).second)
+    {
+        ++gl_checks.stats.suppressed_errors;
+        return;
+    }
+
     LOGE("gles2: function ", glfunc, " in ", func, " line ", line, ": ",
         gl_error_string(err));
 }
@@ -52,7 +138,29 @@ namespace OpenGL
  * Different Context is kept for each output
  * Each of the following functions uses the currently bound context
  */
-program_t program, color_program;
+program_t program, color_program, color_batch_program;
+
+/* Locations of the uniforms and attributes of the built-in programs */
+struct builtin_locations_t
+{
+    program_t::location_t position;
+    program_t::location_t uv_position;
+    program_t::location_t mvp;
+    program_t::location_t color;
+};
+
+builtin_locations_t program_locations, color_program_locations;
+program_t::location_t color_batch_position, color_batch_color, color_batch_mvp;
+
+static builtin_locations_t resolve_builtin_locations(program_t& prog)
+{
+    builtin_locations_t locations;
+    locations.position    = prog.get_attrib_location("position");
+    locations.uv_position = prog.get_attrib_location("uvPosition");
+    locations.mvp   = prog.get_uniform_location("MVP");
+    locations.color = prog.get_uniform_location("color");
+    return locations;
+}
 GLuint compile_shader(std::string source, GLuint type)
 {
     GLuint shader = GL_CALL(glCreateShader(type));
@@ -78,14 +186,288 @@ GLuint compile_shader(std::string source, GLuint type)
     return shader;
 }
 
+namespace
+{
+/**
+ * An on-disk cache of linked program binaries, so that the programs of the core and of the plugins do not
+ * have to be compiled again on every start of Wayfire.
+ *
+ * The binaries are stored in $XDG_CACHE_HOME/wayfire/programs (or ~/.cache/wayfire/programs), one file per
+ * program, named after a hash of the driver, the GPU and the shader sources. A binary which the driver
+ * rejects (for example after a driver update with the same version string) is simply compiled again.
+ */
+struct program_binary_cache_t
+{
+    bool initialized = false;
+    bool supported   = false;
+    std::string driver;
+    std::filesystem::path directory;
+
+    /* The core GLES 3.0 functions, or their GL_OES_get_program_binary equivalents on GLES 2.0 */
+    PFNGLPROGRAMBINARYOESPROC program_binary    = nullptr;
+    PFNGLGETPROGRAMBINARYOESPROC get_program_binary = nullptr;
+    /* GLES 2.0 has no GL_PROGRAM_BINARY_RETRIEVABLE_HINT, binaries are always retrievable there */
+    bool has_retrievable_hint = false;
+
+    static bool has_gles3()
+    {
+        // GL_MAJOR_VERSION cannot be queried on GLES 2.0, the version string has the form
+        // "OpenGL ES N.M <vendor-specific information>".
+        auto version = (const char*)glGetString(GL_VERSION);
+        int major    = 0;
+        return version && (sscanf(version, "OpenGL ES %d.", &major) == 1) && (major >= 3);
+    }
+
+    bool load_functions()
+    {
+        if (has_gles3())
+        {
+            program_binary       = glProgramBinary;
+            get_program_binary   = glGetProgramBinary;
+            has_retrievable_hint = true;
+            return true;
+        }
+
+        auto extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "GL_OES_get_program_binary"))
+        {
+            return false;
+        }
+
+        program_binary     = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+        get_program_binary = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+        return program_binary && get_program_binary;
+    }
+
+    void init()
+    {
+        initialized = true;
+        if (!load_functions())
+        {
+            LOGD("Program binaries are not supported, not caching programs.");
+            return;
+        }
+
+        // Some drivers expose the functions but support no binary format at all.
+        GLint nr_formats = 0;
+        GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nr_formats));
+
+        std::string cache_home;
+        if (char *c_xdg_cache_home = std::getenv("XDG_CACHE_HOME"))
+        {
+            cache_home = c_xdg_cache_home;
+        } else if (char *c_user_home = std::getenv("HOME"))
+        {
+            cache_home = (std::string)c_user_home + "/.cache";
+        }
+
+        if ((nr_formats <= 0) || cache_home.empty())
+        {
+            return;
+        }
+
+        auto get_string = [] (GLenum name)
+        {
+            auto str = (const char*)glGetString(name);
+            return std::string(str ? str : "");
+        };
+
+        driver    = get_string(GL_VENDOR) + "\n" + get_string(GL_RENDERER) + "\n" + get_string(GL_VERSION);
+        directory = std::filesystem::path(cache_home) / "wayfire" / "programs";
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        supported = !ec;
+    }
+
+    bool enabled()
+    {
+        static wf::option_wrapper_t<bool> cache_programs{"core/program_binary_cache"};
+        if (!initialized)
+        {
+            init();
+        }
+
+        return supported && cache_programs;
+    }
+
+    /* FNV-1a, because the file names have to be stable between runs and builds */
+    static uint64_t hash_strings(std::initializer_list<const std::string*> parts)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (auto *str : parts)
+        {
+            for (unsigned char c : *str)
+            {
+                hash = (hash ^ c) * 1099511628211ull;
+            }
+
+            // Separate the strings, so that moving text from one to the other changes the hash
+            hash = (hash ^ 0xff) * 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    /* The file names start with the hash of the driver, so that binaries of other drivers can be found */
+    std::string get_driver_prefix()
+    {
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "%08llx-", (unsigned long long)(hash_strings({&driver}) >> 32));
+        return prefix;
+    }
+
+    std::filesystem::path get_path(const std::string& vertex_source, const std::string& frag_source)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin",
+            (unsigned long long)hash_strings({&driver, &vertex_source, &frag_source}));
+        return directory / (get_driver_prefix() + name);
+    }
+
+    /* Binaries which have not been used for this long are assumed to be of shaders which no longer exist */
+    static constexpr auto UNUSED_LIFETIME = std::chrono::hours(24 * 30);
+    bool pruned = false;
+
+    /**
+     * Delete the binaries of other drivers, those which have not been used for a while, and temporary files
+     * left behind by a crash. This is done once per run, on the first lookup which misses, since a miss means
+     * that the driver or the shaders changed.
+     */
+    void prune()
+    {
+        if (pruned)
+        {
+            return;
+        }
+
+        pruned = true;
+        const auto prefix = get_driver_prefix();
+        const auto now    = std::filesystem::file_time_type::clock::now();
+        std::error_code ec;
+        for (auto& entry : std::filesystem::directory_iterator(directory, ec))
+        {
+            const auto name = entry.path().filename().string();
+            const bool used_recently = (now - entry.last_write_time(ec) < UNUSED_LIFETIME) && !ec;
+            if ((name.rfind(prefix, 0) != 0) || (entry.path().extension() != ".bin") || !used_recently)
+            {
+                LOGD("Removing stale program binary ", entry.path().string());
+                std::filesystem::remove(entry.path(), ec);
+            }
+        }
+    }
+
+    /* Create a program from the cached binary, or return 0 if there is no valid binary */
+    GLuint load(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        GLenum format;
+        if (!file.read((char*)&format, sizeof(format)))
+        {
+            prune();
+            return 0;
+        }
+
+        std::vector<char> binary{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        std::error_code ec;
+        if (binary.empty())
+        {
+            std::filesystem::remove(path, ec);
+            prune();
+            return 0;
+        }
+
+        auto result_program = GL_CALL(glCreateProgram());
+        GL_CALL(program_binary(result_program, format, binary.data(), binary.size()));
+
+        GLint s = GL_FALSE;
+        GL_CALL(glGetProgramiv(result_program, GL_LINK_STATUS, &s));
+        if (s == GL_FALSE)
+        {
+            LOGD("Discarding outdated program binary ", path.string());
+            GL_CALL(glDeleteProgram(result_program));
+            std::filesystem::remove(path, ec);
+            prune();
+            return 0;
+        }
+
+        // Mark the binary as used, see prune()
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        return result_program;
+    }
+
+    void store(const std::filesystem::path& path, GLuint program)
+    {
+        GLint length = 0;
+        GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (length <= 0)
+        {
+            return;
+        }
+
+        GLenum format;
+        std::vector<char> binary(length);
+        GL_CALL(get_program_binary(program, length, &length, &format, binary.data()));
+
+        // Write to a temporary file first, so that a crash or a parallel instance never leaves a truncated
+        // binary behind.
+        auto tmp_path = path;
+        tmp_path += ".tmp" + std::to_string(getpid());
+        bool file_written;
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            file.write((const char*)&format, sizeof(format));
+            file.write(binary.data(), length);
+            file.close();
+            file_written = !file.fail();
+            if (!file_written)
+            {
+                LOGW("Failed to write program binary ", tmp_path.string());
+            }
+        }
+
+        std::error_code ec;
+        if (!file_written)
+        {
+            std::filesystem::remove(tmp_path, ec);
+            return;
+        }
+
+        std::filesystem::rename(tmp_path, path, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp_path, ec);
+        }
+    }
+};
+
+program_binary_cache_t program_binary_cache;
+}
+
 /* Create a very simple gl program from the given shader sources */
 GLuint compile_program(std::string vertex_source, std::string frag_source)
 {
+    const bool use_cache = program_binary_cache.enabled();
+    std::filesystem::path cache_path;
+    if (use_cache)
+    {
+        cache_path = program_binary_cache.get_path(vertex_source, frag_source);
+        if (auto cached_program = program_binary_cache.load(cache_path))
+        {
+            return cached_program;
+        }
+    }
+
     auto vertex_shader   = compile_shader(vertex_source, GL_VERTEX_SHADER);
     auto fragment_shader = compile_shader(frag_source, GL_FRAGMENT_SHADER);
     auto result_program  = GL_CALL(glCreateProgram());
     GL_CALL(glAttachShader(result_program, vertex_shader));
     GL_CALL(glAttachShader(result_program, fragment_shader));
+    if (use_cache && program_binary_cache.has_retrievable_hint)
+    {
+        GL_CALL(glProgramParameteri(result_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
     GL_CALL(glLinkProgram(result_program));
 
     int s = GL_FALSE;
@@ -106,51 +488,383 @@ GLuint compile_program(std::string vertex_source, std::string frag_source)
     /* won't be really deleted until program is deleted as well */
     GL_CALL(glDeleteShader(vertex_shader));
     GL_CALL(glDeleteShader(fragment_shader));
-    return (s == GL_FALSE) ? 0 : result_program;
+    if (s == GL_FALSE)
+    {
+        return 0;
+    }
+
+    if (use_cache)
+    {
+        program_binary_cache.store(cache_path, result_program);
+    }
+
+    return result_program;
 }
 
 void init()
 {
     render_begin();
-    // enable_gl_synchronous_debug()
     program.compile(default_vertex_shader_source,
         default_fragment_shader_source);
 
     color_program.set_simple(compile_program(default_vertex_shader_source,
         color_rect_fragment_source));
 
+    program_locations = resolve_builtin_locations(program);
+    color_program_locations = resolve_builtin_locations(color_program);
+
+    color_batch_program.set_simple(compile_program(color_batch_vertex_source,
+        color_batch_fragment_source));
+    color_batch_position = color_batch_program.get_attrib_location("position");
+    color_batch_color    = color_batch_program.get_attrib_location("color");
+    color_batch_mvp = color_batch_program.get_uniform_location("MVP");
     render_end();
 }
 
+namespace
+{
+wf::output_t *current_output = NULL;
+uint32_t current_output_fb   = 0;
+
+struct gpu_memory_record_t
+{
+    uint64_t bytes;
+    gpu_memory_owner_t owner;
+};
+
+std::unordered_map<GLuint, gpu_memory_record_t> gpu_memory;
+std::vector<const gpu_memory_scope_t*> gpu_memory_scopes;
+
+void set_gpu_memory_owner(GLuint tex, gpu_memory_owner_t owner)
+{
+    auto it = gpu_memory.find(tex);
+    if (it != gpu_memory.end())
+    {
+        it->second.owner = std::move(owner);
+    }
+}
+
+/**
+ * Framebuffers released by framebuffer_t::release() are kept (together with their color texture) in a pool,
+ * so that allocating a framebuffer of the same size later does not need to allocate GPU memory again.
+ * Released depth textures are kept in the same pool, as entries without a framebuffer.
+ * The least recently released entries are freed when the pool grows beyond core/framebuffer_pool_budget.
+ */
+struct framebuffer_pool_t
+{
+    struct entry_t
+    {
+        // 0 for depth textures
+        GLuint fb;
+        GLuint tex;
+        int width;
+        int height;
+    };
+
+    // Most recently released entries first
+    std::list<entry_t> entries;
+    framebuffer_pool_stats_t stats;
+
+    static uint64_t size_of(int width, int height)
+    {
+        return uint64_t(std::max(width, 0)) * std::max(height, 0) * 4;
+    }
+
+    uint64_t get_budget()
+    {
+        static wf::option_wrapper_t<int> budget_mb{"core/framebuffer_pool_budget"};
+        return uint64_t(std::max((int)budget_mb, 0)) * 1024 * 1024;
+    }
+
+    bool take(int width, int height, GLuint& fb, GLuint& tex, bool depth = false)
+    {
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            if ((it->width == width) && (it->height == height) && ((it->fb == 0) == depth))
+            {
+                fb  = it->fb;
+                tex = it->tex;
+                track_gpu_memory(tex, size_of(width, height), depth ? "depth-buffer" : "framebuffer");
+                stats.pooled_bytes -= size_of(width, height);
+                --stats.pooled_buffers;
+                ++stats.hits;
+                entries.erase(it);
+                return true;
+            }
+        }
+
+        ++stats.misses;
+        return false;
+    }
+
+    void give(GLuint fb, GLuint tex, int width, int height)
+    {
+        const uint64_t budget = get_budget();
+        if (size_of(width, height) > budget)
+        {
+            destroy(entry_t{fb, tex, width, height});
+            return;
+        }
+
+        entries.push_front(entry_t{fb, tex, width, height});
+        set_gpu_memory_owner(tex, {"framebuffer-pool"});
+        stats.pooled_bytes += size_of(width, height);
+        ++stats.pooled_buffers;
+
+        while (stats.pooled_bytes > budget)
+        {
+            auto& oldest = entries.back();
+            stats.pooled_bytes -= size_of(oldest.width, oldest.height);
+            --stats.pooled_buffers;
+            ++stats.evictions;
+            destroy(oldest);
+            entries.pop_back();
+        }
+    }
+
+    void clear()
+    {
+        for (auto& entry : entries)
+        {
+            destroy(entry);
+        }
+
+        entries.clear();
+        stats.pooled_bytes   = 0;
+        stats.pooled_buffers = 0;
+    }
+
+    static void destroy(const entry_t& entry)
+    {
+        if (entry.fb != 0)
+        {
+            GL_CALL(glDeleteFramebuffers(1, &entry.fb));
+        }
+
+        GL_CALL(glDeleteTextures(1, &entry.tex));
+        untrack_gpu_memory(entry.tex);
+    }
+};
+
+framebuffer_pool_t framebuffer_pool;
+
+std::vector<reclaimable_buffer_t*> reclaimable_buffers;
+// The number of frames painted on all outputs.
+uint64_t frame_counter = 0;
+// Check for buffers to reclaim after this many frames.
+constexpr uint64_t RECLAIM_INTERVAL = 64;
+}
+
 void fini()
 {
     render_begin();
     program.free_resources();
     color_program.free_resources();
+    color_batch_program.free_resources();
+    framebuffer_pool.clear();
+    render_end();
+}
+
+framebuffer_pool_stats_t get_framebuffer_pool_stats()
+{
+    return framebuffer_pool.stats;
+}
+
+gl_check_stats_t get_gl_check_stats()
+{
+    return gl_checks.stats;
+}
+
+void reset_gl_check_stats()
+{
+    gl_checks.stats = {};
+    gl_checks.reported.clear();
+}
+
+void clear_framebuffer_pool()
+{
+    render_begin();
+    framebuffer_pool.clear();
     render_end();
 }
 
-namespace
+GLuint allocate_depth_texture(int width, int height)
+{
+    GLuint fb, tex;
+    if (framebuffer_pool.take(width, height, fb, tex, true))
+    {
+        return tex;
+    }
+
+    GL_CALL(glGenTextures(1, &tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
+        width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+    track_gpu_memory(tex, framebuffer_pool_t::size_of(width, height), "depth-buffer");
+    return tex;
+}
+
+void release_depth_texture(GLuint tex, int width, int height)
+{
+    framebuffer_pool.give(0, tex, width, height);
+}
+
+reclaimable_buffer_t::reclaimable_buffer_t(std::function<void()> release) : release(std::move(release))
+{
+    reclaimable_buffers.push_back(this);
+}
+
+reclaimable_buffer_t::~reclaimable_buffer_t()
+{
+    auto it = std::find(reclaimable_buffers.begin(), reclaimable_buffers.end(), this);
+    *it = reclaimable_buffers.back();
+    reclaimable_buffers.pop_back();
+}
+
+void reclaimable_buffer_t::mark_used()
+{
+    allocated = true;
+    last_used = frame_counter;
+}
+
+void reclaim_buffers(uint64_t max_idle_frames)
+{
+    // The callbacks may create or destroy other buffers.
+    auto buffers = reclaimable_buffers;
+    for (auto buffer : buffers)
+    {
+        if (std::find(reclaimable_buffers.begin(), reclaimable_buffers.end(), buffer) ==
+            reclaimable_buffers.end())
+        {
+            continue;
+        }
+
+        if (buffer->allocated && (frame_counter - buffer->last_used > max_idle_frames))
+        {
+            buffer->allocated = false;
+            buffer->release();
+        }
+    }
+}
+
+gpu_memory_scope_t::gpu_memory_scope_t(std::function<gpu_memory_owner_t()> describe_owner) :
+    describe_owner(std::move(describe_owner))
+{
+    gpu_memory_scopes.push_back(this);
+}
+
+gpu_memory_scope_t::~gpu_memory_scope_t()
+{
+    // Scopes are destroyed in reverse order of their creation.
+    gpu_memory_scopes.pop_back();
+}
+
+gpu_memory_owner_t get_current_gpu_memory_owner()
+{
+    gpu_memory_owner_t owner;
+    for (auto scope : wf::reverse(gpu_memory_scopes))
+    {
+        auto outer = scope->describe_owner();
+        if (owner.name.empty())
+        {
+            owner.name = std::move(outer.name);
+        }
+
+        if (!owner.view_id)
+        {
+            owner.view_id = outer.view_id;
+        }
+
+        if (owner.output.empty())
+        {
+            owner.output = std::move(outer.output);
+        }
+    }
+
+    return owner;
+}
+
+void track_gpu_memory(GLuint tex, uint64_t bytes, const char *fallback_name)
+{
+    auto owner = get_current_gpu_memory_owner();
+    if (owner.name.empty())
+    {
+        owner.name = fallback_name;
+    }
+
+    gpu_memory[tex] = {bytes, std::move(owner)};
+}
+
+void untrack_gpu_memory(GLuint tex)
+{
+    gpu_memory.erase(tex);
+}
+
+std::vector<gpu_memory_usage_t> get_gpu_memory_usage()
 {
-wf::output_t *current_output = NULL;
-uint32_t current_output_fb   = 0;
+    std::map<std::tuple<std::string, uint32_t, std::string>, gpu_memory_usage_t> by_owner;
+    for (auto& [tex, record] : gpu_memory)
+    {
+        auto& usage = by_owner[{record.owner.name, record.owner.view_id, record.owner.output}];
+        usage.owner = record.owner;
+        usage.bytes += record.bytes;
+        ++usage.textures;
+    }
+
+    std::vector<gpu_memory_usage_t> result;
+    for (auto& [key, usage] : by_owner)
+    {
+        result.push_back(std::move(usage));
+    }
+
+    std::sort(result.begin(), result.end(), [] (const auto& a, const auto& b)
+    {
+        return a.bytes > b.bytes;
+    });
+    return result;
 }
 
 void bind_output(wf::output_t *output, uint32_t fb)
 {
     current_output    = output;
     current_output_fb = fb;
+
+    static wf::option_wrapper_t<int> error_check_period{"core/gl_error_check_period"};
+    static wf::option_wrapper_t<bool> state_tracking{"core/gl_state_tracking"};
+    static wf::option_wrapper_t<bool> debug_output{"core/gl_debug_output"};
+
+    auto& stats = gl_checks.stats;
+    gl_checks.check_errors = (error_check_period > 0) && (stats.frames % error_check_period == 0);
+    gl_checks.track_state  = state_tracking;
+    gl_checks.debug_output = debug_output;
+    ++stats.frames;
+    stats.checked_frames += gl_checks.check_errors;
+    stats.tracked_frames += gl_checks.track_state;
 }
 
 void unbind_output(wf::output_t *output)
 {
     current_output    = NULL;
     current_output_fb = 0;
+
+    static wf::option_wrapper_t<int> reclaim_frames{"core/buffer_reclaim_frames"};
+    if ((++frame_counter % RECLAIM_INTERVAL == 0) && (reclaim_frames > 0))
+    {
+        reclaim_buffers(reclaim_frames);
+    }
 }
 
 std::vector<GLfloat> vertexData;
 std::vector<GLfloat> coordData;
 
+// The geometry, texture coordinates and transform of the last rendered quad, used by draw_cached_region().
+gl_geometry cached_geometry;
+gl_geometry cached_texg;
+glm::mat4 cached_model;
+std::vector<GLfloat> batchVertexData;
+std::vector<GLfloat> batchCoordData;
+
 void render_transformed_texture(wf::texture_t tex,
     const gl_geometry& g, const gl_geometry& texg,
     glm::mat4 model, glm::vec4 color, uint32_t bits)
@@ -189,11 +903,15 @@ void render_transformed_texture(wf::texture_t tex,
         final_texg.x1, final_texg.y2,
     };
 
+    cached_geometry = g;
+    cached_texg     = final_texg;
+    cached_model    = model;
+
     program.set_active_texture(tex);
-    program.attrib_pointer("position", 2, 0, vertexData.data());
-    program.attrib_pointer("uvPosition", 2, 0, coordData.data());
-    program.uniformMatrix4f("MVP", model);
-    program.uniform4f("color", color);
+    program.attrib_pointer(program_locations.position, 2, 0, vertexData.data());
+    program.attrib_pointer(program_locations.uv_position, 2, 0, coordData.data());
+    program.uniformMatrix4f(program_locations.mvp, model);
+    program.uniform4f(program_locations.color, color);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -212,6 +930,85 @@ void draw_cached()
     GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
 }
 
+void draw_cached_region(const wf::render_target_t& target, const wf::region_t& region)
+{
+    const gl_geometry& g = cached_geometry;
+    const gl_geometry& t = cached_texg;
+    const float width  = g.x2 - g.x1;
+    const float height = g.y2 - g.y1;
+    if ((width <= 0) || (height <= 0) || (target.viewport_width <= 0) || (target.viewport_height <= 0))
+    {
+        return;
+    }
+
+    // The damage is rounded to whole framebuffer pixels, the same way logic_scissor() does it. Clipping in
+    // logical coordinates would leave pixels which are only partially covered unpainted at fractional scales.
+    wf::region_t fb_region = target.framebuffer_region_from_geometry_region(region);
+    if (target.framebuffer_clip)
+    {
+        fb_region &= *target.framebuffer_clip;
+    }
+
+    // Map framebuffer pixels (top-left origin) back to the coordinates of the quad. The quad's transform is
+    // an orthographic projection, possibly rotated by multiples of 90 degrees, so boxes stay boxes.
+    const glm::mat4 inverse_model = glm::inverse(cached_model);
+    const auto to_quad = [&] (float x, float y)
+    {
+        glm::vec4 ndc{2.0f * x / target.viewport_width - 1.0f, 1.0f - 2.0f * y / target.viewport_height,
+            0.0f, 1.0f};
+        glm::vec4 p = inverse_model * ndc;
+        return glm::vec2{p.x / p.w, p.y / p.w};
+    };
+
+    // Texture coordinates are interpolated linearly along the quad. Note that y1 of the texture coordinates
+    // corresponds to y2 of the quad (see render_transformed_texture()).
+    const auto push_vertex = [&] (float x, float y)
+    {
+        batchVertexData.push_back(x);
+        batchVertexData.push_back(y);
+        batchCoordData.push_back(t.x1 + (t.x2 - t.x1) * (x - g.x1) / width);
+        batchCoordData.push_back(t.y1 + (t.y2 - t.y1) * (g.y2 - y) / height);
+    };
+
+    batchVertexData.clear();
+    batchCoordData.clear();
+    for (const auto& box : fb_region)
+    {
+        const glm::vec2 a = to_quad(box.x1, box.y1);
+        const glm::vec2 b = to_quad(box.x2, box.y2);
+
+        // The edges of the quad itself are kept exact, only the damage edges are on pixel boundaries.
+        const float x1 = std::max(std::min(a.x, b.x), g.x1);
+        const float y1 = std::max(std::min(a.y, b.y), g.y1);
+        const float x2 = std::min(std::max(a.x, b.x), g.x2);
+        const float y2 = std::min(std::max(a.y, b.y), g.y2);
+        if ((x1 >= x2) || (y1 >= y2))
+        {
+            continue;
+        }
+
+        push_vertex(x1, y1);
+        push_vertex(x2, y1);
+        push_vertex(x2, y2);
+        push_vertex(x1, y1);
+        push_vertex(x2, y2);
+        push_vertex(x1, y2);
+    }
+
+    if (batchVertexData.empty())
+    {
+        return;
+    }
+
+    program.attrib_pointer(program_locations.position, 2, 0, batchVertexData.data());
+    program.attrib_pointer(program_locations.uv_position, 2, 0, batchCoordData.data());
+    GL_CALL(glDrawArrays(GL_TRIANGLES, 0, batchVertexData.size() / 2));
+
+    // Restore the cached quad, so that draw_cached() can still be used.
+    program.attrib_pointer(program_locations.position, 2, 0, vertexData.data());
+    program.attrib_pointer(program_locations.uv_position, 2, 0, coordData.data());
+}
+
 void clear_cached()
 {
     disable_gl_call = false;
@@ -254,9 +1051,9 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
         x, y,
     };
 
-    color_program.attrib_pointer("position", 2, 0, vertexData);
-    color_program.uniformMatrix4f("MVP", matrix);
-    color_program.uniform4f("color", {color.r, color.g, color.b, color.a});
+    color_program.attrib_pointer(color_program_locations.position, 2, 0, vertexData);
+    color_program.uniformMatrix4f(color_program_locations.mvp, matrix);
+    color_program.uniform4f(color_program_locations.color, {color.r, color.g, color.b, color.a});
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -265,6 +1062,75 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
     color_program.deactivate();
 }
 
+void rectangle_batch_t::add(wf::geometry_t box, wf::color_t color)
+{
+    if ((box.width <= 0) || (box.height <= 0))
+    {
+        return;
+    }
+
+    const GLfloat x1 = box.x, y1 = box.y, x2 = box.x + box.width, y2 = box.y + box.height;
+    const GLfloat corners[6][2] = {
+        {x1, y1}, {x2, y1}, {x2, y2},
+        {x1, y1}, {x2, y2}, {x1, y2},
+    };
+
+    for (auto& corner : corners)
+    {
+        vertices.insert(vertices.end(),
+            {corner[0], corner[1], (GLfloat)color.r, (GLfloat)color.g, (GLfloat)color.b, (GLfloat)color.a});
+    }
+}
+
+void rectangle_batch_t::add(wf::geometry_t box, wf::color_t color, const wf::region_t& clip)
+{
+    // The boxes of a region do not overlap, so no part of the rectangle is blended twice.
+    const auto clip_with = pixman_box_from_wlr_box(box);
+    pixman_box32_t chunk[16];
+    for (auto it = clip.begin(); it != clip.end();)
+    {
+        const size_t count = std::min<size_t>(clip.end() - it, 16);
+        std::copy(it, it + count, chunk);
+        wf::intersect_boxes(chunk, count, clip_with);
+        for (size_t i = 0; i < count; i++)
+        {
+            add(wlr_box_from_pixman_box(chunk[i]), color);
+        }
+
+        it += count;
+    }
+}
+
+bool rectangle_batch_t::empty() const
+{
+    return vertices.empty();
+}
+
+void rectangle_batch_t::clear()
+{
+    vertices.clear();
+}
+
+void rectangle_batch_t::render(glm::mat4 matrix) const
+{
+    if (vertices.empty())
+    {
+        return;
+    }
+
+    const int stride = 6 * sizeof(GLfloat);
+    color_batch_program.use(wf::TEXTURE_TYPE_RGBA);
+    color_batch_program.attrib_pointer(color_batch_position, 2, stride, vertices.data());
+    color_batch_program.attrib_pointer(color_batch_color, 4, stride, vertices.data() + 2);
+    color_batch_program.uniformMatrix4f(color_batch_mvp, matrix);
+
+    GL_CALL(glEnable(GL_BLEND));
+    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    GL_CALL(glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 6));
+
+    color_batch_program.deactivate();
+}
+
 static bool egl_make_current(struct wlr_egl *egl)
 {
     if (!eglMakeCurrent(wlr_egl_get_display(egl), EGL_NO_SURFACE, EGL_NO_SURFACE,
@@ -289,20 +1155,140 @@ void render_begin()
         egl_make_current(wf::get_core_impl().egl);
     }
 
+    // The debug output callback can only be (un)registered with a current context.
+    if (gl_checks.debug_output != gl_checks.debug_output_enabled)
+    {
+        gl_checks.debug_output_enabled = gl_checks.debug_output;
+        if (gl_checks.debug_output)
+        {
+            enable_gl_synchronous_debug();
+        } else
+        {
+            disable_gl_synchronous_debug();
+        }
+    }
+
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
 }
 
+namespace
+{
+struct egl_fence_procs_t
+{
+    bool resolved = false;
+    PFNEGLCREATESYNCKHRPROC create_sync = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC destroy_sync = nullptr;
+    PFNEGLWAITSYNCKHRPROC wait_sync = nullptr;
+    PFNEGLDUPNATIVEFENCEFDANDROIDPROC dup_native_fence_fd = nullptr;
+};
+
+/** @return The EGL functions for native fences, or nullptr if the driver does not support them. */
+egl_fence_procs_t *get_fence_procs()
+{
+    static egl_fence_procs_t procs;
+    if (!procs.resolved)
+    {
+        procs.resolved = true;
+        const char *exts = eglQueryString(wlr_egl_get_display(wf::get_core_impl().egl), EGL_EXTENSIONS);
+        if (exts && strstr(exts, "EGL_ANDROID_native_fence_sync") && strstr(exts, "EGL_KHR_wait_sync"))
+        {
+            procs.create_sync  = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+            procs.destroy_sync = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+            procs.wait_sync    = (PFNEGLWAITSYNCKHRPROC)eglGetProcAddress("eglWaitSyncKHR");
+            procs.dup_native_fence_fd =
+                (PFNEGLDUPNATIVEFENCEFDANDROIDPROC)eglGetProcAddress("eglDupNativeFenceFDANDROID");
+        }
+    }
+
+    if (!procs.create_sync || !procs.destroy_sync || !procs.wait_sync || !procs.dup_native_fence_fd)
+    {
+        return nullptr;
+    }
+
+    return &procs;
+}
+}
+
+int export_render_fence()
+{
+    auto procs = get_fence_procs();
+    if (!procs)
+    {
+        return -1;
+    }
+
+    auto egl_display = wlr_egl_get_display(wf::get_core_impl().egl);
+    if (!egl_is_current(wf::get_core_impl().egl))
+    {
+        egl_make_current(wf::get_core_impl().egl);
+    }
+
+    const EGLint attribs[] = {EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID, EGL_NONE};
+    EGLSyncKHR sync = procs->create_sync(egl_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+    if (sync == EGL_NO_SYNC_KHR)
+    {
+        return -1;
+    }
+
+    // The fence is only created when the commands are submitted to the GPU.
+    GL_CALL(glFlush());
+    int fd = procs->dup_native_fence_fd(egl_display, sync);
+    procs->destroy_sync(egl_display, sync);
+    return fd == EGL_NO_NATIVE_FENCE_FD_ANDROID ? -1 : fd;
+}
+
+bool wait_sync_file(int fd)
+{
+    auto procs = get_fence_procs();
+    if (!procs)
+    {
+        close(fd);
+        return false;
+    }
+
+    auto egl_display = wlr_egl_get_display(wf::get_core_impl().egl);
+    if (!egl_is_current(wf::get_core_impl().egl))
+    {
+        egl_make_current(wf::get_core_impl().egl);
+    }
+
+    // On success, the sync object takes ownership of the file descriptor.
+    const EGLint attribs[] = {EGL_SYNC_NATIVE_FENCE_FD_ANDROID, fd, EGL_NONE};
+    EGLSyncKHR sync = procs->create_sync(egl_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+    if (sync == EGL_NO_SYNC_KHR)
+    {
+        close(fd);
+        return false;
+    }
+
+    const bool ok = procs->wait_sync(egl_display, sync, 0) == EGL_TRUE;
+    procs->destroy_sync(egl_display, sync);
+    return ok;
+}
+
 void render_begin(const wf::framebuffer_t& fb)
 {
     render_begin();
     fb.bind();
 }
 
+void render_begin(const wf::render_target_t& target)
+{
+    render_begin();
+    target.bind();
+    if (target.framebuffer_clip)
+    {
+        target.scissor(*target.framebuffer_clip);
+    }
+}
+
 void render_begin(int32_t width, int32_t height, uint32_t fb)
 {
     render_begin();
 
+    track_binding(GL_DRAW_FRAMEBUFFER_BINDING, fb, gl_checks.stats.framebuffer_binds,
+        gl_checks.stats.redundant_framebuffer_binds);
     GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb));
     GL_CALL(glViewport(0, 0, width, height));
 }
@@ -342,8 +1328,48 @@ static std::string framebuffer_status_to_str(
     }
 }
 
+/**
+ * Prepare a texture from the framebuffer pool for reuse, since users may have changed its parameters.
+ */
+static void reset_pooled_texture(GLuint tex)
+{
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+static bool is_poolable(GLuint fb, GLuint tex)
+{
+    return (fb != (GLuint)-1) && (fb != 0) && (tex != (GLuint)-1) && (tex != 0) &&
+           (fb != OpenGL::current_output_fb);
+}
+
 bool wf::framebuffer_t::allocate(int width, int height)
 {
+    const bool is_new    = (fb == (uint32_t)-1) && (tex == (uint32_t)-1);
+    const bool is_resize = is_poolable(fb, tex) && ((width != viewport_width) || (height != viewport_height));
+    if (is_new || is_resize)
+    {
+        GLuint pooled_fb, pooled_tex;
+        if (OpenGL::framebuffer_pool.take(width, height, pooled_fb, pooled_tex))
+        {
+            if (is_resize)
+            {
+                OpenGL::framebuffer_pool.give(fb, tex, viewport_width, viewport_height);
+            }
+
+            fb  = pooled_fb;
+            tex = pooled_tex;
+            reset_pooled_texture(tex);
+            viewport_width  = width;
+            viewport_height = height;
+            return true;
+        }
+    }
+
     bool first_allocate = false;
     if (fb == (uint32_t)-1)
     {
@@ -374,6 +1400,8 @@ bool wf::framebuffer_t::allocate(int width, int height)
             GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
             GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
                 0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+            OpenGL::track_gpu_memory(tex, uint64_t(std::max(width, 0)) * std::max(height, 0) * 4,
+                "framebuffer");
         }
     }
 
@@ -405,6 +1433,8 @@ bool wf::framebuffer_t::allocate(int width, int height)
 
 void wf::framebuffer_t::bind() const
 {
+    track_binding(GL_DRAW_FRAMEBUFFER_BINDING, fb, gl_checks.stats.framebuffer_binds,
+        gl_checks.stats.redundant_framebuffer_binds);
     GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb));
     GL_CALL(glViewport(0, 0, viewport_width, viewport_height));
 }
@@ -418,6 +1448,13 @@ void wf::framebuffer_t::scissor(wlr_box box) const
 
 void wf::framebuffer_t::release()
 {
+    if (is_poolable(fb, tex))
+    {
+        OpenGL::framebuffer_pool.give(fb, tex, viewport_width, viewport_height);
+        reset();
+        return;
+    }
+
     if ((fb != uint32_t(-1)) && (fb != 0))
     {
         GL_CALL(glDeleteFramebuffers(1, &fb));
@@ -426,6 +1463,7 @@ void wf::framebuffer_t::release()
     if ((tex != uint32_t(-1)) && ((fb != 0) || (tex != 0)))
     {
         GL_CALL(glDeleteTextures(1, &tex));
+        OpenGL::untrack_gpu_memory(tex);
     }
 
     reset();
@@ -438,50 +1476,82 @@ void wf::framebuffer_t::reset()
     viewport_width = viewport_height = 0;
 }
 
-wlr_box wf::render_target_t::framebuffer_box_from_geometry_box(wlr_box box) const
+/** Steps 3 and 4 of framebuffer_box_from_geometry_box(): rotate and apply the subbuffer. */
+static wlr_box rotate_to_framebuffer(const wf::render_target_t& target, const wlr_box& scaled)
 {
-    /* Step 1: Make relative to the framebuffer */
-    box.x -= this->geometry.x;
-    box.y -= this->geometry.y;
-
-    /* Step 2: Apply scale to box */
-    wlr_box scaled = box * scale;
-
-    /* Step 3: rotate */
-    int width = viewport_width, height = viewport_height;
-    if (wl_transform & 1)
+    int width = target.viewport_width, height = target.viewport_height;
+    if (target.wl_transform & 1)
     {
         std::swap(width, height);
     }
 
     wlr_box result;
     wl_output_transform transform =
-        wlr_output_transform_invert((wl_output_transform)wl_transform);
+        wlr_output_transform_invert((wl_output_transform)target.wl_transform);
 
     wlr_box_transform(&result, &scaled, transform, width, height);
 
-    if (subbuffer)
+    if (target.subbuffer)
     {
-        result = scale_box({0, 0, viewport_width, viewport_height},
-            subbuffer.value(), result);
+        result = wf::scale_box({0, 0, target.viewport_width, target.viewport_height},
+            target.subbuffer.value(), result);
     }
 
     return result;
 }
 
+wlr_box wf::render_target_t::framebuffer_box_from_geometry_box(wlr_box box) const
+{
+    wlr_box scaled;
+    if (exact_geometry)
+    {
+        /* Steps 1 and 2 at once, rounding only at the end */
+        const auto& g = *exact_geometry;
+        scaled.x = std::floor((box.x - g.x) * scale);
+        scaled.y = std::floor((box.y - g.y) * scale);
+        scaled.width  = std::ceil((box.x + box.width - g.x) * scale) - scaled.x;
+        scaled.height = std::ceil((box.y + box.height - g.y) * scale) - scaled.y;
+    } else
+    {
+        /* Step 1: Make relative to the framebuffer */
+        box.x -= this->geometry.x;
+        box.y -= this->geometry.y;
+
+        /* Step 2: Apply scale to box */
+        scaled = box * scale;
+    }
+
+    return rotate_to_framebuffer(*this, scaled);
+}
+
 wf::region_t wf::render_target_t::framebuffer_region_from_geometry_region(const wf::region_t& region) const
 {
-    wf::region_t result;
-    for (const auto& rect : region)
+    // Steps 1 and 2 are done for all boxes at once, and the region is built from the boxes in one go instead
+    // of merging them one by one.
+    std::vector<pixman_box32_t> boxes(region.begin(), region.end());
+    const wf::pointf_t origin = exact_geometry ?
+        wf::pointf_t{exact_geometry->x, exact_geometry->y} : wf::pointf_t{wf::origin(geometry)};
+    wf::scale_boxes(boxes.data(), boxes.size(), scale, -origin);
+
+    if ((wl_transform != WL_OUTPUT_TRANSFORM_NORMAL) || subbuffer)
     {
-        result |= framebuffer_box_from_geometry_box(wlr_box_from_pixman_box(rect));
+        for (auto& box : boxes)
+        {
+            box = pixman_box_from_wlr_box(rotate_to_framebuffer(*this, wlr_box_from_pixman_box(box)));
+        }
     }
 
-    return result;
+    return wf::region_t{boxes.data(), (int)boxes.size()};
 }
 
 glm::mat4 wf::render_target_t::get_orthographic_projection() const
 {
+    if (exact_geometry)
+    {
+        const auto& g = *exact_geometry;
+        return gl_to_framebuffer() * glm::ortho<float>(g.x, g.x + g.width, g.y + g.height, g.y);
+    }
+
     auto ortho = glm::ortho(1.0f * geometry.x,
         1.0f * geometry.x + 1.0f * geometry.width,
         1.0f * geometry.y + 1.0f * geometry.height,
@@ -520,13 +1590,54 @@ glm::mat4 wf::render_target_t::gl_to_framebuffer() const
 
 void wf::render_target_t::logic_scissor(wlr_box box) const
 {
-    scissor(framebuffer_box_from_geometry_box(box));
+    box = framebuffer_box_from_geometry_box(box);
+    if (framebuffer_clip)
+    {
+        box = wf::geometry_intersection(box, *framebuffer_clip);
+    }
+
+    scissor(box);
 }
 
 wf::render_target_t wf::render_target_t::translated(wf::point_t offset) const
 {
     render_target_t copy = *this;
     copy.geometry = copy.geometry + offset;
+    if (copy.exact_geometry)
+    {
+        copy.exact_geometry->x += offset.x;
+        copy.exact_geometry->y += offset.y;
+    }
+
+    return copy;
+}
+
+wf::render_target_t wf::render_target_t::transformed(double scale, wf::pointf_t offset) const
+{
+    wlr_fbox exact = exact_geometry.value_or(wlr_fbox{
+        (double)geometry.x, (double)geometry.y, (double)geometry.width, (double)geometry.height,
+    });
+
+    exact.x      = (exact.x - offset.x) / scale;
+    exact.y      = (exact.y - offset.y) / scale;
+    exact.width  = exact.width / scale;
+    exact.height = exact.height / scale;
+
+    render_target_t copy = *this;
+    copy.exact_geometry  = exact;
+    copy.geometry.x      = std::floor(exact.x);
+    copy.geometry.y      = std::floor(exact.y);
+    copy.geometry.width  = std::ceil(exact.x + exact.width) - copy.geometry.x;
+    copy.geometry.height = std::ceil(exact.y + exact.height) - copy.geometry.y;
+    copy.scale = this->scale * scale;
+    return copy;
+}
+
+wf::render_target_t wf::render_target_t::clipped(wf::geometry_t box) const
+{
+    render_target_t copy = *this;
+    box = framebuffer_box_from_geometry_box(box);
+    copy.framebuffer_clip = framebuffer_clip ? wf::geometry_intersection(box, *framebuffer_clip) : box;
     return copy;
 }
 
@@ -642,6 +1753,13 @@ class program_t::impl
         return uniforms[active_program_idx][name];
     }
 
+    /** Count a set of a uniform of the currently bound program, see core/gl_state_tracking */
+    template<class T>
+    void track_uniform(int loc, const T *values, int count)
+    {
+        ::track_uniform<T>(id[active_program_idx], loc, values, count);
+    }
+
     std::map<std::string, int> attribs[wf::TEXTURE_TYPE_ALL];
     /** Find the attrib location for the currently bound program */
     int find_attrib_loc(const std::string& name)
@@ -657,6 +1775,16 @@ class program_t::impl
 
         return attribs[active_program_idx][name];
     }
+
+    int active_loc(const program_t::location_t& location) const
+    {
+        return location.loc[active_program_idx];
+    }
+
+    // Locations of the uniforms used by set_active_texture(), resolved on first use.
+    bool builtins_resolved = false;
+    program_t::location_t uv_base;
+    program_t::location_t uv_scale;
 };
 
 program_t::program_t()
@@ -734,6 +1862,8 @@ void program_t::free_resources()
         priv->uniforms[i].clear();
         priv->attribs[i].clear();
     }
+
+    priv->builtins_resolved = false;
 }
 
 void program_t::use(wf::texture_type_t type)
@@ -744,6 +1874,8 @@ void program_t::use(wf::texture_type_t type)
             std::to_string(type));
     }
 
+    track_binding(GL_CURRENT_PROGRAM, priv->id[type], gl_checks.stats.program_binds,
+        gl_checks.stats.redundant_program_binds);
     GL_CALL(glUseProgram(priv->id[type]));
     priv->active_program_idx = type;
 }
@@ -753,39 +1885,123 @@ int program_t::get_program_id(wf::texture_type_t type)
     return priv->id[type];
 }
 
+program_t::location_t program_t::get_uniform_location(const std::string& name)
+{
+    location_t location;
+    for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+    {
+        location.loc[i] = priv->id[i] ? GL_CALL(glGetUniformLocation(priv->id[i], name.c_str())) : -1;
+    }
+
+    return location;
+}
+
+program_t::location_t program_t::get_attrib_location(const std::string& name)
+{
+    location_t location;
+    for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+    {
+        location.loc[i] = priv->id[i] ? GL_CALL(glGetAttribLocation(priv->id[i], name.c_str())) : -1;
+    }
+
+    return location;
+}
+
+void program_t::uniform1i(const location_t& uniform, int value)
+{
+    int loc = priv->active_loc(uniform);
+    priv->track_uniform(loc, &value, 1);
+    GL_CALL(glUniform1i(loc, value));
+}
+
+void program_t::uniform1f(const location_t& uniform, float value)
+{
+    int loc = priv->active_loc(uniform);
+    priv->track_uniform(loc, &value, 1);
+    GL_CALL(glUniform1f(loc, value));
+}
+
+void program_t::uniform2f(const location_t& uniform, float x, float y)
+{
+    int loc = priv->active_loc(uniform);
+    const float values[] = {x, y};
+    priv->track_uniform(loc, values, 2);
+    GL_CALL(glUniform2f(loc, x, y));
+}
+
+void program_t::uniform3f(const location_t& uniform, float x, float y, float z)
+{
+    int loc = priv->active_loc(uniform);
+    const float values[] = {x, y, z};
+    priv->track_uniform(loc, values, 3);
+    GL_CALL(glUniform3f(loc, x, y, z));
+}
+
+void program_t::uniform4f(const location_t& uniform, const glm::vec4& value)
+{
+    int loc = priv->active_loc(uniform);
+    priv->track_uniform(loc, &value[0], 4);
+    GL_CALL(glUniform4f(loc, value.r, value.g, value.b, value.a));
+}
+
+void program_t::uniformMatrix4f(const location_t& uniform, const glm::mat4& value)
+{
+    int loc = priv->active_loc(uniform);
+    priv->track_uniform(loc, &value[0][0], 16);
+    GL_CALL(glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]));
+}
+
+void program_t::attrib_pointer(const location_t& attrib,
+    int size, int stride, const void *ptr, GLenum type)
+{
+    int loc = priv->active_loc(attrib);
+    priv->active_attrs.insert(loc);
+
+    GL_CALL(glEnableVertexAttribArray(loc));
+    GL_CALL(glVertexAttribPointer(loc, size, type, GL_FALSE, stride, ptr));
+}
+
 void program_t::uniform1i(const std::string& name, int value)
 {
     int loc = priv->find_uniform_loc(name);
+    priv->track_uniform(loc, &value, 1);
     GL_CALL(glUniform1i(loc, value));
 }
 
 void program_t::uniform1f(const std::string& name, float value)
 {
     int loc = priv->find_uniform_loc(name);
+    priv->track_uniform(loc, &value, 1);
     GL_CALL(glUniform1f(loc, value));
 }
 
 void program_t::uniform2f(const std::string& name, float x, float y)
 {
     int loc = priv->find_uniform_loc(name);
+    const float values[] = {x, y};
+    priv->track_uniform(loc, values, 2);
     GL_CALL(glUniform2f(loc, x, y));
 }
 
 void program_t::uniform3f(const std::string& name, float x, float y, float z)
 {
     int loc = priv->find_uniform_loc(name);
+    const float values[] = {x, y, z};
+    priv->track_uniform(loc, values, 3);
     GL_CALL(glUniform3f(loc, x, y, z));
 }
 
 void program_t::uniform4f(const std::string& name, const glm::vec4& value)
 {
     int loc = priv->find_uniform_loc(name);
+    priv->track_uniform(loc, &value[0], 4);
     GL_CALL(glUniform4f(loc, value.r, value.g, value.b, value.a));
 }
 
 void program_t::uniformMatrix4f(const std::string& name, const glm::mat4& value)
 {
     int loc = priv->find_uniform_loc(name);
+    priv->track_uniform(loc, &value[0][0], 16);
     GL_CALL(glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]));
 }
 
@@ -809,6 +2025,12 @@ void program_t::attrib_divisor(const std::string& attrib, int divisor)
 void program_t::set_active_texture(const wf::texture_t& texture)
 {
     GL_CALL(glActiveTexture(GL_TEXTURE0));
+    if (texture.target == GL_TEXTURE_2D)
+    {
+        track_binding(GL_TEXTURE_BINDING_2D, texture.tex_id, gl_checks.stats.texture_binds,
+            gl_checks.stats.redundant_texture_binds);
+    }
+
     GL_CALL(glBindTexture(texture.target, texture.tex_id));
     GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 
@@ -829,8 +2051,15 @@ void program_t::set_active_texture(const wf::texture_t& texture)
         base.y   = 1.0 - base.y;
     }
 
-    uniform2f("_wayfire_uv_base", base.x, base.y);
-    uniform2f("_wayfire_uv_scale", scale.x, scale.y);
+    if (!priv->builtins_resolved)
+    {
+        priv->uv_base  = get_uniform_location("_wayfire_uv_base");
+        priv->uv_scale = get_uniform_location("_wayfire_uv_scale");
+        priv->builtins_resolved = true;
+    }
+
+    uniform2f(priv->uv_base, base.x, base.y);
+    uniform2f(priv->uv_scale, scale.x, scale.y);
 }
 
 void program_t::deactivate()
@@ -6,6 +6,7 @@
 #include "wayfire/render-manager.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/startup-profile.hpp"
 
 #include "../output/output-impl.hpp"
 #include <xf86drmMode.h>
@@ -232,20 +233,16 @@ void transfer_views(wf::output_t *from, wf::output_t *to)
     {
         /* If we aren't moving to another output, then there is no need to
          * enumerate views either */
-        auto views = from->wset()->get_views(WSET_SORT_STACKING);
-        for (auto& view : views)
-        {
-            move_view_to_output(view, to, true);
-        }
+        move_views_to_output(from->wset()->get_views(WSET_SORT_STACKING), to, true);
     }
 
     // Step 2: Ensure none of the remaining views have an invalid output.
     // Note that all views in workspace sets will have their output reassigned automatically by the
     // workspace-set impl.
     std::vector<std::shared_ptr<wf::view_interface_t>> non_ws_views;
-    for (auto& view : wf::get_core().get_all_views())
+    for (auto& view : wf::get_core().get_views_on_output(from))
     {
-        if ((view->get_output() == from) && (!toplevel_cast(view) || !toplevel_cast(view)->get_wset()))
+        if (!toplevel_cast(view) || !toplevel_cast(view)->get_wset())
         {
             // Take a ref, so that the view doesn't get destroyed while we're doing operations on the views
             non_ws_views.push_back(view->shared_from_this());
@@ -671,6 +668,51 @@ struct output_layout_output_t
         return true;
     }
 
+    /**
+     * Describe the modeset needed for the given state in @pending, so that it can be committed together
+     * with the other outputs in a single backend commit.
+     *
+     * @return false if the state cannot be applied this way, for example because the render format has to
+     *   be chosen by trial and error.
+     */
+    bool build_backend_state(const output_state_t& state, wlr_output_state& pending)
+    {
+        const bool enabled = !(state.source & OUTPUT_IMAGE_SOURCE_NONE);
+        wlr_output_state_set_enabled(&pending, enabled);
+        if (!enabled)
+        {
+            return true;
+        }
+
+        if (state.depth != current_bit_depth)
+        {
+            return false;
+        }
+
+        refresh_custom_modes();
+        if (auto built_in = find_matching_mode(handle, state.mode, state.uses_custom_mode))
+        {
+            wlr_output_state_set_mode(&pending, built_in);
+        } else
+        {
+            wlr_output_state_set_custom_mode(&pending, state.mode.width, state.mode.height,
+                state.mode.refresh);
+        }
+
+        if ((handle->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED) != state.vrr)
+        {
+            wlr_output_state_set_adaptive_sync_enabled(&pending, state.vrr);
+        }
+
+        if (state.source & OUTPUT_IMAGE_SOURCE_SELF)
+        {
+            wlr_output_state_set_transform(&pending, state.transform);
+            wlr_output_state_set_scale(&pending, state.scale);
+        }
+
+        return true;
+    }
+
     /** Change the output mode */
     void apply_mode(const wlr_output_mode& mode, bool custom_mode)
     {
@@ -742,7 +784,33 @@ struct output_layout_output_t
     wl_listener_wrapper on_frame;
     wlr_output *locked_cursors_on = NULL;
 
-    /** Render the output using texture as source */
+    /* Damage of the mirrored output's buffers, scaled to the size of our buffers. Only valid while
+     * mirroring. */
+    wlr_damage_ring mirror_damage;
+    bool mirror_damage_ready = false;
+    /* Whether the last frame was a direct scanout of the mirrored buffer, so our swapchain buffers do
+     * not have any known contents. */
+    bool mirror_scanout_active = false;
+
+    /** Scan the mirrored output's buffer out directly, if its size matches ours. */
+    bool try_scanout_mirror()
+    {
+        if ((source_back_buffer->width != handle->width) || (source_back_buffer->height != handle->height))
+        {
+            return false;
+        }
+
+        wlr_output_state_set_buffer(&pending_state.pending, source_back_buffer);
+        if (!pending_state.test(handle))
+        {
+            pending_state.reset();
+            return false;
+        }
+
+        return pending_state.commit(handle);
+    }
+
+    /** Render the output using texture as source, repainting only the damaged parts of our buffer. */
     void render_output(wlr_texture *texture)
     {
         int buffer_age;
@@ -753,10 +821,24 @@ struct output_layout_output_t
             return;
         }
 
-        wf::texture_t tex{texture};
-        OpenGL::render_transformed_texture(tex, {-1, -1, 2, 2});
+        wf::region_t damage;
+        if (mirror_scanout_active)
+        {
+            damage |= wf::geometry_t{0, 0, handle->width, handle->height};
+        } else
+        {
+            wlr_damage_ring_get_buffer_damage(&mirror_damage, buffer_age, damage.to_pixman());
+        }
+
+        wlr_render_texture_options options{};
+        options.texture = texture;
+        options.dst_box = {0, 0, handle->width, handle->height};
+        options.clip    = damage.to_pixman();
+        options.blend_mode = WLR_RENDER_BLEND_MODE_NONE;
+        wlr_render_pass_add_texture(pass, &options);
 
         wlr_render_pass_submit(pass);
+        wlr_output_state_set_damage(&pending_state.pending, damage.to_pixman());
         pending_state.commit(handle);
     }
 
@@ -781,15 +863,41 @@ struct output_layout_output_t
             return;
         }
 
-        auto texture = wlr_texture_from_buffer(get_core().renderer, source_back_buffer);
-        if (!texture)
+        if (try_scanout_mirror())
+        {
+            mirror_scanout_active = true;
+        } else
+        {
+            auto texture = wlr_texture_from_buffer(get_core().renderer, source_back_buffer);
+            if (!texture)
+            {
+                LOGE("Failed to export texture to dmabuf!");
+                return;
+            }
+
+            render_output(texture);
+            wlr_texture_destroy(texture);
+            mirror_scanout_active = false;
+        }
+
+        wlr_damage_ring_rotate(&mirror_damage);
+    }
+
+    /** Add the damage of a commit of the mirrored output, in its buffer coordinates, to our damage. */
+    void add_mirror_damage(const wlr_output_state *state)
+    {
+        if (!(state->committed & WLR_OUTPUT_STATE_DAMAGE))
         {
-            LOGE("Failed to export texture to dmabuf!");
+            wlr_damage_ring_add_whole(&mirror_damage);
             return;
         }
 
-        render_output(texture);
-        wlr_texture_destroy(texture);
+        wf::region_t damage;
+        wlr_region_scale_xy(damage.to_pixman(), &state->damage,
+            1.0 * handle->width / state->buffer->width, 1.0 * handle->height / state->buffer->height);
+        // Scaling may produce fractional boxes, so grow the damage to cover their edges as well.
+        wlr_region_expand(damage.to_pixman(), damage.to_pixman(), 1);
+        wlr_damage_ring_add(&mirror_damage, damage.to_pixman());
     }
 
     void set_enabled(bool enabled)
@@ -837,6 +945,11 @@ struct output_layout_output_t
         wlr_output_lock_software_cursors(wo->handle, true);
         locked_cursors_on = wo->handle;
 
+        wlr_damage_ring_init(&mirror_damage);
+        wlr_damage_ring_set_bounds(&mirror_damage, handle->width, handle->height);
+        mirror_damage_ready   = true;
+        mirror_scanout_active = false;
+
         wlr_output_schedule_frame(handle);
         on_mirrored_frame.set_callback([=] (void *data)
         {
@@ -855,6 +968,7 @@ struct output_layout_output_t
 
                 source_back_buffer = ev->state->buffer;
                 wlr_buffer_lock(ev->state->buffer);
+                add_mirror_damage(ev->state);
             }
 
             /* The mirrored output was repainted, schedule repaint
@@ -883,6 +997,11 @@ struct output_layout_output_t
 
         on_mirrored_frame.disconnect();
         on_frame.disconnect();
+        if (mirror_damage_ready)
+        {
+            wlr_damage_ring_finish(&mirror_damage);
+            mirror_damage_ready = false;
+        }
     }
 
     wf::dimensions_t get_effective_size()
@@ -947,6 +1066,8 @@ struct output_layout_output_t
             changed_fields |= wf::OUTPUT_POSITION_CHANGE;
         }
 
+        const bool enabling    = (this->current_state.source == OUTPUT_IMAGE_SOURCE_NONE);
+        const auto apply_start = wf::startup_profile::clock::now();
         this->current_state = state;
 
         /* Even if output will remain mirrored, we can tear it down and set
@@ -978,6 +1099,10 @@ struct output_layout_output_t
             }
 
             pending_state.commit(handle);
+            if (enabling)
+            {
+                wf::startup_profile::record("output", std::string("enable ") + handle->name, apply_start);
+            }
 
             ensure_wayfire_output(get_effective_size());
             output->render->damage_whole();
@@ -1017,7 +1142,7 @@ class output_layout_t::impl
 
     wf::signal::connection_t<wf::reload_config_signal> on_config_reload = [=] (wf::reload_config_signal *ev)
     {
-        reconfigure_from_config();
+        reconfigure_from_config(ev);
     };
 
     wf::signal::connection_t<core_backend_started_signal> on_backend_started =
@@ -1300,14 +1425,26 @@ class output_layout_t::impl
         return configuration;
     }
 
-    /** Load config from file, test and apply */
-    void reconfigure_from_config()
+    /**
+     * Load config from file, test and apply.
+     *
+     * @param reload The reload which triggered the reconfiguration, if any. Outputs whose section did not
+     *   change in it keep their current state.
+     */
+    void reconfigure_from_config(const wf::reload_config_signal *reload = nullptr)
     {
         // Load desired configuration from config file
         output_configuration_t configuration;
+        const bool reload_all = !reload || reload->section_changed("workarounds");
         for (auto& [output, layout_output] : this->outputs)
         {
-            configuration[output] = layout_output->load_configured_state();
+            if (!reload_all && !reload->section_changed(layout_output->config_section->get_name()))
+            {
+                configuration[output] = layout_output->current_state;
+            } else
+            {
+                configuration[output] = layout_output->load_configured_state();
+            }
         }
 
         if (configuration != get_current_configuration())
@@ -1489,6 +1626,91 @@ class output_layout_t::impl
         return ok;
     }
 
+    /** Fill the buffer with black, so that it can be used for the first frame after a modeset. */
+    static bool render_black_frame(wlr_buffer *buffer)
+    {
+        auto pass = wlr_renderer_begin_buffer_pass(wf::get_core().renderer, buffer, NULL);
+        if (!pass)
+        {
+            return false;
+        }
+
+        wlr_render_rect_options rect{};
+        rect.box   = {0, 0, buffer->width, buffer->height};
+        rect.color = {0.0, 0.0, 0.0, 1.0};
+        wlr_render_pass_add_rect(pass, &rect);
+        return wlr_render_pass_submit(pass);
+    }
+
+    /**
+     * Try to modeset all outputs of the configuration with a single backend commit, so that plugging in a
+     * dock results in one modeset instead of one per output. On success, applying the per-output states
+     * afterwards finds the modes already set and only does cheap commits. If the backend rejects the
+     * combined state, nothing is changed and false is returned.
+     */
+    bool commit_configuration_atomically(const output_configuration_t& config)
+    {
+        std::vector<wlr_backend_output_state> states;
+        states.reserve(config.size());
+
+        bool ok = true;
+        for (auto& [handle, state] : config)
+        {
+            if ((handle->data == WF_NOOP_OUTPUT_MAGIC) || !this->outputs.count(handle))
+            {
+                continue;
+            }
+
+            auto& bstate = states.emplace_back();
+            bstate.output = handle;
+            wlr_output_state_init(&bstate.base);
+            ok &= this->outputs[handle]->build_backend_state(state, bstate.base);
+        }
+
+        wlr_output_swapchain_manager swapchain_manager;
+        wlr_output_swapchain_manager_init(&swapchain_manager, wf::get_core().backend);
+        ok = ok && !states.empty() &&
+            wlr_output_swapchain_manager_prepare(&swapchain_manager, states.data(), states.size());
+
+        for (auto& bstate : states)
+        {
+            if (!ok || !bstate.base.enabled)
+            {
+                continue;
+            }
+
+            auto swapchain = wlr_output_swapchain_manager_get_swapchain(&swapchain_manager, bstate.output);
+            int buffer_age;
+            wlr_buffer *buffer = swapchain ? wlr_swapchain_acquire(swapchain, &buffer_age) : NULL;
+            if (!buffer || !render_black_frame(buffer))
+            {
+                ok = false;
+            } else
+            {
+                wlr_output_state_set_buffer(&bstate.base, buffer);
+            }
+
+            if (buffer)
+            {
+                wlr_buffer_unlock(buffer);
+            }
+        }
+
+        ok = ok && wlr_backend_commit(wf::get_core().backend, states.data(), states.size());
+        if (ok)
+        {
+            wlr_output_swapchain_manager_apply(&swapchain_manager);
+        }
+
+        wlr_output_swapchain_manager_finish(&swapchain_manager);
+        for (auto& bstate : states)
+        {
+            wlr_output_state_finish(&bstate.base);
+        }
+
+        return ok;
+    }
+
     /** Apply the given configuration. Config MUST be a valid configuration */
     void apply_configuration(const output_configuration_t& config)
     {
@@ -1527,6 +1749,11 @@ class output_layout_t::impl
             ensure_noop_output();
         }
 
+        if (commit_configuration_atomically(config))
+        {
+            LOGD("Applied output configuration with a single backend commit");
+        }
+
         /* First: disable all outputs that need disabling */
         for (auto& entry : config)
         {
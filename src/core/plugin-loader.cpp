@@ -1,13 +1,21 @@
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <filesystem>
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "plugin-loader.hpp"
 #include "../core/wm.hpp"
 #include "wayfire/plugin.hpp"
 #include <wayfire/util/log.hpp>
+#include <wayfire/debug.hpp>
+#include <wayfire/startup-profile.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/opengl.hpp>
 
 wf::plugin_manager_t::plugin_manager_t()
 {
@@ -16,6 +24,7 @@ wf::plugin_manager_t::plugin_manager_t()
 
     reload_dynamic_plugins();
     load_static_plugins();
+    startup_finished = deferred_plugins.empty();
 
     this->plugins_opt.set_callback([=] ()
     {
@@ -52,7 +61,11 @@ wf::plugin_manager_t::~plugin_manager_t()
 void wf::plugin_manager_t::destroy_plugin(wf::loaded_plugin_t& p)
 {
     LOGD("Unloading plugin ", p.so_path);
-    p.instance->fini();
+    if (p.initialized)
+    {
+        p.instance->fini();
+    }
+
     p.instance.reset();
 
     /* dlopen()/dlclose() do reference counting, so we should close the plugin
@@ -78,13 +91,29 @@ void wf::plugin_manager_t::destroy_plugin(wf::loaded_plugin_t& p)
     }
 }
 
-std::pair<void*, void*> wf::get_new_instance_handle(const std::string& path)
+namespace
+{
+/** Start reading the plugin file into the page cache, without waiting for it. */
+void prefetch_plugin_file(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+}
+
+std::pair<void*, void*> wf::open_plugin_handle(const std::string& path, std::string& error)
 {
     // RTLD_GLOBAL is required for RTTI/dynamic_cast across plugins
     void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_GLOBAL);
     if (handle == NULL)
     {
-        LOGE("error loading plugin [", path, "]: ", dlerror());
+        error = "error loading plugin [" + path + "]: " + nonull(dlerror());
         return {nullptr, nullptr};
     }
 
@@ -92,18 +121,18 @@ std::pair<void*, void*> wf::get_new_instance_handle(const std::string& path)
     auto version_func_ptr = dlsym(handle, "getWayfireVersion");
     if (version_func_ptr == NULL)
     {
-        LOGE(path, ": missing getWayfireVersion()", path.c_str());
+        error = path + ": missing getWayfireVersion()";
         dlclose(handle);
         return {nullptr, nullptr};
     }
 
     auto version_func = union_cast<void*, wayfire_plugin_version_func>(version_func_ptr);
-    int32_t plugin_abi_version = version_func();
+    uint32_t plugin_abi_version = version_func();
 
-    if (version_func() != WAYFIRE_API_ABI_VERSION)
+    if (plugin_abi_version != WAYFIRE_API_ABI_VERSION)
     {
-        LOGE(path, ": API/ABI version mismatch: Wayfire is ",
-            WAYFIRE_API_ABI_VERSION, ",  plugin built with ", plugin_abi_version);
+        error = path + ": API/ABI version mismatch: Wayfire is " + std::to_string(WAYFIRE_API_ABI_VERSION) +
+            ",  plugin built with " + std::to_string(plugin_abi_version);
         dlclose(handle);
         return {nullptr, nullptr};
     }
@@ -111,19 +140,38 @@ std::pair<void*, void*> wf::get_new_instance_handle(const std::string& path)
     auto new_instance_func_ptr = dlsym(handle, "newInstance");
     if (new_instance_func_ptr == NULL)
     {
-        LOGE(path, ": missing newInstance(). ", dlerror());
+        error = path + ": missing newInstance(). " + nonull(dlerror());
         dlclose(handle);
         return {nullptr, nullptr};
     }
 
-    LOGD("Loaded plugin ", path.c_str());
-
     return {handle, new_instance_func_ptr};
 }
 
+std::pair<void*, void*> wf::get_new_instance_handle(const std::string& path)
+{
+    std::string error;
+    auto result = open_plugin_handle(path, error);
+    if (!result.second)
+    {
+        LOGE(error);
+    } else
+    {
+        LOGD("Loaded plugin ", path.c_str());
+    }
+
+    return result;
+}
+
 std::optional<wf::loaded_plugin_t> wf::plugin_manager_t::load_plugin_from_file(std::string path)
 {
-    auto [handle, new_instance_func_ptr] = wf::get_new_instance_handle(path);
+    return instantiate_plugin(path, wf::get_new_instance_handle(path));
+}
+
+std::optional<wf::loaded_plugin_t> wf::plugin_manager_t::instantiate_plugin(const std::string& path,
+    std::pair<void*, void*> plugin_handle)
+{
+    auto [handle, new_instance_func_ptr] = plugin_handle;
     if (new_instance_func_ptr)
     {
         auto new_instance_func = union_cast<void*, wayfire_plugin_load_func>(new_instance_func_ptr);
@@ -201,19 +249,47 @@ void wf::plugin_manager_t::reload_dynamic_plugins()
     }
 
     /* load new plugins */
-    std::vector<std::pair<std::string, wf::loaded_plugin_t>> pending_initialize;
+    std::vector<std::string> to_open;
+    std::copy_if(next_plugins.begin(), next_plugins.end(), std::back_inserter(to_open),
+        [&] (const std::string& plugin) { return !loaded_plugins.count(plugin); });
+
+    /* dlopen() runs the static initializers of the plugins, which may use core (for ex. option wrappers at
+     * namespace scope), so the plugins are opened on the main thread. To avoid waiting for the disk for each
+     * plugin in turn, the kernel is asked to read all of them ahead first. */
+    const auto open_start = std::chrono::steady_clock::now();
+    for (auto& path : to_open)
+    {
+        prefetch_plugin_file(path);
+    }
+
+    std::vector<std::pair<void*, void*>> handles(to_open.size(), {nullptr, nullptr});
+    std::vector<std::string> errors(to_open.size());
+    for (size_t i = 0; i < to_open.size(); i++)
+    {
+        handles[i] = wf::open_plugin_handle(to_open[i], errors[i]);
+    }
 
-    for (auto plugin : next_plugins)
+    if (!to_open.empty())
     {
-        if (loaded_plugins.count(plugin))
+        wf::startup_profile::record("plugin", "open plugins", open_start);
+        LOGD("Opened ", to_open.size(), " plugins in ", std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - open_start).count(), "ms");
+    }
+
+    std::vector<std::pair<std::string, wf::loaded_plugin_t>> pending_initialize;
+    for (size_t i = 0; i < to_open.size(); i++)
+    {
+        if (!handles[i].second)
         {
+            LOGE(errors[i]);
             continue;
         }
 
-        std::optional<wf::loaded_plugin_t> ptr = load_plugin_from_file(plugin);
+        LOGD("Loaded plugin ", to_open[i]);
+        std::optional<wf::loaded_plugin_t> ptr = instantiate_plugin(to_open[i], handles[i]);
         if (ptr)
         {
-            pending_initialize.emplace_back(plugin, std::move(*ptr));
+            pending_initialize.emplace_back(to_open[i], std::move(*ptr));
         }
     }
 
@@ -222,10 +298,73 @@ void wf::plugin_manager_t::reload_dynamic_plugins()
         return a.second.instance->get_order_hint() < b.second.instance->get_order_hint();
     });
 
+    // Deferring is only useful while the compositor starts, afterwards the first frame has been shown.
+    const bool starting = !startup_finished;
     for (auto& [plugin, ptr] : pending_initialize)
     {
-        ptr.instance->init();
-        loaded_plugins[plugin] = std::move(ptr);
+        auto& loaded = loaded_plugins[plugin] = std::move(ptr);
+        if (starting && loaded.instance->defer_init())
+        {
+            deferred_plugins.push_back(plugin);
+        } else
+        {
+            init_plugin(plugin, loaded);
+        }
+    }
+
+    if (!deferred_plugins.empty())
+    {
+        schedule_deferred_init();
+    }
+}
+
+void wf::plugin_manager_t::init_plugin(const std::string& name, loaded_plugin_t& plugin)
+{
+    const auto start = std::chrono::steady_clock::now();
+    OpenGL::gpu_memory_scope_t memory_scope{[&] () { return OpenGL::gpu_memory_owner_t{name}; }};
+    WF_TRACE_ZONE_TEXT("plugin init", name);
+    plugin.instance->init();
+    plugin.initialized = true;
+    wf::startup_profile::record("plugin", "init " + name, start);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    LOGD("Initialized plugin ", name, " in ", elapsed / 1000.0, "ms");
+}
+
+void wf::plugin_manager_t::schedule_deferred_init()
+{
+    // Initialize the deferred plugins after the first frame on any output, or after a timeout if no output
+    // renders (for example, with only the noop output).
+    on_first_frame.set_callback([=] (wf::frame_done_signal*)
+    {
+        idle_init_deferred.run_once([=] () { init_deferred_plugins(); });
+    });
+
+    for (auto& output : wf::get_core().output_layout->get_outputs())
+    {
+        output->connect(&on_first_frame);
+    }
+
+    deferred_init_timeout.set_timeout(DEFERRED_INIT_TIMEOUT_MS, [=] () { init_deferred_plugins(); });
+}
+
+void wf::plugin_manager_t::init_deferred_plugins()
+{
+    on_first_frame.disconnect();
+    deferred_init_timeout.disconnect();
+    idle_init_deferred.disconnect();
+    startup_finished = true;
+
+    auto deferred = std::move(deferred_plugins);
+    deferred_plugins.clear();
+    for (auto& name : deferred)
+    {
+        // The plugin might have been unloaded in the meantime.
+        auto it = loaded_plugins.find(name);
+        if ((it != loaded_plugins.end()) && !it->second.initialized)
+        {
+            init_plugin(name, it->second);
+        }
     }
 }
 
@@ -237,6 +376,7 @@ static wf::loaded_plugin_t create_plugin(std::string name)
     lp.so_handle = nullptr;
     lp.so_path   = name;
     lp.instance->init();
+    lp.initialized = true;
     return lp;
 }
 
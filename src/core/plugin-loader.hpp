@@ -6,6 +6,8 @@
 #include "config.h"
 #include "wayfire/util.hpp"
 #include <wayfire/option-wrapper.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/signal-provider.hpp>
 
 namespace wf
 {
@@ -19,6 +21,9 @@ struct loaded_plugin_t
 
     // A path to the .so file of the plugin.
     std::string so_path;
+
+    // Whether init() has been called, see plugin_interface_t::defer_init().
+    bool initialized = false;
 };
 
 struct plugin_manager_t
@@ -36,7 +41,19 @@ struct plugin_manager_t
 
     void deinit_plugins(bool unloadable);
 
+    /** Plugins whose init() is deferred until the first frame after startup, by path. */
+    std::vector<std::string> deferred_plugins;
+    wf::signal::connection_t<wf::frame_done_signal> on_first_frame;
+    wf::wl_timer<false> deferred_init_timeout;
+    wf::wl_idle_call idle_init_deferred;
+    bool startup_finished = false;
+    static constexpr uint32_t DEFERRED_INIT_TIMEOUT_MS = 1000;
+    void init_plugin(const std::string& name, loaded_plugin_t& plugin);
+    void schedule_deferred_init();
+    void init_deferred_plugins();
+
     std::optional<loaded_plugin_t> load_plugin_from_file(std::string path);
+    std::optional<loaded_plugin_t> instantiate_plugin(const std::string& path, std::pair<void*, void*> handle);
     void load_static_plugins();
     void destroy_plugin(loaded_plugin_t& plugin);
 };
@@ -64,6 +81,12 @@ B union_cast(A object)
  */
 std::pair<void*, void*> get_new_instance_handle(const std::string& path);
 
+/**
+ * Same as get_new_instance_handle(), but instead of logging, describe the failure in @error. Must be called
+ * on the main thread, because dlopen() runs the static initializers of the plugin.
+ */
+std::pair<void*, void*> open_plugin_handle(const std::string& path, std::string& error);
+
 /**
  * List the locations where wayfire's plugins are installed.
  * This function takes care of env variable WAYFIRE_PLUGIN_PATH,
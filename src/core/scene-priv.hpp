@@ -7,6 +7,20 @@ namespace wf
 namespace scene
 {
 struct root_node_t::priv_t
-{};
+{
+    /* The last result of keyboard_refocus(), see core/keyboard_refocus_cache. */
+    struct
+    {
+        uint64_t generation  = 0;
+        wf::output_t *output = nullptr;
+        wf::keyboard_focus_node_t result;
+    } refocus_cache;
+};
+
+/**
+ * A counter which is incremented whenever the list of children of any node changes, that is, whenever the
+ * stacking order or the set of nodes attached to the scenegraph may have changed.
+ */
+uint64_t get_children_list_generation();
 }
 }
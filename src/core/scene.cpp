@@ -4,6 +4,8 @@
 #include <wayfire/view.hpp>
 #include <wayfire/output.hpp>
 #include <algorithm>
+#include <iterator>
+#include <unordered_map>
 
 #include "scene-priv.hpp"
 #include "wayfire/geometry.hpp"
@@ -13,6 +15,8 @@
 #include "wayfire/scene-render.hpp"
 #include "wayfire/signal-provider.hpp"
 #include <wayfire/core.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/trace.hpp>
 
 namespace wf
 {
@@ -42,6 +46,69 @@ bool keyboard_focus_node_t::operator <(const keyboard_focus_node_t& other) const
 namespace scene
 {
 // ---------------------------------- node_t -----------------------------------
+/**
+ * Hit-testing is done on every pointer, touch and tablet motion event, and walks through all views, even
+ * those which are far away from the cursor. To speed it up, inner nodes may cache the bounding boxes of the
+ * views among their children, and skip views whose bounding box does not contain the point.
+ *
+ * The cache is invalidated whenever the scenegraph is updated and whenever an output is repainted, so it is
+ * at most as old as the contents shown on the screen.
+ */
+struct node_t::hit_test_cache_t
+{
+    struct entry_t
+    {
+        node_t *node;
+        // Only views are known to accept input solely inside of their bounding box.
+        bool is_view;
+        wf::geometry_t bbox;
+    };
+
+    uint64_t generation = 0;
+    std::vector<entry_t> entries;
+};
+
+static uint64_t hit_test_generation = 1;
+
+void invalidate_hit_test_cache()
+{
+    ++hit_test_generation;
+}
+
+uint64_t get_hit_test_generation()
+{
+    return hit_test_generation;
+}
+
+/**
+ * Bounding boxes of nodes are queried many times in each frame (for damage, visibility and for scheduling
+ * render instructions), and computing them walks through the whole subtree of the node and applies all
+ * transformers. Inside of a bounding box cache scope, every cached box is valid until the scope ends or
+ * until the node is marked as dirty by update().
+ *
+ * The cache is limited to explicit scopes, because plugins commonly change transformers without calling
+ * update(), only damaging the view before and after the change.
+ */
+static uint64_t bounding_box_generation = 1;
+static int bounding_box_cache_depth     = 0;
+
+void begin_bounding_box_cache()
+{
+    static wf::option_wrapper_t<bool> use_bounding_box_cache{"core/bounding_box_cache"};
+    if ((bounding_box_cache_depth > 0) || use_bounding_box_cache)
+    {
+        ++bounding_box_cache_depth;
+    }
+}
+
+void end_bounding_box_cache()
+{
+    if ((bounding_box_cache_depth > 0) && (--bounding_box_cache_depth == 0))
+    {
+        ++bounding_box_generation;
+    }
+}
+
 node_t::~node_t()
 {}
 
@@ -71,16 +138,62 @@ std::string node_t::stringify_flags() const
     return "(" + fl + ")";
 }
 
+bool node_t::validate_hit_test_cache()
+{
+    static wf::option_wrapper_t<bool> use_hit_test_cache{"core/hit_test_cache"};
+    if (!use_hit_test_cache)
+    {
+        hit_test_cache.reset();
+        return false;
+    }
+
+    if (!hit_test_cache)
+    {
+        hit_test_cache = std::make_unique<hit_test_cache_t>();
+    }
+
+    if ((hit_test_cache->generation == hit_test_generation) &&
+        (hit_test_cache->entries.size() == children.size()))
+    {
+        return true;
+    }
+
+    hit_test_cache->entries.clear();
+    for (auto& ch : children)
+    {
+        const bool is_view = ch->is_enabled() && dynamic_cast<wf::view_node_tag_t*>(ch.get());
+        hit_test_cache->entries.push_back({
+            .node    = ch.get(),
+            .is_view = is_view,
+            .bbox    = is_view ? ch->get_bounding_box() : wf::geometry_t{0, 0, 0, 0},
+        });
+    }
+
+    hit_test_cache->generation = hit_test_generation;
+    return true;
+}
+
 std::optional<input_node_t> node_t::find_node_at(const wf::pointf_t& at)
 {
     auto local = this->to_local(at);
-    for (auto& node : get_children())
+    const bool use_cache = validate_hit_test_cache();
+    for (size_t i = 0; i < children.size(); i++)
     {
+        auto& node = children[i];
         if (!node->is_enabled())
         {
             continue;
         }
 
+        if (use_cache)
+        {
+            const auto& entry = hit_test_cache->entries[i];
+            if ((entry.node == node.get()) && entry.is_view && !(entry.bbox & local))
+            {
+                continue;
+            }
+        }
+
         auto child_node = node->find_node_at(local);
         if (child_node.has_value())
         {
@@ -121,6 +234,41 @@ bool floating_inner_node_t::set_children_list(std::vector<node_ptr> new_list)
     return true;
 }
 
+bool floating_inner_node_t::move_to_front(node_ptr child)
+{
+    auto it = std::find(children.begin(), children.end(), child);
+    wf::dassert(it != children.end(), "Moving a node which is not a child!");
+    if (it == children.begin())
+    {
+        return false;
+    }
+
+    std::rotate(children.begin(), it, it + 1);
+
+    // Only the area of the moved child is painted differently.
+    node_damage_signal data;
+    data.region |= child->get_bounding_box();
+    this->emit(&data);
+    return true;
+}
+
+bool floating_inner_node_t::move_to_back(node_ptr child)
+{
+    auto it = std::find(children.begin(), children.end(), child);
+    wf::dassert(it != children.end(), "Moving a node which is not a child!");
+    if (it + 1 == children.end())
+    {
+        return false;
+    }
+
+    std::rotate(it, it + 1, children.end());
+
+    node_damage_signal data;
+    data.region |= child->get_bounding_box();
+    this->emit(&data);
+    return true;
+}
+
 void node_t::set_children_unchecked(std::vector<node_ptr> new_list)
 {
     node_damage_signal data;
@@ -234,6 +382,16 @@ class default_render_instance_t : public render_instance_t
         // from being scanned out.
         return direct_scanout::SKIP;
     }
+
+    bool can_render_transformed() override
+    {
+        return true;
+    }
+
+    int get_alpha_layer_count() override
+    {
+        return 0;
+    }
 };
 
 void node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
@@ -267,7 +425,7 @@ wf::geometry_t node_t::get_children_bounding_box()
 
     for (auto& ch : children)
     {
-        auto bbox = ch->get_bounding_box();
+        auto bbox = ch->get_cached_bounding_box();
 
         min_x = std::min(min_x, bbox.x);
         min_y = std::min(min_y, bbox.y);
@@ -283,6 +441,22 @@ wf::geometry_t node_t::get_bounding_box()
     return get_children_bounding_box();
 }
 
+wf::geometry_t node_t::get_cached_bounding_box()
+{
+    if (bounding_box_cache_depth == 0)
+    {
+        return get_bounding_box();
+    }
+
+    if (cached_bounding_box_generation != bounding_box_generation)
+    {
+        cached_bounding_box = get_bounding_box();
+        cached_bounding_box_generation = bounding_box_generation;
+    }
+
+    return cached_bounding_box;
+}
+
 uint32_t node_t::optimize_update(uint32_t flags)
 {
     if (!this->is_enabled())
@@ -318,6 +492,7 @@ wf::pointf_t output_node_t::to_global(const wf::pointf_t& point)
 
 std::optional<input_node_t> output_node_t::find_node_at(const wf::pointf_t& at)
 {
+    WF_TRACE_ZONE("find_node_at");
     if (limit_region && !(*limit_region & at))
     {
         return {};
@@ -329,29 +504,155 @@ std::optional<input_node_t> output_node_t::find_node_at(const wf::pointf_t& at)
 class output_render_instance_t : public default_render_instance_t
 {
     wf::output_t *output;
+    wf::output_t *shown_on;
     output_node_t *self;
+    damage_callback push_damage;
     std::vector<render_instance_uptr> children;
+    wf::signal::connection_t<node_regen_instances_signal> on_regen_instances;
+
+    /** The range of @children generated by one enabled child node. */
+    struct child_range_t
+    {
+        node_ptr node;
+        uint64_t generation;
+        size_t count;
+    };
+
+    std::vector<child_range_t> child_ranges;
+
+    /**
+     * The render instances of a disabled child node, kept alive so that they do not have to be generated
+     * again when the node is enabled (for example, when switching back to a workspace set), see
+     * core/detached_instances_cache. Sorted from the most recently detached.
+     */
+    struct detached_instances_t
+    {
+        node_ptr node;
+        uint64_t generation;
+        std::vector<render_instance_uptr> instances;
+    };
+
+    std::vector<detached_instances_t> detached;
 
   public:
     output_render_instance_t(output_node_t *self, damage_callback callback,
         wf::output_t *output, wf::output_t *shown_on) :
         default_render_instance_t(self, transform_damage(callback))
     {
-        this->self   = self;
-        this->output = output;
+        this->self     = self;
+        this->output   = output;
+        this->shown_on = shown_on;
+        this->push_damage = callback;
+
+        on_regen_instances = [=] (node_regen_instances_signal*)
+        {
+            regen_instances();
+        };
+        self->connect(&on_regen_instances);
+        regen_instances();
+    }
+
+    void regen_instances()
+    {
+        static wf::option_wrapper_t<int> detached_cache_size{"core/detached_instances_cache"};
+        if (detached_cache_size <= 0)
+        {
+            detached.clear();
+            child_ranges.clear();
+            // Children are stored as a sublist, because we need to translate every
+            // time between global and output-local geometry.
+            children.clear();
+            for (auto& child : self->get_children())
+            {
+                if (child->is_enabled())
+                {
+                    child->gen_render_instances(children,
+                        transform_damage(push_damage), shown_on);
+                }
+            }
+
+            return;
+        }
+
+        // Keep the instances of the children which were disabled since the last time.
+        auto old_children = std::move(children);
+        children.clear();
+        size_t idx = 0;
+        for (auto& range : child_ranges)
+        {
+            auto begin = old_children.begin() + idx;
+            idx += range.count;
+            if (range.node->is_enabled() || (range.node->parent() != self))
+            {
+                continue;
+            }
 
-        // Children are stored as a sublist, because we need to translate every
-        // time between global and output-local geometry.
+            detached_instances_t entry;
+            entry.node = range.node;
+            entry.generation = range.generation;
+            entry.instances.insert(entry.instances.end(), std::make_move_iterator(begin),
+                std::make_move_iterator(begin + range.count));
+            detached.insert(detached.begin(), std::move(entry));
+        }
+
+        old_children.clear();
+        child_ranges.clear();
         for (auto& child : self->get_children())
         {
-            if (child->is_enabled())
+            if (!child->is_enabled())
+            {
+                continue;
+            }
+
+            const size_t count_before = children.size();
+            auto it = std::find_if(detached.begin(), detached.end(), [&] (const detached_instances_t& entry)
+            {
+                return entry.node == child;
+            });
+            if ((it != detached.end()) && (it->generation == child->get_instances_generation()))
+            {
+                std::move(it->instances.begin(), it->instances.end(), std::back_inserter(children));
+            } else
+            {
+                child->gen_render_instances(children, transform_damage(child_damage(child)), shown_on);
+            }
+
+            if (it != detached.end())
             {
-                child->gen_render_instances(children,
-                    transform_damage(callback), shown_on);
+                detached.erase(it);
             }
+
+            child_ranges.push_back({child, child->get_instances_generation(), children.size() - count_before});
+        }
+
+        // Drop the instances of children which were removed in the meantime or were detached long ago.
+        auto is_stale = [&] (const detached_instances_t& entry)
+        {
+            return (entry.node->parent() != self) ||
+                   (entry.node->get_instances_generation() != entry.generation);
+        };
+        detached.erase(std::remove_if(detached.begin(), detached.end(), is_stale), detached.end());
+        if ((int)detached.size() > detached_cache_size)
+        {
+            detached.resize(detached_cache_size);
         }
     }
 
+    /**
+     * Detached instances still receive the damage of their nodes, but it is not relevant while the nodes are
+     * disabled.
+     */
+    damage_callback child_damage(node_ptr child)
+    {
+        return [=] (const wf::region_t& damage)
+        {
+            if (child->is_enabled())
+            {
+                push_damage(damage);
+            }
+        };
+    }
+
     damage_callback transform_damage(damage_callback child_damage)
     {
         return [=] (const wf::region_t& damage)
@@ -444,6 +745,13 @@ void output_node_t::gen_render_instances(
             shown_on));
 }
 
+uint32_t output_node_t::optimize_update(uint32_t flags)
+{
+    // Views are added and removed from outputs all the time, but this doesn't affect other outputs, so the
+    // output's render instances can regenerate their children locally.
+    return optimize_nested_render_instances(shared_from_this(), flags);
+}
+
 wf::geometry_t output_node_t::get_bounding_box()
 {
     const auto bbox = node_t::get_bounding_box();
@@ -468,6 +776,38 @@ root_node_t::root_node_t() : floating_inner_node_t(true)
 root_node_t::~root_node_t()
 {}
 
+static uint64_t keyboard_refocus_generation = 1;
+
+void invalidate_keyboard_refocus()
+{
+    ++keyboard_refocus_generation;
+}
+
+/**
+ * Refocusing walks through the whole scenegraph and evaluates the focus candidates among all views and
+ * layer-shell surfaces. It is often triggered several times in a row without anything changing in between
+ * (for example, by consecutive layer-shell state changes), so the last result is cached until the
+ * scenegraph is updated or focus changes.
+ */
+wf::keyboard_focus_node_t root_node_t::keyboard_refocus(wf::output_t *output)
+{
+    static wf::option_wrapper_t<bool> use_refocus_cache{"core/keyboard_refocus_cache"};
+    if (!use_refocus_cache)
+    {
+        return floating_inner_node_t::keyboard_refocus(output);
+    }
+
+    auto& cache = priv->refocus_cache;
+    if ((cache.generation != keyboard_refocus_generation) || (cache.output != output))
+    {
+        cache.result     = floating_inner_node_t::keyboard_refocus(output);
+        cache.output     = output;
+        cache.generation = keyboard_refocus_generation;
+    }
+
+    return cache.result;
+}
+
 std::string root_node_t::stringify() const
 {
     return "root " + stringify_flags();
@@ -491,13 +831,53 @@ void set_node_enabled(wf::scene::node_ptr node, bool enabled)
     }
 }
 
+static uint64_t children_list_generation = 1;
+uint64_t get_children_list_generation()
+{
+    return children_list_generation;
+}
+
 void update(node_ptr changed_node, uint32_t flags)
 {
+    if (flags & update_flag::REORDERED)
+    {
+        // Only the node whose children were reordered sees the flag, its parents see the result.
+        static wf::option_wrapper_t<bool> incremental_restack{"core/incremental_restack"};
+        node_reorder_instances_signal data;
+        if (incremental_restack && !(flags & update_flag::CHILDREN_LIST))
+        {
+            changed_node->emit(&data);
+        }
+
+        flags &= ~update_flag::REORDERED;
+        if (data.handled)
+        {
+            // The stacking order still changed, as did visibility and input.
+            ++children_list_generation;
+            flags |= update_flag::GEOMETRY | update_flag::INPUT_STATE;
+        } else
+        {
+            flags |= update_flag::CHILDREN_LIST;
+        }
+    }
+
+    if (flags & update_flag::CHILDREN_LIST)
+    {
+        ++children_list_generation;
+    }
+
+    invalidate_hit_test_cache();
+    invalidate_keyboard_refocus();
     if ((flags & update_flag::CHILDREN_LIST) ||
         (flags & update_flag::ENABLED) ||
         (flags & update_flag::GEOMETRY))
     {
         flags |= update_flag::INPUT_STATE;
+        // Mark the cached bounding boxes as dirty here, because parents may optimize the flags away.
+        for (node_t *node = changed_node.get(); node; node = node->parent())
+        {
+            node->cached_bounding_box_generation = 0;
+        }
     }
 
     if (!changed_node->is_enabled() &&
@@ -514,8 +894,19 @@ void update(node_ptr changed_node, uint32_t flags)
         return;
     }
 
+    if (flags & update_flag::CHILDREN_LIST)
+    {
+        ++changed_node->instances_generation;
+    }
+
     if (changed_node->parent())
     {
+        if (flags & (update_flag::CHILDREN_LIST | update_flag::ENABLED))
+        {
+            // Whether the parent handles the update locally or not, its subtree changed.
+            ++changed_node->parent()->instances_generation;
+        }
+
         flags = changed_node->parent()->optimize_update(flags);
         if (!changed_node->parent()->is_enabled())
         {
@@ -549,5 +940,71 @@ uint32_t optimize_nested_render_instances(wf::scene::node_ptr node, uint32_t fla
 
     return flags;
 }
+
+// ---------------------------- damage attribution -----------------------------
+namespace
+{
+struct attributed_node_t
+{
+    // Used to notice when the address of a destroyed node is reused for a new node. Nodes which are not
+    // owned by a shared_ptr yet (damaged in their constructor) cannot be tracked.
+    std::weak_ptr<node_t> node;
+    bool tracked = false;
+    node_damage_stats_t stats;
+};
+
+std::unordered_map<node_t*, attributed_node_t>& damage_attribution()
+{
+    static std::unordered_map<node_t*, attributed_node_t> nodes;
+    return nodes;
+}
+}
+
+bool detail::damage_attribution_enabled = false;
+
+void detail::record_node_damage(node_t *node, const wf::region_t& damage)
+{
+    auto& entry = damage_attribution()[node];
+    if ((entry.stats.reports == 0) || (entry.tracked && entry.node.expired()))
+    {
+        entry.node    = node->weak_from_this();
+        entry.tracked = !entry.node.expired();
+        entry.stats   = {};
+        entry.stats.node = node->stringify();
+    }
+
+    for (const auto& box : damage)
+    {
+        entry.stats.area += uint64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+    }
+
+    ++entry.stats.reports;
+}
+
+void set_damage_attribution(bool enabled)
+{
+    detail::damage_attribution_enabled = enabled;
+}
+
+std::vector<node_damage_stats_t> get_damage_attribution()
+{
+    std::vector<node_damage_stats_t> result;
+    result.reserve(damage_attribution().size());
+    for (auto& [_, entry] : damage_attribution())
+    {
+        result.push_back(entry.stats);
+    }
+
+    std::sort(result.begin(), result.end(), [] (const auto& a, const auto& b)
+    {
+        return a.area > b.area;
+    });
+    return result;
+}
+
+void reset_damage_attribution()
+{
+    damage_attribution().clear();
+}
 } // namespace scene
 }
@@ -4,6 +4,8 @@
 #include "hotspot-manager.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include <wayfire/debug.hpp>
+#include <map>
+#include <unordered_map>
 
 struct wf::bindings_repository_t::impl
 {
@@ -35,8 +37,84 @@ struct wf::bindings_repository_t::impl
 
     hotspot_manager_t hotspot_mgr;
 
+    /**
+     * The callbacks of the bindings which match a pressed combination of modifiers and key or button.
+     */
+    template<class Callback>
+    struct matches_t
+    {
+        std::vector<Callback*> bindings;
+        std::vector<activator_callback*> activators;
+    };
+
+    /**
+     * The matching bindings of each combination which was pressed, indexed by (modifiers << 32 | key or
+     * button). The entries are filled on the first press of a combination, so that later presses do not
+     * have to compare the combination with every registered binding.
+     *
+     * The index is cleared whenever a binding is added or removed, or the value of a binding option changes.
+     */
+    std::unordered_map<uint64_t, matches_t<key_callback>> key_matches;
+    std::unordered_map<uint64_t, matches_t<button_callback>> button_matches;
+    std::unordered_map<uint32_t, std::vector<axis_callback*>> axis_matches;
+
+    /**
+     * Copies of the matching callbacks, which are needed because the callbacks may add or remove bindings.
+     * They are reused between events, so that dispatching does not allocate.
+     */
+    matches_t<key_callback> key_dispatch;
+    matches_t<button_callback> button_dispatch;
+    std::vector<axis_callback*> axis_dispatch;
+
+    void invalidate_matches()
+    {
+        key_matches.clear();
+        button_matches.clear();
+        axis_matches.clear();
+    }
+
+    /** The options of the registered bindings, with the number of bindings using each of them. */
+    std::map<wf::config::option_base_t*, int> watched_options;
+    wf::config::option_base_t::updated_callback_t on_binding_option_updated = [=] ()
+    {
+        invalidate_matches();
+    };
+
+    void watch_option(wf::config::option_base_t *option)
+    {
+        if (watched_options[option]++ == 0)
+        {
+            option->add_updated_handler(&on_binding_option_updated);
+        }
+    }
+
+    void unwatch_option(wf::config::option_base_t *option)
+    {
+        auto it = watched_options.find(option);
+        if ((it != watched_options.end()) && (--it->second == 0))
+        {
+            option->rem_updated_handler(&on_binding_option_updated);
+            watched_options.erase(it);
+        }
+    }
+
+    ~impl()
+    {
+        for (auto& [option, count] : watched_options)
+        {
+            option->rem_updated_handler(&on_binding_option_updated);
+        }
+    }
+
     wf::signal::connection_t<wf::reload_config_signal> on_config_reload = [=] (wf::reload_config_signal *ev)
     {
+        // Bindings may come from any section, but nothing needs to be rebuilt if no option changed.
+        if (!ev->any_changed())
+        {
+            return;
+        }
+
+        invalidate_matches();
         recreate_hotspots();
         reparse_extensions();
     };
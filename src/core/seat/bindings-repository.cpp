@@ -9,13 +9,59 @@ wf::bindings_repository_t::bindings_repository_t()
 }
 
 template<class Option, class Callback>
-static void push_binding(wf::binding_container_t<Option, Callback>& bindings,
-    wf::option_sptr_t<Option> opt, Callback *callback)
+static void push_binding(wf::bindings_repository_t::impl *priv,
+    wf::binding_container_t<Option, Callback>& bindings, wf::option_sptr_t<Option> opt, Callback *callback)
 {
     auto bnd = std::make_unique<wf::binding_t<Option, Callback>>();
     bnd->activated_by = opt;
     bnd->callback     = callback;
     bindings.emplace_back(std::move(bnd));
+    priv->watch_option(opt.get());
+    priv->invalidate_matches();
+}
+
+/**
+ * Find the bindings which match the pressed combination, filling the index on the first lookup.
+ */
+template<class Option, class Callback, class Pressed>
+static const wf::bindings_repository_t::impl::matches_t<Callback>& find_matches(
+    std::unordered_map<uint64_t, wf::bindings_repository_t::impl::matches_t<Callback>>& index,
+    const wf::binding_container_t<Option, Callback>& bindings,
+    const wf::binding_container_t<wf::activatorbinding_t, wf::activator_callback>& activators,
+    uint64_t hash, const Pressed& pressed)
+{
+    // Bound the index, the number of distinct combinations a user presses is usually small.
+    static constexpr size_t MAX_INDEXED_COMBINATIONS = 1024;
+
+    auto it = index.find(hash);
+    if (it != index.end())
+    {
+        return it->second;
+    }
+
+    if (index.size() >= MAX_INDEXED_COMBINATIONS)
+    {
+        index.clear();
+    }
+
+    auto& matches = index[hash];
+    for (auto& binding : bindings)
+    {
+        if (binding->activated_by->get_value() == pressed)
+        {
+            matches.bindings.push_back(binding->callback);
+        }
+    }
+
+    for (auto& binding : activators)
+    {
+        if (binding->activated_by->get_value().has_match(pressed))
+        {
+            matches.activators.push_back(binding->callback);
+        }
+    }
+
+    return matches;
 }
 
 wf::bindings_repository_t::~bindings_repository_t()
@@ -23,23 +69,23 @@ wf::bindings_repository_t::~bindings_repository_t()
 
 void wf::bindings_repository_t::add_key(option_sptr_t<keybinding_t> key, wf::key_callback *cb)
 {
-    push_binding(priv->keys, key, cb);
+    push_binding(priv.get(), priv->keys, key, cb);
 }
 
 void wf::bindings_repository_t::add_axis(option_sptr_t<keybinding_t> axis, wf::axis_callback *cb)
 {
-    push_binding(priv->axes, axis, cb);
+    push_binding(priv.get(), priv->axes, axis, cb);
 }
 
 void wf::bindings_repository_t::add_button(option_sptr_t<buttonbinding_t> button, wf::button_callback *cb)
 {
-    push_binding(priv->buttons, button, cb);
+    push_binding(priv.get(), priv->buttons, button, cb);
 }
 
 void wf::bindings_repository_t::add_activator(
     option_sptr_t<activatorbinding_t> activator, wf::activator_callback *cb)
 {
-    push_binding(priv->activators, activator, cb);
+    push_binding(priv.get(), priv->activators, activator, cb);
     if (activator->get_value().get_hotspots().size())
     {
         priv->recreate_hotspots();
@@ -54,52 +100,39 @@ bool wf::bindings_repository_t::handle_key(const wf::keybinding_t& pressed,
         return false;
     }
 
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->priv->keys)
+    const uint64_t hash = ((uint64_t)pressed.get_modifiers() << 32) | pressed.get_key();
+    const auto& found   = find_matches(priv->key_matches, priv->keys, priv->activators, hash, pressed);
+
+    /* We must be careful because the callbacks might add or erase bindings,
+     * so copy them before calling any. The dispatch buffer is taken over, in case a callback triggers
+     * another binding. */
+    auto callbacks = std::move(priv->key_dispatch);
+    callbacks.bindings.assign(found.bindings.begin(), found.bindings.end());
+    callbacks.activators.assign(found.activators.begin(), found.activators.end());
+
+    bool handled = false;
+    for (auto callback : callbacks.bindings)
     {
-        if (binding->activated_by->get_value() == pressed)
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback] ()
-            {
-                return (*callback)(pressed);
-            });
-        }
+        handled |= (*callback)(pressed);
     }
 
-    for (auto& binding : this->priv->activators)
+    for (auto callback : callbacks.activators)
     {
-        if (binding->activated_by->get_value().has_match(pressed))
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback, mod_binding_key] ()
-            {
-                wf::activator_data_t ev = {
-                    .source = activator_source_t::KEYBINDING,
-                    .activation_data = pressed.get_key()
-                };
+        wf::activator_data_t ev = {
+            .source = activator_source_t::KEYBINDING,
+            .activation_data = pressed.get_key()
+        };
 
-                if (mod_binding_key)
-                {
-                    ev.source = activator_source_t::MODIFIERBINDING;
-                    ev.activation_data = mod_binding_key;
-                }
-
-                return (*callback)(ev);
-            });
+        if (mod_binding_key)
+        {
+            ev.source = activator_source_t::MODIFIERBINDING;
+            ev.activation_data = mod_binding_key;
         }
-    }
 
-    bool handled = false;
-    for (auto& cb : callbacks)
-    {
-        handled |= cb();
+        handled |= (*callback)(ev);
     }
 
+    priv->key_dispatch = std::move(callbacks);
     return handled;
 }
 
@@ -111,22 +144,29 @@ bool wf::bindings_repository_t::handle_axis(uint32_t modifiers,
         return false;
     }
 
-    std::vector<wf::axis_callback*> callbacks;
-
-    for (auto& binding : this->priv->axes)
+    auto it = priv->axis_matches.find(modifiers);
+    if (it == priv->axis_matches.end())
     {
-        if (binding->activated_by->get_value() == wf::keybinding_t{modifiers, 0})
+        it = priv->axis_matches.emplace(modifiers, std::vector<wf::axis_callback*>{}).first;
+        for (auto& binding : this->priv->axes)
         {
-            callbacks.push_back(binding->callback);
+            if (binding->activated_by->get_value() == wf::keybinding_t{modifiers, 0})
+            {
+                it->second.push_back(binding->callback);
+            }
         }
     }
 
+    auto callbacks = std::move(priv->axis_dispatch);
+    callbacks.assign(it->second.begin(), it->second.end());
     for (auto call : callbacks)
     {
         (*call)(ev);
     }
 
-    return !callbacks.empty();
+    const bool handled = !callbacks.empty();
+    priv->axis_dispatch = std::move(callbacks);
+    return handled;
 }
 
 bool wf::bindings_repository_t::handle_button(const wf::buttonbinding_t& pressed)
@@ -136,45 +176,31 @@ bool wf::bindings_repository_t::handle_button(const wf::buttonbinding_t& pressed
         return false;
     }
 
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->priv->buttons)
-    {
-        if (binding->activated_by->get_value() == pressed)
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
-            {
-                return (*callback)(pressed);
-            });
-        }
-    }
+    const uint64_t hash = ((uint64_t)pressed.get_modifiers() << 32) | pressed.get_button();
+    const auto& found   = find_matches(priv->button_matches, priv->buttons, priv->activators, hash, pressed);
 
-    for (auto& binding : this->priv->activators)
+    /* We must be careful because the callbacks might add or erase bindings,
+     * so copy them before calling any. */
+    auto callbacks = std::move(priv->button_dispatch);
+    callbacks.bindings.assign(found.bindings.begin(), found.bindings.end());
+    callbacks.activators.assign(found.activators.begin(), found.activators.end());
+
+    bool binding_handled = false;
+    for (auto callback : callbacks.bindings)
     {
-        if (binding->activated_by->get_value().has_match(pressed))
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
-            {
-                wf::activator_data_t data = {
-                    .source = activator_source_t::BUTTONBINDING,
-                    .activation_data = pressed.get_button(),
-                };
-                return (*callback)(data);
-            });
-        }
+        binding_handled |= (*callback)(pressed);
     }
 
-    bool binding_handled = false;
-    for (auto call : callbacks)
+    for (auto callback : callbacks.activators)
     {
-        binding_handled |= call();
+        wf::activator_data_t data = {
+            .source = activator_source_t::BUTTONBINDING,
+            .activation_data = pressed.get_button(),
+        };
+        binding_handled |= (*callback)(data);
     }
 
+    priv->button_dispatch = std::move(callbacks);
     return binding_handled;
 }
 
@@ -242,12 +268,18 @@ bool wf::bindings_repository_t::handle_extension_generic(
 
 void wf::bindings_repository_t::rem_binding(void *callback)
 {
-    const auto& erase = [callback] (auto& container)
+    const auto& erase = [callback, this] (auto& container)
     {
         auto it = std::remove_if(container.begin(), container.end(),
-            [callback] (const auto& ptr)
+            [callback, this] (const auto& ptr)
         {
-            return ptr->callback == callback;
+            if (ptr->callback == callback)
+            {
+                priv->unwatch_option(ptr->activated_by.get());
+                return true;
+            }
+
+            return false;
         });
         container.erase(it, container.end());
     };
@@ -262,6 +294,7 @@ void wf::bindings_repository_t::rem_binding(void *callback)
     erase(priv->buttons);
     erase(priv->axes);
     erase(priv->activators);
+    priv->invalidate_matches();
 
     if (update_hotspots)
     {
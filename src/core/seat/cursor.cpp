@@ -4,6 +4,7 @@
 #include "../../view/view-impl.hpp"
 #include "input-manager.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/output.hpp"
 #include "wayfire/output-layout.hpp"
 #include "tablet.hpp"
 #include "wayfire/signal-definitions.hpp"
@@ -20,13 +21,22 @@ wf::cursor_t::cursor_t(wf::seat_t *seat)
     wlr_cursor_warp(cursor, NULL, cursor->x, cursor->y);
     init_xcursor();
 
-    config_reloaded = [=] (auto)
+    config_reloaded = [=] (wf::reload_config_signal *ev)
     {
-        init_xcursor();
+        if (ev->section_changed("input"))
+        {
+            init_xcursor();
+        }
     };
 
     wf::get_core().connect(&config_reloaded);
 
+    on_layout_changed = [=] (auto)
+    {
+        preload_xcursor_scales();
+    };
+    wf::get_core().output_layout->connect(&on_layout_changed);
+
     request_set_cursor.set_callback([&] (void *data)
     {
         auto ev = static_cast<wlr_seat_pointer_request_set_cursor_event*>(data);
@@ -110,6 +120,16 @@ void wf::cursor_t::init_xcursor()
     int size = wf::option_wrapper_t<int>("input/cursor_size");
     auto theme_ptr = (theme == "default") ? NULL : theme.c_str();
 
+    // The input section changes for many unrelated options. Recreating the manager would load all cursor
+    // images again and upload the current one anew.
+    if (xcursor && (theme == xcursor_theme) && (size == xcursor_size))
+    {
+        return;
+    }
+
+    xcursor_theme = theme;
+    xcursor_size  = size;
+
     // Set environment variables needed for Xwayland and maybe other apps
     // which use them to determine the correct cursor size
     setenv("XCURSOR_SIZE", std::to_string(size).c_str(), 1);
@@ -124,9 +144,23 @@ void wf::cursor_t::init_xcursor()
     }
 
     xcursor = wlr_xcursor_manager_create(theme_ptr, size);
+    preload_xcursor_scales();
+    current_xcursor.clear();
     set_cursor("default");
 }
 
+void wf::cursor_t::preload_xcursor_scales()
+{
+    for (auto& wo : wf::get_core().output_layout->get_outputs())
+    {
+        // Scales which are already loaded are skipped by wlroots.
+        if (!wlr_xcursor_manager_load(xcursor, wo->handle->scale))
+        {
+            LOGE("Failed to load cursor theme \"", xcursor_theme, "\" for scale ", wo->handle->scale);
+        }
+    }
+}
+
 void wf::cursor_t::set_cursor(std::string name)
 {
     if (this->hide_ref_counter)
@@ -146,6 +180,14 @@ void wf::cursor_t::set_cursor(std::string name)
 
     idle_set_cursor.run_once([name, this] ()
     {
+        // Plugins and core set the cursor repeatedly, for example on each motion over a decoration.
+        // Uploading the same image again would damage the output or update the cursor plane for nothing.
+        if (name == current_xcursor)
+        {
+            return;
+        }
+
+        current_xcursor = name;
         wlr_cursor_set_xcursor(cursor, xcursor, name.c_str());
     });
 }
@@ -163,6 +205,7 @@ void wf::cursor_t::unhide_cursor()
 void wf::cursor_t::hide_cursor()
 {
     idle_set_cursor.disconnect();
+    current_xcursor.clear();
     wlr_cursor_set_surface(cursor, NULL, 0, 0);
     this->hide_ref_counter++;
 }
@@ -199,6 +242,7 @@ void wf::cursor_t::set_cursor(
         }
     }
 
+    current_xcursor.clear();
     wlr_cursor_set_surface(cursor, ev->surface, ev->hotspot_x, ev->hotspot_y);
 }
 
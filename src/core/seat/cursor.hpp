@@ -37,6 +37,9 @@ struct cursor_t
      */
     wf::wl_idle_call idle_set_cursor;
 
+    /** The name of the xcursor image which is currently set, or empty if a client surface is used. */
+    std::string current_xcursor;
+
     /**
      * Start/stop touchscreen mode, which means the cursor will be hidden.
      * It will be shown again once a pointer or tablet event happens.
@@ -50,6 +53,17 @@ struct cursor_t
     void init_xcursor();
     void setup_listeners();
 
+    /**
+     * Load the cursor theme for the scales of all outputs, so that it is not read from disk on the first
+     * cursor change on an output with a new scale.
+     */
+    void preload_xcursor_scales();
+    wf::signal::connection_t<wf::output_layout_configuration_changed_signal> on_layout_changed;
+
+    /** The theme and size the xcursor manager was created with. */
+    std::string xcursor_theme;
+    int xcursor_size = 0;
+
     // Device event listeners
     wf::wl_listener_wrapper on_button, on_motion, on_motion_absolute, on_axis,
 
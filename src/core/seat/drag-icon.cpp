@@ -210,11 +210,18 @@ wf::point_t wf::drag_icon_t::get_position()
 
 void wf::drag_icon_t::update_position()
 {
+    auto new_box =
+        wf::construct_box(get_position(), {icon->surface->current.width, icon->surface->current.height});
+    if (new_box == last_box)
+    {
+        // Sub-pixel motion, nothing to repaint.
+        return;
+    }
+
     // damage previous position
     wf::region_t dmg_region;
     dmg_region |= last_box;
-    last_box    =
-        wf::construct_box(get_position(), {icon->surface->current.width, icon->surface->current.height});
+    last_box    = new_box;
     dmg_region |= last_box;
     scene::damage_node(root_node, dmg_region);
 }
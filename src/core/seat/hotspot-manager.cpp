@@ -2,26 +2,32 @@
 #include "wayfire/core.hpp"
 #include <wayfire/output-layout.hpp>
 #include <wayfire/touch/touch.hpp>
+#include <algorithm>
+#include <climits>
 
-void wf::hotspot_instance_t::process_input_motion(wf::pointf_t gc)
+void wf::hotspot_instance_t::reset()
 {
-    const auto& reset_hotspot = [&] ()
-    {
-        timer.disconnect();
-        this->armed = true;
-    };
+    timer.disconnect();
+    this->armed = true;
+}
+
+void wf::hotspot_instance_t::invalidate_geometry()
+{
+    last_output = nullptr;
+}
 
-    auto target = wf::get_core().output_layout->get_output_coords_at(gc, gc);
+void wf::hotspot_instance_t::process_input_motion(wf::pointf_t gc, wf::output_t *target)
+{
     if (target != last_output)
     {
-        reset_hotspot();
+        reset();
         last_output = target;
-        recalc_geometry();
+        get_geometry(target, hotspot_geometry);
     }
 
     if (!(hotspot_geometry[0] & gc) && !(hotspot_geometry[1] & gc))
     {
-        reset_hotspot();
+        reset();
         return;
     }
 
@@ -36,15 +42,8 @@ void wf::hotspot_instance_t::process_input_motion(wf::pointf_t gc)
     }
 }
 
-wf::geometry_t wf::hotspot_instance_t::pin(wf::dimensions_t dim) noexcept
+wf::geometry_t wf::hotspot_instance_t::pin(wf::geometry_t og, wf::dimensions_t dim) const noexcept
 {
-    if (!last_output)
-    {
-        return {0, 0, 0, 0};
-    }
-
-    auto og = last_output->get_layout_geometry();
-
     wf::geometry_t result;
     result.width  = dim.width;
     result.height = dim.height;
@@ -75,14 +74,21 @@ wf::geometry_t wf::hotspot_instance_t::pin(wf::dimensions_t dim) noexcept
     return wf::clamp(result, og);
 }
 
-void wf::hotspot_instance_t::recalc_geometry() noexcept
+void wf::hotspot_instance_t::get_geometry(wf::output_t *output, wf::geometry_t result[2]) const noexcept
 {
+    if (!output)
+    {
+        result[0] = result[1] = {0, 0, 0, 0};
+        return;
+    }
+
+    auto og = output->get_layout_geometry();
     uint32_t cnt_edges = __builtin_popcount(edges);
 
     if (cnt_edges == 2)
     {
-        hotspot_geometry[0] = pin({away, along});
-        hotspot_geometry[1] = pin({along, away});
+        result[0] = pin(og, {away, along});
+        result[1] = pin(og, {along, away});
     } else
     {
         wf::dimensions_t dim;
@@ -94,27 +100,23 @@ void wf::hotspot_instance_t::recalc_geometry() noexcept
             dim = {along, away};
         }
 
-        hotspot_geometry[0] = pin(dim);
-        hotspot_geometry[1] = hotspot_geometry[0];
+        result[0] = pin(og, dim);
+        result[1] = result[0];
     }
 }
 
 wf::hotspot_instance_t::hotspot_instance_t(uint32_t edges, uint32_t along, uint32_t away, int32_t timeout,
     std::function<void(uint32_t)> callback)
 {
-    wf::get_core().connect(&on_motion_event);
-    wf::get_core().connect(&on_motion_event);
-    wf::get_core().connect(&on_touch_motion);
-
     this->edges = edges;
     this->along = along;
     this->away  = away;
     this->timeout_ms = timeout;
     this->callback   = callback;
+}
 
-    recalc_geometry();
-
-    // callbacks
+wf::hotspot_manager_t::hotspot_manager_t()
+{
     on_tablet_axis = [=] (wf::post_input_event_signal<wlr_tablet_tool_axis_event> *ev)
     {
         process_input_motion(wf::get_core().get_cursor_position());
@@ -133,11 +135,125 @@ wf::hotspot_instance_t::hotspot_instance_t(uint32_t edges, uint32_t along, uint3
             process_input_motion(wf::get_core().get_touch_position(0));
         }
     };
+
+    on_layout_changed = [=] (wf::output_layout_configuration_changed_signal *ev)
+    {
+        invalidate_geometry();
+    };
+
+    on_output_removed = [=] (wf::output_removed_signal *ev)
+    {
+        invalidate_geometry();
+    };
+}
+
+void wf::hotspot_manager_t::invalidate_geometry()
+{
+    inner_area.clear();
+    last_output = nullptr;
+    for (auto& hs : hotspots)
+    {
+        hs->invalidate_geometry();
+    }
+}
+
+wf::geometry_t wf::hotspot_manager_t::get_inner_area(wf::output_t *output)
+{
+    auto it = inner_area.find(output);
+    if (it != inner_area.end())
+    {
+        return it->second;
+    }
+
+    // All hotspots are at the edges of the output, so the inner area can be found by moving each side of
+    // the output inwards until it is past all hotspot rectangles which touch it.
+    const auto og = output->get_layout_geometry();
+    int left = og.x, top = og.y, right = og.x + og.width, bottom = og.y + og.height;
+    bool valid = true;
+    for (auto& hs : hotspots)
+    {
+        wf::geometry_t rects[2];
+        hs->get_geometry(output, rects);
+        for (auto& r : rects)
+        {
+            if ((r.width <= 0) || (r.height <= 0))
+            {
+                continue;
+            }
+
+            // How far each side has to move to exclude the rectangle, if the rectangle touches that side
+            const int from_left   = (r.x <= og.x) ? r.x + r.width - og.x : INT_MAX;
+            const int from_right  = (r.x + r.width >= og.x + og.width) ? og.x + og.width - r.x : INT_MAX;
+            const int from_top    = (r.y <= og.y) ? r.y + r.height - og.y : INT_MAX;
+            const int from_bottom = (r.y + r.height >= og.y + og.height) ? og.y + og.height - r.y : INT_MAX;
+            const int min_shift   = std::min({from_left, from_right, from_top, from_bottom});
+            if (min_shift == INT_MAX)
+            {
+                valid = false;
+            } else if (min_shift == from_left)
+            {
+                left = std::max(left, og.x + from_left);
+            } else if (min_shift == from_right)
+            {
+                right = std::min(right, og.x + og.width - from_right);
+            } else if (min_shift == from_top)
+            {
+                top = std::max(top, og.y + from_top);
+            } else
+            {
+                bottom = std::min(bottom, og.y + og.height - from_bottom);
+            }
+        }
+    }
+
+    wf::geometry_t inner = {0, 0, 0, 0};
+    if (valid && (right > left) && (bottom > top))
+    {
+        inner = {left, top, right - left, bottom - top};
+    }
+
+    inner_area[output] = inner;
+    return inner;
+}
+
+void wf::hotspot_manager_t::process_input_motion(wf::pointf_t gc)
+{
+    if (!last_output || !(last_output->get_layout_geometry() & gc))
+    {
+        last_output = wf::get_core().output_layout->get_output_coords_at(gc, gc);
+        if (!last_output)
+        {
+            return;
+        }
+    }
+
+    if (get_inner_area(last_output) & gc)
+    {
+        if (near_edge)
+        {
+            near_edge = false;
+            for (auto& hs : hotspots)
+            {
+                hs->reset();
+            }
+        }
+
+        return;
+    }
+
+    near_edge = true;
+    for (auto& hs : hotspots)
+    {
+        hs->process_input_motion(gc, last_output);
+    }
 }
 
 void wf::hotspot_manager_t::update_hotspots(const container_t& activators)
 {
     hotspots.clear();
+    inner_area.clear();
+    last_output = nullptr;
+    near_edge   = false;
     for (const auto& opt : activators)
     {
         auto opt_hotspots = opt->activated_by->get_value().get_hotspots();
@@ -158,4 +274,20 @@ void wf::hotspot_manager_t::update_hotspots(const container_t& activators)
             hotspots.push_back(std::move(instance));
         }
     }
+
+    if (hotspots.empty())
+    {
+        on_tablet_axis.disconnect();
+        on_motion_event.disconnect();
+        on_touch_motion.disconnect();
+        on_layout_changed.disconnect();
+        on_output_removed.disconnect();
+    } else if (!on_motion_event.is_connected())
+    {
+        wf::get_core().connect(&on_tablet_axis);
+        wf::get_core().connect(&on_motion_event);
+        wf::get_core().connect(&on_touch_motion);
+        wf::get_core().output_layout->connect(&on_layout_changed);
+        wf::get_core().output_layout->connect(&on_output_removed);
+    }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "wayfire/util.hpp"
+#include <map>
 #include <wayfire/config/types.hpp>
 #include <wayfire/output.hpp>
 #include <wayfire/util/log.hpp>
@@ -33,6 +34,18 @@ class hotspot_instance_t
     hotspot_instance_t(uint32_t edges, uint32_t along, uint32_t away, int32_t timeout,
         std::function<void(uint32_t)> callback);
 
+    /** Update state based on input motion at @gc, which is on @output. */
+    void process_input_motion(wf::pointf_t gc, wf::output_t *output);
+
+    /** Cancel a pending activation and allow the hotspot to be triggered again. */
+    void reset();
+
+    /** Forget the cached geometry, for example because the output layout changed. */
+    void invalidate_geometry();
+
+    /** Get the rectangles of the hotspot on the given output. */
+    void get_geometry(wf::output_t *output, wf::geometry_t result[2]) const noexcept;
+
   private:
     /** The possible hotspot rectangles */
     wf::geometry_t hotspot_geometry[2];
@@ -59,34 +72,42 @@ class hotspot_instance_t
     /** Callback to execute */
     std::function<void(uint32_t)> callback;
 
-    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_axis_event>> on_tablet_axis;
-    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion_event;
-    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_motion_event>> on_touch_motion;
-
-    /** Update state based on input motion */
-    void process_input_motion(wf::pointf_t gc);
-
     /** Calculate a rectangle with size @dim inside @og at the correct edges. */
-    wf::geometry_t pin(wf::dimensions_t dim) noexcept;
-
-    /** Recalculate the hotspot geometries. */
-    void recalc_geometry() noexcept;
+    wf::geometry_t pin(wf::geometry_t og, wf::dimensions_t dim) const noexcept;
 };
 
 /**
  * Manages hotspot bindings on the given output.
  * A part of the bindings_repository_t.
+ *
+ * The manager handles the input motion for all hotspots. For each output, it keeps the inner rectangle
+ * which does not intersect any hotspot, so that motion away from the edges costs a single bounds check.
  */
 class hotspot_manager_t
 {
   public:
-    hotspot_manager_t()
-    {}
+    hotspot_manager_t();
 
     using container_t = binding_container_t<activatorbinding_t, activator_callback>;
     void update_hotspots(const container_t& activators);
 
   private:
     std::vector<std::unique_ptr<hotspot_instance_t>> hotspots;
+
+    /** The part of each output which is outside of all hotspots. */
+    std::map<wf::output_t*, wf::geometry_t> inner_area;
+    wf::output_t *last_output = nullptr;
+    /** Whether the last motion was near an edge, so that the hotspots may have a pending activation. */
+    bool near_edge = false;
+
+    wf::geometry_t get_inner_area(wf::output_t *output);
+    void process_input_motion(wf::pointf_t gc);
+    void invalidate_geometry();
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_axis_event>> on_tablet_axis;
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion_event;
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_touch_motion_event>> on_touch_motion;
+    wf::signal::connection_t<wf::output_layout_configuration_changed_signal> on_layout_changed;
+    wf::signal::connection_t<wf::output_removed_signal> on_output_removed;
 };
 }
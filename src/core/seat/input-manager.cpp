@@ -3,6 +3,7 @@
 #include "pointer.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/signal-definitions.hpp"
+#include "wayfire/scene.hpp"
 #include "../core-impl.hpp"
 #include "../../output/output-impl.hpp"
 #include "touch.hpp"
@@ -153,8 +154,17 @@ wf::input_manager_t::input_manager_t()
     });
     input_device_created.connect(&wf::get_core().backend->events.new_input);
 
-    config_updated = [=] (auto)
+    config_updated = [=] (wf::reload_config_signal *ev)
     {
+        // Devices read the input section and their own input-device sections.
+        bool input_changed = ev->section_changed("input") ||
+            std::any_of(ev->changed_sections.begin(), ev->changed_sections.end(),
+                [] (const std::string& section) { return section.rfind("input-device", 0) == 0; });
+        if (!input_changed)
+        {
+            return;
+        }
+
         for (auto& dev : input_devices)
         {
             dev->update_options();
@@ -178,6 +188,7 @@ wf::input_manager_t::input_manager_t()
 void wf::input_manager_t::set_exclusive_focus(wl_client *client)
 {
     exclusive_client = client;
+    wf::scene::invalidate_keyboard_refocus();
     for (auto& wo : wf::get_core().output_layout->get_outputs())
     {
         wo->set_inhibited(client != nullptr);
@@ -142,8 +142,6 @@ void wf::text_input_v3_popup::update_geometry()
         return;
     }
 
-    damage();
-
     wf::pointf_t popup_offset = wf::place_popup_at(wlr_surface, surface, {x* 1.0, y * 1.0});
     x = popup_offset.x;
     y = popup_offset.y;
@@ -169,11 +167,17 @@ void wf::text_input_v3_popup::update_geometry()
     // make sure top edge is on screen, sliding down and sacrificing down edge if unavoidable
     y = std::max(0, y);
 
+    // The popup surface commits and the text input sends its cursor rectangle on every key, usually without
+    // moving the popup. Contents changes are damaged by the surface node itself.
+    const wf::geometry_t new_geometry = {x, y, width, height};
+    if (new_geometry == geometry)
+    {
+        return;
+    }
+
+    damage();
     surface_root_node->set_offset({x, y});
-    geometry.x     = x;
-    geometry.y     = y;
-    geometry.width = width;
-    geometry.height = height;
+    geometry = new_geometry;
     damage();
     wf::scene::update(get_surface_root_node(), wf::scene::update_flag::GEOMETRY);
 }
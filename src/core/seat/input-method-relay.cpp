@@ -220,6 +220,7 @@ void wf::input_method_relay::disable_text_input(wlr_text_input_v3 *input)
     }
 
     wlr_input_method_v2_send_deactivate(input_method);
+    focused_input->sent_state.reset();
     send_im_state(input);
 }
 
@@ -389,6 +390,7 @@ wf::text_input::text_input(wf::input_method_relay *rel, wlr_text_input_v3 *in) :
         }
 
         wlr_input_method_v2_send_activate(relay->input_method);
+        update_sent_state();
         relay->send_im_state(input);
     });
 
@@ -397,25 +399,9 @@ wf::text_input::text_input(wf::input_method_relay *rel, wlr_text_input_v3 *in) :
         auto wlr_text_input = static_cast<wlr_text_input_v3*>(data);
         assert(input == wlr_text_input);
 
-        if (!input->current_enabled)
-        {
-            LOGI("Inactive text input tried to commit");
-
-            return;
-        }
-
-        if (relay->input_method == nullptr)
-        {
-            LOGI("Committing text input, but input method is gone");
-
-            return;
-        }
-
-        relay->send_im_state(input);
-
-        wf::text_input_commit_signal sigdata;
-        sigdata.cursor_rect = input->current.cursor_rectangle;
-        relay->emit(&sigdata);
+        // Clients may commit several times while handling one batch of events (e.g. the cursor rectangle
+        // and the surrounding text separately), only the last state is relayed.
+        idle_commit.run_once([=] () { handle_commit(); });
     });
 
     on_text_input_disable.set_callback([&] (void *data)
@@ -437,6 +423,7 @@ wf::text_input::text_input(wf::input_method_relay *rel, wlr_text_input_v3 *in) :
         }
 
         set_pending_focused_surface(nullptr);
+        idle_commit.disconnect();
         on_text_input_enable.disconnect();
         on_text_input_commit.disconnect();
         on_text_input_disable.disconnect();
@@ -473,6 +460,52 @@ void wf::text_input::set_pending_focused_surface(wlr_surface *surface)
     }
 }
 
+void wf::text_input::handle_commit()
+{
+    if (!input->current_enabled)
+    {
+        LOGI("Inactive text input tried to commit");
+
+        return;
+    }
+
+    if (relay->input_method == nullptr)
+    {
+        LOGI("Committing text input, but input method is gone");
+
+        return;
+    }
+
+    // Commits which only move the cursor rectangle do not need a new state for the input method.
+    if (update_sent_state())
+    {
+        relay->send_im_state(input);
+    }
+
+    wf::text_input_commit_signal sigdata;
+    sigdata.cursor_rect = input->current.cursor_rectangle;
+    relay->emit(&sigdata);
+}
+
+bool wf::text_input::update_sent_state()
+{
+    const auto& current = input->current;
+    sent_state_t state;
+    state.surrounding = current.surrounding.text ? current.surrounding.text : "";
+    state.cursor  = current.surrounding.cursor;
+    state.anchor  = current.surrounding.anchor;
+    state.cause   = current.text_change_cause;
+    state.hint    = current.content_type.hint;
+    state.purpose = current.content_type.purpose;
+    if (sent_state == state)
+    {
+        return false;
+    }
+
+    sent_state = std::move(state);
+    return true;
+}
+
 wf::text_input::~text_input()
 {}
 
@@ -7,6 +7,8 @@
 
 #include <vector>
 #include <memory>
+#include <optional>
+#include <string>
 
 namespace wf
 {
@@ -72,8 +74,33 @@ struct text_input
         on_text_input_enable, on_text_input_commit,
         on_text_input_disable, on_text_input_destroy;
 
+    /* The state of the text input which was last sent to the input method */
+    struct sent_state_t
+    {
+        std::string surrounding;
+        uint32_t cursor  = 0;
+        uint32_t anchor  = 0;
+        uint32_t cause   = 0;
+        uint32_t hint    = 0;
+        uint32_t purpose = 0;
+
+        bool operator ==(const sent_state_t& other) const
+        {
+            return surrounding == other.surrounding && cursor == other.cursor && anchor == other.anchor &&
+                   cause == other.cause && hint == other.hint && purpose == other.purpose;
+        }
+    };
+
+    std::optional<sent_state_t> sent_state;
+    wf::wl_idle_call idle_commit;
+
     text_input(input_method_relay*, wlr_text_input_v3*);
     void set_pending_focused_surface(wlr_surface*);
     ~text_input();
+
+    /** Relay the last committed state of the text input to the input method and the popups. */
+    void handle_commit();
+    /** Remember the current state as sent. @return Whether it differs from the state sent last. */
+    bool update_sent_state();
 };
 }
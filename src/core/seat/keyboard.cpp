@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <string>
+#include <vector>
 #include <wayfire/bindings-repository.hpp>
 #include <linux/input-event-codes.h>
 #include <wayland-server-protocol.h>
@@ -160,6 +164,85 @@ static void set_locked_mod(xkb_mod_mask_t *mods, xkb_keymap *keymap, const char
     }
 }
 
+namespace
+{
+/**
+ * Compiled keymaps, shared by all keyboards. Compiling a keymap from RMLVO names takes tens of milliseconds,
+ * and docking stations expose several keyboard devices which all use the same configuration.
+ *
+ * Only a few of the most recently used keymaps are kept, older ones are left from previous configurations.
+ */
+class keymap_cache_t
+{
+  public:
+    static keymap_cache_t& get()
+    {
+        static keymap_cache_t cache;
+        return cache;
+    }
+
+    /**
+     * @return A new reference to the keymap for the given names, or nullptr if it cannot be compiled.
+     */
+    xkb_keymap *get_keymap(const xkb_rule_names& names)
+    {
+        key_t key = {or_empty(names.rules), or_empty(names.model), or_empty(names.layout),
+            or_empty(names.variant), or_empty(names.options)};
+
+        auto it = std::find_if(entries.begin(), entries.end(), [&] (const auto& entry)
+        {
+            return entry.first == key;
+        });
+
+        if (it != entries.end())
+        {
+            // Move to the back, so that the least recently used keymap is at the front.
+            std::rotate(it, it + 1, entries.end());
+        } else
+        {
+            auto keymap = xkb_keymap_new_from_names(ctx, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+            if (!keymap)
+            {
+                return nullptr;
+            }
+
+            if (entries.size() >= MAX_ENTRIES)
+            {
+                xkb_keymap_unref(entries.front().second);
+                entries.erase(entries.begin());
+            }
+
+            entries.emplace_back(key, keymap);
+        }
+
+        return xkb_keymap_ref(entries.back().second);
+    }
+
+    ~keymap_cache_t()
+    {
+        for (auto& [key, keymap] : entries)
+        {
+            xkb_keymap_unref(keymap);
+        }
+
+        xkb_context_unref(ctx);
+    }
+
+  private:
+    static constexpr size_t MAX_ENTRIES = 4;
+    using key_t = std::array<std::string, 5>;
+
+    // Kept for the whole lifetime of the process, creating it loads the include paths every time.
+    xkb_context *ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    std::vector<std::pair<key_t, xkb_keymap*>> entries;
+
+    static const char *or_empty(const char *str)
+    {
+        return str ? str : "";
+    }
+};
+}
+
 void wf::keyboard_t::reload_input_options()
 {
     if (!this->dirty_options)
@@ -169,8 +252,6 @@ void wf::keyboard_t::reload_input_options()
 
     this->dirty_options = false;
 
-    auto ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-
     /* Copy memory to stack, so that .c_str() is valid */
     std::string rules   = this->rules;
     std::string model   = this->model;
@@ -184,8 +265,7 @@ void wf::keyboard_t::reload_input_options()
     names.layout  = layout.c_str();
     names.variant = variant.c_str();
     names.options = options.c_str();
-    auto keymap = xkb_map_new_from_names(ctx, &names,
-        XKB_KEYMAP_COMPILE_NO_FLAGS);
+    auto keymap = keymap_cache_t::get().get_keymap(names);
 
     if (!keymap)
     {
@@ -195,7 +275,7 @@ void wf::keyboard_t::reload_input_options()
 
         // reset to NULL
         std::memset(&names, 0, sizeof(names));
-        keymap = xkb_map_new_from_names(ctx, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+        keymap = keymap_cache_t::get().get_keymap(names);
     }
 
     xkb_mod_mask_t locked_mods = 0;
@@ -212,7 +292,6 @@ void wf::keyboard_t::reload_input_options()
 
     wlr_keyboard_set_keymap(handle, keymap);
     xkb_keymap_unref(keymap);
-    xkb_context_unref(ctx);
 
     wlr_keyboard_set_repeat_info(handle, repeat_rate, repeat_delay);
 
@@ -10,6 +10,7 @@
 #include <wayfire/util/log.hpp>
 #include <wayfire/core.hpp>
 #include <wayfire/output-layout.hpp>
+#include <algorithm>
 
 wf::pointer_t::pointer_t(nonstd::observer_ptr<wf::input_manager_t> input,
     nonstd::observer_ptr<seat_t> seat)
@@ -70,6 +71,11 @@ bool wf::pointer_t::focus_enabled() const
 
 void wf::pointer_t::update_cursor_position(int64_t time_msec)
 {
+    coalesce_timer.disconnect();
+    idle_flush_motion.disconnect();
+    pending_motion_time  = -1;
+    last_position_update = wf::get_current_time();
+
     wf::pointf_t gc = seat->priv->cursor->get_cursor_position();
 
     /* If we have a grabbed surface, but no drag, we want to continue sending
@@ -87,6 +93,84 @@ void wf::pointer_t::update_cursor_position(int64_t time_msec)
     seat->priv->update_drag_icon();
 }
 
+bool wf::pointer_t::should_coalesce_motion() const
+{
+    return (motion_coalesce_rate > 0) && can_coalesce_motion();
+}
+
+bool wf::pointer_t::can_coalesce_motion() const
+{
+    // Drags and drawing applications need every motion event, and clients with constrained pointers expect
+    // the pointer position to follow the constraint exactly.
+    if (count_pressed_buttons > 0)
+    {
+        return false;
+    }
+
+    return wl_list_empty(&wf::get_core().protocols.pointer_constraints->constraints);
+}
+
+void wf::pointer_t::coalesce_cursor_position_update(int64_t time_msec)
+{
+    const int64_t interval = std::max(1, 1000 / motion_coalesce_rate);
+    const int64_t elapsed  = wf::get_current_time() - last_position_update;
+    if ((elapsed >= interval) || (elapsed < 0))
+    {
+        // First event after a pause: handle it right away, so that coalescing adds no latency.
+        update_cursor_position(time_msec);
+        return;
+    }
+
+    pending_motion_time = time_msec;
+    if (!coalesce_timer.is_connected())
+    {
+        coalesce_timer.set_timeout(interval - elapsed, [=] ()
+        {
+            update_cursor_position(pending_motion_time);
+        });
+    }
+}
+
+bool wf::pointer_t::is_queued_motion(uint32_t time_msec) const
+{
+    // Events older than this were not dispatched as soon as they arrived.
+    static constexpr uint32_t QUEUED_MOTION_LAG_MS = 8;
+    if (!coalesce_queued_motion || !can_coalesce_motion())
+    {
+        return false;
+    }
+
+    // Event times are truncated to 32 bits, and times from a different clock have implausible lags.
+    const uint32_t lag = (uint32_t)wf::get_current_time() - time_msec;
+    return (lag > QUEUED_MOTION_LAG_MS) && (lag < 1000);
+}
+
+void wf::pointer_t::handle_motion_update(uint32_t time_msec)
+{
+    if (is_queued_motion(time_msec))
+    {
+        pending_motion_time = time_msec;
+        idle_flush_motion.run_once([=] ()
+        {
+            flush_pending_motion();
+        });
+    } else if (should_coalesce_motion())
+    {
+        coalesce_cursor_position_update(time_msec);
+    } else
+    {
+        update_cursor_position(time_msec);
+    }
+}
+
+void wf::pointer_t::flush_pending_motion()
+{
+    if (pending_motion_time >= 0)
+    {
+        update_cursor_position(pending_motion_time);
+    }
+}
+
 void wf::pointer_t::send_leave_to_focus(wf::scene::node_ptr old_focus)
 {
     if (old_focus)
@@ -212,6 +296,7 @@ void wf::pointer_t::handle_pointer_button(wlr_pointer_button_event *ev,
 {
     seat->priv->break_mod_bindings();
     bool handled_in_binding = (mode != input_event_processing_mode_t::FULL);
+    flush_pending_motion();
 
     if (ev->state == WL_POINTER_BUTTON_STATE_PRESSED)
     {
@@ -317,7 +402,7 @@ void wf::pointer_t::handle_pointer_motion(wlr_pointer_motion_event *ev,
 {
     /* XXX: maybe warp directly? */
     wlr_cursor_move(seat->priv->cursor->cursor, &ev->pointer->base, ev->delta_x, ev->delta_y);
-    update_cursor_position(ev->time_msec);
+    handle_motion_update(ev->time_msec);
 }
 
 void wf::pointer_t::handle_pointer_motion_absolute(
@@ -337,12 +422,13 @@ void wf::pointer_t::handle_pointer_motion_absolute(
 
     // TODO: indirection via wf_cursor
     wlr_cursor_warp_closest(seat->priv->cursor->cursor, NULL, cx, cy);
-    update_cursor_position(ev->time_msec);
+    handle_motion_update(ev->time_msec);
 }
 
 void wf::pointer_t::handle_pointer_axis(wlr_pointer_axis_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_pending_motion();
     bool handled_in_binding = wf::get_core().bindings->handle_axis(
         seat->priv->get_modifiers(), ev);
     seat->priv->break_mod_bindings();
@@ -371,6 +457,7 @@ void wf::pointer_t::handle_pointer_axis(wlr_pointer_axis_event *ev,
 void wf::pointer_t::handle_pointer_swipe_begin(wlr_pointer_swipe_begin_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_pending_motion();
     wlr_pointer_gestures_v1_send_swipe_begin(
         wf::get_core().protocols.pointer_gestures, seat->seat,
         ev->time_msec, ev->fingers);
@@ -395,6 +482,7 @@ void wf::pointer_t::handle_pointer_swipe_end(wlr_pointer_swipe_end_event *ev,
 void wf::pointer_t::handle_pointer_pinch_begin(wlr_pointer_pinch_begin_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_pending_motion();
     wlr_pointer_gestures_v1_send_pinch_begin(
         wf::get_core().protocols.pointer_gestures, seat->seat,
         ev->time_msec, ev->fingers);
@@ -419,6 +507,7 @@ void wf::pointer_t::handle_pointer_pinch_end(wlr_pointer_pinch_end_event *ev,
 void wf::pointer_t::handle_pointer_hold_begin(wlr_pointer_hold_begin_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_pending_motion();
     wlr_pointer_gestures_v1_send_hold_begin(
         wf::get_core().protocols.pointer_gestures, seat->seat,
         ev->time_msec, ev->fingers);
@@ -82,6 +82,12 @@ class pointer_t
      */
     void update_cursor_position(int64_t time_msec);
 
+    /**
+     * Run a cursor position update which was postponed because of motion
+     * coalescing, if there is one. No-op otherwise.
+     */
+    void flush_pending_motion();
+
     /**
      * Transfer focus and pressed buttons to the given grab.
      */
@@ -96,6 +102,24 @@ class pointer_t
     // actual movement of the mouse.
     std::optional<wf::pointf_t> last_focus_coords;
 
+    // Pointer motion coalescing: when enabled, the cursor image still moves with every event, but focus and
+    // motion events to clients are updated at most input/pointer_motion_coalesce_rate times per second.
+    wf::cached_option_t<int> motion_coalesce_rate{"input/pointer_motion_coalesce_rate"};
+    wf::wl_timer<false> coalesce_timer;
+    int64_t last_position_update = 0;
+    int64_t pending_motion_time  = -1;
+    bool should_coalesce_motion() const;
+    void coalesce_cursor_position_update(int64_t time_msec);
+
+    // Motion which waited in the queue, for example while a long frame blocked the event loop, arrives in a
+    // burst. With input/coalesce_queued_motion, only the last position of the burst is processed, once the
+    // event loop has dispatched all queued events.
+    wf::cached_option_t<bool> coalesce_queued_motion{"input/coalesce_queued_motion"};
+    wf::wl_idle_call idle_flush_motion;
+    bool can_coalesce_motion() const;
+    bool is_queued_motion(uint32_t time_msec) const;
+    void handle_motion_update(uint32_t time_msec);
+
     // Buttons sent to the client currently
     // Note that count_pressed_buttons also contains buttons not sent to the
     // client
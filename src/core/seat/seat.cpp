@@ -33,6 +33,7 @@ void wf::seat_t::set_active_node(wf::scene::node_ptr node, wf::keyboard_focus_re
         clock_gettime(CLOCK_MONOTONIC, &ts);
         priv->last_timestamp = ts.tv_sec * 1'000'000'000ll + ts.tv_nsec;
         node->keyboard_interaction().last_focus_timestamp = priv->last_timestamp;
+        wf::scene::invalidate_keyboard_refocus();
     }
 
     auto focus = wf::get_core().scene()->keyboard_refocus(priv->active_output);
@@ -522,6 +523,8 @@ void wf::seat_t::impl::set_keyboard_focus(wf::scene::node_ptr new_focus, keyboar
     }
 
     this->keyboard_focus = new_focus;
+    // Layer-shell and unmanaged Xwayland surfaces keep the focus only while they have it.
+    wf::scene::invalidate_keyboard_refocus();
     if (new_focus)
     {
         new_focus->keyboard_interaction().handle_keyboard_enter(wf::get_core().seat.get());
@@ -137,7 +137,13 @@ void wf::tablet_tool_t::update_tool_position(bool real_update)
         }
     }
 
-    bool focus_changed = set_focus(focus_node);
+    // While the tool is in contact, the grabbed node stays focused, so there is nothing to update.
+    bool focus_changed = false;
+    if (focus_node != hovered_node)
+    {
+        hovered_node  = focus_node;
+        focus_changed = set_focus(focus_node);
+    }
 
     /* If focus is a wlr surface, send position */
     wlr_surface *next_focus = wlr_surface_from_node(focus_node);
@@ -183,10 +189,53 @@ bool wf::tablet_tool_t::set_focus(wf::scene::node_ptr surface)
 void wf::tablet_tool_t::reset_grab()
 {
     this->grabbed_node = nullptr;
+    this->hovered_node = nullptr;
+}
+
+void wf::tablet_tool_t::queue_axis(wlr_tablet_tool_axis_event *ev)
+{
+    // Only the latest value of an axis is needed, except for the wheel which is relative.
+    const uint32_t wheel = pending_axes & WLR_TABLET_TOOL_AXIS_WHEEL;
+    pending_wheel_delta = (wheel ? pending_wheel_delta : 0) + ev->wheel_delta;
+    pending_axes |= ev->updated_axes;
+    last_axis_event = *ev;
+    last_axis_event.updated_axes = pending_axes;
+    last_axis_event.wheel_delta  = pending_wheel_delta;
+
+    /* Update tilt, use old values if no new values are provided */
+    if (ev->updated_axes & WLR_TABLET_TOOL_AXIS_TILT_X)
+    {
+        tilt_x = ev->tilt_x;
+    }
+
+    if (ev->updated_axes & WLR_TABLET_TOOL_AXIS_TILT_Y)
+    {
+        tilt_y = ev->tilt_y;
+    }
+
+    if (!idle_flush_axis.is_connected())
+    {
+        idle_flush_axis.run_once([=] () { flush_axis(); });
+    }
+}
+
+void wf::tablet_tool_t::flush_axis()
+{
+    idle_flush_axis.disconnect();
+    if (!pending_axes)
+    {
+        return;
+    }
+
+    update_tool_position(true);
+    passthrough_axis();
+    pending_axes = 0;
+    pending_wheel_delta = 0;
 }
 
-void wf::tablet_tool_t::passthrough_axis(wlr_tablet_tool_axis_event *ev)
+void wf::tablet_tool_t::passthrough_axis()
 {
+    const auto ev = &last_axis_event;
     if (ev->updated_axes & WLR_TABLET_TOOL_AXIS_PRESSURE)
     {
         wlr_tablet_v2_tablet_tool_notify_pressure(tool_v2, ev->pressure);
@@ -212,17 +261,6 @@ void wf::tablet_tool_t::passthrough_axis(wlr_tablet_tool_axis_event *ev)
         wlr_tablet_v2_tablet_tool_notify_wheel(tool_v2, ev->wheel_delta, 0);
     }
 
-    /* Update tilt, use old values if no new values are provided */
-    if (ev->updated_axes & WLR_TABLET_TOOL_AXIS_TILT_X)
-    {
-        tilt_x = ev->tilt_x;
-    }
-
-    if (ev->updated_axes & WLR_TABLET_TOOL_AXIS_TILT_Y)
-    {
-        tilt_y = ev->tilt_y;
-    }
-
     if (ev->updated_axes &
         (WLR_TABLET_TOOL_AXIS_TILT_X | WLR_TABLET_TOOL_AXIS_TILT_Y))
     {
@@ -266,7 +304,8 @@ void wf::tablet_tool_t::handle_proximity(wlr_tablet_tool_proximity_event *ev)
     if (ev->state == WLR_TABLET_TOOL_PROXIMITY_OUT)
     {
         set_focus(nullptr);
-        is_active = false;
+        hovered_node = nullptr;
+        is_active    = false;
     } else
     {
         is_active = true;
@@ -309,6 +348,8 @@ wf::tablet_tool_t*wf::tablet_t::ensure_tool(wlr_tablet_tool *tool)
 void wf::tablet_t::handle_tip(wlr_tablet_tool_tip_event *ev,
     input_event_processing_mode_t mode)
 {
+    auto tool = ensure_tool(ev->tool);
+    tool->flush_axis();
     if (should_use_absolute_positioning(ev->tool))
     {
         wlr_cursor_warp_absolute(cursor, &ev->tablet->base, ev->x, ev->y);
@@ -329,7 +370,6 @@ void wf::tablet_t::handle_tip(wlr_tablet_tool_tip_event *ev,
             wf::buttonbinding_t{seat->priv->get_modifiers(), BTN_LEFT});
     }
 
-    auto tool = ensure_tool(ev->tool);
     if (!handled_in_binding)
     {
         tool->handle_tip(ev);
@@ -350,28 +390,30 @@ void wf::tablet_t::handle_axis(wlr_tablet_tool_axis_event *ev,
         wlr_cursor_move(cursor, &ev->tablet->base, ev->dx, ev->dy);
     }
 
-    /* Update focus */
-    auto tool = ensure_tool(ev->tool);
-    tool->update_tool_position(true);
-    tool->passthrough_axis(ev);
+    /* Focus is updated once for all axis events of this iteration of the event loop */
+    ensure_tool(ev->tool)->queue_axis(ev);
 }
 
 void wf::tablet_t::handle_button(wlr_tablet_tool_button_event *ev,
     input_event_processing_mode_t mode)
 {
     /* Pass to the tool */
-    ensure_tool(ev->tool)->handle_button(ev);
+    auto tool = ensure_tool(ev->tool);
+    tool->flush_axis();
+    tool->handle_button(ev);
 }
 
 void wf::tablet_t::handle_proximity(wlr_tablet_tool_proximity_event *ev,
     input_event_processing_mode_t mode)
 {
+    auto tool = ensure_tool(ev->tool);
+    tool->flush_axis();
     if (should_use_absolute_positioning(ev->tool))
     {
         wlr_cursor_warp_absolute(cursor, &ev->tablet->base, ev->x, ev->y);
     }
 
-    ensure_tool(ev->tool)->handle_proximity(ev);
+    tool->handle_proximity(ev);
     auto& impl = wf::get_core_impl();
 
     /* Show appropriate cursor */
@@ -539,13 +581,13 @@ void wf::tablet_pad_t::select_default_tool()
 
 bool wf::tablet_t::should_use_absolute_positioning(wlr_tablet_tool *tool)
 {
-    static wf::option_wrapper_t<std::string> tablet_motion_mode{"input/tablet_motion_mode"};
+    static wf::cached_option_t<std::string> tablet_motion_mode{"input/tablet_motion_mode"};
 
     /* Update cursor position */
-    if ((std::string)tablet_motion_mode == "absolute")
+    if (tablet_motion_mode.value() == "absolute")
     {
         return true;
-    } else if ((std::string)tablet_motion_mode == "relative")
+    } else if (tablet_motion_mode.value() == "relative")
     {
         return false;
     } else
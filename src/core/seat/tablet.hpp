@@ -34,10 +34,13 @@ struct tablet_tool_t
     void reset_grab();
 
     /**
-     * Send the axis updates directly.
-     * Only the position is handled separately.
+     * Queue the axis updates of an event. The updates queued in one iteration of the event loop are handled
+     * together, with a single refocus of the tool, and sent to the client in one frame.
      */
-    void passthrough_axis(wlr_tablet_tool_axis_event *ev);
+    void queue_axis(wlr_tablet_tool_axis_event *ev);
+
+    /** Handle the queued axis updates now, so that they are sent before the next tip, button or proximity. */
+    void flush_axis();
 
     /**
      * Called whenever a tip occurs for this tool
@@ -65,9 +68,24 @@ struct tablet_tool_t
     /** Surface where the tool was grabbed */
     scene::node_ptr grabbed_node = nullptr;
 
+    /** The node under the tool at the last refocus */
+    scene::node_ptr hovered_node = nullptr;
+
     double tilt_x = 0.0;
     double tilt_y = 0.0;
 
+    /* Axis updates queued with queue_axis() */
+    uint32_t pending_axes = 0;
+    double pending_wheel_delta = 0;
+    wlr_tablet_tool_axis_event last_axis_event;
+    wf::wl_idle_call idle_flush_axis;
+
+    /**
+     * Send the axis updates to the client.
+     * Only the position is handled separately.
+     */
+    void passthrough_axis();
+
     /* A tablet tool is active if it has a proximity_in
      * event but no proximity_out */
     bool is_active = false;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <wayfire/nonstd/observer_ptr.h>
+#include <wayfire/touch/touch.hpp>
+
+namespace wf
+{
+/**
+ * The touch gestures registered on a seat, and the subset of them which may still complete in the current
+ * touch sequence.
+ *
+ * All gestures are reset when the first finger goes down. Afterwards, a gesture which is cancelled (for
+ * example, because more fingers are down than it expects) or completed ignores events until the next reset,
+ * so it is dropped from the running set and not visited by further events of the sequence. With many
+ * fingers, this leaves only the few gestures for the current finger count.
+ *
+ * The running set is kept in a preallocated vector, so handling an event does not allocate.
+ */
+class touch_gesture_set_t
+{
+  public:
+    void add(nonstd::observer_ptr<touch::gesture_t> gesture)
+    {
+        gestures.push_back(gesture);
+        running.reserve(gestures.size());
+        // A gesture added in the middle of a touch sequence receives the rest of it, as before.
+        running.push_back(gesture);
+    }
+
+    void remove(nonstd::observer_ptr<touch::gesture_t> gesture)
+    {
+        gestures.erase(std::remove(gestures.begin(), gestures.end(), gesture), gestures.end());
+        // The gesture might be removed while the events are being dispatched, so only clear its entry here.
+        std::replace(running.begin(), running.end(), gesture, nonstd::observer_ptr<touch::gesture_t>{});
+    }
+
+    /**
+     * Dispatch an event to the running gestures.
+     *
+     * @param nr_fingers The number of fingers down, including the finger of a touch down event.
+     */
+    void update(const touch::gesture_event_t& ev, size_t nr_fingers)
+    {
+        if ((nr_fingers == 1) && (ev.type == touch::EVENT_TYPE_TOUCH_DOWN))
+        {
+            running.assign(gestures.begin(), gestures.end());
+            for (auto& gesture : running)
+            {
+                gesture->reset(ev.time);
+            }
+        }
+
+        // Gestures may be added and removed by the callbacks of completed gestures, so iterate by index.
+        size_t kept = 0;
+        for (size_t i = 0; i < running.size(); i++)
+        {
+            auto gesture = running[i];
+            if (!gesture)
+            {
+                continue;
+            }
+
+            gesture->update_state(ev);
+            if (running[i] && (gesture->get_status() == touch::GESTURE_STATUS_RUNNING))
+            {
+                running[kept++] = gesture;
+            }
+        }
+
+        running.resize(kept);
+    }
+
+    /** @return The number of gestures which may still complete in the current touch sequence. */
+    size_t nr_running() const
+    {
+        return running.size();
+    }
+
+  private:
+    std::vector<nonstd::observer_ptr<touch::gesture_t>> gestures;
+    std::vector<nonstd::observer_ptr<touch::gesture_t>> running;
+};
+}
@@ -145,14 +145,13 @@ void wf::touch_interface_t::add_touch_gesture(
     nonstd::observer_ptr<touch::gesture_t> gesture)
 {
     gesture->set_timer(std::make_unique<touch_timer_adapter_t>());
-    this->gestures.emplace_back(gesture);
+    this->gestures.add(gesture);
 }
 
 void wf::touch_interface_t::rem_touch_gesture(
     nonstd::observer_ptr<touch::gesture_t> gesture)
 {
-    gestures.erase(std::remove(gestures.begin(), gestures.end(), gesture),
-        gestures.end());
+    gestures.remove(gesture);
 }
 
 void wf::touch_interface_t::set_touch_focus(wf::scene::node_ptr node,
@@ -199,16 +198,7 @@ void wf::touch_interface_t::transfer_grab(scene::node_ptr grab_node)
 
 void wf::touch_interface_t::update_gestures(const wf::touch::gesture_event_t& ev)
 {
-    for (auto& gesture : this->gestures)
-    {
-        if ((this->finger_state.fingers.size() == 1) &&
-            (ev.type == touch::EVENT_TYPE_TOUCH_DOWN))
-        {
-            gesture->reset(ev.time);
-        }
-
-        gesture->update_state(ev);
-    }
+    this->gestures.update(ev, this->finger_state.fingers.size());
 }
 
 void wf::touch_interface_t::handle_touch_down(int32_t id, uint32_t time,
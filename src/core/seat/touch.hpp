@@ -3,6 +3,7 @@
 
 #include <map>
 #include <wayfire/touch/touch.hpp>
+#include "touch-gesture-set.hpp"
 #include "wayfire/scene-input.hpp"
 #include "wayfire/util.hpp"
 #include <wayfire/signal-definitions.hpp>
@@ -71,7 +72,7 @@ class touch_interface_t
     std::map<int, wf::scene::node_ptr> focus;
 
     void update_gestures(const wf::touch::gesture_event_t& event);
-    std::vector<nonstd::observer_ptr<touch::gesture_t>> gestures;
+    touch_gesture_set_t gestures;
 
     wf::signal::connection_t<wf::scene::root_node_update_signal>
     on_root_node_updated;
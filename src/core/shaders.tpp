@@ -39,6 +39,29 @@ void main()
 
 
 
+static const char *color_batch_vertex_source =
+R"(#version 100
+
+attribute mediump vec2 position;
+attribute mediump vec4 color;
+varying mediump vec4 vcolor;
+
+uniform mat4 MVP;
+
+void main() {
+    gl_Position = MVP * vec4(position.xy, 0.0, 1.0);
+    vcolor = color;
+})";
+
+static const char *color_batch_fragment_source =
+R"(#version 100
+varying mediump vec4 vcolor;
+
+void main()
+{
+    gl_FragColor = vcolor;
+})";
+
 static const char *builtin_rgba_source =
 R"(
 uniform sampler2D _wayfire_texture;
@@ -0,0 +1,177 @@
+#include <wayfire/startup-profile.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <nlohmann/json.hpp>
+#include <wayland-server-core.h>
+
+namespace
+{
+/* The profile is relative to the time the binary was loaded, which is close enough to the process start. */
+const auto process_start = wf::startup_profile::clock::now();
+
+/* Give up waiting for the first frames this long after startup finished. */
+constexpr int FINISH_TIMEOUT_MS = 10'000;
+
+struct profile_state_t
+{
+    bool recording = true;
+    bool startup_finished = false;
+    std::vector<wf::startup_profile::event_t> events;
+    std::set<uint32_t> outputs_with_frame;
+    wl_event_source *timeout = nullptr;
+};
+
+profile_state_t& state()
+{
+    static profile_state_t state;
+    return state;
+}
+
+int64_t to_us(wf::startup_profile::clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - process_start).count();
+}
+
+bool all_outputs_presented()
+{
+    for (auto& output : wf::get_core().output_layout->get_outputs())
+    {
+        if (!state().outputs_with_frame.count(output->get_id()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void write_trace(const std::string& path)
+{
+    nlohmann::json trace;
+    trace["traceEvents"] = nlohmann::json::array();
+    for (auto& ev : state().events)
+    {
+        nlohmann::json entry;
+        entry["name"] = ev.name;
+        entry["cat"]  = ev.category;
+        entry["ts"]   = ev.start_us;
+        entry["pid"]  = 1;
+        entry["tid"]  = 1;
+        if (ev.duration_us > 0)
+        {
+            entry["ph"]  = "X";
+            entry["dur"] = ev.duration_us;
+        } else
+        {
+            entry["ph"] = "i";
+            entry["s"]  = "g";
+        }
+
+        trace["traceEvents"].push_back(std::move(entry));
+    }
+
+    std::ofstream out{path};
+    out << trace.dump(1);
+    if (!out)
+    {
+        LOGE("Failed to write the startup trace to ", path);
+    } else
+    {
+        LOGI("Wrote the startup trace to ", path);
+    }
+}
+}
+
+double wf::startup_profile::get_uptime_ms()
+{
+    return to_us(clock::now()) / 1000.0;
+}
+
+bool wf::startup_profile::is_recording()
+{
+    return state().recording;
+}
+
+void wf::startup_profile::mark(const std::string& category, const std::string& name)
+{
+    if (state().recording)
+    {
+        state().events.push_back({category, name, to_us(clock::now()), 0});
+    }
+}
+
+void wf::startup_profile::record(const std::string& category, const std::string& name,
+    clock::time_point start)
+{
+    if (state().recording)
+    {
+        const auto start_us = to_us(start);
+        state().events.push_back({category, name, start_us, to_us(clock::now()) - start_us});
+    }
+}
+
+void wf::startup_profile::mark_first_frame(wf::output_t *output)
+{
+    if (!state().recording)
+    {
+        return;
+    }
+
+    mark("output", "first frame on " + output->to_string());
+    state().outputs_with_frame.insert(output->get_id());
+    if (state().startup_finished && all_outputs_presented())
+    {
+        finish();
+    }
+}
+
+void wf::startup_profile::startup_finished()
+{
+    mark("core", "startup finished");
+    state().startup_finished = true;
+    if (all_outputs_presented())
+    {
+        // Only happens without any outputs, otherwise at least the first frame is still pending.
+        finish();
+        return;
+    }
+
+    state().timeout = wl_event_loop_add_timer(wf::get_core().ev_loop, [] (void*)
+    {
+        finish();
+        return 0;
+    }, nullptr);
+    wl_event_source_timer_update(state().timeout, FINISH_TIMEOUT_MS);
+}
+
+void wf::startup_profile::finish()
+{
+    auto& s = state();
+    if (s.timeout)
+    {
+        wl_event_source_remove(s.timeout);
+        s.timeout = nullptr;
+    }
+
+    if (!s.recording)
+    {
+        return;
+    }
+
+    s.recording = false;
+    if (const char *path = getenv("WAYFIRE_STARTUP_TRACE"))
+    {
+        write_trace(path);
+    }
+}
+
+const std::vector<wf::startup_profile::event_t>& wf::startup_profile::get_events()
+{
+    return state().events;
+}
@@ -0,0 +1,50 @@
+#include "tearing-control.hpp"
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+wf::tearing_control_manager_t::tearing_control_manager_t(wl_display *display)
+{
+    manager = wlr_tearing_control_manager_v1_create(display, 1);
+}
+
+bool wf::tearing_control_manager_t::wants_tearing(wlr_surface *surface) const
+{
+    static wf::option_wrapper_t<bool> allow_tearing{"core/allow_tearing"};
+
+    if (!manager || (wlr_tearing_control_manager_v1_surface_hint_from_surface(manager, surface) !=
+                     WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC))
+    {
+        return false;
+    }
+
+    auto view = wf::wl_surface_to_wayfire_view(surface->resource);
+    if (view && view->has_data<view_tearing_policy_t>())
+    {
+        return view->get_data<view_tearing_policy_t>()->allow;
+    }
+
+    return allow_tearing;
+}
+
+void wf::tearing_control_manager_t::set_tearing(wf::output_t *output, bool tearing)
+{
+    if (tearing)
+    {
+        tearing_outputs.insert(output);
+    } else
+    {
+        tearing_outputs.erase(output);
+    }
+}
+
+bool wf::tearing_control_manager_t::is_tearing(wf::output_t *output) const
+{
+    return tearing_outputs.count(output);
+}
+
+void wf::tearing_control_manager_t::remove_output(wf::output_t *output)
+{
+    tearing_outputs.erase(output);
+}
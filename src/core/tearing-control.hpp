@@ -0,0 +1,47 @@
+#ifndef WF_CORE_TEARING_CONTROL_HPP
+#define WF_CORE_TEARING_CONTROL_HPP
+
+#include <wayfire/nonstd/wlroots.hpp>
+#include <unordered_set>
+
+struct wlr_tearing_control_manager_v1;
+
+namespace wf
+{
+class output_t;
+
+/**
+ * Implements the tearing-control-v1 protocol.
+ *
+ * Surfaces which are directly scanned out and whose client asks for async presentation are committed with
+ * an async page flip, i.e. they are shown right away instead of at the next vblank, if tearing is allowed for
+ * them. While an output shows such a surface, frames are painted as soon as the client commits, without the
+ * repaint delay. Composited frames are never torn.
+ */
+class tearing_control_manager_t
+{
+  public:
+    tearing_control_manager_t(wl_display *display);
+
+    tearing_control_manager_t(const tearing_control_manager_t&) = delete;
+    tearing_control_manager_t& operator =(const tearing_control_manager_t&) = delete;
+
+    /** @return Whether @surface should be scanned out with an async page flip. */
+    bool wants_tearing(wlr_surface *surface) const;
+
+    /** Record whether the last frame of @output was a torn direct scanout. */
+    void set_tearing(wf::output_t *output, bool tearing);
+
+    /** @return Whether the last frame of @output was a torn direct scanout. */
+    bool is_tearing(wf::output_t *output) const;
+
+    /** Forget the state of an output which is being destroyed. */
+    void remove_output(wf::output_t *output);
+
+  private:
+    wlr_tearing_control_manager_v1 *manager;
+    std::unordered_set<wf::output_t*> tearing_outputs;
+};
+}
+
+#endif /* end of include guard: WF_CORE_TEARING_CONTROL_HPP */
@@ -0,0 +1,416 @@
+#include <wayfire/thread-pool.hpp>
+#include <wayfire/debug.hpp>
+#include "core-impl.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <wayland-server-core.h>
+
+namespace
+{
+/**
+ * The number of CPUs the compositor may use: the CPUs in its affinity mask, limited by the CPU quota of its
+ * cgroup (cgroup v2), if any.
+ */
+size_t get_available_cpus()
+{
+    size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        cpus = std::max(1, CPU_COUNT(&set));
+    }
+
+    std::ifstream cpu_max{"/sys/fs/cgroup/cpu.max"};
+    std::string quota;
+    double period;
+    if ((cpu_max >> quota >> period) && (quota != "max") && (period > 0))
+    {
+        const double quota_cpus = std::ceil(std::stod(quota) / period);
+        cpus = std::clamp<size_t>(quota_cpus, 1, cpus);
+    }
+
+    return cpus;
+}
+}
+
+struct wf::thread_pool_t::impl
+{
+    struct worker_t
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<worker_t>> workers;
+    std::atomic<size_t> next_worker = 0;
+
+    // The number of queued tasks which no worker has claimed yet, and whether the workers should exit.
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    size_t unclaimed = 0;
+    bool stopping    = false;
+
+    // Completions are handed to the main loop through an eventfd, like asynchronous image loading.
+    std::mutex completions_mutex;
+    std::vector<std::function<void()>> completions;
+    int event_fd = -1;
+    wl_event_source *event_source = nullptr;
+
+    static thread_local impl *current_pool;
+    static thread_local size_t current_worker;
+
+    void push(std::function<void()> task)
+    {
+        // Tasks submitted by a worker go to its own queue, where they are likely to still be in the cache.
+        const size_t index = (current_pool == this) ? current_worker : (next_worker++ % workers.size());
+        {
+            std::lock_guard<std::mutex> lock(workers[index]->mutex);
+            workers[index]->tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            ++unclaimed;
+        }
+
+        wake.notify_one();
+    }
+
+    /** Take the newest task of the worker's own queue, or steal the oldest task of another queue. */
+    bool pop(size_t index, std::function<void()>& task)
+    {
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            auto& worker = *workers[(index + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (worker.tasks.empty())
+            {
+                continue;
+            }
+
+            if (i == 0)
+            {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+            } else
+            {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void run_worker(size_t index)
+    {
+        current_pool   = this;
+        current_worker = index;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [&] { return stopping || (unclaimed > 0); });
+                if (stopping)
+                {
+                    return;
+                }
+
+                --unclaimed;
+            }
+
+            // A task was claimed, so there is at least one in the queues. Other workers may be taking
+            // theirs at the same time, so it may take another pass to find it.
+            std::function<void()> task;
+            while (!pop(index, task))
+            {
+                std::this_thread::yield();
+            }
+
+            task();
+        }
+    }
+
+    void post_completion(std::function<void()> done)
+    {
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex);
+            completions.push_back(std::move(done));
+        }
+
+        uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) != sizeof(one))
+        {
+            LOGE("Failed to wake up the main loop after a task completed");
+        }
+    }
+
+    static int dispatch_completions(int fd, uint32_t mask, void *data)
+    {
+        auto self = static_cast<impl*>(data);
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+        {
+            return 0;
+        }
+
+        std::vector<std::function<void()>> done;
+        {
+            std::lock_guard<std::mutex> lock(self->completions_mutex);
+            std::swap(done, self->completions);
+        }
+
+        for (auto& callback : done)
+        {
+            callback();
+        }
+
+        return 0;
+    }
+};
+
+thread_local wf::thread_pool_t::impl *wf::thread_pool_t::impl::current_pool = nullptr;
+thread_local size_t wf::thread_pool_t::impl::current_worker = 0;
+
+wf::thread_pool_t::thread_pool_t(wl_event_loop *loop, size_t workers)
+{
+    priv = std::make_unique<impl>();
+    if (workers == 0)
+    {
+        // The main thread does its share of the work in parallel_for().
+        workers = std::max<size_t>(1, get_available_cpus() - 1);
+    }
+
+    priv->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (priv->event_fd >= 0)
+    {
+        priv->event_source = wl_event_loop_add_fd(loop, priv->event_fd, WL_EVENT_READABLE,
+            impl::dispatch_completions, priv.get());
+    } else
+    {
+        LOGE("Failed to create eventfd for the thread pool, task completions will not run");
+    }
+
+    for (size_t i = 0; i < workers; i++)
+    {
+        priv->workers.push_back(std::make_unique<impl::worker_t>());
+    }
+
+    for (size_t i = 0; i < workers; i++)
+    {
+        priv->workers[i]->thread = std::thread([this, i] () { priv->run_worker(i); });
+    }
+
+    LOGD("Started thread pool with ", workers, " workers");
+}
+
+wf::thread_pool_t::~thread_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(priv->sleep_mutex);
+        priv->stopping = true;
+    }
+
+    priv->wake.notify_all();
+    for (auto& worker : priv->workers)
+    {
+        worker->thread.join();
+    }
+
+    if (priv->event_source)
+    {
+        wl_event_source_remove(priv->event_source);
+    }
+
+    if (priv->event_fd >= 0)
+    {
+        close(priv->event_fd);
+    }
+}
+
+wf::thread_pool_t& wf::thread_pool_t::get()
+{
+    return *wf::get_core_impl().thread_pool;
+}
+
+size_t wf::thread_pool_t::get_worker_count() const
+{
+    return priv->workers.size();
+}
+
+void wf::thread_pool_t::parallel_for(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count <= 1)
+    {
+        if (count == 1)
+        {
+            fn(0);
+        }
+
+        return;
+    }
+
+    struct state_t
+    {
+        const std::function<void(size_t)> *fn;
+        size_t count;
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        void run()
+        {
+            size_t i;
+            while ((i = next++) < count)
+            {
+                (*fn)(i);
+                if (++done == count)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        }
+    };
+
+    // Helpers which start after all indices were taken return right away, but may still touch the state
+    // after this function returned, so it is shared with them.
+    auto state   = std::make_shared<state_t>();
+    state->fn    = &fn;
+    state->count = count;
+
+    const size_t helpers = std::min(count - 1, priv->workers.size());
+    for (size_t i = 0; i < helpers; i++)
+    {
+        priv->push([state] () { state->run(); });
+    }
+
+    state->run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == count; });
+}
+
+struct wf::task_group_t::impl : public std::enable_shared_from_this<impl>
+{
+    thread_pool_t::impl *pool;
+
+    struct entry_t
+    {
+        std::function<void()> task;
+        std::function<void()> done;
+    };
+
+    // The plugin's callbacks are kept here instead of in the pool's queues, so that the group can destroy
+    // them when it is destroyed itself, while the plugin is still loaded.
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::deque<entry_t> queued;
+    std::vector<std::function<void()>> finished;
+    size_t running = 0;
+    bool cancelled = false;
+
+    // Accessed only on the main thread.
+    size_t pending = 0;
+
+    void run_one()
+    {
+        entry_t entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cancelled || queued.empty())
+            {
+                return;
+            }
+
+            entry = std::move(queued.front());
+            queued.pop_front();
+            ++running;
+        }
+
+        entry.task();
+        entry.task = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!cancelled)
+            {
+                finished.push_back(std::move(entry.done));
+            }
+
+            entry.done = nullptr;
+            --running;
+        }
+
+        idle.notify_all();
+        pool->post_completion([self = shared_from_this()] () { self->dispatch(); });
+    }
+
+    void dispatch()
+    {
+        std::vector<std::function<void()>> done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(done, finished);
+        }
+
+        for (auto& callback : done)
+        {
+            // A callback may destroy the group.
+            if (cancelled)
+            {
+                break;
+            }
+
+            --pending;
+            if (callback)
+            {
+                callback();
+            }
+        }
+    }
+};
+
+wf::task_group_t::task_group_t(thread_pool_t& pool)
+{
+    priv = std::make_shared<impl>();
+    priv->pool = pool.priv.get();
+}
+
+wf::task_group_t::~task_group_t()
+{
+    std::unique_lock<std::mutex> lock(priv->mutex);
+    priv->cancelled = true;
+    priv->queued.clear();
+    priv->finished.clear();
+    priv->idle.wait(lock, [&] { return priv->running == 0; });
+}
+
+void wf::task_group_t::submit(std::function<void()> task, std::function<void()> done)
+{
+    {
+        std::lock_guard<std::mutex> lock(priv->mutex);
+        priv->queued.push_back({std::move(task), std::move(done)});
+    }
+
+    ++priv->pending;
+    priv->pool->push([group = priv] () { group->run_one(); });
+}
+
+size_t wf::task_group_t::get_pending_count() const
+{
+    return priv->pending;
+}
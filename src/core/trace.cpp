@@ -0,0 +1,21 @@
+#include <wayfire/trace.hpp>
+
+#if defined(WF_TRACING_PERFETTO)
+PERFETTO_TRACK_EVENT_STATIC_STORAGE();
+
+void wf::trace::init()
+{
+    // Zones are sent to the system tracing service (traced), and recorded when a trace session is active.
+    perfetto::TracingInitArgs args;
+    args.backends = perfetto::kSystemBackend;
+    perfetto::Tracing::Initialize(args);
+    perfetto::TrackEvent::Register();
+}
+
+#else
+void wf::trace::init()
+{
+    // Tracy connects on its own when the profiler is started, nothing to do otherwise.
+}
+
+#endif
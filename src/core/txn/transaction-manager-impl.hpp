@@ -1,19 +1,74 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/txn/transaction.hpp"
 #include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
 #include <wayfire/txn/transaction-manager.hpp>
 #include <wayfire/debug.hpp>
 
-static bool transactions_intersect(const wf::txn::transaction_uptr& a, const wf::txn::transaction_uptr& b)
+/**
+ * A fixed-size ring buffer of transaction lifecycle events.
+ */
+class transaction_trace_t
 {
-    const auto& obj_a = a->get_objects();
-    const auto& obj_b = b->get_objects();
+  public:
+    void set_capacity(size_t capacity)
+    {
+        entries.assign(capacity, {});
+        next  = 0;
+        count = 0;
+    }
 
-    return std::any_of(obj_a.begin(), obj_a.end(), [&] (const wf::txn::transaction_object_sptr& x)
+    bool enabled() const
     {
-        return std::find(obj_b.begin(), obj_b.end(), x) != obj_b.end();
-    });
-}
+        return !entries.empty();
+    }
+
+    void record(wf::txn::transaction_event_t event, const void *tx, const void *other_tx = nullptr,
+        wf::txn::transaction_object_t *object = nullptr)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+
+        auto& entry = entries[next];
+        entry.time_us  = wf::get_current_time_us();
+        entry.tx       = tx;
+        entry.other_tx = other_tx;
+        entry.event    = event;
+        entry.object[0] = '\0';
+        if (object)
+        {
+            auto name = object->stringify();
+            const size_t len = std::min(name.size(), sizeof(entry.object) - 1);
+            std::memcpy(entry.object, name.data(), len);
+            entry.object[len] = '\0';
+        }
+
+        next  = (next + 1) % entries.size();
+        count = std::min(count + 1, entries.size());
+    }
+
+    std::vector<wf::txn::transaction_trace_entry_t> get_entries() const
+    {
+        std::vector<wf::txn::transaction_trace_entry_t> result;
+        result.reserve(count);
+        const size_t first = (next + entries.size() - count) % std::max(entries.size(), (size_t)1);
+        for (size_t i = 0; i < count; i++)
+        {
+            result.push_back(entries[(first + i) % entries.size()]);
+        }
+
+        return result;
+    }
+
+  private:
+    std::vector<wf::txn::transaction_trace_entry_t> entries;
+    size_t next  = 0;
+    size_t count = 0;
+};
 
 struct wf::txn::transaction_manager_t::impl
 {
@@ -25,6 +80,7 @@ struct wf::txn::transaction_manager_t::impl
     void schedule_transaction(transaction_uptr tx)
     {
         LOGC(TXN, "Scheduling transaction ", tx.get());
+        trace.record(transaction_event_t::SCHEDULED, tx.get());
 
         // Step 1: add any objects which are directly or indirectly connected to the objects in tx
         coalesce_transactions(tx);
@@ -33,41 +89,55 @@ struct wf::txn::transaction_manager_t::impl
         remove_conflicts(tx);
 
         // Step 3: schedule tx for execution. At this point, there are no conflicts in all pending txs
+        index_objects(pending_objects, tx.get());
         pending.push_back(std::move(tx));
         consider_commit();
     }
 
     void coalesce_transactions(const transaction_uptr& tx)
     {
-        while (true)
+        // The pending transactions never share objects, so every object is in at most one of them. Note that
+        // tx grows while we iterate over its objects, so that transactions which are only indirectly
+        // connected to tx are merged too.
+        merged.clear();
+        for (size_t i = 0; i < tx->get_objects().size(); i++)
         {
-            const size_t start_size = tx->get_objects().size();
-            for (auto& existing : pending)
+            auto it = pending_objects.find(tx->get_objects()[i].get());
+            if ((it == pending_objects.end()) || !merged.insert(it->second).second)
             {
-                if (transactions_intersect(existing, tx))
-                {
-                    for (auto& obj : existing->get_objects())
-                    {
-                        tx->add_object(obj);
-                    }
-                }
+                continue;
             }
 
-            if (start_size == tx->get_objects().size())
+            trace.record(transaction_event_t::MERGED, it->second, tx.get());
+
+            for (auto& obj : it->second->get_objects())
             {
-                // No new objects were added in the last iteration => done
-                break;
+                tx->add_object(obj);
             }
+
+            transaction_merged_signal ev;
+            ev.self = it->second;
+            ev.into = tx.get();
+            it->second->emit(&ev);
         }
     }
 
     void remove_conflicts(const transaction_uptr& tx)
     {
+        if (merged.empty())
+        {
+            return;
+        }
+
         auto it = std::remove_if(pending.begin(), pending.end(), [&] (const transaction_uptr& existing)
         {
-            return transactions_intersect(existing, tx);
+            return merged.count(existing.get());
         });
+
+        // The objects of the merged transactions are all part of tx, and are indexed again when tx is
+        // added to the pending list.
         pending.erase(it, pending.end());
+        merged.clear();
     }
 
     // Try to commit as many transactions as possible
@@ -83,6 +153,7 @@ struct wf::txn::transaction_manager_t::impl
             {
                 auto tx = std::move(pending[idx]);
                 pending.erase(pending.begin() + idx);
+                unindex_objects(pending_objects, tx.get());
                 do_commit(std::move(tx));
                 // Note: the container may change after this operation, because some objects emit ready
                 // directly inside commit().
@@ -95,25 +166,89 @@ struct wf::txn::transaction_manager_t::impl
 
     bool can_commit_transaction(const transaction_uptr& tx)
     {
-        return std::none_of(committed.begin(), committed.end(), [&] (const transaction_uptr& comm)
+        const auto& objs = tx->get_objects();
+        return std::none_of(objs.begin(), objs.end(), [&] (const transaction_object_sptr& obj)
         {
-            return transactions_intersect(tx, comm);
+            return committed_objects.count(obj.get());
         });
     }
 
     void do_commit(transaction_uptr tx)
     {
         tx->connect(&on_tx_apply);
+        tx->connect(&on_tx_split);
+        if (trace.enabled())
+        {
+            tx->connect(&on_tx_object_ready);
+        }
+
+        trace.record(transaction_event_t::COMMITTED, tx.get());
+        index_objects(committed_objects, tx.get());
         committed.push_back(std::move(tx));
         // Note: this might immediately trigger tx_apply if all objects are already ready!
         committed.back()->commit();
     }
 
+    using object_index_t = std::unordered_map<transaction_object_t*, transaction_t*>;
+    static void index_objects(object_index_t& index, transaction_t *tx)
+    {
+        for (auto& obj : tx->get_objects())
+        {
+            index[obj.get()] = tx;
+        }
+    }
+
+    static void unindex_objects(object_index_t& index, transaction_t *tx)
+    {
+        unindex_objects(index, tx, tx->get_objects());
+    }
+
+    static void unindex_objects(object_index_t& index, transaction_t *tx,
+        const std::vector<transaction_object_sptr>& objects)
+    {
+        for (auto& obj : objects)
+        {
+            auto it = index.find(obj.get());
+            if ((it != index.end()) && (it->second == tx))
+            {
+                index.erase(it);
+            }
+        }
+    }
+
     std::vector<transaction_uptr> done; // Temporary storage for transactions which are complete
     std::vector<transaction_uptr> committed;
     std::vector<transaction_uptr> pending;
     wf::wl_idle_call idle_clear_done;
 
+    // For each object, the pending (respectively committed) transaction it is part of. Since neither pending
+    // nor committed transactions share objects, each object is part of at most one of each.
+    object_index_t pending_objects;
+    object_index_t committed_objects;
+
+    // The transaction collecting the objects scheduled during a batch, see begin_batch().
+    transaction_uptr batch;
+    int batch_depth = 0;
+
+    // Temporary storage for the pending transactions merged in coalesce_transactions().
+    std::unordered_set<transaction_t*> merged;
+    transaction_trace_t trace;
+
+    wf::signal::connection_t<transaction_object_ready_signal> on_tx_object_ready =
+        [&] (transaction_object_ready_signal *ev)
+    {
+        trace.record(transaction_event_t::OBJECT_READY, ev->self, nullptr, ev->object);
+    };
+
+    wf::signal::connection_t<transaction_split_signal> on_tx_split = [&] (transaction_split_signal *ev)
+    {
+        // The applied objects are no longer part of the committed transaction, so the next transactions for
+        // them can be committed already.
+        trace.record(transaction_event_t::SPLIT, ev->self);
+        unindex_objects(committed_objects, ev->self, ev->applied);
+        consider_commit();
+    };
+
     wf::signal::connection_t<transaction_applied_signal> on_tx_apply = [&] (transaction_applied_signal *ev)
     {
         // Move transactions which are done from committed to done.
@@ -124,7 +259,9 @@ struct wf::txn::transaction_manager_t::impl
         });
 
         wf::dassert(it != committed.end(), "Transaction not found in committed list");
+        trace.record(ev->timed_out ? transaction_event_t::TIMED_OUT : transaction_event_t::APPLIED, ev->self);
 
+        unindex_objects(committed_objects, it->get());
         done.push_back(std::move(*it));
         committed.erase(it);
         consider_commit();
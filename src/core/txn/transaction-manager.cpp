@@ -3,6 +3,7 @@
 #include "transaction-manager-impl.hpp"
 #include "wayfire/debug.hpp"
 #include "wayfire/txn/transaction.hpp"
+#include "wayfire/scene.hpp"
 
 wf::txn::transaction_manager_t::transaction_manager_t()
 {
@@ -13,6 +14,8 @@ wf::txn::transaction_manager_t::~transaction_manager_t() = default;
 
 void wf::txn::transaction_manager_t::schedule_transaction(wf::txn::transaction_uptr tx)
 {
+    // Views are refocused based on their pending state, which is now different.
+    wf::scene::invalidate_keyboard_refocus();
     new_transaction_signal ev;
     ev.tx = tx.get();
     this->emit(&ev);
@@ -21,29 +24,65 @@ void wf::txn::transaction_manager_t::schedule_transaction(wf::txn::transaction_u
 
 void wf::txn::transaction_manager_t::schedule_object(transaction_object_sptr object)
 {
+    if (priv->batch)
+    {
+        priv->batch->add_object(std::move(object));
+        return;
+    }
+
     auto tx = wf::txn::transaction_t::create();
     tx->add_object(std::move(object));
     schedule_transaction(std::move(tx));
 }
 
-template<class T>
-static bool is_contained(const std::vector<T>& objs, const T& object)
+void wf::txn::transaction_manager_t::begin_batch()
 {
-    return std::find(objs.begin(), objs.end(), object) != objs.end();
+    if (priv->batch_depth++ == 0)
+    {
+        priv->batch = wf::txn::transaction_t::create();
+    }
+}
+
+void wf::txn::transaction_manager_t::end_batch()
+{
+    wf::dassert(priv->batch_depth > 0, "end_batch() without a matching begin_batch()!");
+    if (--priv->batch_depth > 0)
+    {
+        return;
+    }
+
+    auto tx = std::move(priv->batch);
+    if (!tx->get_objects().empty())
+    {
+        schedule_transaction(std::move(tx));
+    }
 }
 
 bool wf::txn::transaction_manager_t::is_object_pending(transaction_object_sptr object) const
 {
-    return std::any_of(this->priv->pending.begin(), this->priv->pending.end(), [&] (auto& pending)
+    if (priv->batch)
     {
-        return is_contained(pending->get_objects(), object);
-    });
+        const auto& objs = priv->batch->get_objects();
+        if (std::find(objs.begin(), objs.end(), object) != objs.end())
+        {
+            return true;
+        }
+    }
+
+    return this->priv->pending_objects.count(object.get());
 }
 
 bool wf::txn::transaction_manager_t::is_object_committed(transaction_object_sptr object) const
 {
-    return std::any_of(this->priv->committed.begin(), this->priv->committed.end(), [&] (auto& committed)
-    {
-        return is_contained(committed->get_objects(), object);
-    });
+    return this->priv->committed_objects.count(object.get());
+}
+
+void wf::txn::transaction_manager_t::set_trace_capacity(size_t capacity)
+{
+    priv->trace.set_capacity(capacity);
+}
+
+std::vector<wf::txn::transaction_trace_entry_t> wf::txn::transaction_manager_t::get_trace() const
+{
+    return priv->trace.get_entries();
 }
@@ -1,7 +1,10 @@
 #include "wayfire/option-wrapper.hpp"
 #include "wayfire/txn/transaction-object.hpp"
 #include <wayfire/txn/transaction.hpp>
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
+#include <unordered_map>
 #include <wayfire/debug.hpp>
 
 std::string wf::txn::transaction_object_t::stringify() const
@@ -11,6 +14,79 @@ std::string wf::txn::transaction_object_t::stringify() const
     return out.str();
 }
 
+namespace
+{
+/**
+ * Learns how fast each client makes its transaction objects ready after they have been committed. The
+ * estimate works like the estimate of the round-trip time in TCP (RFC 6298): the budget of a client is its
+ * smoothed latency plus four times the latency variation.
+ */
+class client_latency_tracker_t
+{
+  public:
+    static client_latency_tracker_t& get()
+    {
+        static client_latency_tracker_t tracker;
+        return tracker;
+    }
+
+    void add_sample(wl_client *client, int64_t latency_us)
+    {
+        if (!client)
+        {
+            return;
+        }
+
+        auto& data = clients[client];
+        if (!data)
+        {
+            data = std::make_unique<client_latency_t>();
+            data->on_destroy.notify = handle_client_destroy;
+            wl_client_add_destroy_listener(client, &data->on_destroy);
+            data->smoothed_us  = latency_us;
+            data->variation_us = latency_us / 2;
+            return;
+        }
+
+        data->variation_us = (3 * data->variation_us + std::abs(data->smoothed_us - latency_us)) / 4;
+        data->smoothed_us  = (7 * data->smoothed_us + latency_us) / 8;
+    }
+
+    /**
+     * Get the time after which the client is late, or -1 if nothing is known about the client.
+     */
+    int64_t get_budget_us(wl_client *client)
+    {
+        auto it = clients.find(client);
+        if (!client || (it == clients.end()))
+        {
+            return -1;
+        }
+
+        return std::max(MIN_BUDGET_US, it->second->smoothed_us + 4 * it->second->variation_us);
+    }
+
+  private:
+    // Do not split transactions on the slightest delay, a client needs at least a frame to respond.
+    static constexpr int64_t MIN_BUDGET_US = 20'000;
+
+    struct client_latency_t
+    {
+        wl_listener on_destroy;
+        int64_t smoothed_us;
+        int64_t variation_us;
+    };
+
+    std::unordered_map<wl_client*, std::unique_ptr<client_latency_t>> clients;
+
+    static void handle_client_destroy(wl_listener *listener, void *data)
+    {
+        wl_list_remove(&listener->link);
+        get().clients.erase((wl_client*)data);
+    }
+};
+}
+
 wf::txn::transaction_t::transaction_t(uint64_t timeout, timer_setter_t timer_setter)
 {
     this->timeout = timeout;
@@ -23,6 +99,15 @@ wf::txn::transaction_t::transaction_t(uint64_t timeout, timer_setter_t timer_set
             count_ready_objects, "/", this->objects.size(), ")");
 
         wf::dassert(count_ready_objects <= (int)this->objects.size(), "object emitted ready multiple times?");
+        ready_objects.push_back(ev->self);
+        client_latency_tracker_t::get().add_sample(ev->self->get_client(),
+            wf::get_current_time_us() - commit_time_us);
+
+        transaction_object_ready_signal ready_ev;
+        ready_ev.self   = this;
+        ready_ev.object = ev->self;
+        this->emit(&ready_ev);
+
         if (count_ready_objects == (int)this->objects.size())
         {
             apply(false);
@@ -37,8 +122,27 @@ const std::vector<wf::txn::transaction_object_sptr>& wf::txn::transaction_t::get
 
 void wf::txn::transaction_t::add_object(transaction_object_sptr object)
 {
-    auto it = std::find(objects.begin(), objects.end(), object);
-    if (it == objects.end())
+    // Small transactions are searched linearly, large ones (e.g. after merging many transactions) keep an
+    // index of their objects, so that adding objects does not become quadratic.
+    static constexpr size_t MAX_LINEAR_SEARCH = 16;
+    bool contained;
+    if (objects.size() < MAX_LINEAR_SEARCH)
+    {
+        contained = std::find(objects.begin(), objects.end(), object) != objects.end();
+    } else
+    {
+        if (object_index.empty())
+        {
+            for (auto& obj : objects)
+            {
+                object_index.insert(obj.get());
+            }
+        }
+
+        contained = !object_index.insert(object.get()).second;
+    }
+
+    if (!contained)
     {
         LOGC(TXNI, "Transaction ", this, " add object ", object->stringify());
         objects.push_back(object);
@@ -47,6 +151,7 @@ void wf::txn::transaction_t::add_object(transaction_object_sptr object)
 
 void wf::txn::transaction_t::commit()
 {
+    WF_TRACE_ZONE("transaction commit");
     LOGC(TXN, "Committing transaction ", this, " with timeout ", this->timeout);
     if (this->objects.empty())
     {
@@ -55,25 +160,118 @@ void wf::txn::transaction_t::commit()
         return;
     }
 
+    commit_time_us = wf::get_current_time_us();
+    ready_objects.clear();
     for (auto& obj : this->objects)
     {
         obj->connect(&on_object_ready);
         obj->commit();
     }
 
-    timer_setter(this->timeout, [=] ()
+    auto apply_on_timeout = [=] ()
     {
         if (count_ready_objects < (int)this->objects.size())
         {
             apply(true);
         }
 
+        return false;
+    };
+
+    const int64_t split_timeout = adaptive_timeout ? get_split_timeout() : -1;
+    if (split_timeout <= 0)
+    {
+        timer_setter(this->timeout, apply_on_timeout);
+        return;
+    }
+
+    timer_setter(split_timeout, [=] ()
+    {
+        if (count_ready_objects < (int)this->objects.size())
+        {
+            split();
+            // The timer cannot be set again from its own callback.
+            idle_set_final_timeout.run_once([=] ()
+            {
+                timer_setter(this->timeout - split_timeout, apply_on_timeout);
+            });
+        }
+
         return false;
     });
 }
 
+void wf::txn::transaction_t::set_adaptive_timeout(bool enabled)
+{
+    this->adaptive_timeout = enabled;
+}
+
+int64_t wf::txn::transaction_t::get_split_timeout()
+{
+    if (objects.size() < 2)
+    {
+        // Nothing to split.
+        return -1;
+    }
+
+    // Split only once every object is late compared to what its client usually needs. Objects of unknown
+    // clients get the full timeout.
+    int64_t budget_us = 0;
+    for (auto& obj : objects)
+    {
+        const int64_t obj_budget = client_latency_tracker_t::get().get_budget_us(obj->get_client());
+        if (obj_budget < 0)
+        {
+            return -1;
+        }
+
+        budget_us = std::max(budget_us, obj_budget);
+    }
+
+    const int64_t budget_ms = (budget_us + 999) / 1000;
+    return (budget_ms < (int64_t)this->timeout) ? budget_ms : -1;
+}
+
+void wf::txn::transaction_t::split()
+{
+    transaction_split_signal ev;
+    ev.self = this;
+
+    std::vector<transaction_object_sptr> remaining;
+    for (auto& obj : this->objects)
+    {
+        if (std::find(ready_objects.begin(), ready_objects.end(), obj.get()) != ready_objects.end())
+        {
+            ev.applied.push_back(obj);
+        } else
+        {
+            remaining.push_back(obj);
+        }
+    }
+
+    if (ev.applied.empty())
+    {
+        return;
+    }
+
+    LOGC(TXN, "Splitting transaction ", this, ": applying ", ev.applied.size(), " ready objects, ",
+        remaining.size(), " objects are late");
+    this->objects = std::move(remaining);
+    this->object_index.clear();
+    this->ready_objects.clear();
+    this->count_ready_objects = 0;
+    for (auto& obj : ev.applied)
+    {
+        obj->disconnect(&on_object_ready);
+        obj->apply();
+    }
+
+    this->emit(&ev);
+}
+
 void wf::txn::transaction_t::apply(bool did_timeout)
 {
+    WF_TRACE_ZONE("transaction apply");
     on_object_ready.disconnect();
 
     LOGC(TXN, "Applying transaction ", this, " timed_out: ", did_timeout);
@@ -116,5 +314,8 @@ std::unique_ptr<wf::txn::transaction_t> wf::txn::transaction_t::create(int64_t t
         timeout = tx_timeout;
     }
 
-    return std::make_unique<wayfire_default_transaction_t>(timeout);
+    static wf::option_wrapper_t<bool> adaptive_timeout{"core/transaction_adaptive_timeout"};
+    auto tx = std::make_unique<wayfire_default_transaction_t>(timeout);
+    tx->set_adaptive_timeout(adaptive_timeout);
+    return tx;
 }
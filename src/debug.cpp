@@ -17,7 +17,10 @@
 #include <cstring>
 #include <dlfcn.h>
 #include <sys/stat.h>
+#include <atomic>
 #include <iostream>
+#include <new>
+#include <config.h>
 
 #define MAX_FRAMES 256
 #define MAX_FUNCTION_NAME 1024
@@ -348,6 +351,52 @@ std::ostream& wf::operator <<(std::ostream& out, wayfire_view view)
 }
 
 std::bitset<(size_t)wf::log::logging_category::TOTAL> wf::log::enabled_categories;
+std::bitset<(size_t)wf::log::logging_category::TOTAL> wf::log::recorded_categories;
+
+const char *wf::log::category_to_string(logging_category category)
+{
+    switch (category)
+    {
+      case logging_category::TXN:
+        return "TXN";
+
+      case logging_category::TXNI:
+        return "TXNI";
+
+      case logging_category::VIEWS:
+        return "VIEWS";
+
+      case logging_category::WLR:
+        return "WLR";
+
+      case logging_category::SCANOUT:
+        return "SCANOUT";
+
+      case logging_category::POINTER:
+        return "POINTER";
+
+      case logging_category::WSET:
+        return "WSET";
+
+      case logging_category::KBD:
+        return "KBD";
+
+      case logging_category::XWL:
+        return "XWL";
+
+      case logging_category::LSHELL:
+        return "LSHELL";
+
+      case logging_category::IM:
+        return "IM";
+
+      case logging_category::RENDER:
+        return "RENDER";
+
+      default:
+        return "UNKNOWN";
+    }
+}
 
 #define CLEAR_COLOR "\033[0m"
 #define GREY_COLOR "\033[30;1m"
@@ -432,3 +481,64 @@ void wf::detail::option_wrapper_debug_message(const std::string & option_name, c
     wf::print_trace(false);
     std::_Exit(0);
 }
+
+#if WF_ALLOCATION_STATS
+/* Replace the global allocation functions to count allocations. Everything else is forwarded to malloc and
+ * free, like in the default implementation. The counter is atomic, since worker threads (the IPC worker and
+ * the thread pool) allocate too. */
+static std::atomic<int64_t> heap_allocation_count = 0;
+
+static void *counted_alloc(std::size_t size)
+{
+    heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void *operator new(std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int64_t wf::get_heap_allocation_count()
+{
+    return heap_allocation_count.load(std::memory_order_relaxed);
+}
+
+#else
+int64_t wf::get_heap_allocation_count()
+{
+    return -1;
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <wayfire/core.hpp>
 
 #include <cstring>
+#include <map>
 #include <sys/inotify.h>
 #include <filesystem>
 #include <unistd.h>
@@ -30,6 +31,72 @@ static void reload_config(int fd)
     wf::config::load_configuration_options_from_file(*cfg_manager, config_file);
 }
 
+/** The values of all options, by section and option name. */
+using config_snapshot_t = std::map<std::string, std::map<std::string, std::string>>;
+
+static config_snapshot_t take_snapshot()
+{
+    config_snapshot_t snapshot;
+    for (auto& section : cfg_manager->get_all_sections())
+    {
+        auto& values = snapshot[section->get_name()];
+        for (auto& option : section->get_registered_options())
+        {
+            values[option->get_name()] = option->get_value_str();
+        }
+    }
+
+    return snapshot;
+}
+
+/** Record the options which differ between @before and @after in @ev. */
+static void diff_snapshots(const config_snapshot_t& before, const config_snapshot_t& after,
+    wf::reload_config_signal& ev)
+{
+    ev.changes_known = true;
+    auto diff_section = [&] (const std::string& name, const std::map<std::string, std::string>& a,
+                             const std::map<std::string, std::string>& b)
+    {
+        if (a.size() != b.size())
+        {
+            ev.changed_sections.insert(name);
+        }
+
+        for (auto& [option, value] : a)
+        {
+            auto it = b.find(option);
+            if ((it == b.end()) || (it->second != value))
+            {
+                ev.add_changed_option(name, option);
+            }
+        }
+
+        for (auto& [option, value] : b)
+        {
+            if (!a.count(option))
+            {
+                ev.add_changed_option(name, option);
+            }
+        }
+    };
+
+    static const std::map<std::string, std::string> empty;
+    for (auto& [name, values] : before)
+    {
+        auto it = after.find(name);
+        diff_section(name, values, (it == after.end()) ? empty : it->second);
+    }
+
+    for (auto& [name, values] : after)
+    {
+        if (!before.count(name))
+        {
+            ev.changed_sections.insert(name);
+            diff_section(name, empty, values);
+        }
+    }
+}
+
 static int handle_config_updated(int fd, uint32_t mask, void *data)
 {
     if ((mask & WL_EVENT_READABLE) == 0)
@@ -84,8 +151,12 @@ static int handle_config_updated(int fd, uint32_t mask, void *data)
     {
         LOGD("Reloading configuration file");
 
+        auto before = take_snapshot();
         reload_config(fd);
+
         wf::reload_config_signal ev;
+        diff_snapshots(before, take_snapshot(), ev);
+        LOGD("Configuration reloaded, ", ev.changed_options.size(), " options changed");
         wf::get_core().emit(&ev);
     }
 
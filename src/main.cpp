@@ -1,12 +1,16 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <optional>
+#include <sstream>
 #include <getopt.h>
 #include <signal.h>
 #include <fcntl.h>
 
 #include <unistd.h>
 #include <wayfire/debug.hpp>
+#include <wayfire/startup-profile.hpp>
+#include <wayfire/trace.hpp>
 #include "main.hpp"
 
 #include <wayland-server.h>
@@ -34,6 +38,8 @@ static void print_help()
         std::endl;
     std::cout << " -h,  --help              print this help" << std::endl;
     std::cout << " -d,  --debug             enable debug logging" << std::endl;
+    std::cout << "      --record            record debug categories in the log ring, " <<
+        "printed on crash (e.g. --record txn,pointer)" << std::endl;
     std::cout <<
         " -D,  --damage-debug      enable additional debug for damaged regions" <<
         std::endl;
@@ -103,6 +109,11 @@ static void wlr_log_handler(wlr_log_importance level,
         wf::log::enabled_categories.test((int)wf::log::logging_category::WLR);
     if ((wlevel == wf::log::LOG_LEVEL_DEBUG) && !enabled)
     {
+        if (wf::log::recorded_categories.test((int)wf::log::logging_category::WLR))
+        {
+            wf::log::ring::record((size_t)wf::log::logging_category::WLR, "wlroots", 0, (const char*)buffer);
+        }
+
         return;
     }
 
@@ -143,6 +154,7 @@ static void signal_handler(int signal)
 
     LOGE("Fatal error: ", error);
     wf::print_trace(false);
+    wf::log::ring::dump_to_log();
     std::_Exit(-1);
 }
 
@@ -183,61 +195,70 @@ static wf::config_backend_t *load_backend(const std::string& backend)
     return init();
 }
 
-void parse_extended_debugging(const std::vector<std::string>& categories)
+struct debugging_category_t
+{
+    const char *name;
+    wf::log::logging_category category;
+    const char *description;
+};
+
+static const debugging_category_t debugging_categories[] = {
+    {"txn", wf::log::logging_category::TXN, "transactions"},
+    {"txni", wf::log::logging_category::TXNI, "transaction objects"},
+    {"views", wf::log::logging_category::VIEWS, "views"},
+    {"wlroots", wf::log::logging_category::WLR, "wlroots"},
+    {"scanout", wf::log::logging_category::SCANOUT, "direct scanout"},
+    {"pointer", wf::log::logging_category::POINTER, "pointer events"},
+    {"wset", wf::log::logging_category::WSET, "workspace set events"},
+    {"kbd", wf::log::logging_category::KBD, "keyboard events"},
+    {"xwayland", wf::log::logging_category::XWL, "xwayland events"},
+    {"layer-shell", wf::log::logging_category::LSHELL, "layer-shell events"},
+    {"im", wf::log::logging_category::IM, "input method events"},
+    {"render", wf::log::logging_category::RENDER, "render events"},
+};
+
+static const debugging_category_t *find_debugging_category(const std::string& name)
 {
-    for (const auto& cat : categories)
+    for (const auto& cat : debugging_categories)
     {
-        if (cat == "txn")
-        {
-            LOGD("Enabling extended debugging for transactions");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::TXN, 1);
-        } else if (cat == "txni")
-        {
-            LOGD("Enabling extended debugging for transaction objects");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::TXNI, 1);
-        } else if (cat == "views")
-        {
-            LOGD("Enabling extended debugging for views");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::VIEWS, 1);
-        } else if (cat == "wlroots")
-        {
-            LOGD("Enabling extended debugging for wlroots");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::WLR, 1);
-        } else if (cat == "scanout")
-        {
-            LOGD("Enabling extended debugging for direct scanout");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::SCANOUT, 1);
-        } else if (cat == "pointer")
-        {
-            LOGD("Enabling extended debugging for pointer events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::POINTER, 1);
-        } else if (cat == "wset")
+        if (name == cat.name)
         {
-            LOGD("Enabling extended debugging for workspace set events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::WSET, 1);
-        } else if (cat == "kbd")
-        {
-            LOGD("Enabling extended debugging for keyboard events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::KBD, 1);
-        } else if (cat == "xwayland")
-        {
-            LOGD("Enabling extended debugging for xwayland events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::XWL, 1);
-        } else if (cat == "layer-shell")
-        {
-            LOGD("Enabling extended debugging for layer-shell events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::LSHELL, 1);
-        } else if (cat == "im")
-        {
-            LOGD("Enabling extended debugging for input method events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::IM, 1);
-        } else if (cat == "render")
+            return &cat;
+        }
+    }
+
+    LOGE("Unrecognized debugging category \"", name, "\"");
+    return nullptr;
+}
+
+void parse_extended_debugging(const std::vector<std::string>& categories)
+{
+    for (const auto& name : categories)
+    {
+        if (auto cat = find_debugging_category(name))
         {
-            LOGD("Enabling extended debugging for render events");
-            wf::log::enabled_categories.set((size_t)wf::log::logging_category::RENDER, 1);
-        } else
+            LOGD("Enabling extended debugging for ", cat->description);
+            wf::log::enabled_categories.set((size_t)cat->category, 1);
+        }
+    }
+}
+
+/**
+ * Parse the categories to record in the log ring, given as a comma-separated list like `txn,pointer`.
+ */
+void parse_recorded_categories(const std::vector<std::string>& lists)
+{
+    for (const auto& list : lists)
+    {
+        std::stringstream ss(list);
+        std::string name;
+        while (std::getline(ss, name, ','))
         {
-            LOGE("Unrecognized debugging category \"", cat, "\"");
+            if (auto cat = find_debugging_category(name))
+            {
+                LOGI("Recording ", cat->description, " in the log ring");
+                wf::log::recorded_categories.set((size_t)cat->category, 1);
+            }
         }
     }
 }
@@ -272,6 +293,7 @@ int main(int argc, char *argv[])
             "config-backend", required_argument, NULL, 'B'
         },
         {"debug", optional_argument, NULL, 'd'},
+        {"record", required_argument, NULL, 'T'},
         {"damage-debug", no_argument, NULL, 'D'},
         {"damage-rerender", no_argument, NULL, 'R'},
         {"legacy-wl-drm", no_argument, NULL, 'l'},
@@ -284,6 +306,7 @@ int main(int argc, char *argv[])
     std::string config_file;
     std::string config_backend = WF_DEFAULT_CONFIG_BACKEND;
     std::vector<std::string> extended_debug_categories;
+    std::vector<std::string> recorded_debug_categories;
     bool allow_root = false;
 
     int c, i;
@@ -339,6 +362,10 @@ int main(int argc, char *argv[])
 
             break;
 
+          case 'T':
+            recorded_debug_categories.push_back(optarg);
+            break;
+
           case 'v':
             print_version();
             break;
@@ -355,6 +382,8 @@ int main(int argc, char *argv[])
     wf::log::initialize_logging(std::cout, log_level, detect_color_mode());
 
     parse_extended_debugging(extended_debug_categories);
+    parse_recorded_categories(recorded_debug_categories);
+    wf::trace::init();
     wlr_log_init(WLR_DEBUG, wlr_log_handler);
 
 #ifdef PRINT_TRACE
@@ -372,6 +401,7 @@ int main(int argc, char *argv[])
     {
         std::cout << "Unhandled exception" << std::endl;
         wf::print_trace(false);
+        wf::log::ring::dump_to_log();
         std::abort();
     });
 
@@ -387,7 +417,13 @@ int main(int argc, char *argv[])
     /** TODO: move this to core_impl constructor */
     core.display = display;
     core.ev_loop = wl_display_get_event_loop(core.display);
-    core.backend = wlr_backend_autocreate(core.ev_loop, &core.session);
+    {
+        wf::startup_profile::scope_t step{"core", "create backend"};
+        core.backend = wlr_backend_autocreate(core.ev_loop, &core.session);
+    }
+
+    std::optional<wf::startup_profile::scope_t> renderer_step;
+    renderer_step.emplace("core", "create renderer");
 
     int drm_fd = -1;
     char *drm_device = getenv("WLR_RENDER_DRM_DEVICE");
@@ -427,6 +463,7 @@ int main(int argc, char *argv[])
     assert(core.allocator);
     core.egl = wlr_gles2_renderer_get_egl(core.renderer);
     assert(core.egl);
+    renderer_step.reset();
 
     if (!allow_root && !drop_permissions())
     {
@@ -447,8 +484,15 @@ int main(int argc, char *argv[])
 
     LOGD("Using configuration backend: ", config_backend);
     core.config_backend = std::unique_ptr<wf::config_backend_t>(backend);
-    core.config_backend->init(display, core.config, config_file);
-    core.init();
+    {
+        wf::startup_profile::scope_t step{"core", "load configuration"};
+        core.config_backend->init(display, core.config, config_file);
+    }
+
+    {
+        wf::startup_profile::scope_t step{"core", "initialize core"};
+        core.init();
+    }
 
     auto socket = choose_socket(core.display);
     if (!socket)
@@ -460,6 +504,7 @@ int main(int argc, char *argv[])
 
     core.wayland_display = socket.value();
     LOGI("Using socket name ", core.wayland_display);
+    wf::startup_profile::clock::time_point backend_start = wf::startup_profile::clock::now();
     if (!wlr_backend_start(core.backend))
     {
         LOGE("Failed to initialize backend, exiting");
@@ -469,6 +514,7 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    wf::startup_profile::record("core", "start backend", backend_start);
     setenv("WAYLAND_DISPLAY", core.wayland_display.c_str(), 1);
     core.post_init();
 
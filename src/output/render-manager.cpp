@@ -10,25 +10,139 @@
 #include "wayfire/view.hpp"
 #include "wayfire/output.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/startup-profile.hpp"
 #include "../core/opengl-priv.hpp"
+#include "../core/core-impl.hpp"
+#include "../core/dmabuf-feedback.hpp"
+#include "../core/tearing-control.hpp"
+#include "../core/content-type.hpp"
 #include "../main.hpp"
 #include "wayfire/workspace-set.hpp"
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <vector>
 #include <wayfire/nonstd/reverse.hpp>
-#include <wayfire/nonstd/safe-list.hpp>
+#include <wayfire/nonstd/compact-safe-list.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wlr/types/wlr_gamma_control_v1.h>
 
 namespace wf
 {
+/**
+ * Accumulates the damage of an output into a decaying heatmap, see render_manager::set_damage_heatmap().
+ * The output is divided into square cells. Each frame, the heat of every cell decays, and the share of the
+ * cell which was damaged in that frame is added.
+ */
+class damage_heatmap_t
+{
+  public:
+    static constexpr int CELL_SIZE = 32;
+    // Heat remaining after one frame. Damage in every frame settles at a heat of 1 / (1 - DECAY).
+    static constexpr float DECAY = 0.94f;
+    static constexpr float MIN_HEAT = 0.02f;
+
+    /** Add damage reported for the next frame, in output-local coordinates. */
+    void add_damage(const wf::region_t& region)
+    {
+        pending |= region;
+    }
+
+    /** Start a new frame of the given output size: decay the heat and add the damage of the frame. */
+    void update(wf::dimensions_t size)
+    {
+        const int cols = (size.width + CELL_SIZE - 1) / CELL_SIZE;
+        const int rows = (size.height + CELL_SIZE - 1) / CELL_SIZE;
+        if ((cols != this->cols) || (rows != this->rows))
+        {
+            this->cols = cols;
+            this->rows = rows;
+            heat.assign(cols * rows, 0.0f);
+        }
+
+        hot_cells = 0;
+        for (auto& h : heat)
+        {
+            h  = h * DECAY;
+            h *= (h >= MIN_HEAT);
+        }
+
+        frame_damage = pending & wf::geometry_t{0, 0, size.width, size.height};
+        pending.clear();
+        for (const auto& box : frame_damage)
+        {
+            for (int y = box.y1 / CELL_SIZE; y * CELL_SIZE < box.y2; y++)
+            {
+                for (int x = box.x1 / CELL_SIZE; x * CELL_SIZE < box.x2; x++)
+                {
+                    const int w = std::min(box.x2, (x + 1) * CELL_SIZE) - std::max(box.x1, x * CELL_SIZE);
+                    const int h = std::min(box.y2, (y + 1) * CELL_SIZE) - std::max(box.y1, y * CELL_SIZE);
+                    heat[y * cols + x] += float(w * h) / (CELL_SIZE * CELL_SIZE);
+                }
+            }
+        }
+
+        for (auto h : heat)
+        {
+            hot_cells += (h > 0);
+        }
+    }
+
+    /** @return Whether anything is drawn, so that the next frame has to be rendered to update the heatmap. */
+    bool is_visible() const
+    {
+        return hot_cells > 0;
+    }
+
+    /** Draw the heatmap and the damage of the current frame on the given output-local target. */
+    void render(const wf::render_target_t& target)
+    {
+        batch.clear();
+        for (int y = 0; y < rows; y++)
+        {
+            for (int x = 0; x < cols; x++)
+            {
+                const float h = heat[y * cols + x];
+                if (h > 0)
+                {
+                    const float alpha = std::min(h / 8.0f, 1.0f) * 0.6f;
+                    batch.add({x * CELL_SIZE, y * CELL_SIZE, CELL_SIZE, CELL_SIZE}, {alpha, 0, 0, alpha});
+                }
+            }
+        }
+
+        for (const auto& box : frame_damage)
+        {
+            batch.add(wlr_box_from_pixman_box(box), {0, 0.25, 0, 0.25});
+        }
+
+        OpenGL::render_begin(target);
+        batch.render(target.get_orthographic_projection());
+        OpenGL::render_end();
+    }
+
+  private:
+    wf::region_t pending;
+    wf::region_t frame_damage;
+    std::vector<float> heat;
+    OpenGL::rectangle_batch_t batch;
+    int cols = 0;
+    int rows = 0;
+    int hot_cells = 0;
+};
+
 /**
  * swapchain_damage_manager_t is responsible for tracking the damage and managing the swapchain on the
  * given output.
  */
 struct swapchain_damage_manager_t
 {
-    wf::option_wrapper_t<bool> force_frame_sync{"workarounds/force_frame_sync"};
+    wf::cached_option_t<bool> force_frame_sync{"workarounds/force_frame_sync"};
     signal::connection_t<scene::root_node_update_signal> root_update;
     std::vector<scene::render_instance_uptr> render_instances;
 
@@ -42,7 +156,13 @@ struct swapchain_damage_manager_t
     wlr_damage_ring damage_ring;
     output_t *wo;
 
+    // Set while the damage heatmap is shown.
+    std::unique_ptr<damage_heatmap_t> heatmap;
+
     bool pending_gamma_lut = false;
+    // The gamma ramp programmed on the output (red, green and blue after each other), empty if there is none,
+    // or std::nullopt if it is not known because a commit failed.
+    std::optional<std::vector<uint16_t>> applied_gamma = std::vector<uint16_t>{};
     wf::wl_idle_call idle_recompute_visibility;
 
     void update_scenegraph(uint32_t update_mask)
@@ -62,9 +182,16 @@ struct swapchain_damage_manager_t
             auto root = wf::get_core().scene();
             scene::damage_callback push_damage = [=] (wf::region_t region)
             {
+                output_scene_damage_signal ev;
+                ev.region = &region;
+                wo->emit(&ev);
+
                 // Damage is pushed up to the root in root coordinate system,
                 // we need it in layout-local coordinate system.
                 region += -wf::origin(wo->get_layout_geometry());
+                // Every output receives the damage of the whole scene. Only the part on this output should
+                // schedule a repaint, otherwise damage on one output repaints all of them.
+                region &= wo->get_relative_geometry();
                 this->damage(region, true);
             };
 
@@ -76,16 +203,37 @@ struct swapchain_damage_manager_t
         {
             idle_recompute_visibility.run_once([=] ()
             {
-                LOGC(RENDER, "Output ", wo->to_string(), ": recomputing visibility.");
-                wf::region_t region = this->wo->get_layout_geometry();
-                for (auto& inst : render_instances)
-                {
-                    inst->compute_visibility(wo, region);
-                }
+                recompute_visibility();
             });
         }
     }
 
+    void recompute_visibility()
+    {
+        LOGC(RENDER, "Output ", wo->to_string(), ": recomputing visibility.");
+        wf::region_t region = this->wo->get_layout_geometry();
+        scene::begin_bounding_box_cache();
+        for (auto& inst : render_instances)
+        {
+            inst->compute_visibility(wo, region);
+        }
+
+        scene::end_bounding_box_cache();
+    }
+
+    /**
+     * Render instances may skip rendering based on their visibility, so make sure it is up-to-date before
+     * rendering a frame.
+     */
+    void flush_visibility()
+    {
+        if (idle_recompute_visibility.is_connected())
+        {
+            idle_recompute_visibility.disconnect();
+            recompute_visibility();
+        }
+    }
+
     void update_damage_ring_bounds()
     {
         int width, height;
@@ -115,13 +263,16 @@ struct swapchain_damage_manager_t
         wlr_damage_ring_init(&damage_ring);
         update_damage_ring_bounds();
 
-        on_needs_frame.set_callback([=] (void*) { schedule_repaint(); });
+        // The output needs a frame without new damage when the hardware cursor is updated. Such frames do not
+        // need a repaint of the scene, see try_commit_cursor_only().
+        on_needs_frame.set_callback([=] (void*) { wlr_output_schedule_frame(output->handle); });
         on_damage.set_callback([&] (void *data)
         {
+            // Damage from wlroots itself, i.e. the old and new boxes of software cursors
             auto ev = static_cast<wlr_output_event_damage*>(data);
             if (wlr_damage_ring_add(&damage_ring, ev->damage))
             {
-                schedule_repaint();
+                request_frame();
             }
         });
 
@@ -139,8 +290,10 @@ struct swapchain_damage_manager_t
             auto event = (const wlr_gamma_control_manager_v1_set_gamma_event*)data;
             if (event->output == this->output)
             {
+                // The ramp is committed without repainting the scene if nothing else changed, see
+                // try_commit_cursor_only().
                 pending_gamma_lut = true;
-                schedule_repaint();
+                wlr_output_schedule_frame(output);
             }
         });
 
@@ -172,8 +325,14 @@ struct swapchain_damage_manager_t
             return;
         }
 
+        if (heatmap)
+        {
+            heatmap->add_damage(region);
+        }
+
         /* Wlroots expects damage after scaling */
         auto scaled_region = region * wo->handle->scale;
+        scene_repaint_pending = true;
         frame_damage |= scaled_region;
         wlr_damage_ring_add(&damage_ring, scaled_region.to_pixman());
         if (repaint)
@@ -189,8 +348,14 @@ struct swapchain_damage_manager_t
             return;
         }
 
+        if (heatmap)
+        {
+            heatmap->add_damage(box);
+        }
+
         /* Wlroots expects damage after scaling */
         auto scaled_box = box * wo->handle->scale;
+        scene_repaint_pending = true;
         frame_damage |= scaled_box;
         wlr_damage_ring_add_box(&damage_ring, &scaled_box);
         if (repaint)
@@ -270,6 +435,15 @@ struct swapchain_damage_manager_t
     }
 
     bool try_apply_gamma(frame_object_t& next_frame)
+    {
+        return try_apply_gamma(next_frame.state);
+    }
+
+    /**
+     * Add the pending gamma ramp to the output state. Night light tools set a new ramp every few seconds,
+     * often the same one as before, so the ramp is added only if it differs from the programmed one.
+     */
+    bool try_apply_gamma(wlr_output_state& state)
     {
         if (!pending_gamma_lut)
         {
@@ -280,15 +454,30 @@ struct swapchain_damage_manager_t
         auto gamma_control =
             wlr_gamma_control_manager_v1_get_control(wf::get_core().protocols.gamma_v1, output);
 
-        if (!wlr_gamma_control_v1_apply(gamma_control, &next_frame.state))
+        std::vector<uint16_t> ramp;
+        if (gamma_control)
+        {
+            ramp.assign(gamma_control->table, gamma_control->table + 3 * gamma_control->ramp_size);
+        }
+
+        if (applied_gamma == ramp)
+        {
+            return true;
+        }
+
+        if (!wlr_gamma_control_v1_apply(gamma_control, &state))
         {
             LOGE("Failed to apply gamma to output state!");
             return false;
         }
 
-        if (!wlr_output_test_state(output, &next_frame.state))
+        if (!wlr_output_test_state(output, &state))
         {
             wlr_gamma_control_v1_send_failed_and_destroy(gamma_control);
+            applied_gamma.reset();
+        } else
+        {
+            applied_gamma = std::move(ramp);
         }
 
         return true;
@@ -302,9 +491,12 @@ struct swapchain_damage_manager_t
      */
     std::unique_ptr<frame_object_t> start_frame()
     {
+        WF_TRACE_ZONE("start frame");
         const bool needs_swap = force_next_frame | output->needs_frame |
             pixman_region32_not_empty(&damage_ring.current) | (constant_redraw_counter > 0);
-        force_next_frame = false;
+        force_next_frame      = false;
+        cursor_only_frame     = !scene_repaint_pending && (constant_redraw_counter == 0);
+        scene_repaint_pending = false;
 
         if (!needs_swap)
         {
@@ -312,7 +504,6 @@ struct swapchain_damage_manager_t
         }
 
         auto next_frame = std::make_unique<frame_object_t>();
-        next_frame->state.committed |= WLR_OUTPUT_STATE_DAMAGE;
 
         if (!try_apply_gamma(*next_frame))
         {
@@ -340,8 +531,15 @@ struct swapchain_damage_manager_t
         return next_frame;
     }
 
-    void swap_buffers(std::unique_ptr<frame_object_t> next_frame, const wf::region_t& swap_damage)
+    /**
+     * Submit the frame and commit it to the output.
+     *
+     * @param whole_changed Whether the whole frame may differ from the previous one, even outside of the
+     *   damage of the scene, e.g. because of non-pointwise postprocessing effects.
+     */
+    void swap_buffers(std::unique_ptr<frame_object_t> next_frame, bool whole_changed)
     {
+        WF_TRACE_ZONE("swap buffers");
         /* If force frame sync option is set, call glFinish to block until
          * the GPU finishes rendering. This can work around some driver
          * bugs, but may cause more resource usage. */
@@ -362,6 +560,17 @@ struct swapchain_damage_manager_t
         wlr_output_state_set_buffer(&next_frame->state, next_frame->buffer);
         wlr_buffer_unlock(next_frame->buffer);
 
+        // The part of the buffer which changed since the previous frame. Screencopy clients which requested
+        // damage (screen recorders, remote desktop) copy and encode only this region, and get no frame at
+        // all while nothing changes.
+        wf::region_t changed{&damage_ring.current};
+        if (whole_changed || runtime_config.no_damage_track || runtime_config.damage_debug || heatmap)
+        {
+            changed |= get_wlr_damage_box();
+        }
+
+        wlr_output_state_set_damage(&next_frame->state, changed.to_pixman());
+
         if (!wlr_output_test_state(output, &next_frame->state))
         {
             LOGE("Output test failed!");
@@ -385,10 +594,34 @@ struct swapchain_damage_manager_t
     {
         wlr_damage_ring_get_buffer_damage(&damage_ring, buffer_age, acc_damage.to_pixman());
         frame_damage |= acc_damage;
-        if (runtime_config.no_damage_track)
+        // The heatmap is drawn over the whole output, so everything below it has to be repainted.
+        if (runtime_config.no_damage_track || heatmap)
         {
             frame_damage |= get_wlr_damage_box();
         }
+
+        simplify_frame_damage();
+    }
+
+    wf::cached_option_t<int> damage_max_rectangles{"core/damage_max_rectangles"};
+    uint64_t simplified_frames = 0;
+    int64_t simplify_added_area = 0;
+
+    /**
+     * Merge the rectangles of the frame damage if there are too many of them, so that render instances
+     * issue fewer draw calls. The swapchain damage is not changed, as the additional area is repainted with
+     * the same contents.
+     */
+    void simplify_frame_damage()
+    {
+        const int max_boxes = damage_max_rectangles;
+        if ((max_boxes <= 0) || (pixman_region32_n_rects(frame_damage.to_pixman()) <= max_boxes))
+        {
+            return;
+        }
+
+        ++simplified_frames;
+        simplify_added_area += frame_damage.simplify(max_boxes);
     }
 
     /**
@@ -400,15 +633,105 @@ struct swapchain_damage_manager_t
         return frame_damage * (1.0 / wo->handle->scale);
     }
 
+    /**
+     * Whether the scene was damaged or a repaint was requested since the last frame was started. If not,
+     * the frame is rendered only because of the damage of software cursors.
+     */
+    bool scene_repaint_pending = false;
+    bool cursor_only_frame     = false;
+    /* The number of frames rendered only because software cursors were moved or changed. */
+    uint64_t cursor_only_frames = 0;
+    /* The number of frames committed without rendering, to update the hardware cursor. */
+    uint64_t cursor_plane_commits = 0;
+
+    /**
+     * If the output needs a new frame only because the hardware cursor was moved or changed, or because a
+     * new gamma ramp was set, commit the output without a new buffer, so that the cursor plane and the gamma
+     * ramp are updated without repainting the scene.
+     *
+     * @return Whether the frame was committed this way.
+     */
+    bool try_commit_cursor_only()
+    {
+        if (force_next_frame || !(output->needs_frame || pending_gamma_lut) || (constant_redraw_counter > 0) ||
+            pixman_region32_not_empty(&damage_ring.current))
+        {
+            return false;
+        }
+
+        wlr_output_state state;
+        wlr_output_state_init(&state);
+        const bool had_gamma = pending_gamma_lut;
+        if (!try_apply_gamma(state))
+        {
+            wlr_output_state_finish(&state);
+            return false;
+        }
+
+        if (!output->needs_frame && !state.committed)
+        {
+            // The ramp did not change, nothing to commit.
+            wlr_output_state_finish(&state);
+            return true;
+        }
+
+        const bool committed = wlr_output_commit_state(output, &state);
+        wlr_output_state_finish(&state);
+        if (!committed)
+        {
+            // Fall back to a full frame, which also applies the gamma ramp again.
+            if (had_gamma)
+            {
+                pending_gamma_lut = true;
+                applied_gamma.reset();
+                request_frame();
+            }
+
+            return false;
+        }
+
+        ++cursor_plane_commits;
+        return true;
+    }
+
     /**
      * Schedule a frame for the output
      */
     void schedule_repaint()
     {
-        wlr_output_schedule_frame(output);
+        scene_repaint_pending = true;
+        request_frame();
+    }
+
+    /**
+     * Schedule a frame for the output, without marking the scene as needing a repaint.
+     */
+    void request_frame()
+    {
         force_next_frame = true;
+        if (defer_repaints)
+        {
+            deferred_repaint = true;
+            return;
+        }
+
+        if (!output->enabled)
+        {
+            // In DPMS, the next frame is scheduled when the output is turned on again.
+            return;
+        }
+
+        wlr_output_schedule_frame(output);
     }
 
+    /**
+     * While set, schedule_repaint() only records that a new frame is needed (see deferred_repaint), the
+     * frame itself is scheduled later by the render manager. Used to limit the rate of frames requested
+     * while painting (i.e. frames driven by compositor animations) on adaptive sync outputs.
+     */
+    bool defer_repaints   = false;
+    bool deferred_repaint = false;
+
     /**
      * Return the extents of the visible region for the output in the wlroots
      * damage coordinate system.
@@ -449,7 +772,7 @@ struct swapchain_damage_manager_t
     /**
      * Same as render_manager::damage_whole()
      */
-    void damage_whole()
+    void damage_whole(bool repaint = true)
     {
         auto vsize = wo->wset()->get_workspace_grid_size();
         auto vp    = wo->wset()->get_current_workspace();
@@ -460,7 +783,7 @@ struct swapchain_damage_manager_t
                 -vp.y * res.height,
                 vsize.width * res.width,
                 vsize.height * res.height,
-            }, true);
+            }, repaint);
     }
 
     wf::wl_idle_call idle_damage;
@@ -482,7 +805,7 @@ struct swapchain_damage_manager_t
  */
 struct effect_hook_manager_t
 {
-    using effect_container_t = wf::safe_list_t<effect_hook_t*>;
+    using effect_container_t = wf::compact_safe_list_t<effect_hook_t*>;
     effect_container_t effects[OUTPUT_EFFECT_TOTAL];
 
     void add_effect(effect_hook_t *hook, output_effect_type_t type)
@@ -506,29 +829,78 @@ struct effect_hook_manager_t
 
     void run_effects(output_effect_type_t type)
     {
+        WF_TRACE_ZONE("effect hooks");
         effects[type].for_each([] (auto effect)
         { (*effect)(); });
     }
 };
 
+static const char *post_color_vertex_shader =
+    R"(
+#version 100
+
+attribute mediump vec2 position;
+attribute highp vec2 uvPosition;
+
+varying highp vec2 uvpos;
+
+void main() {
+
+    gl_Position = vec4(position.xy, 0.0, 1.0);
+    uvpos = uvPosition;
+}
+)";
+
 /**
  * A class to manage and run postprocessing effects
  */
 struct postprocessing_manager_t
 {
-    using post_container_t = wf::safe_list_t<post_hook_t*>;
+    using post_container_t = wf::compact_safe_list_t<post_hook_t*>;
     post_container_t post_effects;
     wf::framebuffer_t post_buffers[3];
     /* Buffer to which other operations render to */
     static constexpr uint32_t default_out_buffer = 0;
 
+    /* Color effects are added to post_effects as a hook owned by the manager, so that their order relative
+     * to the other hooks is kept. Consecutive color hooks are then run as a single fused pass. */
+    std::map<post_color_effect_t*, std::unique_ptr<post_hook_t>> color_hooks;
+    std::map<post_hook_t*, post_color_effect_t*> color_effects;
+    /* The fused programs, by the list of effects they were generated from */
+    std::map<std::vector<post_color_effect_t*>, std::unique_ptr<OpenGL::program_t>> fused_programs;
+
     output_t *output;
     uint32_t output_width, output_height;
+
+    /* Releases the buffers when no effects have been active for a while */
+    OpenGL::reclaimable_buffer_t reclaim_post_buffers{[this] ()
+        {
+            OpenGL::render_begin();
+            for (auto& buffer : post_buffers)
+            {
+                buffer.release();
+            }
+
+            OpenGL::render_end();
+        }
+    };
+
     postprocessing_manager_t(output_t *output)
     {
         this->output = output;
     }
 
+    ~postprocessing_manager_t()
+    {
+        OpenGL::render_begin();
+        for (auto& [effects, program] : fused_programs)
+        {
+            program->free_resources();
+        }
+
+        OpenGL::render_end();
+    }
+
     void workaround_wlroots_backend_y_invert(wf::render_target_t& fb) const
     {
         /* Sometimes, the framebuffer by OpenGL is Y-inverted.
@@ -560,9 +932,11 @@ struct postprocessing_manager_t
         output_width  = width;
         output_height = height;
 
+        OpenGL::gpu_memory_scope_t memory_scope{[] () { return OpenGL::gpu_memory_owner_t{"postprocessing"}; }};
         OpenGL::render_begin();
         post_buffers[default_out_buffer].allocate(width, height);
         OpenGL::render_end();
+        reclaim_post_buffers.mark_used();
     }
 
     void add_post(post_hook_t *hook)
@@ -577,99 +951,341 @@ struct postprocessing_manager_t
         output->render->damage_whole_idle();
     }
 
-    /* Run all postprocessing effects, rendering to alternating buffers and
-     * finally to the screen.
-     *
-     * NB: 2 buffers just aren't enough. We render to the zero buffer, and then
-     * we alternately render to the second and the third. The reason: We track
-     * damage. So, we need to keep the whole buffer each frame. */
-    void run_post_effects()
+    void add_post(post_color_effect_t *effect)
     {
-        wf::framebuffer_t default_framebuffer;
-        default_framebuffer.fb  = output_fb;
-        default_framebuffer.tex = 0;
-
-        int last_buffer_idx = default_out_buffer;
-        int next_buffer_idx = 1;
-
-        post_effects.for_each([&] (auto post) -> void
+        if (color_hooks.count(effect))
         {
-            /* The last postprocessing hook renders directly to the screen, others to
-             * the currently free buffer */
-            wf::framebuffer_t& next_buffer =
-                (post == post_effects.back() ? default_framebuffer :
-                    post_buffers[next_buffer_idx]);
-
-            OpenGL::render_begin();
-            /* Make sure we have the correct resolution */
-            next_buffer.allocate(output_width, output_height);
-            OpenGL::render_end();
-
-            (*post)(post_buffers[last_buffer_idx], next_buffer);
+            return;
+        }
 
-            last_buffer_idx  = next_buffer_idx;
-            next_buffer_idx ^= 0b11; // alternate 1 and 2
+        auto hook = std::make_unique<post_hook_t>([=] (const wf::framebuffer_t& source,
+                                                       const wf::framebuffer_t& destination)
+        {
+            run_color_effects({effect}, source, destination,
+                wlr_box{0, 0, destination.viewport_width, destination.viewport_height});
         });
+
+        color_effects[hook.get()] = effect;
+        add_post(hook.get());
+        color_hooks[effect] = std::move(hook);
     }
 
-    wf::render_target_t get_target_framebuffer() const
+    void rem_post(post_color_effect_t *effect)
     {
-        wf::render_target_t fb;
-        fb.geometry     = output->get_relative_geometry();
-        fb.wl_transform = output->handle->transform;
-        fb.transform    = get_output_matrix_from_transform(
-            (wl_output_transform)fb.wl_transform);
-        fb.scale = output->handle->scale;
-
-        if (post_effects.size())
-        {
-            fb.fb  = post_buffers[default_out_buffer].fb;
-            fb.tex = post_buffers[default_out_buffer].tex;
-        } else
+        auto it = color_hooks.find(effect);
+        if (it == color_hooks.end())
         {
-            fb.fb  = output_fb;
-            fb.tex = 0;
+            return;
         }
 
-        workaround_wlroots_backend_y_invert(fb);
-        fb.viewport_width  = output->handle->width;
-        fb.viewport_height = output->handle->height;
+        rem_post(it->second.get());
+        color_effects.erase(it->second.get());
+        color_hooks.erase(it);
 
-        return fb;
+        OpenGL::render_begin();
+        for (auto prog = fused_programs.begin(); prog != fused_programs.end();)
+        {
+            if (std::find(prog->first.begin(), prog->first.end(), effect) != prog->first.end())
+            {
+                prog->second->free_resources();
+                prog = fused_programs.erase(prog);
+            } else
+            {
+                ++prog;
+            }
+        }
+
+        OpenGL::render_end();
     }
 
-    bool can_scanout() const
+    static std::string get_color_effect_prefix(size_t index)
     {
-        return post_effects.size() == 0;
+        return "post_effect" + std::to_string(index);
     }
-};
 
-/**
- * Responsible for attaching depth buffers to framebuffers.
- * It keeps at most 3 depth buffers at any given time to conserve
- * resources.
- */
-class depth_buffer_manager_t
-{
-  public:
-    void ensure_depth_buffer(int fb, int width, int height)
-    {
-        /* If the backend doesn't have its own framebuffer, then the
-         * framebuffer is created with a depth buffer. */
-        if ((fb == 0) || (required_counter <= 0))
+    /* Generate a fragment shader which applies all the given color effects in order. */
+    static std::string generate_fused_shader(const std::vector<post_color_effect_t*>& effects)
+    {
+        std::string source = "#version 100\n"
+                             "varying highp vec2 uvpos;\n"
+                             "uniform sampler2D smp;\n"
+                             "uniform highp vec2 post_resolution;\n";
+        std::string warps;
+        std::string body;
+        for (size_t i = 0; i < effects.size(); i++)
+        {
+            const std::string prefix = get_color_effect_prefix(i);
+            std::string effect_source = effects[i]->source;
+            for (size_t pos = effect_source.find("EFFECT"); pos != std::string::npos;
+                 pos = effect_source.find("EFFECT", pos + prefix.length()))
+            {
+                effect_source.replace(pos, 6, prefix);
+            }
+
+            source += effect_source + "\n";
+            body   += "    color = " + prefix + "(color);\n";
+            if (effects[i]->warp)
+            {
+                // Each warp takes pixels from the image produced by the effects before it, so the position
+                // is passed through the warps in reverse order. The color effects commute with warps.
+                warps = "    pos = " + prefix + "_warp(pos);\n" + warps;
+            }
+        }
+
+        source += "void main()\n{\n";
+        if (warps.empty())
         {
-            return;
+            source += "    mediump vec4 color = texture2D(smp, uvpos);\n";
+        } else
+        {
+            source += "    highp vec2 pos = uvpos * post_resolution;\n";
+            source += warps;
+            source += "    mediump vec4 color = texture2D(smp, pos / post_resolution);\n";
         }
 
-        attach_buffer(find_buffer(fb), fb, width, height);
+        source += body;
+        source += "    gl_FragColor = color;\n}\n";
+        return source;
     }
 
-    void set_required(bool require)
+    /* Run the given color effects in a single pass with a fused shader, limited to the given damage in
+     * framebuffer coordinates. */
+    void run_color_effects(const std::vector<post_color_effect_t*>& effects,
+        const wf::framebuffer_t& source, const wf::framebuffer_t& destination, const wf::region_t& damage)
+    {
+        static const float vertex_data[] = {
+            -1.0f, -1.0f,
+            1.0f, -1.0f,
+            1.0f, 1.0f,
+            -1.0f, 1.0f
+        };
+
+        static const float coord_data[] = {
+            0.0f, 0.0f,
+            1.0f, 0.0f,
+            1.0f, 1.0f,
+            0.0f, 1.0f
+        };
+
+        OpenGL::render_begin(destination);
+        auto& program = fused_programs[effects];
+        if (!program)
+        {
+            program = std::make_unique<OpenGL::program_t>();
+            program->set_simple(OpenGL::compile_program(post_color_vertex_shader,
+                generate_fused_shader(effects)));
+        }
+
+        program->use(wf::TEXTURE_TYPE_RGBA);
+        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, source.tex));
+        program->attrib_pointer("position", 2, 0, vertex_data);
+        program->attrib_pointer("uvPosition", 2, 0, coord_data);
+        if (std::any_of(effects.begin(), effects.end(), [] (auto effect) { return effect->warp; }))
+        {
+            program->uniform2f("post_resolution", destination.viewport_width, destination.viewport_height);
+        }
+
+        for (size_t i = 0; i < effects.size(); i++)
+        {
+            if (effects[i]->set_uniforms)
+            {
+                effects[i]->set_uniforms(*program, get_color_effect_prefix(i));
+            }
+        }
+
+        GL_CALL(glDisable(GL_BLEND));
+        for (const auto& rect : damage)
+        {
+            destination.scissor(wlr_box_from_pixman_box(rect));
+            GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+        }
+
+        GL_CALL(glEnable(GL_BLEND));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        program->deactivate();
+        OpenGL::render_end();
+    }
+
+    /**
+     * Whether all post effects are color effects. In this case, each output pixel depends only on the same
+     * pixel of the zero buffer (or on the pixels of a warp area, which its effect damages as a whole), which
+     * is kept between frames, so only the damaged parts of the output have to be processed again.
+     */
+    bool is_pointwise()
+    {
+        return post_effects.size() && (color_effects.size() == post_effects.size());
+    }
+
+    /* Run all postprocessing effects, rendering to alternating buffers and
+     * finally to the screen. Consecutive color effects are fused into a
+     * single pass.
+     *
+     * NB: 2 buffers just aren't enough. We render to the zero buffer, and then
+     * we alternately render to the second and the third. The reason: We track
+     * damage. So, we need to keep the whole buffer each frame.
+     *
+     * @param swap_damage The damage of the output buffer. If the effects are
+     *   pointwise, only this region is processed. */
+    void run_post_effects(const wf::region_t& swap_damage)
+    {
+        WF_TRACE_ZONE("postprocess");
+        wf::framebuffer_t default_framebuffer;
+        default_framebuffer.fb  = output_fb;
+        default_framebuffer.tex = 0;
+
+        /* Each pass is either a post hook, or a list of color effects */
+        std::vector<std::pair<post_hook_t*, std::vector<post_color_effect_t*>>> passes;
+        post_effects.for_each([&] (auto post) -> void
+        {
+            auto it = color_effects.find(post);
+            if (it == color_effects.end())
+            {
+                passes.push_back({post, {}});
+            } else if (!passes.empty() && !passes.back().first)
+            {
+                passes.back().second.push_back(it->second);
+            } else
+            {
+                passes.push_back({nullptr, {it->second}});
+            }
+        });
+
+        int last_buffer_idx = default_out_buffer;
+        int next_buffer_idx = 1;
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            /* The last pass renders directly to the screen, others to
+             * the currently free buffer */
+            wf::framebuffer_t& next_buffer =
+                (i + 1 == passes.size() ? default_framebuffer : post_buffers[next_buffer_idx]);
+
+            OpenGL::gpu_memory_scope_t memory_scope{[] ()
+            {
+                return OpenGL::gpu_memory_owner_t{"postprocessing"};
+            }};
+            OpenGL::render_begin();
+            /* Make sure we have the correct resolution */
+            next_buffer.allocate(output_width, output_height);
+            OpenGL::render_end();
+
+            if (passes[i].first)
+            {
+                (*passes[i].first)(post_buffers[last_buffer_idx], next_buffer);
+            } else
+            {
+                run_color_effects(passes[i].second, post_buffers[last_buffer_idx], next_buffer,
+                    (passes.size() == 1) ? get_framebuffer_damage(swap_damage) :
+                    wf::region_t{wlr_box{0, 0, next_buffer.viewport_width, next_buffer.viewport_height}});
+            }
+
+            last_buffer_idx  = next_buffer_idx;
+            next_buffer_idx ^= 0b11; // alternate 1 and 2
+        }
+    }
+
+    /* Convert damage in output coordinates (scaled, as in the swap damage) to framebuffer coordinates. */
+    wf::region_t get_framebuffer_damage(const wf::region_t& damage) const
+    {
+        auto target = get_target_framebuffer();
+        wlr_output_transformed_resolution(output->handle, &target.geometry.width, &target.geometry.height);
+        target.scale = 1;
+        return target.framebuffer_region_from_geometry_region(damage);
+    }
+
+    wf::render_target_t get_target_framebuffer() const
+    {
+        wf::render_target_t fb;
+        fb.geometry     = output->get_relative_geometry();
+        fb.wl_transform = output->handle->transform;
+        fb.transform    = get_output_matrix_from_transform(
+            (wl_output_transform)fb.wl_transform);
+        fb.scale = output->handle->scale;
+
+        if (post_effects.size())
+        {
+            fb.fb  = post_buffers[default_out_buffer].fb;
+            fb.tex = post_buffers[default_out_buffer].tex;
+        } else
+        {
+            fb.fb  = output_fb;
+            fb.tex = 0;
+        }
+
+        workaround_wlroots_backend_y_invert(fb);
+        fb.viewport_width  = output->handle->width;
+        fb.viewport_height = output->handle->height;
+
+        return fb;
+    }
+
+    bool can_scanout() const
+    {
+        return post_effects.size() == 0;
+    }
+};
+
+/**
+ * Responsible for attaching depth buffers to the framebuffers of an output.
+ *
+ * The swapchain cycles through several framebuffers, so each of them keeps its depth buffer attached for as
+ * long as depth buffers are required, instead of sharing a few buffers which are reattached every frame.
+ * The buffers of framebuffers which are no longer rendered to (e.g. after the swapchain was recreated) and
+ * all buffers once they are not required anymore are given back to the framebuffer pool, where buffers of
+ * the same size are picked up again by this or another output.
+ *
+ * Which buffer is attached to which framebuffer is tracked here, instead of being queried from GL: GLES2 does
+ * not allow querying the name of a missing attachment.
+ */
+class depth_buffer_manager_t
+{
+  public:
+    /**
+     * @param owner The buffer which owns @fb, if any. Its framebuffer is destroyed together with it, and the
+     *   name may be reused by a new framebuffer which does not have the depth buffer attached.
+     */
+    void ensure_depth_buffer(int fb, int width, int height, wlr_buffer *owner)
+    {
+        /* If the backend doesn't have its own framebuffer, then the
+         * framebuffer is created with a depth buffer. */
+        if ((fb == 0) || (required_counter <= 0))
+        {
+            return;
+        }
+
+        ++frame;
+        release_stale_buffers();
+
+        auto& buffer = buffers[fb];
+        if ((buffer.width != width) || (buffer.height != height))
+        {
+            attach_buffer(buffer, fb, width, height);
+        }
+
+        if (owner && !buffer.on_owner_destroy.is_connected())
+        {
+            buffer.on_owner_destroy.set_callback([this, fb] (void*)
+            {
+                // The framebuffer goes away together with its depth attachment.
+                auto it = buffers.find(fb);
+                OpenGL::render_begin();
+                OpenGL::release_depth_texture(it->second.tex, it->second.width, it->second.height);
+                OpenGL::render_end();
+                buffers.erase(it);
+            });
+            buffer.on_owner_destroy.connect(&owner->events.destroy);
+        }
+
+        buffer.last_used = frame;
+        reclaim_depth_buffers.mark_used();
+    }
+
+    void set_required(bool require)
     {
         required_counter += require ? 1 : -1;
         if (required_counter <= 0)
         {
-            free_all_buffers();
+            release_all_buffers();
         }
     }
 
@@ -677,7 +1293,7 @@ class depth_buffer_manager_t
 
     ~depth_buffer_manager_t()
     {
-        free_all_buffers();
+        release_all_buffers();
     }
 
     depth_buffer_manager_t(const depth_buffer_manager_t &) = delete;
@@ -686,97 +1302,99 @@ class depth_buffer_manager_t
     depth_buffer_manager_t& operator =(depth_buffer_manager_t&&) = delete;
 
   private:
-    static constexpr size_t MAX_BUFFERS = 3;
+    /* Release the buffer of a framebuffer which has not been rendered to for this many frames */
+    static constexpr uint64_t STALE_FRAMES = 16;
     int required_counter = 0;
+    uint64_t frame = 0;
 
     struct depth_buffer_t
     {
         GLuint tex = -1;
-        int attached_to = -1;
         int width  = 0;
         int height = 0;
 
-        int64_t last_used = 0;
+        uint64_t last_used = 0;
+        wf::wl_listener_wrapper on_owner_destroy;
     };
 
-    void free_buffer(depth_buffer_t& buffer)
+    /* Binds a framebuffer and restores the previous binding when it goes out of scope, so that attaching
+     * and detaching buffers does not change the framebuffer which the current frame is rendered to. */
+    struct scoped_framebuffer_binding_t
     {
-        if (buffer.tex != (GLuint) - 1)
+        GLint previous = 0;
+        scoped_framebuffer_binding_t(int fb)
         {
-            GL_CALL(glDeleteTextures(1, &buffer.tex));
+            GL_CALL(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous));
+            GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb));
         }
-    }
 
-    void free_all_buffers()
-    {
-        OpenGL::render_begin();
-        for (auto& b : buffers)
+        ~scoped_framebuffer_binding_t()
         {
-            free_buffer(b);
+            GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, previous));
         }
+    };
 
-        OpenGL::render_end();
-    }
+    /* Frees the buffers when nothing has needed them for a while */
+    OpenGL::reclaimable_buffer_t reclaim_depth_buffers{[this] () { release_all_buffers(); }};
 
-    void attach_buffer(depth_buffer_t& buffer, int fb, int width, int height)
+    void release_buffer(int fb, depth_buffer_t& buffer)
     {
-        if ((buffer.attached_to == fb) &&
-            (buffer.width == width) &&
-            (buffer.height == height))
+        if (buffer.tex == (GLuint) - 1)
         {
             return;
         }
 
-        free_buffer(buffer);
-        GL_CALL(glGenTextures(1, &buffer.tex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, buffer.tex));
-        GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-            width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL));
-        buffer.width  = width;
-        buffer.height = height;
-
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, buffer.tex));
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb));
-        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-            GL_TEXTURE_2D, buffer.tex, 0));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        /* The texture may be attached to another framebuffer once it is back in the pool */
+        if (glIsFramebuffer(fb))
+        {
+            scoped_framebuffer_binding_t binding{fb};
+            GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0));
+        }
 
-        buffer.attached_to = fb;
-        buffer.last_used   = get_current_time();
+        OpenGL::release_depth_texture(buffer.tex, buffer.width, buffer.height);
+        buffer.tex = -1;
     }
 
-    depth_buffer_t& find_buffer(int fb)
+    void release_all_buffers()
     {
-        for (auto& buffer : buffers)
+        OpenGL::render_begin();
+        for (auto& [fb, buffer] : buffers)
         {
-            if (buffer.attached_to == fb)
-            {
-                return buffer;
-            }
+            release_buffer(fb, buffer);
         }
 
-        /** New buffer? */
-        if (buffers.size() < MAX_BUFFERS)
-        {
-            buffers.push_back(depth_buffer_t{});
-
-            return buffers.back();
-        }
+        buffers.clear();
+        OpenGL::render_end();
+    }
 
-        /** Evict oldest */
-        auto oldest = &buffers.front();
-        for (auto& buffer : buffers)
+    void release_stale_buffers()
+    {
+        for (auto it = buffers.begin(); it != buffers.end();)
         {
-            if (buffer.last_used < oldest->last_used)
+            if (frame - it->second.last_used > STALE_FRAMES)
             {
-                oldest = &buffer;
+                release_buffer(it->first, it->second);
+                it = buffers.erase(it);
+            } else
+            {
+                ++it;
             }
         }
+    }
 
-        return *oldest;
+    void attach_buffer(depth_buffer_t& buffer, int fb, int width, int height)
+    {
+        release_buffer(fb, buffer);
+        buffer.tex    = OpenGL::allocate_depth_texture(width, height);
+        buffer.width  = width;
+        buffer.height = height;
+
+        scoped_framebuffer_binding_t binding{fb};
+        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+            GL_TEXTURE_2D, buffer.tex, 0));
     }
 
-    std::vector<depth_buffer_t> buffers;
+    std::map<int, depth_buffer_t> buffers;
 };
 
 /**
@@ -807,6 +1425,11 @@ class depth_buffer_manager_t
  * delay is increased by one. If the next frame is delayed, then
  * `increase_window` is doubled, otherwise, it is halved
  * (but it must stay between `MIN_INCREASE_WINDOW` and `MAX_INCREASE_WINDOW`).
+ *
+ * Alternatively, with core/repaint_scheduling set to `predictive`, the time
+ * needed to paint and commit a frame is estimated from the previous frames
+ * (moving average plus deviation), and painting starts so that the commit
+ * happens shortly before the next predicted vblank.
  */
 struct repaint_delay_manager_t
 {
@@ -816,8 +1439,15 @@ struct repaint_delay_manager_t
         {
             auto ev = static_cast<wlr_output_event_present*>(data);
             this->refresh_nsec = ev->refresh;
+            if (ev->presented && ev->when)
+            {
+                this->last_present_us = wf::timespec_to_usec(*ev->when);
+            }
         });
         on_present.connect(&output->handle->events.present);
+
+        update_scheduling_mode();
+        repaint_scheduling.set_callback([=] () { update_scheduling_mode(); });
     }
 
     /**
@@ -835,6 +1465,12 @@ struct repaint_delay_manager_t
      */
     void start_frame()
     {
+        if (is_predictive())
+        {
+            update_predictive_delay();
+            return;
+        }
+
         if (last_pageflip == -1)
         {
             last_pageflip = get_current_time();
@@ -878,66 +1514,594 @@ struct repaint_delay_manager_t
                     MIN_INCREASE_WINDOW, MAX_INCREASE_WINDOW);
             }
 
-            reset_increase_timer();
-        }
+            reset_increase_timer();
+        }
+
+        last_pageflip = get_current_time();
+    }
+
+    /**
+     * @return The delay in milliseconds for the current frame.
+     */
+    int get_delay()
+    {
+        return delay;
+    }
+
+    /**
+     * A frame was painted. Painting started at @paint_start and the output was committed at @paint_end
+     * (both in microseconds, CLOCK_MONOTONIC). Used to refine the render time estimate of the predictive
+     * scheduling policy.
+     */
+    void frame_painted(int64_t paint_start, int64_t paint_end)
+    {
+        const int64_t duration = paint_end - paint_start;
+        if (render_samples == 0)
+        {
+            render_estimate  = duration;
+            render_deviation = duration / 2;
+        } else
+        {
+            // React quickly when frames get more expensive (e.g. an effect starts), but decrease the
+            // estimate slowly, so that a few cheap frames do not cause a missed vblank.
+            const double alpha = (duration > render_estimate) ? EWMA_ALPHA_UP : EWMA_ALPHA_DOWN;
+            render_deviation = (1 - alpha) * render_deviation + alpha * std::abs(duration - render_estimate);
+            render_estimate  = (1 - alpha) * render_estimate + alpha * duration;
+        }
+
+        ++render_samples;
+        if (target_vblank_us >= 0)
+        {
+            last_margin_us    = target_vblank_us - paint_end;
+            average_margin_us = (1 - EWMA_ALPHA_DOWN) * average_margin_us + EWMA_ALPHA_DOWN * last_margin_us;
+            late_frames += (last_margin_us < 0);
+            target_vblank_us = -1;
+        }
+    }
+
+    void fill_stats(frame_stats_t& stats) const
+    {
+        stats.repaint_delay = delay;
+        stats.predicted_render_us = is_predictive() ? predicted_render_us : 0;
+        stats.last_margin_us    = last_margin_us;
+        stats.average_margin_us = average_margin_us;
+        stats.late_frames = late_frames;
+    }
+
+  private:
+    int delay = 0;
+
+    bool is_predictive() const
+    {
+        return predictive;
+    }
+
+    void update_scheduling_mode()
+    {
+        predictive = (repaint_scheduling.value() == "predictive");
+    }
+
+    /**
+     * Compute the delay for the predictive policy: start painting as late as possible, so that the frame is
+     * committed just before the next vblank, according to the estimated render time.
+     */
+    void update_predictive_delay()
+    {
+        const int64_t now = wf::get_current_time_us();
+        const int64_t refresh_us = refresh_nsec / 1000;
+        if ((refresh_us <= 0) || (last_present_us < 0) || (render_samples < MIN_RENDER_SAMPLES))
+        {
+            // Not enough information yet, paint immediately.
+            delay = 0;
+            target_vblank_us = -1;
+            return;
+        }
+
+        int64_t next_vblank = last_present_us + refresh_us;
+        if (next_vblank <= now)
+        {
+            next_vblank += ((now - next_vblank) / refresh_us + 1) * refresh_us;
+        }
+
+        predicted_render_us = render_estimate + 4 * render_deviation + SAFETY_MARGIN_US;
+        const int64_t slack = next_vblank - now - predicted_render_us;
+        delay = clamp(slack / 1000, (int64_t)0, std::max(refresh_us / 1000 - 1, (int64_t)0));
+        target_vblank_us = next_vblank;
+    }
+
+    void update_delay(int delta)
+    {
+        int config_delay = std::max(0,
+            (int)(this->refresh_nsec / 1e6) - max_render_time);
+
+        int min = 0;
+        int max = config_delay;
+        if (max_render_time == -1)
+        {
+            max = 0;
+        } else if (!dynamic_delay)
+        {
+            min = config_delay;
+            max = config_delay;
+        }
+
+        delay = clamp(delay + delta, min, max);
+    }
+
+    void reset_increase_timer()
+    {
+        last_increase = get_current_time();
+    }
+
+    static constexpr int64_t MIN_INCREASE_WINDOW = 200; // 200 ms
+    static constexpr int64_t MAX_INCREASE_WINDOW = 30'000; // 30s
+    int64_t increase_window = MIN_INCREASE_WINDOW;
+    int64_t last_increase   = 0;
+
+    // > 0 => Increase increase_window
+    int64_t expand_inc_window_on_miss = 0;
+
+    // Expontential decrease in case of missed frames
+    int32_t consecutive_decrease = 1;
+
+    // Time of last frame
+    int64_t last_pageflip = -1; // -1 is invalid
+
+    int64_t refresh_nsec = 0;
+    wf::cached_option_t<int> max_render_time{"core/max_render_time"};
+    wf::cached_option_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+    wf::cached_option_t<std::string> repaint_scheduling{"core/repaint_scheduling"};
+    // Parsed from repaint_scheduling when it changes, so that it is not compared on every frame.
+    bool predictive = false;
+
+    // State of the predictive policy. All times are in microseconds.
+    static constexpr int64_t SAFETY_MARGIN_US = 1000;
+    static constexpr int64_t MIN_RENDER_SAMPLES = 10;
+    static constexpr double EWMA_ALPHA_UP   = 0.5;
+    static constexpr double EWMA_ALPHA_DOWN = 0.05;
+
+    int64_t last_present_us = -1;
+    int64_t render_samples  = 0;
+    double render_estimate  = 0;
+    double render_deviation = 0;
+    int64_t predicted_render_us = 0;
+
+    // The vblank the current frame is scheduled for, -1 if unknown.
+    int64_t target_vblank_us  = -1;
+    int64_t last_margin_us    = 0;
+    double average_margin_us  = 0;
+    uint64_t late_frames = 0;
+
+    wf::wl_listener_wrapper on_present;
+};
+
+/**
+ * Manages rendering on outputs with adaptive sync (VRR) enabled, if core/vrr_on_demand_rendering is set.
+ *
+ * With adaptive sync, the display refreshes as soon as a new frame is committed (within the refresh range of
+ * the display), so waiting for a fixed repaint delay only adds latency. Instead, frames are painted as soon as
+ * they are requested, e.g. when a fullscreen client commits.
+ *
+ * Frames requested while painting are driven by the compositor itself (animations, constant redraw), and
+ * would otherwise make the display run at its maximal refresh rate. They are limited to
+ * core/vrr_animation_fps. The limit is never below core/vrr_min_refresh, the bottom of the display's refresh
+ * range, so that the driver does not have to fall back to low framerate compensation (repeating frames)
+ * in the middle of an animation.
+ */
+struct vrr_frame_limiter_t
+{
+    vrr_frame_limiter_t(wf::output_t *output) : output(output)
+    {}
+
+    /**
+     * Whether the output currently uses on-demand rendering.
+     */
+    bool is_active() const
+    {
+        return (vrr_on_demand_rendering || content_on_demand) &&
+               (output->handle->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED);
+    }
+
+    /**
+     * Use on-demand rendering even without core/vrr_on_demand_rendering, because the content of the output
+     * benefits from it (see content_type_manager_t).
+     */
+    bool content_on_demand = false;
+
+    /**
+     * A frame started painting.
+     */
+    void frame_started()
+    {
+        last_frame_us = wf::get_current_time_us();
+        // Compositor-driven frames which are still waiting will be requested again while painting.
+        throttle_timer.disconnect();
+    }
+
+    /**
+     * Schedule a compositor-driven frame, no earlier than allowed by the animation rate limit.
+     */
+    void schedule_animation_frame(std::function<void()> schedule)
+    {
+        if (throttle_timer.is_connected())
+        {
+            return;
+        }
+
+        const int64_t interval = get_min_frame_interval_us();
+        const int64_t elapsed  = wf::get_current_time_us() - last_frame_us;
+        if ((interval <= 0) || (last_frame_us < 0) || (elapsed >= interval))
+        {
+            schedule();
+            return;
+        }
+
+        // Round up, so that the frame is not started a bit too early.
+        const uint32_t delay_ms = (interval - elapsed + 999) / 1000;
+        throttle_timer.set_timeout(delay_ms, schedule);
+    }
+
+  private:
+    wf::output_t *output;
+    int64_t last_frame_us = -1;
+    wf::wl_timer<false> throttle_timer;
+
+    wf::cached_option_t<bool> vrr_on_demand_rendering{"core/vrr_on_demand_rendering"};
+    wf::cached_option_t<int> vrr_animation_fps{"core/vrr_animation_fps"};
+    wf::cached_option_t<int> vrr_min_refresh{"core/vrr_min_refresh"};
+
+    /**
+     * The minimal time between two compositor-driven frames, 0 if not limited.
+     */
+    int64_t get_min_frame_interval_us() const
+    {
+        int fps = vrr_animation_fps;
+        if (fps <= 0)
+        {
+            return 0;
+        }
+
+        fps = std::max(fps, (int)vrr_min_refresh);
+        if (output->handle->refresh > 0)
+        {
+            // Limiting to more than the maximal refresh rate has no effect.
+            const int max_fps = output->handle->refresh / 1000;
+            if (fps >= max_fps)
+            {
+                return 0;
+            }
+        }
+
+        return 1'000'000 / fps;
+    }
+};
+
+/**
+ * Get the p-th percentile of a non-empty list of samples. The samples are reordered.
+ */
+static int64_t percentile(std::vector<int64_t>& samples, double p)
+{
+    size_t idx = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+/**
+ * The frame profiler records how long the different stages of painting an output take.
+ *
+ * The last FRAME_HISTORY frames are stored in a fixed-size ring buffer, so recording a frame never allocates
+ * and never blocks. CPU times are measured with a monotonic clock. GPU times are measured with timer queries
+ * if GL_EXT_disjoint_timer_query is supported. Their results become available only a few frames later, so
+ * they are written back to the frame's slot once the query has finished.
+ */
+struct frame_profiler_t
+{
+    static constexpr size_t FRAME_HISTORY = 512;
+    static constexpr size_t MAX_PENDING_QUERIES = 4;
+    // From GL_EXT_disjoint_timer_query
+    static constexpr GLenum TIME_ELAPSED_QUERY = 0x88BF;
+    static constexpr GLenum GPU_DISJOINT_QUERY = 0x8FBB;
+    using clock = std::chrono::steady_clock;
+
+    ~frame_profiler_t()
+    {
+        if (gpu_timer_supported)
+        {
+            OpenGL::render_begin();
+            for (auto& query : queries)
+            {
+                GL_CALL(glDeleteQueries(1, &query.id));
+            }
+
+            OpenGL::render_end();
+        }
+    }
+
+    /**
+     * Start measuring a new frame. Must be followed by either end_frame() or discard_frame().
+     */
+    void start_frame()
+    {
+        current = {};
+        std::fill(std::begin(current.stage_us), std::end(current.stage_us), -1);
+        current.seq = next_seq;
+        last_mark   = clock::now();
+    }
+
+    /**
+     * Record the time since the previous mark (or the frame start) for the given stage.
+     */
+    void mark(frame_stage_t stage)
+    {
+        auto now = clock::now();
+        current.stage_us[stage] = to_us(now - last_mark);
+        last_mark = now;
+    }
+
+    /**
+     * Directly set the time for the given stage, for stages which are measured elsewhere.
+     */
+    void set_stage(frame_stage_t stage, int64_t us)
+    {
+        current.stage_us[stage] = us;
+    }
+
+    /**
+     * The frame was not rendered, do not record it.
+     */
+    void discard_frame()
+    {
+        current.seq = 0;
+    }
+
+    void end_frame()
+    {
+        if (current.seq == 0)
+        {
+            return;
+        }
+
+        history[current.seq % FRAME_HISTORY] = current;
+        ++next_seq;
+        current.seq = 0;
+    }
+
+    /**
+     * Start a GPU timer query for the current frame. The output's GL context must be current.
+     */
+    void begin_gpu_timer()
+    {
+        check_gpu_timer_support();
+        if (!gpu_timer_supported)
+        {
+            return;
+        }
+
+        collect_gpu_results();
+        active_query = nullptr;
+        for (auto& query : queries)
+        {
+            if (!query.pending)
+            {
+                active_query = &query;
+                break;
+            }
+        }
+
+        if (!active_query)
+        {
+            // All queries are still in flight, skip GPU measurement for this frame.
+            return;
+        }
+
+        if (active_query->id == 0)
+        {
+            GL_CALL(glGenQueries(1, &active_query->id));
+        }
+
+        GL_CALL(glBeginQuery(TIME_ELAPSED_QUERY, active_query->id));
+    }
+
+    void end_gpu_timer()
+    {
+        if (!active_query)
+        {
+            return;
+        }
+
+        GL_CALL(glEndQuery(TIME_ELAPSED_QUERY));
+        active_query->pending = true;
+        active_query->seq     = current.seq;
+        active_query = nullptr;
+    }
+
+    frame_stats_t get_stats() const
+    {
+        frame_stats_t stats;
+        stats.total_frames = next_seq - 1;
+        stats.gpu_timer_supported = gpu_timer_supported;
+
+        std::vector<int64_t> samples;
+        samples.reserve(FRAME_HISTORY);
+        for (int stage = 0; stage < FRAME_STAGE_TOTAL; stage++)
+        {
+            samples.clear();
+            for (auto& frame : history)
+            {
+                if ((frame.seq != 0) && (frame.stage_us[stage] >= 0))
+                {
+                    samples.push_back(frame.stage_us[stage]);
+                }
+            }
+
+            auto& result = stats.stages[stage];
+            result.samples = samples.size();
+            if (samples.empty())
+            {
+                continue;
+            }
+
+            result.p50 = percentile(samples, 0.50);
+            result.p95 = percentile(samples, 0.95);
+            result.p99 = percentile(samples, 0.99);
+            result.max = *std::max_element(samples.begin(), samples.end());
+        }
+
+        return stats;
+    }
+
+  private:
+    struct frame_record_t
+    {
+        // 0 means the slot is unused.
+        uint64_t seq = 0;
+        int64_t stage_us[FRAME_STAGE_TOTAL];
+    };
+
+    struct gpu_query_t
+    {
+        GLuint id    = 0;
+        bool pending = false;
+        uint64_t seq = 0;
+    };
+
+    std::array<frame_record_t, FRAME_HISTORY> history;
+    frame_record_t current;
+    uint64_t next_seq = 1;
+    clock::time_point last_mark;
+
+    bool gpu_timer_checked   = false;
+    bool gpu_timer_supported = false;
+    std::array<gpu_query_t, MAX_PENDING_QUERIES> queries;
+    gpu_query_t *active_query = nullptr;
+
+    static int64_t to_us(clock::duration d)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    }
+
+    void check_gpu_timer_support()
+    {
+        if (gpu_timer_checked)
+        {
+            return;
+        }
+
+        gpu_timer_checked = true;
+        auto extensions = (const char*)glGetString(GL_EXTENSIONS);
+        gpu_timer_supported = extensions && strstr(extensions, "GL_EXT_disjoint_timer_query");
+        LOGC(RENDER, "GPU timer queries ", gpu_timer_supported ? "are" : "are not", " supported.");
+    }
+
+    void collect_gpu_results()
+    {
+        GLint disjoint = 0;
+        GL_CALL(glGetIntegerv(GPU_DISJOINT_QUERY, &disjoint));
+        for (auto& query : queries)
+        {
+            if (!query.pending)
+            {
+                continue;
+            }
+
+            GLuint available = 0;
+            GL_CALL(glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available));
+            if (!available)
+            {
+                continue;
+            }
+
+            GLuint elapsed_ns = 0;
+            GL_CALL(glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &elapsed_ns));
+            query.pending = false;
+
+            // If a disjoint operation happened (e.g. GPU frequency change), the result is meaningless.
+            auto& frame = history[query.seq % FRAME_HISTORY];
+            if (!disjoint && (frame.seq == query.seq))
+            {
+                frame.stage_us[FRAME_STAGE_GPU] = elapsed_ns / 1000;
+            }
+        }
+    }
+};
+
+/**
+ * Drives the frames of an output for throughput benchmarks, see render_manager::set_synthetic_frame_driver().
+ */
+struct synthetic_frame_driver_t
+{
+    // Enough for more than a minute at 1000 FPS, later intervals are counted but not sampled.
+    static constexpr size_t MAX_SAMPLES = 65536;
 
-        last_pageflip = get_current_time();
+    synthetic_frame_driver_t(int rate) : rate(std::max(rate, 0))
+    {
+        start_us = wf::get_current_time_us();
+        next_frame_us = start_us;
+        intervals.reserve(MAX_SAMPLES);
     }
 
     /**
-     * @return The delay in milliseconds for the current frame.
+     * A frame was painted and committed.
      */
-    int get_delay()
-    {
-        return delay;
-    }
-
-  private:
-    int delay = 0;
-
-    void update_delay(int delta)
+    void frame_painted()
     {
-        int config_delay = std::max(0,
-            (int)(this->refresh_nsec / 1e6) - max_render_time);
-
-        int min = 0;
-        int max = config_delay;
-        if (max_render_time == -1)
-        {
-            max = 0;
-        } else if (!dynamic_delay)
+        const int64_t now = wf::get_current_time_us();
+        if ((last_frame_us >= 0) && (intervals.size() < MAX_SAMPLES))
         {
-            min = config_delay;
-            max = config_delay;
+            intervals.push_back(now - last_frame_us);
         }
 
-        delay = clamp(delay + delta, min, max);
+        last_frame_us = now;
+        ++frames;
     }
 
-    void reset_increase_timer()
+    /**
+     * Schedule the next frame, by calling @tick once it is due.
+     */
+    void schedule(std::function<void()> tick)
     {
-        last_increase = get_current_time();
-    }
-
-    static constexpr int64_t MIN_INCREASE_WINDOW = 200; // 200 ms
-    static constexpr int64_t MAX_INCREASE_WINDOW = 30'000; // 30s
-    int64_t increase_window = MIN_INCREASE_WINDOW;
-    int64_t last_increase   = 0;
+        if (rate == 0)
+        {
+            // Give clients a chance to run between frames.
+            idle_tick.run_once(tick);
+            return;
+        }
 
-    // > 0 => Increase increase_window
-    int64_t expand_inc_window_on_miss = 0;
+        // Keep a steady rate, even if the timer fires late.
+        const int64_t now = wf::get_current_time_us();
+        next_frame_us = std::max(next_frame_us + 1'000'000 / rate, now);
+        timer_tick.set_timeout((next_frame_us - now) / 1000, tick);
+    }
 
-    // Expontential decrease in case of missed frames
-    int32_t consecutive_decrease = 1;
+    synthetic_frame_stats_t get_stats() const
+    {
+        synthetic_frame_stats_t stats;
+        stats.running  = true;
+        stats.rate     = rate;
+        stats.frames   = frames;
+        stats.duration = wf::get_current_time_us() - start_us;
+        stats.fps = (stats.duration > 0) ? frames * 1e6 / stats.duration : 0;
+        if (!intervals.empty())
+        {
+            auto samples = intervals;
+            stats.interval_p50 = percentile(samples, 0.50);
+            stats.interval_p95 = percentile(samples, 0.95);
+            stats.interval_p99 = percentile(samples, 0.99);
+            stats.interval_max = *std::max_element(samples.begin(), samples.end());
+        }
 
-    // Time of last frame
-    int64_t last_pageflip = -1; // -1 is invalid
+        return stats;
+    }
 
-    int64_t refresh_nsec;
-    wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
-    wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+    const int rate;
+    int64_t start_us;
+    int64_t next_frame_us;
+    int64_t last_frame_us = -1;
+    uint64_t frames = 0;
+    std::vector<int64_t> intervals;
 
-    wf::wl_listener_wrapper on_present;
+    wf::wl_idle_call idle_tick;
+    wf::wl_timer<false> timer_tick;
 };
 
 class wf::render_manager::impl
@@ -948,13 +2112,21 @@ class wf::render_manager::impl
 
     output_t *output;
     wf::region_t swap_damage;
+    // Heap allocations during the last painted frame, see wf::get_heap_allocation_count().
+    int64_t last_frame_allocations = -1;
+    // Whether the last frame was directly scanned out.
+    bool last_frame_scanout = false;
     std::unique_ptr<swapchain_damage_manager_t> damage_manager;
     std::unique_ptr<effect_hook_manager_t> effects;
     std::unique_ptr<postprocessing_manager_t> postprocessing;
     std::unique_ptr<depth_buffer_manager_t> depth_buffer_manager;
     std::unique_ptr<repaint_delay_manager_t> delay_manager;
+    std::unique_ptr<vrr_frame_limiter_t> vrr_limiter;
+    std::unique_ptr<frame_profiler_t> profiler;
+    std::unique_ptr<synthetic_frame_driver_t> synthetic_driver;
+    bool first_frame_committed = false;
 
-    wf::option_wrapper_t<wf::color_t> background_color_opt;
+    wf::cached_option_t<wf::color_t> background_color_opt;
 
     impl(output_t *o) : output(o), env_allow_scanout(check_scanout_enabled())
     {
@@ -963,6 +2135,8 @@ class wf::render_manager::impl
         postprocessing = std::make_unique<postprocessing_manager_t>(o);
         depth_buffer_manager = std::make_unique<depth_buffer_manager_t>();
         delay_manager = std::make_unique<repaint_delay_manager_t>(o);
+        vrr_limiter   = std::make_unique<vrr_frame_limiter_t>(o);
+        profiler = std::make_unique<frame_profiler_t>();
 
         on_frame.set_callback([&] (void*)
         {
@@ -973,9 +2147,19 @@ class wf::render_manager::impl
                 return;
             }
 
+            // Outputs in DPMS are disabled, nothing would be shown, so do not render or drive animations
+            // and clients. Rendering resumes with a full repaint when the output is inhibited no more.
+            if (!output->handle->enabled)
+            {
+                return;
+            }
+
             delay_manager->start_frame();
 
-            auto repaint_delay = delay_manager->get_delay();
+            // With adaptive sync or async page flips, the display waits for us, so any delay only adds latency.
+            // Games also want the lowest latency.
+            auto repaint_delay = (vrr_limiter->is_active() || synthetic_driver || is_tearing() ||
+                (get_content_type() == content_type_t::GAME)) ? 0 : delay_manager->get_delay();
             // Leave a bit of time for clients to render, see
             // https://github.com/swaywm/sway/pull/4588
             if (repaint_delay < 1)
@@ -1007,6 +2191,38 @@ class wf::render_manager::impl
         damage_manager->schedule_repaint();
     }
 
+    ~impl()
+    {
+        if (auto feedback = wf::get_core_impl().dmabuf_feedback.get())
+        {
+            feedback->remove_output(output);
+        }
+
+        if (auto tearing_control = wf::get_core_impl().tearing_control.get())
+        {
+            tearing_control->remove_output(output);
+        }
+
+        if (auto content_type = wf::get_core_impl().content_type.get())
+        {
+            content_type->remove_output(output);
+        }
+    }
+
+    /** @return The content type of the surface which covered the output in the last frame. */
+    content_type_t get_content_type() const
+    {
+        auto content_type = wf::get_core_impl().content_type.get();
+        return content_type ? content_type->get_output_content_type(output) : content_type_t::NONE;
+    }
+
+    /** @return Whether the last frame was a directly scanned out surface shown with an async page flip. */
+    bool is_tearing() const
+    {
+        auto tearing_control = wf::get_core_impl().tearing_control.get();
+        return tearing_control && tearing_control->is_tearing(output);
+    }
+
     const bool env_allow_scanout;
     static bool check_scanout_enabled()
     {
@@ -1058,14 +2274,44 @@ class wf::render_manager::impl
         const bool can_scanout = !output_inhibit_counter && effects->can_scanout() &&
             postprocessing->can_scanout() && wlr_output_is_direct_scanout_allowed(output->handle);
 
-        if (!can_scanout || !env_allow_scanout)
+        auto result = scene::direct_scanout::SKIP;
+        if (can_scanout && env_allow_scanout)
+        {
+            result = scene::try_scanout_from_list(damage_manager->render_instances, output);
+        }
+
+        commit_scanout_candidates();
+        if (result != scene::direct_scanout::SUCCESS)
         {
+            // Composited frames are always presented at vblank.
+            if (auto tearing_control = wf::get_core_impl().tearing_control.get())
+            {
+                tearing_control->set_tearing(output, false);
+            }
+
             return false;
         }
 
-        auto result = scene::try_scanout_from_list(
-            damage_manager->render_instances, output);
-        return result == scene::direct_scanout::SUCCESS;
+        return true;
+    }
+
+    /**
+     * Update the dmabuf feedback and the content type of the output after the render instances had a chance
+     * to report a scanout candidate.
+     */
+    void commit_scanout_candidates()
+    {
+        if (auto feedback = wf::get_core_impl().dmabuf_feedback.get())
+        {
+            feedback->commit_frame(output);
+        }
+
+        if (auto content_type = wf::get_core_impl().content_type.get())
+        {
+            content_type->commit_frame(output);
+            const auto type = content_type->get_output_content_type(output);
+            vrr_limiter->content_on_demand = (type == content_type_t::GAME) || (type == content_type_t::PHOTO);
+        }
     }
 
     /**
@@ -1081,8 +2327,9 @@ class wf::render_manager::impl
      * Render an output. Either calls the built-in renderer, or the render hook
      * of a plugin
      */
-    void render_output()
+    void render_output(scene::render_pass_timings_t *timings)
     {
+        WF_TRACE_ZONE("render output");
         if (runtime_config.damage_debug)
         {
             /* Clear the screen to yellow, so that the repainted parts are visible */
@@ -1104,6 +2351,7 @@ class wf::render_manager::impl
             wf::origin(output->get_layout_geometry()));
         params.background_color = background_color_opt;
         params.reference_output = this->output;
+        params.timings = timings;
 
         this->swap_damage = scene::run_render_pass(params,
             scene::RPASS_CLEAR_BACKGROUND | scene::RPASS_EMIT_SIGNALS);
@@ -1123,8 +2371,8 @@ class wf::render_manager::impl
 
         postprocessing->set_output_framebuffer(current_fb);
         const auto& default_fb = postprocessing->get_target_framebuffer();
-        depth_buffer_manager->ensure_depth_buffer(
-            default_fb.fb, default_fb.viewport_width, default_fb.viewport_height);
+        depth_buffer_manager->ensure_depth_buffer(default_fb.fb, default_fb.viewport_width,
+            default_fb.viewport_height, (default_fb.fb == current_fb) ? buffer : nullptr);
     }
 
     /**
@@ -1132,15 +2380,73 @@ class wf::render_manager::impl
      */
     void paint()
     {
+        WF_TRACE_ZONE_TEXT("paint", output->to_string());
+        profiler->start_frame();
+        OpenGL::gpu_memory_scope_t memory_scope{[this] ()
+        {
+            return OpenGL::gpu_memory_owner_t{"", 0, output->to_string()};
+        }};
+
+        // Frames requested while painting are driven by the compositor, see vrr_frame_limiter_t.
+        const bool limit_animations = vrr_limiter->is_active();
+        if (limit_animations)
+        {
+            vrr_limiter->frame_started();
+            damage_manager->defer_repaints = true;
+        }
+
+        if (paint_frame())
+        {
+            if (!first_frame_committed)
+            {
+                first_frame_committed = true;
+                wf::startup_profile::mark_first_frame(output);
+            }
+
+            if (synthetic_driver)
+            {
+                synthetic_driver->frame_painted();
+            }
+
+            post_paint();
+        }
+
+        if (limit_animations)
+        {
+            damage_manager->defer_repaints = false;
+            schedule_deferred_repaint();
+        }
+    }
+
+    /**
+     * Paint a single frame.
+     *
+     * @return Whether a frame was rendered and committed.
+     */
+    bool paint_frame()
+    {
+        const int64_t paint_start = wf::get_current_time_us();
+        const int64_t allocations_start = wf::get_heap_allocation_count();
+
         /* Part 1: frame setup: query damage, etc. */
         effects->run_effects(OUTPUT_EFFECT_PRE);
         effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        damage_manager->flush_visibility();
+
+        if (damage_manager->try_commit_cursor_only())
+        {
+            delay_manager->skip_frame();
+            profiler->discard_frame();
+            return false;
+        }
 
         if (do_direct_scanout())
         {
             // Yet another optimization: if we can directly scanout, we should
             // stop the rest of the repaint cycle.
-            return;
+            last_frame_scanout = true;
+            profiler->discard_frame();
+            return false;
         }
 
         auto next_frame = damage_manager->start_frame();
@@ -1149,23 +2455,40 @@ class wf::render_manager::impl
             // Optimization: the output doesn't need a new frame (so isn't damaged), so we can
             // just skip the whole repaint
             delay_manager->skip_frame();
-            return;
+            profiler->discard_frame();
+            return false;
         }
 
+        last_frame_scanout = false;
+        profiler->mark(FRAME_STAGE_UPDATE);
+
         /* Part 2: call the renderer, which sets swap_damage and draws the scenegraph */
         update_bound_output(next_frame->buffer);
-        render_output();
+        OpenGL::render_begin();
+        profiler->begin_gpu_timer();
+        OpenGL::render_end();
+
+        scene::render_pass_timings_t pass_timings;
+        render_output(&pass_timings);
+        profiler->mark(FRAME_STAGE_RENDER);
+        profiler->set_stage(FRAME_STAGE_SCHEDULE, pass_timings.schedule_us);
+        profiler->set_stage(FRAME_STAGE_RENDER, pass_timings.render_us);
 
         /* Part 3: overlay effects */
         effects->run_effects(OUTPUT_EFFECT_OVERLAY);
+        if (damage_manager->heatmap)
+        {
+            damage_manager->heatmap->update(output->get_screen_size());
+            damage_manager->heatmap->render(postprocessing->get_target_framebuffer());
+        }
 
         /* Part 4: finalize the scene: postprocessing effects */
-        if (postprocessing->post_effects.size())
+        if (postprocessing->post_effects.size() && !postprocessing->is_pointwise())
         {
             swap_damage |= damage_manager->get_wlr_damage_box();
         }
 
-        postprocessing->run_post_effects();
+        postprocessing->run_post_effects(swap_damage);
         if (output_inhibit_counter)
         {
             OpenGL::render_begin(output->handle->width, output->handle->height,
@@ -1180,13 +2503,27 @@ class wf::render_manager::impl
         OpenGL::render_begin();
         wlr_output_add_software_cursors_to_render_pass(output->handle, next_frame->render_pass,
             swap_damage.to_pixman());
+        profiler->end_gpu_timer();
         OpenGL::render_end();
+        profiler->mark(FRAME_STAGE_POSTPROCESS);
 
         /* Part 6: finalize frame: swap buffers, send frame_done, etc */
-        damage_manager->swap_buffers(std::move(next_frame), swap_damage);
+        damage_manager->swap_buffers(std::move(next_frame),
+            postprocessing->post_effects.size() && !postprocessing->is_pointwise());
         OpenGL::unbind_output(output);
         swap_damage.clear();
-        post_paint();
+        profiler->mark(FRAME_STAGE_SWAP);
+        profiler->end_frame();
+        delay_manager->frame_painted(paint_start, wf::get_current_time_us());
+        damage_manager->cursor_only_frames += damage_manager->cursor_only_frame;
+        if (allocations_start >= 0)
+        {
+            last_frame_allocations = wf::get_heap_allocation_count() - allocations_start;
+        }
+
+        // The geometry of views may have changed without a scenegraph update (e.g. transformers).
+        scene::invalidate_hit_test_cache();
+        return true;
     }
 
     /**
@@ -1194,17 +2531,148 @@ class wf::render_manager::impl
      */
     void post_paint()
     {
+        WF_TRACE_ZONE("post paint");
         effects->run_effects(OUTPUT_EFFECT_POST);
+        if (damage_manager->heatmap && damage_manager->heatmap->is_visible())
+        {
+            // Keep rendering until the heat has decayed, without adding damage of our own.
+            damage_manager->force_next_frame = true;
+            damage_manager->schedule_repaint();
+        }
+
         if (damage_manager->constant_redraw_counter)
         {
             damage_manager->schedule_repaint();
         }
     }
+
+    void set_synthetic_frame_driver(bool enabled, int rate)
+    {
+        synthetic_driver.reset();
+        if (enabled)
+        {
+            synthetic_driver = std::make_unique<synthetic_frame_driver_t>(rate);
+            synthetic_tick();
+        } else
+        {
+            damage_manager->schedule_repaint();
+        }
+    }
+
+    /**
+     * Force a full repaint and emit the frame event of the output ourselves, so that the frame does not
+     * wait for the backend. The next tick is scheduled right away, so that a frame which is skipped (for
+     * example, because the output is inhibited) does not stop the driver.
+     */
+    void synthetic_tick()
+    {
+        damage_manager->damage_whole(false);
+        damage_manager->force_next_frame = true;
+        wlr_output_send_frame(output->handle);
+        if (synthetic_driver)
+        {
+            synthetic_driver->schedule([=] () { synthetic_tick(); });
+        }
+    }
+
+    /**
+     * Schedule the frame requested while painting, if any, respecting the animation rate limit.
+     */
+    void schedule_deferred_repaint()
+    {
+        if (!damage_manager->deferred_repaint)
+        {
+            return;
+        }
+
+        damage_manager->deferred_repaint = false;
+        vrr_limiter->schedule_animation_frame([=] ()
+        {
+            damage_manager->schedule_repaint();
+        });
+    }
+};
+
+/**
+ * Memory pool for render instances. Blocks are grouped in size classes of 16 bytes, and freed blocks are kept
+ * in an intrusive free list per size class (so that the pool itself never allocates). Render instances are
+ * only created and destroyed on the main thread, so no locking is needed.
+ */
+namespace
+{
+constexpr std::size_t RENDER_INSTANCE_GRANULARITY = 16;
+constexpr std::size_t RENDER_INSTANCE_SIZE_CLASSES = 32;
+// Maximum number of blocks kept per size class, so that a one-time burst of instances is not kept forever.
+constexpr int RENDER_INSTANCE_POOL_LIMIT = 1024;
+
+struct free_block_t
+{
+    free_block_t *next;
+};
+
+struct render_instance_pool_t
+{
+    free_block_t *free_list[RENDER_INSTANCE_SIZE_CLASSES] = {};
+    int free_count[RENDER_INSTANCE_SIZE_CLASSES] = {};
 };
 
+render_instance_pool_t render_instance_pool;
+
+std::size_t render_instance_size_class(std::size_t size)
+{
+    return (std::max(size, (std::size_t)1) - 1) / RENDER_INSTANCE_GRANULARITY;
+}
+}
+
+void *scene::render_instance_t::operator new(std::size_t size)
+{
+    const auto idx = render_instance_size_class(size);
+    if (idx >= RENDER_INSTANCE_SIZE_CLASSES)
+    {
+        return ::operator new(size);
+    }
+
+    if (auto block = render_instance_pool.free_list[idx])
+    {
+        render_instance_pool.free_list[idx] = block->next;
+        --render_instance_pool.free_count[idx];
+        return block;
+    }
+
+    return ::operator new((idx + 1) * RENDER_INSTANCE_GRANULARITY);
+}
+
+void scene::render_instance_t::operator delete(void *ptr, std::size_t size)
+{
+    const auto idx = render_instance_size_class(size);
+    if ((idx >= RENDER_INSTANCE_SIZE_CLASSES) ||
+        (render_instance_pool.free_count[idx] >= RENDER_INSTANCE_POOL_LIMIT))
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto block = static_cast<free_block_t*>(ptr);
+    block->next = render_instance_pool.free_list[idx];
+    render_instance_pool.free_list[idx] = block;
+    ++render_instance_pool.free_count[idx];
+}
+
+void *scene::render_instance_t::operator new(std::size_t size, std::align_val_t align)
+{
+    // Over-aligned instances are rare, they are not pooled.
+    return ::operator new(size, align);
+}
+
+void scene::render_instance_t::operator delete(void *ptr, std::size_t size, std::align_val_t align)
+{
+    ::operator delete(ptr, size, align);
+}
+
 wf::region_t scene::run_render_pass(
     const render_pass_params_t& params, uint32_t flags)
 {
+    WF_TRACE_ZONE("render pass");
     auto accumulated_damage = params.damage;
 
     if (flags & RPASS_EMIT_SIGNALS)
@@ -1216,14 +2684,37 @@ wf::region_t scene::run_render_pass(
 
     wf::region_t swap_damage = accumulated_damage;
 
-    // Gather instructions
-    std::vector<wf::scene::render_instruction_t> instructions;
+    using clock = std::chrono::steady_clock;
+    auto elapsed_us = [] (clock::time_point since)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - since).count();
+    };
+
+    // Gather instructions. The instruction buffers are reused between frames to avoid reallocating them,
+    // one buffer per nesting level since render instances may run render passes of their own.
+    static std::vector<std::unique_ptr<std::vector<render_instruction_t>>> instruction_buffers;
+    static std::size_t render_pass_depth = 0;
+    if (instruction_buffers.size() <= render_pass_depth)
+    {
+        instruction_buffers.push_back(std::make_unique<std::vector<render_instruction_t>>());
+    }
+
+    auto& instructions = *instruction_buffers[render_pass_depth++];
+    scene::begin_bounding_box_cache();
+    auto schedule_start = clock::now();
     for (auto& inst : *params.instances)
     {
         inst->schedule_instructions(instructions,
             params.target, accumulated_damage);
     }
 
+    if (params.timings)
+    {
+        params.timings->schedule_us = elapsed_us(schedule_start);
+    }
+
+    auto render_start = clock::now();
+
     // Clear visible background areas
     if (flags & RPASS_CLEAR_BACKGROUND)
     {
@@ -1240,6 +2731,7 @@ wf::region_t scene::run_render_pass(
     // Render instances
     for (auto& instr : wf::reverse(instructions))
     {
+        WF_TRACE_ZONE("render instance");
         instr.instance->render(instr.target, instr.damage, instr.data);
         if (params.reference_output)
         {
@@ -1247,6 +2739,15 @@ wf::region_t scene::run_render_pass(
         }
     }
 
+    if (params.timings)
+    {
+        params.timings->render_us = elapsed_us(render_start);
+    }
+
+    scene::end_bounding_box_cache();
+    instructions.clear();
+    --render_pass_depth;
+
     if (flags & RPASS_EMIT_SIGNALS)
     {
         render_pass_end_signal end_ev;
@@ -1285,6 +2786,31 @@ void scene::compute_visibility_from_list(const std::vector<render_instance_uptr>
     region += offset;
 }
 
+bool scene::can_render_transformed_list(const std::vector<render_instance_uptr>& instances)
+{
+    return std::all_of(instances.begin(), instances.end(), [] (const auto& ch)
+    {
+        return ch->can_render_transformed();
+    });
+}
+
+int scene::get_alpha_layer_count_list(const std::vector<render_instance_uptr>& instances)
+{
+    int total = 0;
+    for (auto& ch : instances)
+    {
+        const int count = ch->get_alpha_layer_count();
+        if (count < 0)
+        {
+            return -1;
+        }
+
+        total += count;
+    }
+
+    return total;
+}
+
 render_manager::render_manager(output_t *o) :
     pimpl(new impl(o))
 {}
@@ -1330,6 +2856,16 @@ void render_manager::rem_post(post_hook_t *hook)
     pimpl->postprocessing->rem_post(hook);
 }
 
+void render_manager::add_post(post_color_effect_t *effect)
+{
+    pimpl->postprocessing->add_post(effect);
+}
+
+void render_manager::rem_post(post_color_effect_t *effect)
+{
+    pimpl->postprocessing->rem_post(effect);
+}
+
 wf::region_t render_manager::get_scheduled_damage()
 {
     return pimpl->damage_manager->get_scheduled_damage();
@@ -1370,6 +2906,53 @@ void render_manager::set_require_depth_buffer(bool require)
     return pimpl->depth_buffer_manager->set_required(require);
 }
 
+frame_stats_t render_manager::get_frame_stats() const
+{
+    auto stats = pimpl->profiler->get_stats();
+    pimpl->delay_manager->fill_stats(stats);
+    stats.damage_simplified_frames = pimpl->damage_manager->simplified_frames;
+    stats.damage_simplify_added_area = pimpl->damage_manager->simplify_added_area;
+    stats.cursor_only_frames   = pimpl->damage_manager->cursor_only_frames;
+    stats.cursor_plane_commits = pimpl->damage_manager->cursor_plane_commits;
+    stats.frame_allocations = pimpl->last_frame_allocations;
+    stats.render_instances  = pimpl->damage_manager->render_instances.size();
+    stats.direct_scanout    = pimpl->last_frame_scanout;
+    return stats;
+}
+
+void render_manager::set_damage_heatmap(bool enabled)
+{
+    if (enabled == (bool)pimpl->damage_manager->heatmap)
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        pimpl->damage_manager->heatmap = std::make_unique<damage_heatmap_t>();
+    } else
+    {
+        pimpl->damage_manager->heatmap.reset();
+    }
+
+    pimpl->damage_manager->damage_whole();
+}
+
+void render_manager::set_synthetic_frame_driver(bool enabled, int rate)
+{
+    pimpl->set_synthetic_frame_driver(enabled, rate);
+}
+
+synthetic_frame_stats_t render_manager::get_synthetic_frame_stats() const
+{
+    if (!pimpl->synthetic_driver)
+    {
+        return {};
+    }
+
+    return pimpl->synthetic_driver->get_stats();
+}
+
 void priv_render_manager_clear_instances(wf::render_manager *manager)
 {
     manager->pimpl->damage_manager->render_instances.clear();
@@ -3,6 +3,8 @@
 #include "wayfire/signal-provider.hpp"
 #include <wayfire/output.hpp>
 #include <wayfire/signal-definitions.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/util.hpp>
 
 struct wf::output_workarea_manager_t::impl
 {
@@ -10,18 +12,75 @@ struct wf::output_workarea_manager_t::impl
     std::vector<anchored_area*> anchors;
     output_t *output;
     wf::signal::connection_t<output_configuration_changed_signal> on_configuration_changed;
+
+    // Panels which animate their exclusive zone can change the workarea many times per frame. Plugins are
+    // notified of the first change in a frame right away, further changes are coalesced and notified on the
+    // next frame event. Outputs which are off or do not repaint never send a frame event, so a timer is
+    // used as a fallback.
+    wf::geometry_t notified_workarea;
+    bool notified_this_frame = false;
+    bool notify_pending = false;
+    wf::wl_timer<false> notify_timer;
+    static constexpr uint32_t NOTIFY_FALLBACK_MS = 50;
+
+    void notify_workarea_changed()
+    {
+        notify_pending = false;
+        if (notified_workarea == current_workarea)
+        {
+            return;
+        }
+
+        wf::workarea_changed_signal data;
+        data.output = output;
+        data.old_workarea = notified_workarea;
+        data.new_workarea = current_workarea;
+        notified_workarea = current_workarea;
+        notified_this_frame = true;
+        output->emit(&data);
+    }
+
+    void schedule_notify()
+    {
+        if (!notified_this_frame)
+        {
+            notify_workarea_changed();
+        } else if (!notify_pending)
+        {
+            notify_pending = true;
+            output->render->schedule_redraw();
+            notify_timer.set_timeout(NOTIFY_FALLBACK_MS, [=] () { end_frame(); });
+        }
+    }
+
+    void end_frame()
+    {
+        notify_timer.disconnect();
+        notified_this_frame = false;
+        if (notify_pending)
+        {
+            notify_workarea_changed();
+        }
+    }
+
+    wf::signal::connection_t<frame_done_signal> on_frame_done = [=] (frame_done_signal*)
+    {
+        end_frame();
+    };
 };
 
 wf::output_workarea_manager_t::output_workarea_manager_t(output_t *output)
 {
     priv = std::make_unique<impl>();
     priv->output = output;
-    priv->current_workarea = output->get_relative_geometry();
+    priv->current_workarea  = output->get_relative_geometry();
+    priv->notified_workarea = priv->current_workarea;
     priv->on_configuration_changed = [=] (auto)
     {
         this->reflow_reserved_areas();
     };
     output->connect(&priv->on_configuration_changed);
+    output->connect(&priv->on_frame_done);
 }
 
 wf::output_workarea_manager_t::~output_workarea_manager_t() = default;
@@ -44,8 +103,6 @@ void wf::output_workarea_manager_t::remove_reserved_area(anchored_area *area)
 
 void wf::output_workarea_manager_t::reflow_reserved_areas()
 {
-    auto old_workarea = priv->current_workarea;
-
     priv->current_workarea = priv->output->get_relative_geometry();
     for (auto a : priv->anchors)
     {
@@ -74,13 +131,8 @@ void wf::output_workarea_manager_t::reflow_reserved_areas()
         }
     }
 
-    wf::workarea_changed_signal data;
-    data.output = priv->output;
-    data.old_workarea = old_workarea;
-    data.new_workarea = priv->current_workarea;
-
-    if (data.old_workarea != data.new_workarea)
+    if (priv->current_workarea != priv->notified_workarea)
     {
-        priv->output->emit(&data);
+        priv->schedule_notify();
     }
 }
@@ -9,6 +9,7 @@
 #include <wayfire/opengl.hpp>
 #include <set>
 #include <algorithm>
+#include <iterator>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/window-manager.hpp>
@@ -17,11 +18,13 @@
 #include <wayfire/scene-operations.hpp>
 
 #include "../view/view-impl.hpp"
+#include "../core/scene-priv.hpp"
 #include "wayfire/debug.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/nonstd/tracking-allocator.hpp"
 #include "wayfire/option-wrapper.hpp"
 #include "wayfire/scene-input.hpp"
+#include "wayfire/scene-render.hpp"
 #include "wayfire/scene.hpp"
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/toplevel-view.hpp"
@@ -166,6 +169,146 @@ static size_t find_index_in_parent(wf::scene::node_t *x, wf::scene::node_t *pare
     return it - children.begin();
 }
 
+/**
+ * With core/incremental_restack, the render instances of the views in a workspace set are kept in a list of
+ * their own, so that raising or lowering a view only reorders this list, instead of regenerating the render
+ * instances of everything on the output.
+ */
+class workspace_set_render_instance_t : public wf::scene::render_instance_t
+{
+    wf::scene::node_t *self;
+    wf::scene::damage_callback push_damage;
+    wf::output_t *shown_on;
+
+    std::vector<wf::scene::render_instance_uptr> children;
+    // The enabled children of the node in stacking order, with the number of instances each of them generated.
+    std::vector<std::pair<wf::scene::node_t*, size_t>> ranges;
+
+    wf::signal::connection_t<wf::scene::node_damage_signal> on_node_damage =
+        [=] (wf::scene::node_damage_signal *ev)
+    {
+        push_damage(ev->region);
+    };
+
+    wf::signal::connection_t<wf::scene::node_reorder_instances_signal> on_reorder =
+        [=] (wf::scene::node_reorder_instances_signal *ev)
+    {
+        reorder_instances();
+        ev->handled = true;
+    };
+
+    void regen_instances()
+    {
+        children.clear();
+        ranges.clear();
+        for (auto& ch : self->get_children())
+        {
+            if (ch->is_enabled())
+            {
+                const size_t count_before = children.size();
+                ch->gen_render_instances(children, push_damage, shown_on);
+                ranges.emplace_back(ch.get(), children.size() - count_before);
+            }
+        }
+    }
+
+    void reorder_instances()
+    {
+        auto old_children = std::move(children);
+        auto old_ranges   = std::move(ranges);
+        children.clear();
+        ranges.clear();
+
+        std::vector<size_t> old_start;
+        size_t idx = 0;
+        for (auto& [node, count] : old_ranges)
+        {
+            old_start.push_back(idx);
+            idx += count;
+        }
+
+        for (auto& ch : self->get_children())
+        {
+            if (!ch->is_enabled())
+            {
+                continue;
+            }
+
+            auto it = std::find_if(old_ranges.begin(), old_ranges.end(),
+                [&] (const auto& range) { return range.first == ch.get(); });
+            if (it == old_ranges.end())
+            {
+                // Not a pure reordering after all.
+                regen_instances();
+                return;
+            }
+
+            auto begin = old_children.begin() + old_start[it - old_ranges.begin()];
+            std::move(begin, begin + it->second, std::back_inserter(children));
+            ranges.push_back(*it);
+        }
+
+        if (ranges.size() != old_ranges.size())
+        {
+            regen_instances();
+        }
+    }
+
+  public:
+    workspace_set_render_instance_t(wf::scene::node_t *self, wf::scene::damage_callback push_damage,
+        wf::output_t *shown_on)
+    {
+        this->self = self;
+        this->push_damage = push_damage;
+        this->shown_on    = shown_on;
+        self->connect(&on_node_damage);
+        self->connect(&on_reorder);
+        regen_instances();
+    }
+
+    void schedule_instructions(std::vector<wf::scene::render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        for (auto& ch : children)
+        {
+            ch->schedule_instructions(instructions, target, damage);
+        }
+    }
+
+    void render(const wf::render_target_t& target, const wf::region_t& region) override
+    {
+        wf::dassert(false, "Rendering a workspace set node?");
+    }
+
+    void presentation_feedback(wf::output_t *output) override
+    {
+        for (auto& ch : children)
+        {
+            ch->presentation_feedback(output);
+        }
+    }
+
+    wf::scene::direct_scanout try_scanout(wf::output_t *output) override
+    {
+        return wf::scene::try_scanout_from_list(children, output);
+    }
+
+    void compute_visibility(wf::output_t *output, wf::region_t& visible) override
+    {
+        wf::scene::compute_visibility_from_list(children, output, visible, {0, 0});
+    }
+
+    bool can_render_transformed() override
+    {
+        return wf::scene::can_render_transformed_list(children);
+    }
+
+    int get_alpha_layer_count() override
+    {
+        return wf::scene::get_alpha_layer_count_list(children);
+    }
+};
+
 class workspace_set_root_node_t : public wf::scene::floating_inner_node_t
 {
     uint64_t index;
@@ -176,6 +319,19 @@ class workspace_set_root_node_t : public wf::scene::floating_inner_node_t
         this->index = index;
     }
 
+    void gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
+        wf::scene::damage_callback push_damage, wf::output_t *output) override
+    {
+        static wf::option_wrapper_t<bool> incremental_restack{"core/incremental_restack"};
+        if (incremental_restack)
+        {
+            instances.push_back(std::make_unique<workspace_set_render_instance_t>(this, push_damage, output));
+        } else
+        {
+            floating_inner_node_t::gen_render_instances(instances, push_damage, output);
+        }
+    }
+
     std::string stringify() const override
     {
         return "workspace-set id=" + std::to_string(index) + " " + stringify_flags();
@@ -391,6 +547,7 @@ struct workspace_set_t::impl
 
         LOGC(WSET, "Adding view ", view, " to wset ", index);
         wset_views.push_back(view);
+        stacked_views_dirty = true;
         view->connect(&on_view_destruct);
         view->priv->current_wset = self->weak_from_this();
         view->set_output(this->output);
@@ -407,10 +564,29 @@ struct workspace_set_t::impl
 
         LOGC(WSET, "Removing view ", view, " from id=", index);
         wset_views.erase(it);
+        stacked_views_dirty = true;
         view->disconnect(&on_view_destruct);
         view->priv->current_wset.reset();
     }
 
+    const std::vector<wayfire_toplevel_view>& get_stacked_views(bool mapped_only)
+    {
+        // Both counters are bumped before any signal is emitted for the change, so that signal handlers
+        // (which may run before ours would) never see a stale list.
+        const uint64_t generation = scene::get_children_list_generation();
+        const uint64_t mapped_generation = get_mapped_state_generation();
+        if (stacked_views_dirty || (generation != stacked_views_generation) ||
+            (mapped_generation != stacked_views_mapped_generation))
+        {
+            rebuild_stacked_views();
+            stacked_views_generation = generation;
+            stacked_views_mapped_generation = mapped_generation;
+            stacked_views_dirty = false;
+        }
+
+        return mapped_only ? stacked_mapped_views : stacked_views;
+    }
+
     std::vector<wayfire_toplevel_view> get_views(uint32_t flags = 0,
         std::optional<wf::point_t> workspace = {})
     {
@@ -424,10 +600,13 @@ struct workspace_set_t::impl
             workspace = get_current_workspace();
         }
 
-        auto views = wset_views;
+        // The stacked lists are already filtered by mapped state and sorted, so only the remaining filters
+        // have to be applied.
+        const bool sorted = (flags & WSET_SORT_STACKING);
+        auto views = sorted ? get_stacked_views(flags & WSET_MAPPED_ONLY) : wset_views;
         auto it    = std::remove_if(views.begin(), views.end(), [&] (wayfire_toplevel_view view)
         {
-            if ((flags & WSET_MAPPED_ONLY) && !view->is_mapped())
+            if (!sorted && (flags & WSET_MAPPED_ONLY) && !view->is_mapped())
             {
                 return true;
             }
@@ -437,11 +616,6 @@ struct workspace_set_t::impl
                 return true;
             }
 
-            if ((flags & WSET_SORT_STACKING) && !is_attached_to_scenegraph(view->get_root_node().get()))
-            {
-                return true;
-            }
-
             if (workspace && !view_visible_on(view, *workspace))
             {
                 return true;
@@ -450,30 +624,58 @@ struct workspace_set_t::impl
             return false;
         });
         views.erase(it, views.end());
+        return views;
+    }
+
+  private:
+    std::vector<wayfire_toplevel_view> wset_views;
+
+    /**
+     * The views of the wset which are attached to the scenegraph, sorted in stacking order, and the subset
+     * of them which is mapped. They are rebuilt lazily, when views are added or removed, mapped or unmapped,
+     * or when the children of any scenegraph node change.
+     */
+    std::vector<wayfire_toplevel_view> stacked_views;
+    std::vector<wayfire_toplevel_view> stacked_mapped_views;
+    uint64_t stacked_views_generation = 0;
+    uint64_t stacked_views_mapped_generation = 0;
+    bool stacked_views_dirty = true;
 
-        if (flags & WSET_SORT_STACKING)
+    void rebuild_stacked_views()
+    {
+        stacked_views.clear();
+        for (auto& view : wset_views)
         {
-            std::sort(views.begin(), views.end(), [] (wayfire_toplevel_view a, wayfire_view b)
+            if (is_attached_to_scenegraph(view->get_root_node().get()))
             {
-                wf::scene::node_t *x   = a->get_root_node().get();
-                wf::scene::node_t *y   = b->get_root_node().get();
-                wf::scene::node_t *lca = find_lca(x, y);
-                wf::dassert(lca != nullptr,
-                    "LCA should always exist when the two nodes are in the scenegraph!");
-                wf::dassert((lca != x) && (lca != y), "LCA should not be equal to one of the nodes, this"
-                                                      "means nested views/dialogs have been added to the wset!");
-
-                const size_t idx_x = find_index_in_parent(x, lca);
-                const size_t idx_y = find_index_in_parent(y, lca);
-                return idx_x < idx_y;
-            });
+                stacked_views.push_back(view);
+            }
         }
 
-        return views;
-    }
+        std::sort(stacked_views.begin(), stacked_views.end(), [] (wayfire_toplevel_view a, wayfire_view b)
+        {
+            wf::scene::node_t *x   = a->get_root_node().get();
+            wf::scene::node_t *y   = b->get_root_node().get();
+            wf::scene::node_t *lca = find_lca(x, y);
+            wf::dassert(lca != nullptr,
+                "LCA should always exist when the two nodes are in the scenegraph!");
+            wf::dassert((lca != x) && (lca != y), "LCA should not be equal to one of the nodes, this"
+                                                  "means nested views/dialogs have been added to the wset!");
+
+            const size_t idx_x = find_index_in_parent(x, lca);
+            const size_t idx_y = find_index_in_parent(y, lca);
+            return idx_x < idx_y;
+        });
 
-  private:
-    std::vector<wayfire_toplevel_view> wset_views;
+        stacked_mapped_views.clear();
+        for (auto& view : stacked_views)
+        {
+            if (view->is_mapped())
+            {
+                stacked_mapped_views.push_back(view);
+            }
+        }
+    }
 
     int current_vx = 0;
     int current_vy = 0;
@@ -641,7 +843,9 @@ struct workspace_set_t::impl
         self->emit(&data);
         if (output)
         {
-            // Finally, do a refocus to update the keyboard focus
+            // Finally, do a refocus to update the keyboard focus. The views have not been updated in the
+            // scenegraph yet, so the last focus result is not valid anymore.
+            wf::scene::invalidate_keyboard_refocus();
             wf::get_core().seat->refocus();
             output->emit(&data);
         }
@@ -697,6 +901,11 @@ std::vector<wayfire_toplevel_view> workspace_set_t::get_views(uint32_t flags, st
     return pimpl->get_views(flags, ws);
 }
 
+const std::vector<wayfire_toplevel_view>& workspace_set_t::get_views_in_stacking_order(bool mapped_only)
+{
+    return pimpl->get_stacked_views(mapped_only);
+}
+
 void workspace_set_t::remove_view(wayfire_toplevel_view view)
 {
     pimpl->remove_view(view);
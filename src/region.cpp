@@ -1,5 +1,8 @@
 #include <wayfire/region.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 /* Pixman helpers */
 wlr_box wlr_box_from_pixman_box(const pixman_box32_t& box)
@@ -20,6 +23,129 @@ pixman_box32_t pixman_box_from_wlr_box(const wlr_box& box)
     };
 }
 
+/**
+ * Most regions in practice consist of a single rectangle (a view, an output or a surface damage box).
+ * Pixman stores such regions without allocating (data is NULL), but its generic operations still go
+ * through the full band-merging machinery. The operators below handle the common cases with at most one
+ * rectangle on each side directly.
+ */
+static bool is_single_box(const pixman_region32_t *region)
+{
+    return region->data == NULL;
+}
+
+static bool is_empty_region(const pixman_region32_t *region)
+{
+    return (region->data != NULL) && (region->data->numRects == 0);
+}
+
+static bool is_empty_box(const pixman_box32_t& box)
+{
+    return (box.x1 >= box.x2) || (box.y1 >= box.y2);
+}
+
+static bool box_contains(const pixman_box32_t& outer, const pixman_box32_t& inner)
+{
+    return (outer.x1 <= inner.x1) && (outer.y1 <= inner.y1) &&
+           (outer.x2 >= inner.x2) && (outer.y2 >= inner.y2);
+}
+
+static pixman_box32_t box_intersection(const pixman_box32_t& a, const pixman_box32_t& b)
+{
+    return pixman_box32_t{
+        .x1 = std::max(a.x1, b.x1),
+        .y1 = std::max(a.y1, b.y1),
+        .x2 = std::min(a.x2, b.x2),
+        .y2 = std::min(a.y2, b.y2),
+    };
+}
+
+static void set_to_box(pixman_region32_t *region, const pixman_box32_t& box)
+{
+    if (is_empty_box(box))
+    {
+        pixman_region32_clear(region);
+    } else
+    {
+        pixman_region32_reset(region, const_cast<pixman_box32_t*>(&box));
+    }
+}
+
+/* Try to compute @dst = @src & @box without pixman_region32_intersect_rect().
+ * @return false if the slow path is needed. */
+static bool intersect_box_fast(pixman_region32_t *dst, pixman_region32_t *src, const pixman_box32_t& box)
+{
+    if (is_empty_region(src) || is_empty_box(box))
+    {
+        pixman_region32_clear(dst);
+        return true;
+    }
+
+    if (is_single_box(src))
+    {
+        set_to_box(dst, box_intersection(src->extents, box));
+        return true;
+    }
+
+    if (box_contains(box, src->extents))
+    {
+        if (dst != src)
+        {
+            pixman_region32_copy(dst, src);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/* Try to compute @dst = @src | @box without pixman_region32_union_rect().
+ * @return false if the slow path is needed. */
+static bool union_box_fast(pixman_region32_t *dst, pixman_region32_t *src, const pixman_box32_t& box)
+{
+    if (is_empty_box(box) || (is_single_box(src) && box_contains(src->extents, box)))
+    {
+        if (dst != src)
+        {
+            pixman_region32_copy(dst, src);
+        }
+
+        return true;
+    }
+
+    if (is_empty_region(src) || box_contains(box, src->extents))
+    {
+        set_to_box(dst, box);
+        return true;
+    }
+
+    return false;
+}
+
+/* Try to compute @dst = @src - @box without pixman_region32_subtract().
+ * @return false if the slow path is needed. */
+static bool subtract_box_fast(pixman_region32_t *dst, pixman_region32_t *src, const pixman_box32_t& box)
+{
+    if (is_empty_region(src) || is_empty_box(box) || is_empty_box(box_intersection(src->extents, box)))
+    {
+        if (dst != src)
+        {
+            pixman_region32_copy(dst, src);
+        }
+
+        return true;
+    }
+
+    if (box_contains(box, src->extents))
+    {
+        pixman_region32_clear(dst);
+        return true;
+    }
+
+    return false;
+}
+
 wf::region_t::region_t()
 {
     pixman_region32_init(&_region);
@@ -35,6 +161,12 @@ wf::region_t::region_t(const wlr_box& box)
     pixman_region32_init_rect(&_region, box.x, box.y, box.width, box.height);
 }
 
+wf::region_t::region_t(const pixman_box32_t *boxes, int count)
+{
+    // pixman_region32_init_rects() takes a non-const array, but only reads it.
+    pixman_region32_init_rects(&_region, const_cast<pixman_box32_t*>(boxes), count);
+}
+
 wf::region_t::~region_t()
 {
     pixman_region32_fini(&_region);
@@ -123,6 +255,85 @@ void wf::region_t::expand_edges(int amount)
     free(dst_rects);
 }
 
+static int64_t box_area(const pixman_box32_t& box)
+{
+    return int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+}
+
+static int64_t region_area(const wf::region_t& region)
+{
+    int64_t area = 0;
+    for (const auto& box : region)
+    {
+        area += box_area(box);
+    }
+
+    return area;
+}
+
+static pixman_box32_t box_union(const pixman_box32_t& a, const pixman_box32_t& b)
+{
+    return pixman_box32_t{
+        .x1 = std::min(a.x1, b.x1),
+        .y1 = std::min(a.y1, b.y1),
+        .x2 = std::max(a.x2, b.x2),
+        .y2 = std::max(a.y2, b.y2),
+    };
+}
+
+int64_t wf::region_t::simplify(int max_boxes)
+{
+    max_boxes = std::max(max_boxes, 1);
+    if (pixman_region32_n_rects(&_region) <= max_boxes)
+    {
+        return 0;
+    }
+
+    const int64_t initial_area = region_area(*this);
+
+    // Pixman keeps the rectangles sorted by y, then x, so rectangles which are close to each other are also
+    // close in the list. We greedily merge the pair of rectangles which adds the least area, considering
+    // only a few neighbors of each rectangle to keep the cost quadratic.
+    static constexpr int NEIGHBORS = 4;
+    std::vector<pixman_box32_t> boxes{begin(), end()};
+    while ((int)boxes.size() > max_boxes)
+    {
+        size_t best_i = 0, best_j = 1;
+        int64_t best_cost = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            for (size_t j = i + 1; j < std::min(boxes.size(), i + 1 + NEIGHBORS); j++)
+            {
+                const int64_t cost = box_area(box_union(boxes[i], boxes[j])) -
+                    box_area(boxes[i]) - box_area(boxes[j]);
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_i    = i;
+                    best_j    = j;
+                }
+            }
+        }
+
+        boxes[best_i] = box_union(boxes[best_i], boxes[best_j]);
+        boxes.erase(boxes.begin() + best_j);
+    }
+
+    pixman_region32_fini(&_region);
+    pixman_region32_init_rects(&_region, boxes.data(), boxes.size());
+
+    // Overlapping rectangles may be split into more bands by pixman. In this rare case, fall back to the
+    // extents of the region.
+    if (pixman_region32_n_rects(&_region) > max_boxes)
+    {
+        auto extents = *pixman_region32_extents(&_region);
+        pixman_region32_fini(&_region);
+        pixman_region32_init_with_extents(&_region, &extents);
+    }
+
+    return region_area(*this) - initial_area;
+}
+
 pixman_box32_t wf::region_t::get_extents() const
 {
     return *pixman_region32_extents(this->unconst());
@@ -196,8 +407,11 @@ wf::region_t& wf::region_t::operator *=(float scale)
 wf::region_t wf::region_t::operator &(const wlr_box& box) const
 {
     wf::region_t result;
-    pixman_region32_intersect_rect(result.to_pixman(), this->unconst(),
-        box.x, box.y, box.width, box.height);
+    if (!intersect_box_fast(result.to_pixman(), this->unconst(), pixman_box_from_wlr_box(box)))
+    {
+        pixman_region32_intersect_rect(result.to_pixman(), this->unconst(),
+            box.x, box.y, box.width, box.height);
+    }
 
     return result;
 }
@@ -205,24 +419,35 @@ wf::region_t wf::region_t::operator &(const wlr_box& box) const
 wf::region_t wf::region_t::operator &(const wf::region_t& other) const
 {
     wf::region_t result;
-    pixman_region32_intersect(result.to_pixman(),
-        this->unconst(), other.unconst());
+    if (!is_single_box(other.unconst()) ||
+        !intersect_box_fast(result.to_pixman(), this->unconst(), other._region.extents))
+    {
+        pixman_region32_intersect(result.to_pixman(),
+            this->unconst(), other.unconst());
+    }
 
     return result;
 }
 
 wf::region_t& wf::region_t::operator &=(const wlr_box& box)
 {
-    pixman_region32_intersect_rect(this->to_pixman(), this->to_pixman(),
-        box.x, box.y, box.width, box.height);
+    if (!intersect_box_fast(this->to_pixman(), this->to_pixman(), pixman_box_from_wlr_box(box)))
+    {
+        pixman_region32_intersect_rect(this->to_pixman(), this->to_pixman(),
+            box.x, box.y, box.width, box.height);
+    }
 
     return *this;
 }
 
 wf::region_t& wf::region_t::operator &=(const wf::region_t& other)
 {
-    pixman_region32_intersect(this->to_pixman(),
-        this->to_pixman(), other.unconst());
+    if (!is_single_box(other.unconst()) ||
+        !intersect_box_fast(this->to_pixman(), this->to_pixman(), other._region.extents))
+    {
+        pixman_region32_intersect(this->to_pixman(),
+            this->to_pixman(), other.unconst());
+    }
 
     return *this;
 }
@@ -231,8 +456,11 @@ wf::region_t& wf::region_t::operator &=(const wf::region_t& other)
 wf::region_t wf::region_t::operator |(const wlr_box& other) const
 {
     wf::region_t result;
-    pixman_region32_union_rect(result.to_pixman(), this->unconst(),
-        other.x, other.y, other.width, other.height);
+    if (!union_box_fast(result.to_pixman(), this->unconst(), pixman_box_from_wlr_box(other)))
+    {
+        pixman_region32_union_rect(result.to_pixman(), this->unconst(),
+            other.x, other.y, other.width, other.height);
+    }
 
     return result;
 }
@@ -240,22 +468,36 @@ wf::region_t wf::region_t::operator |(const wlr_box& other) const
 wf::region_t wf::region_t::operator |(const wf::region_t& other) const
 {
     wf::region_t result;
-    pixman_region32_union(result.to_pixman(), this->unconst(), other.unconst());
+    if (!is_single_box(other.unconst()) ||
+        !union_box_fast(result.to_pixman(), this->unconst(), other._region.extents))
+    {
+        pixman_region32_union(result.to_pixman(), this->unconst(), other.unconst());
+    }
 
     return result;
 }
 
 wf::region_t& wf::region_t::operator |=(const wlr_box& other)
 {
-    pixman_region32_union_rect(this->to_pixman(), this->to_pixman(),
-        other.x, other.y, other.width, other.height);
+    if (!union_box_fast(this->to_pixman(), this->to_pixman(), pixman_box_from_wlr_box(other)))
+    {
+        pixman_region32_union_rect(this->to_pixman(), this->to_pixman(),
+            other.x, other.y, other.width, other.height);
+    }
 
     return *this;
 }
 
 wf::region_t& wf::region_t::operator |=(const wf::region_t& other)
 {
-    pixman_region32_union(this->to_pixman(), this->to_pixman(), other.unconst());
+    if (is_empty_region(this->to_pixman()))
+    {
+        pixman_region32_copy(this->to_pixman(), other.unconst());
+    } else if (!is_single_box(other.unconst()) ||
+               !union_box_fast(this->to_pixman(), this->to_pixman(), other._region.extents))
+    {
+        pixman_region32_union(this->to_pixman(), this->to_pixman(), other.unconst());
+    }
 
     return *this;
 }
@@ -264,8 +506,11 @@ wf::region_t& wf::region_t::operator |=(const wf::region_t& other)
 wf::region_t wf::region_t::operator ^(const wlr_box& box) const
 {
     wf::region_t result;
-    wf::region_t sub{box};
-    pixman_region32_subtract(result.to_pixman(), this->unconst(), sub.to_pixman());
+    if (!subtract_box_fast(result.to_pixman(), this->unconst(), pixman_box_from_wlr_box(box)))
+    {
+        wf::region_t sub{box};
+        pixman_region32_subtract(result.to_pixman(), this->unconst(), sub.to_pixman());
+    }
 
     return result;
 }
@@ -273,25 +518,36 @@ wf::region_t wf::region_t::operator ^(const wlr_box& box) const
 wf::region_t wf::region_t::operator ^(const wf::region_t& other) const
 {
     wf::region_t result;
-    pixman_region32_subtract(result.to_pixman(),
-        this->unconst(), other.unconst());
+    if (!is_single_box(other.unconst()) ||
+        !subtract_box_fast(result.to_pixman(), this->unconst(), other._region.extents))
+    {
+        pixman_region32_subtract(result.to_pixman(),
+            this->unconst(), other.unconst());
+    }
 
     return result;
 }
 
 wf::region_t& wf::region_t::operator ^=(const wlr_box& box)
 {
-    wf::region_t sub{box};
-    pixman_region32_subtract(this->to_pixman(),
-        this->to_pixman(), sub.to_pixman());
+    if (!subtract_box_fast(this->to_pixman(), this->to_pixman(), pixman_box_from_wlr_box(box)))
+    {
+        wf::region_t sub{box};
+        pixman_region32_subtract(this->to_pixman(),
+            this->to_pixman(), sub.to_pixman());
+    }
 
     return *this;
 }
 
 wf::region_t& wf::region_t::operator ^=(const wf::region_t& other)
 {
-    pixman_region32_subtract(this->to_pixman(),
-        this->to_pixman(), other.unconst());
+    if (!is_single_box(other.unconst()) ||
+        !subtract_box_fast(this->to_pixman(), this->to_pixman(), other._region.extents))
+    {
+        pixman_region32_subtract(this->to_pixman(),
+            this->to_pixman(), other.unconst());
+    }
 
     return *this;
 }
@@ -320,3 +576,83 @@ const pixman_box32_t*wf::region_t::end() const
 
     return data + n;
 }
+
+/* Bulk box operations */
+namespace
+{
+using v4si = int32_t __attribute__((vector_size(16)));
+using v4df = double __attribute__((vector_size(32)));
+
+// The lanes of a box vector which hold x1 and y1.
+constexpr v4si lower_lanes = {-1, -1, 0, 0};
+
+v4si load_box(const pixman_box32_t& box)
+{
+    return v4si{box.x1, box.y1, box.x2, box.y2};
+}
+
+void store_box(pixman_box32_t& box, v4si v)
+{
+    box = {v[0], v[1], std::max(v[0], v[2]), std::max(v[1], v[3])};
+}
+
+v4si select(v4si mask, v4si a, v4si b)
+{
+    return (a & mask) | (b & ~mask);
+}
+
+/** Round x1 and y1 down, and x2 and y2 up. */
+v4si round_outwards(const v4df& v)
+{
+    const v4si truncated = __builtin_convertvector(v, v4si);
+    const v4df back = __builtin_convertvector(truncated, v4df);
+    // Comparisons are -1 where true, so adding them rounds down and subtracting them rounds up.
+    const v4si floor = truncated + __builtin_convertvector(back > v, v4si);
+    const v4si ceil  = truncated - __builtin_convertvector(back < v, v4si);
+    return select(lower_lanes, floor, ceil);
+}
+}
+
+void wf::intersect_boxes(pixman_box32_t *boxes, size_t count, const pixman_box32_t& clip)
+{
+    const v4si clip_v = load_box(clip);
+    for (size_t i = 0; i < count; i++)
+    {
+        const v4si v = load_box(boxes[i]);
+        const v4si greater = v > clip_v;
+        const v4si max     = select(greater, v, clip_v);
+        const v4si min     = select(greater, clip_v, v);
+        store_box(boxes[i], select(lower_lanes, max, min));
+    }
+}
+
+void wf::scale_boxes(pixman_box32_t *boxes, size_t count, double scale, wf::pointf_t offset)
+{
+    const v4df offset_v = {offset.x, offset.y, offset.x, offset.y};
+    for (size_t i = 0; i < count; i++)
+    {
+        const v4df v = (__builtin_convertvector(load_box(boxes[i]), v4df) + offset_v) * scale;
+        store_box(boxes[i], round_outwards(v));
+    }
+}
+
+void wf::transform_boxes(pixman_box32_t *boxes, size_t count, const affine_2d_t& transform)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto& box = boxes[i];
+        // The four corners of the box.
+        const v4df xs = {(double)box.x1, (double)box.x2, (double)box.x1, (double)box.x2};
+        const v4df ys = {(double)box.y1, (double)box.y1, (double)box.y2, (double)box.y2};
+        const v4df tx = transform.xx * xs + transform.xy * ys + transform.x0;
+        const v4df ty = transform.yx * xs + transform.yy * ys + transform.y0;
+
+        const v4df bbox = {
+            std::min({tx[0], tx[1], tx[2], tx[3]}),
+            std::min({ty[0], ty[1], ty[2], ty[3]}),
+            std::max({tx[0], tx[1], tx[2], tx[3]}),
+            std::max({ty[0], ty[1], ty[2], ty[3]}),
+        };
+        store_box(boxes[i], round_outwards(bbox));
+    }
+}
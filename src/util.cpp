@@ -12,6 +12,11 @@ int64_t wf::timespec_to_msec(const timespec& ts)
     return ts.tv_sec * 1000ll + ts.tv_nsec / 1000000ll;
 }
 
+int64_t wf::timespec_to_usec(const timespec& ts)
+{
+    return ts.tv_sec * 1000'000ll + ts.tv_nsec / 1000ll;
+}
+
 int64_t wf::get_current_time()
 {
     timespec ts;
@@ -20,10 +25,12 @@ int64_t wf::get_current_time()
     return wf::timespec_to_msec(ts);
 }
 
-static void handle_idle_listener(void *data)
+int64_t wf::get_current_time_us()
 {
-    auto call = (wf::wl_idle_call*)(data);
-    call->execute();
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return wf::timespec_to_usec(ts);
 }
 
 static int handle_timeout(void *data)
@@ -34,7 +41,62 @@ static int handle_timeout(void *data)
 
 namespace wf
 {
-wl_idle_call::wl_idle_call() = default;
+/**
+ * The queue of scheduled idle calls, which are all dispatched from a single idle source.
+ */
+namespace
+{
+struct idle_queue_t
+{
+    wl_list calls;
+    wl_event_source *source     = nullptr;
+    wl_event_loop *source_loop = nullptr;
+    wl_listener on_loop_destroy;
+
+    idle_queue_t()
+    {
+        wl_list_init(&calls);
+        wl_list_init(&on_loop_destroy.link);
+        on_loop_destroy.notify = handle_loop_destroy;
+    }
+
+    static void handle_loop_destroy(wl_listener *listener, void*)
+    {
+        idle_queue_t *self = wl_container_of(listener, self, on_loop_destroy);
+        // The pending idle source (if any) is destroyed together with the loop.
+        self->source = nullptr;
+        self->source_loop = nullptr;
+        wl_list_remove(&listener->link);
+        wl_list_init(&listener->link);
+    }
+};
+
+idle_queue_t& get_idle_queue()
+{
+    static idle_queue_t queue;
+    return queue;
+}
+}
+
+void wl_idle_call::dispatch_queue(void*)
+{
+    auto& queue = get_idle_queue();
+    // Idle sources are removed automatically after they are dispatched.
+    queue.source = nullptr;
+
+    // Like libwayland, also run idle calls which are scheduled while dispatching.
+    while (!wl_list_empty(&queue.calls))
+    {
+        wl_idle_call *next = wl_container_of(queue.calls.next, next, link);
+        next->execute();
+    }
+}
+
+wl_idle_call::wl_idle_call()
+{
+    wl_list_init(&link);
+}
+
 wl_idle_call::~wl_idle_call()
 {
     disconnect();
@@ -50,13 +112,32 @@ wl_event_loop*wl_idle_call::loop = NULL;
 
 void wl_idle_call::run_once()
 {
-    if (!call || source)
+    if (!call || is_connected())
     {
         return;
     }
 
+    auto& queue   = get_idle_queue();
     auto use_loop = loop ?: get_core().ev_loop;
-    source = wl_event_loop_add_idle(use_loop, handle_idle_listener, this);
+    if (queue.source && (queue.source_loop != use_loop))
+    {
+        // The loop was replaced (only happens in tests).
+        wl_event_source_remove(queue.source);
+        queue.source = nullptr;
+    }
+
+    if (!queue.source)
+    {
+        queue.source = wl_event_loop_add_idle(use_loop, dispatch_queue, nullptr);
+        if (queue.source_loop != use_loop)
+        {
+            wl_list_remove(&queue.on_loop_destroy.link);
+            wl_event_loop_add_destroy_listener(use_loop, &queue.on_loop_destroy);
+            queue.source_loop = use_loop;
+        }
+    }
+
+    wl_list_insert(queue.calls.prev, &link);
 }
 
 void wl_idle_call::run_once(callback_t cb)
@@ -67,23 +148,18 @@ void wl_idle_call::run_once(callback_t cb)
 
 void wl_idle_call::disconnect()
 {
-    if (!source)
-    {
-        return;
-    }
-
-    wl_event_source_remove(source);
-    source = nullptr;
+    wl_list_remove(&link);
+    wl_list_init(&link);
 }
 
 bool wl_idle_call::is_connected() const
 {
-    return source;
+    return !wl_list_empty(&link);
 }
 
 void wl_idle_call::execute()
 {
-    source = nullptr;
+    disconnect();
     if (call)
     {
         call();
@@ -118,12 +194,13 @@ void wl_timer<Repeat>::set_timeout(uint32_t timeout_ms, callback_t call)
                 wl_event_source_timer_update(source, this->timeout);
             } else
             {
-                disconnect();
+                armed = false;
             }
         } else
         {
-            // Disconnect first, ensuring that if `this` is destroyed, we don't use it anymore.
-            disconnect();
+            // The timer has already expired, so it is enough to mark it as disarmed. Do this first, ensuring
+            // that if `this` is destroyed, we don't use it anymore.
+            armed = false;
             call();
         }
     };
@@ -134,24 +211,26 @@ void wl_timer<Repeat>::set_timeout(uint32_t timeout_ms, callback_t call)
         source = wl_event_loop_add_timer(get_core().ev_loop, handle_timeout, &execute);
     }
 
+    armed = true;
     wl_event_source_timer_update(source, timeout_ms);
 }
 
 template<bool Repeat>
 void wl_timer<Repeat>::disconnect()
 {
-    if (source)
+    // Keep the event source around, so that re-arming the timer does not need to allocate a new one.
+    if (source && armed)
     {
-        wl_event_source_remove(source);
+        wl_event_source_timer_update(source, 0);
     }
 
-    source = NULL;
+    armed = false;
 }
 
 template<bool Repeat>
 bool wl_timer<Repeat>::is_connected()
 {
-    return source != NULL;
+    return armed;
 }
 
 template class wl_timer<false>;
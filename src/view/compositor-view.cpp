@@ -16,11 +16,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <wayfire/signal-provider.hpp>
 
-static void render_colored_rect(const wf::render_target_t& fb,
+static void add_colored_rect(OpenGL::rectangle_batch_t& batch, const wf::region_t& damage,
     int x, int y, int w, int h, const wf::color_t& color)
 {
     wf::color_t premultiply{color.r * color.a, color.g * color.a, color.b * color.a, color.a};
-    OpenGL::render_rectangle({x, y, w, h}, premultiply, fb.get_orthographic_projection());
+    batch.add({x, y, w, h}, premultiply, damage);
 }
 
 class wf::color_rect_view_t::color_rect_node_t : public wf::scene::floating_inner_node_t
@@ -29,6 +29,10 @@ class wf::color_rect_view_t::color_rect_node_t : public wf::scene::floating_inne
     {
       public:
         using simple_render_instance_t::simple_render_instance_t;
+
+        // Kept between frames, to reuse its storage.
+        OpenGL::rectangle_batch_t batch;
+
         void render(const wf::render_target_t& target, const wf::region_t& region) override
         {
             auto view = self->_view.lock();
@@ -42,32 +46,30 @@ class wf::color_rect_view_t::color_rect_node_t : public wf::scene::floating_inne
             auto _border_color = view->_border_color;
             auto _color = view->_color;
 
+            /* Draw the border, making sure border parts don't overlap, otherwise
+             * we will get wrong corners if border has alpha != 1.0 */
+            // top
+            add_colored_rect(batch, region, geometry.x, geometry.y, geometry.width, border,
+                _border_color);
+            // bottom
+            add_colored_rect(batch, region, geometry.x, geometry.y + geometry.height - border,
+                geometry.width, border, _border_color);
+            // left
+            add_colored_rect(batch, region, geometry.x, geometry.y + border, border,
+                geometry.height - 2 * border, _border_color);
+            // right
+            add_colored_rect(batch, region, geometry.x + geometry.width - border,
+                geometry.y + border, border, geometry.height - 2 * border, _border_color);
+
+            /* Draw the inside of the rect */
+            add_colored_rect(batch, region, geometry.x + border, geometry.y + border,
+                geometry.width - 2 * border, geometry.height - 2 * border, _color);
+
+            // The rectangles are clipped to the damage already, so no scissor is needed.
             OpenGL::render_begin(target);
-            for (const auto& box : region)
-            {
-                target.logic_scissor(wlr_box_from_pixman_box(box));
-
-                /* Draw the border, making sure border parts don't overlap, otherwise
-                 * we will get wrong corners if border has alpha != 1.0 */
-                // top
-                render_colored_rect(target, geometry.x, geometry.y, geometry.width, border,
-                    _border_color);
-                // bottom
-                render_colored_rect(target, geometry.x, geometry.y + geometry.height - border,
-                    geometry.width, border, _border_color);
-                // left
-                render_colored_rect(target, geometry.x, geometry.y + border, border,
-                    geometry.height - 2 * border, _border_color);
-                // right
-                render_colored_rect(target, geometry.x + geometry.width - border,
-                    geometry.y + border, border, geometry.height - 2 * border, _border_color);
-
-                /* Draw the inside of the rect */
-                render_colored_rect(target, geometry.x + border, geometry.y + border,
-                    geometry.width - 2 * border, geometry.height - 2 * border, _color);
-            }
-
+            batch.render(target.get_orthographic_projection());
             OpenGL::render_end();
+            batch.clear();
         }
     };
 
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <optional>
 
 #include <wayfire/seat.hpp>
 #include <wayfire/workarea.hpp>
@@ -61,8 +62,13 @@ class wayfire_layer_shell_view : public wf::view_interface_t
 
     static std::shared_ptr<wayfire_layer_shell_view> create(wlr_layer_surface_v1 *lsurface);
     std::unique_ptr<wf::output_workarea_manager_t::anchored_area> anchored_area;
+    // The available workarea passed to the anchored area when it was last reflowed.
+    wf::geometry_t anchored_workarea = {0, 0, 0, 0};
     void remove_anchored(bool reflow);
 
+    // The box the view was last configured with, see configure().
+    std::optional<wf::geometry_t> last_configured;
+
     virtual ~wayfire_layer_shell_view() = default;
 
     void map();
@@ -255,6 +261,7 @@ struct wf_layer_shell_manager
                 std::make_unique<wf::output_workarea_manager_t::anchored_area>();
             v->anchored_area->reflowed = [this, v] (wf::geometry_t avail_workarea)
             {
+                v->anchored_workarea = avail_workarea;
                 pin_view(v, avail_workarea);
             };
             /* Notice that the reflowed areas won't be changed until we call
@@ -359,6 +366,47 @@ struct wf_layer_shell_manager
         view->get_output()->workarea->reflow_reserved_areas();
     }
 
+    /**
+     * Arrange a single mapped view after its anchor, size, margin or exclusive zone changed.
+     *
+     * The other views on the output depend on the view only through its reserved area. If that did not
+     * change, the workarea stays the same and only the view itself has to be placed again.
+     */
+    void arrange_view(wayfire_layer_shell_view *view)
+    {
+        auto output = view->get_output();
+        const bool had_area = !!view->anchored_area;
+        const auto old_edge = view->anchored_area ? view->anchored_area->edge :
+            wf::output_workarea_manager_t::ANCHORED_EDGE_TOP;
+        const int old_size = view->anchored_area ? view->anchored_area->reserved_size : 0;
+
+        if (view->lsurface->pending.exclusive_zone > 0)
+        {
+            set_exclusive_zone(view);
+        } else
+        {
+            view->remove_anchored(false);
+        }
+
+        const auto new_edge = view->anchored_area ? view->anchored_area->edge :
+            wf::output_workarea_manager_t::ANCHORED_EDGE_TOP;
+        const int new_size = view->anchored_area ? view->anchored_area->reserved_size : 0;
+        if ((old_edge != new_edge) || (old_size != new_size) || (had_area != !!view->anchored_area))
+        {
+            LOGC(LSHELL, "Reserved area of ", view->self(), " changed, rearranging ", output->to_string());
+            arrange_layers(output);
+            return;
+        }
+
+        if (view->anchored_area)
+        {
+            pin_view(view, view->anchored_workarea);
+        } else
+        {
+            pin_view(view, output->workarea->get_workarea());
+        }
+    }
+
     void arrange_layers(wf::output_t *output)
     {
         const auto layers = {
@@ -558,14 +606,22 @@ void wayfire_layer_shell_view::commit()
             wf::scene::readd_front(get_output()->node_for_layer(get_layer()), get_root_node());
             /* Will also trigger reflowing */
             wf_layer_shell_manager::get_instance().handle_move_layer(this);
-        } else
+        } else if ((prev_state.anchor != state->anchor) ||
+                   (prev_state.exclusive_zone != state->exclusive_zone) ||
+                   (prev_state.desired_width != state->desired_width) ||
+                   (prev_state.desired_height != state->desired_height) ||
+                   (prev_state.margin.top != state->margin.top) ||
+                   (prev_state.margin.bottom != state->margin.bottom) ||
+                   (prev_state.margin.left != state->margin.left) ||
+                   (prev_state.margin.right != state->margin.right))
         {
-            /* Reflow reserved areas and positions */
-            wf_layer_shell_manager::get_instance().arrange_layers(get_output());
+            /* Reflow reserved areas and positions, if they are affected */
+            wf_layer_shell_manager::get_instance().arrange_view(this);
         }
 
         if (prev_state.keyboard_interactive != state->keyboard_interactive)
         {
+            wf::scene::invalidate_keyboard_refocus();
             if ((state->keyboard_interactive == 1) && (state->layer >= ZWLR_LAYER_SHELL_V1_LAYER_TOP))
             {
                 wf::get_core().seat->focus_view(self());
@@ -633,6 +689,16 @@ void wayfire_layer_shell_view::configure(wf::geometry_t box)
         close();
     }
 
+    // Arranging the layers configures all views on the output. Mapped views which keep their box do not
+    // need a new configure, which would only make the client commit again. Unmapped views must be
+    // configured in response to every initial commit.
+    if (is_mapped() && (last_configured == box))
+    {
+        return;
+    }
+
+    last_configured = box;
+
     // TODO: transactions here could make sense, since we want to change x,y,w,h together, but have to wait
     // for the client to resize.
     move(box.x, box.y);
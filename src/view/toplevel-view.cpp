@@ -333,16 +333,9 @@ wayfire_toplevel_view wf::find_view_for_toplevel(
     std::shared_ptr<wf::toplevel_t> toplevel)
 {
     // FIXME: this could be a lot more efficient if we simply store a custom data on the toplevel.
-    for (auto& view : wf::get_core().get_all_views())
+    return toplevel_cast(wf::get_core().find_view([&] (wayfire_view view)
     {
-        if (auto tview = toplevel_cast(view))
-        {
-            if (tview->toplevel() == toplevel)
-            {
-                return tview;
-            }
-        }
-    }
-
-    return nullptr;
+        auto tview = toplevel_cast(view);
+        return tview && (tview->toplevel() == toplevel);
+    }));
 }
@@ -2,6 +2,7 @@
 #include <wayfire/scene.hpp>
 #include <wayfire/unstable/translation-node.hpp>
 #include <wayfire/debug.hpp>
+#include <wayfire/option-wrapper.hpp>
 
 wf::scene::translation_node_t::translation_node_t(bool is_structure) :
     wf::scene::floating_inner_node_t(is_structure)
@@ -95,7 +96,17 @@ void wf::scene::translation_node_instance_t::schedule_instructions(
     std::vector<wf::scene::render_instruction_t>& instructions,
     const wf::render_target_t& target, wf::region_t& damage)
 {
-    wf::region_t our_damage = damage & self->get_bounding_box();
+    static wf::option_wrapper_t<bool> use_opaque_optimizations{
+        "workarounds/enable_opaque_region_damage_optimizations"
+    };
+
+    if (use_opaque_optimizations && fully_occluded)
+    {
+        // Skip the whole subtree, nothing of it is visible on the output.
+        return;
+    }
+
+    wf::region_t our_damage = damage & self->get_cached_bounding_box();
     if (!our_damage.empty())
     {
         wf::point_t offset = self->get_offset();
@@ -135,7 +146,18 @@ wf::scene::direct_scanout wf::scene::translation_node_instance_t::try_scanout(wf
     return try_scanout_from_list(this->children, output);
 }
 
+bool wf::scene::translation_node_instance_t::can_render_transformed()
+{
+    return can_render_transformed_list(children);
+}
+
+int wf::scene::translation_node_instance_t::get_alpha_layer_count()
+{
+    return get_alpha_layer_count_list(children);
+}
+
 void wf::scene::translation_node_instance_t::compute_visibility(wf::output_t *output, wf::region_t& visible)
 {
+    fully_occluded = (visible & self->get_cached_bounding_box()).empty();
     compute_visibility_from_list(children, output, visible, self->get_offset());
 }
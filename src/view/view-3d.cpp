@@ -9,9 +9,9 @@
 #include "wayfire/opengl.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/output.hpp"
+#include "wayfire/signal-definitions.hpp"
 #include <glm/ext/matrix_transform.hpp>
 #include <string>
-#include <tuple>
 #include <wayfire/view.hpp>
 #include <algorithm>
 #include <cmath>
@@ -100,6 +100,12 @@ view_2d_transformer_t::view_2d_transformer_t(wayfire_view view) :
     transformer_base_node_t(false)
 {
     this->view = view->weak_from_this();
+    if (toplevel_cast(view))
+    {
+        center_tracked = true;
+        on_geometry_changed = [=] (wf::view_geometry_changed_signal*) { center_dirty = true; };
+        view->connect(&on_geometry_changed);
+    }
 }
 
 static wf::pointf_t get_center(wf::geometry_t view)
@@ -127,38 +133,54 @@ static wf::pointf_t get_center(std::weak_ptr<wf::view_interface_t> _view)
     }
 }
 
-static void rotate_xy(double& x, double& y, double angle)
+const view_2d_transformer_t::cached_transform_t& view_2d_transformer_t::get_cached_transform()
 {
-    const auto cs = std::cos(angle);
-    const auto sn = std::sin(angle);
-    std::tie(x, y) = std::make_tuple(cs * x - sn * y, sn * x + cs * y);
+    if (!center_tracked || center_dirty)
+    {
+        auto center = get_center(view);
+        cache.valid &= (center.x == cache.center.x) && (center.y == cache.center.y);
+        cache.center = center;
+        center_dirty = false;
+    }
+
+    if (cache.valid && (cache.scale_x == scale_x) && (cache.scale_y == scale_y) &&
+        (cache.translation_x == translation_x) && (cache.translation_y == translation_y) &&
+        (cache.angle == angle))
+    {
+        return cache;
+    }
+
+    cache.scale_x = scale_x;
+    cache.scale_y = scale_y;
+    cache.translation_x = translation_x;
+    cache.translation_y = translation_y;
+    cache.angle = angle;
+    cache.valid = true;
+
+    // global = R(-angle) * S * (local - center) + center + translation
+    const double cs = std::cos(angle);
+    const double sn = std::sin(angle);
+    const auto& c   = cache.center;
+    glm::dmat3 to_origin{1, 0, 0, 0, 1, 0, -c.x, -c.y, 1};
+    glm::dmat3 scale{scale_x, 0, 0, 0, scale_y, 0, 0, 0, 1};
+    glm::dmat3 rotate{cs, -sn, 0, sn, cs, 0, 0, 0, 1};
+    glm::dmat3 from_origin{1, 0, 0, 0, 1, 0, c.x + translation_x, c.y + translation_y, 1};
+
+    cache.forward = from_origin * rotate * scale * to_origin;
+    cache.inverse = glm::inverse(cache.forward);
+    return cache;
 }
 
 wf::pointf_t view_2d_transformer_t::to_local(const wf::pointf_t& point)
 {
-    auto midpoint = get_center(view);
-    auto result   = point - midpoint;
-    result.x -= translation_x;
-    result.y -= translation_y;
-    rotate_xy(result.x, result.y, angle);
-    result.x /= scale_x;
-    result.y /= scale_y;
-    result   += midpoint;
-    return result;
+    auto result = get_cached_transform().inverse * glm::dvec3{point.x, point.y, 1.0};
+    return {result.x, result.y};
 }
 
 wf::pointf_t view_2d_transformer_t::to_global(const wf::pointf_t& point)
 {
-    auto midpoint = get_center(view);
-    auto result   = point - midpoint;
-
-    result.x *= scale_x;
-    result.y *= scale_y;
-    rotate_xy(result.x, result.y, -angle);
-    result.x += translation_x;
-    result.y += translation_y;
-
-    return result + midpoint;
+    auto result = get_cached_transform().forward * glm::dvec3{point.x, point.y, 1.0};
+    return {result.x, result.y};
 }
 
 std::string view_2d_transformer_t::stringify() const
@@ -177,26 +199,124 @@ wf::geometry_t view_2d_transformer_t::get_bounding_box()
     return get_bbox_for_node(this, get_children_bounding_box());
 }
 
+wf::affine_2d_t view_2d_transformer_t::get_affine_transform()
+{
+    const auto& forward = get_cached_transform().forward;
+    return {
+        forward[0][0], forward[1][0], forward[2][0],
+        forward[0][1], forward[1][1], forward[2][1],
+    };
+}
+
 static void transform_linear_damage(node_t *self, wf::region_t& damage)
 {
-    auto copy = damage;
-    damage.clear();
-    for (auto& box : copy)
+    std::vector<pixman_box32_t> boxes;
+    boxes.reserve(damage.end() - damage.begin());
+    for (auto& box : damage)
     {
-        damage |=
-            get_bbox_for_node(self, wlr_box_from_pixman_box(box));
+        boxes.push_back(pixman_box_from_wlr_box(get_bbox_for_node(self, wlr_box_from_pixman_box(box))));
     }
+
+    damage = wf::region_t{boxes.data(), (int)boxes.size()};
+}
+
+static void transform_affine_damage(const wf::affine_2d_t& transform, wf::region_t& damage)
+{
+    std::vector<pixman_box32_t> boxes(damage.begin(), damage.end());
+    wf::transform_boxes(boxes.data(), boxes.size(), transform);
+    damage = wf::region_t{boxes.data(), (int)boxes.size()};
+}
+
+// A full turn (for example after rotating a view with wrot) is the same as no rotation.
+static bool is_full_turn(float angle)
+{
+    const double turns = angle / (2 * M_PI);
+    return std::abs(turns - std::round(turns)) < 1e-4;
 }
 
 class view_2d_render_instance_t :
     public transformer_render_instance_t<view_2d_transformer_t>
 {
+    /**
+     * Translation and uniform scaling can be expressed as a render target for the children, so they can be
+     * rendered directly instead of through an auxiliary buffer. Opacity can be applied this way only if the
+     * children paint a single surface, since overlapping surfaces (for example subsurfaces) would show
+     * through each other.
+     */
+    bool can_render_direct()
+    {
+        return is_full_turn(self->angle) && (self->scale_x == self->scale_y) && (self->scale_x > 0) &&
+               ((self->alpha == 1.0f) || (get_alpha_layer_count_list(children) == 1)) &&
+               can_render_transformed_list(children);
+    }
+
+    void schedule_direct(std::vector<render_instruction_t>& instructions,
+        const wf::render_target_t& target, const wf::region_t& damage)
+    {
+        // The children are rendered directly, so the auxiliary buffer is not needed.
+        self->release_buffers();
+
+        // global = scale * (local - midpoint) + midpoint + translation
+        const double scale = self->scale_x;
+        const auto midpoint = get_center(self->view);
+        const wf::pointf_t offset = {
+            midpoint.x * (1 - scale) + self->translation_x,
+            midpoint.y * (1 - scale) + self->translation_y,
+        };
+
+        // The damage of the children has to be rounded outwards, so each box gets its own clipped target to
+        // avoid painting outside of the damage.
+        for (const auto& rect : damage)
+        {
+            auto box = wlr_box_from_pixman_box(rect);
+            auto child_target = target.clipped(box).transformed(scale, offset);
+            child_target.alpha *= self->alpha;
+
+            const int x1 = std::floor((box.x - offset.x) / scale);
+            const int y1 = std::floor((box.y - offset.y) / scale);
+            const int x2 = std::ceil((box.x + box.width - offset.x) / scale);
+            const int y2 = std::ceil((box.y + box.height - offset.y) / scale);
+            wf::region_t child_damage = wlr_box{x1, y1, x2 - x1, y2 - y1};
+
+            for (auto& ch : children)
+            {
+                ch->schedule_instructions(instructions, child_target, child_damage);
+            }
+        }
+    }
+
   public:
     using transformer_render_instance_t::transformer_render_instance_t;
 
     void transform_damage_region(wf::region_t& damage) override
     {
-        transform_linear_damage(self.get(), damage);
+        transform_affine_damage(self->get_affine_transform(), damage);
+    }
+
+    void schedule_instructions(std::vector<render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        if (!can_render_direct())
+        {
+            transformer_render_instance_t::schedule_instructions(instructions, target, damage);
+            return;
+        }
+
+        auto our_damage = damage & self->get_cached_bounding_box();
+        if (!our_damage.empty())
+        {
+            schedule_direct(instructions, target, our_damage);
+        }
+    }
+
+    bool can_render_transformed() override
+    {
+        return true;
+    }
+
+    int get_alpha_layer_count() override
+    {
+        return can_render_direct() ? get_alpha_layer_count_list(children) : -1;
     }
 
     void render(const wf::render_target_t& target,
@@ -230,6 +350,21 @@ class view_2d_render_instance_t :
 
         OpenGL::render_end();
     }
+
+    direct_scanout try_scanout(wf::output_t *output) override
+    {
+        // Buffers cannot be scanned out with any other rotation than a full turn, see
+        // wlr_surface_node_t::try_scanout().
+        const bool is_identity = is_full_turn(self->angle) &&
+            (self->scale_x == 1.0f) && (self->scale_y == 1.0f) &&
+            (self->translation_x == 0.0f) && (self->translation_y == 0.0f) && (self->alpha == 1.0f);
+        if (!is_identity)
+        {
+            return direct_scanout::OCCLUSION;
+        }
+
+        return try_scanout_from_list(children, output);
+    }
 };
 
 void view_2d_transformer_t::gen_render_instances(
@@ -284,14 +419,27 @@ static wf::pointf_t get_absolute_coords_from_relative(wf::geometry_t view,
     };
 }
 
-/* TODO: cache total_transform, because it is often unnecessarily recomputed */
 glm::mat4 view_3d_transformer_t::calculate_total_transform()
 {
     auto bbox   = get_children_bounding_box();
     float scale = std::max(bbox.width, bbox.height);
     scale = std::max(scale, 1.0f);
+
+    if (cache.valid && (cache.depth == scale) && (cache.translation == translation) &&
+        (cache.view_proj == view_proj) && (cache.rotation == rotation) && (cache.scaling == scaling))
+    {
+        return cache.total;
+    }
+
     glm::mat4 depth_scale = glm::scale(glm::mat4(1.0), {1, 1, 2.0 / scale});
-    return translation * view_proj * depth_scale * rotation * scaling;
+    cache.view_proj   = view_proj;
+    cache.translation = translation;
+    cache.rotation    = rotation;
+    cache.scaling     = scaling;
+    cache.depth = scale;
+    cache.total = translation * view_proj * depth_scale * rotation * scaling;
+    cache.valid = true;
+    return cache.total;
 }
 
 wf::pointf_t view_3d_transformer_t::to_local(const wf::pointf_t& point)
@@ -17,8 +17,15 @@
 #include <wayfire/view-helpers.hpp>
 #include <wayfire/scene-operations.hpp>
 
+static uint64_t mapped_state_generation = 1;
+uint64_t wf::get_mapped_state_generation()
+{
+    return mapped_state_generation;
+}
+
 void wf::view_implementation::emit_view_map_signal(wayfire_view view, bool has_position)
 {
+    ++mapped_state_generation;
     wf::view_mapped_signal data;
     data.view = view;
     data.is_positioned = has_position;
@@ -42,6 +49,7 @@ void wf::view_implementation::emit_ping_timeout_signal(wayfire_view view)
 void wf::view_implementation::emit_geometry_changed_signal(wayfire_toplevel_view view,
     wf::geometry_t old_geometry)
 {
+    wf::scene::invalidate_keyboard_refocus();
     wf::view_geometry_changed_signal data;
     data.view = view;
     data.old_geometry = old_geometry;
@@ -61,6 +69,7 @@ void wf::view_interface_t::emit_view_map()
 
 void wf::view_interface_t::emit_view_unmap()
 {
+    ++mapped_state_generation;
     view_unmapped_signal data;
     data.view = self();
 
@@ -440,6 +449,18 @@ void wf::fini_desktop_apis()
     // xwayland destroyed separately by core
 }
 
+static uint64_t suppressed_configures = 0;
+
+void wf::count_suppressed_configure()
+{
+    ++suppressed_configures;
+}
+
+uint64_t wf::get_suppressed_configure_count()
+{
+    return suppressed_configures;
+}
+
 void wf::adjust_view_pending_geometry_on_start_map(wf::toplevel_view_interface_t *self,
     wf::geometry_t map_geometry_client, bool map_fs, bool map_maximized)
 {
@@ -54,6 +54,12 @@ class view_interface_t::view_priv_impl
     wf::signal::connection_t<destruct_signal<view_interface_t>> pre_free;
 };
 
+/**
+ * A counter which is incremented whenever a view is mapped or unmapped. It is bumped before any of the map
+ * and unmap signals are emitted, so that caches keyed on it are already stale in every signal handler.
+ */
+uint64_t get_mapped_state_generation();
+
 /**
  * Adjust the position of the view according to the new size of its buffer and the geometry.
  */
@@ -78,6 +84,31 @@ void xwayland_update_default_cursor();
 void xwayland_bring_to_front(wlr_surface *surface);
 int xwayland_get_pid();
 
+struct xwayland_stats_t
+{
+    // Whether Xwayland is started on the first X11 client connection.
+    bool lazy = false;
+    // Whether Xwayland was started ahead of the first client, see core/xwayland_prewarm.
+    bool prewarmed = false;
+    // Whether the Xwayland server has been started.
+    bool started = false;
+    // The time from starting the server until it was ready to accept clients, or -1.
+    double startup_latency_ms = -1;
+    // The time from starting the compositor until the first X11 window was created, or -1.
+    double first_surface_ms = -1;
+    // The resident memory of the Xwayland server, or -1 if it is not running.
+    int64_t memory_kb = -1;
+};
+
+xwayland_stats_t xwayland_get_stats();
+
+/**
+ * Record a configure which was not sent to a client because it would not have changed its state, see
+ * core/skip_noop_configures.
+ */
+void count_suppressed_configure();
+uint64_t get_suppressed_configure_count();
+
 void init_desktop_apis();
 void fini_desktop_apis();
 void init_xdg_decoration_handlers();
@@ -11,6 +11,7 @@
 #include "wayfire/scene.hpp"
 #include "wayfire/view.hpp"
 #include "wayfire/view-transform.hpp"
+#include "wayfire/unstable/translation-node.hpp"
 #include "wayfire/workspace-set.hpp"
 #include "wayfire/render-manager.hpp"
 #include "xdg-shell.hpp"
@@ -104,6 +105,10 @@ void wf::view_interface_t::take_snapshot(wf::render_target_t& target)
     const wf::geometry_t bbox = root_node->get_bounding_box();
     float scale = get_output()->handle->scale;
 
+    OpenGL::gpu_memory_scope_t memory_scope{[this] ()
+    {
+        return OpenGL::gpu_memory_owner_t{"view-snapshot", get_id()};
+    }};
     OpenGL::render_begin();
     target.allocate(bbox.width * scale, bbox.height * scale);
     OpenGL::render_end();
@@ -153,10 +158,14 @@ void wf::view_interface_t::set_surface_root_node(scene::floating_inner_ptr surfa
     priv->transformed_node->set_children_list({surface_root_node});
 }
 
-class view_root_node_t : public wf::scene::floating_inner_node_t, public wf::view_node_tag_t
+/**
+ * The root node of a view. It is a translation node (with a zero offset) so that adding or removing popups,
+ * dialogs and transformers regenerates only the render instances of the view and not the whole scenegraph.
+ */
+class view_root_node_t : public wf::scene::translation_node_t, public wf::view_node_tag_t
 {
   public:
-    view_root_node_t(wf::view_interface_t *_view) : floating_inner_node_t(false),
+    view_root_node_t(wf::view_interface_t *_view) : translation_node_t(false),
         view_node_tag_t(_view), view(_view->weak_from_this())
     {}
 
@@ -240,6 +249,18 @@ wayfire_view wf::node_to_view(wf::scene::node_ptr node)
     return node_to_view(node.get());
 }
 
+OpenGL::gpu_memory_owner_t wf::scene::gpu_memory_owner_of(node_t *node, std::string name)
+{
+    OpenGL::gpu_memory_owner_t owner;
+    owner.name = name.empty() ? node->stringify() : std::move(name);
+    if (auto view = node_to_view(node))
+    {
+        owner.view_id = view->get_id();
+    }
+
+    return owner;
+}
+
 wl_client*wf::view_interface_t::get_client()
 {
     if (get_wlr_surface())
@@ -2,9 +2,13 @@
 #include "wayfire/scene-operations.hpp"
 #include "wayfire/scene.hpp"
 #include "wayfire/unstable/wlr-subsurface-controller.hpp"
+#include "wayfire/unstable/wlr-surface-controller.hpp"
 #include "wayfire/unstable/wlr-surface-node.hpp"
+#include <algorithm>
 #include <memory>
 #include <wayfire/debug.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/signal-provider.hpp>
 
 wf::wlr_subsurface_controller_t::wlr_subsurface_controller_t(wlr_subsurface *sub)
 {
@@ -56,7 +60,13 @@ wf::wlr_subsurface_root_node_t::wlr_subsurface_root_node_t(wlr_subsurface *subsu
     this->subsurface = subsurface;
     this->on_subsurface_commit.set_callback([=] (void*)
     {
-        update_offset();
+        if (auto controller = wlr_surface_controller_t::get_batching_controller(this->subsurface->surface))
+        {
+            controller->defer_subsurface_offset(this);
+        } else
+        {
+            update_offset();
+        }
     });
 
     this->on_subsurface_destroy.set_callback([=] (void*)
@@ -82,6 +92,12 @@ bool wf::wlr_subsurface_root_node_t::update_offset(bool apply_damage)
     wf::point_t offset = {subsurface->current.x, subsurface->current.y};
     const bool changed = offset != get_offset();
 
+    if (changed)
+    {
+        // The flattened hit-testing lists store the offsets of nested subsurfaces.
+        scene::invalidate_hit_test_cache();
+    }
+
     if (changed && apply_damage)
     {
         scene::damage_node(this, get_bounding_box());
@@ -97,3 +113,337 @@ bool wf::wlr_subsurface_root_node_t::update_offset(bool apply_damage)
 
     return changed;
 }
+
+namespace
+{
+using wf::wlr_subsurface_root_node_t;
+using nested_chain_t = std::vector<wlr_subsurface_root_node_t*>;
+
+bool use_flattening()
+{
+    static wf::option_wrapper_t<bool> flatten_subsurfaces{"core/flatten_subsurfaces"};
+    return flatten_subsurfaces;
+}
+
+wf::point_t get_chain_offset(const nested_chain_t& chain)
+{
+    wf::point_t offset = {0, 0};
+    for (auto& node : chain)
+    {
+        offset = offset + node->get_offset();
+    }
+
+    return offset;
+}
+
+/**
+ * Walk through the enabled nodes below a subsurface root and call @leaf for each node which is not a
+ * subsurface root itself, front to back, with the nested subsurface roots leading to it. @nested is called
+ * for each nested subsurface root, with the subsurface roots leading to its parent.
+ */
+template<class LeafCallback, class NestedCallback>
+void for_each_flattened_node(wf::scene::node_t *root, nested_chain_t& chain,
+    LeafCallback leaf, NestedCallback nested)
+{
+    for (auto& ch : root->get_children())
+    {
+        if (!ch->is_enabled())
+        {
+            continue;
+        }
+
+        if (auto sub = dynamic_cast<wlr_subsurface_root_node_t*>(ch.get()))
+        {
+            nested(sub, chain);
+            chain.push_back(sub);
+            for_each_flattened_node(sub, chain, leaf, nested);
+            chain.pop_back();
+        } else
+        {
+            leaf(ch.get(), chain);
+        }
+    }
+}
+
+/**
+ * A render instance for a whole tree of subsurfaces. The render instances of the surfaces in the tree are kept
+ * in a flat list, and the offsets of the nested subsurfaces are applied to each of them directly, instead of
+ * going through one translation instance per nested subsurface.
+ */
+class flattened_subsurface_instance_t : public wf::scene::render_instance_t
+{
+    struct entry_t
+    {
+        // The nested subsurface roots between the top-level subsurface root and the instance.
+        nested_chain_t chain;
+        wf::scene::render_instance_uptr instance;
+    };
+
+    std::shared_ptr<wlr_subsurface_root_node_t> self;
+    wf::scene::damage_callback push_damage;
+    wf::output_t *shown_on;
+    std::vector<entry_t> entries;
+
+    // The nested subsurface roots are kept alive so that the chains of the entries stay valid until the next
+    // regeneration.
+    std::vector<std::shared_ptr<wf::scene::node_t>> nested_nodes;
+    std::vector<std::unique_ptr<wf::signal::connection_t<wf::scene::node_damage_signal>>> on_nested_damage;
+    wf::signal::connection_t<wf::scene::node_damage_signal> on_node_damage;
+    wf::signal::connection_t<wf::scene::node_regen_instances_signal> on_regen_instances;
+    bool fully_occluded = false;
+
+    wf::point_t get_entry_offset(const entry_t& entry)
+    {
+        return self->get_offset() + get_chain_offset(entry.chain);
+    }
+
+    void regen_instances()
+    {
+        entries.clear();
+        on_nested_damage.clear();
+        auto old_nested = std::move(nested_nodes);
+        nested_nodes.clear();
+
+        nested_chain_t path;
+        for_each_flattened_node(self.get(), path, [&] (wf::scene::node_t *node, const nested_chain_t& chain)
+        {
+            auto push_damage_child = [=] (wf::region_t child_damage)
+            {
+                child_damage += self->get_offset() + get_chain_offset(chain);
+                push_damage(child_damage);
+            };
+
+            std::vector<wf::scene::render_instance_uptr> instances;
+            node->gen_render_instances(instances, push_damage_child, shown_on);
+            for (auto& instance : instances)
+            {
+                entries.push_back({chain, std::move(instance)});
+            }
+        }, [&] (wlr_subsurface_root_node_t *nested, const nested_chain_t& chain)
+        {
+            // Nested subsurface roots damage themselves in the coordinates of their parent.
+            auto on_damage = std::make_unique<wf::signal::connection_t<wf::scene::node_damage_signal>>(
+                [=] (wf::scene::node_damage_signal *data)
+            {
+                push_damage(data->region + self->get_offset() + get_chain_offset(chain));
+            });
+
+            nested->connect(on_damage.get());
+            on_nested_damage.push_back(std::move(on_damage));
+            nested_nodes.push_back(nested->shared_from_this());
+        });
+
+        // This may run while one of the nested roots emits the regeneration signal, so the connection is
+        // only updated for the roots which were added to or removed from the tree.
+        for (auto& node : old_nested)
+        {
+            if (std::find(nested_nodes.begin(), nested_nodes.end(), node) == nested_nodes.end())
+            {
+                node->disconnect(&on_regen_instances);
+            }
+        }
+
+        for (auto& node : nested_nodes)
+        {
+            if (std::find(old_nested.begin(), old_nested.end(), node) == old_nested.end())
+            {
+                node->connect(&on_regen_instances);
+            }
+        }
+    }
+
+  public:
+    flattened_subsurface_instance_t(wlr_subsurface_root_node_t *self,
+        wf::scene::damage_callback push_damage, wf::output_t *shown_on)
+    {
+        this->self = std::dynamic_pointer_cast<wlr_subsurface_root_node_t>(self->shared_from_this());
+        this->push_damage = push_damage;
+        this->shown_on    = shown_on;
+
+        on_node_damage = [=] (wf::scene::node_damage_signal *data)
+        {
+            push_damage(data->region);
+        };
+        self->connect(&on_node_damage);
+
+        on_regen_instances = [=] (auto)
+        {
+            regen_instances();
+        };
+        self->connect(&on_regen_instances);
+        regen_instances();
+    }
+
+    void schedule_instructions(std::vector<wf::scene::render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        static wf::option_wrapper_t<bool> use_opaque_optimizations{
+            "workarounds/enable_opaque_region_damage_optimizations"
+        };
+
+        if ((use_opaque_optimizations && fully_occluded) ||
+            (damage & self->get_cached_bounding_box()).empty())
+        {
+            return;
+        }
+
+        // Surfaces next to each other usually share their offset, so damage and target are translated only
+        // when it changes.
+        wf::point_t applied = {0, 0};
+        auto entry_target   = target;
+        for (auto& entry : entries)
+        {
+            const wf::point_t offset = get_entry_offset(entry);
+            if (offset != applied)
+            {
+                damage += applied - offset;
+                entry_target = target.translated(-offset);
+                applied = offset;
+            }
+
+            entry.instance->schedule_instructions(instructions, entry_target, damage);
+        }
+
+        damage += applied;
+    }
+
+    void render(const wf::render_target_t& target, const wf::region_t& region) override
+    {
+        wf::dassert(false, "Rendering a flattened subsurface tree?");
+    }
+
+    void presentation_feedback(wf::output_t *output) override
+    {
+        for (auto& entry : entries)
+        {
+            entry.instance->presentation_feedback(output);
+        }
+    }
+
+    wf::scene::direct_scanout try_scanout(wf::output_t *output) override
+    {
+        for (auto& entry : entries)
+        {
+            if (get_entry_offset(entry) != wf::point_t{0, 0})
+            {
+                return wf::scene::direct_scanout::OCCLUSION;
+            }
+
+            auto res = entry.instance->try_scanout(output);
+            if (res != wf::scene::direct_scanout::SKIP)
+            {
+                return res;
+            }
+        }
+
+        return wf::scene::direct_scanout::SKIP;
+    }
+
+    void compute_visibility(wf::output_t *output, wf::region_t& visible) override
+    {
+        fully_occluded = (visible & self->get_cached_bounding_box()).empty();
+
+        wf::point_t applied = {0, 0};
+        for (auto& entry : entries)
+        {
+            const wf::point_t offset = get_entry_offset(entry);
+            if (offset != applied)
+            {
+                visible += applied - offset;
+                applied = offset;
+            }
+
+            entry.instance->compute_visibility(output, visible);
+        }
+
+        visible += applied;
+    }
+
+    bool can_render_transformed() override
+    {
+        return std::all_of(entries.begin(), entries.end(), [] (const entry_t& entry)
+        {
+            return entry.instance->can_render_transformed();
+        });
+    }
+
+    int get_alpha_layer_count() override
+    {
+        int total = 0;
+        for (auto& entry : entries)
+        {
+            const int count = entry.instance->get_alpha_layer_count();
+            if (count < 0)
+            {
+                return -1;
+            }
+
+            total += count;
+        }
+
+        return total;
+    }
+};
+}
+
+void wf::wlr_subsurface_root_node_t::gen_render_instances(
+    std::vector<scene::render_instance_uptr>& instances,
+    scene::damage_callback damage, wf::output_t *output)
+{
+    if (!use_flattening())
+    {
+        translation_node_t::gen_render_instances(instances, damage, output);
+        return;
+    }
+
+    instances.push_back(std::make_unique<flattened_subsurface_instance_t>(this, damage, output));
+}
+
+void wf::wlr_subsurface_root_node_t::rebuild_flat_input()
+{
+    flat_input.clear();
+    nested_chain_t chain;
+    for_each_flattened_node(this, chain, [&] (scene::node_t *node, const nested_chain_t& chain)
+    {
+        flat_input_entry_t entry;
+        entry.node   = node;
+        entry.offset = get_chain_offset(chain);
+        if (dynamic_cast<scene::wlr_surface_node_t*>(node))
+        {
+            entry.bbox = node->get_bounding_box() + entry.offset;
+        }
+
+        flat_input.push_back(entry);
+    }, [] (wlr_subsurface_root_node_t*, const nested_chain_t&) {});
+
+    flat_input_generation = scene::get_hit_test_generation();
+}
+
+std::optional<wf::scene::input_node_t> wf::wlr_subsurface_root_node_t::find_node_at(const wf::pointf_t& at)
+{
+    if (!use_flattening())
+    {
+        return translation_node_t::find_node_at(at);
+    }
+
+    if (flat_input_generation != scene::get_hit_test_generation())
+    {
+        rebuild_flat_input();
+    }
+
+    const auto local = to_local(at);
+    for (auto& entry : flat_input)
+    {
+        if (entry.bbox && !(*entry.bbox & local))
+        {
+            continue;
+        }
+
+        if (auto result = entry.node->find_node_at(local - wf::pointf_t{entry.offset}))
+        {
+            return result;
+        }
+    }
+
+    return {};
+}
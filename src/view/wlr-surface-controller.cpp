@@ -5,7 +5,10 @@
 #include "wayfire/unstable/wlr-surface-controller.hpp"
 #include "wayfire/unstable/wlr-surface-node.hpp"
 #include "wayfire/unstable/wlr-subsurface-controller.hpp"
+#include "wayfire/unstable/translation-node.hpp"
 #include <wayfire/scene-operations.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <algorithm>
 
 static void update_subsurface_position(wlr_surface *surface, int, int, void*)
 {
@@ -19,6 +22,43 @@ static void update_subsurface_position(wlr_surface *surface, int, int, void*)
     }
 }
 
+static bool use_commit_batching()
+{
+    static wf::option_wrapper_t<bool> batch_subsurface_commits{"core/batch_subsurface_commits"};
+    return batch_subsurface_commits;
+}
+
+static void defer_subsurface_position(wlr_surface *surface, int, int, void *data)
+{
+    if (wlr_subsurface *sub = wlr_subsurface_try_from_wlr_surface(surface))
+    {
+        if (sub->data)
+        {
+            auto sub_root = ((wf::wlr_subsurface_controller_t*)sub->data)->get_subsurface_root();
+            ((wf::wlr_surface_controller_t*)data)->defer_subsurface_offset(sub_root.get());
+        }
+    }
+}
+
+/**
+ * Whether the state of the subsurface is applied only when its parent's state is applied, either because the
+ * subsurface is in synchronized mode or because one of its ancestors is.
+ */
+static bool is_effectively_synchronized(wlr_subsurface *sub)
+{
+    while (sub)
+    {
+        if (sub->synchronized)
+        {
+            return true;
+        }
+
+        sub = sub->parent ? wlr_subsurface_try_from_wlr_surface(sub->parent) : nullptr;
+    }
+
+    return false;
+}
+
 wf::wlr_surface_controller_t::wlr_surface_controller_t(wlr_surface *surface,
     scene::floating_inner_ptr root_node)
 {
@@ -70,9 +110,16 @@ wf::wlr_surface_controller_t::wlr_surface_controller_t(wlr_surface *surface,
     {
         if (!wlr_subsurface_try_from_wlr_surface(surface))
         {
-            wlr_surface_for_each_surface(surface, update_subsurface_position, nullptr);
+            if (use_commit_batching())
+            {
+                wlr_surface_for_each_surface(surface, defer_subsurface_position, this);
+            } else
+            {
+                wlr_surface_for_each_surface(surface, update_subsurface_position, nullptr);
+            }
         }
 
+        apply_deferred_commits();
         update_subsurface_order_and_position();
     });
 
@@ -98,6 +145,175 @@ void wf::wlr_surface_controller_t::try_free_controller(wlr_surface *surface)
     }
 }
 
+wf::wlr_surface_controller_t*wf::wlr_surface_controller_t::get_batching_controller(wlr_surface *surface)
+{
+    if (!use_commit_batching())
+    {
+        return nullptr;
+    }
+
+    wlr_subsurface *sub = wlr_subsurface_try_from_wlr_surface(surface);
+    if (!sub || !is_effectively_synchronized(sub))
+    {
+        return nullptr;
+    }
+
+    // Go up to the first surface whose own commits are applied right away.
+    while (sub && is_effectively_synchronized(sub) && sub->parent)
+    {
+        surface = sub->parent;
+        sub     = wlr_subsurface_try_from_wlr_surface(surface);
+    }
+
+    return (wlr_surface_controller_t*)surface->data;
+}
+
+void wf::wlr_surface_controller_t::defer_surface_state(scene::wlr_surface_node_t *node)
+{
+    auto it = std::find_if(deferred_surfaces.begin(), deferred_surfaces.end(), [&] (const auto& other)
+    {
+        return other.lock().get() == node;
+    });
+
+    if (it == deferred_surfaces.end())
+    {
+        deferred_surfaces.push_back(node->weak_from_this());
+    }
+}
+
+void wf::wlr_surface_controller_t::defer_subsurface_offset(wlr_subsurface_root_node_t *node)
+{
+    auto it = std::find_if(deferred_subsurfaces.begin(), deferred_subsurfaces.end(), [&] (const auto& other)
+    {
+        return other.lock().get() == node;
+    });
+
+    if (it == deferred_subsurfaces.end())
+    {
+        deferred_subsurfaces.push_back(
+            std::dynamic_pointer_cast<wlr_subsurface_root_node_t>(node->shared_from_this()));
+    }
+}
+
+/**
+ * Convert a damage region of @node to the coordinates of the children of the root node, which is where the
+ * main surface node damages itself. Only subsurface roots (or other translations) are expected in between.
+ */
+bool wf::wlr_surface_controller_t::to_root_coordinates(scene::node_t *node, wf::region_t& region)
+{
+    for (auto parent = node->parent(); parent != root.get(); parent = parent->parent())
+    {
+        auto translation = dynamic_cast<scene::translation_node_t*>(parent);
+        if (!translation)
+        {
+            return false;
+        }
+
+        region += translation->get_offset();
+    }
+
+    return true;
+}
+
+/**
+ * Apply the deferred state and positions of the synchronized subsurfaces, and damage everything which changed
+ * at once through the main surface node.
+ */
+void wf::wlr_surface_controller_t::apply_deferred_commits()
+{
+    auto surfaces    = std::move(deferred_surfaces);
+    auto subsurfaces = std::move(deferred_subsurfaces);
+    deferred_surfaces.clear();
+    deferred_subsurfaces.clear();
+
+    auto main_node = find_main_node();
+    if (!main_node || !main_node->is_enabled())
+    {
+        for (auto& weak : subsurfaces)
+        {
+            if (auto sub_root = weak.lock())
+            {
+                sub_root->update_offset();
+            }
+        }
+
+        for (auto& weak : surfaces)
+        {
+            if (auto node = std::dynamic_pointer_cast<scene::wlr_surface_node_t>(weak.lock()))
+            {
+                scene::damage_node(node, node->apply_deferred_state());
+            }
+        }
+
+        return;
+    }
+
+    wf::region_t damage;
+    auto add_damage = [&] (scene::node_t *node, wf::region_t region)
+    {
+        if (to_root_coordinates(node, region))
+        {
+            damage |= region;
+        } else
+        {
+            scene::damage_node(node, region);
+        }
+    };
+
+    // Moving a subsurface moves its nested subsurfaces too, so all old positions are computed first.
+    std::vector<std::pair<std::shared_ptr<wlr_subsurface_root_node_t>, wf::region_t>> old_boxes;
+    for (auto& weak : subsurfaces)
+    {
+        if (auto sub_root = weak.lock())
+        {
+            wf::region_t old_box{sub_root->get_bounding_box()};
+            if (!to_root_coordinates(sub_root.get(), old_box))
+            {
+                sub_root->update_offset();
+                continue;
+            }
+
+            old_boxes.emplace_back(sub_root, old_box);
+        }
+    }
+
+    for (auto& [sub_root, old_box] : old_boxes)
+    {
+        if (sub_root->update_offset(false))
+        {
+            damage |= old_box;
+            add_damage(sub_root.get(), sub_root->get_bounding_box());
+        }
+    }
+
+    for (auto& weak : surfaces)
+    {
+        if (auto node = std::dynamic_pointer_cast<scene::wlr_surface_node_t>(weak.lock()))
+        {
+            add_damage(node.get(), node->apply_deferred_state());
+        }
+    }
+
+    if (!damage.empty())
+    {
+        scene::damage_node(main_node, damage);
+    }
+}
+
+wf::scene::wlr_surface_node_t*wf::wlr_surface_controller_t::find_main_node()
+{
+    for (auto& node : root->get_children())
+    {
+        auto wlr_node = dynamic_cast<scene::wlr_surface_node_t*>(node.get());
+        if (wlr_node && (wlr_node->get_surface() == surface))
+        {
+            return wlr_node;
+        }
+    }
+
+    return nullptr;
+}
+
 void wf::wlr_surface_controller_t::update_subsurface_order_and_position()
 {
     auto old_bbox = root->get_bounding_box();
@@ -106,15 +322,11 @@ void wf::wlr_surface_controller_t::update_subsurface_order_and_position()
     auto all_subsurfaces = this->root->get_children();
 
     // Go until we find the main node, it should be a wlr_surface node.
+    auto main_node = find_main_node();
     auto it = std::find_if(all_subsurfaces.begin(), all_subsurfaces.end(),
         [=] (const scene::node_ptr& node)
     {
-        if (auto wlr_node = dynamic_cast<scene::wlr_surface_node_t*>(node.get()))
-        {
-            return wlr_node->get_surface() == surface;
-        }
-
-        return false;
+        return node.get() == main_node;
     });
 
     if (it == all_subsurfaces.end())
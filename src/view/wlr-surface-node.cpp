@@ -1,13 +1,24 @@
 #include "wayfire/unstable/wlr-surface-node.hpp"
+#include "wayfire/unstable/wlr-surface-controller.hpp"
 #include "pixman.h"
+#include "wayfire/debug.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/render-manager.hpp"
 #include "wayfire/scene-render.hpp"
 #include "wayfire/scene.hpp"
+#include "wayfire/util.hpp"
 #include "wlr-surface-pointer-interaction.hpp"
 #include "wlr-surface-touch-interaction.cpp"
 #include "wayfire/output-layout.hpp"
+#include "wayfire/matcher.hpp"
+#include "wayfire/view.hpp"
+#include "../core/core-impl.hpp"
+#include "../core/dmabuf-feedback.hpp"
+#include "../core/explicit-sync.hpp"
+#include "../core/tearing-control.hpp"
+#include "../core/content-type.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -35,6 +46,7 @@ wf::scene::surface_state_t& wf::scene::surface_state_t::operator =(surface_state
     size = other.size;
     src_viewport = other.src_viewport;
     transform    = other.transform;
+    acquire = std::move(other.acquire);
 
     other.current_buffer = NULL;
     other.texture = NULL;
@@ -45,6 +57,9 @@ wf::scene::surface_state_t& wf::scene::surface_state_t::operator =(surface_state
 
 void wf::scene::surface_state_t::merge_state(wlr_surface *surface)
 {
+    // Note that the texture is owned by the wlr_client_buffer of the surface, which outlives the individual
+    // wl_buffers of the client. For SHM buffers, wlroots updates this texture in place with only the damaged
+    // region on each commit, so there is no need to keep a texture per surface here.
     // NB: lock the new buffer first, in case it is the same as the old one
     if (surface->buffer)
     {
@@ -69,6 +84,8 @@ void wf::scene::surface_state_t::merge_state(wlr_surface *surface)
         this->size    = {0, 0};
     }
 
+    this->acquire = wf::explicit_sync_acquire_t::from_surface(surface, this->acquire);
+
     if (surface->current.viewport.has_src)
     {
         wlr_fbox fbox;
@@ -84,6 +101,34 @@ void wf::scene::surface_state_t::merge_state(wlr_surface *surface)
     this->accumulated_damage |= current_damage;
 }
 
+bool wf::scene::surface_state_t::is_pixel_exact(float scale) const
+{
+    if (!current_buffer || (size.width <= 0) || (size.height <= 0))
+    {
+        return false;
+    }
+
+    const wlr_fbox src = src_viewport.value_or(
+        wlr_fbox{0, 0, (double)current_buffer->width, (double)current_buffer->height});
+    if ((src.x != std::floor(src.x)) || (src.y != std::floor(src.y)) ||
+        (src.width != std::floor(src.width)) || (src.height != std::floor(src.height)))
+    {
+        return false;
+    }
+
+    double width  = src.width;
+    double height = src.height;
+    if (transform & WL_OUTPUT_TRANSFORM_90)
+    {
+        std::swap(width, height);
+    }
+
+    // Clients round the buffer size to the closest integer, see fractional-scale-v1.
+    static constexpr double epsilon = 1e-3;
+    return (std::abs(width - size.width * scale) <= 0.5 + epsilon) &&
+           (std::abs(height - size.height * scale) <= 0.5 + epsilon);
+}
+
 wf::scene::surface_state_t::~surface_state_t()
 {
     if (current_buffer)
@@ -107,10 +152,13 @@ wf::scene::wlr_surface_node_t::wlr_surface_node_t(wlr_surface *surface, bool aut
 
         on_surface_commit.disconnect();
         on_surface_destroyed.disconnect();
+        background_frame_timer.disconnect();
     });
 
     this->on_surface_commit.set_callback([=] (void*)
     {
+        update_commit_stats();
+        update_video_cadence();
         if (!wlr_surface_has_buffer(this->surface) && this->visibility.empty())
         {
             send_frame_done(false);
@@ -118,7 +166,14 @@ wf::scene::wlr_surface_node_t::wlr_surface_node_t(wlr_surface *surface, bool aut
 
         if (this->autocommit)
         {
-            apply_current_surface_state();
+            if (auto controller = wlr_surface_controller_t::get_batching_controller(this->surface))
+            {
+                deferred_state.merge_state(this->surface);
+                controller->defer_surface_state(this);
+            } else
+            {
+                apply_current_surface_state();
+            }
         }
 
         for (auto& [wo, _] : visibility)
@@ -130,6 +185,7 @@ wf::scene::wlr_surface_node_t::wlr_surface_node_t(wlr_surface *surface, bool aut
     on_surface_destroyed.connect(&surface->events.destroy);
     on_surface_commit.connect(&surface->events.commit);
     send_frame_done(false);
+    update_frame_throttle();
 
     current_state.merge_state(surface);
 
@@ -139,6 +195,21 @@ wf::scene::wlr_surface_node_t::wlr_surface_node_t(wlr_surface *surface, bool aut
         pending_visibility_delta.erase(ev->output);
     });
     wf::get_core().output_layout->connect(&on_output_remove);
+
+    on_title_changed.set_callback([=] (wf::view_title_changed_signal*)
+    {
+        reset_unthrottled();
+    });
+    on_app_id_changed.set_callback([=] (wf::view_app_id_changed_signal*)
+    {
+        reset_unthrottled();
+    });
+
+    // The matcher reloads the condition from its own callback on the option, which may run after this one.
+    unthrottled_views_option.set_callback([=] ()
+    {
+        idle_reset_unthrottled.run_once([=] () { reset_unthrottled(); });
+    });
 }
 
 void wf::scene::wlr_surface_node_t::apply_state(surface_state_t&& state)
@@ -152,6 +223,18 @@ void wf::scene::wlr_surface_node_t::apply_state(surface_state_t&& state)
     }
 }
 
+wf::region_t wf::scene::wlr_surface_node_t::apply_deferred_state()
+{
+    const bool size_changed = current_state.size != deferred_state.size;
+    this->current_state = std::move(deferred_state);
+    if (size_changed)
+    {
+        scene::update(this->shared_from_this(), scene::update_flag::GEOMETRY);
+    }
+
+    return current_state.accumulated_damage;
+}
+
 void wf::scene::wlr_surface_node_t::apply_current_surface_state()
 {
     surface_state_t state;
@@ -224,17 +307,187 @@ void wf::scene::wlr_surface_node_t::send_frame_done(bool delay_until_vblank)
     }
 }
 
+void wf::scene::wlr_surface_node_t::update_commit_stats()
+{
+    stats.commits++;
+    int nrects;
+    const pixman_box32_t *rects = pixman_region32_rectangles(&surface->buffer_damage, &nrects);
+    for (int i = 0; i < nrects; i++)
+    {
+        stats.damaged_area += (uint64_t)(rects[i].x2 - rects[i].x1) * (rects[i].y2 - rects[i].y1);
+    }
+
+    const int64_t now = wf::get_current_time_us();
+    commit_window_commits++;
+    if (now - commit_window_start_us >= 1'000'000)
+    {
+        stats.commits_per_second = commit_window_commits * 1e6 / (now - commit_window_start_us);
+        commit_window_start_us   = now;
+        commit_window_commits    = 0;
+    }
+
+    stats.buffer_size   = {0, 0};
+    stats.buffer_format = 0;
+    stats.dmabuf = false;
+    if (surface->buffer && surface->buffer->source)
+    {
+        auto buffer = surface->buffer->source;
+        stats.buffer_size = {buffer->width, buffer->height};
+
+        wlr_dmabuf_attributes dmabuf;
+        wlr_shm_attributes shm;
+        if (wlr_buffer_get_dmabuf(buffer, &dmabuf))
+        {
+            stats.buffer_format = dmabuf.format;
+            stats.dmabuf = true;
+        } else if (wlr_buffer_get_shm(buffer, &shm))
+        {
+            stats.buffer_format = shm.format;
+            // wlroots uploads only the buffer damage of SHM buffers into the texture of the previous buffer,
+            // unless the texture cannot be reused. In that case, a new texture is created.
+            if (surface->buffer->texture == last_texture)
+            {
+                stats.partial_uploads++;
+            } else
+            {
+                stats.full_uploads++;
+            }
+        }
+    } else if (surface->buffer)
+    {
+        stats.buffer_size = {surface->buffer->base.width, surface->buffer->base.height};
+    }
+
+    last_texture = surface->buffer ? surface->buffer->texture : nullptr;
+}
+
+wf::scene::surface_stats_t wf::scene::wlr_surface_node_t::get_stats() const
+{
+    auto result = stats;
+    const int64_t elapsed = wf::get_current_time_us() - commit_window_start_us;
+    if (elapsed >= 2'000'000)
+    {
+        // The surface has not committed for at least a second after the current window was complete, so the
+        // rate measured at the start of the window is outdated.
+        result.commits_per_second = commit_window_commits * 1e6 / elapsed;
+    }
+
+    return result;
+}
+
+void wf::scene::wlr_surface_node_t::update_video_cadence()
+{
+    if (!(surface->current.committed & WLR_SURFACE_STATE_BUFFER))
+    {
+        return;
+    }
+
+    auto content_type = wf::get_core_impl().content_type.get();
+    if (!content_type || (content_type->get_content_type(surface) != wf::content_type_t::VIDEO))
+    {
+        video_frame_interval_us = 0;
+        return;
+    }
+
+    const int64_t now = wf::get_current_time_us();
+    const int64_t interval = now - last_buffer_commit_us;
+    last_buffer_commit_us = now;
+    if (interval >= 1'000'000)
+    {
+        // Paused or just started, the cadence is unknown.
+        video_frame_interval_us = 0;
+    } else if (video_frame_interval_us == 0)
+    {
+        video_frame_interval_us = interval;
+    } else
+    {
+        // Smooth out jitter of the client's commits.
+        video_frame_interval_us = (video_frame_interval_us * 7 + interval) / 8;
+    }
+}
+
+bool wf::scene::wlr_surface_node_t::frame_done_due(wf::output_t *output) const
+{
+    if (!output || (video_frame_interval_us <= 0) || (output->handle->refresh <= 0))
+    {
+        return true;
+    }
+
+    // Send the frame callback from the last output frame before the next video frame is due, so that the
+    // client has one refresh cycle to submit it. Videos at (or above) the refresh rate get every frame.
+    const int64_t refresh_us = 1'000'000'000ll / output->handle->refresh;
+    if (video_frame_interval_us < refresh_us * 3 / 2)
+    {
+        return true;
+    }
+
+    return wf::get_current_time_us() - last_buffer_commit_us + refresh_us >= video_frame_interval_us;
+}
+
+bool wf::scene::wlr_surface_node_t::is_unthrottled()
+{
+    if (!unthrottled)
+    {
+        auto view = wf::node_to_view(this);
+        if (!view)
+        {
+            return false;
+        }
+
+        static wf::view_matcher_t unthrottled_views{"core/unthrottled_views"};
+        unthrottled = unthrottled_views.matches(view);
+
+        on_title_changed.disconnect();
+        on_app_id_changed.disconnect();
+        view->connect(&on_title_changed);
+        view->connect(&on_app_id_changed);
+    }
+
+    return *unthrottled;
+}
+
+void wf::scene::wlr_surface_node_t::reset_unthrottled()
+{
+    unthrottled.reset();
+    update_frame_throttle();
+}
+
+void wf::scene::wlr_surface_node_t::update_frame_throttle()
+{
+    static wf::option_wrapper_t<int> background_frame_rate{"core/background_frame_rate"};
+    if (!surface || (full_rate_instances > 0) || (background_frame_rate <= 0) || is_unthrottled())
+    {
+        background_frame_timer.disconnect();
+        return;
+    }
+
+    if (!background_frame_timer.is_connected())
+    {
+        background_frame_timer.set_timeout(std::max(1, 1000 / background_frame_rate), [=] ()
+        {
+            send_frame_done(false);
+            return true;
+        });
+    }
+}
+
 class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public render_instance_t
 {
     std::shared_ptr<wlr_surface_node_t> self;
     wf::signal::connection_t<wf::frame_done_signal> on_frame_done = [=] (wf::frame_done_signal *ev)
     {
-        self->send_frame_done(false);
+        if (self->frame_done_due(visible_on))
+        {
+            self->send_frame_done(false);
+        }
     };
 
     wf::output_t *visible_on;
     damage_callback push_damage;
     wf::region_t last_visibility;
+    // Instances which are not rendered directly on an output (e.g. in workspace streams) never get their
+    // visibility computed, and should never be culled.
+    bool visibility_computed = false;
 
     wf::signal::connection_t<node_damage_signal> on_surface_damage =
         [=] (node_damage_signal *data)
@@ -244,7 +497,7 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
             // Make sure to expand damage, because stretching the surface may cause additional damage.
             const float scale = self->surface->current.scale;
             const float output_scale = visible_on ? visible_on->handle->scale : 1.0;
-            if (scale != output_scale)
+            if ((scale != output_scale) && !self->current_state.is_pixel_exact(output_scale))
             {
                 data->region.expand_edges(std::ceil(std::abs(scale - output_scale)));
             }
@@ -284,11 +537,35 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
         {
             self->handle_leave(visible_on);
         }
+
+        set_full_rate(false);
+    }
+
+    // Whether the instance sends frame callbacks on every frame of its output.
+    bool full_rate = false;
+    void set_full_rate(bool enabled)
+    {
+        if (full_rate != enabled)
+        {
+            full_rate = enabled;
+            self->full_rate_instances += enabled ? 1 : -1;
+            self->update_frame_throttle();
+        }
     }
 
     void schedule_instructions(std::vector<render_instruction_t>& instructions,
         const wf::render_target_t& target, wf::region_t& damage) override
     {
+        static wf::option_wrapper_t<bool> use_opaque_optimizations{
+            "workarounds/enable_opaque_region_damage_optimizations"
+        };
+
+        if (use_opaque_optimizations && visibility_computed && last_visibility.empty())
+        {
+            // The surface is fully covered by opaque surfaces above it.
+            return;
+        }
+
         wf::region_t our_damage = damage & self->get_bounding_box();
         if (!our_damage.empty())
         {
@@ -298,7 +575,8 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
                 .damage   = std::move(our_damage),
             });
 
-            if (self->surface)
+            // The surface does not hide what is below it when it is rendered translucently.
+            if (self->surface && (target.alpha == 1.0f))
             {
                 pixman_region32_subtract(damage.to_pixman(), damage.to_pixman(),
                     &self->surface->opaque_region);
@@ -313,16 +591,50 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
             return;
         }
 
+        const int64_t render_start = wf::get_current_time_us();
+        if (self->current_state.acquire)
+        {
+            self->current_state.acquire->wait_gpu();
+        }
+
         wf::geometry_t geometry = self->get_bounding_box();
         wf::texture_t texture{self->current_state.texture, self->current_state.src_viewport};
+        gl_geometry quad = {
+            (float)geometry.x, (float)geometry.y,
+            (float)(geometry.x + geometry.width), (float)(geometry.y + geometry.height),
+        };
+
+        // If the buffer matches the framebuffer's scale, draw it pixel-aligned and exactly as big as the
+        // buffer, so that it is copied 1:1 instead of being resampled.
+        const bool pixel_exact = !target.subbuffer && !target.exact_geometry &&
+            self->current_state.is_pixel_exact(target.scale);
+        if (pixel_exact)
+        {
+            const double scale = target.scale;
+            const double x     = std::round((geometry.x - target.geometry.x) * scale) / scale;
+            const double y     = std::round((geometry.y - target.geometry.y) * scale) / scale;
+            double width  = self->current_state.src_viewport ?
+                self->current_state.src_viewport->width : self->current_state.current_buffer->width;
+            double height = self->current_state.src_viewport ?
+                self->current_state.src_viewport->height : self->current_state.current_buffer->height;
+            if (self->current_state.transform & WL_OUTPUT_TRANSFORM_90)
+            {
+                std::swap(width, height);
+            }
+
+            quad.x1 = target.geometry.x + x;
+            quad.y1 = target.geometry.y + y;
+            quad.x2 = quad.x1 + width / scale;
+            quad.y2 = quad.y1 + height / scale;
+        }
 
         glm::mat4 transform = target.get_orthographic_projection();
 
         if (self->current_state.transform)
         {
-            const double cx     = geometry.x + geometry.width / 2.0;
-            const double cy     = geometry.y + geometry.height / 2.0;
-            const double aspect = geometry.width * 1.0 / geometry.height;
+            const double cx     = (quad.x1 + quad.x2) / 2.0;
+            const double cy     = (quad.y1 + quad.y2) / 2.0;
+            const double aspect = (quad.x2 - quad.x1) / (quad.y2 - quad.y1);
 
             // Center the surface in the coordinate system, rotate (preserving aspect ration)
             // according to transform, go back
@@ -336,25 +648,44 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
         }
 
         OpenGL::render_begin(target);
-        OpenGL::render_transformed_texture(texture, geometry, transform,
-            glm::vec4(1.f), OpenGL::RENDER_FLAG_CACHED);
+        OpenGL::render_transformed_texture(texture, quad, {}, transform,
+            glm::vec4{1.0, 1.0, 1.0, target.alpha}, OpenGL::RENDER_FLAG_CACHED);
 
-        // use GL_NEAREST for integer scale.
-        // GL_NEAREST makes scaled text blocky instead of blurry, which looks better
-        // but only for integer scale.
-        if (target.scale - floor(target.scale) < 0.001)
+        if (pixel_exact)
+        {
+            // Each texel lands on exactly one pixel, sample it without filtering.
+            GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+            GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        } else if (target.scale - floor(target.scale) < 0.001)
         {
+            // use GL_NEAREST for integer scale.
+            // GL_NEAREST makes scaled text blocky instead of blurry, which looks better
+            // but only for integer scale.
             GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        } else
+        {
+            // The filter is part of the texture state, reset it in case it was shown 1:1 before.
+            GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
         }
 
-        for (const auto& rect : region)
+        if (self->current_state.transform)
+        {
+            for (const auto& rect : region)
+            {
+                target.logic_scissor(wlr_box_from_pixman_box(rect));
+                OpenGL::draw_cached();
+            }
+        } else
         {
-            target.logic_scissor(wlr_box_from_pixman_box(rect));
-            OpenGL::draw_cached();
+            // The quad is not rotated, so we can clip it to the damage directly.
+            OpenGL::draw_cached_region(target, region);
         }
 
         OpenGL::clear_cached();
         OpenGL::render_end();
+
+        self->stats.renders++;
+        self->stats.render_time_us += wf::get_current_time_us() - render_start;
     }
 
     void presentation_feedback(wf::output_t *output) override
@@ -377,10 +708,31 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
             return direct_scanout::OCCLUSION;
         }
 
-        // Must have a wlr surface with the correct scale and transform
+        // The surface covers the whole output, so it could be scanned out if its buffer has a suitable format.
+        if (auto feedback = wf::get_core_impl().dmabuf_feedback.get())
+        {
+            feedback->set_candidate(output, self->surface);
+        }
+
+        auto content_type = wf::get_core_impl().content_type.get();
+        if (content_type)
+        {
+            content_type->set_candidate(output, self->surface);
+        }
+
+        // Must have a wlr surface with the correct scale and transform. The buffer is shown as-is, because
+        // wlroots does not support rotating the buffer during scanout. Clients are instead asked to render
+        // with the output's transform (see update_pending_outputs()). Clients using fractional scaling may
+        // also be scanned out, if their buffer has exactly the output's size and is not cropped.
         auto wlr_surf = self->surface;
-        if ((wlr_surf->current.scale != output->handle->scale) ||
-            (wlr_surf->current.transform != output->handle->transform))
+        const auto& state = self->current_state;
+        if (!state.is_pixel_exact(output->handle->scale) ||
+            (wlr_surf->current.transform != output->handle->transform) ||
+            (state.current_buffer->width != output->handle->width) ||
+            (state.current_buffer->height != output->handle->height) ||
+            (state.src_viewport && ((state.src_viewport->x != 0) || (state.src_viewport->y != 0) ||
+                                    (state.src_viewport->width != output->handle->width) ||
+                                    (state.src_viewport->height != output->handle->height))))
         {
             return direct_scanout::OCCLUSION;
         }
@@ -393,44 +745,109 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
             return direct_scanout::OCCLUSION;
         }
 
+        if (!wlr_surf->buffer)
+        {
+            return direct_scanout::OCCLUSION;
+        }
+
+        // If the backend rejected the buffer recently, do not try again on every frame, because testing
+        // and committing a new output state is expensive. Instead, composite until the buffer changes its
+        // size, or until some time has passed.
+        const wf::dimensions_t buffer_size = {wlr_surf->buffer->base.width, wlr_surf->buffer->base.height};
+        // Games prefer direct scanout, so they try on every frame.
+        const bool game = content_type && (content_type->get_content_type(wlr_surf) == wf::content_type_t::GAME);
+        if (!game && (buffer_size == rejected_buffer_size) && (wf::get_current_time() < retry_scanout_after))
+        {
+            return direct_scanout::OCCLUSION;
+        }
+
         wlr_output_state state;
         wlr_output_state_init(&state);
         wlr_output_state_set_buffer(&state, &wlr_surf->buffer->base);
-        wlr_presentation_surface_scanned_out_on_output(wlr_surf, output->handle);
+        if (auto& acquire = self->current_state.acquire)
+        {
+            // The display engine waits for the buffer to be ready, without blocking the compositor.
+            wlr_output_state_set_wait_timeline(&state, acquire->timeline, acquire->point);
+        }
+
+        auto tearing_control = wf::get_core_impl().tearing_control.get();
+        state.tearing_page_flip = tearing_control && tearing_control->wants_tearing(wlr_surf);
+        if (state.tearing_page_flip && !wlr_output_test_state(output->handle, &state))
+        {
+            LOGC(SCANOUT, "Backend rejected async page flip on ", output->to_string());
+            state.tearing_page_flip = false;
+        }
 
-        if (wlr_output_commit_state(output->handle, &state))
+        if (wlr_output_test_state(output->handle, &state) && wlr_output_commit_state(output->handle, &state))
         {
+            if (tearing_control)
+            {
+                tearing_control->set_tearing(output, state.tearing_page_flip);
+            }
+
             wlr_output_state_finish(&state);
+            wlr_presentation_surface_scanned_out_on_output(wlr_surf, output->handle);
+            rejected_buffer_size = {0, 0};
+            self->stats.scanout_frames++;
             return direct_scanout::SUCCESS;
         } else
         {
             wlr_output_state_finish(&state);
+            LOGC(SCANOUT, "Backend rejected buffer ", buffer_size, " for direct scanout on ",
+                output->to_string(), ", falling back to composition.");
+            rejected_buffer_size = buffer_size;
+            retry_scanout_after  = wf::get_current_time() + SCANOUT_RETRY_INTERVAL;
             return direct_scanout::OCCLUSION;
         }
     }
 
+    // Time in milliseconds after which a rejected buffer may be tried again.
+    static constexpr int64_t SCANOUT_RETRY_INTERVAL = 1000;
+    wf::dimensions_t rejected_buffer_size = {0, 0};
+    int64_t retry_scanout_after = 0;
+
+    bool can_render_transformed() override
+    {
+        return true;
+    }
+
+    int get_alpha_layer_count() override
+    {
+        return 1;
+    }
+
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override
     {
         auto our_box = self->get_bounding_box();
         on_frame_done.disconnect();
-        last_visibility = visible & our_box;
+        last_visibility     = visible & our_box;
+        visibility_computed = true;
 
         static wf::option_wrapper_t<bool> use_opaque_optimizations{
             "workarounds/enable_opaque_region_damage_optimizations"
         };
+        static wf::option_wrapper_t<int> background_frame_rate{"core/background_frame_rate"};
 
-        if (!last_visibility.empty())
+        const bool throttling = (background_frame_rate > 0);
+        if (!last_visibility.empty() || (throttling && self->is_unthrottled()))
         {
-            // We are visible on the given output => send wl_surface.frame on output frame, so that clients
-            // can draw the next frame.
+            // We are visible on the given output (or exempt from throttling) => send wl_surface.frame on
+            // output frame, so that clients can draw the next frame.
             output->connect(&on_frame_done);
+        }
 
-            if (use_opaque_optimizations && self->surface)
+        if (!last_visibility.empty())
+        {
+            // Occluded surfaces are detected only with the opaque region optimizations, or when they get
+            // throttled frame callbacks instead (which keeps them updating, though slowly).
+            if ((use_opaque_optimizations || throttling) && self->surface)
             {
                 pixman_region32_subtract(visible.to_pixman(), visible.to_pixman(),
                     &self->surface->opaque_region);
             }
         }
+
+        set_full_rate(on_frame_done.is_connected());
     }
 };
 
@@ -456,6 +873,11 @@ std::optional<wf::texture_t> wf::scene::wlr_surface_node_t::to_texture() const
 {
     if (this->current_state.current_buffer && (this->current_state.transform == WL_OUTPUT_TRANSFORM_NORMAL))
     {
+        if (current_state.acquire)
+        {
+            current_state.acquire->wait_gpu();
+        }
+
         return wf::texture_t{current_state.texture, current_state.src_viewport};
     }
 
@@ -512,13 +934,33 @@ void wf::scene::wlr_surface_node_t::update_pending_outputs()
     if (surface && (visibility.size() > 0))
     {
         float max_scale = 1;
+        auto transform  = visibility.begin()->first->handle->transform;
         for (auto x : visibility)
         {
             max_scale = std::max(max_scale, x.first->handle->scale);
+            if (x.first->handle->transform != transform)
+            {
+                transform = WL_OUTPUT_TRANSFORM_NORMAL;
+            }
         }
 
         wlr_fractional_scale_v1_notify_scale(surface, max_scale);
         wlr_surface_set_preferred_buffer_scale(surface, max_scale);
+        // Clients which render their buffers with the output's transform can be scanned out on rotated
+        // outputs, see try_scanout().
+        wlr_surface_set_preferred_buffer_transform(surface, transform);
+    }
+
+    auto feedback = wf::get_core_impl().dmabuf_feedback.get();
+    if (surface && feedback)
+    {
+        std::vector<wf::output_t*> outputs;
+        for (auto& [wo, _] : visibility)
+        {
+            outputs.push_back(wo);
+        }
+
+        feedback->set_visible_outputs(surface, outputs);
     }
 
     pending_visibility_delta.clear();
@@ -19,6 +19,14 @@ class wlr_surface_pointer_interaction_t final : public wf::pointer_interaction_t
     wlr_pointer_constraint_v1 *last_constraint = NULL;
     wf::wl_listener_wrapper constraint_destroyed;
 
+    // The region of last_constraint, in surface-local coordinates. wlroots updates the region when the client
+    // sets a new one and when the input region of the surface changes, so it is refreshed lazily after
+    // such commits instead of being copied on each motion event.
+    wf::region_t constraint_region;
+    std::vector<wlr_box> constraint_boxes;
+    bool constraint_region_dirty = true;
+    wf::wl_listener_wrapper constraint_region_changed, surface_committed;
+
     scene::node_t *self;
 
     // From position relative to current focus to global scene coordinates
@@ -40,22 +48,47 @@ class wlr_surface_pointer_interaction_t final : public wf::pointer_interaction_t
         return std::hypot(a.x - b.x, a.y - b.y);
     }
 
-    inline static wf::pointf_t region_closest_point(const wf::region_t& region,
-        const wf::pointf_t& ref)
+    void update_constraint_region()
+    {
+        if (!constraint_region_dirty)
+        {
+            return;
+        }
+
+        constraint_region_dirty = false;
+        constraint_region = wf::region_t{&last_constraint->region};
+        constraint_boxes.clear();
+        for (const auto& box : constraint_region)
+        {
+            constraint_boxes.push_back(wlr_box_from_pixman_box(box));
+        }
+    }
+
+    wf::pointf_t region_closest_point(const wf::pointf_t& ref) const
     {
-        if (region.empty() || region.contains_pointf(ref))
+        if (constraint_boxes.empty())
         {
             return ref;
         }
 
-        auto extents = region.get_extents();
-        wf::pointf_t result = {1.0 * extents.x1, 1.0 * extents.y1};
+        double x, y;
+        if (constraint_boxes.size() == 1)
+        {
+            // The usual case: confined to a rectangle, e.g. the whole surface.
+            wlr_box_closest_point(&constraint_boxes.front(), ref.x, ref.y, &x, &y);
+            return {x, y};
+        }
 
-        for (const auto& box : region)
+        if (constraint_region.contains_pointf(ref))
         {
-            auto wlr_box = wlr_box_from_pixman_box(box);
+            return ref;
+        }
 
-            double x, y;
+        auto extents = constraint_region.get_extents();
+        wf::pointf_t result = {1.0 * extents.x1, 1.0 * extents.y1};
+
+        for (const auto& wlr_box : constraint_boxes)
+        {
             wlr_box_closest_point(&wlr_box, ref.x, ref.y, &x, &y);
             wf::pointf_t closest = {x, y};
 
@@ -71,8 +104,9 @@ class wlr_surface_pointer_interaction_t final : public wf::pointer_interaction_t
 
     wf::pointf_t constrain_point(wf::pointf_t point)
     {
+        update_constraint_region();
         point = get_node_local_coords(self, point);
-        auto closest = region_closest_point({&this->last_constraint->region}, point);
+        auto closest = region_closest_point(point);
         closest = get_absolute_position_from_relative(closest);
 
         return closest;
@@ -137,9 +171,17 @@ class wlr_surface_pointer_interaction_t final : public wf::pointer_interaction_t
         {
             last_constraint = NULL;
             constraint_destroyed.disconnect();
+            constraint_region_changed.disconnect();
+            surface_committed.disconnect();
         });
 
+        constraint_region_changed.set_callback([=] (void*) { constraint_region_dirty = true; });
+        surface_committed.set_callback([=] (void*) { constraint_region_dirty = true; });
+
         constraint_destroyed.connect(&constraint->events.destroy);
+        constraint_region_changed.connect(&constraint->events.set_region);
+        surface_committed.connect(&surface->events.commit);
+        constraint_region_dirty = true;
         wlr_pointer_constraint_v1_send_activated(constraint);
         last_constraint = constraint;
     }
@@ -158,6 +200,8 @@ class wlr_surface_pointer_interaction_t final : public wf::pointer_interaction_t
         }
 
         constraint_destroyed.disconnect();
+        constraint_region_changed.disconnect();
+        surface_committed.disconnect();
         wlr_pointer_constraint_v1_send_deactivated(last_constraint);
         last_constraint = NULL;
     }
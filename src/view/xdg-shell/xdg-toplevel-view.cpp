@@ -285,6 +285,13 @@ void wf::xdg_toplevel_view_t::request_native_size()
 
 void wf::xdg_toplevel_view_t::set_activated(bool active)
 {
+    static wf::option_wrapper_t<bool> skip_noop_configures{"core/skip_noop_configures"};
+    if (skip_noop_configures && (activated == active))
+    {
+        wf::count_suppressed_configure();
+        return;
+    }
+
     toplevel_view_interface_t::set_activated(active);
     if (xdg_toplevel && xdg_toplevel->base->surface->mapped)
     {
@@ -66,34 +66,61 @@ void wf::xdg_toplevel_t::commit()
     const wf::dimensions_t desired_size =
         wf::shrink_dimensions_by_margins(wf::dimensions(_pending.geometry), _pending.margins);
 
+    const bool only_size_changes = (_current.tiled_edges == _pending.tiled_edges) &&
+        (_current.fullscreen == _pending.fullscreen);
+    // While the client has not acknowledged the last configure, a field which that configure already
+    // carries does not need to be sent again: the client answers the last configure in any case, and we
+    // wait for that answer anyway.
+    const bool skip_noop = skip_noop_configures && has_unacked_configure();
+    const auto& scheduled = toplevel->scheduled;
+
+    deferred_size.reset();
     if (current_size != desired_size)
     {
         wait_for_client = true;
         const int configure_width  = std::max(1, desired_size.width);
         const int configure_height = std::max(1, desired_size.height);
-        this->target_configure = wlr_xdg_toplevel_set_size(this->toplevel, configure_width, configure_height);
+        if (skip_noop && (scheduled.width == configure_width) && (scheduled.height == configure_height))
+        {
+            wf::count_suppressed_configure();
+        } else if (coalesce_configures && only_size_changes && has_unacked_configure())
+        {
+            // The client is still busy with an older size, any configure sent now would just pile up.
+            deferred_size = wf::dimensions_t{configure_width, configure_height};
+        } else
+        {
+            this->target_configure =
+                wlr_xdg_toplevel_set_size(this->toplevel, configure_width, configure_height);
+        }
     }
 
     if (_current.tiled_edges != _pending.tiled_edges)
     {
         wait_for_client = true;
-        wlr_xdg_toplevel_set_tiled(this->toplevel, _pending.tiled_edges);
-
         auto version = wl_resource_get_version(toplevel->resource);
-        if (version >= XDG_TOPLEVEL_STATE_TILED_LEFT_SINCE_VERSION)
+        const bool maximized = (version >= XDG_TOPLEVEL_STATE_TILED_LEFT_SINCE_VERSION) ?
+            (_pending.tiled_edges == TILED_EDGES_ALL) : !!_pending.tiled_edges;
+
+        if (skip_noop && (scheduled.tiled == _pending.tiled_edges) && (scheduled.maximized == maximized))
         {
-            this->target_configure =
-                wlr_xdg_toplevel_set_maximized(this->toplevel, (_pending.tiled_edges == TILED_EDGES_ALL));
+            wf::count_suppressed_configure();
         } else
         {
-            this->target_configure = wlr_xdg_toplevel_set_maximized(this->toplevel, !!_pending.tiled_edges);
+            wlr_xdg_toplevel_set_tiled(this->toplevel, _pending.tiled_edges);
+            this->target_configure = wlr_xdg_toplevel_set_maximized(this->toplevel, maximized);
         }
     }
 
     if (_current.fullscreen != _pending.fullscreen)
     {
         wait_for_client = true;
-        this->target_configure = wlr_xdg_toplevel_set_fullscreen(toplevel, _pending.fullscreen);
+        if (skip_noop && (scheduled.fullscreen == _pending.fullscreen))
+        {
+            wf::count_suppressed_configure();
+        } else
+        {
+            this->target_configure = wlr_xdg_toplevel_set_fullscreen(toplevel, _pending.fullscreen);
+        }
     }
 
     if (wait_for_client)
@@ -130,6 +157,13 @@ void wf::xdg_toplevel_t::apply()
         }
     }
 
+    if (deferred_size)
+    {
+        // The transaction timed out before the client caught up. Still send the latest size, so that the
+        // client ends up with the state we just applied.
+        send_deferred_configure();
+    }
+
     this->_current = committed();
     const bool is_pending = wf::get_core().tx_manager->is_object_pending(shared_from_this());
     if (!is_pending)
@@ -148,6 +182,11 @@ void wf::xdg_toplevel_t::apply()
     }
 }
 
+wl_client*wf::xdg_toplevel_t::get_client() const
+{
+    return toplevel ? wl_resource_get_client(toplevel->resource) : nullptr;
+}
+
 void wf::xdg_toplevel_t::handle_surface_commit()
 {
     pending_state.merge_state(toplevel->base->surface);
@@ -161,6 +200,14 @@ void wf::xdg_toplevel_t::handle_surface_commit()
     const bool is_committed = wf::get_core().tx_manager->is_object_committed(shared_from_this());
     if (is_committed)
     {
+        if (deferred_size && !has_unacked_configure())
+        {
+            // The client caught up with the previous configure, now it can get the latest size.
+            send_deferred_configure();
+            main_surface->send_frame_done(true);
+            return;
+        }
+
         // TODO: handle overflow?
         if (this->toplevel->base->current.configure_serial < this->target_configure)
         {
@@ -241,6 +288,22 @@ void wf::xdg_toplevel_t::apply_pending_state()
     }
 }
 
+bool wf::xdg_toplevel_t::has_unacked_configure()
+{
+    return toplevel && (this->toplevel->base->current.configure_serial < this->target_configure);
+}
+
+void wf::xdg_toplevel_t::send_deferred_configure()
+{
+    if (toplevel)
+    {
+        this->target_configure = wlr_xdg_toplevel_set_size(toplevel, deferred_size->width,
+            deferred_size->height);
+    }
+
+    deferred_size.reset();
+}
+
 void wf::xdg_toplevel_t::emit_ready()
 {
     if (pending_ready)
@@ -2,8 +2,10 @@
 
 #include "wayfire/geometry.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/option-wrapper.hpp"
 #include <wayfire/unstable/wlr-surface-node.hpp>
 #include <memory>
+#include <optional>
 #include <wayfire/toplevel.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 
@@ -24,6 +26,7 @@ class xdg_toplevel_t : public toplevel_t, public std::enable_shared_from_this<xd
         std::shared_ptr<wf::scene::wlr_surface_node_t> surface);
     void commit() override;
     void apply() override;
+    wl_client *get_client() const override;
     wf::geometry_t calculate_base_geometry();
     void request_native_size();
 
@@ -45,6 +48,18 @@ class xdg_toplevel_t : public toplevel_t, public std::enable_shared_from_this<xd
     void handle_surface_commit();
     uint32_t target_configure = 0;
 
+    /**
+     * In coalescing mode, a size change is not sent while the client has not acknowledged the previous
+     * configure. Instead, the latest desired size is stored and sent once the client catches up.
+     */
+    wf::option_wrapper_t<bool> coalesce_configures{"core/coalesce_configures"};
+    std::optional<wf::dimensions_t> deferred_size;
+
+    // See core/skip_noop_configures.
+    wf::option_wrapper_t<bool> skip_noop_configures{"core/skip_noop_configures"};
+    bool has_unacked_configure();
+    void send_deferred_configure();
+
     void emit_ready();
     bool pending_ready = false;
 };
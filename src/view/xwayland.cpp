@@ -8,11 +8,21 @@
 
 #include "wayfire/unstable/wlr-view-events.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/startup-profile.hpp"
 #include "xwayland/xwayland-helpers.hpp"
 #include "xwayland/xwayland-view-base.hpp"
 #include "xwayland/xwayland-unmanaged-view.hpp"
 #include "xwayland/xwayland-toplevel-view.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 #if WF_HAS_XWAYLAND
 
 xcb_atom_t wf::xw::_NET_WM_WINDOW_TYPE_NORMAL;
@@ -213,13 +223,147 @@ class xwayland_view_controller_t
 static wlr_xwayland *xwayland_handle = nullptr;
 static wf::wl_listener_wrapper on_xwayland_surface_created;
 static wf::wl_listener_wrapper on_xwayland_ready;
+static wf::wl_listener_wrapper on_xwayland_server_start;
+
+namespace
+{
+/**
+ * Lazy Xwayland can be started ahead of the first X11 client, if X11 clients were used in one of the
+ * previous sessions. The state file holds one character per recent session, '1' for sessions which used
+ * X11 clients and '0' for the others, the current session last.
+ */
+constexpr size_t USAGE_HISTORY_LENGTH = 8;
+constexpr int PREWARM_DELAY_MS = 2000;
+
+struct xwayland_state_t
+{
+    wf::xwayland_stats_t stats;
+    std::chrono::steady_clock::time_point server_start;
+    std::string usage_history;
+    bool track_usage = false;
+    bool x11_used    = false;
+    wf::wl_timer<false> prewarm_timer;
+    wf::signal::connection_t<wf::core_startup_finished_signal> on_startup_finished;
+};
+
+xwayland_state_t *xwayland_state = nullptr;
+
+std::filesystem::path usage_history_path()
+{
+    const char *state_home = getenv("XDG_STATE_HOME");
+    const char *home = getenv("HOME");
+    if (state_home && *state_home)
+    {
+        return std::filesystem::path(state_home) / "wayfire" / "xwayland-usage";
+    }
+
+    return home ? (std::filesystem::path(home) / ".local/state/wayfire/xwayland-usage") : "";
+}
+
+void write_usage_history()
+{
+    auto path = usage_history_path();
+    if (path.empty())
+    {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::ofstream out{path};
+    out << xwayland_state->usage_history << std::endl;
+    if (!out)
+    {
+        LOGW("Failed to write the Xwayland usage history to ", path.string());
+    }
+}
+
+/** Start lazy Xwayland by connecting to its X11 socket, as a client would. */
+void prewarm_xwayland()
+{
+    if (!xwayland_handle || !xwayland_handle->display_name || (xwayland_handle->server->pid > 0))
+    {
+        return;
+    }
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/.X11-unix/X%s", xwayland_handle->display_name + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0)
+    {
+        LOGD("Prewarming Xwayland");
+        xwayland_state->stats.prewarmed = true;
+    } else
+    {
+        LOGW("Failed to prewarm Xwayland on ", addr.sun_path, ": ", strerror(errno));
+    }
+
+    close(fd);
+}
+
+void setup_usage_tracking()
+{
+    std::ifstream in{usage_history_path()};
+    std::getline(in, xwayland_state->usage_history);
+
+    auto& history = xwayland_state->usage_history;
+    history.erase(std::remove_if(history.begin(), history.end(),
+        [] (char c) { return (c != '0') && (c != '1'); }), history.end());
+    const bool used_before = (history.find('1') != std::string::npos);
+
+    history += '0';
+    if (history.size() > USAGE_HISTORY_LENGTH)
+    {
+        history.erase(0, history.size() - USAGE_HISTORY_LENGTH);
+    }
+
+    xwayland_state->track_usage = true;
+    write_usage_history();
+
+    if (used_before)
+    {
+        xwayland_state->on_startup_finished.set_callback([] (wf::core_startup_finished_signal*)
+        {
+            xwayland_state->prewarm_timer.set_timeout(PREWARM_DELAY_MS, [] () { prewarm_xwayland(); });
+        });
+        wf::get_core().connect(&xwayland_state->on_startup_finished);
+    }
+}
+
+void mark_x11_used()
+{
+    if (xwayland_state->x11_used)
+    {
+        return;
+    }
+
+    xwayland_state->x11_used = true;
+    xwayland_state->stats.first_surface_ms = wf::startup_profile::get_uptime_ms();
+    if (xwayland_state->track_usage)
+    {
+        xwayland_state->usage_history.back() = '1';
+        write_usage_history();
+    }
+}
+}
 #endif
 
 void wf::init_xwayland(bool lazy)
 {
 #if WF_HAS_XWAYLAND
+    xwayland_state = new xwayland_state_t;
+    xwayland_state->stats.lazy = lazy;
+
     on_xwayland_surface_created.set_callback([] (void *data)
     {
+        mark_x11_used();
         wf::new_xwayland_surface_signal ev;
         ev.surface = (wlr_xwayland_surface*)data;
         wf::get_core().emit(&ev);
@@ -243,15 +387,39 @@ void wf::init_xwayland(bool lazy)
 
         wlr_xwayland_set_seat(xwayland_handle, wf::get_core().get_current_seat());
         xwayland_update_default_cursor();
+        wf::startup_profile::mark("xwayland", "xwayland ready");
+        xwayland_state->stats.startup_latency_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - xwayland_state->server_start).count();
     });
 
+    auto launch_start = wf::startup_profile::clock::now();
     xwayland_handle = wlr_xwayland_create(wf::get_core().display,
         wf::get_core_impl().compositor, lazy);
+    wf::startup_profile::record("xwayland", lazy ? "create xwayland (lazy)" : "launch xwayland", launch_start);
 
     if (xwayland_handle)
     {
         on_xwayland_surface_created.connect(&xwayland_handle->events.new_surface);
         on_xwayland_ready.connect(&xwayland_handle->events.ready);
+
+        on_xwayland_server_start.set_callback([] (void*)
+        {
+            xwayland_state->stats.started = true;
+            xwayland_state->server_start  = std::chrono::steady_clock::now();
+        });
+        on_xwayland_server_start.connect(&xwayland_handle->server->events.start);
+        if (!lazy)
+        {
+            // The server was started by wlr_xwayland_create().
+            xwayland_state->stats.started = true;
+            xwayland_state->server_start  = launch_start;
+        }
+
+        wf::option_wrapper_t<bool> prewarm{"core/xwayland_prewarm"};
+        if (lazy && prewarm)
+        {
+            setup_usage_tracking();
+        }
     }
 
 #endif
@@ -264,9 +432,14 @@ void wf::fini_xwayland()
     {
         on_xwayland_surface_created.disconnect();
         on_xwayland_ready.disconnect();
+        on_xwayland_server_start.disconnect();
         wlr_xwayland_destroy(xwayland_handle);
+        xwayland_handle = nullptr;
     }
 
+    delete xwayland_state;
+    xwayland_state = nullptr;
+
 #endif
 }
 
@@ -317,6 +490,34 @@ std::string wf::xwayland_get_display()
 #endif
 }
 
+wf::xwayland_stats_t wf::xwayland_get_stats()
+{
+#if WF_HAS_XWAYLAND
+    if (!xwayland_state)
+    {
+        return {};
+    }
+
+    auto stats = xwayland_state->stats;
+    const int pid = xwayland_get_pid();
+    std::ifstream status{"/proc/" + std::to_string(pid) + "/status"};
+    std::string line;
+    while ((pid > 0) && std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+        {
+            stats.memory_kb = std::stoll(line.substr(6));
+            break;
+        }
+    }
+
+    return stats;
+#else
+
+    return {};
+#endif
+}
+
 int wf::xwayland_get_pid()
 {
 #if WF_HAS_XWAYLAND
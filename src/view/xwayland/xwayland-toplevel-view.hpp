@@ -269,6 +269,13 @@ class wayfire_xwayland_view : public wf::toplevel_view_interface_t, public wayfi
 
     void set_activated(bool active) override
     {
+        static wf::option_wrapper_t<bool> skip_noop_configures{"core/skip_noop_configures"};
+        if (skip_noop_configures && (activated == active))
+        {
+            wf::count_suppressed_configure();
+            return;
+        }
+
         if (xw)
         {
             wlr_xwayland_surface_activate(xw, active);
@@ -5,6 +5,7 @@
 #include <wayfire/txn/transaction-manager.hpp>
 #include "../view-impl.hpp"
 #include "wayfire/toplevel.hpp"
+#include <algorithm>
 
 #if WF_HAS_XWAYLAND
 
@@ -115,16 +116,31 @@ void wf::xw::xwayland_toplevel_t::commit()
         reconfigure_xwayland_surface();
     }
 
+    // The surface keeps the last state which was sent to the X server, there is no need to send it again.
+    static wf::option_wrapper_t<bool> skip_noop_configures{"core/skip_noop_configures"};
     if (_pending.tiled_edges != _current.tiled_edges)
     {
         wait_for_client = true;
-        wlr_xwayland_surface_set_maximized(xw, !!_pending.tiled_edges);
+        const bool maximized = !!_pending.tiled_edges;
+        if (skip_noop_configures && (xw->maximized_horz == maximized) && (xw->maximized_vert == maximized))
+        {
+            wf::count_suppressed_configure();
+        } else
+        {
+            wlr_xwayland_surface_set_maximized(xw, maximized);
+        }
     }
 
     if (_pending.fullscreen != _current.fullscreen)
     {
         wait_for_client = true;
-        wlr_xwayland_surface_set_fullscreen(xw, _pending.fullscreen);
+        if (skip_noop_configures && (xw->fullscreen == _pending.fullscreen))
+        {
+            wf::count_suppressed_configure();
+        } else
+        {
+            wlr_xwayland_surface_set_fullscreen(xw, _pending.fullscreen);
+        }
     }
 
     if (wait_for_client && main_surface)
@@ -155,6 +171,47 @@ void wf::xw::xwayland_toplevel_t::reconfigure_xwayland_surface()
         return;
     }
 
+    queued_configure = configure;
+    idle_configure.run_once([=] () { send_queued_configure(); });
+}
+
+void wf::xw::xwayland_toplevel_t::send_queued_configure()
+{
+    if (!xw || !queued_configure)
+    {
+        queued_configure.reset();
+        return;
+    }
+
+    const wf::geometry_t configure = *queued_configure;
+    const wf::geometry_t last = {xw->x, xw->y, xw->width, xw->height};
+    if (configure == last)
+    {
+        wf::count_suppressed_configure();
+        queued_configure.reset();
+        return;
+    }
+
+    const int64_t now = wf::get_current_time_us();
+    const int64_t min_interval_us = (int64_t)position_update_interval * 1000;
+    if ((wf::dimensions(configure) == wf::dimensions(last)) && (now - last_configure_time_us < min_interval_us))
+    {
+        // Only the position changed and the last configure was just sent, wait a bit, in the meantime,
+        // newer positions may replace the queued one.
+        if (!position_update_timer.is_connected())
+        {
+            const int64_t remaining_ms = (last_configure_time_us + min_interval_us - now + 999) / 1000;
+            position_update_timer.set_timeout(std::max<int64_t>(remaining_ms, 1),
+                [=] () { send_queued_configure(); });
+        }
+
+        return;
+    }
+
+    position_update_timer.disconnect();
+    queued_configure.reset();
+    last_configure_time_us = now;
+
     LOGC(XWL, "Configuring xwayland surface ", nonull(xw->title), " ", nonull(xw->class_t), " ", configure);
     wlr_xwayland_surface_configure(xw, configure.x, configure.y, configure.width, configure.height);
 }
@@ -3,7 +3,9 @@
 #include "config.h"
 #include "wayfire/geometry.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/option-wrapper.hpp"
 #include <memory>
+#include <optional>
 #include <wayfire/toplevel.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/unstable/wlr-surface-node.hpp>
@@ -54,7 +56,22 @@ class xwayland_toplevel_t : public wf::toplevel_t, public std::enable_shared_fro
     wf::point_t output_offset = {0, 0};
     void handle_surface_commit();
 
+    /**
+     * Configures are not sent immediately, but on the next idle, so that all configures which are generated
+     * by a transaction (and in the same event loop iteration) are sent together, and each surface is
+     * configured at most once with its latest geometry.
+     */
     void reconfigure_xwayland_surface();
+    void send_queued_configure();
+    std::optional<wf::geometry_t> queued_configure;
+    wf::wl_idle_call idle_configure;
+
+    // Used to limit the rate of configures which only change the position, see
+    // workarounds/xwayland_position_update_interval.
+    wf::option_wrapper_t<int> position_update_interval{"workarounds/xwayland_position_update_interval"};
+    wf::wl_timer<false> position_update_timer;
+    int64_t last_configure_time_us = 0;
+
     void emit_ready();
     bool pending_ready = false;
 };
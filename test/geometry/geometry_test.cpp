@@ -2,6 +2,8 @@
 #include <doctest/doctest.h>
 
 #include <wayfire/geometry.hpp>
+#include <wayfire/region.hpp>
+#include <vector>
 
 TEST_CASE("Point addition")
 {
@@ -11,3 +13,131 @@ TEST_CASE("Point addition")
     using namespace wf;
     REQUIRE_EQ(a + b, wf::point_t{4, 6});
 }
+
+TEST_CASE("Region simplification")
+{
+    wf::region_t region;
+    for (int i = 0; i < 20; i++)
+    {
+        region |= wlr_box{i * 10, 0, 5, 5};
+        region |= wlr_box{i * 10, 100, 5, 5};
+    }
+
+    const auto extents = region.get_extents();
+    REQUIRE_EQ(region.simplify(40), 0);
+
+    const int64_t added = region.simplify(2);
+    REQUIRE_LE(pixman_region32_n_rects(region.to_pixman()), 2);
+    REQUIRE_EQ(added, 2 * (195 * 5 - 20 * 25));
+    REQUIRE_EQ(region.get_extents().x1, extents.x1);
+    REQUIRE_EQ(region.get_extents().y2, extents.y2);
+    for (int i = 0; i < 20; i++)
+    {
+        REQUIRE(region.contains_point({i * 10 + 2, 2}));
+        REQUIRE(region.contains_point({i * 10 + 2, 102}));
+    }
+}
+
+static int64_t test_region_area(const wf::region_t& region)
+{
+    int64_t area = 0;
+    for (const auto& box : region)
+    {
+        area += int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+    }
+
+    return area;
+}
+
+TEST_CASE("Region operations on single rectangles")
+{
+    const wlr_box a = {0, 0, 100, 100};
+    const wlr_box b = {50, 50, 100, 100};
+    const wlr_box inner = {10, 10, 10, 10};
+
+    wf::region_t region{a};
+    REQUIRE_EQ(test_region_area(region & b), 50 * 50);
+    REQUIRE_EQ(test_region_area(region & wf::region_t{b}), 50 * 50);
+    REQUIRE((region & wlr_box{200, 200, 10, 10}).empty());
+    REQUIRE((region & wlr_box{0, 0, -5, 10}).empty());
+
+    REQUIRE_EQ(test_region_area(region | inner), 100 * 100);
+    REQUIRE_EQ(test_region_area(region | b), 2 * 100 * 100 - 50 * 50);
+    REQUIRE_EQ(test_region_area(wf::region_t{} | b), 100 * 100);
+    REQUIRE_EQ(test_region_area(wf::region_t{inner} | wf::region_t{a}), 100 * 100);
+
+    REQUIRE((region ^ wlr_box{-10, -10, 200, 200}).empty());
+    REQUIRE_EQ(test_region_area(region ^ wlr_box{200, 200, 10, 10}), 100 * 100);
+    REQUIRE_EQ(test_region_area(region ^ inner), 100 * 100 - 10 * 10);
+    REQUIRE_FALSE((region ^ inner).contains_point({15, 15}));
+
+    // In-place operations
+    wf::region_t copy = region;
+    copy &= b;
+    REQUIRE_EQ(test_region_area(copy), 50 * 50);
+    copy |= a;
+    REQUIRE_EQ(test_region_area(copy), 100 * 100);
+    copy |= copy;
+    REQUIRE_EQ(test_region_area(copy), 100 * 100);
+    copy ^= wf::region_t{a};
+    REQUIRE(copy.empty());
+
+    // Complex regions combined with rectangles
+    wf::region_t complex;
+    complex |= wlr_box{0, 0, 10, 10};
+    complex |= wlr_box{20, 20, 10, 10};
+    REQUIRE_EQ(test_region_area(complex & wlr_box{-5, -5, 100, 100}), 200);
+    REQUIRE_EQ(test_region_area(complex & wlr_box{0, 0, 5, 5}), 25);
+    REQUIRE_EQ(test_region_area(complex | wlr_box{-5, -5, 100, 100}), 100 * 100);
+    REQUIRE((complex ^ wlr_box{0, 0, 30, 30}).empty());
+    REQUIRE_EQ(test_region_area(complex ^ wlr_box{0, 0, 10, 10}), 100);
+}
+
+TEST_CASE("Bulk box operations")
+{
+    std::vector<pixman_box32_t> boxes = {
+        {0, 0, 10, 10},
+        {5, -5, 30, 8},
+        {-10, -10, -5, -5},
+    };
+
+    auto clipped = boxes;
+    wf::intersect_boxes(clipped.data(), clipped.size(), {2, 2, 20, 20});
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        const auto expected = wf::geometry_intersection(wlr_box_from_pixman_box(boxes[i]), {2, 2, 18, 18});
+        const auto result   = wlr_box_from_pixman_box(clipped[i]);
+        if ((expected.width <= 0) || (expected.height <= 0))
+        {
+            REQUIRE(((result.width == 0) || (result.height == 0)));
+        } else
+        {
+            REQUIRE_EQ(result, expected);
+        }
+    }
+
+    for (double scale : {1.0, 1.25, 1.5, 2.0 / 3.0})
+    {
+        auto scaled = boxes;
+        wf::scale_boxes(scaled.data(), scaled.size(), scale, {-3, 7});
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            const auto expected = (wlr_box_from_pixman_box(boxes[i]) + wf::point_t{-3, 7}) * scale;
+            REQUIRE_EQ(wlr_box_from_pixman_box(scaled[i]), expected);
+        }
+    }
+
+    // Rotation by 90 degrees and translation.
+    auto transformed = boxes;
+    wf::transform_boxes(transformed.data(), transformed.size(), {0, -1, 100, 1, 0, 0});
+    REQUIRE_EQ(wlr_box_from_pixman_box(transformed[0]), wlr_box{90, 0, 10, 10});
+    REQUIRE_EQ(wlr_box_from_pixman_box(transformed[1]), wlr_box{92, 5, 13, 25});
+
+    // Non-integer results are rounded outwards.
+    transformed = {{1, 1, 3, 3}};
+    wf::transform_boxes(transformed.data(), 1, {0.5, 0, 0.25, 0, 0.5, 0});
+    REQUIRE_EQ(wlr_box_from_pixman_box(transformed[0]), wlr_box{0, 0, 2, 2});
+
+    const wf::region_t region{boxes.data(), (int)boxes.size()};
+    REQUIRE_EQ(test_region_area(region), 100 + 25 * 13 - 5 * 8 + 25);
+}
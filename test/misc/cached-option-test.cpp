@@ -0,0 +1,50 @@
+#include "wayfire/option-wrapper.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+TEST_CASE("cached_option_t follows option updates")
+{
+    auto option = std::make_shared<wf::config::option_t<int>>("test/int", 5);
+    wf::cached_option_t<int> cached{option};
+    const int *address = &cached.value();
+    CHECK(cached == 5);
+
+    int calls = 0, seen = 0;
+    cached.set_callback([&] ()
+    {
+        ++calls;
+        seen = cached;
+    });
+
+    option->set_value(7);
+    CHECK(cached == 7);
+    CHECK(calls == 1);
+    CHECK(seen == 7);
+
+    // Reads always go to the same copy, never through the option object.
+    CHECK(&cached.value() == address);
+}
+
+TEST_CASE("cached_option_t caches non-trivial types")
+{
+    auto option = std::make_shared<wf::config::option_t<std::string>>("test/string", "default");
+    wf::cached_option_t<std::string> cached{option};
+    CHECK(cached.value() == "default");
+
+    option->set_value(std::string("predictive"));
+    CHECK(cached.value() == "predictive");
+}
+
+TEST_CASE("cached_option_t disconnects from the option when destroyed")
+{
+    auto option = std::make_shared<wf::config::option_t<bool>>("test/bool", false);
+    int calls   = 0;
+    {
+        wf::cached_option_t<bool> cached{option};
+        cached.set_callback([&] () { ++calls; });
+        option->set_value(true);
+    }
+
+    option->set_value(false);
+    CHECK(calls == 1);
+}
@@ -0,0 +1,101 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+#include <vector>
+
+#include <wayfire/coroutine.hpp>
+
+namespace
+{
+/** An awaitable which is resumed manually by the test. */
+struct manual_event_t
+{
+    std::coroutine_handle<> waiting;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        waiting = h;
+    }
+
+    void await_resume() const noexcept
+    {}
+
+    void fire()
+    {
+        std::exchange(waiting, nullptr).resume();
+    }
+};
+
+wf::coro::task_t wait_twice(manual_event_t& event, std::vector<int>& log)
+{
+    log.push_back(1);
+    co_await event;
+    log.push_back(2);
+    co_await event;
+    log.push_back(3);
+}
+
+wf::coro::task_t wait_for_task(manual_event_t& event, std::vector<int>& log)
+{
+    log.push_back(0);
+    co_await wait_twice(event, log);
+    log.push_back(4);
+}
+
+struct destructor_flag_t
+{
+    bool *destroyed;
+    ~destructor_flag_t()
+    {
+        *destroyed = true;
+    }
+};
+
+wf::coro::task_t hold_flag(manual_event_t& event, bool *destroyed)
+{
+    destructor_flag_t flag{destroyed};
+    co_await event;
+}
+}
+
+TEST_CASE("Tasks run until their first suspension and resume in order")
+{
+    manual_event_t event;
+    std::vector<int> log;
+    auto task = wait_twice(event, log);
+    REQUIRE(log == std::vector<int>{1});
+    REQUIRE(task.is_running());
+
+    event.fire();
+    REQUIRE(log == std::vector<int>{1, 2});
+    event.fire();
+    REQUIRE(log == std::vector<int>{1, 2, 3});
+    REQUIRE(!task.is_running());
+}
+
+TEST_CASE("Awaiting a task resumes the caller when it finishes")
+{
+    manual_event_t event;
+    std::vector<int> log;
+    auto task = wait_for_task(event, log);
+    event.fire();
+    event.fire();
+    REQUIRE(log == std::vector<int>{0, 1, 2, 3, 4});
+    REQUIRE(!task.is_running());
+}
+
+TEST_CASE("Destroying a task destroys the suspended coroutine")
+{
+    manual_event_t event;
+    bool destroyed = false;
+    {
+        auto task = hold_flag(event, &destroyed);
+        REQUIRE(!destroyed);
+    }
+
+    REQUIRE(destroyed);
+}
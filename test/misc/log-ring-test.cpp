@@ -0,0 +1,51 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+#include <string>
+
+#include <wayfire/log-ring.hpp>
+#include <wayfire/debug.hpp>
+
+TEST_CASE("Log ring formats recorded arguments lazily")
+{
+    wf::log::ring::clear();
+    wf::geometry_t box = {1, 2, 3, 4};
+    std::string name = "view";
+    wf::log::ring::record((size_t)wf::log::logging_category::TXN, "/path/to/file.cpp", 42,
+        "value ", 5, " ", -7, " ", true, " ", name, " ", box, " ", (void*)nullptr);
+
+    auto lines = wf::log::ring::format_all();
+    REQUIRE(lines.size() == 1);
+
+    std::string expected = "[TXN] file.cpp:42 value 5 -7 true view " +
+        wf::log::detail::format_concat(box) + " (null)";
+    REQUIRE(lines[0].size() > expected.size());
+    CHECK(lines[0].substr(lines[0].size() - expected.size()) == expected);
+
+    wf::log::ring::clear();
+    CHECK(wf::log::ring::format_all().empty());
+}
+
+TEST_CASE("Log ring drops the oldest records when full")
+{
+    wf::log::ring::clear();
+    const std::string payload(1000, 'x');
+    const int count = 2 * wf::log::ring::RING_CAPACITY / payload.size();
+    for (int i = 0; i < count; i++)
+    {
+        wf::log::ring::record((size_t)wf::log::logging_category::RENDER, "file.cpp", i, payload, " #", i);
+    }
+
+    auto lines = wf::log::ring::format_all();
+    REQUIRE(!lines.empty());
+    REQUIRE((int)lines.size() < count);
+
+    // The newest record survives, in order after the others.
+    auto last = " #" + std::to_string(count - 1);
+    CHECK(lines.back().substr(lines.back().size() - last.size()) == last);
+    for (size_t i = 1; i < lines.size(); i++)
+    {
+        auto prev = std::stoi(lines[i - 1].substr(lines[i - 1].rfind('#') + 1));
+        auto cur  = std::stoi(lines[i].substr(lines[i].rfind('#') + 1));
+        CHECK(prev + 1 == cur);
+    }
+}
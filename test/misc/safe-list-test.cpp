@@ -1,11 +1,29 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
+#include <functional>
+#include <vector>
 
 #include <wayfire/nonstd/safe-list.hpp>
+#include <wayfire/nonstd/compact-safe-list.hpp>
 
-TEST_CASE("Safe-list basics")
+// wf::safe_list_t and wf::compact_safe_list_t have the same interface, the tests run for both.
+struct safe_list_tag_t
 {
-    wf::safe_list_t<int> list;
+    template<class T>
+    using list_t = wf::safe_list_t<T>;
+};
+
+struct compact_safe_list_tag_t
+{
+    template<class T>
+    using list_t = wf::compact_safe_list_t<T>;
+};
+
+#define SAFE_LISTS safe_list_tag_t, compact_safe_list_tag_t
+
+TEST_CASE_TEMPLATE("Safe-list basics", List, SAFE_LISTS)
+{
+    typename List::template list_t<int> list;
 
     list.push_back(5);
     list.push_back(6);
@@ -42,10 +60,10 @@ TEST_CASE("Safe-list basics")
     });
 }
 
-TEST_CASE("safe-list remove self")
+TEST_CASE_TEMPLATE("safe-list remove self", List, SAFE_LISTS)
 {
     using cb = std::function<void ()>;
-    wf::safe_list_t<cb*> list;
+    typename List::template list_t<cb*> list;
 
     cb self;
     list.push_back(&self);
@@ -56,10 +74,10 @@ TEST_CASE("safe-list remove self")
     });
 }
 
-TEST_CASE("safe-list remove next")
+TEST_CASE_TEMPLATE("safe-list remove next", List, SAFE_LISTS)
 {
     using cb = std::function<void ()>;
-    wf::safe_list_t<cb*> list;
+    typename List::template list_t<cb*> list;
 
     cb self, next;
     list.push_back(&self);
@@ -76,10 +94,10 @@ TEST_CASE("safe-list remove next")
     });
 }
 
-TEST_CASE("safe-list push next")
+TEST_CASE_TEMPLATE("safe-list push next", List, SAFE_LISTS)
 {
     using cb = std::function<void ()>;
-    wf::safe_list_t<cb*> list;
+    typename List::template list_t<cb*> list;
 
     cb self, next;
     list.push_back(&self);
@@ -94,3 +112,41 @@ TEST_CASE("safe-list push next")
 
     REQUIRE(list.size() == 2);
 }
+
+TEST_CASE("compact safe-list nested removal")
+{
+    wf::compact_safe_list_t<int, 2> list;
+    for (int i = 0; i < 10; i++)
+    {
+        list.push_back(i);
+    }
+
+    std::vector<int> visited;
+    list.for_each([&] (int i)
+    {
+        visited.push_back(i);
+        list.for_each_reverse([&] (int j)
+        {
+            // Remove the odd elements and grow the list from the nested iteration.
+            if (j % 2)
+            {
+                list.remove_all(j);
+            }
+        });
+
+        if (i == 0)
+        {
+            list.push_back(10);
+        }
+
+        REQUIRE(list.size() == 6);
+    });
+
+    REQUIRE(visited == std::vector<int>{0, 2, 4, 6, 8});
+    REQUIRE(list.front() == 0);
+    REQUIRE(list.back() == 10);
+
+    visited.clear();
+    list.for_each([&] (int i) { visited.push_back(i); });
+    REQUIRE(visited == std::vector<int>{0, 2, 4, 6, 8, 10});
+}
@@ -0,0 +1,122 @@
+#include "wayfire/signal-provider.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+struct signal_a
+{
+    int value = 0;
+};
+
+struct signal_b
+{
+    int value = 0;
+};
+
+TEST_CASE("Signals are delivered only to connections of the same type")
+{
+    wf::signal::provider_t provider;
+
+    int a_count = 0, b_count = 0;
+    wf::signal::connection_t<signal_a> on_a = [&] (signal_a *ev) { a_count += ev->value; };
+    wf::signal::connection_t<signal_b> on_b = [&] (signal_b *ev) { b_count += ev->value; };
+
+    signal_a a{1};
+    signal_b b{2};
+
+    // No connections at all
+    provider.emit(&a);
+    REQUIRE(a_count == 0);
+
+    provider.connect(&on_a);
+    provider.emit(&a);
+    provider.emit(&b);
+    REQUIRE(a_count == 1);
+    REQUIRE(b_count == 0);
+
+    provider.connect(&on_b);
+    provider.emit(&b);
+    REQUIRE(a_count == 1);
+    REQUIRE(b_count == 2);
+
+    on_a.disconnect();
+    REQUIRE(!on_a.is_connected());
+    provider.emit(&a);
+    provider.emit(&b);
+    REQUIRE(a_count == 1);
+    REQUIRE(b_count == 4);
+}
+
+TEST_CASE("Connecting a new signal type during emission")
+{
+    wf::signal::provider_t provider;
+
+    int b_count = 0;
+    wf::signal::connection_t<signal_b> on_b = [&] (signal_b*) { ++b_count; };
+    wf::signal::connection_t<signal_a> on_a = [&] (signal_a*)
+    {
+        provider.connect(&on_b);
+        signal_b b;
+        provider.emit(&b);
+    };
+
+    provider.connect(&on_a);
+    signal_a a;
+    provider.emit(&a);
+    REQUIRE(b_count == 1);
+}
+
+TEST_CASE("Connections are cleaned up when the provider is destroyed")
+{
+    wf::signal::connection_t<signal_a> on_a = [&] (signal_a*) {};
+    {
+        wf::signal::provider_t provider;
+        provider.connect(&on_a);
+        REQUIRE(on_a.is_connected());
+    }
+
+    REQUIRE(!on_a.is_connected());
+}
+
+TEST_CASE("Connections to many providers and large callbacks")
+{
+    wf::signal::provider_t providers[4];
+
+    // Larger than the inline storage of the callback
+    char padding[128] = {1};
+    int count = 0;
+    wf::signal::connection_t<signal_a> on_a = [&count, padding] (signal_a *ev)
+    {
+        count += ev->value * padding[0];
+    };
+
+    for (auto& p : providers)
+    {
+        p.connect(&on_a);
+    }
+
+    signal_a a{1};
+    for (auto& p : providers)
+    {
+        p.emit(&a);
+    }
+
+    REQUIRE(count == 4);
+
+    providers[1].disconnect(&on_a);
+    REQUIRE(on_a.is_connected());
+    on_a.disconnect();
+    REQUIRE(!on_a.is_connected());
+    for (auto& p : providers)
+    {
+        p.emit(&a);
+    }
+
+    REQUIRE(count == 4);
+
+    // Resetting the callback with an empty function
+    std::function<void(signal_a*)> empty;
+    on_a = empty;
+    providers[0].connect(&on_a);
+    providers[0].emit(&a);
+    REQUIRE(count == 4);
+}
@@ -0,0 +1,81 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+#include <atomic>
+#include <vector>
+
+#include <wayfire/thread-pool.hpp>
+#include <wayland-server-core.h>
+
+TEST_CASE("parallel_for runs every index exactly once")
+{
+    auto loop = wl_event_loop_create();
+    {
+        wf::thread_pool_t pool{loop, 3};
+        REQUIRE(pool.get_worker_count() == 3);
+
+        std::vector<std::atomic<int>> hits(1000);
+        pool.parallel_for(hits.size(), [&] (size_t i) { hits[i]++; });
+        for (auto& hit : hits)
+        {
+            REQUIRE(hit == 1);
+        }
+
+        // Nested calls from the workers must not deadlock.
+        std::atomic<int> total = 0;
+        pool.parallel_for(8, [&] (size_t)
+        {
+            pool.parallel_for(8, [&] (size_t) { total++; });
+        });
+        REQUIRE(total == 64);
+    }
+
+    wl_event_loop_destroy(loop);
+}
+
+TEST_CASE("Task completions run on the event loop")
+{
+    auto loop = wl_event_loop_create();
+    {
+        wf::thread_pool_t pool{loop, 2};
+        wf::task_group_t group{pool};
+
+        std::atomic<int> tasks = 0;
+        int completions = 0;
+        for (int i = 0; i < 10; i++)
+        {
+            group.submit([&] { tasks++; }, [&] { completions++; });
+        }
+
+        REQUIRE(group.get_pending_count() == 10);
+        while (group.get_pending_count() > 0)
+        {
+            wl_event_loop_dispatch(loop, -1);
+        }
+
+        REQUIRE(tasks == 10);
+        REQUIRE(completions == 10);
+    }
+
+    wl_event_loop_destroy(loop);
+}
+
+TEST_CASE("Destroying a task group drops its completions")
+{
+    auto loop = wl_event_loop_create();
+    {
+        wf::thread_pool_t pool{loop, 2};
+        int completions = 0;
+        {
+            wf::task_group_t group{pool};
+            for (int i = 0; i < 100; i++)
+            {
+                group.submit([] {}, [&] { completions++; });
+            }
+        }
+
+        wl_event_loop_dispatch(loop, 0);
+        REQUIRE(completions == 0);
+    }
+
+    wl_event_loop_destroy(loop);
+}
@@ -1,5 +1,6 @@
 #include "wayfire/nonstd/tracking-allocator.hpp"
 #include "wayfire/signal-provider.hpp"
+#include <algorithm>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 
@@ -54,3 +55,72 @@ TEST_CASE("Misc factory works")
     REQUIRE(destruct_events == 1);
     REQUIRE(allocator.get_all().size() == 1);
 }
+
+class movable_t : public base_t
+{
+  public:
+    movable_t(std::unique_ptr<int> value, int& constructed) : value(std::move(value))
+    {
+        ++constructed;
+    }
+
+    std::unique_ptr<int> value;
+};
+
+TEST_CASE("Arguments are forwarded")
+{
+    auto& allocator = wf::tracking_allocator_t<base_t>::get();
+    int constructed = 0;
+    auto obj = allocator.allocate<movable_t>(std::make_unique<int>(42), constructed);
+    REQUIRE(constructed == 1);
+    REQUIRE(*obj->value == 42);
+}
+
+TEST_CASE("Objects are tracked under churn")
+{
+    auto& allocator = wf::tracking_allocator_t<base_t>::get();
+    const size_t initial = allocator.get_all().size();
+    const int destroyed_start = base_t::destroyed;
+
+    std::vector<std::shared_ptr<base_t>> objects;
+    std::vector<std::weak_ptr<base_t>> weak;
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < 50; i++)
+        {
+            objects.push_back(allocator.allocate<derived_t>(i));
+            weak.push_back(objects.back());
+        }
+
+        // Free every third object, from the middle of the list.
+        for (size_t i = objects.size(); i > 0; i--)
+        {
+            if (i % 3 == 0)
+            {
+                objects.erase(objects.begin() + i - 1);
+            }
+        }
+
+        REQUIRE(allocator.get_all().size() == initial + objects.size());
+        for (auto& obj : objects)
+        {
+            auto& all = allocator.get_all();
+            REQUIRE(std::count(all.begin(), all.end(), nonstd::make_observer(obj.get())) == 1);
+        }
+
+        // The objects are listed in the order they were allocated.
+        auto& all = allocator.get_all();
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            REQUIRE(all[initial + i].get() == objects[i].get());
+        }
+    }
+
+    objects.clear();
+    REQUIRE(allocator.get_all().size() == initial);
+    REQUIRE(base_t::destroyed - destroyed_start == (int)weak.size());
+    for (auto& obj : weak)
+    {
+        REQUIRE(obj.expired());
+    }
+}
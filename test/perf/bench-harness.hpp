@@ -0,0 +1,142 @@
+#pragma once
+
+#include <wayfire/util/log.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+namespace perf
+{
+/** @return The time it takes to run @op once, in nanoseconds. */
+inline double time_ns(const std::function<void()>& op)
+{
+    using clock = std::chrono::steady_clock;
+    auto start  = clock::now();
+    op();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+}
+
+/** A command line parameter of a benchmark. */
+struct bench_param_t
+{
+    std::string name;
+    int value;
+    int min = 1;
+    int max = INT_MAX;
+};
+
+/**
+ * The command line and the report shared by the benchmarks in this directory.
+ *
+ * Parameters are declared with their default values and can be overridden with "--name value". The report
+ * is printed as JSON on stdout by finish(): the parameters, the measured times in nanoseconds per operation
+ * under "results-ns", and the values which the benchmark added to extra (typically checksums, so that the
+ * compiler cannot drop the workloads).
+ */
+class bench_t
+{
+  public:
+    bench_t(int argc, char **argv, std::vector<bench_param_t> params) : params(std::move(params))
+    {
+        wf::log::initialize_logging(std::cerr, wf::log::LOG_LEVEL_ERROR, wf::log::LOG_COLOR_MODE_OFF);
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto it = std::find_if(this->params.begin(), this->params.end(),
+                [&] (const bench_param_t& param) { return arg == "--" + param.name; });
+            if ((it == this->params.end()) || (i + 1 >= argc))
+            {
+                usage(argv[0], arg);
+            }
+
+            it->value = std::clamp(std::atoi(argv[++i]), it->min, it->max);
+        }
+    }
+
+    /** @return The value of the parameter with the given name. */
+    int param(const std::string& name) const
+    {
+        for (auto& param : params)
+        {
+            if (param.name == name)
+            {
+                return param.value;
+            }
+        }
+
+        std::fprintf(stderr, "Benchmark has no parameter %s\n", name.c_str());
+        std::abort();
+    }
+
+    /**
+     * Run @op for each i in [0, iterations), and record the time per operation as the result @name.
+     *
+     * @param ops_per_iteration How many operations each call of @op does.
+     * @return The time per operation in nanoseconds.
+     */
+    double measure(const std::string& name, int iterations, const std::function<void(int)>& op,
+        double ops_per_iteration = 1)
+    {
+        const double ns = time_ns([&] ()
+        {
+            for (int i = 0; i < iterations; i++)
+            {
+                op(i);
+            }
+        });
+
+        return add_result(name, ns / std::max(1.0, iterations * ops_per_iteration));
+    }
+
+    /** Record a time per operation which was measured otherwise. */
+    double add_result(const std::string& name, double ns_per_op)
+    {
+        results[name] = ns_per_op;
+        return ns_per_op;
+    }
+
+    /** Values to add to the report besides the parameters and the results. */
+    nlohmann::json extra = nlohmann::json::object();
+
+    /** Print the report and return the exit code of the benchmark. */
+    int finish()
+    {
+        nlohmann::json report = extra;
+        for (auto& param : params)
+        {
+            report["params"][param.name] = param.value;
+        }
+
+        report["results-ns"] = results;
+        std::printf("%s\n", report.dump(2).c_str());
+        return 0;
+    }
+
+  private:
+    std::vector<bench_param_t> params;
+    nlohmann::json results = nlohmann::json::object();
+
+    [[noreturn]] void usage(const char *program, const std::string& arg)
+    {
+        std::fprintf(stderr, "Invalid argument %s\nUsage: %s", arg.c_str(), program);
+        for (auto& param : params)
+        {
+            std::fprintf(stderr, " [--%s N (default %d)]", param.name.c_str(), param.value);
+        }
+
+        std::fprintf(stderr, "\n");
+        std::exit(1);
+    }
+};
+}
+}
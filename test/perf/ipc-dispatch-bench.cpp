@@ -0,0 +1,69 @@
+#include "bench-harness.hpp"
+#include "plugins/ipc/ipc-method-repository.hpp"
+#include <wayfire/util.hpp>
+#include <wayland-server-core.h>
+
+#include <string>
+
+/**
+ * A benchmark of the dispatch of IPC method calls through the method repository.
+ *
+ * Usage: ipc-dispatch-bench [--methods N] [--iterations N] [--payload-views N]
+ *
+ * The times include building the request message as the IPC socket does after parsing.
+ */
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv,
+        {{"methods", 200}, {"iterations", 100000}, {"payload-views", 50, 0}}};
+    const int nr_methods    = bench.param("methods");
+    const int iterations    = bench.param("iterations");
+    const int payload_views = bench.param("payload-views");
+
+    wf::wl_idle_call::loop = wl_event_loop_create();
+
+    wf::ipc::method_repository_t repository;
+    std::vector<std::string> names;
+    size_t handled = 0;
+    for (int i = 0; i < nr_methods; i++)
+    {
+        names.push_back("plugin-" + std::to_string(i % 20) + "/method-" + std::to_string(i));
+        repository.register_method(names.back(), [&] (nlohmann::json data)
+        {
+            handled += data.size();
+            return nlohmann::json{{"result", "ok"}};
+        });
+    }
+
+    // A request like window-rules/configure-view, and a large one like a batch of view descriptions.
+    const nlohmann::json small_request = {{"id", 42}, {"geometry", {{"x", 0}, {"y", 0}, {"width", 800}}}};
+    nlohmann::json large_request = {{"views", nlohmann::json::array()}};
+    for (int i = 0; i < payload_views; i++)
+    {
+        large_request["views"].push_back({
+            {"id", i}, {"title", "A window title " + std::to_string(i)}, {"app-id", "org.example.app"},
+            {"geometry", {{"x", i}, {"y", i}, {"width", 640}, {"height", 480}}}
+        });
+    }
+
+    bench.measure("small_request", iterations, [&] (int i)
+    {
+        nlohmann::json message = {{"method", names[i % names.size()]}, {"data", small_request}};
+        repository.call_method(message["method"], std::move(message["data"]));
+    });
+
+    bench.measure("large_request", iterations / 10, [&] (int i)
+    {
+        nlohmann::json message = {{"method", names[i % names.size()]}, {"data", large_request}};
+        repository.call_method(message["method"], std::move(message["data"]));
+    });
+
+    bench.measure("missing_method", iterations, [&] (int i)
+    {
+        repository.call_method("no-such-method", nlohmann::json::object());
+    });
+
+    bench.extra["handled"] = handled;
+    return bench.finish();
+}
@@ -0,0 +1,170 @@
+#include "bench-harness.hpp"
+#include "src/core/matcher-priv.hpp"
+#include <wayfire/lexer/lexer.hpp>
+#include <wayfire/condition/condition.hpp>
+#include <wayfire/parser/condition_parser.hpp>
+#include <unordered_map>
+
+/**
+ * A benchmark of the evaluation of view matchers, comparing the ways of looking up the properties used by
+ * a condition:
+ * - compare: comparing the identifier with each supported identifier in turn, like the view access
+ *   interface did originally,
+ * - by_name: looking up the identifier in a map, like view_access_interface_t::get(identifier),
+ * - resolved: the resolved access interface of wf::view_matcher_t.
+ *
+ * Usage: matcher-bench [--views N] [--rounds N]
+ *
+ * Each round evaluates a typical window rule condition for every view. The times are per evaluation.
+ */
+
+struct bench_view_t
+{
+    std::string app_id;
+    std::string title;
+    bool fullscreen = false;
+};
+
+/** Like view_access_interface_t, for a synthetic view. */
+class bench_access_interface_t : public wf::access_interface_t
+{
+  public:
+    enum class property_t
+    {
+        APP_ID,
+        TITLE,
+        FULLSCREEN,
+        TYPE,
+        UNKNOWN,
+    };
+
+    const bench_view_t *view = nullptr;
+
+    static property_t resolve_property(const std::string& identifier)
+    {
+        static const std::unordered_map<std::string, property_t> properties = {
+            {"app_id", property_t::APP_ID},
+            {"title", property_t::TITLE},
+            {"fullscreen", property_t::FULLSCREEN},
+            {"type", property_t::TYPE},
+        };
+
+        auto it = properties.find(identifier);
+        return (it == properties.end()) ? property_t::UNKNOWN : it->second;
+    }
+
+    wf::variant_t get(const std::string& identifier, bool& error) override
+    {
+        return get(resolve_property(identifier), error);
+    }
+
+    wf::variant_t get(property_t property, bool& error)
+    {
+        error = false;
+        switch (property)
+        {
+          case property_t::APP_ID:
+            return view->app_id;
+
+          case property_t::TITLE:
+            return view->title;
+
+          case property_t::FULLSCREEN:
+            return view->fullscreen;
+
+          case property_t::TYPE:
+            return std::string("toplevel");
+
+          case property_t::UNKNOWN:
+            break;
+        }
+
+        return std::string("");
+    }
+};
+
+/** Compares the identifier with each supported identifier, in the order of the view access interface. */
+class bench_compare_access_interface_t : public bench_access_interface_t
+{
+  public:
+    using bench_access_interface_t::get;
+
+    wf::variant_t get(const std::string& identifier, bool& error) override
+    {
+        static const std::pair<const char*, property_t> properties[] = {
+            {"app_id", property_t::APP_ID},
+            {"title", property_t::TITLE},
+            {"role", property_t::UNKNOWN},
+            {"fullscreen", property_t::FULLSCREEN},
+            {"activated", property_t::UNKNOWN},
+            {"minimized", property_t::UNKNOWN},
+            {"focusable", property_t::UNKNOWN},
+            {"mapped", property_t::UNKNOWN},
+            {"tiled-left", property_t::UNKNOWN},
+            {"tiled-right", property_t::UNKNOWN},
+            {"tiled-top", property_t::UNKNOWN},
+            {"tiled-bottom", property_t::UNKNOWN},
+            {"maximized", property_t::UNKNOWN},
+            {"floating", property_t::UNKNOWN},
+            {"type", property_t::TYPE},
+        };
+
+        for (auto& [name, property] : properties)
+        {
+            if (identifier == name)
+            {
+                return get(property, error);
+            }
+        }
+
+        return get(property_t::UNKNOWN, error);
+    }
+};
+
+template<class Access>
+static long measure(wf::perf::bench_t& bench, const std::string& name, wf::condition_t& condition,
+    const std::vector<bench_view_t>& views, Access& access, const bench_view_t*& current)
+{
+    long matches = 0;
+    bench.measure(name, bench.param("rounds"), [&] (int)
+    {
+        for (auto& view : views)
+        {
+            current = &view;
+            bool ignored = false;
+            matches += condition.evaluate(access, ignored);
+        }
+    }, views.size());
+
+    return matches;
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {{"views", 1000}, {"rounds", 200}}};
+
+    wf::lexer_t lexer;
+    lexer.reset("(app_id is \"firefox\" | title contains \"Mail\" | app_id contains \"term\") & "
+                "type is \"toplevel\" & !(fullscreen is true)");
+    auto condition = wf::condition_parser_t{}.parse(lexer);
+
+    const char *app_ids[] = {"firefox", "org.gnome.Nautilus", "kitty", "xterm", "mpv"};
+    std::vector<bench_view_t> views(bench.param("views"));
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        views[i].app_id     = app_ids[i % 5];
+        views[i].title      = (i % 3 == 0) ? "Inbox - Mail" : "Document " + std::to_string(i);
+        views[i].fullscreen = (i % 7 == 0);
+    }
+
+    bench_compare_access_interface_t compare;
+    bench_access_interface_t by_name;
+    wf::resolved_access_interface_t<bench_access_interface_t> resolved;
+    bench.extra["matches"] = {
+        {"compare", measure(bench, "compare", *condition, views, compare, compare.view)},
+        {"by_name", measure(bench, "by_name", *condition, views, by_name, by_name.view)},
+        {"resolved", measure(bench, "resolved", *condition, views, resolved, resolved.access.view)},
+    };
+
+    return bench.finish();
+}
@@ -0,0 +1,589 @@
+#include "bench-harness.hpp"
+#include "wayfire/txn/transaction-manager.hpp"
+#include "../txn/transaction-test-object.hpp"
+#include "plugins/ipc/ipc-helpers.hpp"
+#include <wayfire/txn/transaction.hpp>
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/signal-provider.hpp>
+#include <wayfire/unstable/translation-node.hpp>
+#include <wayfire/region.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/util/log.hpp>
+#include <wayfire/config/section.hpp>
+#include <wayfire/config/option.hpp>
+#include <wayfire/lexer/lexer.hpp>
+#include <wayfire/condition/condition.hpp>
+#include <wayfire/condition/access_interface.hpp>
+#include <wayfire/parser/condition_parser.hpp>
+#include <wayland-server-core.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A performance regression suite for the hot paths of the core: transaction scheduling, region operations,
+ * signal emission, scenegraph traversal, matcher evaluation and IPC serialization of large view lists.
+ *
+ * Usage: perf-regression [--baselines FILE] [--update-baselines] [--repetitions N]
+ *
+ * Each case runs a fixed workload several times, and the fastest run is kept. To make the results comparable
+ * between machines, they are divided by the time of a calibration workload (sorting integers) measured the
+ * same way, and compared to the relative costs stored in the baselines file. A case fails if it is slower
+ * than its baseline by more than the tolerance of the file (or of the case). A case without a baseline fails
+ * too, so that a suite which has not been calibrated yet cannot pass silently.
+ *
+ * With --update-baselines, the measured relative costs are written to the baselines file instead, keeping
+ * the tolerances. Baselines should be updated on an otherwise idle machine, with a release build.
+ *
+ * The results are printed as JSON on stdout, the exit code is 1 if any case regressed or has no baseline.
+ */
+
+struct perf_case_t
+{
+    std::string name;
+    // Prepares the workload and returns a function which runs it once, returning the number of operations.
+    std::function<std::function<int()>()> setup;
+};
+
+// Results of the workloads, so that the compiler cannot drop them.
+static uint64_t checksum = 0;
+
+struct case_result_t
+{
+    std::string name;
+    double ns_per_op;
+    double relative;
+};
+
+/** @return The fastest time per operation of @repetitions runs of @run, in nanoseconds. */
+static double measure(int repetitions, const std::function<int()>& run)
+{
+    double best = INFINITY;
+    for (int r = 0; r < repetitions; r++)
+    {
+        int ops = 0;
+        const double ns = wf::perf::time_ns([&] () { ops = run(); });
+        best = std::min(best, ns / std::max(ops, 1));
+    }
+
+    return best;
+}
+
+/** A deterministic pseudo-random generator, so that the workloads are the same in every run. */
+struct lcg_t
+{
+    uint32_t seed = 42;
+    int next(int max)
+    {
+        seed = seed * 1103515245 + 12345;
+        return (int)((seed >> 16) % max);
+    }
+};
+
+static std::function<int()> calibration_workload()
+{
+    return [] ()
+    {
+        lcg_t rng;
+        std::vector<int> values(1 << 16);
+        for (auto& v : values)
+        {
+            v = rng.next(1 << 30);
+        }
+
+        std::sort(values.begin(), values.end());
+        checksum += values[values.size() / 2];
+        return (int)values.size() / 1024;
+    };
+}
+
+/* ------------------------------- Transactions ------------------------------- */
+
+static std::function<int()> transaction_workload()
+{
+    constexpr int OBJECTS = 2000;
+    auto objects = std::make_shared<std::vector<std::shared_ptr<txn_test_object_t>>>();
+    for (int i = 0; i < OBJECTS; i++)
+    {
+        objects->push_back(std::make_shared<txn_test_object_t>(false));
+    }
+
+    // Every object gets its own transaction, which is committed immediately and applied afterwards.
+    return [objects] ()
+    {
+        wf::txn::transaction_manager_t manager;
+        for (auto& obj : *objects)
+        {
+            auto tx = std::make_unique<wf::txn::transaction_t>(0, [] (auto, auto) {});
+            tx->add_object(obj);
+            manager.schedule_transaction(std::move(tx));
+        }
+
+        for (auto& obj : *objects)
+        {
+            obj->emit_ready();
+        }
+
+        wl_event_loop_dispatch_idle(wf::wl_idle_call::loop);
+        return OBJECTS;
+    };
+}
+
+/* ------------------------------- Regions ------------------------------- */
+
+static std::function<int()> region_workload()
+{
+    constexpr int BOXES = 200;
+    lcg_t rng;
+    auto boxes = std::make_shared<std::vector<wf::geometry_t>>();
+    for (int i = 0; i < BOXES; i++)
+    {
+        boxes->push_back({rng.next(1800), rng.next(1000), 32 + rng.next(600), 32 + rng.next(400)});
+    }
+
+    // Accumulating damage of many surfaces, clipped to the output and with opaque regions cut out.
+    return [boxes] ()
+    {
+        const wf::geometry_t output_box = {0, 0, 1920, 1080};
+        wf::region_t frame_damage;
+        for (const auto& box : *boxes)
+        {
+            wf::region_t damage = box;
+            damage &= output_box;
+            damage ^= wf::geometry_t{box.x + 8, box.y + 8, 16, 16};
+            frame_damage |= damage;
+        }
+
+        frame_damage ^= wf::geometry_t{100, 100, 400, 300};
+        checksum += frame_damage.empty();
+        return BOXES;
+    };
+}
+
+/* ------------------------------- Signals ------------------------------- */
+
+struct perf_signal_t
+{
+    int value = 0;
+};
+
+static std::function<int()> signal_workload()
+{
+    constexpr int CONNECTIONS = 32;
+    constexpr int EMISSIONS   = 10000;
+
+    struct state_t
+    {
+        wf::signal::provider_t provider;
+        std::vector<std::unique_ptr<wf::signal::connection_t<perf_signal_t>>> connections;
+        long calls = 0;
+    };
+
+    auto state = std::make_shared<state_t>();
+    for (int i = 0; i < CONNECTIONS; i++)
+    {
+        auto conn = std::make_unique<wf::signal::connection_t<perf_signal_t>>();
+        conn->set_callback([s = state.get()] (perf_signal_t *ev)
+        {
+            s->calls += ev->value;
+        });
+        state->provider.connect(conn.get());
+        state->connections.push_back(std::move(conn));
+    }
+
+    return [state] ()
+    {
+        perf_signal_t ev;
+        ev.value = 1;
+        for (int i = 0; i < EMISSIONS; i++)
+        {
+            state->provider.emit(&ev);
+        }
+
+        return EMISSIONS;
+    };
+}
+
+/* ------------------------------- Scenegraph ------------------------------- */
+
+class perf_surface_node_t : public wf::scene::node_t
+{
+  public:
+    perf_surface_node_t(wf::geometry_t box) : node_t(false), box(box)
+    {}
+
+    std::optional<wf::scene::input_node_t> find_node_at(const wf::pointf_t& at) override
+    {
+        if (box & at)
+        {
+            wf::scene::input_node_t result;
+            result.node = this;
+            result.local_coords = {at.x - box.x, at.y - box.y};
+            return result;
+        }
+
+        return {};
+    }
+
+    void gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
+        wf::scene::damage_callback push_damage, wf::output_t *output) override;
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return box;
+    }
+
+    std::string stringify() const override
+    {
+        return "perf surface " + stringify_flags();
+    }
+
+    wf::geometry_t box;
+};
+
+class perf_surface_instance_t : public wf::scene::simple_render_instance_t<perf_surface_node_t>
+{
+  public:
+    using simple_render_instance_t::simple_render_instance_t;
+
+    void render(const wf::render_target_t& target, const wf::region_t& region) override
+    {}
+};
+
+void perf_surface_node_t::gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
+    wf::scene::damage_callback push_damage, wf::output_t *output)
+{
+    instances.push_back(std::make_unique<perf_surface_instance_t>(this, push_damage, output));
+}
+
+/** An output with 50 views of 4 surfaces each, like a busy desktop. */
+static std::shared_ptr<wf::scene::floating_inner_node_t> build_scene()
+{
+    lcg_t rng;
+    auto root = std::make_shared<wf::scene::floating_inner_node_t>(true);
+    std::vector<wf::scene::node_ptr> views;
+    for (int v = 0; v < 50; v++)
+    {
+        auto view = std::make_shared<wf::scene::translation_node_t>();
+        view->set_offset({rng.next(1500), rng.next(800)});
+        std::vector<wf::scene::node_ptr> surfaces;
+        for (int s = 0; s < 4; s++)
+        {
+            surfaces.push_back(std::make_shared<perf_surface_node_t>(
+                wf::geometry_t{rng.next(300), rng.next(200), 64 + rng.next(400), 64 + rng.next(300)}));
+        }
+
+        view->set_children_list(surfaces);
+        views.push_back(view);
+    }
+
+    root->set_children_list(views);
+    return root;
+}
+
+static std::function<int()> find_node_at_workload()
+{
+    constexpr int QUERIES = 2000;
+    auto root = build_scene();
+    return [root] ()
+    {
+        for (int i = 0; i < QUERIES; i++)
+        {
+            wf::pointf_t at{(double)((i * 7919) % 1920), (double)((i * 104729) % 1080)};
+            checksum += root->find_node_at(at).has_value();
+        }
+
+        return QUERIES;
+    };
+}
+
+static std::function<int()> gen_render_instances_workload()
+{
+    constexpr int PASSES = 200;
+    auto root = build_scene();
+    return [root] ()
+    {
+        for (int i = 0; i < PASSES; i++)
+        {
+            std::vector<wf::scene::render_instance_uptr> instances;
+            root->gen_render_instances(instances, [] (const wf::region_t&) {}, nullptr);
+            checksum += instances.size();
+        }
+
+        return PASSES;
+    };
+}
+
+/* ------------------------------- Matchers ------------------------------- */
+
+/** Like the view access interface, for a synthetic view. */
+class perf_access_interface_t : public wf::access_interface_t
+{
+  public:
+    std::string app_id;
+    std::string title;
+    bool fullscreen = false;
+
+    wf::variant_t get(const std::string& identifier, bool& error) override
+    {
+        if (identifier == "app_id")
+        {
+            return app_id;
+        } else if (identifier == "title")
+        {
+            return title;
+        } else if (identifier == "fullscreen")
+        {
+            return fullscreen;
+        } else if (identifier == "type")
+        {
+            return std::string("toplevel");
+        }
+
+        error = true;
+        return std::string("");
+    }
+};
+
+static std::function<int()> matcher_workload()
+{
+    constexpr int VIEWS = 1000;
+    struct state_t
+    {
+        std::shared_ptr<wf::condition_t> condition;
+        std::vector<perf_access_interface_t> views;
+    };
+
+    auto state = std::make_shared<state_t>();
+    wf::lexer_t lexer;
+    lexer.reset("(app_id is \"firefox\" | title contains \"Mail\" | app_id contains \"term\") & "
+                "type is \"toplevel\" & !(fullscreen is true)");
+    state->condition = wf::condition_parser_t{}.parse(lexer);
+
+    const char *app_ids[] = {"firefox", "org.gnome.Nautilus", "kitty", "xterm", "mpv"};
+    for (int i = 0; i < VIEWS; i++)
+    {
+        perf_access_interface_t view;
+        view.app_id     = app_ids[i % 5];
+        view.title      = (i % 3 == 0) ? "Inbox - Mail" : "Document " + std::to_string(i);
+        view.fullscreen = (i % 7 == 0);
+        state->views.push_back(std::move(view));
+    }
+
+    return [state] ()
+    {
+        for (auto& view : state->views)
+        {
+            bool ignored = false;
+            checksum += state->condition->evaluate(view, ignored);
+        }
+
+        return VIEWS;
+    };
+}
+
+/* ------------------------------- IPC ------------------------------- */
+
+static std::function<int()> ipc_serialization_workload()
+{
+    constexpr int VIEWS = 500;
+
+    // The same fields as view_to_json() in ipc-rules, for synthetic views.
+    return [] ()
+    {
+        nlohmann::json list = nlohmann::json::array();
+        for (int i = 0; i < VIEWS; i++)
+        {
+            wf::geometry_t geometry = {i % 1920, i % 1080, 800, 600};
+            nlohmann::json description;
+            description["id"]     = i;
+            description["pid"]    = 1000 + i;
+            description["title"]  = "A window title " + std::to_string(i);
+            description["app-id"] = "org.example.app";
+            description["base-geometry"] = wf::ipc::geometry_to_json(geometry);
+            description["parent"]   = -1;
+            description["geometry"] = wf::ipc::geometry_to_json(geometry);
+            description["bbox"] = wf::ipc::geometry_to_json(geometry);
+            description["output-id"]   = 1;
+            description["output-name"] = "DP-1";
+            description["last-focus-timestamp"] = 123456789 + i;
+            description["role"]   = "toplevel";
+            description["mapped"] = true;
+            description["layer"]  = "workspace";
+            description["tiled-edges"] = 0;
+            description["fullscreen"]  = false;
+            description["minimized"]   = false;
+            description["activated"]   = (i == 0);
+            description["sticky"]     = false;
+            description["wset-index"] = 1;
+            description["min-size"]   = wf::ipc::dimensions_to_json({0, 0});
+            description["max-size"]   = wf::ipc::dimensions_to_json({0, 0});
+            description["focusable"]  = true;
+            description["type"] = "toplevel";
+            list.push_back(std::move(description));
+        }
+
+        // The response is serialized as the IPC socket does before sending it.
+        checksum += list.dump().size();
+        return VIEWS;
+    };
+}
+
+/* ------------------------------- Driver ------------------------------- */
+
+static std::vector<perf_case_t> all_cases()
+{
+    return {
+        {"transaction_schedule", transaction_workload},
+        {"region_ops", region_workload},
+        {"signal_emit", signal_workload},
+        {"scene_find_node_at", find_node_at_workload},
+        {"scene_gen_render_instances", gen_render_instances_workload},
+        {"matcher_evaluate", matcher_workload},
+        {"ipc_view_list_serialization", ipc_serialization_workload},
+    };
+}
+
+static void register_options()
+{
+    auto core = std::make_shared<wf::config::section_t>("core");
+    core->register_new_option(std::make_shared<wf::config::option_t<bool>>("hit_test_cache", false));
+    core->register_new_option(std::make_shared<wf::config::option_t<bool>>("bounding_box_cache", false));
+    wf::get_core().config.merge_section(core);
+}
+
+int main(int argc, char **argv)
+{
+    std::string baselines_path;
+    bool update = false;
+    int repetitions = 7;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--baselines") && (i + 1 < argc))
+        {
+            baselines_path = argv[++i];
+        } else if (arg == "--update-baselines")
+        {
+            update = true;
+        } else if ((arg == "--repetitions") && (i + 1 < argc))
+        {
+            repetitions = std::max(1, std::atoi(argv[++i]));
+        } else
+        {
+            std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    wf::log::initialize_logging(std::cerr, wf::log::LOG_LEVEL_ERROR, wf::log::LOG_COLOR_MODE_OFF);
+    wf::wl_idle_call::loop = wl_event_loop_create();
+    register_options();
+
+    nlohmann::json baselines = {{"tolerance", 0.25}, {"cases", nlohmann::json::object()}};
+    if (!baselines_path.empty())
+    {
+        std::ifstream in{baselines_path};
+        if (in)
+        {
+            try {
+                baselines = nlohmann::json::parse(in);
+            } catch (nlohmann::json::exception& e)
+            {
+                std::fprintf(stderr, "Failed to parse %s: %s\n", baselines_path.c_str(), e.what());
+                return 1;
+            }
+        } else if (!update)
+        {
+            std::fprintf(stderr, "Failed to open %s\n", baselines_path.c_str());
+            return 1;
+        }
+    }
+
+    const double calibration_ns = measure(repetitions, calibration_workload());
+    std::vector<case_result_t> results;
+    for (auto& perf_case : all_cases())
+    {
+        auto run = perf_case.setup();
+        run(); // warm up caches and lazily initialized state
+        const double ns = measure(repetitions, run);
+        results.push_back({perf_case.name, ns, ns / calibration_ns});
+    }
+
+    const double default_tolerance = baselines.value("tolerance", 0.25);
+    bool failed = false;
+
+    nlohmann::json report;
+    report["calibration-ns"] = calibration_ns;
+    report["repetitions"]    = repetitions;
+    report["checksum"] = checksum;
+    for (auto& result : results)
+    {
+        auto& entry = report["cases"][result.name];
+        entry["ns-per-op"] = result.ns_per_op;
+        entry["relative"]  = result.relative;
+
+        auto& baseline = baselines["cases"][result.name];
+        if (update)
+        {
+            const double tolerance = baseline.is_object() ? baseline.value("tolerance", -1.0) : -1.0;
+            baseline = {{"relative", result.relative}};
+            if (tolerance >= 0)
+            {
+                baseline["tolerance"] = tolerance;
+            }
+
+            continue;
+        }
+
+        if (!baseline.is_object() || !baseline.contains("relative"))
+        {
+            entry["status"] = "no baseline";
+            std::fprintf(stderr, "No baseline for %s, record one with --update-baselines\n",
+                result.name.c_str());
+            failed = true;
+            continue;
+        }
+
+        const double expected  = baseline["relative"];
+        const double tolerance = baseline.value("tolerance", default_tolerance);
+        entry["baseline"] = expected;
+        entry["change"]   = result.relative / expected - 1.0;
+        if (result.relative > expected * (1.0 + tolerance))
+        {
+            entry["status"] = "regressed";
+            failed = true;
+        } else if (result.relative < expected * (1.0 - tolerance))
+        {
+            entry["status"] = "improved";
+        } else
+        {
+            entry["status"] = "ok";
+        }
+    }
+
+    if (update)
+    {
+        std::ofstream out{baselines_path};
+        out << baselines.dump(4) << std::endl;
+        if (!out)
+        {
+            std::fprintf(stderr, "Failed to write %s\n", baselines_path.c_str());
+            return 1;
+        }
+    }
+
+    std::printf("%s\n", report.dump(2).c_str());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#include "bench-harness.hpp"
+#include <wayfire/nonstd/safe-list.hpp>
+#include <wayfire/nonstd/compact-safe-list.hpp>
+#include <wayfire/util.hpp>
+#include <wayland-server-core.h>
+
+/**
+ * A benchmark of the lists of signal connections, comparing wf::safe_list_t with wf::compact_safe_list_t.
+ *
+ * Usage: safe-list-bench [--connections N] [--rounds N]
+ *
+ * Each round emits a signal to the given number of connections, during which one connection disconnects
+ * itself and connects a replacement, like one-shot handlers do. Then a connection is added and removed
+ * again outside of the emission, like a temporary connection of a plugin. The event loop is dispatched
+ * after each round, so that wf::safe_list_t can run its deferred cleanup. The times are per round.
+ */
+
+struct connection_t
+{
+    int calls = 0;
+};
+
+template<class List>
+static long measure(wf::perf::bench_t& bench, const std::string& name, wl_event_loop *loop)
+{
+    const int connections = bench.param("connections");
+    std::vector<connection_t> storage(connections + 2);
+    List list;
+    for (int i = 0; i < connections; i++)
+    {
+        list.push_back(&storage[i]);
+    }
+
+    // The connection which is replaced in the current round, and its replacement.
+    int replaced = connections / 2;
+    int spare    = connections;
+    auto temporary = &storage[connections + 1];
+
+    bench.measure(name, bench.param("rounds"), [&] (int)
+    {
+        list.for_each([&] (connection_t *conn)
+        {
+            ++conn->calls;
+            if (conn == &storage[replaced])
+            {
+                list.remove_all(conn);
+                list.push_back(&storage[spare]);
+                std::swap(replaced, spare);
+            }
+        });
+
+        list.push_back(temporary);
+        list.remove_all(temporary);
+        wl_event_loop_dispatch(loop, 0);
+    });
+
+    long calls = 0;
+    for (auto& conn : storage)
+    {
+        calls += conn.calls;
+    }
+
+    return calls;
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {{"connections", 8}, {"rounds", 200'000}}};
+
+    // wf::safe_list_t defers its cleanup to an idle callback.
+    auto loop = wl_event_loop_create();
+    wf::wl_idle_call::loop = loop;
+
+    const long calls_safe    = measure<wf::safe_list_t<connection_t*>>(bench, "safe_list", loop);
+    const long calls_compact =
+        measure<wf::compact_safe_list_t<connection_t*>>(bench, "compact_safe_list", loop);
+    bench.extra["calls"] = {{"safe_list", calls_safe}, {"compact_safe_list", calls_compact}};
+
+    wl_event_loop_destroy(loop);
+    return bench.finish();
+}
@@ -0,0 +1,57 @@
+#include "bench-harness.hpp"
+#include <wayfire/signal-provider.hpp>
+
+/**
+ * A benchmark of emitting signals, both without any listeners (the common case for most signals on most
+ * objects) and with a few listeners for several signal types.
+ *
+ * Usage: signal-emit-bench [--iterations N]
+ */
+
+struct signal_a
+{
+    int value = 0;
+};
+
+struct signal_b
+{
+    int value = 0;
+};
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {{"iterations", 1'000'000}}};
+    const int iterations = bench.param("iterations");
+
+    auto measure = [&] (const std::string& name, wf::signal::provider_t& provider)
+    {
+        signal_a a{1};
+        bench.measure(name, iterations, [&] (int)
+        {
+            provider.emit(&a);
+        });
+    };
+
+    wf::signal::provider_t empty;
+    measure("no_connections", empty);
+
+    long counter = 0;
+    wf::signal::provider_t other_only;
+    wf::signal::connection_t<signal_b> on_b = [&] (signal_b*) { ++counter; };
+    other_only.connect(&on_b);
+    measure("connections_to_other_signal", other_only);
+
+    wf::signal::provider_t busy;
+    wf::signal::connection_t<signal_a> on_a[4];
+    for (auto& conn : on_a)
+    {
+        conn = [&] (signal_a *ev) { counter += ev->value; };
+        busy.connect(&conn);
+    }
+
+    busy.connect(&on_b);
+    measure("four_connections", busy);
+
+    bench.extra["calls"] = counter;
+    return bench.finish();
+}
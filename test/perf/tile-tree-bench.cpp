@@ -0,0 +1,83 @@
+#include "bench-harness.hpp"
+#include "tree.hpp"
+#include <wayfire/txn/transaction.hpp>
+
+#include <memory>
+
+/**
+ * A benchmark of the layout of the simple-tile tree.
+ *
+ * It builds a tree of the given depth in which every split node has the given number of children, with
+ * alternating split directions. The leaves are stand-ins for the view nodes, which only record their
+ * geometry, so no views (and no running compositor) are needed.
+ *
+ * Usage: tile-tree-bench [--depth N] [--children N] [--iterations N]
+ */
+
+struct bench_leaf_t : public wf::tile::tree_node_t
+{
+    void set_gaps(const wf::tile::gap_size_t& gaps) override
+    {
+        this->gaps = gaps;
+    }
+};
+
+static int nr_leaves = 0;
+
+static std::unique_ptr<wf::tile::tree_node_t> build_tree(int depth, int children, int level = 0)
+{
+    if (level == depth)
+    {
+        ++nr_leaves;
+        return std::make_unique<bench_leaf_t>();
+    }
+
+    auto tx    = wf::txn::transaction_t::create();
+    auto split = std::make_unique<wf::tile::split_node_t>(
+        (level % 2) ? wf::tile::SPLIT_HORIZONTAL : wf::tile::SPLIT_VERTICAL);
+    split->set_geometry({0, 0, 1920, 1080}, tx);
+    for (int i = 0; i < children; i++)
+    {
+        split->add_child(build_tree(depth, children, level + 1), tx);
+    }
+
+    return split;
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {{"depth", 6}, {"children", 3}, {"iterations", 200}}};
+    const int iterations = bench.param("iterations");
+
+    auto root = build_tree(bench.param("depth"), bench.param("children"));
+    auto split_root = root->as_split_node();
+
+    // Resizing the whole tree, like after a workarea change
+    bench.measure("resize_tree", iterations, [&] (int i)
+    {
+        auto tx = wf::txn::transaction_t::create();
+        root->set_geometry({0, 0, 1920 - (i % 2) * 100, 1080}, tx);
+    });
+
+    // Changing the gaps, like update_gaps() does
+    bench.measure("change_gaps", iterations, [&] (int i)
+    {
+        auto tx = wf::txn::transaction_t::create();
+        wf::tile::gap_size_t gaps;
+        gaps.left     = gaps.right = gaps.top = gaps.bottom = i % 8;
+        gaps.internal = i % 4;
+        root->set_gaps(gaps);
+        root->set_geometry(root->geometry, tx);
+    });
+
+    // Inserting and removing a view at the top level, which resizes all other views
+    bench.measure("insert_remove_child", iterations, [&] (int)
+    {
+        auto tx = wf::txn::transaction_t::create();
+        split_root->add_child(std::make_unique<bench_leaf_t>(), tx);
+        split_root->remove_child({root->children.back().get()}, tx);
+    });
+
+    bench.extra["leaves"] = nr_leaves;
+    return bench.finish();
+}
@@ -0,0 +1,152 @@
+#include "bench-harness.hpp"
+#include "src/core/seat/touch-gesture-set.hpp"
+
+#include <memory>
+
+/**
+ * A benchmark of the dispatch of touch events to the registered touch gestures.
+ *
+ * Usage: touch-gesture-bench [--gesture-copies N] [--motion-rounds N] [--fingers N]
+ *
+ * Each copy registers a tap and a touch-and-hold gesture for 1 to 5 fingers, similar to the gestures of
+ * extra-gestures. A touch sequence puts all fingers down one after another, moves all of them for the given
+ * number of rounds and lifts them. The events are dispatched through touch_gesture_set_t, and, for
+ * comparison, to all gestures as core did before. The times are per event.
+ */
+
+using namespace wf::touch;
+
+class null_timer_t : public timer_interface_t
+{
+  public:
+    void set_timeout(uint32_t msec, std::function<void()> handler) override
+    {}
+    void reset() override
+    {}
+};
+
+static std::vector<std::unique_ptr<gesture_t>> make_gestures(int copies, int& completed)
+{
+    std::vector<std::unique_ptr<gesture_t>> gestures;
+    for (int i = 0; i < copies; i++)
+    {
+        for (int fingers = 1; fingers <= 5; fingers++)
+        {
+            gestures.push_back(std::make_unique<gesture_t>(gesture_builder_t()
+                .action(touch_action_t(fingers, true).set_move_tolerance(50).set_duration(150))
+                .action(touch_action_t(fingers, false).set_move_tolerance(50).set_duration(150))
+                .on_completed([&] () { ++completed; })
+                .build()));
+            gestures.push_back(std::make_unique<gesture_t>(gesture_builder_t()
+                .action(touch_action_t(fingers, true).set_move_tolerance(50).set_duration(100))
+                .action(hold_action_t(500).set_move_tolerance(100))
+                .on_completed([&] () { ++completed; })
+                .build()));
+        }
+    }
+
+    for (auto& gesture : gestures)
+    {
+        gesture->set_timer(std::make_unique<null_timer_t>());
+    }
+
+    return gestures;
+}
+
+/** Generate one touch sequence, together with the number of fingers down for each event. */
+static std::vector<std::pair<gesture_event_t, size_t>> make_sequence(int rounds, int fingers)
+{
+    std::vector<std::pair<gesture_event_t, size_t>> events;
+    uint32_t time = 0;
+    for (int f = 0; f < fingers; f++)
+    {
+        gesture_event_t ev;
+        ev.type   = EVENT_TYPE_TOUCH_DOWN;
+        ev.time   = ++time;
+        ev.finger = f;
+        ev.pos    = {100.0 + 50 * f, 100.0};
+        events.push_back({ev, (size_t)f + 1});
+    }
+
+    for (int r = 0; r < rounds; r++)
+    {
+        time += 4;
+        for (int f = 0; f < fingers; f++)
+        {
+            gesture_event_t ev;
+            ev.type   = EVENT_TYPE_MOTION;
+            ev.time   = time;
+            ev.finger = f;
+            ev.pos    = {100.0 + 50 * f + r * 0.5, 100.0 + r * 0.5};
+            events.push_back({ev, (size_t)fingers});
+        }
+    }
+
+    for (int f = 0; f < fingers; f++)
+    {
+        gesture_event_t ev;
+        ev.type   = EVENT_TYPE_TOUCH_UP;
+        ev.time   = ++time;
+        ev.finger = f;
+        ev.pos    = {100.0 + 50 * f + rounds * 0.5, 100.0 + rounds * 0.5};
+        events.push_back({ev, (size_t)(fingers - f)});
+    }
+
+    return events;
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv,
+        {{"gesture-copies", 4}, {"motion-rounds", 200, 0}, {"fingers", 10, 1, 10}}};
+    const int copies  = bench.param("gesture-copies");
+    const int rounds  = bench.param("motion-rounds");
+    const int fingers = bench.param("fingers");
+    const int sequences = 50;
+
+    int completed_pruned = 0, completed_all = 0;
+    auto pruned_gestures = make_gestures(copies, completed_pruned);
+    auto all_gestures    = make_gestures(copies, completed_all);
+    const auto events    = make_sequence(rounds, fingers);
+
+    wf::touch_gesture_set_t set;
+    for (auto& gesture : pruned_gestures)
+    {
+        set.add({gesture});
+    }
+
+    size_t running_after_down = 0;
+    bench.measure("pruned", sequences, [&] (int)
+    {
+        for (auto& [ev, nr_fingers] : events)
+        {
+            set.update(ev, nr_fingers);
+            if ((ev.type == EVENT_TYPE_TOUCH_DOWN) && (nr_fingers == (size_t)fingers))
+            {
+                running_after_down = set.nr_running();
+            }
+        }
+    }, events.size());
+
+    bench.measure("all_gestures", sequences, [&] (int)
+    {
+        for (auto& [ev, nr_fingers] : events)
+        {
+            for (auto& gesture : all_gestures)
+            {
+                if ((nr_fingers == 1) && (ev.type == EVENT_TYPE_TOUCH_DOWN))
+                {
+                    gesture->reset(ev.time);
+                }
+
+                gesture->update_state(ev);
+            }
+        }
+    }, events.size());
+
+    bench.extra["gestures"] = pruned_gestures.size();
+    bench.extra["events"]   = events.size();
+    bench.extra["running-after-last-down"] = running_after_down;
+    bench.extra["completed"] = {{"pruned", completed_pruned}, {"all_gestures", completed_all}};
+    return bench.finish();
+}
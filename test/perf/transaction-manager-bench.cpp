@@ -0,0 +1,122 @@
+#include "bench-harness.hpp"
+#include "wayfire/txn/transaction-manager.hpp"
+#include "wayfire/util.hpp"
+#include <wayland-server-core.h>
+
+#include "../txn/transaction-test-object.hpp"
+#include <wayfire/txn/transaction.hpp>
+#include "../../src/core/txn/transaction-manager-impl.hpp"
+
+#include <memory>
+
+/**
+ * A throughput benchmark of the transaction manager.
+ *
+ * Usage: transaction-manager-bench [--objects N] [--iterations N]
+ *
+ * The times are per scheduled transaction (or lookup).
+ */
+
+static wf::txn::transaction_uptr new_tx()
+{
+    return std::make_unique<wf::txn::transaction_t>(0, [] (auto, auto) {});
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {{"objects", 5000}, {"iterations", 10}}};
+    const int nr_objects = bench.param("objects");
+    const int iterations = bench.param("iterations");
+
+    wf::wl_idle_call::loop = wl_event_loop_create();
+
+    std::vector<std::shared_ptr<txn_test_object_t>> objects;
+    for (int i = 0; i < nr_objects; i++)
+    {
+        objects.push_back(std::make_shared<txn_test_object_t>(false));
+    }
+
+    // Every object gets its own transaction, which is committed immediately and applied afterwards.
+    {
+        wf::txn::transaction_manager_t::impl mgr;
+        bench.measure("independent_transactions", iterations, [&] (int)
+        {
+            for (auto& obj : objects)
+            {
+                auto tx = new_tx();
+                tx->add_object(obj);
+                mgr.schedule_transaction(std::move(tx));
+            }
+
+            for (auto& obj : objects)
+            {
+                obj->emit_ready();
+            }
+
+            wl_event_loop_dispatch_idle(wf::wl_idle_call::loop);
+        }, nr_objects);
+    }
+
+    // Like a tiling layout reflowing groups of windows: while the objects are blocked by a committed
+    // transaction, new transactions for groups of 30 objects keep coming in and have to be merged.
+    constexpr int GROUP_SIZE = 30;
+    int merged_ops = 0;
+    const double merging_ns = wf::perf::time_ns([&] ()
+    {
+        wf::txn::transaction_manager_t::impl mgr;
+        auto blocking = new_tx();
+        for (auto& obj : objects)
+        {
+            blocking->add_object(obj);
+        }
+
+        mgr.schedule_transaction(std::move(blocking));
+        for (int it = 0; it < iterations; it++)
+        {
+            // Shift the groups on each iteration, so that each new transaction overlaps two older ones.
+            for (int start = (it * GROUP_SIZE / 2) % nr_objects; start < nr_objects; start += GROUP_SIZE)
+            {
+                auto tx = new_tx();
+                for (int i = start; i < std::min(start + GROUP_SIZE, nr_objects); i++)
+                {
+                    tx->add_object(objects[i]);
+                }
+
+                mgr.schedule_transaction(std::move(tx));
+                ++merged_ops;
+            }
+        }
+
+        for (auto& obj : objects)
+        {
+            obj->emit_ready();
+        }
+
+        wl_event_loop_dispatch_idle(wf::wl_idle_call::loop);
+    });
+
+    // Lookups of objects while all of them have a committed and a pending transaction.
+    wf::txn::transaction_manager_t manager;
+    for (int i = 0; i < 2; i++)
+    {
+        for (auto& obj : objects)
+        {
+            auto tx = new_tx();
+            tx->add_object(obj);
+            manager.schedule_transaction(std::move(tx));
+        }
+    }
+
+    size_t found = 0;
+    bench.measure("object_lookup", iterations, [&] (int)
+    {
+        for (auto& obj : objects)
+        {
+            found += manager.is_object_pending(obj) + manager.is_object_committed(obj);
+        }
+    }, nr_objects);
+
+    bench.add_result("merged_transactions", merging_ns / std::max(merged_ops, 1));
+    bench.extra["lookup-hits"] = found;
+    return bench.finish();
+}
@@ -0,0 +1,82 @@
+#include "bench-harness.hpp"
+#include "vswipe-processing.hpp"
+
+/**
+ * A benchmark of the per-event processing of touchpad swipes in vswipe.
+ *
+ * Usage: vswipe-bench [--swipes N] [--events-per-swipe N] [--workspaces N]
+ *
+ * Each swipe is a stream of update events like the ones libinput sends for a fast swipe over a row of
+ * workspaces, with some jitter and a few reversals. The deltas are processed like in vswipe's update
+ * handler, and the target workspace is computed at the end of each swipe. Swipes start on every workspace
+ * in turn, so the rubberband slowdown at the edges of the grid is exercised as well. The times are per
+ * event.
+ */
+
+struct swipe_event_t
+{
+    double dx;
+};
+
+static std::vector<swipe_event_t> make_swipe(int events, unsigned seed)
+{
+    std::vector<swipe_event_t> swipe;
+    swipe.reserve(events);
+    const double direction = (seed % 2) ? 1.0 : -1.0;
+    for (int i = 0; i < events; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const double jitter = ((seed >> 16) % 1000) / 1000.0 - 0.5;
+        // Reverse for a short while in the middle of the swipe, like a user changing their mind.
+        const double sign = ((i > events / 2) && (i < events / 2 + events / 10)) ? -1.0 : 1.0;
+        swipe.push_back({direction * sign * (8.0 + 4.0 * jitter)});
+    }
+
+    return swipe;
+}
+
+/** @return The sum of the target workspaces of all swipes. */
+static long long measure(wf::perf::bench_t& bench, const std::string& name,
+    const std::vector<std::vector<swipe_event_t>>& swipes, bool free_movement)
+{
+    const double speed_factor = 256;
+    const double speed_cap    = 0.05;
+    const int vw = bench.param("workspaces");
+
+    long long target_sum = 0;
+    bench.measure(name, swipes.size(), [&] (int s)
+    {
+        const int vx = s % vw;
+        double delta_sum  = 0;
+        double delta_prev = 0;
+        double delta_last = 0;
+        for (auto& ev : swipes[s])
+        {
+            delta_prev = delta_last;
+            delta_sum += vswipe_process_delta(ev.dx / speed_factor, delta_sum, vx, vw,
+                speed_cap, free_movement);
+            delta_last = ev.dx;
+        }
+
+        target_sum += vswipe_finish_target(delta_sum, vx, vw, delta_prev + delta_last,
+            0.35, 24, free_movement);
+    }, bench.param("events-per-swipe"));
+
+    return target_sum;
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {{"swipes", 2000}, {"events-per-swipe", 120}, {"workspaces", 3}}};
+
+    std::vector<std::vector<swipe_event_t>> swipes;
+    for (int i = 0; i < bench.param("swipes"); i++)
+    {
+        swipes.push_back(make_swipe(bench.param("events-per-swipe"), i));
+    }
+
+    const auto bounded = measure(bench, "bounded", swipes, false);
+    const auto free    = measure(bench, "free_movement", swipes, true);
+    bench.extra["target-sum"] = {{"bounded", bounded}, {"free_movement", free}};
+    return bench.finish();
+}
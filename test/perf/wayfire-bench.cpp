@@ -0,0 +1,273 @@
+#include "bench-harness.hpp"
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/unstable/translation-node.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/config/section.hpp>
+#include <wayfire/config/option.hpp>
+#include <wayland-server-core.h>
+
+/**
+ * A headless benchmark of the hot paths of the scenegraph.
+ *
+ * It builds a synthetic scenegraph of N outputs, each with M views, each view consisting of a main surface and
+ * K subsurfaces. No backend or GL context is needed: the surfaces are simple rectangles, and their render
+ * instances only count the rectangles they would have painted.
+ *
+ * Usage: wayfire-bench [--outputs N] [--views M] [--subsurfaces K] [--iterations I]
+ *                      [--hit-test-cache 0|1] [--bounding-box-cache 0|1]
+ *
+ * The view nodes are tagged like the root nodes of real views, so that the hit-test cache can skip them.
+ */
+
+static constexpr int OUTPUT_WIDTH  = 1920;
+static constexpr int OUTPUT_HEIGHT = 1080;
+
+static uint64_t painted_rects = 0;
+
+class bench_surface_node_t : public wf::scene::node_t
+{
+  public:
+    bench_surface_node_t(wf::geometry_t box) : node_t(false), box(box)
+    {}
+
+    std::optional<wf::scene::input_node_t> find_node_at(const wf::pointf_t& at) override
+    {
+        if (box & at)
+        {
+            wf::scene::input_node_t result;
+            result.node = this;
+            result.local_coords = {at.x - box.x, at.y - box.y};
+            return result;
+        }
+
+        return {};
+    }
+
+    void gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
+        wf::scene::damage_callback push_damage, wf::output_t *output) override;
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return box;
+    }
+
+    std::string stringify() const override
+    {
+        return "bench surface " + stringify_flags();
+    }
+
+    wf::geometry_t box;
+};
+
+class bench_surface_instance_t : public wf::scene::simple_render_instance_t<bench_surface_node_t>
+{
+  public:
+    using simple_render_instance_t::simple_render_instance_t;
+
+    void render(const wf::render_target_t& target, const wf::region_t& region) override
+    {
+        // Mocked GL layer: only count the rectangles which would have been painted.
+        for (const auto& rect : region)
+        {
+            (void)rect;
+            ++painted_rects;
+        }
+    }
+
+    void compute_visibility(wf::output_t *output, wf::region_t& visible) override
+    {
+        // All surfaces are opaque.
+        visible ^= self->get_bounding_box();
+    }
+};
+
+void bench_surface_node_t::gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
+    wf::scene::damage_callback push_damage, wf::output_t *output)
+{
+    instances.push_back(std::make_unique<bench_surface_instance_t>(this, push_damage, output));
+}
+
+/** Like the root node of a view, without an actual view. */
+class bench_view_node_t : public wf::scene::translation_node_t, public wf::view_node_tag_t
+{
+  public:
+    bench_view_node_t() : view_node_tag_t(nullptr)
+    {}
+};
+
+struct bench_scene_t
+{
+    std::shared_ptr<wf::scene::floating_inner_node_t> root;
+    std::vector<std::shared_ptr<wf::scene::floating_inner_node_t>> outputs;
+    std::vector<std::shared_ptr<bench_surface_node_t>> surfaces;
+};
+
+static bench_scene_t build_scene(const wf::perf::bench_t& bench)
+{
+    bench_scene_t scene;
+    scene.root = std::make_shared<wf::scene::floating_inner_node_t>(true);
+
+    // A deterministic pseudo-random generator, so that results are comparable between runs.
+    uint32_t seed = 42;
+    auto next_random = [&] (int max)
+    {
+        seed = seed * 1103515245 + 12345;
+        return (int)((seed >> 16) % max);
+    };
+
+    std::vector<wf::scene::node_ptr> output_nodes;
+    for (int o = 0; o < bench.param("outputs"); o++)
+    {
+        auto output = std::make_shared<wf::scene::translation_node_t>(true);
+        output->set_offset({o * OUTPUT_WIDTH, 0});
+
+        std::vector<wf::scene::node_ptr> views;
+        for (int v = 0; v < bench.param("views"); v++)
+        {
+            auto view = std::make_shared<bench_view_node_t>();
+            view->set_offset({next_random(OUTPUT_WIDTH - 400), next_random(OUTPUT_HEIGHT - 300)});
+
+            std::vector<wf::scene::node_ptr> view_surfaces;
+            for (int s = 0; s < bench.param("subsurfaces"); s++)
+            {
+                auto sub = std::make_shared<bench_surface_node_t>(
+                    wf::geometry_t{next_random(300), next_random(200), 64, 64});
+                scene.surfaces.push_back(sub);
+                view_surfaces.push_back(sub);
+            }
+
+            auto main_surface = std::make_shared<bench_surface_node_t>(
+                wf::geometry_t{0, 0, 400 + next_random(400), 300 + next_random(300)});
+            scene.surfaces.push_back(main_surface);
+            view_surfaces.push_back(main_surface);
+
+            view->set_children_list(view_surfaces);
+            views.push_back(view);
+        }
+
+        output->set_children_list(views);
+        scene.outputs.push_back(output);
+        output_nodes.push_back(output);
+    }
+
+    scene.root->set_children_list(output_nodes);
+    return scene;
+}
+
+static void register_options(const wf::perf::bench_t& bench)
+{
+    auto core = std::make_shared<wf::config::section_t>("core");
+    core->register_new_option(
+        std::make_shared<wf::config::option_t<bool>>("hit_test_cache", bench.param("hit-test-cache")));
+    core->register_new_option(
+        std::make_shared<wf::config::option_t<bool>>("bounding_box_cache",
+            bench.param("bounding-box-cache")));
+    wf::get_core().config.merge_section(core);
+
+    auto workarounds = std::make_shared<wf::config::section_t>("workarounds");
+    workarounds->register_new_option(std::make_shared<wf::config::option_t<bool>>(
+        "enable_opaque_region_damage_optimizations", false));
+    wf::get_core().config.merge_section(workarounds);
+}
+
+int main(int argc, char **argv)
+{
+    wf::perf::bench_t bench{argc, argv, {
+        {"outputs", 2}, {"views", 20, 0}, {"subsurfaces", 3, 0}, {"iterations", 1000},
+        {"hit-test-cache", 0, 0, 1}, {"bounding-box-cache", 0, 0, 1},
+    }};
+
+    // wl_idle_calls need an event loop, even if it is never dispatched.
+    wf::wl_idle_call::loop = wl_event_loop_create();
+    register_options(bench);
+
+    auto scene = build_scene(bench);
+    const int iterations = bench.param("iterations");
+    const int nr_outputs = bench.param("outputs");
+
+    // Hit-testing at pseudo-random points on all outputs
+    bench.measure("find_node_at", iterations, [&] (int i)
+    {
+        wf::pointf_t at{(double)((i * 7919) % (OUTPUT_WIDTH * nr_outputs)),
+            (double)((i * 104729) % OUTPUT_HEIGHT)};
+        auto result = scene.root->find_node_at(at);
+        (void)result;
+    });
+
+    // Generating the render instances of each output
+    wf::region_t accumulated_damage;
+    auto push_damage = [&] (const wf::region_t& region)
+    {
+        accumulated_damage |= region;
+    };
+
+    bench.measure("gen_render_instances", iterations, [&] (int)
+    {
+        for (auto& output : scene.outputs)
+        {
+            std::vector<wf::scene::render_instance_uptr> instances;
+            output->gen_render_instances(instances, push_damage, nullptr);
+        }
+    });
+
+    std::vector<std::vector<wf::scene::render_instance_uptr>> instances(scene.outputs.size());
+    for (size_t o = 0; o < scene.outputs.size(); o++)
+    {
+        scene.outputs[o]->gen_render_instances(instances[o], push_damage, nullptr);
+    }
+
+    const wf::geometry_t output_box = {0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT};
+    bench.measure("compute_visibility_from_list", iterations, [&] (int)
+    {
+        for (size_t o = 0; o < instances.size(); o++)
+        {
+            wf::region_t visible = output_box + wf::point_t{(int)o * OUTPUT_WIDTH, 0};
+            wf::scene::compute_visibility_from_list(instances[o], nullptr, visible, {0, 0});
+        }
+    });
+
+    // Damage a single surface and propagate it to the output
+    bench.measure("damage_propagation", iterations, [&] (int i)
+    {
+        auto& surface = scene.surfaces[i % scene.surfaces.size()];
+        wf::scene::damage_node(surface, surface->get_bounding_box());
+    });
+
+    // Typical damage tracking operations on single-rectangle regions: clip surface damage to the output,
+    // subtract an opaque box and accumulate it.
+    bench.measure("region_ops", iterations, [&] (int i)
+    {
+        wf::region_t frame_damage;
+        for (auto& surface : scene.surfaces)
+        {
+            wf::region_t damage = surface->get_bounding_box();
+            damage &= output_box;
+            damage ^= wf::geometry_t{0, 0, 32, 32};
+            frame_damage |= damage & output_box;
+        }
+
+        (void)frame_damage;
+    });
+
+    // A full repaint of every output
+    painted_rects = 0;
+    bench.measure("run_render_pass", iterations, [&] (int)
+    {
+        for (size_t o = 0; o < instances.size(); o++)
+        {
+            wf::scene::render_pass_params_t pass;
+            pass.instances = &instances[o];
+            pass.target.geometry = output_box + wf::point_t{(int)o * OUTPUT_WIDTH, 0};
+            pass.damage = pass.target.geometry;
+            wf::scene::run_render_pass(pass, 0);
+        }
+    });
+
+    instances.clear();
+    bench.extra["nodes"] = scene.surfaces.size();
+    bench.extra["painted-rects-per-pass"] = (double)painted_rects / iterations;
+    return bench.finish();
+}
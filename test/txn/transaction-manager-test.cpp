@@ -290,3 +290,84 @@ TEST_CASE("Concurrent committed")
     REQUIRE(mgr.pending.size() == 0);
     REQUIRE(mgr.done.size() == 2);
 }
+
+TEST_CASE("Pending and committed objects are tracked")
+{
+    setup_wayfire_debugging_state();
+    wf::txn::transaction_manager_t mgr;
+
+    auto obj_a = std::make_shared<txn_test_object_t>(false);
+    auto obj_b = std::make_shared<txn_test_object_t>(false);
+    auto obj_c = std::make_shared<txn_test_object_t>(false);
+
+    auto tx1 = new_tx();
+    tx1->add_object(obj_a);
+    mgr.schedule_transaction(std::move(tx1));
+    REQUIRE(mgr.is_object_committed(obj_a));
+    REQUIRE(!mgr.is_object_pending(obj_a));
+
+    // tx2 waits for tx1, tx3 is merged into tx2, so obj_c is pending as well.
+    auto tx2 = new_tx();
+    tx2->add_object(obj_a);
+    tx2->add_object(obj_b);
+    mgr.schedule_transaction(std::move(tx2));
+
+    auto tx3 = new_tx();
+    tx3->add_object(obj_b);
+    tx3->add_object(obj_c);
+    mgr.schedule_transaction(std::move(tx3));
+    REQUIRE(mgr.priv->pending.size() == 1);
+    REQUIRE(mgr.is_object_pending(obj_a));
+    REQUIRE(mgr.is_object_pending(obj_b));
+    REQUIRE(mgr.is_object_pending(obj_c));
+    REQUIRE(!mgr.is_object_committed(obj_b));
+
+    obj_a->emit_ready();
+    REQUIRE(mgr.is_object_committed(obj_a));
+    REQUIRE(mgr.is_object_committed(obj_c));
+    REQUIRE(!mgr.is_object_pending(obj_a));
+    REQUIRE(!mgr.is_object_pending(obj_c));
+
+    obj_a->emit_ready();
+    obj_b->emit_ready();
+    obj_c->emit_ready();
+    REQUIRE(!mgr.is_object_committed(obj_a));
+    REQUIRE(!mgr.is_object_committed(obj_b));
+    REQUIRE(!mgr.is_object_committed(obj_c));
+}
+
+TEST_CASE("Transaction lifecycle is traced")
+{
+    setup_wayfire_debugging_state();
+    wf::txn::transaction_manager_t mgr;
+    REQUIRE(mgr.get_trace().empty());
+
+    using event_t = wf::txn::transaction_event_t;
+    auto events = [&] ()
+    {
+        std::vector<event_t> result;
+        for (auto& entry : mgr.get_trace())
+        {
+            result.push_back(entry.event);
+        }
+
+        return result;
+    };
+
+    mgr.set_trace_capacity(4);
+    auto obj = std::make_shared<txn_test_object_t>(false);
+    auto tx  = new_tx();
+    tx->add_object(obj);
+    mgr.schedule_transaction(std::move(tx));
+    obj->emit_ready();
+    REQUIRE(events() == std::vector<event_t>{event_t::SCHEDULED, event_t::COMMITTED,
+        event_t::OBJECT_READY, event_t::APPLIED});
+
+    // The oldest entries are overwritten.
+    auto tx2 = new_tx();
+    tx2->add_object(obj);
+    mgr.schedule_transaction(std::move(tx2));
+    REQUIRE(events() == std::vector<event_t>{event_t::OBJECT_READY, event_t::APPLIED,
+        event_t::SCHEDULED, event_t::COMMITTED});
+    REQUIRE(mgr.get_trace().front().time_us <= mgr.get_trace().back().time_us);
+}
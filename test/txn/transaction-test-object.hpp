@@ -48,7 +48,7 @@ inline void setup_wayfire_debugging_state()
     wf::log::initialize_logging(std::cout, wf::log::LOG_LEVEL_DEBUG, wf::log::LOG_COLOR_MODE_ON);
     wf::log::enabled_categories.set((size_t)wf::log::logging_category::TXN, 1);
     wf::log::enabled_categories.set((size_t)wf::log::logging_category::TXNI, 1);
-    // Set wl_idle_call's loop to a fake loop so that the test doesn't crash when using signals which in turn
-    // use safe_list_t which needs wl_idle_calls.
+    // Set wl_idle_call's loop to a fake loop so that the test doesn't crash when the transaction manager
+    // uses wl_idle_calls.
     wf::wl_idle_call::loop = wl_event_loop_create();
 }